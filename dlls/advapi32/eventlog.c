@@ -205,12 +205,14 @@ ULONG WINAPI EnableTraceEx( LPCGUID provider, LPCGUID source, TRACEHANDLE hSessi
                             UCHAR level, ULONGLONG anykeyword, ULONGLONG allkeyword, ULONG enableprop,
                             PEVENT_FILTER_DESCRIPTOR filterdesc )
 {
-    FIXME("(%s, %s, %s, %u, %u, %s, %s, %u, %p): stub\n", debugstr_guid(provider),
+    TRACE("(%s, %s, %s, %u, %u, %s, %s, %u, %p)\n", debugstr_guid(provider),
             debugstr_guid(source), wine_dbgstr_longlong(hSession), enable, level,
             wine_dbgstr_longlong(anykeyword), wine_dbgstr_longlong(allkeyword),
             enableprop, filterdesc);
 
-    return ERROR_SUCCESS;
+    if (enableprop || filterdesc) FIXME("ignoring properties %#x and filter %p\n", enableprop, filterdesc);
+
+    return EnableTraceEx2( hSession, provider, enable, level, anykeyword, allkeyword, 0, NULL );
 }
 
 /******************************************************************************
@@ -218,10 +220,12 @@ ULONG WINAPI EnableTraceEx( LPCGUID provider, LPCGUID source, TRACEHANDLE hSessi
  */
 ULONG WINAPI EnableTrace( ULONG enable, ULONG flag, ULONG level, LPCGUID guid, TRACEHANDLE hSession )
 {
-    FIXME("(%d, 0x%x, %d, %s, %s): stub\n", enable, flag, level,
+    TRACE("(%d, 0x%x, %d, %s, %s)\n", enable, flag, level,
             debugstr_guid(guid), wine_dbgstr_longlong(hSession));
 
-    return ERROR_SUCCESS;
+    return EnableTraceEx2( hSession, guid,
+                           enable ? EVENT_CONTROL_CODE_ENABLE_PROVIDER : EVENT_CONTROL_CODE_DISABLE_PROVIDER,
+                           level, flag, 0, 0, NULL );
 }
 
 /******************************************************************************
@@ -38,6 +38,10 @@ static BOOL (WINAPI *pGetEventLogInformation)(HANDLE,DWORD,LPVOID,DWORD,LPDWORD)
 static ULONG (WINAPI *pEventRegister)(const GUID *,PENABLECALLBACK,void *,REGHANDLE *);
 static ULONG (WINAPI *pEventUnregister)(REGHANDLE);
 static ULONG (WINAPI *pEventWriteString)(REGHANDLE,UCHAR,ULONGLONG,const WCHAR *);
+static ULONG (WINAPI *pEventWrite)(REGHANDLE,const EVENT_DESCRIPTOR *,ULONG,EVENT_DATA_DESCRIPTOR *);
+static BOOLEAN (WINAPI *pEventEnabled)(REGHANDLE,const EVENT_DESCRIPTOR *);
+static ULONG (WINAPI *pEnableTraceEx2)(TRACEHANDLE,const GUID *,ULONG,UCHAR,ULONGLONG,ULONGLONG,ULONG,
+                                       ENABLE_TRACE_PARAMETERS *);
 
 static BOOL (WINAPI *pGetComputerNameExA)(COMPUTER_NAME_FORMAT,LPSTR,LPDWORD);
 static BOOL (WINAPI *pWow64DisableWow64FsRedirection)(PVOID *);
@@ -53,6 +57,9 @@ static void init_function_pointers(void)
     pEventWriteString = (void*)GetProcAddress(hadvapi32, "EventWriteString");
     pEventRegister = (void*)GetProcAddress(hadvapi32, "EventRegister");
     pEventUnregister = (void*)GetProcAddress(hadvapi32, "EventUnregister");
+    pEventWrite = (void*)GetProcAddress(hadvapi32, "EventWrite");
+    pEventEnabled = (void*)GetProcAddress(hadvapi32, "EventEnabled");
+    pEnableTraceEx2 = (void*)GetProcAddress(hadvapi32, "EnableTraceEx2");
 
     pGetComputerNameExA = (void*)GetProcAddress(hkernel32, "GetComputerNameExA");
     pWow64DisableWow64FsRedirection = (void*)GetProcAddress(hkernel32, "Wow64DisableWow64FsRedirection");
@@ -1175,7 +1182,7 @@ static void test_trace_event_params(void)
     }
 
     uret = pEventRegister(NULL, NULL, NULL, &reg_handle);
-    todo_wine ok(uret == ERROR_INVALID_PARAMETER, "EventRegister gave wrong error: %#x\n", uret);
+    ok(uret == ERROR_INVALID_PARAMETER, "EventRegister gave wrong error: %#x\n", uret);
 
     uret = pEventRegister(&test_guid, NULL, NULL, NULL);
     ok(uret == ERROR_INVALID_PARAMETER, "EventRegister gave wrong error: %#x\n", uret);
@@ -1184,13 +1191,13 @@ static void test_trace_event_params(void)
     ok(uret == ERROR_SUCCESS, "EventRegister gave wrong error: %#x\n", uret);
 
     uret = pEventWriteString(0, 0, 0, emptyW);
-    todo_wine ok(uret == ERROR_INVALID_HANDLE, "EventWriteString gave wrong error: %#x\n", uret);
+    ok(uret == ERROR_INVALID_HANDLE, "EventWriteString gave wrong error: %#x\n", uret);
 
     uret = pEventWriteString(reg_handle, 0, 0, NULL);
-    todo_wine ok(uret == ERROR_INVALID_PARAMETER, "EventWriteString gave wrong error: %#x\n", uret);
+    ok(uret == ERROR_INVALID_PARAMETER, "EventWriteString gave wrong error: %#x\n", uret);
 
     uret = pEventUnregister(0);
-    todo_wine ok(uret == ERROR_INVALID_HANDLE, "EventUnregister gave wrong error: %#x\n", uret);
+    ok(uret == ERROR_INVALID_HANDLE, "EventUnregister gave wrong error: %#x\n", uret);
 
     uret = pEventUnregister(reg_handle);
     ok(uret == ERROR_SUCCESS, "EventUnregister gave wrong error: %#x\n", uret);
@@ -1217,39 +1224,40 @@ static void test_start_trace(void)
 
     properties->Wnode.BufferSize = 0;
     ret = StartTraceA(&handle, sessionname, properties);
-    todo_wine
     ok(ret == ERROR_BAD_LENGTH ||
        ret == ERROR_INVALID_PARAMETER, /* XP and 2k3 */
        "Expected ERROR_BAD_LENGTH, got %d\n", ret);
     properties->Wnode.BufferSize = buffersize;
 
     ret = StartTraceA(&handle, "this name is too long", properties);
-    todo_wine
     ok(ret == ERROR_BAD_LENGTH, "Expected ERROR_BAD_LENGTH, got %d\n", ret);
 
     ret = StartTraceA(&handle, sessionname, NULL);
-    todo_wine
     ok(ret == ERROR_INVALID_PARAMETER, "Expected ERROR_INVALID_PARAMETER, got %d\n", ret);
 
     ret = StartTraceA(NULL, sessionname, properties);
-    todo_wine
     ok(ret == ERROR_INVALID_PARAMETER, "Expected ERROR_INVALID_PARAMETER, got %d\n", ret);
 
     properties->LogFileNameOffset = 1;
     ret = StartTraceA(&handle, sessionname, properties);
-    todo_wine
     ok(ret == ERROR_INVALID_PARAMETER, "Expected ERROR_INVALID_PARAMETER, got %d\n", ret);
     properties->LogFileNameOffset = sizeof(EVENT_TRACE_PROPERTIES) + sizeof(sessionname);
 
+    /* the log file name is not terminated within the buffer */
+    properties->Wnode.BufferSize = buffersize - 1;
+    ret = StartTraceA(&handle, sessionname, properties);
+    ok(ret == ERROR_BAD_LENGTH ||
+       ret == ERROR_INVALID_PARAMETER,
+       "Expected ERROR_BAD_LENGTH, got %d\n", ret);
+    properties->Wnode.BufferSize = buffersize;
+
     properties->LoggerNameOffset = 1;
     ret = StartTraceA(&handle, sessionname, properties);
-    todo_wine
     ok(ret == ERROR_INVALID_PARAMETER, "Expected ERROR_INVALID_PARAMETER, got %d\n", ret);
     properties->LoggerNameOffset = sizeof(EVENT_TRACE_PROPERTIES);
 
     properties->LogFileMode = EVENT_TRACE_FILE_MODE_SEQUENTIAL | EVENT_TRACE_FILE_MODE_CIRCULAR;
     ret = StartTraceA(&handle, sessionname, properties);
-    todo_wine
     ok(ret == ERROR_INVALID_PARAMETER, "Expected ERROR_INVALID_PARAMETER, got %d\n", ret);
     properties->LogFileMode = EVENT_TRACE_FILE_MODE_NONE;
     /* XP creates a file we can't delete, so change the filepath to something else */
@@ -1257,13 +1265,11 @@ static void test_start_trace(void)
 
     properties->Wnode.Guid = SystemTraceControlGuid;
     ret = StartTraceA(&handle, sessionname, properties);
-    todo_wine
     ok(ret == ERROR_INVALID_PARAMETER, "Expected ERROR_INVALID_PARAMETER, got %d\n", ret);
     memset(&properties->Wnode.Guid, 0, sizeof(properties->Wnode.Guid));
 
     properties->LogFileNameOffset = 0;
     ret = StartTraceA(&handle, sessionname, properties);
-    todo_wine
     ok(ret == ERROR_BAD_PATHNAME, "Expected ERROR_BAD_PATHNAME, got %d\n", ret);
     properties->LogFileNameOffset = sizeof(EVENT_TRACE_PROPERTIES) + sizeof(sessionname);
 
@@ -1276,7 +1282,6 @@ static void test_start_trace(void)
     ok(ret == ERROR_SUCCESS, "Expected success, got %d\n", ret);
 
     ret = StartTraceA(&handle, sessionname, properties);
-    todo_wine
     ok(ret == ERROR_ALREADY_EXISTS ||
        ret == ERROR_SHARING_VIOLATION, /* 2k3 */
        "Expected ERROR_ALREADY_EXISTS, got %d\n", ret);
@@ -1286,8 +1291,143 @@ static void test_start_trace(void)
 done:
     HeapFree(GetProcessHeap(), 0, properties);
     DeleteFileA(filepath);
+    DeleteFileA(filepath2);
+}
+
+static ULONG enable_callback_count;
+static ULONG enable_callback_control;
+static UCHAR enable_callback_level;
+
+static void WINAPI enable_callback(const GUID *guid, ULONG control, UCHAR level, ULONGLONG match_any,
+                                   ULONGLONG match_all, EVENT_FILTER_DESCRIPTOR *filter, void *context)
+{
+    ok(context == (void *)0xdeadbeef, "got context %p\n", context);
+    enable_callback_count++;
+    enable_callback_control = control;
+    enable_callback_level = level;
+}
+
+static void test_trace_session(void)
+{
+    static const GUID test_guid = {0x57696E65, 0x0000, 0x0000, {0x00,0x00, 0x00,0x00,0x00,0x00,0x00,0x02}};
+    static const char sessionname[] = "wine_session";
+    static const EVENT_DESCRIPTOR info_desc = { 1, 0, 0, TRACE_LEVEL_INFORMATION, 0, 0, 0 };
+    static const EVENT_DESCRIPTOR verbose_desc = { 2, 0, 0, TRACE_LEVEL_VERBOSE, 0, 0, 0 };
+    const ULONG count = winetest_interactive ? 100000 : 10000;
+    EVENT_TRACE_PROPERTIES *properties;
+    EVENT_DATA_DESCRIPTOR data;
+    LARGE_INTEGER freq, start, end;
+    char filepath[MAX_PATH];
+    REGHANDLE reg_handle;
+    TRACEHANDLE handle;
+    WIN32_FILE_ATTRIBUTE_DATA attr;
+    ULONG size, i, ret, value;
+    BOOL bret;
+
+    if (!pEventRegister || !pEventWrite || !pEventEnabled || !pEnableTraceEx2)
+    {
+        win_skip("EventWrite or EnableTraceEx2 is missing, skipping trace session tests\n");
+        return;
+    }
+
+    QueryPerformanceFrequency(&freq);
+    ret = pEventRegister(&test_guid, enable_callback, (void *)0xdeadbeef, &reg_handle);
+    ok(ret == ERROR_SUCCESS, "EventRegister failed: %u\n", ret);
+    ok(!enable_callback_count, "callback called %u times\n", enable_callback_count);
+    ok(!pEventEnabled(reg_handle, &info_desc), "event should be disabled\n");
+
+    /* nothing records the provider, writing should be almost free */
+    data.Ptr = (ULONG_PTR)&value;
+    data.Size = sizeof(value);
+    data.Reserved = 0;
+    QueryPerformanceCounter(&start);
+    for (i = 0; i < count; i++)
+    {
+        value = i;
+        pEventWrite(reg_handle, &info_desc, 1, &data);
+    }
+    QueryPerformanceCounter(&end);
+    if (winetest_interactive)
+        trace("disabled EventWrite: %.1f ns per event\n",
+              (double)(end.QuadPart - start.QuadPart) * 1e9 / freq.QuadPart / count);
+
+    GetTempPathA(MAX_PATH, filepath);
+    strcat(filepath, "wine_session.etl");
+    size = sizeof(*properties) + sizeof(sessionname) + MAX_PATH;
+    properties = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, size);
+    properties->Wnode.BufferSize = size;
+    properties->Wnode.Flags = WNODE_FLAG_TRACED_GUID;
+    properties->Wnode.ClientContext = 1;
+    properties->LogFileMode = EVENT_TRACE_FILE_MODE_SEQUENTIAL;
+    properties->LoggerNameOffset = sizeof(*properties);
+    properties->LogFileNameOffset = sizeof(*properties) + sizeof(sessionname);
+    strcpy((char *)properties + properties->LogFileNameOffset, filepath);
+
+    ret = StartTraceA(&handle, sessionname, properties);
+    if (ret == ERROR_ACCESS_DENIED)
+    {
+        skip("need admin rights\n");
+        goto done;
+    }
+    ok(ret == ERROR_SUCCESS, "StartTrace failed: %u\n", ret);
+    ok(!strcmp((char *)properties + properties->LoggerNameOffset, sessionname), "got name %s\n",
+       (char *)properties + properties->LoggerNameOffset);
+
+    ret = pEnableTraceEx2(handle, &test_guid, EVENT_CONTROL_CODE_ENABLE_PROVIDER, TRACE_LEVEL_INFORMATION,
+                          0, 0, 5000, NULL);
+    ok(ret == ERROR_SUCCESS, "EnableTraceEx2 failed: %u\n", ret);
+    ok(enable_callback_count == 1, "callback called %u times\n", enable_callback_count);
+    ok(enable_callback_control == EVENT_CONTROL_CODE_ENABLE_PROVIDER, "got control %u\n", enable_callback_control);
+    ok(enable_callback_level == TRACE_LEVEL_INFORMATION, "got level %u\n", enable_callback_level);
+    ok(pEventEnabled(reg_handle, &info_desc), "event should be enabled\n");
+    ok(!pEventEnabled(reg_handle, &verbose_desc), "verbose event should be disabled\n");
+
+    QueryPerformanceCounter(&start);
+    for (i = 0; i < count; i++)
+    {
+        value = i;
+        ret = pEventWrite(reg_handle, &info_desc, 1, &data);
+        if (ret) break;
+    }
+    QueryPerformanceCounter(&end);
+    ok(ret == ERROR_SUCCESS, "EventWrite failed: %u\n", ret);
+    if (winetest_interactive)
+        trace("recorded EventWrite: %.1f ns per event\n",
+              (double)(end.QuadPart - start.QuadPart) * 1e9 / freq.QuadPart / count);
+
+    ret = pEventWrite(reg_handle, &verbose_desc, 1, &data);
+    ok(ret == ERROR_SUCCESS, "EventWrite failed: %u\n", ret);
+    ret = pEventWriteString(reg_handle, TRACE_LEVEL_INFORMATION, 0, L"wine");
+    ok(ret == ERROR_SUCCESS, "EventWriteString failed: %u\n", ret);
+
+    ret = ControlTraceA(handle, sessionname, properties, EVENT_TRACE_CONTROL_QUERY);
+    ok(ret == ERROR_SUCCESS, "ControlTrace failed: %u\n", ret);
+    ok(properties->NumberOfBuffers > 0, "got %u buffers\n", properties->NumberOfBuffers);
+
+    ret = ControlTraceA(handle, sessionname, properties, EVENT_TRACE_CONTROL_STOP);
+    ok(ret == ERROR_SUCCESS, "ControlTrace failed: %u\n", ret);
+    ok(properties->BuffersWritten > 0, "no buffers written\n");
+    if (winetest_interactive)
+        trace("%u buffers written, %u events lost\n", properties->BuffersWritten, properties->EventsLost);
+    ok(enable_callback_count == 2, "callback called %u times\n", enable_callback_count);
+    ok(enable_callback_control == EVENT_CONTROL_CODE_DISABLE_PROVIDER, "got control %u\n", enable_callback_control);
+    ok(!pEventEnabled(reg_handle, &info_desc), "event should be disabled\n");
+
+    ret = ControlTraceA(handle, sessionname, properties, EVENT_TRACE_CONTROL_QUERY);
+    ok(ret == ERROR_WMI_INSTANCE_NOT_FOUND, "got %u\n", ret);
+
+    bret = GetFileAttributesExA(filepath, GetFileExInfoStandard, &attr);
+    ok(bret, "GetFileAttributesEx failed: %u\n", GetLastError());
+    ok(attr.nFileSizeLow > count * sizeof(value), "file too small: %u bytes\n", attr.nFileSizeLow);
+    DeleteFileA(filepath);
+
+done:
+    ret = pEventUnregister(reg_handle);
+    ok(ret == ERROR_SUCCESS, "EventUnregister failed: %u\n", ret);
+    HeapFree(GetProcessHeap(), 0, properties);
 }
 
+
 START_TEST(eventlog)
 {
     SetLastError(0xdeadbeef);
@@ -1321,4 +1461,5 @@ START_TEST(eventlog)
 
     /* Trace tests */
     test_start_trace();
+    test_trace_session();
 }
@@ -127,6 +127,7 @@ struct ZIPstate {
     cab_ULONG v[ZIPN_MAX];      /* values in order of bit length */
     cab_ULONG x[ZIPBMAX+1];     /* bit offsets, then code stack */
     cab_UBYTE *inpos;
+    int independent;            /* the previous block isn't available as history */
 };
   
 /* Quantum stuff */
@@ -161,6 +161,8 @@ typedef struct fdi_cds_fwd {
   struct fdi_folder *firstfol; 
   struct fdi_file   *firstfile;
   struct fdi_cds_fwd *next;
+  cab_UWORD blocks_left;           /* blocks not read yet in current folder */
+  struct fdi_prefetch *prefetch;   /* blocks being decoded ahead            */
 } fdi_decomp_state;
 
 #define ZIPNEEDBITS(n) {while(k<(n)){cab_LONG c=*(ZIP(inpos)++);\
@@ -183,6 +185,8 @@ typedef struct fdi_cds_fwd {
 #define DECR_INPUT        (5)
 #define DECR_OUTPUT       (6)
 #define DECR_USERABORT    (7)
+#define DECR_NEEDHISTORY  (8)
+#define DECR_NOTAVAIL     (9)
 
 static void set_error( FDI_Int *fdi, int oper, int err )
 {
@@ -1055,6 +1059,10 @@ struct Ziphuft **t, cab_LONG *m, fdi_decomp_state *decomp_state)
   return y != 0 && g != 1;
 }
 
+/* returned by the inflate functions when a match refers to the previous
+ * block, which isn't available to blocks decoded ahead */
+#define ZIP_NEEDHISTORY 4
+
 /*********************************************************
  * fdi_Zipinflate_codes (internal)
  */
@@ -1116,8 +1124,11 @@ static cab_LONG fdi_Zipinflate_codes(const struct Ziphuft *tl, const struct Ziph
         } while ((e = (t = t->v.t + (b & Zipmask[e]))->e) > 16);
       ZIPDUMPBITS(t->b)
       ZIPNEEDBITS(e)
-      d = w - t->v.n - (b & Zipmask[e]);
+      d = t->v.n + (b & Zipmask[e]);
       ZIPDUMPBITS(e)
+      if (d > w && ZIP(independent))
+        return ZIP_NEEDHISTORY;
+      d = w - d;
       do
       {
         d &= ZIPWSIZE - 1;
@@ -1353,13 +1364,12 @@ static cab_LONG fdi_Zipinflate_dynamic(fdi_decomp_state *decomp_state)
   fdi_Ziphuft_build(ll + nl, nd, 0, Zipcpdist, Zipcpdext, &td, &bd, decomp_state);
 
   /* decompress until an end-of-block code */
-  if(fdi_Zipinflate_codes(tl, td, bl, bd, decomp_state))
-    return 1;
+  i = fdi_Zipinflate_codes(tl, td, bl, bd, decomp_state);
 
   /* free the decoding tables, return */
   fdi_Ziphuft_free(CAB(fdi), tl);
   fdi_Ziphuft_free(CAB(fdi), td);
-  return 0;
+  return i;
 }
 
 /*****************************************************
@@ -1420,8 +1430,16 @@ static int ZIPfdi_decomp(int inlen, int outlen, fdi_decomp_state *decomp_state)
   ZIP(inpos) += 2;
 
   do {
-    if(fdi_Zipinflate_block(&e, decomp_state))
+    switch (fdi_Zipinflate_block(&e, decomp_state)) {
+    case 0:
+      break;
+    case 3:
+      return DECR_NOMEMORY;
+    case ZIP_NEEDHISTORY:
+      return DECR_NEEDHISTORY;
+    default:
       return DECR_ILLEGALDATA;
+    }
   } while(!e);
 
   /* return success */
@@ -1923,6 +1941,177 @@ static int LZXfdi_decomp(int inlen, int outlen, fdi_decomp_state *decomp_state)
   return DECR_OK;
 }
 
+/* MSZIP blocks are decoded ahead on the thread pool, without the previous
+ * block as history.  The few blocks that turn out to refer to the previous
+ * one are decoded again on the calling thread, in order. */
+#define FDI_PREFETCH_MAX 16
+
+struct fdi_block {
+  TP_WORK *work;
+  int err;
+  cab_UWORD inlen, outlen;
+  fdi_decomp_state state;
+};
+
+struct fdi_prefetch {
+  FDI_Int fdi;                     /* allocator for the worker threads      */
+  unsigned int size;               /* number of blocks                      */
+  unsigned int head;               /* next block to use                     */
+  unsigned int count;              /* blocks read ahead                     */
+  unsigned int fallbacks;          /* blocks decoded again in this folder   */
+  BOOL stop;                       /* don't read ahead in this folder       */
+  struct fdi_block blocks[1];
+};
+
+static void * CDECL fdi_prefetch_alloc(ULONG cb)
+{
+  return HeapAlloc(GetProcessHeap(), 0, cb);
+}
+
+static void CDECL fdi_prefetch_free(void *pv)
+{
+  HeapFree(GetProcessHeap(), 0, pv);
+}
+
+static void CALLBACK fdi_decode_block(TP_CALLBACK_INSTANCE *instance, void *context, TP_WORK *work)
+{
+  struct fdi_block *block = context;
+
+  block->err = ZIPfdi_decomp(block->inlen, block->outlen, &block->state);
+}
+
+static void fdi_prefetch_reset(struct fdi_prefetch *prefetch)
+{
+  unsigned int i;
+
+  if (!prefetch) return;
+  for (i = 0; i < prefetch->size; i++)
+    if (prefetch->blocks[i].work) WaitForThreadpoolWorkCallbacks(prefetch->blocks[i].work, TRUE);
+  prefetch->head = prefetch->count = prefetch->fallbacks = 0;
+  prefetch->stop = FALSE;
+}
+
+static void fdi_prefetch_destroy(FDI_Int *fdi, struct fdi_prefetch *prefetch)
+{
+  unsigned int i;
+
+  fdi_prefetch_reset(prefetch);
+  for (i = 0; i < prefetch->size; i++)
+    if (prefetch->blocks[i].work) CloseThreadpoolWork(prefetch->blocks[i].work);
+  fdi->free(prefetch);
+}
+
+static struct fdi_prefetch *fdi_prefetch_create(fdi_decomp_state *decomp_state)
+{
+  struct fdi_prefetch *prefetch;
+  unsigned int i, size;
+  SYSTEM_INFO si;
+
+  GetSystemInfo(&si);
+  if (si.dwNumberOfProcessors < 2) return NULL;
+  size = min(si.dwNumberOfProcessors * 2, FDI_PREFETCH_MAX);
+
+  if (!(prefetch = CAB(fdi)->alloc(FIELD_OFFSET(struct fdi_prefetch, blocks[size]))))
+    return NULL;
+  ZeroMemory(prefetch, FIELD_OFFSET(struct fdi_prefetch, blocks[size]));
+  prefetch->fdi.alloc = fdi_prefetch_alloc;
+  prefetch->fdi.free = fdi_prefetch_free;
+  prefetch->size = size;
+
+  for (i = 0; i < size; i++) {
+    struct fdi_block *block = &prefetch->blocks[i];
+
+    block->state.fdi = &prefetch->fdi;
+    block->state.methods.zip.independent = 1;
+    if (!(block->work = CreateThreadpoolWork(fdi_decode_block, block, NULL))) {
+      fdi_prefetch_destroy(CAB(fdi), prefetch);
+      return NULL;
+    }
+  }
+  return prefetch;
+}
+
+/* Read ahead the blocks of the current folder, except for the last one
+ * which may continue in the next cabinet.  Read errors are reported when
+ * the failed block is used. */
+static void fdi_prefetch_fill(fdi_decomp_state *decomp_state)
+{
+  struct fdi_prefetch *prefetch = CAB(prefetch);
+  cab_UBYTE buf[cfdata_SIZEOF], *data;
+  struct fdi_block *block;
+  cab_ULONG cksum;
+
+  while (!prefetch->stop && prefetch->count < prefetch->size && CAB(blocks_left) > 1) {
+    block = &prefetch->blocks[(prefetch->head + prefetch->count++) % prefetch->size];
+    CAB(blocks_left)--;
+
+    block->err = DECR_INPUT;
+    data = block->state.inbuf;
+    if (CAB(fdi)->read(CAB(cabhf), buf, cfdata_SIZEOF) != cfdata_SIZEOF ||
+        CAB(fdi)->seek(CAB(cabhf), CAB(mii).block_resv, SEEK_CUR) == -1)
+      break;
+    block->inlen = EndGetI16(buf+cfdata_CompressedSize);
+    block->outlen = EndGetI16(buf+cfdata_UncompressedSize);
+    if (block->inlen > CAB_INPUTMAX ||
+        CAB(fdi)->read(CAB(cabhf), data, block->inlen) != block->inlen)
+      break;
+
+    /* clear two bytes after read-in data */
+    data[block->inlen+1] = data[block->inlen+2] = 0;
+
+    cksum = EndGetI32(buf+cfdata_CheckSum);
+    if (cksum && cksum != checksum(buf+4, 4, checksum(data, block->inlen, 0))) {
+      block->err = DECR_CHECKSUM;
+      break;
+    }
+    /* only the last block of a folder can be split */
+    if (!block->outlen) {
+      block->err = DECR_ILLEGALDATA;
+      break;
+    }
+
+    SubmitThreadpoolWork(block->work);
+  }
+  if (CAB(blocks_left) > 1 && prefetch->count < prefetch->size) prefetch->stop = TRUE;
+}
+
+/* Fill the output buffer with the next block of the folder, returns
+ * DECR_NOTAVAIL if it has to be read by the caller. */
+static int fdi_prefetch_next(fdi_decomp_state *decomp_state)
+{
+  struct fdi_prefetch *prefetch = CAB(prefetch);
+  struct fdi_block *block;
+  int err;
+
+  if (!prefetch || CAB(decompress) != ZIPfdi_decomp) return DECR_NOTAVAIL;
+
+  fdi_prefetch_fill(decomp_state);
+  if (!prefetch->count) return DECR_NOTAVAIL;
+
+  block = &prefetch->blocks[prefetch->head];
+  prefetch->head = (prefetch->head + 1) % prefetch->size;
+  prefetch->count--;
+  WaitForThreadpoolWorkCallbacks(block->work, FALSE);
+
+  if ((err = block->err) == DECR_NEEDHISTORY) {
+    /* decode it again, the output buffer holds the previous block */
+    memcpy(CAB(inbuf), block->state.inbuf, block->inlen);
+    CAB(inbuf)[block->inlen+1] = CAB(inbuf)[block->inlen+2] = 0;
+    err = ZIPfdi_decomp(block->inlen, block->outlen, decomp_state);
+
+    /* don't waste time decoding ahead if most blocks depend on each other */
+    if (++prefetch->fallbacks > prefetch->size) prefetch->stop = TRUE;
+  }
+  else if (err == DECR_OK)
+    memcpy(CAB(outbuf), block->state.outbuf, block->outlen);
+  if (err) return err;
+
+  CAB(outlen) = block->outlen;
+  CAB(outpos) = CAB(outbuf);
+  fdi_prefetch_fill(decomp_state);
+  return DECR_OK;
+}
+
 /**********************************************************
  * fdi_decomp (internal)
  *
@@ -1962,12 +2151,19 @@ static int fdi_decomp(const struct fdi_file *fi, int savemode, fdi_decomp_state
 
     /* we only get here if we emptied the output buffer */
 
+    /* use the blocks decoded ahead, as long as we're in the folder's first cabinet */
+    if (cab == decomp_state && (!CAB(decomp_cab) || CAB(decomp_cab) == decomp_state)) {
+      if ((err = fdi_prefetch_next(decomp_state)) == DECR_OK) continue;
+      if (err != DECR_NOTAVAIL) return err;
+    }
+
     /* read data header + data */
     inlen = outlen = 0;
     while (outlen == 0) {
       /* read the block header, skip the reserved part */
       if (CAB(fdi)->read(cab->cabhf, buf, cfdata_SIZEOF) != cfdata_SIZEOF)
         return DECR_INPUT;
+      if (cab == decomp_state && CAB(blocks_left)) CAB(blocks_left)--;
 
       if (CAB(fdi)->seek(cab->cabhf, cab->mii.block_resv, SEEK_CUR) == -1)
         return DECR_INPUT;
@@ -2228,6 +2424,8 @@ static void free_decompression_mem(FDI_Int *fdi, fdi_decomp_state *decomp_state)
 
     fdi->close(CAB(cabhf));
 
+    if (CAB(prefetch)) fdi_prefetch_destroy(fdi, CAB(prefetch));
+
     /* free the storage remembered by mii */
     if (CAB(mii).nextname) fdi->free(CAB(mii).nextname);
     if (CAB(mii).nextinfo) fdi->free(CAB(mii).nextinfo);
@@ -2696,10 +2894,12 @@ BOOL __cdecl FDICopy(
           break;
         }
 
+        fdi_prefetch_reset(CAB(prefetch));
         CAB(decomp_cab) = NULL;
         CAB(fdi)->seek(CAB(cabhf), fol->offset, SEEK_SET);
         CAB(offset) = 0;
         CAB(outlen) = 0;
+        CAB(blocks_left) = fol->num_blocks;
 
         /* initialize the new decompressor */
         switch (ct1) {
@@ -2708,6 +2908,8 @@ BOOL __cdecl FDICopy(
           break;
         case cffoldCOMPTYPE_MSZIP:
           CAB(decompress) = ZIPfdi_decomp;
+          if (!CAB(prefetch) && fol->num_blocks > 2)
+            CAB(prefetch) = fdi_prefetch_create(decomp_state);
           break;
         case cffoldCOMPTYPE_QUANTUM:
           CAB(decompress) = QTMfdi_decomp;
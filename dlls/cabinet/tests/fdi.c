@@ -941,6 +941,343 @@ static void test_FDICopy(void)
     FDIDestroy(hfdi);
 }
 
+#define PERF_FILES      8
+#define PERF_FILE_SIZE  (128 * 1024)
+
+static void fill_perf_data(char *data, DWORD size, DWORD seed)
+{
+    static const char *words[] = { "cabinet ", "folder ", "block ", "deflate ",
+                                   "window ", "huffman ", "literal ", "length\r\n" };
+    DWORD i = 0;
+
+    while (i < size)
+    {
+        const char *word;
+
+        seed = seed * 1103515245 + 12345;
+        word = words[(seed >> 16) & 7];
+        while (*word && i < size) data[i++] = *word++;
+        if (((seed >> 20) & 3) == 0 && i < size) data[i++] = seed >> 24;
+    }
+}
+
+static void create_perf_file(const char *name, DWORD seed, char *buffer)
+{
+    HANDLE file;
+    DWORD written;
+
+    fill_perf_data(buffer, PERF_FILE_SIZE, seed);
+    file = CreateFileA(name, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, 0, NULL);
+    ok(file != INVALID_HANDLE_VALUE, "Failure to open file %s\n", name);
+    WriteFile(file, buffer, PERF_FILE_SIZE, &written, NULL);
+    CloseHandle(file);
+}
+
+static BOOL check_perf_file(const char *name, DWORD seed, char *expected, char *buffer)
+{
+    HANDLE file;
+    DWORD size, read = 0;
+
+    file = CreateFileA(name, GENERIC_READ, 0, NULL, OPEN_EXISTING, 0, NULL);
+    if (file == INVALID_HANDLE_VALUE) return FALSE;
+    size = GetFileSize(file, NULL);
+    if (size == PERF_FILE_SIZE) ReadFile(file, buffer, PERF_FILE_SIZE, &read, NULL);
+    CloseHandle(file);
+
+    fill_perf_data(expected, PERF_FILE_SIZE, seed);
+    return read == PERF_FILE_SIZE && !memcmp(buffer, expected, PERF_FILE_SIZE);
+}
+
+static INT_PTR CDECL perf_notify(FDINOTIFICATIONTYPE fdint, FDINOTIFICATION *info)
+{
+    const BOOL *skip_odd = info->pv;
+    char path[MAX_PATH];
+    HANDLE file;
+
+    switch (fdint)
+    {
+    case fdintCOPY_FILE:
+        ok(info->cb == PERF_FILE_SIZE, "expected %u, got %d\n", PERF_FILE_SIZE, info->cb);
+        if (*skip_odd && (info->psz1[4] - '0') % 2) return 0;
+        sprintf(path, "perfout\\%s", info->psz1);
+        file = CreateFileA(path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, 0, NULL);
+        ok(file != INVALID_HANDLE_VALUE, "Failure to create file %s\n", path);
+        return (INT_PTR)file;
+
+    case fdintCLOSE_FILE_INFO:
+        CloseHandle((HANDLE)info->hf);
+        return 1;
+
+    default:
+        return 0;
+    }
+}
+
+static void test_FDICopy_many_blocks(void)
+{
+    LARGE_INTEGER freq, start, end;
+    char name[16], path[MAX_PATH + 1];
+    char cab_name[] = "perf.cab";
+    char *buffer, *expected;
+    CCAB cabParams;
+    HFDI hfdi;
+    HFCI hfci;
+    ERF erf;
+    BOOL ret, skip_odd;
+    DWORD i;
+
+    buffer = HeapAlloc(GetProcessHeap(), 0, PERF_FILE_SIZE);
+    expected = HeapAlloc(GetProcessHeap(), 0, PERF_FILE_SIZE);
+
+    for (i = 0; i < PERF_FILES; i++)
+    {
+        sprintf(name, "perf%u.dat", i);
+        create_perf_file(name, i + 1, buffer);
+    }
+
+    set_cab_parameters(&cabParams);
+    lstrcpyA(cabParams.szCab, cab_name);
+    hfci = FCICreate(&erf, file_placed, mem_alloc, mem_free, fci_open,
+                     fci_read, fci_write, fci_close, fci_seek,
+                     fci_delete, get_temp_file, &cabParams, NULL);
+    ok(hfci != NULL, "Failed to create an FCI context\n");
+    for (i = 0; i < PERF_FILES; i++)
+    {
+        sprintf(name, "perf%u.dat", i);
+        add_file(hfci, name);
+    }
+    ret = FCIFlushCabinet(hfci, FALSE, get_next_cabinet, progress);
+    ok(ret, "Failed to flush the cabinet\n");
+    FCIDestroy(hfci);
+
+    for (i = 0; i < PERF_FILES; i++)
+    {
+        sprintf(name, "perf%u.dat", i);
+        DeleteFileA(name);
+    }
+
+    CreateDirectoryA("perfout", NULL);
+    lstrcpyA(path, CURR_DIR);
+    lstrcatA(path, "\\");
+    QueryPerformanceFrequency(&freq);
+
+    /* extract everything, then only every other file, which makes FDI skip
+     * over the data of the files in between */
+    for (skip_odd = FALSE; skip_odd <= TRUE; skip_odd++)
+    {
+        hfdi = FDICreate(fdi_alloc, fdi_free, fdi_open, fdi_read,
+                         fdi_write, fdi_close, fdi_seek, cpuUNKNOWN, &erf);
+        ok(hfdi != NULL, "FDICreate error %d\n", erf.erfOper);
+
+        QueryPerformanceCounter(&start);
+        ret = FDICopy(hfdi, cab_name, path, 0, perf_notify, NULL, &skip_odd);
+        QueryPerformanceCounter(&end);
+        ok(ret, "FDICopy error %d\n", erf.erfOper);
+        FDIDestroy(hfdi);
+
+        if (winetest_interactive)
+            trace("extracted %u x %u bytes%s in %.1f ms\n", PERF_FILES, PERF_FILE_SIZE,
+                  skip_odd ? " (skipping odd files)" : "",
+                  (end.QuadPart - start.QuadPart) * 1000.0 / freq.QuadPart);
+
+        for (i = 0; i < PERF_FILES; i++)
+        {
+            sprintf(name, "perfout\\perf%u.dat", i);
+            if (!skip_odd || !(i % 2))
+                ok(check_perf_file(name, i + 1, expected, buffer), "wrong contents in %s\n", name);
+            else
+                ok(GetFileAttributesA(name) == INVALID_FILE_ATTRIBUTES, "%s shouldn't be extracted\n", name);
+            DeleteFileA(name);
+        }
+    }
+
+    RemoveDirectoryA("perfout");
+    DeleteFileA(cab_name);
+    HeapFree(GetProcessHeap(), 0, expected);
+    HeapFree(GetProcessHeap(), 0, buffer);
+}
+
+/* MSZIP keeps the deflate window across the blocks of a folder, which FCI
+ * never takes advantage of, so build a cabinet whose blocks copy data from
+ * the previous one by hand. */
+#define HISTORY_BLOCKS  40
+#define HISTORY_TAIL    100
+
+struct bit_writer
+{
+    BYTE *ptr;
+    UINT bits, count;
+};
+
+static void put_bits(struct bit_writer *writer, UINT value, UINT count)
+{
+    writer->bits |= value << writer->count;
+    writer->count += count;
+    while (writer->count >= 8)
+    {
+        *writer->ptr++ = writer->bits;
+        writer->bits >>= 8;
+        writer->count -= 8;
+    }
+}
+
+/* huffman codes are stored starting with their most significant bit */
+static void put_code(struct bit_writer *writer, UINT code, UINT len)
+{
+    while (len--) put_bits(writer, (code >> len) & 1, 1);
+}
+
+static void put_match(struct bit_writer *writer, UINT len)
+{
+    /* fixed codes for the length symbols 257, 284 and 285 */
+    if (len == 3) put_code(writer, 0x01, 7);
+    else if (len == 258) put_code(writer, 0xc5, 8);
+    else
+    {
+        put_code(writer, 0xc4, 8);
+        put_bits(writer, len - 227, 5);
+    }
+    /* distance symbol 29, the whole window back */
+    put_code(writer, 29, 5);
+    put_bits(writer, 32768 - 24577, 13);
+}
+
+static DWORD build_history_cab(BYTE *cab, const BYTE *data)
+{
+    struct CFHEADER *header = (struct CFHEADER *)cab;
+    struct CFFOLDER *folder = (struct CFFOLDER *)(header + 1);
+    struct CFFILE *file = (struct CFFILE *)(folder + 1);
+    char *name = (char *)(file + 1);
+    struct CFDATA *block;
+    struct bit_writer writer;
+    BYTE *ptr;
+    UINT i, len;
+
+    memset(cab, 0, sizeof(*header) + sizeof(*folder) + sizeof(*file));
+    memcpy(header->signature, "MSCF", 4);
+    header->coffFiles = sizeof(*header) + sizeof(*folder);
+    header->versionMinor = 3;
+    header->versionMajor = 1;
+    header->cFolders = 1;
+    header->cFiles = 1;
+    folder->cCFData = HISTORY_BLOCKS;
+    folder->typeCompress = tcompTYPE_MSZIP;
+    file->cbFile = (HISTORY_BLOCKS - 1) * 32768 + HISTORY_TAIL;
+    file->attribs = FILE_ATTRIBUTE_ARCHIVE;
+    strcpy(name, "history.dat");
+    ptr = (BYTE *)name + sizeof("history.dat");
+    folder->coffCabStart = ptr - cab;
+
+    for (i = 0; i < HISTORY_BLOCKS; i++)
+    {
+        block = (struct CFDATA *)ptr;
+        ptr = (BYTE *)(block + 1);
+        *ptr++ = 'C';
+        *ptr++ = 'K';
+        block->csum = 0;
+        block->cbUncomp = i < HISTORY_BLOCKS - 1 ? 32768 : HISTORY_TAIL;
+
+        if (!i || i == HISTORY_BLOCKS - 1)
+        {
+            /* a stored deflate block, followed by an empty final one */
+            *ptr++ = i ? 1 : 0;
+            *ptr++ = block->cbUncomp;
+            *ptr++ = block->cbUncomp >> 8;
+            *ptr++ = ~block->cbUncomp;
+            *ptr++ = ~block->cbUncomp >> 8;
+            memcpy(ptr, data, block->cbUncomp);
+            ptr += block->cbUncomp;
+            if (!i)
+            {
+                *ptr++ = 0x03;
+                *ptr++ = 0x00;
+            }
+        }
+        else
+        {
+            /* a fixed huffman block copying the previous block */
+            writer.ptr = ptr;
+            writer.bits = writer.count = 0;
+            put_bits(&writer, 1, 1);
+            put_bits(&writer, 1, 2);
+            for (len = 32768; len > 260; len -= 258) put_match(&writer, 258);
+            put_match(&writer, len - 3);
+            put_match(&writer, 3);
+            put_code(&writer, 0, 7);
+            put_bits(&writer, 0, 7);
+            ptr = writer.ptr;
+        }
+        block->cbData = ptr - (BYTE *)(block + 1);
+    }
+
+    header->cbCabinet = ptr - cab;
+    return header->cbCabinet;
+}
+
+static INT_PTR CDECL history_notify(FDINOTIFICATIONTYPE fdint, FDINOTIFICATION *info)
+{
+    switch (fdint)
+    {
+    case fdintCOPY_FILE:
+        ok(!strcmp(info->psz1, "history.dat"), "got %s\n", info->psz1);
+        return (INT_PTR)CreateFileA("history.out", GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, 0, NULL);
+
+    case fdintCLOSE_FILE_INFO:
+        CloseHandle((HANDLE)info->hf);
+        return 1;
+
+    default:
+        return 0;
+    }
+}
+
+static void test_FDICopy_history(void)
+{
+    DWORD i, size, read, file_size = (HISTORY_BLOCKS - 1) * 32768 + HISTORY_TAIL;
+    char cab_name[] = "history.cab";
+    char path[MAX_PATH + 1];
+    BYTE *cab, *data, *out;
+    HANDLE file;
+    HFDI hfdi;
+    ERF erf;
+    BOOL ret;
+
+    data = HeapAlloc(GetProcessHeap(), 0, 32768);
+    cab = HeapAlloc(GetProcessHeap(), 0, HISTORY_BLOCKS * (sizeof(struct CFDATA) + 32768 + 16) + 1024);
+    out = HeapAlloc(GetProcessHeap(), 0, file_size);
+
+    fill_perf_data((char *)data, 32768, 42);
+    size = build_history_cab(cab, data);
+    file = CreateFileA(cab_name, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, 0, NULL);
+    ok(file != INVALID_HANDLE_VALUE, "Failure to create %s\n", cab_name);
+    WriteFile(file, cab, size, &read, NULL);
+    CloseHandle(file);
+
+    lstrcpyA(path, CURR_DIR);
+    lstrcatA(path, "\\");
+    hfdi = FDICreate(fdi_alloc, fdi_free, fdi_open, fdi_read,
+                     fdi_write, fdi_close, fdi_seek, cpuUNKNOWN, &erf);
+    ok(hfdi != NULL, "FDICreate error %d\n", erf.erfOper);
+    ret = FDICopy(hfdi, cab_name, path, 0, history_notify, NULL, NULL);
+    ok(ret, "FDICopy error %d\n", erf.erfOper);
+    FDIDestroy(hfdi);
+
+    read = 0;
+    file = CreateFileA("history.out", GENERIC_READ, 0, NULL, OPEN_EXISTING, 0, NULL);
+    ok(file != INVALID_HANDLE_VALUE, "Failure to open history.out\n");
+    ok(GetFileSize(file, NULL) == file_size, "got size %u\n", GetFileSize(file, NULL));
+    ReadFile(file, out, file_size, &read, NULL);
+    CloseHandle(file);
+    for (i = 0; i + 32768 <= read; i += 32768)
+        ok(!memcmp(out + i, data, 32768), "wrong contents at %#x\n", i);
+    ok(i == read - HISTORY_TAIL && !memcmp(out + i, data, HISTORY_TAIL), "wrong contents at %#x\n", i);
+
+    DeleteFileA("history.out");
+    DeleteFileA(cab_name);
+    HeapFree(GetProcessHeap(), 0, out);
+    HeapFree(GetProcessHeap(), 0, cab);
+    HeapFree(GetProcessHeap(), 0, data);
+}
 
 START_TEST(fdi)
 {
@@ -948,4 +1285,6 @@ START_TEST(fdi)
     test_FDIDestroy();
     test_FDIIsCabinet();
     test_FDICopy();
+    test_FDICopy_many_blocks();
+    test_FDICopy_history();
 }
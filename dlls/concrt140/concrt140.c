@@ -37,6 +37,10 @@ extern const vtable_ptr exception_vtable;
 int CDECL _callnewh(size_t size);
 void (__cdecl *_Xmem)(void);
 void (__cdecl *_Xout_of_range)(const char*);
+static void (__cdecl *p__ExceptionPtrCreate)(exception_ptr*);
+static void (__cdecl *p__ExceptionPtrDestroy)(exception_ptr*);
+static void (__cdecl *p__ExceptionPtrRethrow)(const exception_ptr*);
+static void (__cdecl *p__ExceptionPtrCopyException)(exception_ptr*, void*, const void*);
 
 void* __cdecl operator_new(size_t size)
 {
@@ -64,6 +68,29 @@ void __cdecl operator_delete(void *mem)
     free(mem);
 }
 
+/* exception_ptr objects are created and rethrown by msvcp140 */
+void __cdecl __ExceptionPtrCreate(exception_ptr *ep)
+{
+    p__ExceptionPtrCreate(ep);
+}
+
+void __cdecl __ExceptionPtrDestroy(exception_ptr *ep)
+{
+    p__ExceptionPtrDestroy(ep);
+}
+
+void __cdecl __ExceptionPtrRethrow(const exception_ptr *ep)
+{
+    p__ExceptionPtrRethrow(ep);
+}
+
+/* only used for C++ exceptions */
+void exception_ptr_from_record(exception_ptr *ep, EXCEPTION_RECORD *rec)
+{
+    p__ExceptionPtrCopyException(ep, (void*)rec->ExceptionInformation[1],
+            (const void*)rec->ExceptionInformation[2]);
+}
+
 typedef exception runtime_error;
 extern const vtable_ptr runtime_error_vtable;
 
@@ -117,7 +144,16 @@ static BOOL init_cxx_funcs(void)
     _Xmem = (void*)GetProcAddress(msvcp140, "?_Xbad_alloc@std@@YAXXZ");
     _Xout_of_range = (void*)GetProcAddress(msvcp140, sizeof(void*) > sizeof(int) ?
             "?_Xout_of_range@std@@YAXPEBD@Z" : "?_Xout_of_range@std@@YAXPBD@Z");
-    if (!_Xmem || !_Xout_of_range)
+    p__ExceptionPtrCreate = (void*)GetProcAddress(msvcp140, sizeof(void*) > sizeof(int) ?
+            "?__ExceptionPtrCreate@@YAXPEAX@Z" : "?__ExceptionPtrCreate@@YAXPAX@Z");
+    p__ExceptionPtrDestroy = (void*)GetProcAddress(msvcp140, sizeof(void*) > sizeof(int) ?
+            "?__ExceptionPtrDestroy@@YAXPEAX@Z" : "?__ExceptionPtrDestroy@@YAXPAX@Z");
+    p__ExceptionPtrRethrow = (void*)GetProcAddress(msvcp140, sizeof(void*) > sizeof(int) ?
+            "?__ExceptionPtrRethrow@@YAXPEBX@Z" : "?__ExceptionPtrRethrow@@YAXPBX@Z");
+    p__ExceptionPtrCopyException = (void*)GetProcAddress(msvcp140, sizeof(void*) > sizeof(int) ?
+            "?__ExceptionPtrCopyException@@YAXPEAXPEBX1@Z" : "?__ExceptionPtrCopyException@@YAXPAXPBX1@Z");
+    if (!_Xmem || !_Xout_of_range || !p__ExceptionPtrCreate || !p__ExceptionPtrDestroy
+            || !p__ExceptionPtrRethrow || !p__ExceptionPtrCopyException)
     {
         FreeLibrary(msvcp140);
         return FALSE;
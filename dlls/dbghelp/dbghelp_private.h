@@ -420,6 +420,9 @@ struct module_format
                                                const struct module_format* modfmt,
                                                const struct symt_function* func,
                                                struct location* loc);
+    /* loads the debug information the format defers (if any) that is needed to
+     * look up addr or name, or all of it when neither is given */
+    void                        (*request)(struct module_format* modfmt, DWORD64 addr, const char* name);
     union
     {
         struct elf_module_info*         elf_info;
@@ -430,6 +433,19 @@ struct module_format
     } u;
 };
 
+/* a symbol of the image's symbol table, whose address is covered by debug
+ * information not loaded yet */
+struct deferred_symbol
+{
+    const char*                 name;
+    struct symt_compiland*      compiland;
+    ULONG_PTR                   addr;
+    ULONG_PTR                   size;
+    BOOL                        is_code;
+    BOOL                        is_static;
+    BOOL                        added;
+};
+
 struct module
 {
     struct process*             process;
@@ -455,8 +471,12 @@ struct module
     unsigned                    num_symbols;
     unsigned                    sorttab_size;
     struct symt_ht**            addr_sorttab;
+    unsigned                    sorttab_hint;   /* index of the latest symt_find_nearest() result */
+    struct symt_addr_cache*     addr_cache;     /* latest symt_find_nearest() results */
     struct hash_table           ht_symbols;
     struct symt_module*         top;
+    struct vector               vdeferred_symt; /* struct deferred_symbol */
+    unsigned                    num_deferred_symt; /* number of the ones not added yet */
 
     /* types */
     struct hash_table           ht_types;
@@ -719,6 +739,9 @@ extern struct module*
                     module_is_already_loaded(const struct process* pcs,
                                              const WCHAR* imgname) DECLSPEC_HIDDEN;
 extern BOOL         module_get_debug(struct module_pair*) DECLSPEC_HIDDEN;
+extern void         module_request_address(struct module* module, DWORD64 addr) DECLSPEC_HIDDEN;
+extern void         module_request_name(struct module* module, const char* name) DECLSPEC_HIDDEN;
+extern void         module_request_all(struct module* module) DECLSPEC_HIDDEN;
 extern struct module*
                     module_new(struct process* pcs, const WCHAR* name,
                                enum module_type type, BOOL virtual,
@@ -790,6 +813,8 @@ struct image_file_map;
 extern BOOL         dwarf2_parse(struct module* module, ULONG_PTR load_offset,
                                  const struct elf_thunk_area* thunks,
                                  struct image_file_map* fmap) DECLSPEC_HIDDEN;
+extern BOOL         dwarf2_is_unit_pending(struct module* module, DWORD64 addr) DECLSPEC_HIDDEN;
+extern BOOL         dwarf2_defer_data_symbol(struct module* module, const char* name, DWORD64 addr, DWORD64 size) DECLSPEC_HIDDEN;
 extern BOOL dwarf2_virtual_unwind(struct cpu_stack_walk *csw, DWORD_PTR ip,
     union ctx *ctx, DWORD64 *cfa) DECLSPEC_HIDDEN;
 
@@ -832,6 +857,12 @@ extern struct symt_function*
                                       const char* name,
                                       ULONG_PTR addr, ULONG_PTR size,
                                       struct symt* type) DECLSPEC_HIDDEN;
+extern void         symt_defer_symbol(struct module* module,
+                                      struct symt_compiland* compiland,
+                                      const char* name, ULONG_PTR addr,
+                                      ULONG_PTR size, BOOL is_code,
+                                      BOOL is_static) DECLSPEC_HIDDEN;
+extern void         symt_add_deferred_symbols(struct module* module) DECLSPEC_HIDDEN;
 extern struct symt_inlinesite*
                     symt_new_inlinesite(struct module* module,
                                         struct symt_function* func,
@@ -28,6 +28,7 @@
 #include <stdio.h>
 #include <assert.h>
 #include <stdarg.h>
+#include <ctype.h>
 #include <zlib.h>
 
 #include "windef.h"
@@ -184,6 +185,7 @@ typedef struct dwarf2_parse_module_context_s
     struct vector               unit_contexts;
     struct dwarf2_dwz_alternate_s* dwz;
     DWORD                       cu_versions;
+    unsigned                    num_loaded; /* number of units loaded so far */
 } dwarf2_parse_module_context_t;
 
 typedef struct dwarf2_dwz_alternate_s
@@ -221,6 +223,18 @@ typedef struct dwarf2_parse_context_s
     dwarf2_traverse_context_t   traverse_DIE;
 } dwarf2_parse_context_t;
 
+/* address range covered by a compilation unit */
+struct dwarf2_unit_range
+{
+    ULONG_PTR                   low;
+    ULONG_PTR                   high;
+    ULONG_PTR                   max_high; /* highest 'high' of this range and the ones sorted before */
+    dwarf2_parse_context_t*     unit;     /* NULL when it could be any of the units */
+};
+
+/* kind of a symbol in the unit lists of the .gdb_index symbol table */
+#define GDB_INDEX_SYMBOL_KIND_VARIABLE 2
+
 /* stored in the dbghelp's module internal structure for later reuse */
 struct dwarf2_module_info_s
 {
@@ -230,6 +244,24 @@ struct dwarf2_module_info_s
     dwarf2_section_t            debug_frame;
     dwarf2_section_t            eh_frame;
     unsigned char               word_size;
+    /* compilation units are only loaded when they're first needed */
+    BOOL                        all_loaded;
+    dwarf2_section_t            sections[section_max];
+    dwarf2_parse_module_context_t module_ctx;
+    struct dwarf2_unit_range*   unit_ranges; /* sorted by low address */
+    unsigned                    num_unit_ranges;
+    /* global variables of the image's symbol table defined in units not loaded yet */
+    struct dwarf2_unit_range*   data_ranges;
+    unsigned                    num_data_ranges;
+    unsigned                    alloc_data_ranges;
+    BOOL                        data_ranges_sorted;
+    dwarf2_section_t            gdb_index;
+    const unsigned char*        gdb_cu_list;
+    unsigned                    gdb_num_cus;
+    const unsigned char*        gdb_symtab;
+    unsigned                    gdb_symtab_size; /* number of slots, a power of 2 */
+    const unsigned char*        gdb_pool;
+    unsigned                    gdb_pool_size;
 };
 
 #define loc_dwarf2_location_list        (loc_user + 0)
@@ -2761,16 +2793,34 @@ unsigned dwarf2_cache_cuhead(struct dwarf2_module_info_s* module, struct symt_co
     return TRUE;
 }
 
+/* returns the index of the unit containing the given offset in .debug_info
+ * (units are stored in the order they appear in the section)
+ */
+static unsigned dwarf2_find_unit(const dwarf2_parse_module_context_t* module_ctx, ULONG_PTR ref)
+{
+    const BYTE* where = module_ctx->sections[section_debug].address + ref;
+    const dwarf2_parse_context_t* ctx;
+    unsigned low = 0, high = module_ctx->unit_contexts.num_elts, mid;
+
+    while (low < high)
+    {
+        mid = (low + high) / 2;
+        ctx = vector_at(&module_ctx->unit_contexts, mid);
+        if (where < ctx->traverse_DIE.end_data) high = mid;
+        else low = mid + 1;
+    }
+    return low;
+}
+
 static dwarf2_parse_context_t* dwarf2_locate_cu(dwarf2_parse_module_context_t* module_ctx, ULONG_PTR ref)
 {
-    unsigned i;
+    unsigned idx = dwarf2_find_unit(module_ctx, ref);
     dwarf2_parse_context_t* ctx;
-    const BYTE* where;
-    for (i = 0; i < module_ctx->unit_contexts.num_elts; ++i)
+
+    if (idx < module_ctx->unit_contexts.num_elts)
     {
-        ctx = vector_at(&module_ctx->unit_contexts, i);
-        where = module_ctx->sections[ctx->section].address + ref;
-        if (where >= ctx->traverse_DIE.data && where < ctx->traverse_DIE.end_data)
+        ctx = vector_at(&module_ctx->unit_contexts, idx);
+        if (module_ctx->sections[section_debug].address + ref >= ctx->traverse_DIE.data)
             return ctx;
     }
     FIXME("Couldn't find ref 0x%lx inside sect\n", ref);
@@ -2890,6 +2940,7 @@ static BOOL dwarf2_parse_compilation_unit(dwarf2_parse_context_t* ctx)
                     ctx->module_ctx->module->module.LineNumbers = TRUE;
             }
             ctx->status = UNIT_LOADED;
+            ctx->module_ctx->num_loaded++;
             ret = TRUE;
         }
         else FIXME("Should have a compilation unit here %lu\n", di->abbrev->tag);
@@ -3985,20 +4036,490 @@ static inline void dwarf2_fini_section(dwarf2_section_t* section)
         HeapFree(GetProcessHeap(), 0, (void*)section->address);
 }
 
+static BOOL dwarf2_unload_CU_module(dwarf2_parse_module_context_t* module_ctx);
+
+/* releases the state kept for loading the compilation units */
+static void dwarf2_release_units(struct dwarf2_module_info_s* info)
+{
+    unsigned i;
+
+    dwarf2_unload_CU_module(&info->module_ctx);
+    for (i = 0; i < section_max; i++)
+        dwarf2_fini_section(&info->sections[i]);
+    dwarf2_fini_section(&info->gdb_index);
+    free(info->unit_ranges);
+    info->unit_ranges = NULL;
+    info->num_unit_ranges = 0;
+    free(info->data_ranges);
+    info->data_ranges = NULL;
+    info->num_data_ranges = info->alloc_data_ranges = 0;
+    info->gdb_symtab_size = 0;
+    info->all_loaded = TRUE;
+}
+
 static void dwarf2_module_remove(struct process* pcs, struct module_format* modfmt)
 {
+    if (!modfmt->u.dwarf2_info->all_loaded)
+        dwarf2_release_units(modfmt->u.dwarf2_info);
     dwarf2_fini_section(&modfmt->u.dwarf2_info->debug_loc);
     dwarf2_fini_section(&modfmt->u.dwarf2_info->debug_frame);
     free(modfmt->u.dwarf2_info->cuheads);
     HeapFree(GetProcessHeap(), 0, modfmt);
 }
 
+static void dwarf2_add_range(struct dwarf2_unit_range** ranges, unsigned* num, unsigned* alloc,
+                             ULONG_PTR low, ULONG_PTR high, dwarf2_parse_context_t* unit)
+{
+    struct dwarf2_unit_range* range;
+
+    if (low >= high) return;
+    if (*num == *alloc)
+    {
+        unsigned new_alloc = *alloc ? *alloc * 2 : 64;
+
+        if (!(range = realloc(*ranges, new_alloc * sizeof(*range)))) return;
+        *ranges = range;
+        *alloc = new_alloc;
+    }
+    range = &(*ranges)[(*num)++];
+    range->low = low;
+    range->high = high;
+    range->unit = unit;
+}
+
+static void dwarf2_add_unit_range(struct dwarf2_module_info_s* info, unsigned* alloc,
+                                  ULONG_PTR low, ULONG_PTR high, dwarf2_parse_context_t* unit)
+{
+    dwarf2_add_range(&info->unit_ranges, &info->num_unit_ranges, alloc, low, high, unit);
+}
+
+static int unit_range_compare(const void* p1, const void* p2)
+{
+    const struct dwarf2_unit_range* r1 = p1;
+    const struct dwarf2_unit_range* r2 = p2;
+
+    if (r1->low < r2->low) return -1;
+    if (r1->low > r2->low) return 1;
+    return 0;
+}
+
+static void dwarf2_sort_ranges(struct dwarf2_unit_range* ranges, unsigned num)
+{
+    ULONG_PTR max_high = 0;
+    unsigned i;
+
+    qsort(ranges, num, sizeof(*ranges), unit_range_compare);
+    for (i = 0; i < num; i++)
+    {
+        if (ranges[i].high > max_high) max_high = ranges[i].high;
+        ranges[i].max_high = max_high;
+    }
+}
+
+/******************************************************************
+ *		dwarf2_read_unit_ranges
+ *
+ * Gets the address ranges of a compilation unit from its top DIE, without
+ * loading any of its children.
+ */
+static void dwarf2_read_unit_ranges(struct dwarf2_module_info_s* info, unsigned* alloc,
+                                    dwarf2_parse_context_t* ctx)
+{
+    dwarf2_traverse_context_t   traverse = ctx->traverse_DIE;
+    dwarf2_abbrev_entry_attr_t* attr;
+    dwarf2_debug_info_t         di;
+    struct attribute            low_pc, range;
+    ULONG_PTR                   low, high, base;
+    unsigned                    i;
+
+    if (ctx->status != UNIT_NOTLOADED) return;
+
+    memset(&di, 0, sizeof(di));
+    di.unit_ctx = ctx;
+    di.abbrev = dwarf2_abbrev_table_find_entry(&ctx->abbrev_table, dwarf2_leb128_as_unsigned(&traverse));
+    if (!di.abbrev || di.abbrev->tag != DW_TAG_compile_unit) return;
+    if (di.abbrev->num_attr)
+    {
+        di.data = pool_alloc(&ctx->pool, di.abbrev->num_attr * sizeof(const char*));
+        for (i = 0, attr = di.abbrev->attrs; attr; i++, attr = attr->next)
+        {
+            di.data[i] = traverse.data;
+            dwarf2_swallow_attribute(&traverse, &ctx->head, attr);
+        }
+    }
+
+    if (dwarf2_find_attribute(&di, DW_AT_ranges, &range))
+    {
+        /* the entries are relative to the unit's base address */
+        base = dwarf2_find_attribute(&di, DW_AT_low_pc, &low_pc) ? low_pc.u.uvalue : 0;
+        traverse.data = ctx->module_ctx->sections[section_ranges].address + range.u.uvalue;
+        traverse.end_data = ctx->module_ctx->sections[section_ranges].address +
+            ctx->module_ctx->sections[section_ranges].size;
+        while (traverse.data + 2 * ctx->head.word_size <= traverse.end_data)
+        {
+            low = dwarf2_parse_addr_head(&traverse, &ctx->head);
+            high = dwarf2_parse_addr_head(&traverse, &ctx->head);
+            if (low == 0 && high == 0) break;
+            if (low == (ctx->head.word_size == 8 ? (~(DWORD64)0u) : (DWORD64)(~0u)))
+                base = high;
+            else
+                dwarf2_add_unit_range(info, alloc, base + low, base + high, ctx);
+        }
+    }
+    else if (dwarf2_read_range(ctx, &di, &low, &high))
+        dwarf2_add_unit_range(info, alloc, low, high, ctx);
+}
+
+/******************************************************************
+ *		dwarf2_load_aranges
+ *
+ * Gets the address ranges of the compilation units from .debug_aranges.
+ */
+static void dwarf2_load_aranges(struct dwarf2_module_info_s* info, unsigned* alloc,
+                                const dwarf2_section_t* aranges, BOOL* covered)
+{
+    dwarf2_parse_module_context_t* module_ctx = &info->module_ctx;
+    dwarf2_traverse_context_t   traverse;
+    const unsigned char*        set_start;
+    const unsigned char*        set_end;
+    unsigned char               offset_size, address_size, segment_size;
+    ULONG_PTR                   length, info_offset, low;
+    unsigned                    version, idx, tuple_size;
+
+    traverse.data = aranges->address;
+    traverse.end_data = aranges->address + aranges->size;
+    while (traverse.data + 4 <= traverse.end_data)
+    {
+        set_start = traverse.data;
+        length = dwarf2_parse_3264(&traverse, &offset_size);
+        set_end = traverse.data + length;
+        if (set_end > traverse.end_data) break;
+        version = dwarf2_parse_u2(&traverse);
+        info_offset = dwarf2_parse_offset(&traverse, offset_size);
+        address_size = dwarf2_parse_byte(&traverse);
+        segment_size = dwarf2_parse_byte(&traverse);
+        idx = dwarf2_find_unit(module_ctx, info_offset);
+        if (version != 2 || (address_size != 4 && address_size != 8) || segment_size ||
+            idx >= module_ctx->unit_contexts.num_elts)
+        {
+            WARN("Skipping address range set for unit 0x%lx\n", info_offset);
+            traverse.data = set_end;
+            continue;
+        }
+        /* the tuples are aligned on their size from the start of the set */
+        tuple_size = 2 * address_size;
+        traverse.data = set_start + (traverse.data - set_start + tuple_size - 1) / tuple_size * tuple_size;
+        while (traverse.data + tuple_size <= set_end)
+        {
+            low = dwarf2_parse_addr(&traverse, address_size);
+            length = dwarf2_parse_addr(&traverse, address_size);
+            if (!low && !length) break;
+            dwarf2_add_unit_range(info, alloc, low, low + length, vector_at(&module_ctx->unit_contexts, idx));
+            covered[idx] = TRUE;
+        }
+        traverse.data = set_end;
+    }
+}
+
+/******************************************************************
+ *		dwarf2_load_gdb_index
+ *
+ * Gets the address ranges of the compilation units from .gdb_index, and
+ * keeps its symbol table for looking up names.
+ */
+static BOOL dwarf2_load_gdb_index(struct dwarf2_module_info_s* info, unsigned* alloc, BOOL* covered)
+{
+    dwarf2_parse_module_context_t* module_ctx = &info->module_ctx;
+    const unsigned char*        ptr = info->gdb_index.address;
+    const unsigned char*        entry;
+    ULONG_PTR                   version, cu_list, types_list, address_area, symtab, pool;
+    DWORD                       cu;
+    unsigned                    idx;
+
+    if (!ptr || ptr == IMAGE_NO_MAP || info->gdb_index.size < 6 * 4) return FALSE;
+    version      = dwarf2_get_u4(ptr);
+    cu_list      = dwarf2_get_u4(ptr + 4);
+    types_list   = dwarf2_get_u4(ptr + 8);
+    address_area = dwarf2_get_u4(ptr + 12);
+    symtab       = dwarf2_get_u4(ptr + 16);
+    pool         = dwarf2_get_u4(ptr + 20);
+    /* older versions aren't generated anymore, and have broken symbol tables */
+    if (version < 7 || version > 8 || cu_list > types_list || types_list > address_area ||
+        address_area > symtab || symtab > pool || pool > info->gdb_index.size)
+    {
+        WARN("Unsupported .gdb_index version %lu\n", version);
+        return FALSE;
+    }
+    info->gdb_cu_list = ptr + cu_list;
+    info->gdb_num_cus = (types_list - cu_list) / 16;
+    info->gdb_symtab = ptr + symtab;
+    info->gdb_symtab_size = (pool - symtab) / 8;
+    if (info->gdb_symtab_size & (info->gdb_symtab_size - 1)) info->gdb_symtab_size = 0;
+    info->gdb_pool = ptr + pool;
+    info->gdb_pool_size = info->gdb_index.size - pool;
+
+    for (entry = ptr + address_area; entry + 20 <= ptr + symtab; entry += 20)
+    {
+        cu = dwarf2_get_u4(entry + 16);
+        if (cu >= info->gdb_num_cus) continue;
+        idx = dwarf2_find_unit(module_ctx, dwarf2_get_u8(info->gdb_cu_list + cu * 16));
+        if (idx >= module_ctx->unit_contexts.num_elts) continue;
+        dwarf2_add_unit_range(info, alloc, dwarf2_get_u8(entry), dwarf2_get_u8(entry + 8),
+                              vector_at(&module_ctx->unit_contexts, idx));
+        covered[idx] = TRUE;
+    }
+    return TRUE;
+}
+
+/******************************************************************
+ *		dwarf2_build_unit_index
+ *
+ * Sorts out which compilation units cover which addresses, so that they
+ * can be loaded on demand.
+ */
+static void dwarf2_build_unit_index(struct dwarf2_module_info_s* info, struct image_file_map* fmap)
+{
+    dwarf2_parse_module_context_t* module_ctx = &info->module_ctx;
+    struct image_section_map    aranges_sect;
+    dwarf2_section_t            aranges;
+    unsigned                    i, alloc = 0;
+    BOOL*                       covered;
+
+    if (!(covered = calloc(module_ctx->unit_contexts.num_elts + 1, sizeof(*covered)))) return;
+    if (!dwarf2_load_gdb_index(info, &alloc, covered))
+    {
+        if (dwarf2_init_section(&aranges, fmap, ".debug_aranges", ".zdebug_aranges", &aranges_sect))
+            dwarf2_load_aranges(info, &alloc, &aranges, covered);
+        dwarf2_fini_section(&aranges);
+        image_unmap_section(&aranges_sect);
+    }
+    /* the indexes don't always list every unit */
+    for (i = 0; i < module_ctx->unit_contexts.num_elts; i++)
+    {
+        if (!covered[i])
+            dwarf2_read_unit_ranges(info, &alloc, vector_at(&module_ctx->unit_contexts, i));
+    }
+    free(covered);
+
+    dwarf2_sort_ranges(info->unit_ranges, info->num_unit_ranges);
+    TRACE("%u units, %u address ranges, %s name index\n", module_ctx->unit_contexts.num_elts,
+          info->num_unit_ranges, info->gdb_symtab_size ? "with" : "without");
+}
+
+static void dwarf2_load_all_units(struct dwarf2_module_info_s* info)
+{
+    unsigned i;
+
+    TRACE("Loading all units for %s\n", debugstr_w(info->module_ctx.module->modulename));
+    for (i = 0; i < info->module_ctx.unit_contexts.num_elts; i++)
+        dwarf2_parse_compilation_unit(vector_at(&info->module_ctx.unit_contexts, i));
+    /* nothing is left to load */
+    dwarf2_release_units(info);
+}
+
+/* loads the pending units of the sorted ranges covering addr, or only reports
+ * if there are any; a range without a unit sets *all instead */
+static BOOL dwarf2_request_ranges(struct dwarf2_unit_range* ranges, unsigned num, ULONG_PTR addr,
+                                  BOOL load, BOOL* all)
+{
+    unsigned low = 0, high = num, mid;
+    BOOL pending = FALSE;
+
+    while (low < high)
+    {
+        mid = (low + high) / 2;
+        if (ranges[mid].low <= addr) low = mid + 1;
+        else high = mid;
+    }
+    /* walk back the ranges starting before addr, while one of them may still contain it */
+    while (low-- > 0 && ranges[low].max_high > addr)
+    {
+        if (addr >= ranges[low].high) continue;
+        if (!ranges[low].unit)
+        {
+            *all = TRUE;
+            return TRUE;
+        }
+        if (ranges[low].unit->status != UNIT_NOTLOADED) continue;
+        pending = TRUE;
+        if (!load) break;
+        dwarf2_parse_compilation_unit(ranges[low].unit);
+    }
+    return pending;
+}
+
+/******************************************************************
+ *		dwarf2_request_address
+ *
+ * Loads the pending units covering the given address (relative to the
+ * load offset), either with code or with a global variable there. When
+ * load is FALSE, only reports if there are any.
+ */
+static BOOL dwarf2_request_address(struct dwarf2_module_info_s* info, ULONG_PTR addr, BOOL load)
+{
+    BOOL pending, all = FALSE;
+
+    pending = dwarf2_request_ranges(info->unit_ranges, info->num_unit_ranges, addr, load, &all);
+    if ((load || !pending) && info->num_data_ranges)
+    {
+        if (!info->data_ranges_sorted)
+        {
+            dwarf2_sort_ranges(info->data_ranges, info->num_data_ranges);
+            info->data_ranges_sorted = TRUE;
+        }
+        pending |= dwarf2_request_ranges(info->data_ranges, info->num_data_ranges, addr, load, &all);
+    }
+    if (all && load) dwarf2_load_all_units(info);
+    return pending;
+}
+
+/******************************************************************
+ *		dwarf2_lookup_gdb_name
+ *
+ * Finds the list of units defining a name in .gdb_index. Returns the
+ * number of its entries, which follow *vec.
+ */
+static unsigned dwarf2_lookup_gdb_name(struct dwarf2_module_info_s* info, const char* name,
+                                       const unsigned char** vec)
+{
+    unsigned                    mask = info->gdb_symtab_size - 1, len = strlen(name), idx, step, i;
+    DWORD                       hash = 0, name_offset, vec_offset;
+
+    for (i = 0; i < len; i++) hash = hash * 67 + tolower((unsigned char)name[i]) - 113;
+    idx = hash & mask;
+    step = ((hash * 17) & mask) | 1;
+    for (i = 0; i <= mask; i++, idx = (idx + step) & mask)
+    {
+        name_offset = dwarf2_get_u4(info->gdb_symtab + idx * 8);
+        vec_offset = dwarf2_get_u4(info->gdb_symtab + idx * 8 + 4);
+        if (!name_offset && !vec_offset) break;
+        if (name_offset >= info->gdb_pool_size || info->gdb_pool_size - name_offset <= len ||
+            memcmp(info->gdb_pool + name_offset, name, len + 1))
+            continue;
+        if (vec_offset > info->gdb_pool_size - 4) break;
+        *vec = info->gdb_pool + vec_offset;
+        return min(dwarf2_get_u4(*vec), (info->gdb_pool_size - vec_offset - 4) / 4);
+    }
+    return 0;
+}
+
+/* gets the unit of an entry in a .gdb_index unit list */
+static dwarf2_parse_context_t* dwarf2_get_gdb_unit(struct dwarf2_module_info_s* info, DWORD entry)
+{
+    /* the low 24 bits are the index of the unit */
+    DWORD cu = entry & 0xffffff;
+    unsigned idx;
+
+    if (cu >= info->gdb_num_cus) return NULL;
+    idx = dwarf2_find_unit(&info->module_ctx, dwarf2_get_u8(info->gdb_cu_list + cu * 16));
+    if (idx >= info->module_ctx.unit_contexts.num_elts) return NULL;
+    return vector_at(&info->module_ctx.unit_contexts, idx);
+}
+
+/******************************************************************
+ *		dwarf2_request_name
+ *
+ * Loads the units defining a given name, as listed in .gdb_index.
+ */
+static void dwarf2_request_name(struct dwarf2_module_info_s* info, const char* name)
+{
+    dwarf2_parse_context_t*     unit;
+    const unsigned char*        vec;
+    unsigned                    count = dwarf2_lookup_gdb_name(info, name, &vec);
+
+    while (count--)
+    {
+        vec += 4;
+        if ((unit = dwarf2_get_gdb_unit(info, dwarf2_get_u4(vec))))
+            dwarf2_parse_compilation_unit(unit);
+    }
+}
+
+static void dwarf2_module_request(struct module_format* modfmt, DWORD64 addr, const char* name)
+{
+    struct dwarf2_module_info_s* info = modfmt->u.dwarf2_info;
+    unsigned num_loaded = info->module_ctx.num_loaded;
+
+    if (info->all_loaded) return;
+    if (addr)
+        dwarf2_request_address(info, addr - info->module_ctx.load_offset, TRUE);
+    else if (name && info->gdb_symtab_size)
+        dwarf2_request_name(info, name);
+    else
+        dwarf2_load_all_units(info);
+    /* the symbol table entries in the loaded units which didn't get defined */
+    if (info->all_loaded || info->module_ctx.num_loaded != num_loaded)
+        symt_add_deferred_symbols(modfmt->module);
+}
+
+/******************************************************************
+ *		dwarf2_is_unit_pending
+ *
+ * Checks whether an address is covered by a compilation unit which hasn't been
+ * loaded yet (so that the symbols found there aren't mistaken for ones
+ * without debug information).
+ */
+BOOL dwarf2_is_unit_pending(struct module* module, DWORD64 addr)
+{
+    struct module_format* modfmt = module->format_info[DFI_DWARF];
+
+    if (!modfmt || modfmt->u.dwarf2_info->all_loaded) return FALSE;
+    return dwarf2_request_address(modfmt->u.dwarf2_info, addr - modfmt->u.dwarf2_info->module_ctx.load_offset, FALSE);
+}
+
+/******************************************************************
+ *		dwarf2_defer_data_symbol
+ *
+ * Checks whether a global variable of the image's symbol table is defined
+ * by a compilation unit which hasn't been loaded yet. If so, its address is
+ * remembered, so that looking it up loads the unit, and it's reported as
+ * pending by dwarf2_is_unit_pending() until then. Without .gdb_index, there's
+ * no telling which unit defines it, and all of them are loaded.
+ */
+BOOL dwarf2_defer_data_symbol(struct module* module, const char* name, DWORD64 addr, DWORD64 size)
+{
+    struct module_format*       modfmt = module->format_info[DFI_DWARF];
+    struct dwarf2_module_info_s* info;
+    dwarf2_parse_context_t*     unit;
+    const unsigned char*        vec;
+    ULONG_PTR                   low;
+    unsigned                    count;
+    DWORD                       entry;
+    BOOL                        deferred = FALSE;
+
+    if (!modfmt || modfmt->u.dwarf2_info->all_loaded) return FALSE;
+    info = modfmt->u.dwarf2_info;
+    low = addr - info->module_ctx.load_offset;
+    if (!size) size = 1;
+
+    if (!info->gdb_symtab_size)
+    {
+        dwarf2_add_range(&info->data_ranges, &info->num_data_ranges, &info->alloc_data_ranges,
+                         low, low + size, NULL);
+        info->data_ranges_sorted = FALSE;
+        return TRUE;
+    }
+    count = dwarf2_lookup_gdb_name(info, name, &vec);
+    while (count--)
+    {
+        vec += 4;
+        entry = dwarf2_get_u4(vec);
+        /* the symbol kind is in bits 28 to 30 */
+        if (((entry >> 28) & 7) != GDB_INDEX_SYMBOL_KIND_VARIABLE) continue;
+        if (!(unit = dwarf2_get_gdb_unit(info, entry)) || unit->status != UNIT_NOTLOADED) continue;
+        dwarf2_add_range(&info->data_ranges, &info->num_data_ranges, &info->alloc_data_ranges,
+                         low, low + size, unit);
+        info->data_ranges_sorted = FALSE;
+        deferred = TRUE;
+    }
+    return deferred;
+}
+
 static BOOL dwarf2_load_CU_module(dwarf2_parse_module_context_t* module_ctx, struct module* module,
                                   dwarf2_section_t* sections, ULONG_PTR load_offset,
-                                  const struct elf_thunk_area* thunks, BOOL is_dwz)
+                                  const struct elf_thunk_area* thunks)
 {
     dwarf2_traverse_context_t   mod_ctx;
-    unsigned i;
 
     module_ctx->sections = sections;
     module_ctx->module = module;
@@ -4010,7 +4531,11 @@ static BOOL dwarf2_load_CU_module(dwarf2_parse_module_context_t* module_ctx, str
     vector_init(&module_ctx->unit_contexts, sizeof(dwarf2_parse_context_t), 16);
     module_ctx->cu_versions = 0;
 
-    /* phase I: parse all CU heads */
+    /* only parse the CU heads here, the content of the units is loaded when
+     * it's first needed (either from an address or a name lookup, or when the
+     * debug information is enumerated): it's likely most of them will never be,
+     * and doing this can lead to a huge performance improvement.
+     */
     mod_ctx.data = sections[section_debug].address;
     mod_ctx.end_data = mod_ctx.data + sections[section_debug].size;
     while (mod_ctx.data < mod_ctx.end_data)
@@ -4021,15 +4546,6 @@ static BOOL dwarf2_load_CU_module(dwarf2_parse_module_context_t* module_ctx, str
         dwarf2_parse_compilation_unit_head(unit_ctx, &mod_ctx);
     }
 
-    /* phase2: load content of all CU
-     * If this is a DWZ alternate module, don't load all debug_info at once
-     * wait for main module to ask for them (it's likely it won't need them all)
-     * Doing this can lead to a huge performance improvement.
-     */
-    if (!is_dwz)
-        for (i = 0; i < module_ctx->unit_contexts.num_elts; ++i)
-            dwarf2_parse_compilation_unit((dwarf2_parse_context_t*)vector_at(&module_ctx->unit_contexts, i));
-
     return TRUE;
 }
 
@@ -4055,7 +4571,7 @@ static dwarf2_dwz_alternate_t* dwarf2_load_dwz(struct image_file_map* fmap, stru
     dwarf2_init_section(&dwz->sections[section_ranges], fmap_dwz, ".debug_ranges", ".zdebug_ranges", &dwz->sectmap[section_ranges]);
 
     dwz->module_ctx.dwz = NULL;
-    dwarf2_load_CU_module(&dwz->module_ctx, module, dwz->sections, 0/*FIXME*/, NULL, TRUE);
+    dwarf2_load_CU_module(&dwz->module_ctx, module, dwz->sections, 0/*FIXME*/, NULL);
     return dwz;
 }
 
@@ -4099,8 +4615,8 @@ BOOL dwarf2_parse(struct module* module, ULONG_PTR load_offset,
     struct image_section_map    debug_sect, debug_str_sect, debug_abbrev_sect,
                                 debug_line_sect, debug_ranges_sect, eh_frame_sect;
     BOOL                ret = TRUE;
-    struct module_format* dwarf2_modfmt;
-    dwarf2_parse_module_context_t module_ctx;
+    struct module_format* dwarf2_modfmt = NULL;
+    struct dwarf2_module_info_s* info;
 
     if (!dwarf2_init_section(&eh_frame,                fmap, ".eh_frame",     NULL,             &eh_frame_sect))
         /* lld produces .eh_fram to avoid generating a long name */
@@ -4140,48 +4656,65 @@ BOOL dwarf2_parse(struct module* module, ULONG_PTR load_offset,
     dwarf2_modfmt->module = module;
     dwarf2_modfmt->remove = dwarf2_module_remove;
     dwarf2_modfmt->loc_compute = dwarf2_location_compute;
-    dwarf2_modfmt->u.dwarf2_info = (struct dwarf2_module_info_s*)(dwarf2_modfmt + 1);
-    dwarf2_modfmt->u.dwarf2_info->word_size = fmap->addr_size / 8; /* set the word_size for eh_frame parsing */
+    dwarf2_modfmt->request = dwarf2_module_request;
+    dwarf2_modfmt->u.dwarf2_info = info = (struct dwarf2_module_info_s*)(dwarf2_modfmt + 1);
+    info->word_size = fmap->addr_size / 8; /* set the word_size for eh_frame parsing */
     dwarf2_modfmt->module->format_info[DFI_DWARF] = dwarf2_modfmt;
 
     /* As we'll need later some sections' content, we won't unmap these
      * sections upon existing this function
      */
-    dwarf2_init_section(&dwarf2_modfmt->u.dwarf2_info->debug_loc,   fmap, ".debug_loc",   ".zdebug_loc",   NULL);
-    dwarf2_init_section(&dwarf2_modfmt->u.dwarf2_info->debug_frame, fmap, ".debug_frame", ".zdebug_frame", NULL);
-    dwarf2_modfmt->u.dwarf2_info->eh_frame = eh_frame;
-    dwarf2_modfmt->u.dwarf2_info->cuheads = NULL;
-    dwarf2_modfmt->u.dwarf2_info->num_cuheads = 0;
-
-    module_ctx.dwz = dwarf2_load_dwz(fmap, module);
-    dwarf2_load_CU_module(&module_ctx, module, section, load_offset, thunks, FALSE);
+    dwarf2_init_section(&info->debug_loc,   fmap, ".debug_loc",   ".zdebug_loc",   NULL);
+    dwarf2_init_section(&info->debug_frame, fmap, ".debug_frame", ".zdebug_frame", NULL);
+    dwarf2_init_section(&info->gdb_index,   fmap, ".gdb_index",   NULL,            NULL);
+    info->eh_frame = eh_frame;
+    info->cuheads = NULL;
+    info->num_cuheads = 0;
+    info->all_loaded = FALSE;
+    info->unit_ranges = NULL;
+    info->num_unit_ranges = 0;
+    info->data_ranges = NULL;
+    info->num_data_ranges = info->alloc_data_ranges = 0;
+    info->data_ranges_sorted = TRUE;
+    info->gdb_symtab_size = 0;
+    /* the units are loaded on demand, so the sections need to be kept too */
+    memcpy(info->sections, section, sizeof(section));
+
+    info->module_ctx.dwz = dwarf2_load_dwz(fmap, module);
+    dwarf2_load_CU_module(&info->module_ctx, module, info->sections, load_offset, thunks);
+    dwarf2_build_unit_index(info, fmap);
 
     dwarf2_modfmt->module->module.SymType = SymDia;
     /* hide dwarf versions in CVSig
      * bits 24-31 will be set according to found dwarf version
      * different CU can have different dwarf version, so use a bit per version (version 2 => b24)
      */
-    dwarf2_modfmt->module->module.CVSig = 'D' | ('W' << 8) | ('F' << 16) | ((module_ctx.cu_versions & 0xFF) << 24);
+    dwarf2_modfmt->module->module.CVSig = 'D' | ('W' << 8) | ('F' << 16) | ((info->module_ctx.cu_versions & 0xFF) << 24);
     /* FIXME: we could have a finer grain here */
     dwarf2_modfmt->module->module.GlobalSymbols = TRUE;
     dwarf2_modfmt->module->module.TypeInfo = TRUE;
     dwarf2_modfmt->module->module.SourceIndexed = TRUE;
     dwarf2_modfmt->module->module.Publics = TRUE;
+    /* the line numbers will only be read with their unit */
+    if (section[section_line].size)
+        dwarf2_modfmt->module->module.LineNumbers = TRUE;
 
-    dwarf2_unload_CU_module(&module_ctx);
 leave:
-
-    dwarf2_fini_section(&section[section_debug]);
-    dwarf2_fini_section(&section[section_abbrev]);
-    dwarf2_fini_section(&section[section_string]);
-    dwarf2_fini_section(&section[section_line]);
-    dwarf2_fini_section(&section[section_ranges]);
-
-    image_unmap_section(&debug_sect);
-    image_unmap_section(&debug_abbrev_sect);
-    image_unmap_section(&debug_str_sect);
-    image_unmap_section(&debug_line_sect);
-    image_unmap_section(&debug_ranges_sect);
+    if (!dwarf2_modfmt)
+    {
+        dwarf2_fini_section(&section[section_debug]);
+        dwarf2_fini_section(&section[section_abbrev]);
+        dwarf2_fini_section(&section[section_string]);
+        dwarf2_fini_section(&section[section_line]);
+        dwarf2_fini_section(&section[section_ranges]);
+
+        /* otherwise, the sections stay mapped along with the image */
+        image_unmap_section(&debug_sect);
+        image_unmap_section(&debug_abbrev_sect);
+        image_unmap_section(&debug_str_sect);
+        image_unmap_section(&debug_line_sect);
+        image_unmap_section(&debug_ranges_sect);
+    }
     if (!ret) image_unmap_section(&eh_frame_sect);
 
     return ret;
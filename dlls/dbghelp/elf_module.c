@@ -945,6 +945,23 @@ static int elf_new_wine_thunks(struct module* module, const struct hash_table* h
             ULONG64     ref_addr;
             struct location loc;
 
+            /* check again once the debug information covering it is loaded */
+            if (dwarf2_is_unit_pending(module, addr) ||
+                ((ste->sym.st_info & 0xf) == ELF_STT_OBJECT &&
+                 dwarf2_defer_data_symbol(module, ste->ht_elt.name, addr, ste->sym.st_size)))
+            {
+                switch (ste->sym.st_info & 0xf)
+                {
+                case ELF_STT_FUNC:
+                case ELF_STT_OBJECT:
+                    symt_defer_symbol(module, ste->compiland, ste->ht_elt.name, addr, ste->sym.st_size,
+                                      (ste->sym.st_info & 0xf) == ELF_STT_FUNC,
+                                      elf_is_local_symbol(ste->sym.st_info));
+                    break;
+                }
+                continue;
+            }
+
             symt = symt_find_nearest(module, addr);
             if (symt && !symt_get_address(&symt->symt, &ref_addr))
                 ref_addr = addr;
@@ -1032,7 +1049,7 @@ static BOOL elf_load_debug_info_from_map(struct module* module,
                                          struct hash_table* ht_symtab)
 {
     BOOL                ret = FALSE, lret;
-    struct elf_thunk_area thunks[] = 
+    static const struct elf_thunk_area default_thunks[] =
     {
         {"__wine_spec_import_thunks",           THUNK_ORDINAL_NOTYPE, 0, 0},    /* inter DLL calls */
         {"__wine_spec_delayed_import_loaders",  THUNK_ORDINAL_LOAD,   0, 0},    /* delayed inter DLL calls */
@@ -1042,6 +1059,11 @@ static BOOL elf_load_debug_info_from_map(struct module* module,
         {"__wine_spec_thunk_text_32",           -32,                  0, 0},    /* 32 => 16 thunks */
         {NULL,                                  0,                    0, 0}
     };
+    struct elf_thunk_area* thunks;
+
+    /* the thunks are kept with the module, as the DWARF units refer to them when loaded later on */
+    if (!(thunks = pool_alloc(&module->pool, sizeof(default_thunks)))) return FALSE;
+    memcpy(thunks, default_thunks, sizeof(default_thunks));
 
     module->module.SymType = SymExport;
 
@@ -1255,6 +1277,7 @@ static BOOL elf_load_file_from_fmap(struct process* pcs, const WCHAR* filename,
         modfmt->module      = elf_info->module;
         modfmt->remove      = elf_module_remove;
         modfmt->loc_compute = NULL;
+        modfmt->request     = NULL;
         modfmt->u.elf_info  = elf_module_info;
 
         elf_module_info->elf_addr = load_offset;
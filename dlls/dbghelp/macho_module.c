@@ -1135,6 +1135,16 @@ static void macho_finish_stabs(struct module* module, struct hash_table* ht_symt
 
             if (ste->used) continue;
 
+            /* check again once the debug information covering it is loaded */
+            if (dwarf2_is_unit_pending(module, ste->addr) ||
+                (!ste->is_code && dwarf2_defer_data_symbol(module, ste->ht_elt.name, ste->addr, 0)))
+            {
+                symt_defer_symbol(module, ste->compiland, ste->ht_elt.name, ste->addr, 0,
+                                  ste->is_code, !ste->is_global);
+                ste->used = 1;
+                continue;
+            }
+
             sym = symt_find_nearest(module, ste->addr);
             if (sym)
                 symt_get_address(&sym->symt, &addr);
@@ -1489,6 +1499,7 @@ static BOOL macho_load_file(struct process* pcs, const WCHAR* filename,
         modfmt->module       = macho_info->module;
         modfmt->remove       = macho_module_remove;
         modfmt->loc_compute  = NULL;
+        modfmt->request      = NULL;
         modfmt->u.macho_info = macho_module_info;
 
         macho_module_info->load_addr = load_addr;
@@ -298,10 +298,16 @@ static void fetch_memory64_info(struct dump_context* dc)
     addr = 0;
     while (VirtualQueryEx(dc->process->handle, (LPCVOID)addr, &mbi, sizeof(mbi)) != 0)
     {
-        /* Memory regions with state MEM_COMMIT will be added to the dump */
+        /* Memory regions with state MEM_COMMIT will be added to the dump,
+         * merging the adjacent ones as their data is stored contiguously anyway
+         */
         if (mbi.State == MEM_COMMIT)
         {
-            minidump_add_memory64_block(dc, (ULONG_PTR)mbi.BaseAddress, mbi.RegionSize);
+            if (dc->num_mem64 &&
+                dc->mem64[dc->num_mem64 - 1].base + dc->mem64[dc->num_mem64 - 1].size == (ULONG_PTR)mbi.BaseAddress)
+                dc->mem64[dc->num_mem64 - 1].size += mbi.RegionSize;
+            else
+                minidump_add_memory64_block(dc, (ULONG_PTR)mbi.BaseAddress, mbi.RegionSize);
         }
 
         if ((addr + mbi.RegionSize) < addr)
@@ -845,6 +851,163 @@ static unsigned         dump_memory_info(struct dump_context* dc)
     return sz;
 }
 
+/* The full memory is read in large chunks by a few worker threads, while the
+ * chunks already read are written in order to the dump.
+ * The dumping thread reads them itself when the workers could wait for it, as
+ * they can't start while it holds the loader lock, and when dumping its own
+ * process, where it may also hold locks of the heap the threads use.
+ */
+#define DUMP_CHUNK_SIZE         (1024 * 1024)
+#define DUMP_CHUNK_BUFFERS      8
+#define DUMP_MAX_READERS        4
+
+struct dump_chunk
+{
+    ULONG64                     base;
+    ULONG                       size;
+};
+
+struct dump_chunk_buffer
+{
+    HANDLE                      ready;
+    BYTE*                       data;
+};
+
+struct dump_memory64_stream
+{
+    struct dump_context*        dc;
+    struct dump_chunk*          chunks;
+    unsigned                    num_chunks;
+    LONG                        next_chunk;
+    HANDLE                      free_buffers;
+    struct dump_chunk_buffer    buffers[DUMP_CHUNK_BUFFERS];
+};
+
+static void read_memory64_chunk(struct dump_context* dc, const struct dump_chunk* chunk, BYTE* data)
+{
+    SIZE_T                      pos, len;
+
+    if (!NtReadVirtualMemory(dc->process->handle, (void*)(ULONG_PTR)chunk->base, data, chunk->size, NULL))
+        return;
+    /* fall back to page sized reads, so that only the unreadable parts are lost */
+    for (pos = 0; pos < chunk->size; pos += len)
+    {
+        len = min(chunk->size - pos, 0x1000 - ((chunk->base + pos) & 0xfff));
+        if (NtReadVirtualMemory(dc->process->handle, (void*)(ULONG_PTR)(chunk->base + pos), data + pos, len, NULL))
+            memset(data + pos, 0, len);
+    }
+}
+
+static DWORD WINAPI dump_memory64_reader(void* arg)
+{
+    struct dump_memory64_stream* stream = arg;
+    LONG                        idx;
+
+    for (;;)
+    {
+        /* a chunk is only picked once its buffer has been written out */
+        WaitForSingleObject(stream->free_buffers, INFINITE);
+        if ((idx = InterlockedIncrement(&stream->next_chunk) - 1) >= stream->num_chunks)
+        {
+            ReleaseSemaphore(stream->free_buffers, 1, NULL);
+            break;
+        }
+        read_memory64_chunk(stream->dc, &stream->chunks[idx], stream->buffers[idx % DUMP_CHUNK_BUFFERS].data);
+        SetEvent(stream->buffers[idx % DUMP_CHUNK_BUFFERS].ready);
+    }
+    return 0;
+}
+
+static BOOL init_memory64_stream(struct dump_memory64_stream* stream, struct dump_context* dc)
+{
+    ULONG64                     pos;
+    unsigned                    i;
+
+    memset(stream, 0, sizeof(*stream));
+    stream->dc = dc;
+    for (i = 0; i < dc->num_mem64; i++)
+        stream->num_chunks += (dc->mem64[i].size + DUMP_CHUNK_SIZE - 1) / DUMP_CHUNK_SIZE;
+    if (!(stream->chunks = HeapAlloc(GetProcessHeap(), 0, stream->num_chunks * sizeof(*stream->chunks))))
+        return FALSE;
+    stream->num_chunks = 0;
+    for (i = 0; i < dc->num_mem64; i++)
+    {
+        for (pos = 0; pos < dc->mem64[i].size; pos += DUMP_CHUNK_SIZE)
+        {
+            stream->chunks[stream->num_chunks].base = dc->mem64[i].base + pos;
+            stream->chunks[stream->num_chunks].size = min(dc->mem64[i].size - pos, DUMP_CHUNK_SIZE);
+            stream->num_chunks++;
+        }
+    }
+    for (i = 0; i < DUMP_CHUNK_BUFFERS; i++)
+    {
+        if (!(stream->buffers[i].data = HeapAlloc(GetProcessHeap(), 0, DUMP_CHUNK_SIZE)) ||
+            !(stream->buffers[i].ready = CreateEventW(NULL, FALSE, FALSE, NULL)))
+            return FALSE;
+    }
+    return (stream->free_buffers = CreateSemaphoreW(NULL, DUMP_CHUNK_BUFFERS, DUMP_CHUNK_BUFFERS, NULL)) != NULL;
+}
+
+static void free_memory64_stream(struct dump_memory64_stream* stream)
+{
+    unsigned                    i;
+
+    for (i = 0; i < DUMP_CHUNK_BUFFERS; i++)
+    {
+        HeapFree(GetProcessHeap(), 0, stream->buffers[i].data);
+        if (stream->buffers[i].ready) CloseHandle(stream->buffers[i].ready);
+    }
+    if (stream->free_buffers) CloseHandle(stream->free_buffers);
+    HeapFree(GetProcessHeap(), 0, stream->chunks);
+}
+
+/******************************************************************
+ *		write_memory64_data
+ *
+ * Streams the content of all the memory ranges to the dump, from the current
+ * position of the file.
+ */
+static void write_memory64_data(struct dump_context* dc)
+{
+    struct dump_memory64_stream stream;
+    HANDLE                      readers[DUMP_MAX_READERS];
+    unsigned                    i, num_readers = 0;
+    SYSTEM_INFO                 si;
+    DWORD                       written;
+
+    if (!init_memory64_stream(&stream, dc))
+    {
+        ERR("Couldn't allocate the memory stream\n");
+        free_memory64_stream(&stream);
+        return;
+    }
+
+    if (dc->pid != GetCurrentProcessId() &&
+        !RtlIsCriticalSectionLockedByThread(NtCurrentTeb()->Peb->LoaderLock))
+    {
+        GetSystemInfo(&si);
+        while (num_readers < min(si.dwNumberOfProcessors, DUMP_MAX_READERS) &&
+               (readers[num_readers] = CreateThread(NULL, 0, dump_memory64_reader, &stream, 0, NULL)))
+            num_readers++;
+    }
+
+    for (i = 0; i < stream.num_chunks; i++)
+    {
+        struct dump_chunk_buffer* buffer = &stream.buffers[i % DUMP_CHUNK_BUFFERS];
+
+        if (num_readers)
+            WaitForSingleObject(buffer->ready, INFINITE);
+        else
+            read_memory64_chunk(dc, &stream.chunks[i], buffer->data);
+        WriteFile(dc->hFile, buffer->data, stream.chunks[i].size, &written, NULL);
+        ReleaseSemaphore(stream.free_buffers, 1, NULL);
+    }
+
+    if (num_readers) WaitForMultipleObjects(num_readers, readers, TRUE, INFINITE);
+    for (i = 0; i < num_readers; i++) CloseHandle(readers[i]);
+    free_memory64_stream(&stream);
+}
+
 /******************************************************************
  *		dump_memory64_info
  *
@@ -853,17 +1016,13 @@ static unsigned         dump_memory_info(struct dump_context* dc)
 static unsigned         dump_memory64_info(struct dump_context* dc)
 {
     MINIDUMP_MEMORY64_LIST          mdMem64List;
-    MINIDUMP_MEMORY_DESCRIPTOR64    mdMem64;
-    DWORD                           written;
-    unsigned                        i, len, sz;
-    RVA                             rva_base;
-    char                            tmp[1024];
-    ULONG64                         pos;
+    MINIDUMP_MEMORY_DESCRIPTOR64*   mdMem64;
+    unsigned                        i, sz;
     LARGE_INTEGER                   filepos;
 
     sz = sizeof(mdMem64List.NumberOfMemoryRanges) +
             sizeof(mdMem64List.BaseRva) +
-            dc->num_mem64 * sizeof(mdMem64);
+            dc->num_mem64 * sizeof(*mdMem64);
 
     mdMem64List.NumberOfMemoryRanges = dc->num_mem64;
     mdMem64List.BaseRva = dc->rva + sz;
@@ -873,27 +1032,25 @@ static unsigned         dump_memory64_info(struct dump_context* dc)
     append(dc, &mdMem64List.BaseRva,
            sizeof(mdMem64List.BaseRva));
 
-    rva_base = dc->rva;
-    dc->rva += dc->num_mem64 * sizeof(mdMem64);
-
-    /* dc->rva is not updated past this point. The end of the dump
-     * is just the full memory data. */
-    filepos.QuadPart = dc->rva;
-    for (i = 0; i < dc->num_mem64; i++)
+    if (dc->num_mem64)
     {
-        mdMem64.StartOfMemoryRange = dc->mem64[i].base;
-        mdMem64.DataSize = dc->mem64[i].size;
-        SetFilePointerEx(dc->hFile, filepos, NULL, FILE_BEGIN);
-        for (pos = 0; pos < dc->mem64[i].size; pos += sizeof(tmp))
+        mdMem64 = HeapAlloc(GetProcessHeap(), 0, dc->num_mem64 * sizeof(*mdMem64));
+        if (!mdMem64) return sz;
+        for (i = 0; i < dc->num_mem64; i++)
         {
-            len = min(dc->mem64[i].size - pos, sizeof(tmp));
-            if (read_process_memory(dc->process, dc->mem64[i].base + pos, tmp, len))
-                WriteFile(dc->hFile, tmp, len, &written, NULL);
+            mdMem64[i].StartOfMemoryRange = dc->mem64[i].base;
+            mdMem64[i].DataSize = dc->mem64[i].size;
         }
-        filepos.QuadPart += mdMem64.DataSize;
-        writeat(dc, rva_base + i * sizeof(mdMem64), &mdMem64, sizeof(mdMem64));
+        append(dc, mdMem64, dc->num_mem64 * sizeof(*mdMem64));
+        HeapFree(GetProcessHeap(), 0, mdMem64);
     }
 
+    /* dc->rva is not updated past this point. The end of the dump
+     * is just the full memory data. */
+    filepos.QuadPart = dc->rva;
+    SetFilePointerEx(dc->hFile, filepos, NULL, FILE_BEGIN);
+    write_memory64_data(dc);
+
     return sz;
 }
 
@@ -230,9 +230,13 @@ struct module* module_new(struct process* pcs, const WCHAR* name,
     module->addr_sorttab      = NULL;
     module->num_sorttab       = 0;
     module->num_symbols       = 0;
+    module->sorttab_hint      = 0;
+    module->addr_cache        = NULL;
 
     vector_init(&module->vsymt, sizeof(struct symt*), 128);
     vector_init(&module->vcustom_symt, sizeof(struct symt*), 16);
+    vector_init(&module->vdeferred_symt, sizeof(struct deferred_symbol), 64);
+    module->num_deferred_symt = 0;
     /* FIXME: this seems a bit too high (on a per module basis)
      * need some statistics about this
      */
@@ -255,7 +259,52 @@ BOOL module_init_pair(struct module_pair* pair, HANDLE hProcess, DWORD64 addr)
 {
     if (!(pair->pcs = process_find_by_handle(hProcess))) return FALSE;
     pair->requested = module_find_by_addr(pair->pcs, addr, DMT_UNKNOWN);
-    return module_get_debug(pair);
+    if (!module_get_debug(pair)) return FALSE;
+    module_request_address(pair->effective, addr);
+    return TRUE;
+}
+
+static void module_request(struct module* module, DWORD64 addr, const char* name)
+{
+    struct module_format* modfmt;
+    unsigned i;
+
+    for (i = 0; i < DFI_LAST; i++)
+    {
+        if ((modfmt = module->format_info[i]) && modfmt->request)
+            modfmt->request(modfmt, addr, name);
+    }
+    module->module.NumSyms = module->ht_symbols.num_elts;
+}
+
+/***********************************************************************
+ *		module_request_address
+ *
+ * Loads the deferred debug information needed to look up an address.
+ */
+void module_request_address(struct module* module, DWORD64 addr)
+{
+    if (addr) module_request(module, addr, NULL);
+}
+
+/***********************************************************************
+ *		module_request_name
+ *
+ * Loads the deferred debug information needed to look up a symbol or type name.
+ */
+void module_request_name(struct module* module, const char* name)
+{
+    module_request(module, 0, name);
+}
+
+/***********************************************************************
+ *		module_request_all
+ *
+ * Loads all the deferred debug information, as enumerations need it.
+ */
+void module_request_all(struct module* module)
+{
+    module_request(module, 0, NULL);
 }
 
 /***********************************************************************
@@ -1008,6 +1057,7 @@ BOOL module_remove(struct process* pcs, struct module* module)
     hash_table_destroy(&module->ht_types);
     HeapFree(GetProcessHeap(), 0, module->sources);
     HeapFree(GetProcessHeap(), 0, module->addr_sorttab);
+    HeapFree(GetProcessHeap(), 0, module->addr_cache);
     HeapFree(GetProcessHeap(), 0, module->real_path);
     pool_destroy(&module->pool);
     /* native dbghelp doesn't invoke registered callback(,CBA_SYMBOLS_UNLOADED,) here
@@ -1435,6 +1485,8 @@ void module_reset_debug_info(struct module* module)
     module->sorttab_size = 0;
     module->addr_sorttab = NULL;
     module->num_sorttab = module->num_symbols = 0;
+    HeapFree(GetProcessHeap(), 0, module->addr_cache);
+    module->addr_cache = NULL;
     hash_table_destroy(&module->ht_symbols);
     module->ht_symbols.num_buckets = 0;
     module->ht_symbols.buckets = NULL;
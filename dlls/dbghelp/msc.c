@@ -82,10 +82,44 @@ struct pdb_file_info
 
 /* FIXME: don't make it static */
 #define CV_MAX_MODULES          32
+/* a compiland whose symbols and line numbers haven't been loaded yet */
+struct pdb_compiland
+{
+    WORD                        stream;
+    BOOL                        loaded;
+    DWORD                       symbol_size;
+    DWORD                       lineno_size;
+    DWORD                       lineno2_size;
+};
+
+/* address range contributed by a compiland to the image */
+struct pdb_compiland_range
+{
+    ULONG_PTR                   low;
+    ULONG_PTR                   high;
+    unsigned                    compiland;
+};
+
 struct pdb_module_info
 {
     unsigned                    used_subfiles;
     struct pdb_file_info        pdb_files[CV_MAX_MODULES];
+    /* state needed to load the compilands on request */
+    unsigned                    num_pending;
+    unsigned                    num_compilands;
+    struct pdb_compiland*       compilands;
+    unsigned                    num_ranges;
+    struct pdb_compiland_range* ranges;
+    struct msc_debug_info       msc_dbg;
+    struct symt**               basic_types;
+    unsigned                    num_defined_types;
+    struct symt**               defined_types;
+    const BYTE*                 globalimage;
+    unsigned                    global_size;
+    const BYTE*                 global_hash;
+    unsigned                    global_hash_size;
+    const char*                 files_image;
+    DWORD                       files_size;
 };
 
 /*========================================================================
@@ -2200,6 +2234,13 @@ static void* pdb_ds_read(const struct PDB_DS_HEADER* pdb, const DWORD* block_lis
     if (!size) return NULL;
 
     num_blocks = (size + pdb->block_size - 1) / pdb->block_size;
+
+    /* a stream stored in consecutive blocks is used in place from the mapping */
+    for (i = 1; i < num_blocks; i++)
+        if (block_list[i] != block_list[0] + i) break;
+    if (i == num_blocks && block_list[0] + num_blocks <= pdb->num_pages)
+        return (void*)((const char*)pdb + (SIZE_T)block_list[0] * pdb->block_size);
+
     buffer = HeapAlloc(GetProcessHeap(), 0, num_blocks * pdb->block_size);
 
     for (i = 0; i < num_blocks; i++)
@@ -2265,9 +2306,18 @@ static unsigned pdb_get_file_size(const struct pdb_file_info* pdb_file, DWORD fi
     return 0;
 }
 
-static void pdb_free(void* buffer)
+static BOOL pdb_is_mapped(const struct pdb_file_info* pdb_file, const void* buffer)
+{
+    const struct PDB_DS_HEADER* pdb = (const struct PDB_DS_HEADER*)pdb_file->image;
+
+    return pdb_file->kind == PDB_DS && (const char*)buffer >= pdb_file->image &&
+        (const char*)buffer < pdb_file->image + (SIZE_T)pdb->num_pages * pdb->block_size;
+}
+
+static void pdb_free(const struct pdb_file_info* pdb_file, const void* buffer)
 {
-    HeapFree(GetProcessHeap(), 0, buffer);
+    if (!buffer || pdb_is_mapped(pdb_file, buffer)) return;
+    HeapFree(GetProcessHeap(), 0, (void*)buffer);
 }
 
 static void pdb_free_file(struct pdb_file_info* pdb_file)
@@ -2275,11 +2325,11 @@ static void pdb_free_file(struct pdb_file_info* pdb_file)
     switch (pdb_file->kind)
     {
     case PDB_JG:
-        pdb_free(pdb_file->u.jg.toc);
+        pdb_free(pdb_file, pdb_file->u.jg.toc);
         pdb_file->u.jg.toc = NULL;
         break;
     case PDB_DS:
-        pdb_free(pdb_file->u.ds.toc);
+        pdb_free(pdb_file, pdb_file->u.ds.toc);
         pdb_file->u.ds.toc = NULL;
         break;
     }
@@ -2348,16 +2398,39 @@ static void* pdb_read_strings(const struct pdb_file_info* pdb_file)
     {
         ret = pdb_read_file( pdb_file, idx );
         if (ret && *(const DWORD *)ret == 0xeffeeffe) return ret;
-        pdb_free( ret );
+        pdb_free( pdb_file, ret );
     }
     WARN("string table not found\n");
     return NULL;
 }
 
+static void pdb_release_compilands(struct pdb_module_info* pdb_info)
+{
+    HeapFree(GetProcessHeap(), 0, pdb_info->compilands);
+    HeapFree(GetProcessHeap(), 0, pdb_info->ranges);
+    HeapFree(GetProcessHeap(), 0, (void*)pdb_info->msc_dbg.sectp);
+    HeapFree(GetProcessHeap(), 0, (void*)pdb_info->msc_dbg.omapp);
+    HeapFree(GetProcessHeap(), 0, pdb_info->basic_types);
+    HeapFree(GetProcessHeap(), 0, pdb_info->defined_types);
+    pdb_free(&pdb_info->pdb_files[0], pdb_info->globalimage);
+    pdb_free(&pdb_info->pdb_files[0], pdb_info->global_hash);
+    pdb_free(&pdb_info->pdb_files[0], pdb_info->files_image);
+    pdb_info->num_pending = pdb_info->num_compilands = pdb_info->num_ranges = 0;
+    pdb_info->compilands = NULL;
+    pdb_info->ranges = NULL;
+    pdb_info->msc_dbg.sectp = NULL;
+    pdb_info->msc_dbg.omapp = NULL;
+    pdb_info->basic_types = pdb_info->defined_types = NULL;
+    pdb_info->globalimage = NULL;
+    pdb_info->global_hash = NULL;
+    pdb_info->files_image = NULL;
+}
+
 static void pdb_module_remove(struct process* pcsn, struct module_format* modfmt)
 {
     unsigned    i;
 
+    pdb_release_compilands(modfmt->u.pdb_info);
     for (i = 0; i < modfmt->u.pdb_info->used_subfiles; i++)
     {
         pdb_free_file(&modfmt->u.pdb_info->pdb_files[i]);
@@ -2525,7 +2598,7 @@ static void pdb_process_types(const struct msc_debug_info* msc_dbg,
         /* Read type table */
         codeview_parse_type_table(&ctp);
         HeapFree(GetProcessHeap(), 0, offset);
-        pdb_free(types_image);
+        pdb_free(pdb_file, types_image);
     }
 }
 
@@ -2550,11 +2623,13 @@ static BOOL pdb_init(const struct pdb_lookup* pdb_lookup, struct pdb_file_info*
     TRACE("PDB(%s): %.40s\n", pdb_lookup->filename, debugstr_an(image, 40));
 
     *matched = 0;
+    pdb_file->image = image;
     if (!memcmp(image, PDB_JG_IDENT, sizeof(PDB_JG_IDENT)))
     {
         const struct PDB_JG_HEADER* pdb = (const struct PDB_JG_HEADER*)image;
         struct PDB_JG_ROOT*         root;
 
+        pdb_file->kind = PDB_JG;
         pdb_file->u.jg.toc = pdb_jg_read(pdb, pdb->toc_block, pdb->toc.size);
         root = pdb_read_jg_file(pdb, pdb_file->u.jg.toc, 1);
         if (!root)
@@ -2575,10 +2650,9 @@ static BOOL pdb_init(const struct pdb_lookup* pdb_lookup, struct pdb_file_info*
         if (pdb_lookup->kind != PDB_JG)
         {
             WARN("Found %s, but wrong PDB kind\n", pdb_lookup->filename);
-            pdb_free(root);
+            pdb_free(pdb_file, root);
             return FALSE;
         }
-        pdb_file->kind = PDB_JG;
         pdb_file->u.jg.timestamp = root->TimeDateStamp;
         pdb_file->age = root->Age;
         if (root->TimeDateStamp == pdb_lookup->timestamp) (*matched)++;
@@ -2591,13 +2665,14 @@ static BOOL pdb_init(const struct pdb_lookup* pdb_lookup, struct pdb_file_info*
               pdb_lookup->filename, root->Age, root->TimeDateStamp);
         pdb_load_stream_name_table(pdb_file, &root->names[0], root->cbNames);
 
-        pdb_free(root);
+        pdb_free(pdb_file, root);
     }
     else if (!memcmp(image, PDB_DS_IDENT, sizeof(PDB_DS_IDENT)))
     {
         const struct PDB_DS_HEADER* pdb = (const struct PDB_DS_HEADER*)image;
         struct PDB_DS_ROOT*         root;
 
+        pdb_file->kind = PDB_DS;
         pdb_file->u.ds.toc =
             pdb_ds_read(pdb, 
                         (const DWORD*)((const char*)pdb + pdb->toc_page * pdb->block_size), 
@@ -2615,7 +2690,6 @@ static BOOL pdb_init(const struct pdb_lookup* pdb_lookup, struct pdb_file_info*
         default:
             ERR("-Unknown root block version %d\n", root->Version);
         }
-        pdb_file->kind = PDB_DS;
         pdb_file->u.ds.guid = root->guid;
         pdb_file->age = root->Age;
         if (!memcmp(&root->guid, &pdb_lookup->guid, sizeof(GUID))) (*matched)++;
@@ -2629,7 +2703,7 @@ static BOOL pdb_init(const struct pdb_lookup* pdb_lookup, struct pdb_file_info*
               pdb_lookup->filename, root->Age, debugstr_guid(&root->guid));
         pdb_load_stream_name_table(pdb_file, &root->names[0], root->cbNames);
 
-        pdb_free(root);
+        pdb_free(pdb_file, root);
     }
 
     if (0) /* some tool to dump the internal files from a PDB file */
@@ -2648,7 +2722,7 @@ static BOOL pdb_init(const struct pdb_lookup* pdb_lookup, struct pdb_file_info*
             FIXME("********************** [%u]: size=%08x\n",
                   i, pdb_get_file_size(pdb_file, i));
             dump(x, pdb_get_file_size(pdb_file, i));
-            pdb_free(x);
+            pdb_free(pdb_file, x);
         }
     }
     return ret;
@@ -2723,6 +2797,349 @@ static void pdb_process_symbol_imports(const struct process* pcs,
     cv_current_module->allowed = TRUE;
 }
 
+static void pdb_process_compiland(const struct msc_debug_info* msc_dbg,
+                                  const struct pdb_file_info* pdb_file,
+                                  const struct pdb_compiland* compiland,
+                                  const char* files_image, DWORD files_size)
+{
+    BYTE*       modimage;
+
+    modimage = pdb_read_file(pdb_file, compiland->stream);
+    if (!modimage) return;
+
+    if (compiland->symbol_size)
+        codeview_snarf(msc_dbg, modimage, sizeof(DWORD), compiland->symbol_size, TRUE);
+
+    if (compiland->lineno_size && compiland->lineno2_size) FIXME("Both line info present... only supporting first\n");
+    if (compiland->lineno_size)
+        codeview_snarf_linetab(msc_dbg, modimage + compiland->symbol_size, compiland->lineno_size,
+                               pdb_file->kind == PDB_JG);
+    else if (compiland->lineno2_size && files_image)
+        codeview_snarf_linetab2(msc_dbg, modimage + compiland->symbol_size, compiland->lineno2_size,
+                                files_image + 12, files_size);
+
+    pdb_free(pdb_file, modimage);
+}
+
+static int __cdecl pdb_range_cmp(const void* p1, const void* p2)
+{
+    const struct pdb_compiland_range* r1 = p1;
+    const struct pdb_compiland_range* r2 = p2;
+
+    if (r1->low < r2->low) return -1;
+    if (r1->low > r2->low) return 1;
+    return 0;
+}
+
+/******************************************************************
+ *		pdb_load_compiland_ranges
+ *
+ * Builds the address => compiland map from the section contributions of the
+ * DBI stream, so that the compilands can be loaded when they're looked up.
+ */
+static BOOL pdb_load_compiland_ranges(struct pdb_module_info* pdb_info,
+                                      const struct msc_debug_info* msc_dbg,
+                                      const PDB_SYMBOLS* symbols, const BYTE* image)
+{
+    const BYTE*         ptr = image;
+    const BYTE*         end = image + symbols->offset_size;
+    unsigned            stride, count;
+    ULONG_PTR           low;
+
+    if (symbols->offset_size >= sizeof(DWORD) && *(const DWORD*)ptr == 0xeffe0000 + 19970605)
+    {
+        stride = sizeof(PDB_SYMBOL_RANGE_EX);
+        ptr += sizeof(DWORD);
+    }
+    else if (symbols->offset_size >= sizeof(DWORD) && *(const DWORD*)ptr == 0xeffe0000 + 20140516)
+    {
+        /* also contains the COFF section index */
+        stride = sizeof(PDB_SYMBOL_RANGE_EX) + sizeof(DWORD);
+        ptr += sizeof(DWORD);
+    }
+    else stride = symbols->version < 19970000 ? sizeof(PDB_SYMBOL_RANGE) : sizeof(PDB_SYMBOL_RANGE_EX);
+
+    if (!(count = (end - ptr) / stride)) return FALSE;
+    pdb_info->ranges = HeapAlloc(GetProcessHeap(), 0, count * sizeof(*pdb_info->ranges));
+    if (!pdb_info->ranges) return FALSE;
+
+    pdb_info->num_ranges = 0;
+    for (; ptr + stride <= end; ptr += stride)
+    {
+        /* PDB_SYMBOL_RANGE_EX starts as PDB_SYMBOL_RANGE */
+        const PDB_SYMBOL_RANGE* range = (const PDB_SYMBOL_RANGE*)ptr;
+
+        if (!range->size || !(low = codeview_get_address(msc_dbg, range->segment, range->offset)))
+            continue;
+        pdb_info->ranges[pdb_info->num_ranges].low = low;
+        pdb_info->ranges[pdb_info->num_ranges].high = low + range->size;
+        pdb_info->ranges[pdb_info->num_ranges].compiland = range->index;
+        pdb_info->num_ranges++;
+    }
+    if (!pdb_info->num_ranges)
+    {
+        HeapFree(GetProcessHeap(), 0, pdb_info->ranges);
+        pdb_info->ranges = NULL;
+        return FALSE;
+    }
+    qsort(pdb_info->ranges, pdb_info->num_ranges, sizeof(*pdb_info->ranges), pdb_range_cmp);
+    return TRUE;
+}
+
+static BOOL pdb_add_compiland(struct pdb_module_info* pdb_info, const PDB_SYMBOL_FILE_EX* sfile)
+{
+    struct pdb_compiland*       compiland;
+
+    if (!(pdb_info->num_compilands & (pdb_info->num_compilands - 1)))
+    {
+        unsigned num = pdb_info->num_compilands ? pdb_info->num_compilands * 2 : 64;
+
+        if (pdb_info->compilands)
+            compiland = HeapReAlloc(GetProcessHeap(), 0, pdb_info->compilands, num * sizeof(*compiland));
+        else
+            compiland = HeapAlloc(GetProcessHeap(), 0, num * sizeof(*compiland));
+        if (!compiland) return FALSE;
+        pdb_info->compilands = compiland;
+    }
+    compiland = &pdb_info->compilands[pdb_info->num_compilands++];
+    compiland->stream       = sfile->file;
+    compiland->loaded       = FALSE;
+    compiland->symbol_size  = sfile->symbol_size;
+    compiland->lineno_size  = sfile->lineno_size;
+    compiland->lineno2_size = sfile->lineno2_size;
+    pdb_info->num_pending++;
+    return TRUE;
+}
+
+/******************************************************************
+ *		pdb_defer_compilands
+ *
+ * Keeps what's needed to load the compilands later on: the type tables built
+ * so far, the mapped global symbols and the section layout of the image.
+ */
+static BOOL pdb_defer_compilands(struct pdb_module_info* pdb_info, const struct msc_debug_info* msc_dbg)
+{
+    IMAGE_SECTION_HEADER*       sectp;
+    OMAP*                       omapp;
+
+    pdb_info->msc_dbg = *msc_dbg;
+    pdb_info->msc_dbg.sectp = NULL;
+    pdb_info->msc_dbg.omapp = NULL;
+    pdb_info->msc_dbg.root = NULL;
+
+    if (!(pdb_info->basic_types = HeapAlloc(GetProcessHeap(), 0, sizeof(cv_basic_types))))
+        return FALSE;
+    memcpy(pdb_info->basic_types, cv_basic_types, sizeof(cv_basic_types));
+    if (!(sectp = HeapAlloc(GetProcessHeap(), 0, msc_dbg->nsect * sizeof(*sectp))))
+        return FALSE;
+    memcpy(sectp, msc_dbg->sectp, msc_dbg->nsect * sizeof(*sectp));
+    pdb_info->msc_dbg.sectp = sectp;
+    if (msc_dbg->nomap)
+    {
+        if (!(omapp = HeapAlloc(GetProcessHeap(), 0, msc_dbg->nomap * sizeof(*omapp))))
+            return FALSE;
+        memcpy(omapp, msc_dbg->omapp, msc_dbg->nomap * sizeof(*omapp));
+        pdb_info->msc_dbg.omapp = omapp;
+    }
+
+    /* take ownership of the module's type table */
+    pdb_info->num_defined_types = cv_current_module->num_defined_types;
+    pdb_info->defined_types = cv_current_module->defined_types;
+    cv_current_module->num_defined_types = 0;
+    cv_current_module->defined_types = NULL;
+    return TRUE;
+}
+
+/* load right away the compilands which were meant to be deferred */
+static void pdb_undefer_compilands(const struct msc_debug_info* msc_dbg,
+                                   struct pdb_module_info* pdb_info,
+                                   const char* files_image, DWORD files_size)
+{
+    unsigned    i;
+
+    for (i = 0; i < pdb_info->num_compilands; i++)
+        pdb_process_compiland(msc_dbg, &pdb_info->pdb_files[0], &pdb_info->compilands[i],
+                              files_image, files_size);
+    pdb_release_compilands(pdb_info);
+}
+
+static void pdb_load_compiland(struct pdb_module_info* pdb_info, unsigned index)
+{
+    struct pdb_compiland*       compiland;
+
+    if (index >= pdb_info->num_compilands) return;
+    compiland = &pdb_info->compilands[index];
+    if (compiland->loaded) return;
+    compiland->loaded = TRUE;
+    pdb_info->num_pending--;
+
+    memcpy(cv_basic_types, pdb_info->basic_types, sizeof(cv_basic_types));
+    cv_zmodules[0].allowed = TRUE;
+    cv_zmodules[0].num_defined_types = pdb_info->num_defined_types;
+    cv_zmodules[0].defined_types = pdb_info->defined_types;
+    cv_current_module = &cv_zmodules[0];
+
+    pdb_process_compiland(&pdb_info->msc_dbg, &pdb_info->pdb_files[0], compiland,
+                          pdb_info->files_image, pdb_info->files_size);
+
+    memset(&cv_zmodules[0], 0, sizeof(cv_zmodules[0]));
+    cv_current_module = NULL;
+}
+
+static void pdb_request_address(struct pdb_module_info* pdb_info, ULONG_PTR addr)
+{
+    int low = 0, high = pdb_info->num_ranges - 1, mid;
+
+    while (low <= high)
+    {
+        mid = (low + high) / 2;
+        if (addr < pdb_info->ranges[mid].low) high = mid - 1;
+        else if (addr >= pdb_info->ranges[mid].high) low = mid + 1;
+        else
+        {
+            pdb_load_compiland(pdb_info, pdb_info->ranges[mid].compiland);
+            return;
+        }
+    }
+}
+
+/* hash of the names in the global symbols hash table (same as the PDB writers) */
+static unsigned pdb_hash_name(const char* name)
+{
+    const BYTE* ptr = (const BYTE*)name;
+    unsigned    len = strlen(name), hash = 0;
+
+    for (; len >= 4; len -= 4, ptr += 4)
+        hash ^= ptr[0] | (ptr[1] << 8) | (ptr[2] << 16) | ((unsigned)ptr[3] << 24);
+    if (len >= 2)
+    {
+        hash ^= ptr[0] | (ptr[1] << 8);
+        len -= 2;
+        ptr += 2;
+    }
+    if (len) hash ^= *ptr;
+    hash |= 0x20202020;
+    hash ^= hash >> 11;
+    return (hash ^ (hash >> 16)) % PDB_GSI_HASH_BUCKETS;
+}
+
+static unsigned pdb_count_bits(DWORD bits)
+{
+    unsigned    count = 0;
+
+    for (; bits; bits &= bits - 1) count++;
+    return count;
+}
+
+/* load the compiland of the function reference at offset, if it has the given name */
+static void pdb_load_procref(struct pdb_module_info* pdb_info, unsigned offset, const char* name)
+{
+    const union codeview_symbol* sym;
+
+    if (pdb_info->global_size < 4 || offset > pdb_info->global_size - 4) return;
+    sym = (const union codeview_symbol*)(pdb_info->globalimage + offset);
+    if (sym->generic.len + 2 > pdb_info->global_size - offset) return;
+    if ((sym->generic.id == S_PROCREF || sym->generic.id == S_LPROCREF) &&
+        sym->refsym2_v3.imod && !strcmp(sym->refsym2_v3.name, name))
+        pdb_load_compiland(pdb_info, sym->refsym2_v3.imod - 1);
+}
+
+/******************************************************************
+ *		pdb_request_name_hash
+ *
+ * Looks the name up in the hash table of the global symbols, which only
+ * stores the buckets whose bit is set in the leading bitmap.
+ * Returns FALSE when the table is missing or can't be used.
+ */
+static BOOL pdb_request_name_hash(struct pdb_module_info* pdb_info, const char* name)
+{
+    const PDB_GSI_HASH_HEADER*  hdr = (const PDB_GSI_HASH_HEADER*)pdb_info->global_hash;
+    const PDB_GSI_HASH_RECORD*  records;
+    const DWORD*                bitmap;
+    const DWORD*                buckets;
+    const unsigned              bitmap_size = (PDB_GSI_HASH_BUCKETS + 1 + 31) / 32 * sizeof(DWORD);
+    unsigned                    num_records, num_buckets, bucket, index, start, end, i;
+
+    if (!hdr || pdb_info->global_hash_size < sizeof(*hdr) || hdr->signature != 0xffffffff ||
+        hdr->version != 0xeffe0000 + 19990810 ||
+        hdr->hash_records_size > pdb_info->global_hash_size - sizeof(*hdr) ||
+        hdr->buckets_size > pdb_info->global_hash_size - sizeof(*hdr) - hdr->hash_records_size ||
+        hdr->buckets_size < bitmap_size)
+        return FALSE;
+
+    records = (const PDB_GSI_HASH_RECORD*)(hdr + 1);
+    num_records = hdr->hash_records_size / sizeof(*records);
+    bitmap = (const DWORD*)((const BYTE*)records + hdr->hash_records_size);
+    buckets = (const DWORD*)((const BYTE*)bitmap + bitmap_size);
+    num_buckets = (hdr->buckets_size - bitmap_size) / sizeof(DWORD);
+
+    bucket = pdb_hash_name(name);
+    if (!(bitmap[bucket / 32] & (1u << (bucket % 32)))) return TRUE;
+    for (index = i = 0; i < bucket / 32; i++) index += pdb_count_bits(bitmap[i]);
+    index += pdb_count_bits(bitmap[bucket / 32] & ((1u << (bucket % 32)) - 1));
+    if (index >= num_buckets) return FALSE;
+
+    /* bucket offsets are counted in the writer's in-memory records of 12 bytes */
+    start = buckets[index] / 12;
+    end = index + 1 < num_buckets ? buckets[index + 1] / 12 : num_records;
+    if (start > end || end > num_records) return FALSE;
+    for (i = start; i < end; i++)
+        if (records[i].offset) pdb_load_procref(pdb_info, records[i].offset - 1, name);
+    return TRUE;
+}
+
+/* load the compilands defining a function of the given name, as found from the
+ * references of the global symbols stream
+ */
+static void pdb_request_name(struct pdb_module_info* pdb_info, const char* name)
+{
+    const union codeview_symbol* sym;
+    unsigned    i, length;
+
+    if (pdb_request_name_hash(pdb_info, name)) return;
+
+    for (i = 0; i < pdb_info->global_size; i += length)
+    {
+        sym = (const union codeview_symbol*)(pdb_info->globalimage + i);
+        length = sym->generic.len + 2;
+        if (i + length > pdb_info->global_size || !sym->generic.id || length < 4) break;
+        if ((sym->generic.id == S_PROCREF || sym->generic.id == S_LPROCREF) &&
+            sym->refsym2_v3.imod && !strcmp(sym->refsym2_v3.name, name))
+            pdb_load_compiland(pdb_info, sym->refsym2_v3.imod - 1);
+    }
+}
+
+static void pdb_module_request(struct module_format* modfmt, DWORD64 addr, const char* name)
+{
+    struct pdb_module_info*     pdb_info = modfmt->u.pdb_info;
+    unsigned                    i;
+
+    if (!pdb_info->num_pending) return;
+    __TRY
+    {
+        if (addr)
+            pdb_request_address(pdb_info, addr);
+        else if (name && !strpbrk(name, "*?[") && pdb_info->globalimage)
+            pdb_request_name(pdb_info, name);
+        else
+        {
+            TRACE("Loading all compilands for %s\n", debugstr_w(modfmt->module->modulename));
+            for (i = 0; i < pdb_info->num_compilands; i++)
+                pdb_load_compiland(pdb_info, i);
+        }
+    }
+    __EXCEPT_PAGE_FAULT
+    {
+        ERR("Got a page fault while loading symbols\n");
+        memset(&cv_zmodules[0], 0, sizeof(cv_zmodules[0]));
+        cv_current_module = NULL;
+        pdb_info->num_pending = 0;
+    }
+    __ENDTRY
+    /* nothing is left to load */
+    if (!pdb_info->num_pending) pdb_release_compilands(pdb_info);
+}
+
 static BOOL pdb_process_internal(const struct process* pcs, 
                                  const struct msc_debug_info* msc_dbg,
                                  const struct pdb_lookup* pdb_lookup,
@@ -2735,6 +3152,7 @@ static BOOL pdb_process_internal(const struct process* pcs,
     char*       files_image = NULL;
     DWORD       files_size = 0;
     unsigned    matched;
+    BOOL        deferred = FALSE;
     struct pdb_file_info* pdb_file;
 
     TRACE("Processing PDB file %s\n", pdb_lookup->filename);
@@ -2750,6 +3168,7 @@ static BOOL pdb_process_internal(const struct process* pcs,
     }
     if (!pdb_init(pdb_lookup, pdb_file, image, &matched) || matched != 2)
     {
+        pdb_file->image = NULL;
         CloseHandle(hMap);
         UnmapViewOfFile(image);
         return FALSE;
@@ -2762,7 +3181,6 @@ static BOOL pdb_process_internal(const struct process* pcs,
     {
         PDB_SYMBOLS symbols;
         BYTE*       globalimage;
-        BYTE*       modimage;
         BYTE*       file;
         int         header_size = 0;
         PDB_STREAM_INDEXES* psi;
@@ -2804,6 +3222,13 @@ static BOOL pdb_process_internal(const struct process* pcs,
                                    pdb_lookup, pdb_module_info, module_index);
         pdb_process_types(msc_dbg, pdb_file);
 
+        /* Only a single PDB file's compilands can be loaded later on. The other
+         * ones would need the type tables of all the imported files to be kept.
+         */
+        if (module_index == -1 && pdb_module_info->used_subfiles == 1)
+            deferred = pdb_load_compiland_ranges(pdb_module_info, msc_dbg, &symbols,
+                                                 symbols_image + header_size + symbols.module_size);
+
         /* Read global symbol table */
         globalimage = pdb_read_file(pdb_file, symbols.gsym_file);
         if (globalimage)
@@ -2820,27 +3245,19 @@ static BOOL pdb_process_internal(const struct process* pcs,
             const char*                 file_name;
             unsigned                    size;
 
-            HeapValidate(GetProcessHeap(), 0, NULL);
             pdb_convert_symbol_file(&symbols, &sfile, &size, file);
 
-            modimage = pdb_read_file(pdb_file, sfile.file);
-            if (modimage)
+            if (deferred && !(deferred = pdb_add_compiland(pdb_module_info, &sfile)))
+                pdb_undefer_compilands(msc_dbg, pdb_module_info, files_image, files_size);
+            if (!deferred)
             {
-                if (sfile.symbol_size)
-                    codeview_snarf(msc_dbg, modimage, sizeof(DWORD),
-                                   sfile.symbol_size, TRUE);
-
-                if (sfile.lineno_size && sfile.lineno2_size) FIXME("Both line info present... only supporting first\n");
-                if (sfile.lineno_size)
-                    codeview_snarf_linetab(msc_dbg,
-                                           modimage + sfile.symbol_size,
-                                           sfile.lineno_size,
-                                           pdb_file->kind == PDB_JG);
-                else if (sfile.lineno2_size && files_image)
-                    codeview_snarf_linetab2(msc_dbg, modimage + sfile.symbol_size, sfile.lineno2_size,
-                                   files_image + 12, files_size);
-
-                pdb_free(modimage);
+                struct pdb_compiland    compiland;
+
+                compiland.stream       = sfile.file;
+                compiland.symbol_size  = sfile.symbol_size;
+                compiland.lineno_size  = sfile.lineno_size;
+                compiland.lineno2_size = sfile.lineno2_size;
+                pdb_process_compiland(msc_dbg, pdb_file, &compiland, files_image, files_size);
             }
             file_name = (const char*)file + size;
             file_name += strlen(file_name) + 1;
@@ -2848,18 +3265,40 @@ static BOOL pdb_process_internal(const struct process* pcs,
         }
         /* finish the remaining public and global information */
         if (globalimage)
-        {
             codeview_snarf_public(msc_dbg, globalimage, 0,
                                   pdb_get_file_size(pdb_file, symbols.gsym_file));
-            pdb_free(globalimage);
+
+        if (deferred && !pdb_module_info->num_pending)
+        {
+            pdb_release_compilands(pdb_module_info);
+            deferred = FALSE;
+        }
+        if (deferred && !pdb_defer_compilands(pdb_module_info, msc_dbg))
+        {
+            pdb_undefer_compilands(msc_dbg, pdb_module_info, files_image, files_size);
+            deferred = FALSE;
+        }
+        if (deferred)
+        {
+            TRACE("Deferring %u compilands\n", pdb_module_info->num_pending);
+            pdb_module_info->globalimage = globalimage;
+            pdb_module_info->global_size = globalimage ? pdb_get_file_size(pdb_file, symbols.gsym_file) : 0;
+            if (globalimage && (pdb_module_info->global_hash = pdb_read_file(pdb_file, symbols.global_file)))
+                pdb_module_info->global_hash_size = pdb_get_file_size(pdb_file, symbols.global_file);
+            pdb_module_info->files_image = files_image;
+            pdb_module_info->files_size = files_size;
+            msc_dbg->module->format_info[DFI_PDB]->request = pdb_module_request;
+            globalimage = NULL;
+            files_image = NULL;
         }
+        pdb_free(pdb_file, globalimage);
     }
     else
         pdb_process_symbol_imports(pcs, msc_dbg, NULL, NULL, image,
                                    pdb_lookup, pdb_module_info, module_index);
 
-    pdb_free(symbols_image);
-    pdb_free(files_image);
+    pdb_free(pdb_file, symbols_image);
+    pdb_free(pdb_file, files_image);
 
     return TRUE;
 }
@@ -2872,7 +3311,7 @@ static BOOL pdb_process_file(const struct process* pcs,
     struct module_format*       modfmt;
     struct pdb_module_info*     pdb_module_info;
 
-    modfmt = HeapAlloc(GetProcessHeap(), 0,
+    modfmt = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY,
                        sizeof(struct module_format) + sizeof(struct pdb_module_info));
     if (!modfmt) return FALSE;
 
@@ -2881,6 +3320,7 @@ static BOOL pdb_process_file(const struct process* pcs,
     modfmt->module      = msc_dbg->module;
     modfmt->remove      = pdb_module_remove;
     modfmt->loc_compute = NULL;
+    modfmt->request     = NULL;
     modfmt->u.pdb_info  = pdb_module_info;
 
     memset(cv_zmodules, 0, sizeof(cv_zmodules));
@@ -3245,8 +3685,8 @@ BOOL pdb_virtual_unwind(struct cpu_stack_walk *csw, DWORD_PTR ip,
         }
     }
     else ret = FALSE;
-    pdb_free(fpoext);
-    pdb_free(strbase);
+    pdb_free(&pdb_info->pdb_files[0], fpoext);
+    pdb_free(&pdb_info->pdb_files[0], strbase);
 
     return ret;
 }
@@ -37,6 +37,14 @@ WINE_DECLARE_DEBUG_CHANNEL(dbghelp_symt);
 extern char * CDECL __unDName(char *buffer, const char *mangled, int len,
         void * (CDECL *pfn_alloc)(size_t), void (CDECL *pfn_free)(void *), unsigned short flags);
 
+#define ADDR_CACHE_SIZE 1024    /* must be a power of 2 */
+
+struct symt_addr_cache
+{
+    DWORD_PTR           addr;
+    struct symt_ht*     sym;
+};
+
 static inline int cmp_addr(ULONG64 a1, ULONG64 a2)
 {
     if (a1 > a2) return 1;
@@ -359,6 +367,78 @@ struct symt_function* symt_new_function(struct module* module,
     return sym;
 }
 
+/******************************************************************
+ *		symt_defer_symbol
+ *
+ * Keeps a symbol from the image's symbol table, whose address is covered by
+ * debug information not loaded yet. It's added once that information is
+ * loaded, unless the latter defines a symbol at the same address.
+ */
+void symt_defer_symbol(struct module* module, struct symt_compiland* compiland,
+                       const char* name, ULONG_PTR addr, ULONG_PTR size,
+                       BOOL is_code, BOOL is_static)
+{
+    struct deferred_symbol* ds;
+
+    if (!(ds = vector_add(&module->vdeferred_symt, &module->pool))) return;
+    ds->name      = pool_strdup(&module->pool, name);
+    ds->compiland = compiland;
+    ds->addr      = addr;
+    ds->size      = size;
+    ds->is_code   = is_code;
+    ds->is_static = is_static;
+    ds->added     = FALSE;
+    module->num_deferred_symt++;
+}
+
+/******************************************************************
+ *		symt_add_deferred_symbols
+ *
+ * Adds the deferred symbols whose debug information has been loaded since,
+ * and didn't define them.
+ */
+void symt_add_deferred_symbols(struct module* module)
+{
+    struct deferred_symbol* ds;
+    struct symt_ht*         symt;
+    struct location         loc;
+    ULONG64                 ref_addr;
+    unsigned                i, count = 0;
+
+    if (!module->num_deferred_symt) return;
+
+    /* first find the symbols to add, so that adding them doesn't resort
+     * the module's symbols for each lookup */
+    for (i = 0; i < vector_length(&module->vdeferred_symt); i++)
+    {
+        ds = vector_at(&module->vdeferred_symt, i);
+        if (ds->added || dwarf2_is_unit_pending(module, ds->addr)) continue;
+        module->num_deferred_symt--;
+        symt = symt_find_nearest(module, ds->addr);
+        if (symt && (!symt_get_address(&symt->symt, &ref_addr) || ref_addr == ds->addr))
+            ds->added = TRUE; /* defined by the debug information */
+        else
+            count++;
+    }
+    if (!count) return;
+
+    for (i = 0; i < vector_length(&module->vdeferred_symt); i++)
+    {
+        ds = vector_at(&module->vdeferred_symt, i);
+        if (ds->added || dwarf2_is_unit_pending(module, ds->addr)) continue;
+        ds->added = TRUE;
+        if (ds->is_code)
+            symt_new_function(module, ds->compiland, ds->name, ds->addr, ds->size, NULL);
+        else
+        {
+            loc.kind = loc_absolute;
+            loc.reg = 0;
+            loc.offset = ds->addr;
+            symt_new_global_variable(module, ds->compiland, ds->name, ds->is_static, loc, ds->size, NULL);
+        }
+    }
+}
+
 struct symt_inlinesite* symt_new_inlinesite(struct module* module,
                                             struct symt_function* func,
                                             struct symt* container,
@@ -916,6 +996,7 @@ static BOOL symt_enum_module(struct module_pair* pair, const WCHAR* match,
     WCHAR*                      nameW;
     BOOL                        ret;
 
+    module_request_all(pair->effective);
     hash_table_iter_init(&pair->effective->ht_symbols, &hti, NULL);
     while ((ptr = hash_table_iter_up(&hti)))
     {
@@ -1006,6 +1087,8 @@ static BOOL resort_symbols(struct module* module)
         }
     }
     module->num_sorttab = module->num_symbols;
+    if (module->addr_cache)
+        memset(module->addr_cache, 0, ADDR_CACHE_SIZE * sizeof(*module->addr_cache));
     return module->sortlist_valid = TRUE;
 }
 
@@ -1048,17 +1131,43 @@ static int symt_get_best_at(struct module* module, int idx_sorttab)
     return idx_sorttab;
 }
 
+/* checks whether idx is the index the binary search would find for addr */
+static BOOL symt_is_nearest_index(struct module* module, unsigned idx, ULONG64 addr)
+{
+    int         cmp;
+
+    if (idx >= module->num_sorttab) return FALSE;
+    if ((cmp = cmp_sorttab_addr(module, idx, addr)) > 0) return FALSE;
+    if (!cmp) return !idx || cmp_sorttab_addr(module, idx - 1, addr) < 0;
+    return idx + 1 == module->num_sorttab || cmp_sorttab_addr(module, idx + 1, addr) > 0;
+}
+
+static inline unsigned addr_cache_hash(DWORD_PTR addr)
+{
+    return (addr ^ (addr >> 10)) & (ADDR_CACHE_SIZE - 1);
+}
+
 /* assume addr is in module */
 struct symt_ht* symt_find_nearest(struct module* module, DWORD_PTR addr)
 {
     int         mid, high, low;
     ULONG64     ref_addr, ref_size;
+    struct symt_addr_cache* entry = NULL;
 
     if (!module->sortlist_valid || !module->addr_sorttab)
     {
         if (!resort_symbols(module)) return NULL;
     }
 
+    /* profilers look up the same addresses over and over */
+    if (module->addr_cache ||
+        (module->addr_cache = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY,
+                                        ADDR_CACHE_SIZE * sizeof(*module->addr_cache))))
+    {
+        entry = &module->addr_cache[addr_cache_hash(addr)];
+        if (entry->sym && entry->addr == addr) return entry->sym;
+    }
+
     /*
      * Binary search to find closest symbol.
      */
@@ -1074,24 +1183,40 @@ struct symt_ht* symt_find_nearest(struct module* module, DWORD_PTR addr)
         symt_get_length(module, &module->addr_sorttab[high - 1]->symt, &ref_size);
         if (addr >= ref_addr + ref_size) return NULL;
     }
-    
-    while (high > low + 1)
+
+    /* consecutive lookups often fall in the same symbol, or in the next one when
+     * the addresses are walked in increasing order
+     */
+    if (symt_is_nearest_index(module, module->sorttab_hint, addr))
+        low = module->sorttab_hint;
+    else if (symt_is_nearest_index(module, module->sorttab_hint + 1, addr))
+        low = module->sorttab_hint + 1;
+    else
     {
-        mid = (high + low) / 2;
-        if (cmp_sorttab_addr(module, mid, addr) < 0)
-            low = mid;
-        else
-            high = mid;
+        while (high > low + 1)
+        {
+            mid = (high + low) / 2;
+            if (cmp_sorttab_addr(module, mid, addr) < 0)
+                low = mid;
+            else
+                high = mid;
+        }
+        if (low != high && high != module->num_sorttab &&
+            cmp_sorttab_addr(module, high, addr) <= 0)
+            low = high;
     }
-    if (low != high && high != module->num_sorttab &&
-        cmp_sorttab_addr(module, high, addr) <= 0)
-        low = high;
+    module->sorttab_hint = low;
 
     /* If found symbol is a public symbol, check if there are any other entries that
      * might also have the same address, but would get better information
      */
     low = symt_get_best_at(module, low);
 
+    if (entry)
+    {
+        entry->addr = addr;
+        entry->sym  = module->addr_sorttab[low];
+    }
     return module->addr_sorttab[low];
 }
 
@@ -1609,6 +1734,7 @@ static BOOL find_name(struct process* pcs, struct module* module, const char* na
     pair.pcs = pcs;
     if (!(pair.requested = module)) return FALSE;
     if (!module_get_debug(&pair)) return FALSE;
+    module_request_name(pair.effective, name);
 
     hash_table_iter_init(&pair.effective->ht_symbols, &hti, name);
     while ((ptr = hash_table_iter_up(&hti)))
@@ -2522,6 +2648,7 @@ BOOL WINAPI SymEnumLines(HANDLE hProcess, ULONG64 base, PCSTR compiland,
     if (!(dbghelp_options & SYMOPT_LOAD_LINES)) return TRUE;
 
     if (!module_init_pair(&pair, hProcess, base)) return FALSE;
+    module_request_all(pair.effective);
     if (compiland) FIXME("Unsupported yet (filtering on compiland %s)\n", compiland);
     if (!(srcmask = file_regex(srcfile))) return FALSE;
 
@@ -2707,6 +2834,7 @@ static BOOL get_line_from_inline_context(HANDLE hProcess, DWORD64 addr, ULONG in
     struct symt_inlinesite* inlined;
 
     if (!module_init_pair(&pair, hProcess, mod_addr ? mod_addr : addr)) return FALSE;
+    if (mod_addr) module_request_address(pair.effective, addr);
     switch (IFC_MODE(inline_ctx))
     {
     case IFC_MODE_INLINE:
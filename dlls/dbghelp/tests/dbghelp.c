@@ -16,9 +16,11 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
  */
 
+#include <stdio.h>
 #include "windef.h"
 #include "verrsrc.h"
 #include "dbghelp.h"
+#include "wine/mscvpdb.h"
 #include "wine/test.h"
 
 #if defined(__i386__) || defined(__x86_64__)
@@ -132,13 +134,664 @@ static void test_stack_walk(void)
 
 #endif /* __i386__ || __x86_64__ */
 
+static BOOL start_child(const char *args, PROCESS_INFORMATION *pi)
+{
+    STARTUPINFOA si = {sizeof(si)};
+    char cmdline[MAX_PATH + 64], **argv;
+    BOOL ret;
+
+    winetest_get_mainargs(&argv);
+    sprintf(cmdline, "\"%s\" dbghelp %s", argv[0], args);
+    ret = CreateProcessA(NULL, cmdline, NULL, NULL, FALSE, 0, NULL, NULL, &si, pi);
+    ok(ret, "CreateProcess error %u\n", GetLastError());
+    return ret;
+}
+
+static LARGE_INTEGER perf_freq;
+
+static LONGLONG get_time(void)
+{
+    LARGE_INTEGER counter;
+
+    QueryPerformanceCounter(&counter);
+    return counter.QuadPart;
+}
+
+/* in seconds */
+static double elapsed(LONGLONG start, LONGLONG end)
+{
+    return (double)(end - start) / perf_freq.QuadPart;
+}
+
+static BOOL CALLBACK count_symbols_cb(SYMBOL_INFO *si, ULONG size, void *user)
+{
+    ++*(unsigned int *)user;
+    return TRUE;
+}
+
+/* use another handle, so that the modules' debug information isn't loaded yet */
+static HANDLE init_sym_process(BOOL invade)
+{
+    HANDLE process;
+    BOOL ret;
+
+    ret = DuplicateHandle(GetCurrentProcess(), GetCurrentProcess(), GetCurrentProcess(), &process,
+                          0, FALSE, DUPLICATE_SAME_ACCESS);
+    ok(ret, "DuplicateHandle failed: %u\n", GetLastError());
+    ret = SymInitialize(process, NULL, invade);
+    ok(ret, "SymInitialize failed: %u\n", GetLastError());
+    return process;
+}
+
+static void cleanup_sym_process(HANDLE process)
+{
+    BOOL ret;
+
+    ret = SymCleanup(process);
+    ok(ret, "SymCleanup failed: %u\n", GetLastError());
+    CloseHandle(process);
+}
+
+/* symbols found when the debug information is loaded on demand must be the
+ * same as when it's all loaded first */
+static void test_lazy_symbols(void)
+{
+    char lazy_buf[sizeof(SYMBOL_INFO) + 200], eager_buf[sizeof(SYMBOL_INFO) + 200];
+    SYMBOL_INFO *lazy = (SYMBOL_INFO *)lazy_buf, *eager = (SYMBOL_INFO *)eager_buf;
+    DWORD64 addrs[5], lazy_disp, eager_disp;
+    HANDLE lazy_process, eager_process;
+    unsigned int i, symbols;
+    BOOL lazy_ret, eager_ret;
+    DWORD options;
+
+    /* a global variable and a function outside of this file's unit, a function
+     * of this unit, an assembly thunk, and another module */
+    addrs[0] = (DWORD_PTR)&winetest_interactive;
+    addrs[1] = (DWORD_PTR)winetest_get_mainargs;
+    addrs[2] = (DWORD_PTR)test_lazy_symbols;
+    addrs[3] = (DWORD_PTR)GetProcAddress(GetModuleHandleA("ntdll.dll"), "NtClose");
+    addrs[4] = (DWORD_PTR)GetProcAddress(GetModuleHandleA("kernel32.dll"), "CreateFileA");
+
+    options = SymGetOptions();
+    SymSetOptions(options | SYMOPT_DEFERRED_LOADS);
+    lazy_process = init_sym_process(TRUE);
+    eager_process = init_sym_process(TRUE);
+
+    for (i = 0; i < ARRAY_SIZE(addrs); i++)
+    {
+        winetest_push_context("address %u", i);
+
+        lazy->SizeOfStruct = sizeof(SYMBOL_INFO);
+        lazy->MaxNameLen = 200;
+        lazy_ret = SymFromAddr(lazy_process, addrs[i], &lazy_disp, lazy);
+
+        symbols = 0;
+        SymEnumSymbols(eager_process, SymGetModuleBase64(eager_process, addrs[i]), "*",
+                       count_symbols_cb, &symbols);
+        eager->SizeOfStruct = sizeof(SYMBOL_INFO);
+        eager->MaxNameLen = 200;
+        eager_ret = SymFromAddr(eager_process, addrs[i], &eager_disp, eager);
+
+        ok(lazy_ret == eager_ret, "got %d, expected %d\n", lazy_ret, eager_ret);
+        if (lazy_ret && eager_ret)
+        {
+            ok(!strcmp(lazy->Name, eager->Name), "got %s, expected %s\n", lazy->Name, eager->Name);
+            ok(lazy_disp == eager_disp, "got displacement %s, expected %s\n",
+               wine_dbgstr_longlong(lazy_disp), wine_dbgstr_longlong(eager_disp));
+            ok(lazy->Address == eager->Address, "got address %s, expected %s\n",
+               wine_dbgstr_longlong(lazy->Address), wine_dbgstr_longlong(eager->Address));
+        }
+        winetest_pop_context();
+    }
+    cleanup_sym_process(lazy_process);
+
+    /* and by name, before anything of the variable's unit is loaded */
+    lazy_process = init_sym_process(TRUE);
+    lazy->SizeOfStruct = sizeof(SYMBOL_INFO);
+    lazy->MaxNameLen = 200;
+    lazy_ret = SymFromName(lazy_process, "winetest_interactive", lazy);
+    eager->SizeOfStruct = sizeof(SYMBOL_INFO);
+    eager->MaxNameLen = 200;
+    eager_ret = SymFromName(eager_process, "winetest_interactive", eager);
+    ok(lazy_ret == eager_ret, "got %d, expected %d\n", lazy_ret, eager_ret);
+    if (lazy_ret && eager_ret)
+        ok(lazy->Address == eager->Address, "got address %s, expected %s\n",
+           wine_dbgstr_longlong(lazy->Address), wine_dbgstr_longlong(eager->Address));
+
+    cleanup_sym_process(eager_process);
+    cleanup_sym_process(lazy_process);
+    SymSetOptions(options);
+}
+
+/* a minimal PDB, whose functions are only known from the global symbols'
+ * references until their compiland is loaded */
+#define FIXTURE_BLOCK_SIZE  0x400
+#define FIXTURE_STREAMS     8
+
+static const GUID fixture_guid = {0x1b2c3d4e, 0x5f60, 0x4172, {0x83, 0x94, 0xa5, 0xb6, 0xc7, 0xd8, 0xe9, 0xfa}};
+
+static const struct
+{
+    const char *name;
+    DWORD offset, size;
+    unsigned int bucket;    /* of the name in the global symbols hash table */
+}
+fixture_funcs[] =
+{
+    {"fixture_func2", 0x40, 0x30, 2164},
+    {"fixture_func1", 0x10, 0x20, 2167},
+};
+
+/* terminates the symbol record after its name, padded to 4 bytes */
+static BYTE *end_symbol(union codeview_symbol *sym, const char *name)
+{
+    BYTE *end = (BYTE *)name + strlen(name) + 1;
+
+    end = (BYTE *)sym + (((end - (BYTE *)sym) + 3) & ~3);
+    sym->generic.len = end - (BYTE *)sym - 2;
+    return end;
+}
+
+static void write_file(const char *path, const void *data, DWORD size)
+{
+    DWORD written;
+    HANDLE file;
+
+    file = CreateFileA(path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    ok(file != INVALID_HANDLE_VALUE, "CreateFile failed: %u\n", GetLastError());
+    WriteFile(file, data, size, &written, NULL);
+    ok(written == size, "wrote %u bytes\n", written);
+    CloseHandle(file);
+}
+
+/* only the streams needed to find the functions: 1 (root), 3 (DBI), 4 (hash table
+ * of the global symbols), 5 (global symbols) and a compiland per function */
+static void write_fixture_pdb(const char *path)
+{
+    static const char ident[] = "Microsoft C/C++ MSF 7.00\r\n\032DS\0";
+    BYTE *image, *stream[FIXTURE_STREAMS], *ptr;
+    DWORD size[FIXTURE_STREAMS] = {0}, *toc, *bitmap, *offsets;
+    struct PDB_DS_HEADER *header;
+    struct PDB_DS_ROOT *root;
+    PDB_SYMBOLS *symbols;
+    PDB_SYMBOL_FILE_EX *sfile;
+    PDB_SYMBOL_RANGE_EX *range;
+    PDB_GSI_HASH_HEADER *hash;
+    PDB_GSI_HASH_RECORD *record;
+    union codeview_symbol *sym;
+    unsigned int i, count, procref;
+
+    /* block 0 is the header, 1 the list of the TOC blocks, 2 the TOC, then a block per stream */
+    image = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, (3 + FIXTURE_STREAMS) * FIXTURE_BLOCK_SIZE);
+    for (i = 0; i < FIXTURE_STREAMS; i++) stream[i] = image + (3 + i) * FIXTURE_BLOCK_SIZE;
+
+    root = (struct PDB_DS_ROOT *)stream[1];
+    root->Version = 20000404;
+    root->TimeDateStamp = 0x12345678;
+    root->Age = 1;
+    root->guid = fixture_guid;
+    /* empty stream names table: counts and bitfields */
+    size[1] = FIELD_OFFSET(struct PDB_DS_ROOT, names) + 4 * sizeof(DWORD);
+
+    symbols = (PDB_SYMBOLS *)stream[3];
+    symbols->signature = 0xffffffff;
+    symbols->version = 19990903;
+    symbols->age = 1;
+    symbols->global_file = 4;
+    symbols->public_file = 0xffff;
+    symbols->gsym_file = 5;
+    ptr = (BYTE *)(symbols + 1);
+    hash = (PDB_GSI_HASH_HEADER *)stream[4];
+    record = (PDB_GSI_HASH_RECORD *)(hash + 1);
+    bitmap = (DWORD *)(record + ARRAY_SIZE(fixture_funcs));
+    offsets = bitmap + (PDB_GSI_HASH_BUCKETS + 1 + 31) / 32;
+    for (i = 0; i < ARRAY_SIZE(fixture_funcs); i++)
+    {
+        /* the compiland, with its object name and the function's definition */
+        *(DWORD *)stream[6 + i] = 4;
+        sym = (union codeview_symbol *)(stream[6 + i] + sizeof(DWORD));
+        sym->objname_v3.id = S_OBJNAME;
+        sprintf(sym->objname_v3.name, "fixture%u.obj", i);
+        sym = (union codeview_symbol *)end_symbol(sym, sym->objname_v3.name);
+        procref = (BYTE *)sym - stream[6 + i];
+        sym->proc_v3.id = S_GPROC32;
+        sym->proc_v3.proc_len = fixture_funcs[i].size;
+        sym->proc_v3.offset = fixture_funcs[i].offset;
+        sym->proc_v3.segment = 1;
+        strcpy(sym->proc_v3.name, fixture_funcs[i].name);
+        sym = (union codeview_symbol *)end_symbol(sym, sym->proc_v3.name);
+        sym->generic.len = 2;
+        sym->generic.id = S_END;
+        size[6 + i] = (BYTE *)sym + 4 - stream[6 + i];
+
+        /* its module entry */
+        sfile = (PDB_SYMBOL_FILE_EX *)ptr;
+        sfile->range.segment = 1;
+        sfile->range.offset = fixture_funcs[i].offset;
+        sfile->range.size = fixture_funcs[i].size;
+        sfile->range.index = i;
+        sfile->file = 6 + i;
+        sfile->symbol_size = size[6 + i];
+        ptr += FIELD_OFFSET(PDB_SYMBOL_FILE_EX, filename);
+        ptr += sprintf((char *)ptr, "fixture%u.obj", i) + 1;
+        ptr += sprintf((char *)ptr, "fixture%u.obj", i) + 1;
+        ptr = stream[3] + ((ptr - stream[3] + 3) & ~3);
+
+        /* the global reference to it; the functions are sorted by bucket, as the records */
+        record[i].offset = size[5] + 1;
+        record[i].refcount = 1;
+        bitmap[fixture_funcs[i].bucket / 32] |= 1u << (fixture_funcs[i].bucket % 32);
+        /* in units of the 12 bytes records of the writer */
+        offsets[i] = i * 12;
+        sym = (union codeview_symbol *)(stream[5] + size[5]);
+        sym->refsym2_v3.id = S_PROCREF;
+        sym->refsym2_v3.ibSym = procref;
+        sym->refsym2_v3.imod = i + 1;
+        strcpy(sym->refsym2_v3.name, fixture_funcs[i].name);
+        size[5] = end_symbol(sym, sym->refsym2_v3.name) - stream[5];
+    }
+    symbols->module_size = ptr - (BYTE *)(symbols + 1);
+    /* section contributions */
+    *(DWORD *)ptr = 0xeffe0000 + 19970605;
+    range = (PDB_SYMBOL_RANGE_EX *)(ptr + sizeof(DWORD));
+    for (i = 0; i < ARRAY_SIZE(fixture_funcs); i++)
+    {
+        range[i].segment = 1;
+        range[i].offset = fixture_funcs[i].offset;
+        range[i].size = fixture_funcs[i].size;
+        range[i].characteristics = IMAGE_SCN_CNT_CODE | IMAGE_SCN_MEM_EXECUTE | IMAGE_SCN_MEM_READ;
+        range[i].index = i;
+    }
+    symbols->offset_size = sizeof(DWORD) + ARRAY_SIZE(fixture_funcs) * sizeof(*range);
+    size[3] = sizeof(*symbols) + symbols->module_size + symbols->offset_size;
+
+    hash->signature = 0xffffffff;
+    hash->version = 0xeffe0000 + 19990810;
+    hash->hash_records_size = ARRAY_SIZE(fixture_funcs) * sizeof(*record);
+    hash->buckets_size = (BYTE *)(offsets + ARRAY_SIZE(fixture_funcs)) - (BYTE *)bitmap;
+    size[4] = sizeof(*hash) + hash->hash_records_size + hash->buckets_size;
+
+    /* the TOC: the streams' sizes, then their blocks */
+    toc = (DWORD *)(image + 2 * FIXTURE_BLOCK_SIZE);
+    toc[0] = FIXTURE_STREAMS;
+    memcpy(toc + 1, size, sizeof(size));
+    for (i = 0, count = 1 + FIXTURE_STREAMS; i < FIXTURE_STREAMS; i++)
+        if (size[i]) toc[count++] = 3 + i;
+    *(DWORD *)(image + FIXTURE_BLOCK_SIZE) = 2;
+
+    header = (struct PDB_DS_HEADER *)image;
+    memcpy(header->signature, ident, sizeof(ident));
+    header->block_size = FIXTURE_BLOCK_SIZE;
+    header->unknown1 = 1;
+    header->num_pages = 3 + FIXTURE_STREAMS;
+    header->toc_size = count * sizeof(DWORD);
+    header->toc_page = 1;
+
+    write_file(path, image, (3 + FIXTURE_STREAMS) * FIXTURE_BLOCK_SIZE);
+    HeapFree(GetProcessHeap(), 0, image);
+}
+
+/* an image with a single code section, which also holds the debug directory
+ * pointing to the PDB */
+static void write_fixture_image(const char *path, const char *pdb_path)
+{
+    BYTE image[0x400] = {0};
+    IMAGE_DOS_HEADER *dos = (IMAGE_DOS_HEADER *)image;
+    IMAGE_NT_HEADERS *nt = (IMAGE_NT_HEADERS *)(dos + 1);
+    IMAGE_SECTION_HEADER *section = (IMAGE_SECTION_HEADER *)(nt + 1);
+    IMAGE_DEBUG_DIRECTORY *debug = (IMAGE_DEBUG_DIRECTORY *)(image + 0x300);
+    OMFSignatureRSDS *rsds = (OMFSignatureRSDS *)(debug + 1);
+
+    dos->e_magic = IMAGE_DOS_SIGNATURE;
+    dos->e_lfanew = sizeof(*dos);
+    nt->Signature = IMAGE_NT_SIGNATURE;
+#if defined(__x86_64__)
+    nt->FileHeader.Machine = IMAGE_FILE_MACHINE_AMD64;
+#elif defined(__aarch64__)
+    nt->FileHeader.Machine = IMAGE_FILE_MACHINE_ARM64;
+#elif defined(__arm__)
+    nt->FileHeader.Machine = IMAGE_FILE_MACHINE_ARMNT;
+#else
+    nt->FileHeader.Machine = IMAGE_FILE_MACHINE_I386;
+#endif
+    nt->FileHeader.NumberOfSections = 1;
+    nt->FileHeader.SizeOfOptionalHeader = sizeof(nt->OptionalHeader);
+    nt->FileHeader.Characteristics = IMAGE_FILE_EXECUTABLE_IMAGE | IMAGE_FILE_DLL;
+    nt->OptionalHeader.Magic = IMAGE_NT_OPTIONAL_HDR_MAGIC;
+    nt->OptionalHeader.ImageBase = 0x10000000;
+    nt->OptionalHeader.SectionAlignment = 0x1000;
+    nt->OptionalHeader.FileAlignment = 0x200;
+    nt->OptionalHeader.SizeOfImage = 0x2000;
+    nt->OptionalHeader.SizeOfHeaders = 0x200;
+    nt->OptionalHeader.NumberOfRvaAndSizes = IMAGE_NUMBEROF_DIRECTORY_ENTRIES;
+    nt->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_DEBUG].VirtualAddress = 0x1100;
+    nt->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_DEBUG].Size = sizeof(*debug);
+
+    memcpy(section->Name, ".text", 5);
+    section->Misc.VirtualSize = 0x200;
+    section->VirtualAddress = 0x1000;
+    section->SizeOfRawData = 0x200;
+    section->PointerToRawData = 0x200;
+    section->Characteristics = IMAGE_SCN_CNT_CODE | IMAGE_SCN_MEM_EXECUTE | IMAGE_SCN_MEM_READ;
+
+    debug->Type = IMAGE_DEBUG_TYPE_CODEVIEW;
+    debug->SizeOfData = FIELD_OFFSET(OMFSignatureRSDS, name) + strlen(pdb_path) + 1;
+    debug->AddressOfRawData = 0x1100 + sizeof(*debug);
+    debug->PointerToRawData = (BYTE *)rsds - image;
+    memcpy(rsds->Signature, "RSDS", 4);
+    rsds->guid = fixture_guid;
+    rsds->age = 1;
+    strcpy(rsds->name, pdb_path);
+
+    write_file(path, image, sizeof(image));
+}
+
+static void test_pdb_deferred(void)
+{
+    char si_buf[sizeof(SYMBOL_INFO) + 200], tmpdir[MAX_PATH], dll_path[MAX_PATH], pdb_path[MAX_PATH];
+    SYMBOL_INFO *si = (SYMBOL_INFO *)si_buf;
+    const DWORD64 base = 0x10000000;
+    IMAGEHLP_MODULE64 info;
+    DWORD64 ret_base, disp;
+    HANDLE process;
+    DWORD options;
+    BOOL ret;
+
+    GetTempPathA(ARRAY_SIZE(tmpdir), tmpdir);
+    sprintf(dll_path, "%sdbgfix.dll", tmpdir);
+    sprintf(pdb_path, "%sdbgfix.pdb", tmpdir);
+    write_fixture_pdb(pdb_path);
+    write_fixture_image(dll_path, pdb_path);
+
+    options = SymGetOptions();
+    SymSetOptions(options & ~SYMOPT_DEFERRED_LOADS);
+    process = init_sym_process(FALSE);
+    ret_base = SymLoadModuleEx(process, NULL, dll_path, NULL, base, 0, NULL, 0);
+    ok(ret_base == base, "SymLoadModuleEx failed: %u\n", GetLastError());
+
+    info.SizeOfStruct = sizeof(info);
+    ret = SymGetModuleInfo64(process, base, &info);
+    ok(ret, "SymGetModuleInfo64 failed: %u\n", GetLastError());
+    ok(info.SymType == SymPdb || broken(info.SymType == SymExport || info.SymType == SymNone),
+       "got symbol type %d\n", info.SymType);
+    if (info.SymType != SymPdb)
+    {
+        win_skip("the PDB fixture wasn't loaded\n");
+        goto done;
+    }
+
+    /* by name, through the hash table of the global symbols */
+    si->SizeOfStruct = sizeof(SYMBOL_INFO);
+    si->MaxNameLen = 200;
+    ret = SymFromName(process, "fixture_func2", si);
+    ok(ret, "SymFromName failed: %u\n", GetLastError());
+    if (ret)
+    {
+        ok(si->Address == base + 0x1000 + fixture_funcs[0].offset, "got address %s\n",
+           wine_dbgstr_longlong(si->Address));
+        ok(si->Size == fixture_funcs[0].size, "got size %u\n", si->Size);
+    }
+    ret = SymFromName(process, "fixture_missing", si);
+    ok(!ret, "SymFromName succeeded\n");
+
+    /* by address, through the section contributions */
+    ret = SymFromAddr(process, base + 0x1000 + fixture_funcs[1].offset + 8, &disp, si);
+    ok(ret, "SymFromAddr failed: %u\n", GetLastError());
+    if (ret)
+    {
+        ok(!strcmp(si->Name, "fixture_func1"), "got name %s\n", si->Name);
+        ok(disp == 8, "got displacement %s\n", wine_dbgstr_longlong(disp));
+    }
+    ret = SymFromAddr(process, base + 0x1000 + fixture_funcs[0].offset + 4, &disp, si);
+    ok(ret, "SymFromAddr failed: %u\n", GetLastError());
+    if (ret) ok(!strcmp(si->Name, "fixture_func2"), "got name %s\n", si->Name);
+
+done:
+    ret = SymUnloadModule64(process, base);
+    ok(ret, "SymUnloadModule64 failed: %u\n", GetLastError());
+    cleanup_sym_process(process);
+    SymSetOptions(options);
+    DeleteFileA(dll_path);
+    DeleteFileA(pdb_path);
+}
+
+static void test_symbolize_samples(void)
+{
+    static const char *exports[] =
+    {
+        "CreateFileA", "ReadFile", "WriteFile", "CloseHandle", "GetLastError", "HeapAlloc",
+        "HeapFree", "Sleep", "WaitForSingleObject", "GetTickCount", "lstrlenA", "MultiByteToWideChar",
+    };
+    char si_buf[sizeof(SYMBOL_INFO) + 200];
+    SYMBOL_INFO *si = (SYMBOL_INFO *)si_buf;
+    IMAGEHLP_LINE64 line;
+    LONGLONG start, end;
+    DWORD64 addrs[256], symbols[256], disp;
+    DWORD lines[256], line_disp;
+    unsigned int i, count, num_addrs = 0, mismatches = 0, seed = 12345;
+    HMODULE kernel32 = GetModuleHandleA("kernel32.dll");
+    HANDLE process;
+    DWORD options;
+    BOOL ret;
+
+    options = SymGetOptions();
+    SymSetOptions(options | SYMOPT_LOAD_LINES);
+
+    /* a few hot spots, sampled at several offsets each */
+    for (i = 0; i < ARRAY_SIZE(exports) * 16; i++)
+    {
+        DWORD_PTR func = (DWORD_PTR)GetProcAddress(kernel32, exports[i / 16]);
+        if (func) addrs[num_addrs++] = func + (i % 16) * 3;
+    }
+    for (i = 0; i < 16; i++) addrs[num_addrs++] = (DWORD_PTR)test_symbolize_samples + i * 5;
+    for (i = 0; i < 16; i++) addrs[num_addrs++] = (DWORD_PTR)test_lazy_symbols + i * 7;
+
+    /* the expected results come from another handle, which looks each address up only once */
+    process = init_sym_process(TRUE);
+    si->SizeOfStruct = sizeof(SYMBOL_INFO);
+    si->MaxNameLen = 200;
+    line.SizeOfStruct = sizeof(line);
+    for (i = 0; i < num_addrs; i++)
+    {
+        symbols[i] = SymFromAddr(process, addrs[i], &disp, si) ? si->Address : 0;
+        lines[i] = SymGetLineFromAddr64(process, addrs[i], &line_disp, &line) ? line.LineNumber : 0;
+    }
+    cleanup_sym_process(process);
+
+    process = init_sym_process(TRUE);
+
+    /* a profiler symbolizes every sample, so most addresses come up again and again */
+    count = winetest_interactive ? 10000000 : 2000;
+    start = get_time();
+    for (i = 0; i < count; i++)
+    {
+        unsigned int idx;
+
+        seed = seed * 1103515245 + 12345;
+        idx = (seed >> 16) % num_addrs;
+        ret = SymFromAddr(process, addrs[idx], &disp, si);
+        if (ret ? si->Address != symbols[idx] : symbols[idx] != 0) mismatches++;
+    }
+    end = get_time();
+    ok(!mismatches, "got %u inconsistent results\n", mismatches);
+    if (winetest_interactive)
+        trace("SymFromAddr: %u samples in %.3f ms, %.1f ns per sample\n", count,
+              elapsed(start, end) * 1000, elapsed(start, end) * 1e9 / count);
+
+    count /= 10;
+    mismatches = 0;
+    start = get_time();
+    for (i = 0; i < count; i++)
+    {
+        unsigned int idx;
+
+        seed = seed * 1103515245 + 12345;
+        idx = (seed >> 16) % num_addrs;
+        ret = SymGetLineFromAddr64(process, addrs[idx], &line_disp, &line);
+        if (ret ? line.LineNumber != lines[idx] : lines[idx] != 0) mismatches++;
+    }
+    end = get_time();
+    ok(!mismatches, "got %u inconsistent results\n", mismatches);
+    if (winetest_interactive)
+        trace("SymGetLineFromAddr64: %u samples in %.3f ms, %.1f ns per sample\n", count,
+              elapsed(start, end) * 1000, elapsed(start, end) * 1e9 / count);
+
+    cleanup_sym_process(process);
+    SymSetOptions(options);
+}
+
+/* dumps the process, and checks that the block at data, holding its own
+ * addresses in each page, made it to the dump */
+static void check_memory_dump(HANDLE process, DWORD pid, DWORD_PTR data, SIZE_T size, const char *name)
+{
+    char path[MAX_PATH], tmpdir[MAX_PATH];
+    MINIDUMP_MEMORY64_LIST *list;
+    MINIDUMP_DIRECTORY *dir;
+    LARGE_INTEGER file_size;
+    LONGLONG start, end;
+    ULONG64 rva, offset;
+    SIZE_T i, j;
+    HANDLE file, mapping;
+    ULONG stream_size;
+    BYTE *dump;
+    double secs;
+    BOOL ret, found = FALSE;
+
+    GetTempPathA(ARRAY_SIZE(tmpdir), tmpdir);
+    GetTempFileNameA(tmpdir, "dmp", 0, path);
+    file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    ok(file != INVALID_HANDLE_VALUE, "CreateFile failed: %u\n", GetLastError());
+
+    start = get_time();
+    ret = MiniDumpWriteDump(process, pid, file, MiniDumpWithFullMemory, NULL, NULL, NULL);
+    end = get_time();
+    ok(ret, "MiniDumpWriteDump failed: %u\n", GetLastError());
+    GetFileSizeEx(file, &file_size);
+    secs = elapsed(start, end);
+    if (winetest_interactive)
+        trace("MiniDumpWriteDump of %s: %.1f MiB in %.3f s, %.3f GB/s\n", name,
+              file_size.QuadPart / (1024.0 * 1024.0), secs, secs ? file_size.QuadPart / secs / 1e9 : 0);
+
+    mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    ok(mapping != NULL, "CreateFileMapping failed: %u\n", GetLastError());
+    dump = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    ok(dump != NULL, "MapViewOfFile failed: %u\n", GetLastError());
+    ret = dump && MiniDumpReadDumpStream(dump, Memory64ListStream, &dir, (void **)&list, &stream_size);
+    ok(ret, "no memory list in the dump\n");
+    if (ret)
+    {
+        rva = list->BaseRva;
+        for (i = 0; i < list->NumberOfMemoryRanges; i++)
+        {
+            const MINIDUMP_MEMORY_DESCRIPTOR64 *desc = &list->MemoryRanges[i];
+
+            if (desc->StartOfMemoryRange <= data &&
+                desc->StartOfMemoryRange + desc->DataSize >= data + size)
+            {
+                found = TRUE;
+                ok(rva + desc->DataSize <= file_size.QuadPart, "range out of the file\n");
+                offset = rva + data - desc->StartOfMemoryRange;
+                for (j = 0; j < size; j += 0x1000)
+                    if (*(DWORD_PTR *)(dump + offset + j) != data + j) break;
+                ok(j >= size, "wrong data at offset %#lx\n", (unsigned long)j);
+                break;
+            }
+            rva += desc->DataSize;
+        }
+    }
+    ok(found, "allocated block not found in the dump\n");
+
+    UnmapViewOfFile(dump);
+    CloseHandle(mapping);
+    CloseHandle(file);
+    DeleteFileA(path);
+}
+
+static void test_minidump_memory(void)
+{
+    PROCESS_INFORMATION pi;
+    HANDLE ready, done;
+    SIZE_T size, i;
+    BYTE *data, *remote;
+    BOOL ret;
+
+    /* a big chunk of committed memory, more than the buffers of the dump's readers
+     * hold; a synthetic large process when run interactively */
+    size = (SIZE_T)(winetest_interactive ? 1024 : 16) * 1024 * 1024;
+    data = VirtualAlloc(NULL, size, MEM_COMMIT, PAGE_READWRITE);
+    if (!data)
+    {
+        skip("couldn't allocate %u MiB\n", (unsigned int)(size >> 20));
+        return;
+    }
+
+    /* the process itself, whose memory is read in the dumping thread */
+    for (i = 0; i < size; i += 0x1000) *(DWORD_PTR *)(data + i) = (DWORD_PTR)(data + i);
+    check_memory_dump(GetCurrentProcess(), GetCurrentProcessId(), (DWORD_PTR)data, size, "own process");
+
+    /* and another one, whose memory is read by worker threads */
+    ready = CreateEventA(NULL, TRUE, FALSE, "dbghelp_test_child_ready");
+    done = CreateEventA(NULL, TRUE, FALSE, "dbghelp_test_child_done");
+    if (start_child("minidump", &pi))
+    {
+        ok(!WaitForSingleObject(ready, 30000), "child didn't start\n");
+        remote = VirtualAllocEx(pi.hProcess, NULL, size, MEM_COMMIT, PAGE_READWRITE);
+        ok(remote != NULL, "VirtualAllocEx failed: %u\n", GetLastError());
+        if (remote)
+        {
+            for (i = 0; i < size; i += 0x1000) *(DWORD_PTR *)(data + i) = (DWORD_PTR)(remote + i);
+            ret = WriteProcessMemory(pi.hProcess, remote, data, size, NULL);
+            ok(ret, "WriteProcessMemory failed: %u\n", GetLastError());
+            check_memory_dump(pi.hProcess, pi.dwProcessId, (DWORD_PTR)remote, size, "child process");
+        }
+        SetEvent(done);
+        wait_child_process(pi.hProcess);
+        CloseHandle(pi.hThread);
+        CloseHandle(pi.hProcess);
+    }
+    CloseHandle(done);
+    CloseHandle(ready);
+    VirtualFree(data, 0, MEM_RELEASE);
+}
+
+static void minidump_child(void)
+{
+    HANDLE ready, done;
+
+    ready = OpenEventA(EVENT_MODIFY_STATE, FALSE, "dbghelp_test_child_ready");
+    done = OpenEventA(SYNCHRONIZE, FALSE, "dbghelp_test_child_done");
+    ok(ready && done, "OpenEvent failed: %u\n", GetLastError());
+    SetEvent(ready);
+    WaitForSingleObject(done, 30000);
+    CloseHandle(done);
+    CloseHandle(ready);
+}
+
 START_TEST(dbghelp)
 {
-    BOOL ret = SymInitialize(GetCurrentProcess(), NULL, TRUE);
+    char **argv;
+    int argc;
+    BOOL ret;
+
+    QueryPerformanceFrequency(&perf_freq);
+
+    argc = winetest_get_mainargs(&argv);
+    if (argc >= 3 && !strcmp(argv[2], "minidump"))
+    {
+        minidump_child();
+        return;
+    }
+
+    ret = SymInitialize(GetCurrentProcess(), NULL, TRUE);
     ok(ret, "got error %u\n", GetLastError());
 
     test_stack_walk();
 
     ret = SymCleanup(GetCurrentProcess());
     ok(ret, "got error %u\n", GetLastError());
+
+    test_lazy_symbols();
+    test_pdb_deferred();
+    test_symbolize_samples();
+    test_minidump_memory();
 }
@@ -488,6 +488,7 @@ BOOL WINAPI SymEnumTypes(HANDLE hProcess, ULONG64 BaseOfDll,
           UserContext);
 
     if (!module_init_pair(&pair, hProcess, BaseOfDll)) return FALSE;
+    module_request_all(pair.effective);
 
     sym_info->SizeOfStruct = sizeof(SYMBOL_INFO);
     sym_info->MaxNameLen = sizeof(buffer) - sizeof(SYMBOL_INFO);
@@ -1056,6 +1057,7 @@ BOOL WINAPI SymGetTypeFromName(HANDLE hProcess, ULONG64 BaseOfDll,
     DWORD64             size;
 
     if (!module_init_pair(&pair, hProcess, BaseOfDll)) return FALSE;
+    module_request_name(pair.effective, Name);
     type = symt_find_type_by_name(pair.effective, SymTagNull, Name);
     if (!type) return FALSE;
     Symbol->Index = Symbol->TypeIndex = symt_ptr2index(pair.effective, type);
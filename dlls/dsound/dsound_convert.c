@@ -36,6 +36,7 @@
 
 
 #include <stdarg.h>
+#include <string.h>
 #include <math.h>
 
 #include "windef.h"
@@ -99,6 +100,77 @@ static float getieee32(const IDirectSoundBufferImpl *dsb, BYTE *base, DWORD chan
 
 const bitsgetfunc getbpp[5] = {get8, get16, get24, get32, getieee32};
 
+/* Block versions of the above, they convert count frames of a single channel
+ * to a contiguous float array. The loops are simple enough to be vectorized. */
+static void get8_block(const IDirectSoundBufferImpl *dsb, BYTE *base, DWORD channel, float *dst, UINT count)
+{
+    UINT stride = dsb->pwfx->nBlockAlign, i;
+    const BYTE *buf = base + channel;
+
+    for (i = 0; i < count; i++)
+        dst[i] = (buf[i * stride] - 0x80) / (float)0x80;
+}
+
+static void get16_block(const IDirectSoundBufferImpl *dsb, BYTE *base, DWORD channel, float *dst, UINT count)
+{
+    UINT stride = dsb->pwfx->nBlockAlign / 2, i;
+    const SHORT *sbuf = (const SHORT *)(base + 2 * channel);
+
+    if (stride == 1)
+    {
+        for (i = 0; i < count; i++)
+            dst[i] = (SHORT)le16(sbuf[i]) / (float)0x8000;
+    }
+    else if (stride == 2)
+    {
+        for (i = 0; i < count; i++)
+            dst[i] = (SHORT)le16(sbuf[i * 2]) / (float)0x8000;
+    }
+    else
+    {
+        for (i = 0; i < count; i++)
+            dst[i] = (SHORT)le16(sbuf[i * stride]) / (float)0x8000;
+    }
+}
+
+static void get24_block(const IDirectSoundBufferImpl *dsb, BYTE *base, DWORD channel, float *dst, UINT count)
+{
+    UINT stride = dsb->pwfx->nBlockAlign, i;
+    const BYTE *buf = base + 3 * channel;
+    LONG sample;
+
+    for (i = 0; i < count; i++, buf += stride)
+    {
+        sample = (buf[0] << 8) | (buf[1] << 16) | (buf[2] << 24);
+        dst[i] = sample / (float)0x80000000U;
+    }
+}
+
+static void get32_block(const IDirectSoundBufferImpl *dsb, BYTE *base, DWORD channel, float *dst, UINT count)
+{
+    UINT stride = dsb->pwfx->nBlockAlign / 4, i;
+    const LONG *sbuf = (const LONG *)(base + 4 * channel);
+
+    for (i = 0; i < count; i++)
+        dst[i] = (LONG)le32(sbuf[i * stride]) / (float)0x80000000U;
+}
+
+static void getieee32_block(const IDirectSoundBufferImpl *dsb, BYTE *base, DWORD channel, float *dst, UINT count)
+{
+    UINT stride = dsb->pwfx->nBlockAlign / 4, i;
+    const float *sbuf = (const float *)(base + 4 * channel);
+
+    if (stride == 1)
+        memcpy(dst, sbuf, count * sizeof(float));
+    else
+    {
+        for (i = 0; i < count; i++)
+            dst[i] = sbuf[i * stride];
+    }
+}
+
+const bitsgetblockfunc getbpp_block[5] = {get8_block, get16_block, get24_block, get32_block, getieee32_block};
+
 float get_mono(const IDirectSoundBufferImpl *dsb, BYTE *base, DWORD channel)
 {
     DWORD channels = dsb->pwfx->nChannels;
@@ -111,6 +183,14 @@ float get_mono(const IDirectSoundBufferImpl *dsb, BYTE *base, DWORD channel)
     return val;
 }
 
+void get_mono_block(const IDirectSoundBufferImpl *dsb, BYTE *base, DWORD channel, float *dst, UINT count)
+{
+    UINT stride = dsb->pwfx->nBlockAlign, i;
+
+    for (i = 0; i < count; i++, base += stride)
+        dst[i] = get_mono(dsb, base, channel);
+}
+
 static inline unsigned char f_to_8(float value)
 {
     if(value <= -1.f)
@@ -147,187 +227,6 @@ static inline LONG f_to_32(float value)
     return le32(lrintf(value * 0x80000000U));
 }
 
-void putieee32(const IDirectSoundBufferImpl *dsb, DWORD pos, DWORD channel, float value)
-{
-    BYTE *buf = (BYTE *)dsb->device->tmp_buffer;
-    float *fbuf = (float*)(buf + pos + sizeof(float) * channel);
-    *fbuf = value;
-}
-
-void putieee32_sum(const IDirectSoundBufferImpl *dsb, DWORD pos, DWORD channel, float value)
-{
-    BYTE *buf = (BYTE *)dsb->device->tmp_buffer;
-    float *fbuf = (float*)(buf + pos + sizeof(float) * channel);
-    *fbuf += value;
-}
-
-void put_mono2stereo(const IDirectSoundBufferImpl *dsb, DWORD pos, DWORD channel, float value)
-{
-    dsb->put_aux(dsb, pos, 0, value);
-    dsb->put_aux(dsb, pos, 1, value);
-}
-
-void put_mono2quad(const IDirectSoundBufferImpl *dsb, DWORD pos, DWORD channel, float value)
-{
-    dsb->put_aux(dsb, pos, 0, value);
-    dsb->put_aux(dsb, pos, 1, value);
-    dsb->put_aux(dsb, pos, 2, value);
-    dsb->put_aux(dsb, pos, 3, value);
-}
-
-void put_stereo2quad(const IDirectSoundBufferImpl *dsb, DWORD pos, DWORD channel, float value)
-{
-    if (channel == 0) { /* Left */
-        dsb->put_aux(dsb, pos, 0, value); /* Front left */
-        dsb->put_aux(dsb, pos, 2, value); /* Back left */
-    } else if (channel == 1) { /* Right */
-        dsb->put_aux(dsb, pos, 1, value); /* Front right */
-        dsb->put_aux(dsb, pos, 3, value); /* Back right */
-    }
-}
-
-void put_mono2surround51(const IDirectSoundBufferImpl *dsb, DWORD pos, DWORD channel, float value)
-{
-    dsb->put_aux(dsb, pos, 0, value);
-    dsb->put_aux(dsb, pos, 1, value);
-    dsb->put_aux(dsb, pos, 2, value);
-    dsb->put_aux(dsb, pos, 3, value);
-    dsb->put_aux(dsb, pos, 4, value);
-    dsb->put_aux(dsb, pos, 5, value);
-}
-
-void put_stereo2surround51(const IDirectSoundBufferImpl *dsb, DWORD pos, DWORD channel, float value)
-{
-    if (channel == 0) { /* Left */
-        dsb->put_aux(dsb, pos, 0, value); /* Front left */
-        dsb->put_aux(dsb, pos, 4, value); /* Back left */
-
-        dsb->put_aux(dsb, pos, 2, 0.0f); /* Mute front centre */
-        dsb->put_aux(dsb, pos, 3, 0.0f); /* Mute LFE */
-    } else if (channel == 1) { /* Right */
-        dsb->put_aux(dsb, pos, 1, value); /* Front right */
-        dsb->put_aux(dsb, pos, 5, value); /* Back right */
-    }
-}
-
-void put_surround512stereo(const IDirectSoundBufferImpl *dsb, DWORD pos, DWORD channel, float value)
-{
-    /* based on analyzing a recording of a dsound downmix */
-    switch(channel){
-
-    case 4: /* surround left */
-        value *= 0.24f;
-        dsb->put_aux(dsb, pos, 0, value);
-        break;
-
-    case 0: /* front left */
-        value *= 1.0f;
-        dsb->put_aux(dsb, pos, 0, value);
-        break;
-
-    case 5: /* surround right */
-        value *= 0.24f;
-        dsb->put_aux(dsb, pos, 1, value);
-        break;
-
-    case 1: /* front right */
-        value *= 1.0f;
-        dsb->put_aux(dsb, pos, 1, value);
-        break;
-
-    case 2: /* centre */
-        value *= 0.7;
-        dsb->put_aux(dsb, pos, 0, value);
-        dsb->put_aux(dsb, pos, 1, value);
-        break;
-
-    case 3:
-        /* LFE is totally ignored in dsound when downmixing to 2 channels */
-        break;
-    }
-}
-
-void put_surround712stereo(const IDirectSoundBufferImpl *dsb, DWORD pos, DWORD channel, float value)
-{
-    /* based on analyzing a recording of a dsound downmix */
-    switch(channel){
-
-    case 6: /* back left */
-        value *= 0.24f;
-        dsb->put_aux(dsb, pos, 0, value);
-        break;
-
-    case 4: /* surround left */
-        value *= 0.24f;
-        dsb->put_aux(dsb, pos, 0, value);
-        break;
-
-    case 0: /* front left */
-        value *= 1.0f;
-        dsb->put_aux(dsb, pos, 0, value);
-        break;
-
-    case 7: /* back right */
-        value *= 0.24f;
-        dsb->put_aux(dsb, pos, 1, value);
-        break;
-
-    case 5: /* surround right */
-        value *= 0.24f;
-        dsb->put_aux(dsb, pos, 1, value);
-        break;
-
-    case 1: /* front right */
-        value *= 1.0f;
-        dsb->put_aux(dsb, pos, 1, value);
-        break;
-
-    case 2: /* centre */
-        value *= 0.7;
-        dsb->put_aux(dsb, pos, 0, value);
-        dsb->put_aux(dsb, pos, 1, value);
-        break;
-
-    case 3:
-        /* LFE is totally ignored in dsound when downmixing to 2 channels */
-        break;
-    }
-}
-
-void put_quad2stereo(const IDirectSoundBufferImpl *dsb, DWORD pos, DWORD channel, float value)
-{
-    /* based on pulseaudio's downmix algorithm */
-    switch(channel){
-
-    case 2: /* back left */
-        value *= 0.1f; /* (1/9) / (sum of left volumes) */
-        dsb->put_aux(dsb, pos, 0, value);
-        break;
-
-    case 0: /* front left */
-        value *= 0.9f; /* 1 / (sum of left volumes) */
-        dsb->put_aux(dsb, pos, 0, value);
-        break;
-
-    case 3: /* back right */
-        value *= 0.1f; /* (1/9) / (sum of right volumes) */
-        dsb->put_aux(dsb, pos, 1, value);
-        break;
-
-    case 1: /* front right */
-        value *= 0.9f; /* 1 / (sum of right volumes) */
-        dsb->put_aux(dsb, pos, 1, value);
-        break;
-    }
-}
-
-void mixieee32(float *src, float *dst, unsigned samples)
-{
-    TRACE("%p - %p %d\n", src, dst, samples);
-    while (samples--)
-        *(dst++) += *(src++);
-}
-
 static void norm8(float *src, unsigned char *dst, unsigned samples)
 {
     TRACE("%p - %p %d\n", src, dst, samples);
@@ -86,6 +86,90 @@ void DSOUND_AmpFactorToVolPan(PDSVOLUMEPAN volpan)
     TRACE("Vol=%d Pan=%d\n", volpan->lVolume, volpan->lPan);
 }
 
+/* Channel routing tables: { input channel, output channel, gain } */
+static const DSMixRoute mono2stereo[] =
+{
+    {0, 0, 1.0f}, {0, 1, 1.0f},
+};
+
+static const DSMixRoute mono2quad[] =
+{
+    {0, 0, 1.0f}, {0, 1, 1.0f}, {0, 2, 1.0f}, {0, 3, 1.0f},
+};
+
+static const DSMixRoute mono2surround51[] =
+{
+    {0, 0, 1.0f}, {0, 1, 1.0f}, {0, 2, 1.0f}, {0, 3, 1.0f}, {0, 4, 1.0f}, {0, 5, 1.0f},
+};
+
+static const DSMixRoute stereo2quad[] =
+{
+    {0, 0, 1.0f}, /* Left to front left */
+    {0, 2, 1.0f}, /* Left to back left */
+    {1, 1, 1.0f}, /* Right to front right */
+    {1, 3, 1.0f}, /* Right to back right */
+};
+
+/* front centre and LFE stay muted */
+static const DSMixRoute stereo2surround51[] =
+{
+    {0, 0, 1.0f}, /* Left to front left */
+    {0, 4, 1.0f}, /* Left to back left */
+    {1, 1, 1.0f}, /* Right to front right */
+    {1, 5, 1.0f}, /* Right to back right */
+};
+
+/* based on analyzing a recording of a dsound downmix,
+ * LFE is totally ignored in dsound when downmixing to 2 channels */
+static const DSMixRoute surround512stereo[] =
+{
+    {0, 0, 1.0f},  /* front left */
+    {1, 1, 1.0f},  /* front right */
+    {2, 0, 0.7f},  /* centre */
+    {2, 1, 0.7f},
+    {4, 0, 0.24f}, /* surround left */
+    {5, 1, 0.24f}, /* surround right */
+};
+
+static const DSMixRoute surround712stereo[] =
+{
+    {0, 0, 1.0f},  /* front left */
+    {1, 1, 1.0f},  /* front right */
+    {2, 0, 0.7f},  /* centre */
+    {2, 1, 0.7f},
+    {4, 0, 0.24f}, /* surround left */
+    {5, 1, 0.24f}, /* surround right */
+    {6, 0, 0.24f}, /* back left */
+    {7, 1, 0.24f}, /* back right */
+};
+
+/* based on pulseaudio's downmix algorithm */
+static const DSMixRoute quad2stereo[] =
+{
+    {0, 0, 0.9f}, /* front left, 1 / (sum of left volumes) */
+    {1, 1, 0.9f}, /* front right, 1 / (sum of right volumes) */
+    {2, 0, 0.1f}, /* back left, (1/9) / (sum of left volumes) */
+    {3, 1, 0.1f}, /* back right, (1/9) / (sum of right volumes) */
+};
+
+static void set_routes(IDirectSoundBufferImpl *dsb, const DSMixRoute *routes, int count)
+{
+    memcpy(dsb->routes, routes, count * sizeof(*routes));
+    dsb->nrofroutes = count;
+}
+
+static void set_identity_routes(IDirectSoundBufferImpl *dsb)
+{
+    int i;
+
+    for (i = 0; i < dsb->mix_channels; i++)
+    {
+        dsb->routes[i].in = dsb->routes[i].out = i;
+        dsb->routes[i].gain = 1.0f;
+    }
+    dsb->nrofroutes = dsb->mix_channels;
+}
+
 /**
  * Recalculate the size for temporary buffer, and new writelead
  * Should be called when one of the following things occur:
@@ -133,10 +217,7 @@ void DSOUND_RecalcFormat(IDirectSoundBufferImpl *dsb)
 	dsb->freqAccNum = 0;
 
 	dsb->get_aux = ieee ? getbpp[4] : getbpp[dsb->pwfx->wBitsPerSample/8 - 1];
-	dsb->put_aux = putieee32;
-
-	dsb->get = dsb->get_aux;
-	dsb->put = dsb->put_aux;
+	dsb->get_block = ieee ? getbpp_block[4] : getbpp_block[dsb->pwfx->wBitsPerSample/8 - 1];
 
 	if (ichannels == ochannels)
 	{
@@ -145,56 +226,58 @@ void DSOUND_RecalcFormat(IDirectSoundBufferImpl *dsb)
 			FIXME("Copying %u channels is unsupported, limiting to first 32\n", ichannels);
 			dsb->mix_channels = 32;
 		}
+		set_identity_routes(dsb);
 	}
 	else if (ichannels == 1)
 	{
 		dsb->mix_channels = 1;
 
 		if (ochannels == 2)
-			dsb->put = put_mono2stereo;
+			set_routes(dsb, mono2stereo, ARRAY_SIZE(mono2stereo));
 		else if (ochannels == 4)
-			dsb->put = put_mono2quad;
+			set_routes(dsb, mono2quad, ARRAY_SIZE(mono2quad));
 		else if (ochannels == 6)
-			dsb->put = put_mono2surround51;
+			set_routes(dsb, mono2surround51, ARRAY_SIZE(mono2surround51));
+		else
+			set_identity_routes(dsb);
 	}
 	else if (ochannels == 1)
 	{
 		dsb->mix_channels = 1;
-		dsb->get = get_mono;
+		dsb->get_block = get_mono_block;
+		set_identity_routes(dsb);
 	}
 	else if (ichannels == 2 && ochannels == 4)
 	{
 		dsb->mix_channels = 2;
-		dsb->put = put_stereo2quad;
+		set_routes(dsb, stereo2quad, ARRAY_SIZE(stereo2quad));
 	}
 	else if (ichannels == 2 && ochannels == 6)
 	{
 		dsb->mix_channels = 2;
-		dsb->put = put_stereo2surround51;
+		set_routes(dsb, stereo2surround51, ARRAY_SIZE(stereo2surround51));
 	}
 	else if (ichannels == 6 && ochannels == 2)
 	{
 		dsb->mix_channels = 6;
-		dsb->put = put_surround512stereo;
-		dsb->put_aux = putieee32_sum;
+		set_routes(dsb, surround512stereo, ARRAY_SIZE(surround512stereo));
 	}
 	else if (ichannels == 8 && ochannels == 2)
 	{
 		dsb->mix_channels = 8;
-		dsb->put = put_surround712stereo;
-		dsb->put_aux = putieee32_sum;
+		set_routes(dsb, surround712stereo, ARRAY_SIZE(surround712stereo));
 	}
 	else if (ichannels == 4 && ochannels == 2)
 	{
 		dsb->mix_channels = 4;
-		dsb->put = put_quad2stereo;
-		dsb->put_aux = putieee32_sum;
+		set_routes(dsb, quad2stereo, ARRAY_SIZE(quad2stereo));
 	}
 	else
 	{
 		if (ichannels > 2)
 			FIXME("Conversion from %u to %u channels is not implemented, falling back to stereo\n", ichannels, ochannels);
 		dsb->mix_channels = 2;
+		set_identity_routes(dsb);
 	}
 }
 
@@ -275,70 +358,119 @@ void DSOUND_CheckEvent(const IDirectSoundBufferImpl *dsb, DWORD playpos, int len
     }
 }
 
-static inline float get_current_sample(const IDirectSoundBufferImpl *dsb,
-        BYTE *buffer, DWORD buflen, DWORD mixpos, DWORD channel)
+/**
+ * Convert count frames of a single channel, starting at mixpos, to a
+ * contiguous float array. Handles the buffer wraparound.
+ */
+static void get_current_samples(const IDirectSoundBufferImpl *dsb, BYTE *buffer, DWORD buflen,
+        DWORD mixpos, DWORD channel, float *out, UINT count)
+{
+    UINT istride = dsb->pwfx->nBlockAlign;
+    UINT n;
+
+    while (count)
+    {
+        if (mixpos >= buflen)
+        {
+            if (!(dsb->playflags & DSBPLAY_LOOPING))
+            {
+                memset(out, 0, count * sizeof(float));
+                return;
+            }
+            mixpos %= buflen;
+        }
+
+        n = (buflen - mixpos + istride - 1) / istride;
+        if (n > count)
+            n = count;
+        dsb->get_block(dsb, buffer + mixpos, channel, out, n);
+        out += n;
+        count -= n;
+        mixpos += n * istride;
+    }
+}
+
+static float *get_cp_buffer(DirectSoundDevice *device, DWORD len)
 {
-    if (mixpos >= buflen && !(dsb->playflags & DSBPLAY_LOOPING))
-        return 0.0f;
-    return dsb->get(dsb, buffer + (mixpos % buflen), channel);
+    if (!device->cp_buffer) {
+        device->cp_buffer = HeapAlloc(GetProcessHeap(), 0, len);
+        device->cp_buffer_len = len;
+    } else if (len > device->cp_buffer_len) {
+        device->cp_buffer = HeapReAlloc(GetProcessHeap(), 0, device->cp_buffer, len);
+        device->cp_buffer_len = len;
+    }
+    return device->cp_buffer;
+}
+
+/* Dot product using independent partial sums, so that it can be vectorized. */
+static inline float fir_dot(const float *coeffs, const float *samples, UINT len)
+{
+    float sum0 = 0.0f, sum1 = 0.0f, sum2 = 0.0f, sum3 = 0.0f;
+    UINT i;
+
+    for (i = 0; i + 4 <= len; i += 4)
+    {
+        sum0 += coeffs[i] * samples[i];
+        sum1 += coeffs[i + 1] * samples[i + 1];
+        sum2 += coeffs[i + 2] * samples[i + 2];
+        sum3 += coeffs[i + 3] * samples[i + 3];
+    }
+    for (; i < len; i++)
+        sum0 += coeffs[i] * samples[i];
+    return (sum0 + sum1) + (sum2 + sum3);
 }
 
-static UINT cp_fields_noresample(IDirectSoundBufferImpl *dsb, bitsputfunc put, UINT ostride, UINT count)
+/* The cp_fields functions write non-interleaved output, channel after
+ * channel, each of them count samples long. */
+static UINT cp_fields_noresample(IDirectSoundBufferImpl *dsb, float *out, UINT count)
 {
     UINT istride = dsb->pwfx->nBlockAlign;
     UINT committed_samples = 0;
-    DWORD channel, i;
+    DWORD channel;
 
     if(dsb->use_committed) {
         committed_samples = (dsb->writelead - dsb->committed_mixpos) / istride;
         committed_samples = committed_samples <= count ? committed_samples : count;
     }
 
-    for (i = 0; i < committed_samples; i++)
-        for (channel = 0; channel < dsb->mix_channels; channel++)
-            dsb->put(dsb, i * ostride, channel, get_current_sample(dsb, dsb->committedbuff,
-                dsb->writelead, dsb->committed_mixpos + i * istride, channel));
-
-    for (; i < count; i++)
-        for (channel = 0; channel < dsb->mix_channels; channel++)
-            put(dsb, i * ostride, channel, get_current_sample(dsb, dsb->buffer->memory,
-                dsb->buflen, dsb->sec_mixpos + i * istride, channel));
+    for (channel = 0; channel < dsb->mix_channels; channel++, out += count)
+    {
+        get_current_samples(dsb, dsb->committedbuff, dsb->writelead,
+                dsb->committed_mixpos, channel, out, committed_samples);
+        get_current_samples(dsb, dsb->buffer->memory, dsb->buflen,
+                dsb->sec_mixpos + committed_samples * istride, channel,
+                out + committed_samples, count - committed_samples);
+    }
     return count;
 }
 
-static UINT cp_fields_resample_lq(IDirectSoundBufferImpl *dsb, bitsputfunc put,
-                                  UINT ostride, UINT count, LONG64 *freqAccNum)
+static UINT cp_fields_resample_lq(IDirectSoundBufferImpl *dsb, float *out,
+                                  UINT count, LONG64 *freqAccNum)
 {
     UINT i, channel;
-    UINT istride = dsb->pwfx->nBlockAlign;
     UINT channels = dsb->mix_channels;
 
     LONG64 freqAcc_start = *freqAccNum;
     LONG64 freqAcc_end = freqAcc_start + count * dsb->freqAdjustNum;
     UINT max_ipos = freqAcc_end / dsb->freqAdjustDen;
+    /* one more sample in case the float position gets rounded up */
+    UINT required_input = max_ipos + 3;
+    float *input;
+
+    input = get_cp_buffer(dsb->device, required_input * channels * sizeof(float));
+    for (channel = 0; channel < channels; channel++)
+        get_current_samples(dsb, dsb->buffer->memory, dsb->buflen, dsb->sec_mixpos,
+                channel, input + channel * required_input, required_input);
 
     for (i = 0; i < count; ++i) {
         float cur_freqAcc = (freqAcc_start + i * dsb->freqAdjustNum) / (float)dsb->freqAdjustDen;
         float cur_freqAcc2;
         UINT ipos = cur_freqAcc;
-        UINT idx = dsb->sec_mixpos + ipos * istride;
         cur_freqAcc -= (int)cur_freqAcc;
         cur_freqAcc2 = 1.0f - cur_freqAcc;
         for (channel = 0; channel < channels; channel++) {
-            /**
-             * Generally we cannot cache the result of get_current_sample().
-             * Consider the case of resampling from 192000 Hz to 44100 Hz -
-             * none of the values will get reused for the next value of i.
-             * OTOH, for resampling from 44100 Hz to 192000 Hz both values
-             * will likely be reused.
-             *
-             * So far, this possibility of saving calls to
-             * get_current_sample() is ignored.
-             */
-            float s1 = get_current_sample(dsb, dsb->buffer->memory, dsb->buflen, idx, channel);
-            float s2 = get_current_sample(dsb, dsb->buffer->memory, dsb->buflen, idx + istride, channel);
-            float result = s1 * cur_freqAcc2 + s2 * cur_freqAcc;
-            put(dsb, i * ostride, channel, result);
+            const float *s = input + channel * required_input + ipos;
+            out[channel * count + i] = s[0] * cur_freqAcc2 + s[1] * cur_freqAcc;
         }
     }
 
@@ -346,8 +478,8 @@ static UINT cp_fields_resample_lq(IDirectSoundBufferImpl *dsb, bitsputfunc put,
     return max_ipos;
 }
 
-static UINT cp_fields_resample_hq(IDirectSoundBufferImpl *dsb, bitsputfunc put,
-                                  UINT ostride, UINT count, LONG64 *freqAccNum)
+static UINT cp_fields_resample_hq(IDirectSoundBufferImpl *dsb, float *out,
+                                  UINT count, LONG64 *freqAccNum)
 {
     UINT i, channel;
     UINT istride = dsb->pwfx->nBlockAlign;
@@ -367,15 +499,7 @@ static UINT cp_fields_resample_hq(IDirectSoundBufferImpl *dsb, bitsputfunc put,
     len += fir_cachesize;
     len *= sizeof(float);
 
-    if (!dsb->device->cp_buffer) {
-        dsb->device->cp_buffer = HeapAlloc(GetProcessHeap(), 0, len);
-        dsb->device->cp_buffer_len = len;
-    } else if (len > dsb->device->cp_buffer_len) {
-        dsb->device->cp_buffer = HeapReAlloc(GetProcessHeap(), 0, dsb->device->cp_buffer, len);
-        dsb->device->cp_buffer_len = len;
-    }
-
-    fir_copy = dsb->device->cp_buffer;
+    fir_copy = get_cp_buffer(dsb->device, len);
     intermediate = fir_copy + fir_cachesize;
 
     if(dsb->use_committed) {
@@ -388,13 +512,12 @@ static UINT cp_fields_resample_hq(IDirectSoundBufferImpl *dsb, bitsputfunc put,
      * This is good for CPU cache effects, too.
      */
     itmp = intermediate;
-    for (channel = 0; channel < channels; channel++) {
-        for (i = 0; i < committed_samples; i++)
-            *(itmp++) = get_current_sample(dsb, dsb->committedbuff,
-                dsb->writelead, dsb->committed_mixpos + i * istride, channel);
-        for (; i < required_input; i++)
-            *(itmp++) = get_current_sample(dsb, dsb->buffer->memory,
-                    dsb->buflen, dsb->sec_mixpos + i * istride, channel);
+    for (channel = 0; channel < channels; channel++, itmp += required_input) {
+        get_current_samples(dsb, dsb->committedbuff, dsb->writelead,
+                dsb->committed_mixpos, channel, itmp, committed_samples);
+        get_current_samples(dsb, dsb->buffer->memory, dsb->buflen,
+                dsb->sec_mixpos + committed_samples * istride, channel,
+                itmp + committed_samples, required_input - committed_samples);
     }
 
     for(i = 0; i < count; ++i) {
@@ -414,13 +537,9 @@ static UINT cp_fields_resample_hq(IDirectSoundBufferImpl *dsb, bitsputfunc put,
         assert(fir_used <= fir_cachesize);
         assert(ipos + fir_used <= required_input);
 
-        for (channel = 0; channel < dsb->mix_channels; channel++) {
-            int j;
-            float sum = 0.0;
-            float* cache = &intermediate[channel * required_input + ipos];
-            for (j = 0; j < fir_used; j++)
-                sum += fir_copy[j] * cache[j];
-            put(dsb, i * ostride, channel, sum * dsb->firgain);
+        for (channel = 0; channel < channels; channel++) {
+            float *cache = &intermediate[channel * required_input + ipos];
+            out[channel * count + i] = fir_dot(fir_copy, cache, fir_used) * dsb->firgain;
         }
     }
 
@@ -429,17 +548,16 @@ static UINT cp_fields_resample_hq(IDirectSoundBufferImpl *dsb, bitsputfunc put,
     return max_ipos;
 }
 
-static void cp_fields(IDirectSoundBufferImpl *dsb, bitsputfunc put,
-                      UINT ostride, UINT count, LONG64 *freqAccNum)
+static void cp_fields(IDirectSoundBufferImpl *dsb, float *out, UINT count, LONG64 *freqAccNum)
 {
     DWORD ipos, adv;
 
     if (dsb->freqAdjustNum == dsb->freqAdjustDen)
-        adv = cp_fields_noresample(dsb, put, ostride, count); /* *freqAcc is unmodified */
+        adv = cp_fields_noresample(dsb, out, count); /* *freqAcc is unmodified */
     else if (dsb->device->nrofbuffers > ds_hq_buffers_max)
-        adv = cp_fields_resample_lq(dsb, put, ostride, count, freqAccNum);
+        adv = cp_fields_resample_lq(dsb, out, count, freqAccNum);
     else
-        adv = cp_fields_resample_hq(dsb, put, ostride, count, freqAccNum);
+        adv = cp_fields_resample_hq(dsb, out, count, freqAccNum);
 
     ipos = dsb->sec_mixpos + adv * dsb->pwfx->nBlockAlign;
     if (ipos >= dsb->buflen) {
@@ -476,45 +594,27 @@ static inline DWORD DSOUND_BufPtrDiff(DWORD buflen, DWORD ptr1, DWORD ptr2)
 	}
 }
 
-static float getieee32_dsp(const IDirectSoundBufferImpl *dsb, DWORD pos, DWORD channel)
-{
-    const BYTE *buf = (BYTE *)dsb->device->dsp_buffer;
-    const float *fbuf = (const float*)(buf + pos + sizeof(float) * channel);
-    return *fbuf;
-}
-
-static void putieee32_dsp(const IDirectSoundBufferImpl *dsb, DWORD pos, DWORD channel, float value)
-{
-    BYTE *buf = (BYTE *)dsb->device->dsp_buffer;
-    float *fbuf = (float*)(buf + pos + sizeof(float) * channel);
-    *fbuf = value;
-}
-
 /**
  * Mix at most the given amount of data into the allocated temporary buffer
  * of the given secondary buffer, starting from the dsb's first currently
- * unsampled frame (writepos), translating frequency (pitch), stereo/mono
- * and bits-per-sample so that it is ideal for the primary buffer.
+ * unsampled frame (writepos), translating frequency (pitch) and
+ * bits-per-sample. The result is stored non-interleaved, one row of frames
+ * samples per channel of the secondary buffer, and the channel routing is
+ * done when mixing it into the primary buffer.
  * Doesn't perform any mixing - this is a straight copy/convert operation.
  *
  * dsb = the secondary buffer
- * writepos = Starting position of changed buffer
- * len = number of bytes to resample from writepos
- *
- * NOTE: writepos + len <= buflen. When called by mixer, MixOne makes sure of this.
+ * frames = number of frames to convert
  */
 static void DSOUND_MixToTemporary(IDirectSoundBufferImpl *dsb, DWORD frames)
 {
     BOOL using_filters = dsb->num_filters > 0 || dsb->device->eax.using_eax;
-    UINT istride, ostride, size_bytes;
+    UINT channels = dsb->mix_channels;
+    UINT size_bytes = frames * channels * sizeof(float);
+    float *tmp, *dsp;
     DWORD channel, i;
-    bitsputfunc put;
 	HRESULT hr;
 
-    put = dsb->put;
-    ostride = dsb->device->pwfx->nChannels * sizeof(float);
-    size_bytes = frames * ostride;
-
     if (dsb->device->tmp_buffer_len < size_bytes || !dsb->device->tmp_buffer) {
 		if (dsb->device->tmp_buffer)
 			dsb->device->tmp_buffer = HeapReAlloc(GetProcessHeap(), 0, dsb->device->tmp_buffer, size_bytes);
@@ -522,14 +622,11 @@ static void DSOUND_MixToTemporary(IDirectSoundBufferImpl *dsb, DWORD frames)
 			dsb->device->tmp_buffer = HeapAlloc(GetProcessHeap(), 0, size_bytes);
         dsb->device->tmp_buffer_len = size_bytes;
 	}
-    if(dsb->put_aux == putieee32_sum)
-        memset(dsb->device->tmp_buffer, 0, dsb->device->tmp_buffer_len);
+    tmp = dsb->device->tmp_buffer;
 
-    if (using_filters) {
-        put = putieee32_dsp;
-        ostride = dsb->mix_channels * sizeof(float);
-        size_bytes = frames * ostride;
+    cp_fields(dsb, tmp, frames, &dsb->freqAccNum);
 
+    if (using_filters && frames > 0) {
         if (dsb->device->dsp_buffer_len < size_bytes || !dsb->device->dsp_buffer) {
             if (dsb->device->dsp_buffer)
                 dsb->device->dsp_buffer = HeapReAlloc(GetProcessHeap(), 0, dsb->device->dsp_buffer, size_bytes);
@@ -537,64 +634,91 @@ static void DSOUND_MixToTemporary(IDirectSoundBufferImpl *dsb, DWORD frames)
                 dsb->device->dsp_buffer = HeapAlloc(GetProcessHeap(), 0, size_bytes);
             dsb->device->dsp_buffer_len = size_bytes;
         }
-    }
-
-    cp_fields(dsb, put, ostride, frames, &dsb->freqAccNum);
-
-    if (using_filters) {
-        if (frames > 0) {
-            for (i = 0; i < dsb->num_filters; i++) {
-                if (dsb->filters[i].inplace) {
-                    hr = IMediaObjectInPlace_Process(dsb->filters[i].inplace, frames * sizeof(float) * dsb->mix_channels,
-                                                     (BYTE *)dsb->device->dsp_buffer, 0, DMO_INPLACE_NORMAL);
-                    if (FAILED(hr))
-                        WARN("IMediaObjectInPlace_Process failed for filter %u\n", i);
-                } else
-                    WARN("filter %u has no inplace object - unsupported\n", i);
-            }
+        dsp = dsb->device->dsp_buffer;
+
+        /* filters work on interleaved data */
+        for (channel = 0; channel < channels; channel++)
+            for (i = 0; i < frames; i++)
+                dsp[i * channels + channel] = tmp[channel * frames + i];
+
+        for (i = 0; i < dsb->num_filters; i++) {
+            if (dsb->filters[i].inplace) {
+                hr = IMediaObjectInPlace_Process(dsb->filters[i].inplace, frames * sizeof(float) * channels,
+                                                 (BYTE *)dsp, 0, DMO_INPLACE_NORMAL);
+                if (FAILED(hr))
+                    WARN("IMediaObjectInPlace_Process failed for filter %u\n", i);
+            } else
+                WARN("filter %u has no inplace object - unsupported\n", i);
         }
 
         if (dsb->device->eax.using_eax)
-            process_eax_buffer(dsb, dsb->device->dsp_buffer, frames * dsb->mix_channels);
+            process_eax_buffer(dsb, dsp, frames * channels);
 
-        istride = ostride;
-        ostride = dsb->device->pwfx->nChannels * sizeof(float);
-        for (i = 0; i < frames; i++) {
-            for (channel = 0; channel < dsb->mix_channels; channel++) {
-                dsb->put(dsb, i * ostride, channel, getieee32_dsp(dsb, i * istride, channel));
-            }
-        }
+        for (channel = 0; channel < channels; channel++)
+            for (i = 0; i < frames; i++)
+                tmp[channel * frames + i] = dsp[i * channels + channel];
     }
 }
 
-static void DSOUND_MixerVol(const IDirectSoundBufferImpl *dsb, INT frames)
+static inline void mix_block(float *dst, UINT dst_stride, const float *src, float gain, UINT count)
+{
+    UINT i;
+
+    for (i = 0; i < count; i++)
+        dst[i * dst_stride] += src[i] * gain;
+}
+
+/**
+ * Route the converted channels in the temporary buffer to the channels of
+ * the primary buffer, applying the buffer volume, and add them to the mix.
+ */
+static void DSOUND_MixRoutes(const IDirectSoundBufferImpl *dsb, float *mix_buffer, DWORD frames)
 {
-	INT	i;
 	float vols[DS_MAX_CHANNELS];
 	UINT channels = dsb->device->pwfx->nChannels, chan;
+	const DSMixRoute *route;
+	const float *src;
+	float gain;
+	INT i;
 
 	TRACE("(%p,%d)\n",dsb,frames);
 	TRACE("left = %x, right = %x\n", dsb->volpan.dwTotalAmpFactor[0],
 		dsb->volpan.dwTotalAmpFactor[1]);
 
-	if ((!(dsb->dsbd.dwFlags & DSBCAPS_CTRLPAN) || (dsb->volpan.lPan == 0)) &&
-	    (!(dsb->dsbd.dwFlags & DSBCAPS_CTRLVOLUME) || (dsb->volpan.lVolume == 0)) &&
-	     !(dsb->dsbd.dwFlags & DSBCAPS_CTRL3D))
-		return; /* Nothing to do */
+	for (chan = 0; chan < DS_MAX_CHANNELS; ++chan)
+		vols[chan] = 1.0f;
 
-	if (channels > DS_MAX_CHANNELS)
+	if (((dsb->dsbd.dwFlags & DSBCAPS_CTRLPAN) && dsb->volpan.lPan != 0) ||
+	    ((dsb->dsbd.dwFlags & DSBCAPS_CTRLVOLUME) && dsb->volpan.lVolume != 0) ||
+	     (dsb->dsbd.dwFlags & DSBCAPS_CTRL3D))
 	{
-		FIXME("There is no support for %u channels\n", channels);
-		return;
+		if (channels > DS_MAX_CHANNELS)
+			FIXME("There is no support for %u channels\n", channels);
+		else
+		{
+			for (chan = 0; chan < channels; ++chan)
+				vols[chan] = dsb->volpan.dwTotalAmpFactor[chan] / ((float)0xFFFF);
+		}
 	}
 
-	for (i = 0; i < channels; ++i)
-		vols[i] = dsb->volpan.dwTotalAmpFactor[i] / ((float)0xFFFF);
-
-	for(i = 0; i < frames; ++i){
-		for(chan = 0; chan < channels; ++chan){
-			dsb->device->tmp_buffer[i * channels + chan] *= vols[chan];
-		}
+	for (i = 0; i < dsb->nrofroutes; ++i)
+	{
+		route = &dsb->routes[i];
+		if (route->out >= channels)
+			continue;
+
+		src = dsb->device->tmp_buffer + route->in * frames;
+		gain = route->gain;
+		if (route->out < DS_MAX_CHANNELS)
+			gain *= vols[route->out];
+
+		/* let the compiler generate specialized loops for the common layouts */
+		if (channels == 1)
+			mix_block(mix_buffer, 1, src, gain, frames);
+		else if (channels == 2)
+			mix_block(mix_buffer + route->out, 2, src, gain, frames);
+		else
+			mix_block(mix_buffer + route->out, channels, src, gain, frames);
 	}
 }
 
@@ -612,7 +736,6 @@ static void DSOUND_MixerVol(const IDirectSoundBufferImpl *dsb, INT frames)
  */
 static DWORD DSOUND_MixInBuffer(IDirectSoundBufferImpl *dsb, float *mix_buffer, DWORD frames)
 {
-	float *ibuf;
 	DWORD oldpos;
 
 	TRACE("sec_mixpos=%d/%d\n", dsb->sec_mixpos, dsb->buflen);
@@ -621,12 +744,9 @@ static DWORD DSOUND_MixInBuffer(IDirectSoundBufferImpl *dsb, float *mix_buffer,
 	/* Resample buffer to temporary buffer specifically allocated for this purpose, if needed */
 	oldpos = dsb->sec_mixpos;
 	DSOUND_MixToTemporary(dsb, frames);
-	ibuf = dsb->device->tmp_buffer;
-
-	/* Apply volume if needed */
-	DSOUND_MixerVol(dsb, frames);
 
-	mixieee32(ibuf, mix_buffer, frames * dsb->device->pwfx->nChannels);
+	/* Apply channel routing and volume, and mix into the primary buffer */
+	DSOUND_MixRoutes(dsb, mix_buffer, frames);
 
 	/* check for notification positions */
 	if (dsb->dsbd.dwFlags & DSBCAPS_CTRLPOSITIONNOTIFY &&
@@ -50,6 +50,7 @@
 #include "dsound_test.h"
 
 static const GUID testdmo_clsid = {0x1234};
+static const GUID probedmo_clsid = {0x1235};
 
 int align(int length, int align)
 {
@@ -1882,6 +1883,318 @@ static void test_AcquireResources(void)
     IDirectSound_Release(dsound);
 }
 
+/* A pass-through effect checking that it only sees a constant signal, used to
+ * verify the output of the conversion and resampling code. */
+static IMediaObject probedmo;
+static IMediaObjectInPlace probedmo_inplace;
+static WAVEFORMATEX probedmo_format;
+static LONG probedmo_samples, probedmo_bad, probedmo_wanted;
+static HANDLE probedmo_done;
+
+#define PROBE_VALUE 0x2000
+
+static HRESULT WINAPI probedmo_QueryInterface(IMediaObject *iface, REFIID iid, void **out)
+{
+    if (IsEqualGUID(iid, &IID_IMediaObject))
+        *out = &probedmo;
+    else if (IsEqualGUID(iid, &IID_IMediaObjectInPlace))
+        *out = &probedmo_inplace;
+    else
+        return E_NOINTERFACE;
+    return S_OK;
+}
+
+static ULONG WINAPI probedmo_AddRef(IMediaObject *iface)
+{
+    return 2;
+}
+
+static ULONG WINAPI probedmo_Release(IMediaObject *iface)
+{
+    return 1;
+}
+
+static HRESULT WINAPI probedmo_SetType(IMediaObject *iface, DWORD index, const DMO_MEDIA_TYPE *type, DWORD flags)
+{
+    const WAVEFORMATEX *wfx = (const WAVEFORMATEX *)type->pbFormat;
+
+    if (!(wfx->wFormatTag == WAVE_FORMAT_IEEE_FLOAT && wfx->wBitsPerSample == 32)
+            && !(wfx->wFormatTag == WAVE_FORMAT_PCM && wfx->wBitsPerSample == 16))
+        return DMO_E_TYPE_NOT_ACCEPTED;
+    probedmo_format = *wfx;
+    return S_OK;
+}
+
+static HRESULT WINAPI probedmo_Discontinuity(IMediaObject *iface, DWORD index)
+{
+    return S_OK;
+}
+
+static const IMediaObjectVtbl probedmo_vtbl =
+{
+    probedmo_QueryInterface,
+    probedmo_AddRef,
+    probedmo_Release,
+    dmo_GetStreamCount,
+    dmo_GetInputStreamInfo,
+    dmo_GetOutputStreamInfo,
+    dmo_GetInputType,
+    dmo_GetOutputType,
+    probedmo_SetType,
+    probedmo_SetType,
+    dmo_GetInputCurrentType,
+    dmo_GetOutputCurrentType,
+    dmo_GetInputSizeInfo,
+    dmo_GetOutputSizeInfo,
+    dmo_GetInputMaxLatency,
+    dmo_SetInputMaxLatency,
+    dmo_Flush,
+    probedmo_Discontinuity,
+    dmo_AllocateStreamingResources,
+    dmo_FreeStreamingResources,
+    dmo_GetInputStatus,
+    dmo_ProcessInput,
+    dmo_ProcessOutput,
+    dmo_Lock,
+};
+
+static HRESULT WINAPI probedmo_inplace_QueryInterface(IMediaObjectInPlace *iface, REFIID iid, void **out)
+{
+    return IMediaObject_QueryInterface(&probedmo, iid, out);
+}
+
+static ULONG WINAPI probedmo_inplace_AddRef(IMediaObjectInPlace *iface)
+{
+    return 2;
+}
+
+static ULONG WINAPI probedmo_inplace_Release(IMediaObjectInPlace *iface)
+{
+    return 1;
+}
+
+static HRESULT WINAPI probedmo_inplace_Process(IMediaObjectInPlace *iface, ULONG size,
+        BYTE *data, REFERENCE_TIME start, DWORD flags)
+{
+    unsigned int i, count = size / (probedmo_format.wBitsPerSample / 8);
+    float value;
+
+    for (i = 0; i < count; ++i)
+    {
+        if (probedmo_format.wFormatTag == WAVE_FORMAT_IEEE_FLOAT)
+            value = ((float *)data)[i];
+        else
+            value = ((short *)data)[i] / 32768.0f;
+        /* allow for the resampler ripple */
+        if (value < PROBE_VALUE * 0.96f / 32768.0f || value > PROBE_VALUE * 1.04f / 32768.0f)
+            ++probedmo_bad;
+    }
+    probedmo_samples += count;
+    if (probedmo_samples >= probedmo_wanted)
+        SetEvent(probedmo_done);
+
+    return S_FALSE;
+}
+
+static const IMediaObjectInPlaceVtbl probedmo_inplace_vtbl =
+{
+    probedmo_inplace_QueryInterface,
+    probedmo_inplace_AddRef,
+    probedmo_inplace_Release,
+    probedmo_inplace_Process,
+    dmo_inplace_Clone,
+    dmo_inplace_GetLatency,
+};
+
+static IMediaObject probedmo = {&probedmo_vtbl};
+static IMediaObjectInPlace probedmo_inplace = {&probedmo_inplace_vtbl};
+
+static HRESULT WINAPI probedmo_cf_CreateInstance(IClassFactory *iface, IUnknown *outer, REFIID iid, void **out)
+{
+    return IMediaObject_QueryInterface(&probedmo, iid, out);
+}
+
+static const IClassFactoryVtbl probedmo_cf_vtbl =
+{
+    dmo_cf_QueryInterface,
+    dmo_cf_AddRef,
+    dmo_cf_Release,
+    probedmo_cf_CreateInstance,
+    dmo_cf_LockServer,
+};
+
+static IClassFactory probedmo_cf = {&probedmo_cf_vtbl};
+
+static IDirectSoundBuffer *create_probe_buffer(IDirectSound8 *dsound)
+{
+    DSBUFFERDESC bufdesc = {.dwSize = sizeof(bufdesc)};
+    DSEFFECTDESC effect = {.dwSize = sizeof(effect)};
+    IDirectSoundBuffer8 *buffer8;
+    IDirectSoundBuffer *buffer;
+    WAVEFORMATEX wfx;
+    DWORD size, i;
+    short *ptr;
+    HRESULT hr;
+
+    /* The format differs from the one of the device, so the data is resampled. */
+    init_format(&wfx, WAVE_FORMAT_PCM, 11025, 16, 1);
+    bufdesc.dwFlags = DSBCAPS_GETCURRENTPOSITION2 | DSBCAPS_CTRLFX;
+    bufdesc.dwBufferBytes = wfx.nAvgBytesPerSec / 2;
+    bufdesc.lpwfxFormat = &wfx;
+    hr = IDirectSound8_CreateSoundBuffer(dsound, &bufdesc, &buffer, NULL);
+    ok(hr == DS_OK, "Got hr %#x.\n", hr);
+    if (FAILED(hr))
+        return NULL;
+
+    hr = IDirectSoundBuffer_Lock(buffer, 0, 0, (void **)&ptr, &size, NULL, NULL, DSBLOCK_ENTIREBUFFER);
+    ok(hr == DS_OK, "Got hr %#x.\n", hr);
+    for (i = 0; i < size / sizeof(*ptr); ++i)
+        ptr[i] = PROBE_VALUE;
+    IDirectSoundBuffer_Unlock(buffer, ptr, size, NULL, 0);
+
+    IDirectSoundBuffer_QueryInterface(buffer, &IID_IDirectSoundBuffer8, (void **)&buffer8);
+    effect.guidDSFXClass = probedmo_clsid;
+    hr = IDirectSoundBuffer8_SetFX(buffer8, 1, &effect, NULL);
+    ok(hr == DS_OK, "Got hr %#x.\n", hr);
+    IDirectSoundBuffer8_Release(buffer8);
+    if (FAILED(hr))
+    {
+        IDirectSoundBuffer_Release(buffer);
+        return NULL;
+    }
+
+    probedmo_samples = probedmo_bad = 0;
+    probedmo_wanted = wfx.nSamplesPerSec / 2;
+    ResetEvent(probedmo_done);
+    return buffer;
+}
+
+static void check_probe_buffer(IDirectSoundBuffer *buffer)
+{
+    ok(!WaitForSingleObject(probedmo_done, 5000), "Wait timed out.\n");
+    IDirectSoundBuffer_Stop(buffer);
+    ok(probedmo_samples >= probedmo_wanted, "Got %u samples.\n", probedmo_samples);
+    ok(!probedmo_bad, "%u of %u samples differ from the input signal.\n", probedmo_bad, probedmo_samples);
+    IDirectSoundBuffer_Release(buffer);
+}
+
+static void test_mixer(void)
+{
+    static const struct
+    {
+        WORD tag, bits, channels;
+        DWORD rate;
+    }
+    formats[] =
+    {
+        {WAVE_FORMAT_PCM, 16, 2, 44100},
+        {WAVE_FORMAT_PCM, 16, 2, 48000},
+        {WAVE_FORMAT_PCM, 8, 1, 22050},
+        {WAVE_FORMAT_IEEE_FLOAT, 32, 2, 48000},
+    };
+    IDirectSoundBuffer *buffers[128], *probe;
+    FILETIME create, exit, kernel_start, user_start, kernel_end, user_end;
+    ULONGLONG cpu_time;
+    DWORD status, start, elapsed;
+    unsigned int i, count = 0;
+    IDirectSound8 *dsound;
+    DSBUFFERDESC bufdesc;
+    WAVEFORMATEX wfx;
+    void *ptr;
+    DWORD size;
+    HRESULT hr;
+
+    hr = DirectSoundCreate8(NULL, &dsound, NULL);
+    ok(hr == DS_OK || hr == DSERR_NODRIVER, "Got hr %#x.\n", hr);
+    if (FAILED(hr))
+        return;
+
+    hr = IDirectSound8_SetCooperativeLevel(dsound, get_hwnd(), DSSCL_PRIORITY);
+    ok(hr == DS_OK, "Got hr %#x.\n", hr);
+
+    probedmo_done = CreateEventA(NULL, TRUE, FALSE, NULL);
+
+    /* A single playing buffer uses the high quality resampler. */
+    if ((probe = create_probe_buffer(dsound)))
+    {
+        hr = IDirectSoundBuffer_Play(probe, 0, 0, DSBPLAY_LOOPING);
+        ok(hr == DS_OK, "Got hr %#x.\n", hr);
+        check_probe_buffer(probe);
+    }
+
+    for (i = 0; i < ARRAY_SIZE(buffers); ++i)
+    {
+        init_format(&wfx, formats[i % ARRAY_SIZE(formats)].tag, formats[i % ARRAY_SIZE(formats)].rate,
+                formats[i % ARRAY_SIZE(formats)].bits, formats[i % ARRAY_SIZE(formats)].channels);
+
+        memset(&bufdesc, 0, sizeof(bufdesc));
+        bufdesc.dwSize = sizeof(bufdesc);
+        bufdesc.dwFlags = DSBCAPS_GETCURRENTPOSITION2 | DSBCAPS_CTRLVOLUME | DSBCAPS_CTRLFREQUENCY;
+        bufdesc.dwBufferBytes = wfx.nAvgBytesPerSec / 4;
+        bufdesc.lpwfxFormat = &wfx;
+
+        hr = IDirectSound8_CreateSoundBuffer(dsound, &bufdesc, &buffers[count], NULL);
+        ok(hr == DS_OK, "Got hr %#x.\n", hr);
+        if (FAILED(hr))
+            break;
+
+        hr = IDirectSoundBuffer_Lock(buffers[count], 0, 0, &ptr, &size, NULL, NULL, DSBLOCK_ENTIREBUFFER);
+        ok(hr == DS_OK, "Got hr %#x.\n", hr);
+        memset(ptr, wfx.wBitsPerSample == 8 ? 0x80 : 0, size);
+        IDirectSoundBuffer_Unlock(buffers[count], ptr, size, NULL, 0);
+
+        /* exercise both the resampling and the plain copy paths */
+        if (i & 1)
+            IDirectSoundBuffer_SetFrequency(buffers[count], wfx.nSamplesPerSec + 1000);
+        IDirectSoundBuffer_SetVolume(buffers[count], -600);
+        ++count;
+    }
+
+    /* With that many buffers the low quality resampler is used, the probe
+     * buffer also limits how long they are played. */
+    probe = create_probe_buffer(dsound);
+
+    GetProcessTimes(GetCurrentProcess(), &create, &exit, &kernel_start, &user_start);
+    start = GetTickCount();
+
+    for (i = 0; i < count; ++i)
+    {
+        hr = IDirectSoundBuffer_Play(buffers[i], 0, 0, DSBPLAY_LOOPING);
+        ok(hr == DS_OK, "Got hr %#x.\n", hr);
+    }
+    if (probe)
+    {
+        hr = IDirectSoundBuffer_Play(probe, 0, 0, DSBPLAY_LOOPING);
+        ok(hr == DS_OK, "Got hr %#x.\n", hr);
+        check_probe_buffer(probe);
+    }
+
+    for (i = 0; i < count; ++i)
+    {
+        hr = IDirectSoundBuffer_GetStatus(buffers[i], &status);
+        ok(hr == DS_OK, "Got hr %#x.\n", hr);
+        ok(status == (DSBSTATUS_PLAYING | DSBSTATUS_LOOPING), "Buffer %u: got status %#x.\n", i, status);
+        IDirectSoundBuffer_Stop(buffers[i]);
+    }
+
+    if (winetest_interactive)
+    {
+        elapsed = GetTickCount() - start;
+        GetProcessTimes(GetCurrentProcess(), &create, &exit, &kernel_end, &user_end);
+        cpu_time = (((ULONGLONG)user_end.dwHighDateTime << 32 | user_end.dwLowDateTime)
+                - ((ULONGLONG)user_start.dwHighDateTime << 32 | user_start.dwLowDateTime))
+                + (((ULONGLONG)kernel_end.dwHighDateTime << 32 | kernel_end.dwLowDateTime)
+                - ((ULONGLONG)kernel_start.dwHighDateTime << 32 | kernel_start.dwLowDateTime));
+        trace("mixing %u secondary buffers for %u ms used %u ms of CPU time.\n",
+                count, elapsed, (DWORD)(cpu_time / 10000));
+    }
+
+    for (i = 0; i < count; ++i)
+        IDirectSoundBuffer_Release(buffers[i]);
+    CloseHandle(probedmo_done);
+    IDirectSound8_Release(dsound);
+}
+
 START_TEST(dsound8)
 {
     DWORD cookie;
@@ -1905,5 +2218,13 @@ START_TEST(dsound8)
 
     CoRevokeClassObject(cookie);
 
+    hr = CoRegisterClassObject(&probedmo_clsid, (IUnknown *)&probedmo_cf,
+            CLSCTX_INPROC_SERVER, REGCLS_MULTIPLEUSE, &cookie);
+    ok(hr == S_OK, "Failed to register class, hr %#x.\n", hr);
+
+    test_mixer();
+
+    CoRevokeClassObject(cookie);
+
     CoUninitialize();
 }
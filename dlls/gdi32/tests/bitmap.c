@@ -30,11 +30,13 @@
 #include "winerror.h"
 #include "wingdi.h"
 #include "winuser.h"
+#include "winreg.h"
 #include "mmsystem.h"
 #include "winternl.h"
 #include "ddk/d3dkmthk.h"
 
 #include "wine/test.h"
+#include "utils.h"
 
 static NTSTATUS (WINAPI *pD3DKMTCreateDCFromMemory)( D3DKMT_CREATEDCFROMMEMORY *desc );
 static NTSTATUS (WINAPI *pD3DKMTDestroyDCFromMemory)( const D3DKMT_DESTROYDCFROMMEMORY *desc );
@@ -5941,9 +5943,132 @@ static void test_D3DKMTCreateDCFromMemory( void )
     }
 }
 
+static DWORD checksum_bits( const DWORD *bits, unsigned int count )
+{
+    DWORD checksum = 0;
+    while (count--) checksum = (checksum * 31) ^ *bits++;
+    return checksum;
+}
+
+/* large operations may be split into bands rendered by several threads,
+ * the result must not depend on the number of threads */
+static DWORD do_large_blits( DWORD *times )
+{
+    static const int width = 3840, height = 2160;
+    BLENDFUNCTION blend = { AC_SRC_OVER, 0, 255, AC_SRC_ALPHA };
+    TRIVERTEX vt[3] =
+    {
+        { 0,     0,      0xff00, 0x8000, 0x0000, 0x8000 },
+        { width, height, 0x0000, 0x4000, 0xff00, 0xff00 },
+        { 0,     height, 0x2000, 0xff00, 0x8000, 0x0000 },
+    };
+    GRADIENT_RECT rect = { 0, 1 };
+    GRADIENT_TRIANGLE tri = { 0, 1, 2 };
+    BITMAPINFO bmi;
+    HBITMAP src_dib, dst_dib;
+    DWORD *src_bits, *dst_bits, checksum = 0, start;
+    HDC src_dc, dst_dc;
+    int x, y;
+
+    memset( &bmi, 0, sizeof(bmi) );
+    bmi.bmiHeader.biSize = sizeof(bmi.bmiHeader);
+    bmi.bmiHeader.biWidth = width / 2;
+    bmi.bmiHeader.biHeight = -height / 2;
+    bmi.bmiHeader.biPlanes = 1;
+    bmi.bmiHeader.biBitCount = 32;
+    bmi.bmiHeader.biCompression = BI_RGB;
+
+    src_dc = CreateCompatibleDC( 0 );
+    dst_dc = CreateCompatibleDC( 0 );
+    src_dib = CreateDIBSection( src_dc, &bmi, DIB_RGB_COLORS, (void **)&src_bits, NULL, 0 );
+    bmi.bmiHeader.biWidth = width;
+    bmi.bmiHeader.biHeight = -height;
+    dst_dib = CreateDIBSection( dst_dc, &bmi, DIB_RGB_COLORS, (void **)&dst_bits, NULL, 0 );
+    ok( src_dib != NULL && dst_dib != NULL, "CreateDIBSection failed\n" );
+    SelectObject( src_dc, src_dib );
+    SelectObject( dst_dc, dst_dib );
+
+    for (y = 0; y < height / 2; y++)
+        for (x = 0; x < width / 2; x++)
+        {
+            BYTE a = (x + y) & 0xff;
+            src_bits[y * (width / 2) + x] = (a << 24) | ((x * a / 255) << 16) | ((y * a / 255 & 0xff) << 8) | (x ^ y) * a / 255;
+        }
+
+    start = GetTickCount();
+    SetStretchBltMode( dst_dc, COLORONCOLOR );
+    StretchBlt( dst_dc, 0, 0, width, height, src_dc, 0, 0, width / 2, height / 2, SRCCOPY );
+    times[0] = GetTickCount() - start;
+    checksum = checksum_bits( dst_bits, width * height );
+
+    start = GetTickCount();
+    SetStretchBltMode( dst_dc, BLACKONWHITE );
+    StretchBlt( dst_dc, 0, 0, width / 3, height / 3, dst_dc, 0, 0, width, height, SRCCOPY );
+    times[1] = GetTickCount() - start;
+    checksum = (checksum * 31) ^ checksum_bits( dst_bits, width * height );
+
+    start = GetTickCount();
+    pGdiAlphaBlend( dst_dc, 0, 0, width, height, src_dc, 0, 0, width / 2, height / 2, blend );
+    times[2] = GetTickCount() - start;
+    checksum = (checksum * 31) ^ checksum_bits( dst_bits, width * height );
+
+    start = GetTickCount();
+    pGdiGradientFill( dst_dc, vt, 2, &rect, 1, GRADIENT_FILL_RECT_H );
+    pGdiGradientFill( dst_dc, vt, 3, &tri, 1, GRADIENT_FILL_TRIANGLE );
+    times[3] = GetTickCount() - start;
+    checksum = (checksum * 31) ^ checksum_bits( dst_bits, width * height );
+
+    DeleteDC( src_dc );
+    DeleteDC( dst_dc );
+    DeleteObject( src_dib );
+    DeleteObject( dst_dib );
+    return checksum;
+}
+
+static void test_large_blits_child( DWORD expect )
+{
+    DWORD checksum, times[4];
+
+    checksum = do_large_blits( times );
+    ok( checksum == expect, "got checksum %08x, expected %08x\n", checksum, expect );
+    trace( "stretch %u ms, shrink %u ms, alpha blend %u ms, gradient %u ms\n",
+           times[0], times[1], times[2], times[3] );
+}
+
+static void test_large_blits(void)
+{
+    static const DWORD thread_counts[] = { 1, 2, 4, 8 };
+    struct child_setting setting = { "Gdi", "RenderThreads" };
+    DWORD checksum, times[4];
+    char args[32];
+    int i;
+
+    if (!pGdiAlphaBlend || !pGdiGradientFill)
+    {
+        win_skip( "GdiAlphaBlend or GdiGradientFill not available\n" );
+        return;
+    }
+
+    checksum = do_large_blits( times );
+    trace( "stretch %u ms, shrink %u ms, alpha blend %u ms, gradient %u ms\n",
+           times[0], times[1], times[2], times[3] );
+
+    /* the number of render threads is a Wine setting */
+    sprintf( args, "large_blits %u", checksum );
+    for (i = 0; i < ARRAY_SIZE(thread_counts); i++)
+    {
+        setting.value = thread_counts[i];
+        winetest_push_context( "%u threads", thread_counts[i] );
+        run_child_process( "bitmap", args, &setting, 1 );
+        winetest_pop_context();
+    }
+}
+
 START_TEST(bitmap)
 {
     HMODULE hdll;
+    char **argv;
+    int argc;
 
     hdll = GetModuleHandleA("gdi32.dll");
     pD3DKMTCreateDCFromMemory  = (void *)GetProcAddress( hdll, "D3DKMTCreateDCFromMemory" );
@@ -5951,6 +6076,13 @@ START_TEST(bitmap)
     pGdiAlphaBlend             = (void *)GetProcAddress( hdll, "GdiAlphaBlend" );
     pGdiGradientFill           = (void *)GetProcAddress( hdll, "GdiGradientFill" );
 
+    argc = winetest_get_mainargs( &argv );
+    if (argc >= 4 && !strcmp( argv[2], "large_blits" ))
+    {
+        test_large_blits_child( strtoul( argv[3], NULL, 10 ));
+        return;
+    }
+
     test_createdibitmap();
     test_dibsections();
     test_dib_formats();
@@ -5987,4 +6119,5 @@ START_TEST(bitmap)
     test_SetDIBitsToDevice();
     test_SetDIBitsToDevice_RLE8();
     test_D3DKMTCreateDCFromMemory();
+    test_large_blits();
 }
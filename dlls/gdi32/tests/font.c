@@ -28,9 +28,11 @@
 #include "wingdi.h"
 #include "winuser.h"
 #include "winnls.h"
+#include "winreg.h"
 
 #include "wine/heap.h"
 #include "wine/test.h"
+#include "utils.h"
 
 static inline BOOL match_off_by_n(int a, int b, unsigned int n)
 {
@@ -58,6 +60,7 @@ static BOOL  (WINAPI *pRemoveFontResourceExA)(LPCSTR, DWORD, PVOID);
 static BOOL  (WINAPI *pGetFontRealizationInfo)(HDC hdc, DWORD *);
 static BOOL  (WINAPI *pGetFontFileInfo)(DWORD, DWORD, void *, SIZE_T, SIZE_T *);
 static BOOL  (WINAPI *pGetFontFileData)(DWORD, DWORD, UINT64, void *, DWORD);
+static LONG  (WINAPI *pNtQueryInformationProcess)(HANDLE, int, void *, ULONG, ULONG *);
 
 static HMODULE hgdi32 = 0;
 static const MAT2 mat = { {0,1}, {0,0}, {0,0}, {0,1} };
@@ -100,6 +103,8 @@ static void init(void)
     pGetFontFileInfo = (void *)GetProcAddress(hgdi32, "GetFontFileInfo");
     pGetFontFileData = (void *)GetProcAddress(hgdi32, "GetFontFileData");
 
+    pNtQueryInformationProcess = (void *)GetProcAddress(GetModuleHandleA("ntdll.dll"), "NtQueryInformationProcess");
+
     system_lang_id = PRIMARYLANGID(GetSystemDefaultLangID());
 }
 
@@ -7786,14 +7791,190 @@ static void test_select_object(void)
     DeleteObject(hfont);
 }
 
+/* number of wineserver requests made by this process so far, or -1 when not running on Wine
+ * with WINEDEBUG=+servercalls */
+static LONG get_server_call_count(void)
+{
+    ULONG count;
+
+    if (!pNtQueryInformationProcess ||
+        pNtQueryInformationProcess(GetCurrentProcess(), 1001 /* ProcessWineServerCallCount */,
+                                   &count, sizeof(count), NULL))
+        return -1;
+    return count;
+}
+
+static void test_font_startup_child(BOOL expect_installed)
+{
+    FILETIME creation, exit_time, kernel_time, user_time, now;
+    ULARGE_INTEGER start, end;
+    TEXTMETRICA tm;
+    HFONT hfont, old_hfont;
+    LONG calls;
+    HDC hdc;
+    BOOL ret;
+
+    ret = GetProcessTimes(GetCurrentProcess(), &creation, &exit_time, &kernel_time, &user_time);
+    ok(ret, "GetProcessTimes error %u\n", GetLastError());
+
+    hdc = CreateCompatibleDC(0);
+    hfont = CreateFontA(-12, 0, 0, 0, FW_NORMAL, 0, 0, 0, DEFAULT_CHARSET, 0, 0, 0, 0, "Tahoma");
+    ok(hfont != NULL, "CreateFont failed\n");
+    old_hfont = SelectObject(hdc, hfont);
+    ret = GetTextMetricsA(hdc, &tm);
+    ok(ret, "GetTextMetrics error %u\n", GetLastError());
+
+    calls = get_server_call_count();
+    GetSystemTimeAsFileTime(&now);
+    start.u.LowPart = creation.dwLowDateTime;
+    start.u.HighPart = creation.dwHighDateTime;
+    end.u.LowPart = now.dwLowDateTime;
+    end.u.HighPart = now.dwHighDateTime;
+    trace("time to first CreateFont: %u ms\n", (DWORD)((end.QuadPart - start.QuadPart) / 10000));
+    if (calls != -1) trace("server calls before first CreateFont: %d\n", calls);
+
+    SelectObject(hdc, old_hfont);
+    DeleteObject(hfont);
+    DeleteDC(hdc);
+
+    ret = is_truetype_font_installed("wine_test");
+    ok(ret == expect_installed, "font wine_test should%s be enumerated\n", expect_installed ? "" : " not");
+}
+
+static void run_font_startup_child(BOOL expect_installed)
+{
+    char args[32];
+
+    sprintf(args, "font_startup %d", expect_installed);
+    run_child_process("font", args, NULL, 1);
+}
+
+/* new processes must see the fonts that were added or removed by other processes,
+ * and should not pay for reloading the shared font list */
+static void test_font_startup(void)
+{
+    char ttf_name[MAX_PATH];
+    int num;
+
+    if (!pAddFontResourceExA || !pRemoveFontResourceExA)
+    {
+        win_skip("AddFontResourceExA is not available on this platform\n");
+        return;
+    }
+
+    if (is_truetype_font_installed("wine_test"))
+    {
+        skip("font wine_test is already installed\n");
+        return;
+    }
+
+    run_font_startup_child(FALSE);
+    run_font_startup_child(FALSE);
+
+    if (!write_ttf_file("wine_test.ttf", ttf_name))
+    {
+        skip("Failed to create ttf file for testing\n");
+        return;
+    }
+
+    num = pAddFontResourceExA(ttf_name, 0, 0);
+    ok(num == 1, "AddFontResourceEx returned %d\n", num);
+    run_font_startup_child(TRUE);
+    run_font_startup_child(TRUE);
+
+    num = pRemoveFontResourceExA(ttf_name, 0, 0);
+    ok(num, "RemoveFontResourceEx error %d\n", GetLastError());
+    run_font_startup_child(FALSE);
+
+    DeleteFileA(ttf_name);
+}
+
+static DWORD render_text_paragraphs(unsigned int iterations, DWORD *elapsed)
+{
+    static const char paragraph[] =
+        "The quick brown fox jumps over the lazy dog. File Edit View Favorites Tools Help "
+        "OK Cancel Apply 0123456789 !\"#$%&'()*+,-./:;<=>?@[\\]^_`{|}~";
+    BITMAPINFO bmi;
+    HBITMAP dib, old_dib;
+    HFONT hfont, old_hfont;
+    DWORD *bits, checksum = 0, start;
+    unsigned int i, line;
+    HDC hdc;
+
+    memset(&bmi, 0, sizeof(bmi));
+    bmi.bmiHeader.biSize = sizeof(bmi.bmiHeader);
+    bmi.bmiHeader.biWidth = 640;
+    bmi.bmiHeader.biHeight = -480;
+    bmi.bmiHeader.biPlanes = 1;
+    bmi.bmiHeader.biBitCount = 32;
+    bmi.bmiHeader.biCompression = BI_RGB;
+
+    hdc = CreateCompatibleDC(0);
+    dib = CreateDIBSection(hdc, &bmi, DIB_RGB_COLORS, (void **)&bits, NULL, 0);
+    ok(dib != NULL, "CreateDIBSection failed\n");
+    old_dib = SelectObject(hdc, dib);
+    hfont = CreateFontA(-11, 0, 0, 0, FW_NORMAL, 0, 0, 0, DEFAULT_CHARSET, 0, 0,
+                        ANTIALIASED_QUALITY, 0, "Tahoma");
+    old_hfont = SelectObject(hdc, hfont);
+
+    start = GetTickCount();
+    for (i = 0; i < iterations; i++)
+    {
+        PatBlt(hdc, 0, 0, 640, 480, WHITENESS);
+        for (line = 0; line < 480 / 12; line++)
+            ExtTextOutA(hdc, (line * 7) % 13, line * 12, 0, NULL, paragraph, strlen(paragraph), NULL);
+    }
+    *elapsed = GetTickCount() - start;
+    GdiFlush();
+
+    for (i = 0; i < 640 * 480; i++) checksum = (checksum * 31) ^ bits[i];
+
+    SelectObject(hdc, old_hfont);
+    DeleteObject(hfont);
+    SelectObject(hdc, old_dib);
+    DeleteObject(dib);
+    DeleteDC(hdc);
+    return checksum;
+}
+
+static void test_text_rendering_child(DWORD expect)
+{
+    DWORD checksum, elapsed;
+
+    checksum = render_text_paragraphs(1, &elapsed);
+    ok(checksum == expect, "got checksum %08x, expected %08x\n", checksum, expect);
+}
+
+/* text rendered from cached glyphs, in this process or another one, must be
+ * identical to freshly rasterized text */
+static void test_text_rendering(void)
+{
+    static const struct child_setting cache_setting = { "Fonts", "SharedGlyphCacheSize", 4096 /* KB */ };
+    static const unsigned int iterations = 50;
+    DWORD checksum, checksum2, elapsed;
+    char args[32];
+
+    checksum = render_text_paragraphs(1, &elapsed);
+    trace("first paragraph rendering took %u ms\n", elapsed);
+
+    checksum2 = render_text_paragraphs(iterations, &elapsed);
+    ok(checksum2 == checksum, "got checksum %08x, expected %08x\n", checksum2, checksum);
+    trace("ExtTextOut throughput: %u lines/s\n",
+          elapsed ? (DWORD)(iterations * (480 / 12) * 1000 / elapsed) : ~0u);
+
+    /* on Wine, enable the shared glyph cache for the children: the first one
+     * fills it and the second one renders from it */
+    sprintf(args, "text_rendering %u", checksum);
+    if (!run_child_process("font", args, &cache_setting, 2))
+        run_child_process("font", args, NULL, 2);
+}
+
 START_TEST(font)
 {
     static const char *test_names[] =
     {
         "AddFontMemResource",
     };
-    char path_name[MAX_PATH];
-    STARTUPINFOA startup;
     char **argv;
     int argc, i;
 
@@ -7804,6 +7985,10 @@ START_TEST(font)
     {
         if (!strcmp(argv[2], "AddFontMemResource"))
             test_AddFontMemResource();
+        else if (!strcmp(argv[2], "font_startup") && argc >= 4)
+            test_font_startup_child(atoi(argv[3]));
+        else if (!strcmp(argv[2], "text_rendering") && argc >= 4)
+            test_text_rendering_child(strtoul(argv[3], NULL, 10));
         return;
     }
 
@@ -7873,25 +8058,15 @@ START_TEST(font)
     test_lang_names();
     test_char_width();
     test_select_object();
+    test_text_rendering();
 
     /* These tests should be last test until RemoveFontResource
      * is properly implemented.
      */
     test_vertical_font();
     test_CreateScalableFontResource();
+    test_font_startup();
 
-    winetest_get_mainargs( &argv );
     for (i = 0; i < ARRAY_SIZE(test_names); ++i)
-    {
-        PROCESS_INFORMATION info;
-
-        memset(&startup, 0, sizeof(startup));
-        startup.cb = sizeof(startup);
-        sprintf(path_name, "%s font %s", argv[0], test_names[i]);
-        ok(CreateProcessA(NULL, path_name, NULL, NULL, FALSE, 0, NULL, NULL, &startup, &info),
-            "CreateProcess failed.\n");
-        wait_child_process(info.hProcess);
-        CloseHandle(info.hProcess);
-        CloseHandle(info.hThread);
-    }
+        run_child_process("font", test_names[i], NULL, 1);
 }
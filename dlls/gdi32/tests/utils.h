@@ -0,0 +1,98 @@
+/*
+ * Helpers shared by the gdi32 tests
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef __WINE_GDI32_TESTS_UTILS_H
+#define __WINE_GDI32_TESTS_UTILS_H
+
+#include <stdio.h>
+
+#include "winreg.h"
+#include "wine/test.h"
+
+/* a DWORD value under HKCU\Software\Wine\<key> that is read by new processes */
+struct child_setting
+{
+    const char *key;
+    const char *name;
+    DWORD       value;
+};
+
+/* Run "<test> <args>" in count child processes, one after the other. When a
+ * setting is given, it is changed for the children and the previous value is
+ * restored afterwards; this is only done on Wine, and FALSE is returned
+ * without starting anything elsewhere or when the setting can't be changed. */
+#define run_child_process(a,b,c,d) run_child_process_(__FILE__, __LINE__, a, b, c, d)
+static inline BOOL run_child_process_( const char *file, unsigned int line, const char *test,
+                                       const char *args, const struct child_setting *setting,
+                                       unsigned int count )
+{
+    DWORD disposition, type, size = 0;
+    PROCESS_INFORMATION info;
+    STARTUPINFOA startup;
+    char cmdline[MAX_PATH], path[MAX_PATH];
+    BYTE *old_value = NULL;
+    HKEY hkey = 0;
+    char **argv;
+
+    if (setting)
+    {
+        if (strcmp( winetest_platform, "wine" )) return FALSE;
+        sprintf( path, "Software\\Wine\\%s", setting->key );
+        if (RegCreateKeyExA( HKEY_CURRENT_USER, path, 0, NULL, 0, KEY_ALL_ACCESS, NULL,
+                             &hkey, &disposition ))
+            return FALSE;
+        if (!RegQueryValueExA( hkey, setting->name, NULL, &type, NULL, &size ) &&
+            (old_value = HeapAlloc( GetProcessHeap(), 0, size )))
+            RegQueryValueExA( hkey, setting->name, NULL, &type, old_value, &size );
+        if (RegSetValueExA( hkey, setting->name, 0, REG_DWORD, (const BYTE *)&setting->value,
+                            sizeof(setting->value) ))
+        {
+            HeapFree( GetProcessHeap(), 0, old_value );
+            RegCloseKey( hkey );
+            return FALSE;
+        }
+    }
+
+    winetest_get_mainargs( &argv );
+    sprintf( cmdline, "%s %s %s", argv[0], test, args );
+    while (count--)
+    {
+        memset( &startup, 0, sizeof(startup) );
+        startup.cb = sizeof(startup);
+        if (!CreateProcessA( NULL, cmdline, NULL, NULL, FALSE, 0, NULL, NULL, &startup, &info ))
+        {
+            ok_(file, line)( 0, "CreateProcess failed %u\n", GetLastError() );
+            break;
+        }
+        wait_child_process_(file, line)( info.hProcess );
+        CloseHandle( info.hProcess );
+        CloseHandle( info.hThread );
+    }
+
+    if (setting)
+    {
+        if (old_value) RegSetValueExA( hkey, setting->name, 0, type, old_value, size );
+        else RegDeleteValueA( hkey, setting->name );
+        RegCloseKey( hkey );
+        if (disposition == REG_CREATED_NEW_KEY) RegDeleteKeyA( HKEY_CURRENT_USER, path );
+        HeapFree( GetProcessHeap(), 0, old_value );
+    }
+    return TRUE;
+}
+
+#endif
@@ -2718,13 +2718,370 @@ static HRESULT compile_arguments(compiler_ctx_t *ctx, const WCHAR *args)
     return parse_arguments(ctx, args, ctx->code->global_code.params, NULL);
 }
 
+/* Pages often load the same large library scripts into many engines. Compiled code of such
+ * scripts is kept in a process wide cache and each engine gets its own copy of the bytecode. */
+
+#define CODE_CACHE_MIN_SOURCE_LEN 1024
+#define CODE_CACHE_SIZE 16
+
+typedef struct {
+    const void *ptr;
+    unsigned idx;
+} pool_map_t;
+
+typedef struct {
+    struct list entry;
+    unsigned hash;
+    DWORD version;
+    BOOL is_html;
+    WCHAR *args;
+    unsigned source_len;
+    unsigned instr_cnt;
+    bytecode_t *code;
+    pool_map_t *bstr_map;
+    pool_map_t *str_map;
+} cached_code_t;
+
+typedef struct {
+    const bytecode_t *src;
+    bytecode_t *code;
+    const pool_map_t *bstr_map;
+    const pool_map_t *str_map;
+} clone_ctx_t;
+
+static struct list code_cache = LIST_INIT(code_cache);
+static unsigned code_cache_size;
+
+static CRITICAL_SECTION code_cache_cs;
+static CRITICAL_SECTION_DEBUG code_cache_cs_debug =
+{
+    0, 0, &code_cache_cs,
+    { &code_cache_cs_debug.ProcessLocksList, &code_cache_cs_debug.ProcessLocksList },
+      0, 0, { (DWORD_PTR)(__FILE__ ": code_cache_cs") }
+};
+static CRITICAL_SECTION code_cache_cs = { &code_cache_cs_debug, -1, 0, 0, 0, 0 };
+
+static unsigned hash_source(const WCHAR *source, unsigned len)
+{
+    unsigned hash = 2166136261u;
+
+    while(len--)
+        hash = (hash ^ *source++) * 16777619u;
+    return hash;
+}
+
+static int pool_map_cmp(const void *a, const void *b)
+{
+    const pool_map_t *map_a = a, *map_b = b;
+    return map_a->ptr < map_b->ptr ? -1 : map_a->ptr > map_b->ptr;
+}
+
+static pool_map_t *create_pool_map(const void *pool, unsigned cnt)
+{
+    pool_map_t *map;
+    unsigned i;
+
+    if(!(map = heap_alloc((cnt + 1) * sizeof(*map))))
+        return NULL;
+
+    for(i = 0; i < cnt; i++) {
+        map[i].ptr = ((const void* const*)pool)[i];
+        map[i].idx = i;
+    }
+    qsort(map, cnt, sizeof(*map), pool_map_cmp);
+    return map;
+}
+
+static BOOL map_pool_ptr(const pool_map_t *map, unsigned cnt, const void *ptr, unsigned *idx)
+{
+    pool_map_t key = { ptr }, *entry;
+
+    if(!(entry = bsearch(&key, map, cnt, sizeof(*map), pool_map_cmp)))
+        return FALSE;
+    *idx = entry->idx;
+    return TRUE;
+}
+
+static BOOL clone_bstr(clone_ctx_t *ctx, BSTR *str)
+{
+    unsigned idx;
+
+    if(!*str)
+        return TRUE;
+    if(!map_pool_ptr(ctx->bstr_map, ctx->src->bstr_cnt, *str, &idx))
+        return FALSE;
+    *str = ctx->code->bstr_pool[idx];
+    return TRUE;
+}
+
+static BOOL clone_str(clone_ctx_t *ctx, jsstr_t **str)
+{
+    unsigned idx;
+
+    if(!map_pool_ptr(ctx->str_map, ctx->src->str_cnt, *str, &idx))
+        return FALSE;
+    *str = ctx->code->str_pool[idx];
+    return TRUE;
+}
+
+static BOOL clone_instr_arg(clone_ctx_t *ctx, instr_arg_type_t type, instr_arg_t *arg)
+{
+    switch(type) {
+    case ARG_BSTR:
+        return clone_bstr(ctx, &arg->bstr);
+    case ARG_STR:
+        return clone_str(ctx, &arg->str);
+    default:
+        return TRUE;
+    }
+}
+
+static BOOL clone_function(clone_ctx_t *ctx, const function_code_t *src, function_code_t *func)
+{
+    unsigned i, j;
+
+    *func = *src;
+    func->bytecode = ctx->code;
+    if(src->source)
+        func->source = ctx->code->source + (src->source - ctx->src->source);
+
+    if(!clone_bstr(ctx, &func->name) || !clone_bstr(ctx, &func->event_target))
+        return FALSE;
+
+    func->funcs = compiler_alloc(ctx->code, func->func_cnt * sizeof(*func->funcs));
+    if(!func->funcs)
+        return FALSE;
+    for(i = 0; i < func->func_cnt; i++) {
+        if(!clone_function(ctx, src->funcs+i, func->funcs+i))
+            return FALSE;
+    }
+
+    func->variables = compiler_alloc(ctx->code, func->var_cnt * sizeof(*func->variables));
+    if(!func->variables)
+        return FALSE;
+    for(i = 0; i < func->var_cnt; i++) {
+        func->variables[i] = src->variables[i];
+        if(!clone_bstr(ctx, &func->variables[i].name))
+            return FALSE;
+    }
+
+    func->params = compiler_alloc(ctx->code, func->param_cnt * sizeof(*func->params));
+    if(!func->params)
+        return FALSE;
+    for(i = 0; i < func->param_cnt; i++) {
+        func->params[i] = src->params[i];
+        if(!clone_bstr(ctx, &func->params[i]))
+            return FALSE;
+    }
+
+    func->local_scopes = compiler_alloc(ctx->code, func->local_scope_count * sizeof(*func->local_scopes));
+    if(!func->local_scopes)
+        return FALSE;
+    for(i = 0; i < func->local_scope_count; i++) {
+        const local_ref_scopes_t *scope = src->local_scopes+i;
+
+        func->local_scopes[i].locals_cnt = scope->locals_cnt;
+        func->local_scopes[i].locals = compiler_alloc(ctx->code, scope->locals_cnt * sizeof(*scope->locals));
+        if(!func->local_scopes[i].locals)
+            return FALSE;
+        for(j = 0; j < scope->locals_cnt; j++) {
+            func->local_scopes[i].locals[j] = scope->locals[j];
+            if(!clone_bstr(ctx, &func->local_scopes[i].locals[j].name))
+                return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+/* creates a private copy of compiled code, sharing nothing with the source */
+static bytecode_t *clone_bytecode(const bytecode_t *src, unsigned instr_cnt, const pool_map_t *bstr_map,
+        const pool_map_t *str_map, UINT64 source_context, unsigned start_line)
+{
+    clone_ctx_t ctx = { src, NULL, bstr_map, str_map };
+    size_t len = lstrlenW(src->source);
+    bytecode_t *code;
+    instr_t *instr;
+    unsigned i;
+
+    if(!(code = heap_alloc_zero(sizeof(*code))))
+        return NULL;
+    ctx.code = code;
+
+    code->ref = 1;
+    code->source_context = source_context;
+    code->start_line = start_line;
+    heap_pool_init(&code->heap);
+
+    code->source = heap_alloc((len + 1) * sizeof(WCHAR));
+    code->instrs = heap_alloc(instr_cnt * sizeof(instr_t));
+    code->bstr_pool = heap_alloc(max(src->bstr_cnt, 1) * sizeof(BSTR));
+    code->str_pool = heap_alloc(max(src->str_cnt, 1) * sizeof(jsstr_t*));
+    if(!code->source || !code->instrs || !code->bstr_pool || !code->str_pool)
+        goto fail;
+    memcpy(code->source, src->source, (len + 1) * sizeof(WCHAR));
+    code->bstr_pool_size = max(src->bstr_cnt, 1);
+    code->str_pool_size = max(src->str_cnt, 1);
+
+    for(i = 0; i < src->bstr_cnt; i++) {
+        code->bstr_pool[i] = SysAllocStringLen(src->bstr_pool[i], SysStringLen(src->bstr_pool[i]));
+        if(!code->bstr_pool[i])
+            goto fail;
+        code->bstr_cnt++;
+    }
+
+    for(i = 0; i < src->str_cnt; i++) {
+        code->str_pool[i] = jsstr_alloc_len(jsstr_flatten(src->str_pool[i]), jsstr_length(src->str_pool[i]));
+        if(!code->str_pool[i])
+            goto fail;
+        code->str_cnt++;
+    }
+
+    /* the first instruction slot is never used */
+    memcpy(code->instrs + 1, src->instrs + 1, (instr_cnt - 1) * sizeof(instr_t));
+    for(instr = code->instrs + 1; instr < code->instrs + instr_cnt; instr++) {
+        if(instr_info[instr->op].arg1_type == ARG_DBL)
+            continue;
+        if(!clone_instr_arg(&ctx, instr_info[instr->op].arg1_type, instr->u.arg)
+           || !clone_instr_arg(&ctx, instr_info[instr->op].arg2_type, instr->u.arg+1))
+            goto fail;
+    }
+
+    if(!clone_function(&ctx, &src->global_code, &code->global_code))
+        goto fail;
+    return code;
+
+fail:
+    release_bytecode(code);
+    return NULL;
+}
+
+static void free_cached_code(cached_code_t *cached)
+{
+    release_bytecode(cached->code);
+    heap_free(cached->bstr_map);
+    heap_free(cached->str_map);
+    heap_free(cached->args);
+    heap_free(cached);
+}
+
+static BOOL is_code_cacheable(script_ctx_t *ctx, size_t len, BOOL from_eval, BOOL use_decode)
+{
+    /* conditional compilation state is per script context and may change the parsed code */
+    return !from_eval && !use_decode && !ctx->cc && len >= CODE_CACHE_MIN_SOURCE_LEN && len <= INT32_MAX;
+}
+
+static BOOL code_cache_match(const cached_code_t *cached, script_ctx_t *ctx, unsigned hash, const WCHAR *source,
+        unsigned len, const WCHAR *args, BOOL is_html)
+{
+    if(cached->hash != hash || cached->source_len != len || cached->version != ctx->version || cached->is_html != is_html)
+        return FALSE;
+    if(!args != !cached->args || (args && wcscmp(args, cached->args)))
+        return FALSE;
+    return !memcmp(cached->code->source, source, len * sizeof(WCHAR));
+}
+
+static bytecode_t *lookup_code_cache(script_ctx_t *ctx, const WCHAR *source, unsigned len, unsigned hash,
+        UINT64 source_context, unsigned start_line, const WCHAR *args, BOOL is_html)
+{
+    cached_code_t *cached;
+    bytecode_t *code = NULL;
+
+    EnterCriticalSection(&code_cache_cs);
+
+    LIST_FOR_EACH_ENTRY(cached, &code_cache, cached_code_t, entry) {
+        if(!code_cache_match(cached, ctx, hash, source, len, args, is_html))
+            continue;
+
+        code = clone_bytecode(cached->code, cached->instr_cnt, cached->bstr_map, cached->str_map,
+                              source_context, start_line);
+        list_remove(&cached->entry);
+        list_add_head(&code_cache, &cached->entry);
+        break;
+    }
+
+    LeaveCriticalSection(&code_cache_cs);
+
+    TRACE("%s %u chars\n", code ? "hit" : "miss", len);
+    return code;
+}
+
+static void add_code_cache(script_ctx_t *ctx, bytecode_t *code, unsigned instr_cnt, unsigned len, unsigned hash,
+        const WCHAR *args, BOOL is_html)
+{
+    pool_map_t *bstr_map, *str_map;
+    cached_code_t *cached;
+
+    if(!(cached = heap_alloc_zero(sizeof(*cached))))
+        return;
+
+    cached->hash = hash;
+    cached->version = ctx->version;
+    cached->is_html = is_html;
+    cached->source_len = len;
+    cached->instr_cnt = instr_cnt;
+
+    bstr_map = create_pool_map(code->bstr_pool, code->bstr_cnt);
+    str_map = create_pool_map(code->str_pool, code->str_cnt);
+    if(bstr_map && str_map)
+        cached->code = clone_bytecode(code, instr_cnt, bstr_map, str_map, 0, 0);
+    heap_free(bstr_map);
+    heap_free(str_map);
+    if(!cached->code || (args && !(cached->args = heap_strdupW(args)))) {
+        if(cached->code)
+            release_bytecode(cached->code);
+        heap_free(cached);
+        return;
+    }
+
+    cached->bstr_map = create_pool_map(cached->code->bstr_pool, cached->code->bstr_cnt);
+    cached->str_map = create_pool_map(cached->code->str_pool, cached->code->str_cnt);
+    if(!cached->bstr_map || !cached->str_map) {
+        free_cached_code(cached);
+        return;
+    }
+
+    EnterCriticalSection(&code_cache_cs);
+
+    list_add_head(&code_cache, &cached->entry);
+    if(code_cache_size == CODE_CACHE_SIZE) {
+        cached = LIST_ENTRY(list_tail(&code_cache), cached_code_t, entry);
+        list_remove(&cached->entry);
+        free_cached_code(cached);
+    }else {
+        code_cache_size++;
+    }
+
+    LeaveCriticalSection(&code_cache_cs);
+}
+
+void free_code_cache(void)
+{
+    cached_code_t *cached, *next;
+
+    LIST_FOR_EACH_ENTRY_SAFE(cached, next, &code_cache, cached_code_t, entry)
+        free_cached_code(cached);
+    list_init(&code_cache);
+    code_cache_size = 0;
+}
+
 HRESULT compile_script(script_ctx_t *ctx, const WCHAR *code, UINT64 source_context, unsigned start_line,
                        const WCHAR *args, const WCHAR *delimiter, BOOL from_eval, BOOL use_decode,
                        named_item_t *named_item, bytecode_t **ret)
 {
     compiler_ctx_t compiler = {0};
+    BOOL is_html = delimiter && !wcsicmp(delimiter, L"</script>"), cacheable;
+    size_t len = code ? lstrlenW(code) : 0;
+    unsigned hash = 0;
     HRESULT hres;
 
+    if((cacheable = is_code_cacheable(ctx, len, from_eval, use_decode))) {
+        hash = hash_source(code, len);
+        compiler.code = lookup_code_cache(ctx, code, len, hash, source_context, start_line, args, is_html);
+        if(compiler.code)
+            goto done;
+    }
+
     hres = init_code(&compiler, code, source_context, start_line);
     if(FAILED(hres))
         return hres;
@@ -2762,6 +3119,10 @@ HRESULT compile_script(script_ctx_t *ctx, const WCHAR *code, UINT64 source_conte
         return DISP_E_EXCEPTION;
     }
 
+    if(cacheable && !ctx->cc)
+        add_code_cache(ctx, compiler.code, compiler.code_off, len, hash, args, is_html);
+
+done:
     if(named_item) {
         compiler.code->named_item = named_item;
         named_item->ref++;
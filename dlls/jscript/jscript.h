@@ -394,6 +394,7 @@ typedef struct {
 } cc_ctx_t;
 
 void release_cc(cc_ctx_t*) DECLSPEC_HIDDEN;
+void free_code_cache(void) DECLSPEC_HIDDEN;
 
 typedef struct {
     IServiceProvider IServiceProvider_iface;
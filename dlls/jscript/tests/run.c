@@ -3559,6 +3559,85 @@ static void test_parse_proc(void)
     invoke_procedure(L" _x1 , y_2", L"return _x1 === 1 && y_2 === 2;", &dp);
 }
 
+static HRESULT parse_library(const WCHAR *lib, unsigned func, int *result, ULONG *ticks)
+{
+    IActiveScriptParse *parser;
+    IActiveScript *engine;
+    WCHAR expr[64];
+    VARIANT v;
+    HRESULT hres;
+
+    engine = create_script();
+    if(!engine)
+        return E_FAIL;
+
+    hres = IActiveScript_QueryInterface(engine, &IID_IActiveScriptParse, (void**)&parser);
+    ok(hres == S_OK, "Could not get IActiveScriptParse: %08x\n", hres);
+
+    hres = IActiveScriptParse_InitNew(parser);
+    ok(hres == S_OK, "InitNew failed: %08x\n", hres);
+
+    hres = IActiveScript_SetScriptSite(engine, &ActiveScriptSite);
+    ok(hres == S_OK, "SetScriptSite failed: %08x\n", hres);
+
+    hres = IActiveScript_SetScriptState(engine, SCRIPTSTATE_STARTED);
+    ok(hres == S_OK, "SetScriptState(SCRIPTSTATE_STARTED) failed: %08x\n", hres);
+
+    *ticks = GetTickCount();
+    hres = IActiveScriptParse_ParseScriptText(parser, lib, NULL, NULL, NULL, 0, 0, 0, NULL, NULL);
+    *ticks = GetTickCount() - *ticks;
+    ok(hres == S_OK, "ParseScriptText failed: %08x\n", hres);
+
+    swprintf(expr, ARRAY_SIZE(expr), L"f%u(2, 3) + counter * 100000", func);
+    V_VT(&v) = VT_EMPTY;
+    hres = IActiveScriptParse_ParseScriptText(parser, expr, NULL, NULL, NULL, 0, 0, SCRIPTTEXT_ISEXPRESSION, &v, NULL);
+    ok(hres == S_OK, "ParseScriptText failed: %08x\n", hres);
+    ok(V_VT(&v) == VT_I4, "V_VT(v) = %d\n", V_VT(&v));
+    *result = V_I4(&v);
+
+    IActiveScriptParse_Release(parser);
+    close_script(engine);
+    return hres;
+}
+
+static void test_library_reload(void)
+{
+    const unsigned func_cnt = 2000, loops = 10;
+    ULONG ticks, total = 0, first = 0;
+    unsigned i, len = 0, size;
+    int result;
+    WCHAR *lib;
+    HRESULT hres;
+
+    size = 256 * func_cnt;
+    lib = HeapAlloc(GetProcessHeap(), 0, size * sizeof(WCHAR));
+    len += swprintf(lib + len, size - len, L"var counter = (typeof(counter) === 'number' ? counter : 0) + 1;\n");
+    for(i = 0; i < func_cnt; i++)
+        len += swprintf(lib + len, size - len,
+                L"function f%u(a, b) {\n"
+                L"    var s = \"str%u\", r = /x%u+/g, o = { k%u: a };\n"
+                L"    function inner(x) { return x + o.k%u * %u; }\n"
+                L"    return r.test(\"x%u\") ? inner(b) + s.length : -1;\n"
+                L"}\n", i, i, i, i, i, i, i);
+
+    for(i = 0; i < loops; i++) {
+        winetest_push_context("%u", i);
+        hres = parse_library(lib, func_cnt - 1, &result, &ticks);
+        if(FAILED(hres)) {
+            winetest_pop_context();
+            break;
+        }
+        ok(result == 100000 + 2 * (func_cnt - 1) + 3 + 7, "result = %d\n", result);
+        winetest_pop_context();
+
+        if(!i) first = ticks;
+        else total += ticks;
+    }
+
+    trace("%u KB library: first parse %u ms, %u reloads %u ms\n", len * 2 / 1024, first, loops - 1, total);
+    HeapFree(GetProcessHeap(), 0, lib);
+}
+
 static void run_encoded_tests(void)
 {
     BSTR src;
@@ -3719,6 +3798,7 @@ START_TEST(run)
             run_encoded_tests();
             trace("ParseProcedureText tests...\n");
             test_parse_proc();
+            test_library_reload();
         }
 
         if(winetest_interactive)
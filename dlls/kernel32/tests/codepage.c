@@ -1308,6 +1308,100 @@ static void test_dbcs_to_widechar(void)
     }
 }
 
+/* long strings mixing 7-bit ASCII runs with other characters, in both directions */
+static void test_mixed_ascii_conversion(void)
+{
+    static const struct
+    {
+        UINT cp;
+        WCHAR ch;
+    }
+    tests[] =
+    {
+        { 1252, 0x00e9 },
+        { 437, 0x00e9 },
+        { 1251, 0x0416 },
+        { 932, 0x3042 },
+        { 936, 0x4e2d },
+        { CP_UTF8, 0x4e2d },
+    };
+    static const unsigned int intervals[] = { 0, 97, 7 };
+    const unsigned int len = winetest_interactive ? 65536 : 4096, loops = 20;
+    unsigned int i, j, k, pos, ticks;
+    WCHAR *src, *wbuf;
+    char *ref, *buf;
+    int ret;
+
+    src = HeapAlloc( GetProcessHeap(), 0, len * sizeof(WCHAR) );
+    wbuf = HeapAlloc( GetProcessHeap(), 0, len * sizeof(WCHAR) );
+    ref = HeapAlloc( GetProcessHeap(), 0, len * 4 );
+    buf = HeapAlloc( GetProcessHeap(), 0, len * 4 );
+
+    for (i = 0; i < ARRAY_SIZE(tests); i++)
+    {
+        if (!IsValidCodePage( tests[i].cp ))
+        {
+            skip( "code page %u not available\n", tests[i].cp );
+            continue;
+        }
+        for (j = 0; j < ARRAY_SIZE(intervals); j++)
+        {
+            winetest_push_context( "cp %u interval %u", tests[i].cp, intervals[j] );
+
+            for (k = 0; k < len; k++)
+            {
+                if (intervals[j] && k % intervals[j] == intervals[j] - 1) src[k] = tests[i].ch;
+                else src[k] = ' ' + k % 95;
+            }
+
+            /* reference result, converting one char at a time */
+            for (k = pos = 0; k < len; k++)
+                pos += WideCharToMultiByte( tests[i].cp, 0, src + k, 1, ref + pos, len * 4 - pos, NULL, NULL );
+
+            ret = WideCharToMultiByte( tests[i].cp, 0, src, len, buf, len * 4, NULL, NULL );
+            ok( ret == pos, "got %d, expected %u\n", ret, pos );
+            ok( !memcmp( buf, ref, pos ), "wrong multibyte data\n" );
+            ret = WideCharToMultiByte( tests[i].cp, 0, src, len, NULL, 0, NULL, NULL );
+            ok( ret == pos, "got %d, expected %u\n", ret, pos );
+
+            ret = MultiByteToWideChar( tests[i].cp, 0, ref, pos, wbuf, len );
+            ok( ret == len, "got %d, expected %u\n", ret, len );
+            ok( !memcmp( wbuf, src, len * sizeof(WCHAR) ), "wrong unicode data\n" );
+            ret = MultiByteToWideChar( tests[i].cp, 0, ref, pos, NULL, 0 );
+            ok( ret == len, "got %d, expected %u\n", ret, len );
+
+            SetLastError( 0xdeadbeef );
+            ret = MultiByteToWideChar( tests[i].cp, 0, ref, pos, wbuf, len - 1 );
+            ok( !ret, "got %d\n", ret );
+            ok( GetLastError() == ERROR_INSUFFICIENT_BUFFER, "got error %u\n", GetLastError() );
+            SetLastError( 0xdeadbeef );
+            ret = WideCharToMultiByte( tests[i].cp, 0, src, len, buf, pos - 1, NULL, NULL );
+            ok( !ret, "got %d\n", ret );
+            ok( GetLastError() == ERROR_INSUFFICIENT_BUFFER, "got error %u\n", GetLastError() );
+
+            if (winetest_interactive)
+            {
+                ticks = GetTickCount();
+                for (k = 0; k < loops; k++) MultiByteToWideChar( tests[i].cp, 0, ref, pos, wbuf, len );
+                ticks = GetTickCount() - ticks;
+                trace( "MultiByteToWideChar: %u chars in %u ms\n", len * loops, ticks );
+
+                ticks = GetTickCount();
+                for (k = 0; k < loops; k++) WideCharToMultiByte( tests[i].cp, 0, src, len, buf, len * 4, NULL, NULL );
+                ticks = GetTickCount() - ticks;
+                trace( "WideCharToMultiByte: %u chars in %u ms\n", len * loops, ticks );
+            }
+
+            winetest_pop_context();
+        }
+    }
+
+    HeapFree( GetProcessHeap(), 0, src );
+    HeapFree( GetProcessHeap(), 0, wbuf );
+    HeapFree( GetProcessHeap(), 0, ref );
+    HeapFree( GetProcessHeap(), 0, buf );
+}
+
 START_TEST(codepage)
 {
     BOOL bUsedDefaultChar;
@@ -1330,4 +1424,5 @@ START_TEST(codepage)
     test_threadcp();
 
     test_dbcs_to_widechar();
+    test_mixed_ascii_conversion();
 }
@@ -3303,6 +3303,83 @@ static void test_unicode_sorting(void)
     ok(ret1 == ret2, "Got ret1=%d, ret2=%d\n", ret1, ret2);
 }
 
+static void test_sortkey_index(void)
+{
+    static const WCHAR alphabet[] = L"abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789 \x00e4\x00f6\x00e5\x00e9\x00fc";
+    static const WCHAR *locales[] = { L"en-US", L"sv-SE" };
+    const unsigned int count = winetest_interactive ? 100000 : 5000;
+    BYTE key1[256], key2[256], *keys;
+    WCHAR *strings, *str;
+    int *lens, len1, len2, result, cmp;
+    unsigned int i, j, l, seed = 0x1234;
+    DWORD start, total;
+
+    if (!pLCMapStringEx || !pCompareStringEx)
+    {
+        win_skip("LCMapStringEx not available\n");
+        return;
+    }
+
+    /* locale exceptions must be honored: a-umlaut sorts after z in Swedish only */
+    len1 = pLCMapStringEx(L"en-US", LCMAP_SORTKEY, L"\x00e4", -1, (WCHAR *)key1, sizeof(key1), NULL, NULL, 0);
+    len2 = pLCMapStringEx(L"en-US", LCMAP_SORTKEY, L"z", -1, (WCHAR *)key2, sizeof(key2), NULL, NULL, 0);
+    ok(len1 && len2, "LCMapStringEx failed\n");
+    ok(memcmp(key1, key2, min(len1, len2)) < 0, "expected a-umlaut before z in en-US\n");
+    len1 = pLCMapStringEx(L"sv-SE", LCMAP_SORTKEY, L"\x00e4", -1, (WCHAR *)key1, sizeof(key1), NULL, NULL, 0);
+    len2 = pLCMapStringEx(L"sv-SE", LCMAP_SORTKEY, L"z", -1, (WCHAR *)key2, sizeof(key2), NULL, NULL, 0);
+    ok(len1 && len2, "LCMapStringEx failed\n");
+    ok(memcmp(key1, key2, min(len1, len2)) > 0, "expected a-umlaut after z in sv-SE\n");
+
+    strings = HeapAlloc(GetProcessHeap(), 0, count * 17 * sizeof(WCHAR));
+    lens = HeapAlloc(GetProcessHeap(), 0, count * sizeof(*lens));
+    keys = HeapAlloc(GetProcessHeap(), 0, count * 128);
+    for (i = 0, str = strings; i < count; i++, str += 17)
+    {
+        seed = seed * 1103515245 + 12345;
+        l = 4 + (seed >> 16) % 13;
+        for (j = 0; j < l; j++)
+        {
+            seed = seed * 1103515245 + 12345;
+            str[j] = alphabet[(seed >> 16) % (ARRAY_SIZE(alphabet) - 1)];
+        }
+        str[l] = 0;
+    }
+
+    for (l = 0; l < ARRAY_SIZE(locales); l++)
+    {
+        /* build the keys of a sorted index, like a database would */
+        start = GetTickCount();
+        for (i = 0, str = strings; i < count; i++, str += 17)
+            lens[i] = pLCMapStringEx(locales[l], LCMAP_SORTKEY, str, -1, (WCHAR *)(keys + i * 128), 128, NULL, NULL, 0);
+        total = GetTickCount() - start;
+        if (winetest_interactive)
+            trace("%s: %u sort keys in %u ms\n", wine_dbgstr_w(locales[l]), count, total);
+
+        for (i = 0; i < count; i++)
+            if (!lens[i]) break;
+        ok(i == count, "%s: LCMapStringEx failed for string %u\n", wine_dbgstr_w(locales[l]), i);
+
+        for (i = 0; i + 1 < count; i += count / 100)
+        {
+            str = strings + i * 17;
+            len1 = pLCMapStringEx(locales[l], LCMAP_SORTKEY, str, -1, (WCHAR *)key1, sizeof(key1), NULL, NULL, 0);
+            ok(len1 == lens[i] && !memcmp(key1, keys + i * 128, len1),
+               "%s: got different sort key for %s\n", wine_dbgstr_w(locales[l]), wine_dbgstr_w(str));
+
+            cmp = memcmp(keys + i * 128, keys + (i + 1) * 128, min(lens[i], lens[i + 1]));
+            if (!cmp) cmp = lens[i] - lens[i + 1];
+            result = pCompareStringEx(locales[l], 0, str, -1, str + 17, -1, NULL, NULL, 0);
+            ok((cmp < 0 && result == CSTR_LESS_THAN) || (cmp > 0 && result == CSTR_GREATER_THAN) ||
+               (!cmp && result == CSTR_EQUAL), "%s: %s vs %s, sort keys %d, CompareStringEx %d\n",
+               wine_dbgstr_w(locales[l]), wine_dbgstr_w(str), wine_dbgstr_w(str + 17), cmp, result);
+        }
+    }
+
+    HeapFree(GetProcessHeap(), 0, keys);
+    HeapFree(GetProcessHeap(), 0, lens);
+    HeapFree(GetProcessHeap(), 0, strings);
+}
+
 static void test_FoldStringA(void)
 {
   int ret, i, j;
@@ -7369,4 +7446,5 @@ START_TEST(locale)
   test_geo_name();
   test_sorting();
   test_unicode_sorting();
+  test_sortkey_index();
 }
@@ -3232,6 +3232,94 @@ static void test_zigzag_event(void)
     trace("count: %d\n", zigzag_count[0]);
 }
 
+struct wait_latency_params
+{
+    HANDLE events[MAXIMUM_WAIT_OBJECTS];
+    DWORD count;
+    DWORD iterations;
+    HANDLE done;
+    LONG expected;
+    LONG mismatches;
+    BOOL recreate;
+};
+
+static DWORD CALLBACK wait_latency_thread(void *arg)
+{
+    struct wait_latency_params *params = arg;
+    DWORD i, ret;
+
+    for (i = 0; i < params->iterations; i++)
+    {
+        ret = WaitForMultipleObjects(params->count, params->events, FALSE, 5000);
+        if (ret != WAIT_OBJECT_0 + params->expected) InterlockedIncrement(&params->mismatches);
+        if (params->recreate)
+        {
+            /* the new event usually gets the same handle, and under esync the
+             * same fd, as the one it replaces */
+            CloseHandle(params->events[params->expected]);
+            params->events[params->expected] = CreateEventA(NULL, FALSE, FALSE, NULL);
+        }
+        SetEvent(params->done);
+    }
+    return 0;
+}
+
+static void test_wait_latency(void)
+{
+    /* Wake a thread waiting on a growing number of events, and make sure it
+     * always reports the event that was signaled. We also print the average
+     * round trip time for each handle count. The second pass replaces the
+     * signaled event after each wakeup, so the next wait is on a new object. */
+
+    static const DWORD counts[] = {1, 2, 4, 8, 16, 32, MAXIMUM_WAIT_OBJECTS};
+    struct wait_latency_params params;
+    LARGE_INTEGER freq, start, end;
+    DWORD i, j, ret;
+    HANDLE thread;
+
+    QueryPerformanceFrequency(&freq);
+    params.iterations = winetest_interactive ? 20000 : 2000;
+    params.done = CreateEventA(NULL, FALSE, FALSE, NULL);
+    for (i = 0; i < MAXIMUM_WAIT_OBJECTS; i++)
+    {
+        params.events[i] = CreateEventA(NULL, FALSE, FALSE, NULL);
+        ok(params.events[i] != NULL, "CreateEvent failed: %u\n", GetLastError());
+    }
+
+    for (i = 0; i < 2 * ARRAY_SIZE(counts); i++)
+    {
+        params.count = counts[i % ARRAY_SIZE(counts)];
+        params.recreate = i >= ARRAY_SIZE(counts);
+        params.mismatches = 0;
+        thread = CreateThread(NULL, 0, wait_latency_thread, &params, 0, NULL);
+
+        QueryPerformanceCounter(&start);
+        for (j = 0; j < params.iterations; j++)
+        {
+            /* walk through all the events, the last ones are the slowest to find */
+            params.expected = params.count - 1 - j % params.count;
+            SetEvent(params.events[params.expected]);
+            ret = WaitForSingleObject(params.done, 5000);
+            if (ret) break;
+        }
+        QueryPerformanceCounter(&end);
+        ok(!ret, "wait failed: %u\n", ret);
+
+        ret = WaitForSingleObject(thread, 5000);
+        ok(!ret, "wait failed: %u\n", ret);
+        CloseHandle(thread);
+        ok(!params.mismatches, "%u handles%s: got %d wrong wakeups\n", params.count,
+           params.recreate ? " (recreated)" : "", params.mismatches);
+
+        trace("%2u handles%s: %u wakeups, %.2f us per round trip\n", params.count,
+              params.recreate ? " (recreated)" : "", j,
+              j ? (end.QuadPart - start.QuadPart) * 1000000.0 / freq.QuadPart / j : 0.0);
+    }
+
+    for (i = 0; i < MAXIMUM_WAIT_OBJECTS; i++) CloseHandle(params.events[i]);
+    CloseHandle(params.done);
+}
+
 START_TEST(sync)
 {
     char **argv;
@@ -3299,5 +3387,6 @@ START_TEST(sync)
     test_alertable_wait();
     test_apc_deadlock();
     test_zigzag_event();
+    test_wait_latency();
     test_crit_section();
 }
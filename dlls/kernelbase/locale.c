@@ -25,6 +25,9 @@
 
 #include <stdarg.h>
 #include <stdlib.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #include "ntstatus.h"
 #define WIN32_NO_STATUS
@@ -656,6 +659,41 @@ static const struct sortguid *find_sortguid( const GUID *guid )
 }
 
 
+/* locale names already resolved by get_language_sort, entries are never modified once published */
+struct sort_cache_entry
+{
+    const struct sortguid *sort;
+    WCHAR                  name[LOCALE_NAME_MAX_LENGTH];
+};
+
+static struct sort_cache_entry *sort_cache[16];
+
+static const struct sortguid *find_cached_language_sort( const WCHAR *locale )
+{
+    struct sort_cache_entry *entry;
+    unsigned int i;
+
+    for (i = 0; i < ARRAY_SIZE(sort_cache) && (entry = sort_cache[i]); i++)
+        if (!wcscmp( entry->name, locale )) return entry->sort;
+    return NULL;
+}
+
+static void cache_language_sort( const WCHAR *locale, const struct sortguid *sort )
+{
+    struct sort_cache_entry *entry;
+    unsigned int i;
+
+    if (!sort || wcslen( locale ) >= LOCALE_NAME_MAX_LENGTH) return;
+    if (!(entry = RtlAllocateHeap( GetProcessHeap(), 0, sizeof(*entry) ))) return;
+    entry->sort = sort;
+    lstrcpyW( entry->name, locale );
+
+    for (i = 0; i < ARRAY_SIZE(sort_cache); i++)
+        if (!InterlockedCompareExchangePointer( (void **)&sort_cache[i], entry, NULL )) return;
+    RtlFreeHeap( GetProcessHeap(), 0, entry );
+}
+
+
 static const struct sortguid *get_language_sort( const WCHAR *locale )
 {
     WCHAR *p, *end, buffer[LOCALE_NAME_MAX_LENGTH], guidstr[39];
@@ -670,7 +708,12 @@ static const struct sortguid *get_language_sort( const WCHAR *locale )
         if (current_locale_sort) return current_locale_sort;
         GetUserDefaultLocaleName( buffer, ARRAY_SIZE( buffer ));
     }
-    else lstrcpynW( buffer, locale, LOCALE_NAME_MAX_LENGTH );
+    else
+    {
+        /* sort key and string comparison functions get here on every call */
+        if ((ret = find_cached_language_sort( locale ))) return ret;
+        lstrcpynW( buffer, locale, LOCALE_NAME_MAX_LENGTH );
+    }
 
     if (buffer[0] && !RegOpenKeyExW( nls_key, L"Sorting\\Ids", 0, KEY_READ, &key ))
     {
@@ -695,6 +738,7 @@ static const struct sortguid *get_language_sort( const WCHAR *locale )
     ret = find_sortguid( &default_sort_guid );
 done:
     RegCloseKey( key );
+    if (locale != LOCALE_NAME_USER_DEFAULT) cache_language_sort( locale, ret );
     return ret;
 }
 
@@ -1491,6 +1535,89 @@ static int mbstowcs_decompose( const CPTABLEINFO *info, const unsigned char *src
 }
 
 
+/* whether code pages map 7-bit ASCII to itself, keyed on the code page number since
+ * tables are caller-supplied. Each entry holds the code page in the low word and
+ * ASCII_* flags in the high word, so that it can be read and replaced atomically. */
+#define ASCII_MB_CHECKED  0x10000
+#define ASCII_MB          0x20000
+#define ASCII_WC_CHECKED  0x40000
+#define ASCII_WC          0x80000
+static LONG ascii_codepages[16];
+
+static BOOL is_ascii_table( const CPTABLEINFO *info, BOOL wctomb )
+{
+    LONG *entry = &ascii_codepages[info->CodePage % ARRAY_SIZE(ascii_codepages)];
+    LONG checked = wctomb ? ASCII_WC_CHECKED : ASCII_MB_CHECKED;
+    LONG ascii = wctomb ? ASCII_WC : ASCII_MB;
+    LONG val = *(volatile LONG *)entry;
+    unsigned int i;
+
+    if (LOWORD(val) == info->CodePage && (val & checked)) return (val & ascii) != 0;
+
+    for (i = 0; i < 0x80; i++)
+    {
+        if (!wctomb)
+        {
+            if (info->MultiByteTable[i] != i) break;
+            if (info->DBCSCodePage && info->DBCSOffsets[i]) break;
+        }
+        else if (info->DBCSCodePage)
+        {
+            if (((const USHORT *)info->WideCharTable)[i] != i) break;
+        }
+        else if (((const unsigned char *)info->WideCharTable)[i] != i) break;
+    }
+
+    /* keep the other direction if it's for the same code page, losing it to a race is harmless */
+    if (LOWORD(val) != info->CodePage) val = info->CodePage;
+    val |= checked;
+    if (i == 0x80) val |= ascii;
+    InterlockedExchange( entry, val );
+    return i == 0x80;
+}
+
+
+/* copy a run of 7-bit ASCII chars, returns the number of chars copied */
+static inline unsigned int copy_ascii_to_unicode( WCHAR *dst, const char *src, unsigned int len )
+{
+    unsigned int i = 0;
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128();
+
+    for ( ; i + 16 <= len; i += 16)
+    {
+        __m128i val = _mm_loadu_si128( (const __m128i *)(src + i) );
+        if (_mm_movemask_epi8( val )) break;
+        _mm_storeu_si128( (__m128i *)(dst + i), _mm_unpacklo_epi8( val, zero ));
+        _mm_storeu_si128( (__m128i *)(dst + i + 8), _mm_unpackhi_epi8( val, zero ));
+    }
+#endif
+    for ( ; i < len && !(src[i] & 0x80); i++) dst[i] = src[i];
+    return i;
+}
+
+
+/* copy a run of 7-bit ASCII chars, returns the number of chars copied */
+static inline unsigned int copy_unicode_to_ascii( char *dst, const WCHAR *src, unsigned int len )
+{
+    unsigned int i = 0;
+#ifdef __SSE2__
+    const __m128i mask = _mm_set1_epi16( 0xff80 ), zero = _mm_setzero_si128();
+
+    for ( ; i + 16 <= len; i += 16)
+    {
+        __m128i lo = _mm_loadu_si128( (const __m128i *)(src + i) );
+        __m128i hi = _mm_loadu_si128( (const __m128i *)(src + i + 8) );
+        __m128i high_bits = _mm_and_si128( _mm_or_si128( lo, hi ), mask );
+        if (_mm_movemask_epi8( _mm_cmpeq_epi16( high_bits, zero )) != 0xffff) break;
+        _mm_storeu_si128( (__m128i *)(dst + i), _mm_packus_epi16( lo, hi ));
+    }
+#endif
+    for ( ; i < len && src[i] < 0x80; i++) dst[i] = src[i];
+    return i;
+}
+
+
 static int mbstowcs_sbcs( const CPTABLEINFO *info, const unsigned char *src, int srclen,
                           WCHAR *dst, int dstlen )
 {
@@ -1506,6 +1633,20 @@ static int mbstowcs_sbcs( const CPTABLEINFO *info, const unsigned char *src, int
         ret = 0;
     }
 
+    if (srclen >= 16 && is_ascii_table( info, FALSE ))
+    {
+        while (srclen)
+        {
+            unsigned int len = copy_ascii_to_unicode( dst, (const char *)src, srclen );
+
+            src += len;
+            dst += len;
+            srclen -= len;
+            for ( ; srclen && (*src & 0x80); srclen--) *dst++ = table[*src++];
+        }
+        return ret;
+    }
+
     while (srclen >= 16)
     {
         dst[0]  = table[src[0]];
@@ -1559,7 +1700,8 @@ static int mbstowcs_dbcs( const CPTABLEINFO *info, const unsigned char *src, int
                           WCHAR *dst, int dstlen )
 {
     USHORT off;
-    int i;
+    int i, len;
+    BOOL ascii;
 
     if (!dstlen)
     {
@@ -1568,8 +1710,18 @@ static int mbstowcs_dbcs( const CPTABLEINFO *info, const unsigned char *src, int
         return i;
     }
 
+    ascii = srclen >= 16 && is_ascii_table( info, FALSE );
     for (i = dstlen; srclen && i; i--, srclen--, src++, dst++)
     {
+        if (ascii && *src < 0x80)
+        {
+            len = copy_ascii_to_unicode( dst, (const char *)src, min( srclen, i )) - 1;
+            i -= len;  /* the last char is accounted for by the loop */
+            srclen -= len;
+            src += len;
+            dst += len;
+            continue;
+        }
         if ((off = info->DBCSOffsets[*src]))
         {
             if (srclen > 1 && src[1])
@@ -1809,6 +1961,20 @@ static int wcstombs_sbcs( const CPTABLEINFO *info, const WCHAR *src, unsigned in
         ret = 0;
     }
 
+    if (srclen >= 16 && is_ascii_table( info, TRUE ))
+    {
+        while (srclen)
+        {
+            unsigned int len = copy_unicode_to_ascii( dst, src, srclen );
+
+            src += len;
+            dst += len;
+            srclen -= len;
+            for ( ; srclen && *src >= 0x80; srclen--) *dst++ = table[*src++];
+        }
+        return ret;
+    }
+
     while (srclen >= 16)
     {
         dst[0]  = table[src[0]];
@@ -1862,7 +2028,8 @@ static int wcstombs_dbcs( const CPTABLEINFO *info, const WCHAR *src, unsigned in
                           char *dst, unsigned int dstlen )
 {
     const USHORT *table = info->WideCharTable;
-    int i;
+    int i, len;
+    BOOL ascii;
 
     if (!dstlen)
     {
@@ -1870,8 +2037,18 @@ static int wcstombs_dbcs( const CPTABLEINFO *info, const WCHAR *src, unsigned in
         return i;
     }
 
+    ascii = srclen >= 16 && is_ascii_table( info, TRUE );
     for (i = dstlen; srclen && i; i--, srclen--, src++)
     {
+        if (ascii && *src < 0x80)
+        {
+            len = copy_unicode_to_ascii( dst, src, min( srclen, i ));
+            i -= len - 1;  /* the last char is accounted for by the loop */
+            srclen -= len - 1;
+            src += len - 1;
+            dst += len;
+            continue;
+        }
         if (table[*src] & 0xff00)
         {
             if (i == 1) break;  /* do not output a partial char */
@@ -2427,11 +2604,55 @@ static DWORD sortkey_get_exception(WCHAR ch, const struct sortguid *locale)
     return 0;
 }
 
-static void sortkey_get_char(struct character_info *info, WCHAR ch, const struct sortguid *locale)
+/* Return the sortkey table of a locale, with its exceptions already merged
+ * into the default weights so that every character costs a single lookup.
+ * The tables are built on first use and kept for the lifetime of the process. */
+static const DWORD *sortkey_get_table(const struct sortguid *locale)
+{
+    static DWORD **tables;
+    DWORD **ptr, *table;
+    unsigned int ch, idx;
+    DWORD value;
+
+    if (!locale || !locale->except)
+        return sort.keys;
+
+    idx = locale - sort.guids;
+    if (!(ptr = tables))
+    {
+        if (!(ptr = RtlAllocateHeap(GetProcessHeap(), HEAP_ZERO_MEMORY, sort.guid_count * sizeof(*ptr))))
+            goto failed;
+        if (InterlockedCompareExchangePointer((void **)&tables, ptr, NULL))
+        {
+            RtlFreeHeap(GetProcessHeap(), 0, ptr);
+            ptr = tables;
+        }
+    }
+    if ((table = ptr[idx]))
+        return table;
+
+    if (!(table = RtlAllocateHeap(GetProcessHeap(), 0, 0x10000 * sizeof(*table))))
+        goto failed;
+    for (ch = 0; ch < 0x10000; ch++)
+    {
+        value = sortkey_get_exception(ch, locale);
+        table[ch] = value ? value : sort.keys[ch];
+    }
+    if (InterlockedCompareExchangePointer((void **)&ptr[idx], table, NULL))
+    {
+        RtlFreeHeap(GetProcessHeap(), 0, table);
+        table = ptr[idx];
+    }
+    return table;
+
+failed:
+    ERR("no memory for sort table of %s, ignoring locale exceptions\n", debugstr_guid(&locale->id));
+    return sort.keys;
+}
+
+static void sortkey_get_char(struct character_info *info, WCHAR ch, const DWORD *keys)
 {
-    DWORD value = sortkey_get_exception(ch, locale);
-    if (!value)
-        value = sort.keys[ch];
+    DWORD value = keys[ch];
     info->weight_case = value >> 24;
     info->weight_diacritic = (value >> 16) & 0xff;
     info->script_member = (value >> 8) & 0xff;
@@ -2483,18 +2704,18 @@ static void sortkey_add_diacritic_weight(struct sortkey_data *data, BYTE value,
         *last_weighted_pos = data->buffer_pos;
 }
 
-static void sortkey_handle_expansion_main(struct sortkey_data *data, int flags, WCHAR c, const struct sortguid *locale)
+static void sortkey_handle_expansion_main(struct sortkey_data *data, int flags, WCHAR c, const DWORD *keys)
 {
     struct character_info info;
     const WCHAR *expansion = sortkey_get_expansion(c);
     if (expansion)
     {
         /* Expansion characters always follow default character logic, ignoring the script_member value */
-        sortkey_handle_expansion_main(data, flags, expansion[0], locale);
-        sortkey_handle_expansion_main(data, flags, expansion[1], locale);
+        sortkey_handle_expansion_main(data, flags, expansion[0], keys);
+        sortkey_handle_expansion_main(data, flags, expansion[1], keys);
         return;
     }
-    sortkey_get_char(&info, c, locale);
+    sortkey_get_char(&info, c, keys);
     if (info.script_member != SORTKEY_UNSORTABLE)
     {
         sortkey_add_weight(data, info.script_member);
@@ -2504,11 +2725,11 @@ static void sortkey_handle_expansion_main(struct sortkey_data *data, int flags,
     }
 }
 
-static void sortkey_add_main_weights(struct sortkey_data *data, int flags, WCHAR c, const struct sortguid *locale)
+static void sortkey_add_main_weights(struct sortkey_data *data, int flags, WCHAR c, const DWORD *keys)
 {
     struct character_info info;
 
-    sortkey_get_char(&info, c, locale);
+    sortkey_get_char(&info, c, keys);
 
     switch (info.script_member)
     {
@@ -2516,7 +2737,7 @@ static void sortkey_add_main_weights(struct sortkey_data *data, int flags, WCHAR
         break;
 
     case SORTKEY_EXPANSION:
-        sortkey_handle_expansion_main(data, flags, c, locale);
+        sortkey_handle_expansion_main(data, flags, c, keys);
         break;
 
     case SORTKEY_DIACRITIC:
@@ -2575,18 +2796,18 @@ static void sortkey_add_main_weights(struct sortkey_data *data, int flags, WCHAR
     }
 }
 
-static void sortkey_handle_expansion_diacritic(struct sortkey_data *data, int flags, WCHAR c, int *last_weighted_pos, const struct sortguid *locale)
+static void sortkey_handle_expansion_diacritic(struct sortkey_data *data, int flags, WCHAR c, int *last_weighted_pos, const DWORD *keys)
 {
     struct character_info info;
     const WCHAR *expansion = sortkey_get_expansion(c);
     if (expansion)
     {
         /* Expansion characters always follow default character logic, ignoring the script_member value */
-        sortkey_handle_expansion_diacritic(data, flags, expansion[0], last_weighted_pos, locale);
-        sortkey_handle_expansion_diacritic(data, flags, expansion[1], last_weighted_pos, locale);
+        sortkey_handle_expansion_diacritic(data, flags, expansion[0], last_weighted_pos, keys);
+        sortkey_handle_expansion_diacritic(data, flags, expansion[1], last_weighted_pos, keys);
         return;
     }
-    sortkey_get_char(&info, c, locale);
+    sortkey_get_char(&info, c, keys);
     if (info.script_member != SORTKEY_UNSORTABLE)
     {
         if (!sortkey_is_PUA(info.script_member))
@@ -2594,12 +2815,12 @@ static void sortkey_handle_expansion_diacritic(struct sortkey_data *data, int fl
     }
 }
 
-static void sortkey_add_diacritic_weights(struct sortkey_data *data, int flags, WCHAR c, int *last_weighted_pos, int diacritic_start_pos, const struct sortguid *locale)
+static void sortkey_add_diacritic_weights(struct sortkey_data *data, int flags, WCHAR c, int *last_weighted_pos, int diacritic_start_pos, const DWORD *keys)
 {
     struct character_info info;
     int old_pos;
 
-    sortkey_get_char(&info, c, locale);
+    sortkey_get_char(&info, c, keys);
 
     switch (info.script_member)
     {
@@ -2607,7 +2828,7 @@ static void sortkey_add_diacritic_weights(struct sortkey_data *data, int flags,
         break;
 
     case SORTKEY_EXPANSION:
-        sortkey_handle_expansion_diacritic(data, flags, c, last_weighted_pos, locale);
+        sortkey_handle_expansion_diacritic(data, flags, c, last_weighted_pos, keys);
         break;
 
     case SORTKEY_DIACRITIC:
@@ -2666,29 +2887,29 @@ static void sortkey_add_diacritic_weights(struct sortkey_data *data, int flags,
     }
 }
 
-static void sortkey_handle_expansion_case(struct sortkey_data *data, int flags, WCHAR c, const struct sortguid *locale)
+static void sortkey_handle_expansion_case(struct sortkey_data *data, int flags, WCHAR c, const DWORD *keys)
 {
     struct character_info info;
     const WCHAR *expansion = sortkey_get_expansion(c);
     if (expansion)
     {
         /* Expansion characters always follow default character logic, ignoring the script_member value */
-        sortkey_handle_expansion_case(data, flags, expansion[0], locale);
-        sortkey_handle_expansion_case(data, flags, expansion[1], locale);
+        sortkey_handle_expansion_case(data, flags, expansion[0], keys);
+        sortkey_handle_expansion_case(data, flags, expansion[1], keys);
         return;
     }
-    sortkey_get_char(&info, c, locale);
+    sortkey_get_char(&info, c, keys);
     if (info.script_member != SORTKEY_UNSORTABLE)
     {
         sortkey_add_case_weight(data, flags, info.weight_case);
     }
 }
 
-static void sortkey_add_case_weights(struct sortkey_data *data, int flags, WCHAR c, const struct sortguid *locale)
+static void sortkey_add_case_weights(struct sortkey_data *data, int flags, WCHAR c, const DWORD *keys)
 {
     struct character_info info;
 
-    sortkey_get_char(&info, c, locale);
+    sortkey_get_char(&info, c, keys);
 
     switch (info.script_member)
     {
@@ -2696,7 +2917,7 @@ static void sortkey_add_case_weights(struct sortkey_data *data, int flags, WCHAR
         break;
 
     case SORTKEY_EXPANSION:
-        sortkey_handle_expansion_case(data, flags, c, locale);
+        sortkey_handle_expansion_case(data, flags, c, keys);
         break;
 
     case SORTKEY_DIACRITIC:
@@ -2738,12 +2959,12 @@ static void sortkey_add_case_weights(struct sortkey_data *data, int flags, WCHAR
     }
 }
 
-static void sortkey_add_special_weights(struct sortkey_data *data, int flags, WCHAR c, const struct sortguid *locale)
+static void sortkey_add_special_weights(struct sortkey_data *data, int flags, WCHAR c, const DWORD *keys)
 {
     struct character_info info;
     BYTE weight_second;
 
-    sortkey_get_char(&info, c, locale);
+    sortkey_get_char(&info, c, keys);
 
     if (info.script_member == SORTKEY_PUNCTUATION)
     {
@@ -2756,11 +2977,11 @@ static void sortkey_add_special_weights(struct sortkey_data *data, int flags, WC
     }
 }
 
-static void sortkey_add_extra_weights_small(struct sortkey_data *data, int flags, WCHAR c, const struct sortguid *locale)
+static void sortkey_add_extra_weights_small(struct sortkey_data *data, int flags, WCHAR c, const DWORD *keys)
 {
     struct character_info info;
 
-    sortkey_get_char(&info, c, locale);
+    sortkey_get_char(&info, c, keys);
 
     if (info.script_member == SORTKEY_JAPANESE)
     {
@@ -2778,11 +2999,11 @@ static void sortkey_add_extra_weights_small(struct sortkey_data *data, int flags
     }
 }
 
-static void sortkey_add_extra_weights_kana(struct sortkey_data *data, int flags, WCHAR c, const struct sortguid *locale)
+static void sortkey_add_extra_weights_kana(struct sortkey_data *data, int flags, WCHAR c, const DWORD *keys)
 {
     struct character_info info;
 
-    sortkey_get_char(&info, c, locale);
+    sortkey_get_char(&info, c, keys);
 
     if (info.script_member == SORTKEY_JAPANESE)
     {
@@ -2799,11 +3020,11 @@ static void sortkey_add_extra_weights_kana(struct sortkey_data *data, int flags,
     }
 }
 
-static void sortkey_add_extra_weights_width(struct sortkey_data *data, int flags, WCHAR c, const struct sortguid *locale)
+static void sortkey_add_extra_weights_width(struct sortkey_data *data, int flags, WCHAR c, const DWORD *keys)
 {
     struct character_info info;
 
-    sortkey_get_char(&info, c, locale);
+    sortkey_get_char(&info, c, keys);
 
     if (info.script_member == SORTKEY_JAPANESE)
     {
@@ -2827,7 +3048,7 @@ static int sortkey_generate(int flags, const WCHAR *locale_name, const WCHAR *st
     static const BYTE SORTKEY_EXTRA_SEPARATOR = 0xff;
     int i;
     struct sortkey_data data;
-    const struct sortguid *locale = get_language_sort(locale_name);
+    const DWORD *keys = sortkey_get_table(get_language_sort(locale_name));
 
     data.buffer = buffer;
     data.buffer_pos = 0;
@@ -2839,7 +3060,7 @@ static int sortkey_generate(int flags, const WCHAR *locale_name, const WCHAR *st
 
     /* Main weights */
     for (i = 0; i < str_len; i++)
-        sortkey_add_main_weights(&data, flags, str[i], locale);
+        sortkey_add_main_weights(&data, flags, str[i], keys);
     sortkey_add_weight(&data, SORTKEY_SEPARATOR);
 
     /* Diacritic weights */
@@ -2848,7 +3069,7 @@ static int sortkey_generate(int flags, const WCHAR *locale_name, const WCHAR *st
         int diacritic_start_pos = data.buffer_pos;
         int last_weighted_pos = data.buffer_pos;
         for (i = 0; i < str_len; i++)
-            sortkey_add_diacritic_weights(&data, flags, str[i], &last_weighted_pos, diacritic_start_pos, locale);
+            sortkey_add_diacritic_weights(&data, flags, str[i], &last_weighted_pos, diacritic_start_pos, keys);
         /* Remove all weights <= SORTKEY_MIN_WEIGHT from the end */
         data.buffer_pos = last_weighted_pos;
     }
@@ -2856,24 +3077,24 @@ static int sortkey_generate(int flags, const WCHAR *locale_name, const WCHAR *st
 
     /* Case weights */
     for (i = 0; i < str_len; i++)
-        sortkey_add_case_weights(&data, flags, str[i], locale);
+        sortkey_add_case_weights(&data, flags, str[i], keys);
     sortkey_add_weight(&data, SORTKEY_SEPARATOR);
 
     /* Extra weights */
     for (i = 0; i < str_len; i++)
-        sortkey_add_extra_weights_small(&data, flags, str[i], locale);
+        sortkey_add_extra_weights_small(&data, flags, str[i], keys);
     sortkey_add_weight(&data, SORTKEY_EXTRA_SEPARATOR);
     for (i = 0; i < str_len; i++)
-        sortkey_add_extra_weights_kana(&data, flags, str[i], locale);
+        sortkey_add_extra_weights_kana(&data, flags, str[i], keys);
     sortkey_add_weight(&data, SORTKEY_EXTRA_SEPARATOR);
     for (i = 0; i < str_len; i++)
-        sortkey_add_extra_weights_width(&data, flags, str[i], locale);
+        sortkey_add_extra_weights_width(&data, flags, str[i], keys);
     sortkey_add_weight(&data, SORTKEY_EXTRA_SEPARATOR);
     sortkey_add_weight(&data, SORTKEY_SEPARATOR);
 
     /* Special weights */
     for (i = 0; i < str_len; i++)
-        sortkey_add_special_weights(&data, flags, str[i], locale);
+        sortkey_add_special_weights(&data, flags, str[i], keys);
     sortkey_add_weight(&data, SORTKEY_TERMINATOR);
 
     if (data.buffer_pos <= buffer_len || !buffer)
@@ -2904,7 +3125,7 @@ static int sortkey_compare(int flags, const WCHAR *locale_name, const WCHAR *str
     int i1, i2;
     int ret;
     struct sortkey_data data1, data2;
-    const struct sortguid *locale = get_language_sort(locale_name);
+    const DWORD *keys = sortkey_get_table(get_language_sort(locale_name));
     int diacritic_start_pos1;
     int last_weighted_pos1;
     int diacritic_start_pos2;
@@ -2930,11 +3151,11 @@ static int sortkey_compare(int flags, const WCHAR *locale_name, const WCHAR *str
         int pos_weight_compare = min(data1.buffer_pos, data2.buffer_pos);
         if (i1 < str1_len)
         {
-            sortkey_add_main_weights(&data1, flags, str1[i1], locale);
+            sortkey_add_main_weights(&data1, flags, str1[i1], keys);
         }
         if (i2 < str2_len)
         {
-            sortkey_add_main_weights(&data2, flags, str2[i2], locale);
+            sortkey_add_main_weights(&data2, flags, str2[i2], keys);
         }
 
         /* For clear differences we must return early without reading all characters. See tests. */
@@ -2961,11 +3182,11 @@ static int sortkey_compare(int flags, const WCHAR *locale_name, const WCHAR *str
         {
             if (i1 < str1_len)
             {
-                sortkey_add_diacritic_weights(&data1, flags, str1[i1], &last_weighted_pos1, diacritic_start_pos1, locale);
+                sortkey_add_diacritic_weights(&data1, flags, str1[i1], &last_weighted_pos1, diacritic_start_pos1, keys);
             }
             if (i2 < str2_len)
             {
-                sortkey_add_diacritic_weights(&data2, flags, str2[i2], &last_weighted_pos2, diacritic_start_pos2, locale);
+                sortkey_add_diacritic_weights(&data2, flags, str2[i2], &last_weighted_pos2, diacritic_start_pos2, keys);
             }
         }
         data1.buffer_pos = last_weighted_pos1;
@@ -2987,11 +3208,11 @@ static int sortkey_compare(int flags, const WCHAR *locale_name, const WCHAR *str
         int pos_weight_compare = min(data1.buffer_pos, data2.buffer_pos);
         if (i1 < str1_len)
         {
-            sortkey_add_case_weights(&data1, flags, str1[i1], locale);
+            sortkey_add_case_weights(&data1, flags, str1[i1], keys);
         }
         if (i2 < str2_len)
         {
-            sortkey_add_case_weights(&data2, flags, str2[i2], locale);
+            sortkey_add_case_weights(&data2, flags, str2[i2], keys);
         }
 
         ret = early_exit_sortkey_comparison(&data1, &data2, pos_weight_compare);
@@ -3010,11 +3231,11 @@ static int sortkey_compare(int flags, const WCHAR *locale_name, const WCHAR *str
         int pos_weight_compare = min(data1.buffer_pos, data2.buffer_pos);
         if (i1 < str1_len)
         {
-            sortkey_add_special_weights(&data1, flags, str1[i1], locale);
+            sortkey_add_special_weights(&data1, flags, str1[i1], keys);
         }
         if (i2 < str2_len)
         {
-            sortkey_add_special_weights(&data2, flags, str2[i2], locale);
+            sortkey_add_special_weights(&data2, flags, str2[i2], keys);
         }
 
         ret = early_exit_sortkey_comparison(&data1, &data2, pos_weight_compare);
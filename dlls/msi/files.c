@@ -286,13 +286,10 @@ static BOOL file_hash_matches( MSIPACKAGE *package, MSIFILE *file )
     return !memcmp( &hash, &file->hash, sizeof(hash) );
 }
 
-static msi_file_state calculate_install_state( MSIPACKAGE *package, MSIFILE *file )
+/* Checks that depend on the package state, returns msifs_invalid if the file on disk has to be examined. */
+static msi_file_state calculate_package_state( MSIPACKAGE *package, MSIFILE *file )
 {
     MSICOMPONENT *comp = file->Component;
-    VS_FIXEDFILEINFO *file_version;
-    WCHAR *font_version;
-    msi_file_state state;
-    DWORD size;
 
     comp->Action = msi_get_component_action( package, comp );
     if (!comp->Enabled || comp->Action != INSTALLSTATE_LOCAL || (comp->assembly && comp->assembly->installed))
@@ -305,8 +302,23 @@ static msi_file_state calculate_install_state( MSIPACKAGE *package, MSIFILE *fil
         TRACE("skipping %s (obsoleted by patch)\n", debugstr_w(file->File));
         return msifs_skipped;
     }
-    if ((msi_is_global_assembly( comp ) && !comp->assembly->installed) ||
-        msi_get_file_attributes( package, file->TargetPath ) == INVALID_FILE_ATTRIBUTES)
+    if (msi_is_global_assembly( comp ) && !comp->assembly->installed)
+    {
+        TRACE("installing %s (missing)\n", debugstr_w(file->File));
+        return msifs_missing;
+    }
+    return msifs_invalid;
+}
+
+/* Checks that only look at the file on disk, these may run on the thread pool. */
+static msi_file_state calculate_disk_state( MSIPACKAGE *package, MSIFILE *file )
+{
+    VS_FIXEDFILEINFO *file_version;
+    WCHAR *font_version;
+    msi_file_state state;
+    DWORD size;
+
+    if (msi_get_file_attributes( package, file->TargetPath ) == INVALID_FILE_ATTRIBUTES)
     {
         TRACE("installing %s (missing)\n", debugstr_w(file->File));
         return msifs_missing;
@@ -375,15 +387,52 @@ static msi_file_state calculate_install_state( MSIPACKAGE *package, MSIFILE *fil
     return msifs_present;
 }
 
+struct disk_state_op
+{
+    MSIFILEOP op;
+    MSIPACKAGE *package;
+    MSIFILE *file;
+};
+
+static void disk_state_proc( MSIFILEOP *op )
+{
+    struct disk_state_op *state_op = CONTAINING_RECORD( op, struct disk_state_op, op );
+
+    state_op->file->state = calculate_disk_state( state_op->package, state_op->file );
+    msi_free( state_op );
+}
+
 static void schedule_install_files(MSIPACKAGE *package)
 {
+    MSIFILEQUEUE queue;
+    BOOL use_queue;
     MSIFILE *file;
 
+    /* examining the files on disk, which includes hashing them, is done in parallel */
+    use_queue = msi_can_queue_file_ops( package ) && msi_init_file_queue( &queue );
+
+    LIST_FOR_EACH_ENTRY(file, &package->files, MSIFILE, entry)
+    {
+        struct disk_state_op *op;
+
+        if ((file->state = calculate_package_state( package, file )) != msifs_invalid) continue;
+
+        if (use_queue && (op = msi_alloc( sizeof(*op) )))
+        {
+            op->op.proc = disk_state_proc;
+            op->package = package;
+            op->file = file;
+            msi_queue_file_op( &queue, &op->op );
+        }
+        else file->state = calculate_disk_state( package, file );
+    }
+
+    if (use_queue) msi_destroy_file_queue( &queue );
+
     LIST_FOR_EACH_ENTRY(file, &package->files, MSIFILE, entry)
     {
         MSICOMPONENT *comp = file->Component;
 
-        file->state = calculate_install_state( package, file );
         if (file->state == msifs_overwrite && (comp->Attributes & msidbComponentAttributesNeverOverwrite))
         {
             TRACE("not overwriting %s\n", debugstr_w(file->TargetPath));
@@ -404,7 +453,7 @@ static UINT copy_file( MSIPACKAGE *package, MSIFILE *file, WCHAR *source )
     return ERROR_SUCCESS;
 }
 
-static UINT copy_install_file(MSIPACKAGE *package, MSIFILE *file, LPWSTR source)
+static UINT try_copy_install_file(MSIPACKAGE *package, MSIFILE *file, LPWSTR source)
 {
     UINT gle;
 
@@ -426,41 +475,113 @@ static UINT copy_install_file(MSIPACKAGE *package, MSIFILE *file, LPWSTR source)
         gle = copy_file( package, file, source );
         TRACE("Overwriting existing file: %d\n", gle);
     }
+    return gle;
+}
+
+static UINT copy_install_file_in_use(MSIPACKAGE *package, MSIFILE *file, LPWSTR source)
+{
+    WCHAR *tmpfileW, *pathW, *p;
+    DWORD len;
+    UINT gle;
+
+    TRACE("file in use, scheduling rename operation\n");
+
+    if (!(pathW = strdupW( file->TargetPath ))) return ERROR_OUTOFMEMORY;
+    if ((p = wcsrchr(pathW, '\\'))) *p = 0;
+    len = lstrlenW( pathW ) + 16;
+    if (!(tmpfileW = msi_alloc(len * sizeof(WCHAR))))
+    {
+        msi_free( pathW );
+        return ERROR_OUTOFMEMORY;
+    }
+    if (!GetTempFileNameW( pathW, L"msi", 0, tmpfileW )) tmpfileW[0] = 0;
+    msi_free( pathW );
+
+    if (msi_copy_file( package, source, tmpfileW, FALSE ) &&
+        msi_move_file( package, file->TargetPath, NULL, MOVEFILE_DELAY_UNTIL_REBOOT ) &&
+        msi_move_file( package, tmpfileW, file->TargetPath, MOVEFILE_DELAY_UNTIL_REBOOT ))
+    {
+        package->need_reboot_at_end = 1;
+        gle = ERROR_SUCCESS;
+    }
+    else
+    {
+        gle = GetLastError();
+        WARN("failed to schedule rename operation: %d)\n", gle);
+        DeleteFileW( tmpfileW );
+    }
+    msi_free(tmpfileW);
+
+    return gle;
+}
+
+static UINT copy_install_file(MSIPACKAGE *package, MSIFILE *file, LPWSTR source)
+{
+    UINT gle = try_copy_install_file( package, file, source );
+
     if (gle == ERROR_SHARING_VIOLATION || gle == ERROR_USER_MAPPED_FILE)
+        gle = copy_install_file_in_use( package, file, source );
+    return gle;
+}
+
+struct copy_op
+{
+    MSIFILEOP op;
+    struct list entry;
+    MSIPACKAGE *package;
+    MSIFILE *file;
+    WCHAR *source;
+    UINT error;
+};
+
+static void copy_op_proc( MSIFILEOP *op )
+{
+    struct copy_op *copy = CONTAINING_RECORD( op, struct copy_op, op );
+
+    copy->error = try_copy_install_file( copy->package, copy->file, copy->source );
+}
+
+/* Frees the queued copies without completing them, the queue must be idle. */
+static void discard_copy_ops( struct list *ops )
+{
+    struct copy_op *copy, *next;
+
+    LIST_FOR_EACH_ENTRY_SAFE( copy, next, ops, struct copy_op, entry )
     {
-        WCHAR *tmpfileW, *pathW, *p;
-        DWORD len;
+        list_remove( &copy->entry );
+        msi_free( copy->source );
+        msi_free( copy );
+    }
+}
 
-        TRACE("file in use, scheduling rename operation\n");
+/* Completes the queued copies in file order, the queue must be idle. */
+static UINT finish_copy_ops( struct list *ops )
+{
+    struct copy_op *copy, *next;
+    UINT rc = ERROR_SUCCESS;
 
-        if (!(pathW = strdupW( file->TargetPath ))) return ERROR_OUTOFMEMORY;
-        if ((p = wcsrchr(pathW, '\\'))) *p = 0;
-        len = lstrlenW( pathW ) + 16;
-        if (!(tmpfileW = msi_alloc(len * sizeof(WCHAR))))
-        {
-            msi_free( pathW );
-            return ERROR_OUTOFMEMORY;
-        }
-        if (!GetTempFileNameW( pathW, L"msi", 0, tmpfileW )) tmpfileW[0] = 0;
-        msi_free( pathW );
+    LIST_FOR_EACH_ENTRY_SAFE( copy, next, ops, struct copy_op, entry )
+    {
+        MSIFILE *file = copy->file;
 
-        if (msi_copy_file( package, source, tmpfileW, FALSE ) &&
-            msi_move_file( package, file->TargetPath, NULL, MOVEFILE_DELAY_UNTIL_REBOOT ) &&
-            msi_move_file( package, tmpfileW, file->TargetPath, MOVEFILE_DELAY_UNTIL_REBOOT ))
-        {
-            package->need_reboot_at_end = 1;
-            gle = ERROR_SUCCESS;
-        }
-        else
+        if (rc == ERROR_SUCCESS)
         {
-            gle = GetLastError();
-            WARN("failed to schedule rename operation: %d)\n", gle);
-            DeleteFileW( tmpfileW );
+            /* replacing files in use needs the package, so it is not done on the thread pool */
+            if (copy->error == ERROR_SHARING_VIOLATION || copy->error == ERROR_USER_MAPPED_FILE)
+                copy->error = copy_install_file_in_use( copy->package, file, copy->source );
+
+            if (copy->error != ERROR_SUCCESS)
+            {
+                ERR("Failed to copy %s to %s (%u)\n", debugstr_w(copy->source), debugstr_w(file->TargetPath), copy->error);
+                rc = ERROR_INSTALL_FAILURE;
+            }
+            else if (!msi_is_global_assembly( file->Component )) file->state = msifs_installed;
         }
-        msi_free(tmpfileW);
+        list_remove( &copy->entry );
+        msi_free( copy->source );
+        msi_free( copy );
     }
-
-    return gle;
+    return rc;
 }
 
 static UINT create_directory( MSIPACKAGE *package, const WCHAR *dir )
@@ -551,12 +672,18 @@ WCHAR *msi_resolve_file_source( MSIPACKAGE *package, MSIFILE *file )
  * For efficiency, this is done in two passes:
  * 1) Correct all the TargetPaths and determine what files are to be installed.
  * 2) Extract Cabinets and copy files.
+ *
+ * Uncompressed files are copied on the thread pool, the copies are completed
+ * in file order before the assemblies are installed.
  */
 UINT ACTION_InstallFiles(MSIPACKAGE *package)
 {
     MSIMEDIAINFO *mi;
     UINT rc = ERROR_SUCCESS;
     MSIFILE *file;
+    MSIFILEQUEUE queue;
+    struct list copy_ops = LIST_INIT( copy_ops );
+    BOOL use_queue;
 
     msi_set_sourcedir_props(package, FALSE);
 
@@ -565,6 +692,7 @@ UINT ACTION_InstallFiles(MSIPACKAGE *package)
 
     schedule_install_files(package);
     mi = msi_alloc_zero( sizeof(MSIMEDIAINFO) );
+    use_queue = msi_can_queue_file_ops( package ) && msi_init_file_queue( &queue );
 
     LIST_FOR_EACH_ENTRY( file, &package->files, MSIFILE, entry )
     {
@@ -614,6 +742,7 @@ UINT ACTION_InstallFiles(MSIPACKAGE *package)
         if (!file->IsCompressed)
         {
             WCHAR *source = msi_resolve_file_source(package, file);
+            struct copy_op *copy;
 
             TRACE("copying %s to %s\n", debugstr_w(source), debugstr_w(file->TargetPath));
 
@@ -621,6 +750,17 @@ UINT ACTION_InstallFiles(MSIPACKAGE *package)
             {
                 create_directory(package, file->Component->Directory);
             }
+            if (use_queue && (copy = msi_alloc( sizeof(*copy) )))
+            {
+                copy->op.proc = copy_op_proc;
+                copy->package = package;
+                copy->file = file;
+                copy->source = source;
+                copy->error = ERROR_SUCCESS;
+                list_add_tail( &copy_ops, &copy->entry );
+                msi_queue_file_op( &queue, &copy->op );
+                continue;
+            }
             rc = copy_install_file(package, file, source);
             if (rc != ERROR_SUCCESS)
             {
@@ -640,6 +780,11 @@ UINT ACTION_InstallFiles(MSIPACKAGE *package)
             goto done;
         }
     }
+    if (use_queue)
+    {
+        msi_wait_file_queue( &queue );
+        if ((rc = finish_copy_ops( &copy_ops ))) goto done;
+    }
     LIST_FOR_EACH_ENTRY( file, &package->files, MSIFILE, entry )
     {
         MSICOMPONENT *comp = file->Component;
@@ -658,6 +803,16 @@ UINT ACTION_InstallFiles(MSIPACKAGE *package)
     }
 
 done:
+    if (use_queue)
+    {
+        /* copies are only left on failure, the ones that didn't run yet are dropped */
+        if (!list_empty( &copy_ops ))
+        {
+            msi_cancel_file_queue( &queue );
+            discard_copy_ops( &copy_ops );
+        }
+        msi_destroy_file_queue( &queue );
+    }
     msi_free_media_info(mi);
     return rc;
 }
@@ -52,6 +52,57 @@ WINE_DEFAULT_DEBUG_CHANNEL(msi);
 #define _O_TEXT        0x4000
 #define _O_BINARY      0x8000
 
+static void CALLBACK file_op_callback( TP_CALLBACK_INSTANCE *instance, void *context )
+{
+    MSIFILEOP *op = context;
+    MSIFILEQUEUE *queue = op->queue;
+
+    if (!queue->cancelled) op->proc( op );
+    if (!InterlockedDecrement( &queue->pending )) SetEvent( queue->idle );
+}
+
+BOOL msi_init_file_queue( MSIFILEQUEUE *queue )
+{
+    /* the extra reference is dropped by msi_wait_file_queue */
+    queue->pending = 1;
+    queue->cancelled = FALSE;
+    return (queue->idle = CreateEventW( NULL, TRUE, FALSE, NULL )) != NULL;
+}
+
+void msi_queue_file_op( MSIFILEQUEUE *queue, MSIFILEOP *op )
+{
+    op->queue = queue;
+    InterlockedIncrement( &queue->pending );
+    if (!TrySubmitThreadpoolCallback( file_op_callback, op, NULL ))
+    {
+        WARN("failed to queue file operation (%u)\n", GetLastError());
+        InterlockedDecrement( &queue->pending );
+        op->proc( op );
+    }
+}
+
+/* wait until all queued operations have completed, the queue can be reused afterwards */
+void msi_wait_file_queue( MSIFILEQUEUE *queue )
+{
+    if (InterlockedDecrement( &queue->pending )) WaitForSingleObject( queue->idle, INFINITE );
+    ResetEvent( queue->idle );
+    queue->pending = 1;
+    queue->cancelled = FALSE;
+}
+
+/* queued operations that haven't started yet are skipped, the running ones are waited for */
+void msi_cancel_file_queue( MSIFILEQUEUE *queue )
+{
+    queue->cancelled = TRUE;
+    msi_wait_file_queue( queue );
+}
+
+void msi_destroy_file_queue( MSIFILEQUEUE *queue )
+{
+    msi_wait_file_queue( queue );
+    CloseHandle( queue->idle );
+}
+
 static BOOL source_matches_volume(MSIMEDIAINFO *mi, LPCWSTR source_root)
 {
     WCHAR volume_name[MAX_PATH + 1], root[MAX_PATH + 1];
@@ -110,6 +161,128 @@ static MSICABINETSTREAM *msi_get_cabinet_stream( MSIPACKAGE *package, UINT disk_
     return NULL;
 }
 
+/* Extracted files are buffered in memory and written out on the thread pool,
+ * so that decompressing the next file overlaps with writing the previous ones.
+ * Files larger than this are written directly. */
+#define MAX_BUFFERED_FILE_SIZE  (16 * 1024 * 1024)
+/* maximum amount of buffered data waiting to be written */
+#define MAX_QUEUED_SIZE         (64 * 1024 * 1024)
+
+struct cabinet_writer
+{
+    MSIFILEQUEUE queue;
+    SIZE_T queued;
+    LONG failed;
+};
+
+struct cabinet_output
+{
+    MSIFILEOP op;
+    struct cabinet_writer *writer;
+    HANDLE handle;
+    BYTE *data;
+    DWORD size;
+    DWORD capacity;
+    FILETIME time;
+};
+
+/* FDI passes nothing but the handle to its I/O callbacks, so the handles
+ * given to it point to one of these. */
+struct cabinet_file
+{
+    HANDLE handle;                  /* cabinet or extracted file */
+    IStream *stream;                /* cabinet stored in a stream */
+    struct cabinet_output *output;  /* buffered data of an extracted file */
+};
+
+static void free_cabinet_output( struct cabinet_output *output )
+{
+    msi_free( output->data );
+    msi_free( output );
+}
+
+static BOOL write_cabinet_output( HANDLE handle, const BYTE *data, DWORD size )
+{
+    DWORD written;
+
+    while (size)
+    {
+        if (!WriteFile( handle, data, size, &written, NULL ) || !written) return FALSE;
+        data += written;
+        size -= written;
+    }
+    return TRUE;
+}
+
+static void cabinet_output_proc( MSIFILEOP *op )
+{
+    struct cabinet_output *output = CONTAINING_RECORD( op, struct cabinet_output, op );
+    BOOL ret;
+
+    ret = write_cabinet_output( output->handle, output->data, output->size );
+    if (ret) ret = SetFileTime( output->handle, &output->time, NULL, &output->time );
+    if (!ret)
+    {
+        WARN("failed to write extracted file (%u)\n", GetLastError());
+        InterlockedExchange( &output->writer->failed, 1 );
+    }
+    CloseHandle( output->handle );
+    free_cabinet_output( output );
+}
+
+static struct cabinet_output *create_cabinet_output( struct cabinet_writer *writer, HANDLE handle, DWORD size )
+{
+    struct cabinet_output *output;
+
+    if (size > MAX_BUFFERED_FILE_SIZE || !(output = msi_alloc_zero( sizeof(*output) ))) return NULL;
+    if (size && !(output->data = msi_alloc( size )))
+    {
+        msi_free( output );
+        return NULL;
+    }
+    output->op.proc = cabinet_output_proc;
+    output->writer = writer;
+    output->handle = handle;
+    output->capacity = size;
+    return output;
+}
+
+static BOOL init_cabinet_writer( struct cabinet_writer *writer )
+{
+    writer->queued = 0;
+    writer->failed = 0;
+    return msi_init_file_queue( &writer->queue );
+}
+
+/* Waits for the pending writes, returns FALSE if any of them failed. */
+static BOOL destroy_cabinet_writer( struct cabinet_writer *writer )
+{
+    msi_destroy_file_queue( &writer->queue );
+    return !writer->failed;
+}
+
+static void queue_cabinet_output( struct cabinet_writer *writer, struct cabinet_output *output )
+{
+    if (writer->queued + output->size > MAX_QUEUED_SIZE)
+    {
+        msi_wait_file_queue( &writer->queue );
+        writer->queued = 0;
+    }
+    writer->queued += output->size;
+    msi_queue_file_op( &writer->queue, &output->op );
+}
+
+static INT_PTR create_cabinet_file( HANDLE handle, IStream *stream, struct cabinet_output *output )
+{
+    struct cabinet_file *file;
+
+    if (!(file = msi_alloc( sizeof(*file) ))) return -1;
+    file->handle = handle;
+    file->stream = stream;
+    file->output = output;
+    return (INT_PTR)file;
+}
+
 static void * CDECL cabinet_alloc(ULONG cb)
 {
     return msi_alloc(cb);
@@ -122,6 +295,8 @@ static void CDECL cabinet_free(void *pv)
 
 static INT_PTR CDECL cabinet_open(char *pszFile, int oflag, int pmode)
 {
+    HANDLE handle;
+    INT_PTR ret;
     DWORD dwAccess = 0;
     DWORD dwShareMode = 0;
     DWORD dwCreateDisposition = OPEN_EXISTING;
@@ -147,16 +322,18 @@ static INT_PTR CDECL cabinet_open(char *pszFile, int oflag, int pmode)
     else if (oflag & _O_CREAT)
         dwCreateDisposition = CREATE_ALWAYS;
 
-    return (INT_PTR)CreateFileA(pszFile, dwAccess, dwShareMode, NULL,
-                                dwCreateDisposition, 0, NULL);
+    handle = CreateFileA(pszFile, dwAccess, dwShareMode, NULL, dwCreateDisposition, 0, NULL);
+    if (handle == INVALID_HANDLE_VALUE) return -1;
+    if ((ret = create_cabinet_file( handle, NULL, NULL )) == -1) CloseHandle( handle );
+    return ret;
 }
 
 static UINT CDECL cabinet_read(INT_PTR hf, void *pv, UINT cb)
 {
-    HANDLE handle = (HANDLE)hf;
+    struct cabinet_file *file = (struct cabinet_file *)hf;
     DWORD read;
 
-    if (ReadFile(handle, pv, cb, &read, NULL))
+    if (ReadFile(file->handle, pv, cb, &read, NULL))
         return read;
 
     return 0;
@@ -164,26 +341,53 @@ static UINT CDECL cabinet_read(INT_PTR hf, void *pv, UINT cb)
 
 static UINT CDECL cabinet_write(INT_PTR hf, void *pv, UINT cb)
 {
-    HANDLE handle = (HANDLE)hf;
+    struct cabinet_file *file = (struct cabinet_file *)hf;
+    struct cabinet_output *output = file->output;
     DWORD written;
 
-    if (WriteFile(handle, pv, cb, &written, NULL))
+    if (output)
+    {
+        if (cb <= output->capacity - output->size)
+        {
+            memcpy( output->data + output->size, pv, cb );
+            output->size += cb;
+            return cb;
+        }
+        /* the file is bigger than announced, stop buffering it */
+        WARN("unexpected file size, writing directly\n");
+        file->output = NULL;
+        if (!write_cabinet_output( file->handle, output->data, output->size ))
+        {
+            free_cabinet_output( output );
+            return 0;
+        }
+        free_cabinet_output( output );
+    }
+
+    if (WriteFile(file->handle, pv, cb, &written, NULL))
         return written;
 
     return 0;
 }
 
+/* extracted files are closed through here too when FDICopy fails */
 static int CDECL cabinet_close(INT_PTR hf)
 {
-    HANDLE handle = (HANDLE)hf;
-    return CloseHandle(handle) ? 0 : -1;
+    struct cabinet_file *file = (struct cabinet_file *)hf;
+    int ret = 0;
+
+    if (file->output) free_cabinet_output( file->output );
+    if (file->stream) IStream_Release( file->stream );
+    else if (!CloseHandle( file->handle )) ret = -1;
+    msi_free( file );
+    return ret;
 }
 
 static LONG CDECL cabinet_seek(INT_PTR hf, LONG dist, int seektype)
 {
-    HANDLE handle = (HANDLE)hf;
+    struct cabinet_file *file = (struct cabinet_file *)hf;
     /* flags are compatible and so are passed straight through */
-    return SetFilePointer(handle, dist, NULL, seektype);
+    return SetFilePointer(file->handle, dist, NULL, seektype);
 }
 
 struct package_disk
@@ -198,6 +402,7 @@ static INT_PTR CDECL cabinet_open_stream( char *pszFile, int oflag, int pmode )
 {
     MSICABINETSTREAM *cab;
     IStream *stream;
+    INT_PTR ret;
 
     if (!(cab = msi_get_cabinet_stream( package_disk.package, package_disk.id )))
     {
@@ -231,38 +436,32 @@ static INT_PTR CDECL cabinet_open_stream( char *pszFile, int oflag, int pmode )
             return -1;
         }
     }
-    return (INT_PTR)stream;
+    if ((ret = create_cabinet_file( NULL, stream, NULL )) == -1) IStream_Release( stream );
+    return ret;
 }
 
 static UINT CDECL cabinet_read_stream( INT_PTR hf, void *pv, UINT cb )
 {
-    IStream *stm = (IStream *)hf;
+    struct cabinet_file *file = (struct cabinet_file *)hf;
     DWORD read;
     HRESULT hr;
 
-    hr = IStream_Read( stm, pv, cb, &read );
+    hr = IStream_Read( file->stream, pv, cb, &read );
     if (hr == S_OK || hr == S_FALSE)
         return read;
 
     return 0;
 }
 
-static int CDECL cabinet_close_stream( INT_PTR hf )
-{
-    IStream *stm = (IStream *)hf;
-    IStream_Release( stm );
-    return 0;
-}
-
 static LONG CDECL cabinet_seek_stream( INT_PTR hf, LONG dist, int seektype )
 {
-    IStream *stm = (IStream *)hf;
+    struct cabinet_file *file = (struct cabinet_file *)hf;
     LARGE_INTEGER move;
     ULARGE_INTEGER newpos;
     HRESULT hr;
 
     move.QuadPart = dist;
-    hr = IStream_Seek( stm, move, seektype, &newpos );
+    hr = IStream_Seek( file->stream, move, seektype, &newpos );
     if (SUCCEEDED(hr))
     {
         if (newpos.QuadPart <= MAXLONG) return newpos.QuadPart;
@@ -414,9 +613,11 @@ static INT_PTR cabinet_copy_file(FDINOTIFICATIONTYPE fdint,
                                  PFDINOTIFICATION pfdin)
 {
     MSICABDATA *data = pfdin->pv;
+    struct cabinet_output *output;
     HANDLE handle = 0;
     LPWSTR path = NULL;
     DWORD attrs;
+    INT_PTR ret;
 
     data->curfile = strdupAtoW(pfdin->psz1);
     if (!data->cb(data->package, data->curfile, MSICABEXTRACT_BEGINEXTRACT, &path,
@@ -493,7 +694,14 @@ static INT_PTR cabinet_copy_file(FDINOTIFICATIONTYPE fdint,
 done:
     msi_free(path);
 
-    return (INT_PTR)handle;
+    if (!handle || handle == INVALID_HANDLE_VALUE) return (INT_PTR)handle;
+    output = create_cabinet_output( data->writer, handle, pfdin->cb );
+    if ((ret = create_cabinet_file( handle, NULL, output )) == -1)
+    {
+        if (output) free_cabinet_output( output );
+        CloseHandle( handle );
+    }
+    return ret;
 }
 
 static INT_PTR cabinet_close_file_info(FDINOTIFICATIONTYPE fdint,
@@ -502,27 +710,36 @@ static INT_PTR cabinet_close_file_info(FDINOTIFICATIONTYPE fdint,
     MSICABDATA *data = pfdin->pv;
     FILETIME ft;
     FILETIME ftLocal;
-    HANDLE handle = (HANDLE)pfdin->hf;
+    struct cabinet_file *file = (struct cabinet_file *)pfdin->hf;
+    struct cabinet_output *output = file->output;
+    HANDLE handle = file->handle;
+
+    msi_free( file );
 
     data->mi->is_continuous = FALSE;
 
-    if (!DosDateTimeToFileTime(pfdin->date, pfdin->time, &ft))
+    if (!DosDateTimeToFileTime(pfdin->date, pfdin->time, &ft) ||
+        !LocalFileTimeToFileTime(&ft, &ftLocal))
     {
+        if (output) free_cabinet_output( output );
         CloseHandle(handle);
         return -1;
     }
-    if (!LocalFileTimeToFileTime(&ft, &ftLocal))
+
+    if (output)
     {
-        CloseHandle(handle);
-        return -1;
+        output->time = ftLocal;
+        queue_cabinet_output( data->writer, output );
     }
-    if (!SetFileTime(handle, &ftLocal, 0, &ftLocal))
+    else
     {
+        if (!SetFileTime(handle, &ftLocal, 0, &ftLocal))
+        {
+            CloseHandle(handle);
+            return -1;
+        }
         CloseHandle(handle);
-        return -1;
     }
-
-    CloseHandle(handle);
     data->cb(data->package, data->curfile, MSICABEXTRACT_FILEEXTRACTED, NULL, NULL, data->user);
 
     msi_free(data->curfile);
@@ -579,6 +796,8 @@ static INT_PTR CDECL cabinet_notify_stream( FDINOTIFICATIONTYPE fdint, PFDINOTIF
 
 static BOOL extract_cabinet( MSIPACKAGE* package, MSIMEDIAINFO *mi, LPVOID data )
 {
+    MSICABDATA *cab_data = data;
+    struct cabinet_writer writer;
     LPSTR cabinet, cab_path = NULL;
     HFDI hfdi;
     ERF erf;
@@ -602,10 +821,21 @@ static BOOL extract_cabinet( MSIPACKAGE* package, MSIMEDIAINFO *mi, LPVOID data
     if (!cab_path)
         goto done;
 
+    if (!init_cabinet_writer( &writer ))
+        goto done;
+    cab_data->writer = &writer;
+
     ret = FDICopy( hfdi, cabinet, cab_path, 0, cabinet_notify, NULL, data );
     if (!ret)
         ERR("FDICopy failed\n");
 
+    cab_data->writer = NULL;
+    if (!destroy_cabinet_writer( &writer ) && ret)
+    {
+        ERR("failed to write extracted files\n");
+        ret = FALSE;
+    }
+
 done:
     FDIDestroy( hfdi );
     msi_free(cabinet );
@@ -620,6 +850,8 @@ done:
 static BOOL extract_cabinet_stream( MSIPACKAGE *package, MSIMEDIAINFO *mi, LPVOID data )
 {
     static char filename[] = {'<','S','T','R','E','A','M','>',0};
+    MSICABDATA *cab_data = data;
+    struct cabinet_writer writer;
     HFDI hfdi;
     ERF erf;
     BOOL ret = FALSE;
@@ -627,7 +859,7 @@ static BOOL extract_cabinet_stream( MSIPACKAGE *package, MSIMEDIAINFO *mi, LPVOI
     TRACE("extracting %s disk id %u\n", debugstr_w(mi->cabinet), mi->disk_id);
 
     hfdi = FDICreate( cabinet_alloc, cabinet_free, cabinet_open_stream, cabinet_read_stream,
-                      cabinet_write, cabinet_close_stream, cabinet_seek_stream, 0, &erf );
+                      cabinet_write, cabinet_close, cabinet_seek_stream, 0, &erf );
     if (!hfdi)
     {
         ERR("FDICreate failed\n");
@@ -637,9 +869,23 @@ static BOOL extract_cabinet_stream( MSIPACKAGE *package, MSIMEDIAINFO *mi, LPVOI
     package_disk.package = package;
     package_disk.id      = mi->disk_id;
 
+    if (!init_cabinet_writer( &writer ))
+    {
+        FDIDestroy( hfdi );
+        return FALSE;
+    }
+    cab_data->writer = &writer;
+
     ret = FDICopy( hfdi, filename, NULL, 0, cabinet_notify_stream, NULL, data );
     if (!ret) ERR("FDICopy failed\n");
 
+    cab_data->writer = NULL;
+    if (!destroy_cabinet_writer( &writer ) && ret)
+    {
+        ERR("failed to write extracted files\n");
+        ret = FALSE;
+    }
+
     FDIDestroy( hfdi );
     if (ret) mi->is_extracted = TRUE;
     return ret;
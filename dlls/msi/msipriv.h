@@ -323,6 +323,17 @@ typedef struct tagMSIVIEWOPS
      */
     UINT (*delete)( struct tagMSIVIEW * );
 
+    /*
+     * find_matching_rows - iterates through rows that match a value
+     *
+     * The value is compared with the data returned by fetch_int, so a string
+     *  ID should be passed in for string columns.
+     * The handle is an input/output parameter that keeps track of the current
+     *  position in the iteration. It must be initialised to zero before the
+     *  first call and continued to be passed in to subsequent calls.
+     */
+    UINT (*find_matching_rows)( struct tagMSIVIEW *view, UINT col, UINT val, UINT *row, MSIITERHANDLE *handle );
+
     /*
      * add_ref - increases the reference count of the table
      */
@@ -1073,6 +1084,11 @@ static inline void msi_revert_fs_redirection( MSIPACKAGE *package )
 {
     if (is_wow64 && package->platform == PLATFORM_X64) Wow64RevertWow64FsRedirection( package->cookie );
 }
+static inline BOOL msi_can_queue_file_ops( MSIPACKAGE *package )
+{
+    /* the redirection cookie is stored in the package, so it can't be used from several threads */
+    return !(is_wow64 && package->platform == PLATFORM_X64);
+}
 extern HANDLE msi_create_file( MSIPACKAGE *, const WCHAR *, DWORD, DWORD, DWORD, DWORD ) DECLSPEC_HIDDEN;
 extern BOOL msi_delete_file( MSIPACKAGE *, const WCHAR * ) DECLSPEC_HIDDEN;
 extern BOOL msi_remove_directory( MSIPACKAGE *, const WCHAR * ) DECLSPEC_HIDDEN;
@@ -1102,12 +1118,33 @@ typedef struct
     PMSICABEXTRACTCB cb;
     LPWSTR curfile;
     PVOID user;
+    struct cabinet_writer *writer;
 } MSICABDATA;
 
 extern UINT ready_media(MSIPACKAGE *package, BOOL compressed, MSIMEDIAINFO *mi) DECLSPEC_HIDDEN;
 extern UINT msi_load_media_info(MSIPACKAGE *package, UINT Sequence, MSIMEDIAINFO *mi) DECLSPEC_HIDDEN;
 extern void msi_free_media_info(MSIMEDIAINFO *mi) DECLSPEC_HIDDEN;
 extern BOOL msi_cabextract(MSIPACKAGE* package, MSIMEDIAINFO *mi, LPVOID data) DECLSPEC_HIDDEN;
+
+/* file operations running on the thread pool */
+typedef struct tagMSIFILEOP
+{
+    void (*proc)( struct tagMSIFILEOP *op );
+    struct tagMSIFILEQUEUE *queue;
+} MSIFILEOP;
+
+typedef struct tagMSIFILEQUEUE
+{
+    LONG pending;
+    BOOL cancelled;
+    HANDLE idle;
+} MSIFILEQUEUE;
+
+extern BOOL msi_init_file_queue(MSIFILEQUEUE *) DECLSPEC_HIDDEN;
+extern void msi_queue_file_op(MSIFILEQUEUE *, MSIFILEOP *) DECLSPEC_HIDDEN;
+extern void msi_wait_file_queue(MSIFILEQUEUE *) DECLSPEC_HIDDEN;
+extern void msi_cancel_file_queue(MSIFILEQUEUE *) DECLSPEC_HIDDEN;
+extern void msi_destroy_file_queue(MSIFILEQUEUE *) DECLSPEC_HIDDEN;
 extern UINT msi_add_cabinet_stream(MSIPACKAGE *, UINT, IStorage *, const WCHAR *) DECLSPEC_HIDDEN;
 
 /* control event stuff */
@@ -55,6 +55,7 @@ typedef struct tagMSICOLUMNINFO
     UINT    type;
     UINT    offset;
     MSICOLUMNHASHENTRY **hash_table;
+    UINT    hash_size;
 } MSICOLUMNINFO;
 
 struct tagMSITABLE
@@ -1479,7 +1480,7 @@ static UINT table_create_new_row( struct tagMSIVIEW *view, UINT *num, BOOL tempo
     UINT sz;
     BYTE ***data_ptr;
     BOOL **data_persist_ptr;
-    UINT *row_count;
+    UINT *row_count, i;
 
     TRACE("%p %s\n", view, temporary ? "TRUE" : "FALSE");
 
@@ -1519,6 +1520,13 @@ static UINT table_create_new_row( struct tagMSIVIEW *view, UINT *num, BOOL tempo
         return ERROR_NOT_ENOUGH_MEMORY;
     }
 
+    /* reset the hash tables, the rows are going to be shifted */
+    for (i = 0; i < tv->num_cols; i++)
+    {
+        msi_free( tv->columns[i].hash_table );
+        tv->columns[i].hash_table = NULL;
+    }
+
     *data_ptr = p;
     (*data_ptr)[*row_count] = row;
 
@@ -1925,6 +1933,91 @@ static UINT TABLE_delete( struct tagMSIVIEW *view )
     return ERROR_SUCCESS;
 }
 
+static UINT table_build_hash( MSITABLEVIEW *tv, UINT col )
+{
+    UINT i, num_rows = tv->table->row_count, hash_size;
+    MSICOLUMNHASHENTRY **hash_table;
+    MSICOLUMNHASHENTRY *new_entry;
+
+    if( tv->columns[col-1].offset >= tv->row_size )
+    {
+        ERR("Stuffed up %d >= %d\n", tv->columns[col-1].offset, tv->row_size );
+        ERR("%p %p\n", tv, tv->columns );
+        return ERROR_FUNCTION_FAILED;
+    }
+
+    /* keep the chains short for large tables */
+    hash_size = max( MSITABLE_HASH_TABLE_SIZE, num_rows | 1 );
+
+    /* allocate contiguous memory for the table and its entries so we
+     * don't have to do an expensive cleanup */
+    hash_table = msi_alloc_zero( hash_size * sizeof(MSICOLUMNHASHENTRY *) +
+                                 num_rows * sizeof(MSICOLUMNHASHENTRY) );
+    if (!hash_table)
+        return ERROR_OUTOFMEMORY;
+
+    new_entry = (MSICOLUMNHASHENTRY *)(hash_table + hash_size) + num_rows;
+
+    /* insert backwards so that the chains are ordered by row */
+    for (i = num_rows; i > 0; i--)
+    {
+        UINT row_value, bucket;
+
+        if (TABLE_fetch_int( &tv->view, i - 1, col, &row_value ) != ERROR_SUCCESS)
+            continue;
+
+        new_entry--;
+        bucket = row_value % hash_size;
+        new_entry->value = row_value;
+        new_entry->row = i - 1;
+        new_entry->next = hash_table[bucket];
+        hash_table[bucket] = new_entry;
+    }
+
+    tv->columns[col-1].hash_table = hash_table;
+    tv->columns[col-1].hash_size = hash_size;
+    return ERROR_SUCCESS;
+}
+
+static UINT TABLE_find_matching_rows( struct tagMSIVIEW *view, UINT col,
+                                      UINT val, UINT *row, MSIITERHANDLE *handle )
+{
+    MSITABLEVIEW *tv = (MSITABLEVIEW*)view;
+    const MSICOLUMNHASHENTRY *entry;
+    UINT r;
+
+    TRACE("%p, %d, %u, %p\n", view, col, val, *handle);
+
+    if( !tv->table )
+        return ERROR_INVALID_PARAMETER;
+
+    if( (col==0) || (col > tv->num_cols) )
+        return ERROR_INVALID_PARAMETER;
+
+    if( !tv->columns[col-1].hash_table )
+    {
+        r = table_build_hash( tv, col );
+        if (r != ERROR_SUCCESS)
+            return r;
+    }
+
+    if( !*handle )
+        entry = tv->columns[col-1].hash_table[val % tv->columns[col-1].hash_size];
+    else
+        entry = (*handle)->next;
+
+    while (entry && entry->value != val)
+        entry = entry->next;
+
+    *handle = entry;
+    if (!entry)
+        return ERROR_NO_MORE_ITEMS;
+
+    *row = entry->row;
+
+    return ERROR_SUCCESS;
+}
+
 static UINT TABLE_add_ref(struct tagMSIVIEW *view)
 {
     MSITABLEVIEW *tv = (MSITABLEVIEW*)view;
@@ -1946,6 +2039,7 @@ static UINT TABLE_remove_column(struct tagMSIVIEW *view, UINT number)
     if (tv->table->colinfo[number-1].type & MSITYPE_TEMPORARY)
     {
         UINT size = tv->table->colinfo[number-1].offset;
+        msi_free( tv->table->colinfo[number-1].hash_table );
         tv->table->col_count--;
         tv->table->colinfo = msi_realloc( tv->table->colinfo, sizeof(*tv->table->colinfo) * tv->table->col_count );
 
@@ -2180,6 +2274,7 @@ static const MSIVIEWOPS table_ops =
     TABLE_get_column_info,
     TABLE_modify,
     TABLE_delete,
+    TABLE_find_matching_rows,
     TABLE_add_ref,
     TABLE_release,
     TABLE_add_column,
@@ -2758,6 +2853,7 @@ static const MSIVIEWOPS transform_view_ops =
     NULL,
     NULL,
     NULL,
+    NULL,
     NULL
 };
 
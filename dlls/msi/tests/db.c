@@ -9275,6 +9275,161 @@ static void test_view_get_error(void)
     DeleteFileA(msifile);
 }
 
+static UINT count_view_rows( MSIHANDLE hdb, MSIHANDLE hrec, const char *query, UINT *count )
+{
+    MSIHANDLE hview, hrow;
+    UINT r;
+
+    *count = 0;
+    r = MsiDatabaseOpenViewA( hdb, query, &hview );
+    if (r != ERROR_SUCCESS)
+        return r;
+    r = MsiViewExecute( hview, hrec );
+    if (r == ERROR_SUCCESS)
+    {
+        while ((r = MsiViewFetch( hview, &hrow )) == ERROR_SUCCESS)
+        {
+            (*count)++;
+            MsiCloseHandle( hrow );
+        }
+        if (r == ERROR_NO_MORE_ITEMS)
+            r = ERROR_SUCCESS;
+        MsiViewClose( hview );
+    }
+    MsiCloseHandle( hview );
+    return r;
+}
+
+static void test_large_join(void)
+{
+    /* the queries are only timed in interactive runs, which use more rows */
+    const UINT directories = 100;
+    UINT components = winetest_interactive ? 1000 : 100;
+    UINT files = winetest_interactive ? 10000 : 1000;
+    MSIHANDLE hdb, hrec, hview;
+    char name[32], parent[32];
+    DWORD start, elapsed;
+    UINT r, i, count;
+
+    hdb = create_db();
+    ok( hdb, "failed to create db\n" );
+
+    r = run_query( hdb, 0, "CREATE TABLE `Directory` (`Directory` CHAR(72) NOT NULL, "
+                   "`Directory_Parent` CHAR(72), `DefaultDir` CHAR(255) NOT NULL PRIMARY KEY `Directory`)" );
+    ok( r == ERROR_SUCCESS, "got %u\n", r );
+    r = run_query( hdb, 0, "CREATE TABLE `Component` (`Component` CHAR(72) NOT NULL, "
+                   "`Directory_` CHAR(72) NOT NULL, `Attributes` SHORT NOT NULL PRIMARY KEY `Component`)" );
+    ok( r == ERROR_SUCCESS, "got %u\n", r );
+    r = run_query( hdb, 0, "CREATE TABLE `File` (`File` CHAR(72) NOT NULL, `Component_` CHAR(72) NOT NULL, "
+                   "`FileName` CHAR(255) NOT NULL, `FileSize` LONG NOT NULL PRIMARY KEY `File`)" );
+    ok( r == ERROR_SUCCESS, "got %u\n", r );
+
+    start = GetTickCount();
+
+    hrec = MsiCreateRecord( 4 );
+    for (i = 0; i < directories; i++)
+    {
+        sprintf( name, "D%u", i );
+        sprintf( parent, "D%u", i / 10 );
+        MsiRecordSetStringA( hrec, 1, name );
+        MsiRecordSetStringA( hrec, 2, i ? parent : "" );
+        MsiRecordSetStringA( hrec, 3, name );
+        r = run_query( hdb, hrec, "INSERT INTO `Directory` (`Directory`, `Directory_Parent`, `DefaultDir`) VALUES (?, ?, ?)" );
+        ok( r == ERROR_SUCCESS, "got %u\n", r );
+    }
+    for (i = 0; i < components; i++)
+    {
+        sprintf( name, "C%u", i );
+        sprintf( parent, "D%u", i % directories );
+        MsiRecordSetStringA( hrec, 1, name );
+        MsiRecordSetStringA( hrec, 2, parent );
+        MsiRecordSetInteger( hrec, 3, i % 4 );
+        r = run_query( hdb, hrec, "INSERT INTO `Component` (`Component`, `Directory_`, `Attributes`) VALUES (?, ?, ?)" );
+        ok( r == ERROR_SUCCESS, "got %u\n", r );
+    }
+    for (i = 0; i < files; i++)
+    {
+        sprintf( name, "F%u", i );
+        sprintf( parent, "C%u", i % components );
+        MsiRecordSetStringA( hrec, 1, name );
+        MsiRecordSetStringA( hrec, 2, parent );
+        MsiRecordSetStringA( hrec, 3, name );
+        MsiRecordSetInteger( hrec, 4, i );
+        r = run_query( hdb, hrec, "INSERT INTO `File` (`File`, `Component_`, `FileName`, `FileSize`) VALUES (?, ?, ?, ?)" );
+        ok( r == ERROR_SUCCESS, "got %u\n", r );
+    }
+    MsiCloseHandle( hrec );
+
+    elapsed = GetTickCount() - start;
+    if (winetest_interactive)
+        trace( "inserting %u rows took %u ms\n", directories + components + files, elapsed );
+
+    /* primary key lookups */
+    start = GetTickCount();
+    hrec = MsiCreateRecord( 1 );
+    r = MsiDatabaseOpenViewA( hdb, "SELECT `FileSize` FROM `File` WHERE `File` = ?", &hview );
+    ok( r == ERROR_SUCCESS, "got %u\n", r );
+    for (i = 0; i < files; i += 7)
+    {
+        MSIHANDLE hrow;
+
+        sprintf( name, "F%u", i );
+        MsiRecordSetStringA( hrec, 1, name );
+        r = MsiViewExecute( hview, hrec );
+        ok( r == ERROR_SUCCESS, "got %u\n", r );
+        r = MsiViewFetch( hview, &hrow );
+        ok( r == ERROR_SUCCESS, "got %u\n", r );
+        ok( MsiRecordGetInteger( hrow, 1 ) == i, "got %d\n", MsiRecordGetInteger( hrow, 1 ) );
+        MsiCloseHandle( hrow );
+        r = MsiViewFetch( hview, &hrow );
+        ok( r == ERROR_NO_MORE_ITEMS, "got %u\n", r );
+        MsiViewClose( hview );
+    }
+    MsiCloseHandle( hview );
+    MsiCloseHandle( hrec );
+    elapsed = GetTickCount() - start;
+    if (winetest_interactive)
+        trace( "%u primary key lookups took %u ms\n", (files + 6) / 7, elapsed );
+
+    /* join filtered by a constant */
+    start = GetTickCount();
+    hrec = MsiCreateRecord( 1 );
+    MsiRecordSetStringA( hrec, 1, "D42" );
+    r = count_view_rows( hdb, hrec, "SELECT `File`.`File` FROM `File`, `Component` WHERE "
+                         "`File`.`Component_` = `Component`.`Component` AND `Component`.`Directory_` = ?", &count );
+    ok( r == ERROR_SUCCESS, "got %u\n", r );
+    ok( count == files / directories, "got %u\n", count );
+    MsiCloseHandle( hrec );
+    elapsed = GetTickCount() - start;
+    if (winetest_interactive)
+        trace( "two table join took %u ms\n", elapsed );
+
+    /* join of all the tables */
+    start = GetTickCount();
+    r = count_view_rows( hdb, 0, "SELECT `File`.`File`, `Directory`.`DefaultDir` FROM `File`, `Component`, `Directory` "
+                         "WHERE `File`.`Component_` = `Component`.`Component` AND "
+                         "`Component`.`Directory_` = `Directory`.`Directory` AND `Component`.`Attributes` <> 3", &count );
+    ok( r == ERROR_SUCCESS, "got %u\n", r );
+    ok( count == files / 4 * 3, "got %u\n", count );
+    elapsed = GetTickCount() - start;
+    if (winetest_interactive)
+        trace( "three table join took %u ms\n", elapsed );
+
+    /* the markers are numbered in the order they appear in the query */
+    hrec = MsiCreateRecord( 3 );
+    MsiRecordSetStringA( hrec, 1, "D1" );
+    MsiRecordSetInteger( hrec, 2, 12345 );
+    MsiRecordSetStringA( hrec, 3, "F1" );
+    r = count_view_rows( hdb, hrec, "SELECT `File`.`File`, `Component`.`Component` FROM `File`, `Component` WHERE "
+                         "(`Component`.`Directory_` = ? OR `File`.`FileSize` = ?) AND `File`.`File` = ?", &count );
+    ok( r == ERROR_SUCCESS, "got %u\n", r );
+    ok( count == components / directories, "got %u\n", count );
+    MsiCloseHandle( hrec );
+
+    MsiCloseHandle( hdb );
+    DeleteFileA( msifile );
+}
+
 START_TEST(db)
 {
     test_msidatabase();
@@ -9334,4 +9489,5 @@ START_TEST(db)
     test_viewmodify_merge();
     test_viewmodify_insert();
     test_view_get_error();
+    test_large_join();
 }
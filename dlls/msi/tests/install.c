@@ -6277,6 +6277,143 @@ static void test_source_resolution(void)
     DeleteFileA(msifile);
 }
 
+#define MANY_FILES 256
+
+static char *alloc_table(const char *header)
+{
+    char *table = HeapAlloc(GetProcessHeap(), 0, lstrlenA(header) + MANY_FILES * 128);
+    lstrcpyA(table, header);
+    return table;
+}
+
+/* half of the files are extracted from a cabinet, the other half are copied */
+static void test_install_many_files(void)
+{
+    const UINT count = winetest_interactive ? MANY_FILES : 32;
+    const UINT size = winetest_interactive ? 65536 : 4096;
+    char *component, *feature_comp, *file, *media, *cab_list, *p;
+    msi_table perf_tables[8];
+    char name[MAX_PATH], path[MAX_PATH];
+    LARGE_INTEGER freq, start, end;
+    BOOL installed = TRUE;
+    UINT r, i;
+
+    if (is_process_limited())
+    {
+        skip("process is limited\n");
+        return;
+    }
+
+    component = alloc_table("Component\tComponentId\tDirectory_\tAttributes\tCondition\tKeyPath\n"
+                            "s72\tS38\ts72\ti2\tS255\tS72\n"
+                            "Component\tComponent\n");
+    feature_comp = alloc_table("Feature_\tComponent_\n"
+                               "s38\ts72\n"
+                               "FeatureComponents\tFeature_\tComponent_\n");
+    file = alloc_table("File\tComponent_\tFileName\tFileSize\tVersion\tLanguage\tAttributes\tSequence\n"
+                       "s72\ts72\tl255\ti4\tS72\tS20\tI2\ti2\n"
+                       "File\tFile\n");
+    media = alloc_table("DiskId\tLastSequence\tDiskPrompt\tCabinet\tVolumeLabel\tSource\n"
+                        "i2\ti4\tL64\tS255\tS32\tS72\n"
+                        "Media\tDiskId\n");
+    cab_list = p = HeapAlloc(GetProcessHeap(), 0, MANY_FILES * 16);
+
+    CreateDirectoryA("msitest", NULL);
+    for (i = 0; i < count; i++)
+    {
+        BOOL compressed = i < count / 2;
+
+        sprintf(name, "perf%03u", i);
+        sprintf(component + lstrlenA(component), "%s\t\tMSITESTDIR\t0\t1\t%s\n", name, name);
+        sprintf(feature_comp + lstrlenA(feature_comp), "feature\t%s\n", name);
+        sprintf(file + lstrlenA(file), "%s\t%s\t%s\t%u\t\t\t%u\t%u\n", name, name, name,
+                size, compressed ? 16384 : 8192, i + 1);
+        if (compressed)
+        {
+            create_file(name, size);
+            lstrcpyA(p, name);
+            p += lstrlenA(p) + 1;
+        }
+        else
+        {
+            sprintf(path, "msitest\\%s", name);
+            create_file_data(path, name, size);
+        }
+    }
+    *p = 0;
+    sprintf(media + lstrlenA(media), "1\t%u\t\tperf.cab\tDISK1\t\n2\t%u\t\t\tDISK2\t\n",
+            count / 2, count);
+    create_cab_file("perf.cab", MEDIA_SIZE, cab_list);
+
+    perf_tables[0].filename = "component.idt";
+    perf_tables[0].data = component;
+    perf_tables[1].filename = "directory.idt";
+    perf_tables[1].data = directory_dat;
+    perf_tables[2].filename = "feature.idt";
+    perf_tables[2].data = cc_feature_dat;
+    perf_tables[3].filename = "feature_comp.idt";
+    perf_tables[3].data = feature_comp;
+    perf_tables[4].filename = "file.idt";
+    perf_tables[4].data = file;
+    perf_tables[5].filename = "install_exec_seq.idt";
+    perf_tables[5].data = install_exec_seq_dat;
+    perf_tables[6].filename = "media.idt";
+    perf_tables[6].data = media;
+    perf_tables[7].filename = "property.idt";
+    perf_tables[7].data = property_dat;
+    for (i = 0; i < ARRAY_SIZE(perf_tables); i++)
+        perf_tables[i].size = lstrlenA(perf_tables[i].data) + 1;
+
+    create_database(msifile, perf_tables, ARRAY_SIZE(perf_tables));
+
+    MsiSetInternalUI(INSTALLUILEVEL_NONE, NULL);
+
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&start);
+    r = MsiInstallProductA(msifile, NULL);
+    QueryPerformanceCounter(&end);
+    if (r == ERROR_INSTALL_PACKAGE_REJECTED)
+    {
+        skip("Not enough rights to perform tests\n");
+        goto error;
+    }
+    ok(r == ERROR_SUCCESS, "Expected ERROR_SUCCESS, got %u\n", r);
+    if (winetest_interactive)
+        trace("installed %u files of %u bytes in %u ms\n", count, size,
+              (UINT)((end.QuadPart - start.QuadPart) * 1000 / freq.QuadPart));
+
+    for (i = 0; i < count; i++)
+    {
+        sprintf(name, "perf%03u", i);
+        sprintf(path, "msitest\\%s", name);
+        if (installed && (get_pf_file_size(path) != size ||
+                          !compare_pf_data(path, name, lstrlenA(name) + 1)))
+        {
+            ok(0, "file %s not installed correctly\n", name);
+            installed = FALSE;
+        }
+        delete_pf(path, TRUE);
+    }
+    ok(delete_pf("msitest", FALSE), "Directory not created\n");
+
+error:
+    for (i = 0; i < count; i++)
+    {
+        sprintf(name, "perf%03u", i);
+        sprintf(path, "msitest\\%s", name);
+        DeleteFileA(name);
+        DeleteFileA(path);
+    }
+    RemoveDirectoryA("msitest");
+    DeleteFileA("perf.cab");
+    DeleteFileA(msifile);
+    HeapFree(GetProcessHeap(), 0, component);
+    HeapFree(GetProcessHeap(), 0, feature_comp);
+    HeapFree(GetProcessHeap(), 0, file);
+    HeapFree(GetProcessHeap(), 0, media);
+    HeapFree(GetProcessHeap(), 0, cab_list);
+}
+
 START_TEST(install)
 {
     DWORD len;
@@ -6370,6 +6507,7 @@ START_TEST(install)
     test_deferred_action();
     test_wow64();
     test_source_resolution();
+    test_install_many_files();
 
     DeleteFileA(customdll);
 
@@ -44,6 +44,14 @@ typedef struct tagMSIROWENTRY
     UINT values[1];
 } MSIROWENTRY;
 
+/* a term of the top level AND chain of the condition */
+typedef struct tagJOINTERM
+{
+    struct expr *expr;
+    UINT wildcard_base; /* number of wildcards evaluated before this term */
+    INT  depth;         /* last table in evaluation order the term refers to */
+} JOINTERM;
+
 typedef struct tagJOINTABLE
 {
     struct tagJOINTABLE *next;
@@ -51,6 +59,10 @@ typedef struct tagJOINTABLE
     UINT col_count;
     UINT row_count;
     UINT table_index;
+    UINT depth;                      /* position in evaluation order */
+    const JOINTERM *lookup;          /* equality term used to find matching rows */
+    UINT lookup_col;
+    const struct expr *lookup_value; /* the side of lookup not in this table */
 } JOINTABLE;
 
 typedef struct tagMSIORDERINFO
@@ -73,6 +85,8 @@ typedef struct tagMSIWHEREVIEW
     struct expr   *cond;
     UINT           rec_index;
     MSIORDERINFO  *order_info;
+    JOINTERM      *terms;
+    UINT           term_count;
 } MSIWHEREVIEW;
 
 static UINT WHERE_evaluate( MSIWHEREVIEW *wv, const UINT rows[],
@@ -646,38 +660,137 @@ static UINT WHERE_evaluate( MSIWHEREVIEW *wv, const UINT rows[],
     return ERROR_SUCCESS;
 }
 
+static UINT check_terms( MSIWHEREVIEW *wv, MSIRECORD *record, INT depth,
+                         const UINT table_rows[], INT *val )
+{
+    UINT i, r;
+
+    *val = TRUE;
+    for (i = 0; i < wv->term_count; i++)
+    {
+        if (wv->terms[i].depth != depth)
+            continue;
+
+        wv->rec_index = wv->terms[i].wildcard_base;
+        r = WHERE_evaluate( wv, table_rows, wv->terms[i].expr, val, record );
+        if (r != ERROR_SUCCESS)
+            return r;
+        if (!*val)
+            break;
+    }
+    return ERROR_SUCCESS;
+}
+
+/* Returns ERROR_SUCCESS with the value to look up in the column of the lookup
+ * term, ERROR_NO_MORE_ITEMS if no row can match or ERROR_CONTINUE if every
+ * row has to be checked. */
+static UINT get_lookup_value( MSIWHEREVIEW *wv, MSIRECORD *record, const JOINTABLE *table,
+                              const UINT table_rows[], UINT *val )
+{
+    const struct expr *expr = table->lookup_value, *column;
+    const WCHAR *str;
+    UINT r;
+    INT ival;
+
+    wv->rec_index = table->lookup->wildcard_base;
+
+    if (table->lookup->expr->type != EXPR_STRCMP)
+    {
+        r = WHERE_evaluate( wv, table_rows, (struct expr *)expr, &ival, record );
+        if (r != ERROR_SUCCESS)
+            return r;
+
+        /* undo the adjustment done when the column is evaluated */
+        column = table->lookup->expr->u.expr.left;
+        if (column == expr)
+            column = table->lookup->expr->u.expr.right;
+        if (column->type == EXPR_COL_NUMBER32)
+            *val = ival + 0x80000000;
+        else
+            *val = ival + 0x8000;
+        return ERROR_SUCCESS;
+    }
+
+    if (expr->type == EXPR_COL_NUMBER_STRING)
+    {
+        r = expr_fetch_value( &expr->u.column, table_rows, val );
+        if (r != ERROR_SUCCESS)
+            return r;
+
+        /* null and empty strings compare equal */
+        return *val ? ERROR_SUCCESS : ERROR_CONTINUE;
+    }
+
+    r = STRING_evaluate( wv, table_rows, expr, record, &str );
+    if (r != ERROR_SUCCESS)
+        return r;
+    if (!str || !*str)
+        return ERROR_CONTINUE;
+
+    /* strings are unique in the string table */
+    if (msi_string2id( wv->db->strings, str, -1, val ) != ERROR_SUCCESS)
+        return ERROR_NO_MORE_ITEMS;
+    return ERROR_SUCCESS;
+}
+
 static UINT check_condition( MSIWHEREVIEW *wv, MSIRECORD *record, JOINTABLE **tables,
                              UINT table_rows[] )
 {
-    UINT r = ERROR_FUNCTION_FAILED;
-    INT val;
+    JOINTABLE *table = *tables;
+    MSIITERHANDLE handle = NULL;
+    UINT r, row = 0, lookup = ERROR_CONTINUE, val = 0;
+    INT matches;
 
-    for (table_rows[(*tables)->table_index] = 0;
-         table_rows[(*tables)->table_index] < (*tables)->row_count;
-         table_rows[(*tables)->table_index]++)
+    if (table->lookup)
     {
-        val = 0;
-        wv->rec_index = 0;
-        r = WHERE_evaluate( wv, table_rows, wv->cond, &val, record );
-        if (r != ERROR_SUCCESS && r != ERROR_CONTINUE)
-            break;
-        if (val)
+        lookup = get_lookup_value( wv, record, table, table_rows, &val );
+        if (lookup == ERROR_NO_MORE_ITEMS)
+            return ERROR_SUCCESS;
+        if (lookup != ERROR_SUCCESS && lookup != ERROR_CONTINUE)
+            return lookup;
+    }
+
+    for (;;)
+    {
+        if (lookup == ERROR_SUCCESS)
         {
-            if (*(tables + 1))
+            r = table->view->ops->find_matching_rows( table->view, table->lookup_col,
+                                                      val, &row, &handle );
+            if (r == ERROR_NO_MORE_ITEMS)
+                r = ERROR_SUCCESS;
+            else if (r != ERROR_SUCCESS && !handle)
             {
-                r = check_condition(wv, record, tables + 1, table_rows);
-                if (r != ERROR_SUCCESS)
-                    break;
-            }
-            else
-            {
-                if (r != ERROR_SUCCESS)
-                    break;
-                add_row (wv, table_rows);
+                /* the lookup term is checked with the others, scan the table instead */
+                WARN("lookup failed (%u), scanning the table\n", r);
+                lookup = ERROR_CONTINUE;
+                row = 0;
+                continue;
             }
+            if (r != ERROR_SUCCESS || !handle)
+                break;
         }
+        else if (row >= table->row_count)
+        {
+            r = ERROR_SUCCESS;
+            break;
+        }
+
+        table_rows[table->table_index] = row++;
+
+        r = check_terms( wv, record, table->depth, table_rows, &matches );
+        if (r != ERROR_SUCCESS)
+            break;
+        if (!matches)
+            continue;
+
+        if (*(tables + 1))
+            r = check_condition( wv, record, tables + 1, table_rows );
+        else
+            r = add_row( wv, table_rows );
+        if (r != ERROR_SUCCESS)
+            break;
     }
-    table_rows[(*tables)->table_index] = INVALID_ROW_INDEX;
+    table_rows[table->table_index] = INVALID_ROW_INDEX;
     return r;
 }
 
@@ -810,6 +923,151 @@ static JOINTABLE **ordertables( MSIWHEREVIEW *wv )
     return tables;
 }
 
+static UINT count_wildcards( const struct expr *expr )
+{
+    switch (expr->type)
+    {
+    case EXPR_WILDCARD:
+        return 1;
+    case EXPR_COMPLEX:
+    case EXPR_STRCMP:
+        return count_wildcards( expr->u.expr.left ) + count_wildcards( expr->u.expr.right );
+    default:
+        return 0;
+    }
+}
+
+static INT get_term_depth( const struct expr *expr )
+{
+    INT left, right;
+
+    switch (expr->type)
+    {
+    case EXPR_COL_NUMBER:
+    case EXPR_COL_NUMBER32:
+    case EXPR_COL_NUMBER_STRING:
+        return expr->u.column.parsed.table->depth;
+    case EXPR_UNARY:
+        return get_term_depth( expr->u.expr.left );
+    case EXPR_COMPLEX:
+    case EXPR_STRCMP:
+        left = get_term_depth( expr->u.expr.left );
+        right = get_term_depth( expr->u.expr.right );
+        return max( left, right );
+    default:
+        return -1;
+    }
+}
+
+/* splits the top level AND chain of the condition, so that each term can be
+ * checked as soon as the tables it refers to are bound */
+static void add_terms( MSIWHEREVIEW *wv, struct expr *expr, UINT *wildcards )
+{
+    if (expr->type == EXPR_COMPLEX && expr->u.expr.op == OP_AND)
+    {
+        add_terms( wv, expr->u.expr.left, wildcards );
+        add_terms( wv, expr->u.expr.right, wildcards );
+        return;
+    }
+
+    if (wv->terms)
+    {
+        wv->terms[wv->term_count].expr = expr;
+        wv->terms[wv->term_count].wildcard_base = *wildcards;
+        wv->terms[wv->term_count].depth = get_term_depth( expr );
+    }
+    wv->term_count++;
+    *wildcards += count_wildcards( expr );
+}
+
+static UINT init_terms( MSIWHEREVIEW *wv )
+{
+    UINT wildcards = 0;
+
+    wv->terms = NULL;
+    wv->term_count = 0;
+    if (!wv->cond)
+        return ERROR_SUCCESS;
+
+    add_terms( wv, wv->cond, &wildcards );
+    if (!(wv->terms = msi_alloc( wv->term_count * sizeof(*wv->terms) )))
+        return ERROR_OUTOFMEMORY;
+
+    wildcards = 0;
+    wv->term_count = 0;
+    add_terms( wv, wv->cond, &wildcards );
+    return ERROR_SUCCESS;
+}
+
+static BOOL is_lookup_column( const struct expr *expr, const JOINTABLE *table, BOOL string )
+{
+    if (string ? expr->type != EXPR_COL_NUMBER_STRING :
+        expr->type != EXPR_COL_NUMBER && expr->type != EXPR_COL_NUMBER32)
+        return FALSE;
+    return expr->u.column.parsed.table == table;
+}
+
+/* the value has to be known before the rows of the table are iterated */
+static BOOL is_lookup_value( const struct expr *expr, const JOINTABLE *table, BOOL string )
+{
+    switch (expr->type)
+    {
+    case EXPR_WILDCARD:
+        return TRUE;
+    case EXPR_SVAL:
+        return string;
+    case EXPR_UVAL:
+        return !string;
+    case EXPR_COL_NUMBER_STRING:
+        return string && expr->u.column.parsed.table->depth < table->depth;
+    case EXPR_COL_NUMBER:
+    case EXPR_COL_NUMBER32:
+        return !string && expr->u.column.parsed.table->depth < table->depth;
+    default:
+        return FALSE;
+    }
+}
+
+/* looks for an equality term which allows to find the matching rows of the
+ * table with a hash lookup instead of checking all of them */
+static void find_lookup_term( MSIWHEREVIEW *wv, JOINTABLE *table )
+{
+    UINT i;
+
+    table->lookup = NULL;
+    if (!table->view->ops->find_matching_rows)
+        return;
+
+    for (i = 0; i < wv->term_count; i++)
+    {
+        const JOINTERM *term = &wv->terms[i];
+        const struct expr *left, *right;
+        BOOL string;
+
+        if (term->depth != table->depth ||
+            (term->expr->type != EXPR_COMPLEX && term->expr->type != EXPR_STRCMP) ||
+            term->expr->u.expr.op != OP_EQ)
+            continue;
+
+        string = term->expr->type == EXPR_STRCMP;
+        left = term->expr->u.expr.left;
+        right = term->expr->u.expr.right;
+        if (!is_lookup_column( left, table, string ) || !is_lookup_value( right, table, string ))
+        {
+            right = left;
+            left = term->expr->u.expr.right;
+            if (!is_lookup_column( left, table, string ) || !is_lookup_value( right, table, string ))
+                continue;
+        }
+
+        TRACE("using term %u to look up rows of table %u\n", i, table->table_index);
+        table->lookup = term;
+        table->lookup_col = left->u.column.parsed.column;
+        table->lookup_value = right;
+        return;
+    }
+}
+
 static UINT WHERE_execute( struct tagMSIVIEW *view, MSIRECORD *record )
 {
     MSIWHEREVIEW *wv = (MSIWHEREVIEW*)view;
@@ -818,6 +1076,7 @@ static UINT WHERE_execute( struct tagMSIVIEW *view, MSIRECORD *record )
     UINT *rows;
     JOINTABLE **ordered_tables;
     UINT i = 0;
+    INT val;
 
     TRACE("%p %p\n", wv, record);
 
@@ -846,12 +1105,31 @@ static UINT WHERE_execute( struct tagMSIVIEW *view, MSIRECORD *record )
     while ((table = table->next));
 
     ordered_tables = ordertables( wv );
+    for (i = 0; i < wv->table_count; i++)
+        ordered_tables[i]->depth = i;
+
+    r = init_terms( wv );
+    if (r != ERROR_SUCCESS)
+    {
+        msi_free( ordered_tables );
+        return r;
+    }
+
+    for (i = 0; i < wv->table_count; i++)
+        find_lookup_term( wv, ordered_tables[i] );
 
     rows = msi_alloc( wv->table_count * sizeof(*rows) );
     for (i = 0; i < wv->table_count; i++)
         rows[i] = INVALID_ROW_INDEX;
 
-    r =  check_condition(wv, record, ordered_tables, rows);
+    /* terms not referring to any table only need to be checked once */
+    r = check_terms( wv, record, -1, rows, &val );
+    if (r == ERROR_SUCCESS && val)
+        r = check_condition( wv, record, ordered_tables, rows );
+
+    msi_free( wv->terms );
+    wv->terms = NULL;
+    wv->term_count = 0;
 
     if (wv->order_info)
         wv->order_info->error = ERROR_SUCCESS;
@@ -1130,6 +1408,7 @@ static const MSIVIEWOPS where_ops =
     NULL,
     NULL,
     NULL,
+    NULL,
     WHERE_sort,
     NULL,
 };
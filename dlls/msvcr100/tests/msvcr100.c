@@ -148,10 +148,19 @@ typedef struct {
     char pad[64];
 } event;
 
+struct ContextVtbl;
 typedef struct {
-    void *vtable;
+    struct ContextVtbl *vtable;
 } Context;
 
+struct ContextVtbl {
+    unsigned int (__thiscall *GetId)(const Context*);
+    unsigned int (__thiscall *GetVirtualProcessorId)(const Context*);
+    unsigned int (__thiscall *GetScheduleGroupId)(const Context*);
+    void (__thiscall *Unblock)(Context*);
+    MSVCRT_bool (__thiscall *IsSynchronouslyBlocked)(const Context*);
+};
+
 typedef struct {
     void *policy_container;
 } SchedulerPolicy;
@@ -170,8 +179,8 @@ struct SchedulerVtbl {
     unsigned int (__thiscall *Release)(Scheduler*);
     void (__thiscall *RegisterShutdownEvent)(Scheduler*,HANDLE);
     void (__thiscall *Attach)(Scheduler*);
-    /* CreateScheduleGroup */
-    /* ScheduleTask */
+    void* (__thiscall *CreateScheduleGroup)(Scheduler*);
+    void (__thiscall *ScheduleTask)(Scheduler*,void (__cdecl*)(void*),void*);
 };
 
 static int* (__cdecl *p_errno)(void);
@@ -223,6 +232,8 @@ static int (__cdecl *p_event_wait_for_multiple)(event**, size_t, MSVCRT_bool, un
 
 static Context* (__cdecl *p_Context_CurrentContext)(void);
 static unsigned int (__cdecl *p_Context_Id)(void);
+static void (__cdecl *p_Context_Block)(void);
+static unsigned int (__cdecl *p_Context_VirtualProcessorId)(void);
 static SchedulerPolicy* (__thiscall *p_SchedulerPolicy_ctor)(SchedulerPolicy*);
 static void (__thiscall *p_SchedulerPolicy_SetConcurrencyLimits)(SchedulerPolicy*, unsigned int, unsigned int);
 static void (__thiscall *p_SchedulerPolicy_dtor)(SchedulerPolicy*);
@@ -230,6 +241,7 @@ static Scheduler* (__cdecl *p_Scheduler_Create)(SchedulerPolicy*);
 static Scheduler* (__cdecl *p_CurrentScheduler_Get)(void);
 static void (__cdecl *p_CurrentScheduler_Detach)(void);
 static unsigned int (__cdecl *p_CurrentScheduler_Id)(void);
+static void (__cdecl *p_CurrentScheduler_ScheduleTask)(void (__cdecl*)(void*),void*);
 
 static int (__cdecl *p__memicmp)(const char*, const char*, size_t);
 static int (__cdecl *p__memicmp_l)(const char*, const char*, size_t,_locale_t);
@@ -274,6 +286,8 @@ static BOOL init(void)
     SET(p___strncnt, "__strncnt");
 
     SET(p_Context_Id, "?Id@Context@Concurrency@@SAIXZ");
+    SET(p_Context_Block, "?Block@Context@Concurrency@@SAXXZ");
+    SET(p_Context_VirtualProcessorId, "?VirtualProcessorId@Context@Concurrency@@SAIXZ");
     SET(p_CurrentScheduler_Detach, "?Detach@CurrentScheduler@Concurrency@@SAXXZ");
     SET(p_CurrentScheduler_Id, "?Id@CurrentScheduler@Concurrency@@SAIXZ");
 
@@ -318,6 +332,7 @@ static BOOL init(void)
         SET(p_SchedulerPolicy_dtor, "??1SchedulerPolicy@Concurrency@@QEAA@XZ");
         SET(p_Scheduler_Create, "?Create@Scheduler@Concurrency@@SAPEAV12@AEBVSchedulerPolicy@2@@Z");
         SET(p_CurrentScheduler_Get, "?Get@CurrentScheduler@Concurrency@@SAPEAVScheduler@2@XZ");
+        SET(p_CurrentScheduler_ScheduleTask, "?ScheduleTask@CurrentScheduler@Concurrency@@SAXP6AXPEAX@Z0@Z");
     } else {
         SET(pSpinWait_ctor_yield, "??0?$_SpinWait@$00@details@Concurrency@@QAE@P6AXXZ@Z");
         SET(pSpinWait_dtor, "??_F?$_SpinWait@$00@details@Concurrency@@QAEXXZ");
@@ -359,6 +374,7 @@ static BOOL init(void)
         SET(p_SchedulerPolicy_dtor, "??1SchedulerPolicy@Concurrency@@QAE@XZ");
         SET(p_Scheduler_Create, "?Create@Scheduler@Concurrency@@SAPAV12@ABVSchedulerPolicy@2@@Z");
         SET(p_CurrentScheduler_Get, "?Get@CurrentScheduler@Concurrency@@SAPAVScheduler@2@XZ");
+        SET(p_CurrentScheduler_ScheduleTask, "?ScheduleTask@CurrentScheduler@Concurrency@@SAXP6AXPAX@Z0@Z");
     }
 
     init_thiscall_thunk();
@@ -989,6 +1005,188 @@ static void test_Scheduler(void)
     call_func1(p_SchedulerPolicy_dtor, &policy);
 }
 
+#define SUM_TASK_GRAIN 4096
+
+struct parallel_sum
+{
+    const unsigned int *data;
+    LONG outstanding;
+    LONG sum;
+    LONG no_vproc;
+    HANDLE done;
+};
+
+struct sum_range
+{
+    struct parallel_sum *ps;
+    unsigned int start;
+    unsigned int end;
+};
+
+static void __cdecl sum_task_proc(void *arg)
+{
+    struct sum_range *range = arg, *upper;
+    struct parallel_sum *ps = range->ps;
+    unsigned int i;
+    LONG sum = 0;
+
+    if (p_Context_VirtualProcessorId() == -1)
+        InterlockedIncrement(&ps->no_vproc);
+
+    /* split the range, so the other workers can steal the upper halves */
+    while (range->end - range->start > SUM_TASK_GRAIN)
+    {
+        upper = malloc(sizeof(*upper));
+        upper->ps = ps;
+        upper->start = range->start + (range->end - range->start) / 2;
+        upper->end = range->end;
+        range->end = upper->start;
+
+        InterlockedIncrement(&ps->outstanding);
+        p_CurrentScheduler_ScheduleTask(sum_task_proc, upper);
+    }
+
+    for (i = range->start; i < range->end; i++)
+        sum += ps->data[i];
+    InterlockedExchangeAdd(&ps->sum, sum);
+    free(range);
+
+    if (!InterlockedDecrement(&ps->outstanding))
+        SetEvent(ps->done);
+}
+
+struct block_task
+{
+    Context *ctx;
+    HANDLE started;
+    HANDLE finished;
+};
+
+static void __cdecl block_task_proc(void *arg)
+{
+    struct block_task *bt = arg;
+
+    bt->ctx = p_Context_CurrentContext();
+    SetEvent(bt->started);
+    p_Context_Block();
+    SetEvent(bt->finished);
+}
+
+static void __cdecl set_event_task_proc(void *arg)
+{
+    SetEvent(arg);
+}
+
+static void test_Scheduler_tasks(void)
+{
+    static const unsigned int limits[] = { 1, 2, 4, 8 };
+    unsigned int i, j, n, count;
+    struct parallel_sum ps;
+    struct block_task bt;
+    struct sum_range *range;
+    SchedulerPolicy policy;
+    Scheduler *scheduler;
+    unsigned int *data;
+    LONG expected = 0;
+    SYSTEM_INFO si;
+    HANDLE event;
+    DWORD ret, start;
+
+    GetSystemInfo(&si);
+
+    /* the sums are only timed in interactive runs, a smaller array is enough otherwise */
+    count = winetest_interactive ? 1 << 22 : 1 << 16;
+    data = malloc(count * sizeof(*data));
+    for (i = 0; i < count; i++)
+    {
+        data[i] = i % 97;
+        expected += data[i];
+    }
+    ps.data = data;
+    ps.done = CreateEventW(NULL, FALSE, FALSE, NULL);
+
+    for (i = 0; i < ARRAY_SIZE(limits); i++)
+    {
+        winetest_push_context("%u", limits[i]);
+
+        call_func1(p_SchedulerPolicy_ctor, &policy);
+        call_func3(p_SchedulerPolicy_SetConcurrencyLimits, &policy, 1, limits[i]);
+        scheduler = p_Scheduler_Create(&policy);
+        ok(scheduler != NULL, "Scheduler::Create() = NULL\n");
+
+        n = call_func1(scheduler->vtable->GetNumberOfVirtualProcessors, scheduler);
+        ok(n == min(limits[i], si.dwNumberOfProcessors),
+                "Scheduler::GetNumberOfVirtualProcessors() = %u\n", n);
+
+        /* first run starts the worker threads */
+        for (j = 0; j < 2; j++)
+        {
+            ps.outstanding = 1;
+            ps.sum = 0;
+            ps.no_vproc = 0;
+            range = malloc(sizeof(*range));
+            range->ps = &ps;
+            range->start = 0;
+            range->end = count;
+
+            start = GetTickCount();
+            call_func3(scheduler->vtable->ScheduleTask, scheduler, sum_task_proc, range);
+            ret = WaitForSingleObject(ps.done, 10000);
+            ok(ret == WAIT_OBJECT_0, "WaitForSingleObject returned %u\n", ret);
+            ok(ps.sum == expected, "sum = %d, expected %d\n", ps.sum, expected);
+            ok(!ps.no_vproc, "%d tasks were not executed on a virtual processor\n", ps.no_vproc);
+        }
+        if (winetest_interactive)
+            trace("%u tasks summing %u elements: %u ms\n", count / SUM_TASK_GRAIN,
+                    count, GetTickCount() - start);
+
+        call_func1(scheduler->vtable->Release, scheduler);
+        call_func1(p_SchedulerPolicy_dtor, &policy);
+        winetest_pop_context();
+    }
+
+    /* a blocked task doesn't prevent other tasks from running */
+    call_func1(p_SchedulerPolicy_ctor, &policy);
+    call_func3(p_SchedulerPolicy_SetConcurrencyLimits, &policy, 1, 1);
+    scheduler = p_Scheduler_Create(&policy);
+
+    bt.ctx = NULL;
+    bt.started = CreateEventW(NULL, FALSE, FALSE, NULL);
+    bt.finished = CreateEventW(NULL, FALSE, FALSE, NULL);
+    event = CreateEventW(NULL, FALSE, FALSE, NULL);
+
+    call_func3(scheduler->vtable->ScheduleTask, scheduler, block_task_proc, &bt);
+    ret = WaitForSingleObject(bt.started, 5000);
+    ok(ret == WAIT_OBJECT_0, "WaitForSingleObject returned %u\n", ret);
+    ok(bt.ctx != NULL, "Context::CurrentContext() = NULL\n");
+
+    call_func3(scheduler->vtable->ScheduleTask, scheduler, set_event_task_proc, event);
+    ret = WaitForSingleObject(event, 5000);
+    ok(ret == WAIT_OBJECT_0, "WaitForSingleObject returned %u\n", ret);
+
+    for (i = 0; i < 100; i++)
+    {
+        if (call_func1(bt.ctx->vtable->IsSynchronouslyBlocked, bt.ctx)) break;
+        Sleep(10);
+    }
+    ok(i < 100, "context is not blocked\n");
+    ret = WaitForSingleObject(bt.finished, 0);
+    ok(ret == WAIT_TIMEOUT, "WaitForSingleObject returned %u\n", ret);
+
+    call_func1(bt.ctx->vtable->Unblock, bt.ctx);
+    ret = WaitForSingleObject(bt.finished, 5000);
+    ok(ret == WAIT_OBJECT_0, "WaitForSingleObject returned %u\n", ret);
+
+    call_func1(scheduler->vtable->Release, scheduler);
+    call_func1(p_SchedulerPolicy_dtor, &policy);
+
+    CloseHandle(event);
+    CloseHandle(bt.started);
+    CloseHandle(bt.finished);
+    CloseHandle(ps.done);
+    free(data);
+}
+
 static void test__memicmp(void)
 {
     static const char *s1 = "abc";
@@ -1113,6 +1311,7 @@ START_TEST(msvcr100)
 
     test_ExternalContextBase();
     test_Scheduler();
+    test_Scheduler_tasks();
     test_wmemcpy_s();
     test_wmemmove_s();
     test_fread_s();
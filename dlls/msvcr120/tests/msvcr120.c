@@ -162,6 +162,18 @@ typedef struct {
     Context *ctx;
 } _Context;
 
+typedef struct {
+    char data[64]; /* larger than the native object */
+} _StructuredTaskCollection;
+
+typedef struct _UnrealizedChore {
+    const vtable_ptr *vtable;
+    void (__cdecl *chore_proc)(struct _UnrealizedChore*);
+    void *task_collection;
+    void *chore_wrapper;
+    void *unk[6];
+} _UnrealizedChore;
+
 static char* (CDECL *p_setlocale)(int category, const char* locale);
 static struct MSVCRT_lconv* (CDECL *p_localeconv)(void);
 static size_t (CDECL *p_wcstombs_s)(size_t *ret, char* dest, size_t sz, const wchar_t* src, size_t max);
@@ -225,6 +237,13 @@ static void (__thiscall *p__Condition_variable_notify_all)(_Condition_variable*)
 static Context* (__cdecl *p_Context_CurrentContext)(void);
 static _Context* (__cdecl *p__Context__CurrentContext)(_Context*);
 
+static _StructuredTaskCollection* (__thiscall *p__StructuredTaskCollection_ctor)(_StructuredTaskCollection*, void*);
+static void (__thiscall *p__StructuredTaskCollection_dtor)(_StructuredTaskCollection*);
+static void (__thiscall *p__StructuredTaskCollection__Schedule)(_StructuredTaskCollection*, _UnrealizedChore*);
+static int (__stdcall *p__StructuredTaskCollection__RunAndWait)(_StructuredTaskCollection*, _UnrealizedChore*);
+static void (__thiscall *p__StructuredTaskCollection__Cancel)(_StructuredTaskCollection*);
+static MSVCRT_bool (__thiscall *p__StructuredTaskCollection__IsCanceling)(_StructuredTaskCollection*);
+
 #define SETNOFAIL(x,y) x = (void*)GetProcAddress(module,y)
 #define SET(x,y) do { SETNOFAIL(x,y); ok(x != NULL, "Export '%s' not found\n", y); } while(0)
 
@@ -311,6 +330,18 @@ static BOOL init(void)
                 "?notify_all@_Condition_variable@details@Concurrency@@QEAAXXZ");
         SET(p_Context_CurrentContext,
                 "?CurrentContext@Context@Concurrency@@SAPEAV12@XZ");
+        SET(p__StructuredTaskCollection_ctor,
+                "??0_StructuredTaskCollection@details@Concurrency@@QEAA@PEAV_CancellationTokenState@12@@Z");
+        SET(p__StructuredTaskCollection_dtor,
+                "??1_StructuredTaskCollection@details@Concurrency@@QEAA@XZ");
+        SET(p__StructuredTaskCollection__Schedule,
+                "?_Schedule@_StructuredTaskCollection@details@Concurrency@@QEAAXPEAV_UnrealizedChore@23@@Z");
+        SET(p__StructuredTaskCollection__RunAndWait,
+                "?_RunAndWait@_StructuredTaskCollection@details@Concurrency@@QEAA?AW4_TaskCollectionStatus@23@PEAV_UnrealizedChore@23@@Z");
+        SET(p__StructuredTaskCollection__Cancel,
+                "?_Cancel@_StructuredTaskCollection@details@Concurrency@@QEAAXXZ");
+        SET(p__StructuredTaskCollection__IsCanceling,
+                "?_IsCanceling@_StructuredTaskCollection@details@Concurrency@@QEAA_NXZ");
     } else {
 #ifdef __arm__
         SET(p_critical_section_ctor,
@@ -343,6 +374,18 @@ static BOOL init(void)
                 "?notify_one@_Condition_variable@details@Concurrency@@QAAXXZ");
         SET(p__Condition_variable_notify_all,
                 "?notify_all@_Condition_variable@details@Concurrency@@QAAXXZ");
+        SET(p__StructuredTaskCollection_ctor,
+                "??0_StructuredTaskCollection@details@Concurrency@@QAA@PAV_CancellationTokenState@12@@Z");
+        SET(p__StructuredTaskCollection_dtor,
+                "??1_StructuredTaskCollection@details@Concurrency@@QAA@XZ");
+        SET(p__StructuredTaskCollection__Schedule,
+                "?_Schedule@_StructuredTaskCollection@details@Concurrency@@QAAXPAV_UnrealizedChore@23@@Z");
+        SET(p__StructuredTaskCollection__RunAndWait,
+                "?_RunAndWait@_StructuredTaskCollection@details@Concurrency@@QAA?AW4_TaskCollectionStatus@23@PAV_UnrealizedChore@23@@Z");
+        SET(p__StructuredTaskCollection__Cancel,
+                "?_Cancel@_StructuredTaskCollection@details@Concurrency@@QAAXXZ");
+        SET(p__StructuredTaskCollection__IsCanceling,
+                "?_IsCanceling@_StructuredTaskCollection@details@Concurrency@@QAA_NXZ");
 #else
         SET(p_critical_section_ctor,
                 "??0critical_section@Concurrency@@QAE@XZ");
@@ -374,6 +417,18 @@ static BOOL init(void)
                 "?notify_one@_Condition_variable@details@Concurrency@@QAEXXZ");
         SET(p__Condition_variable_notify_all,
                 "?notify_all@_Condition_variable@details@Concurrency@@QAEXXZ");
+        SET(p__StructuredTaskCollection_ctor,
+                "??0_StructuredTaskCollection@details@Concurrency@@QAE@PAV_CancellationTokenState@12@@Z");
+        SET(p__StructuredTaskCollection_dtor,
+                "??1_StructuredTaskCollection@details@Concurrency@@QAE@XZ");
+        SET(p__StructuredTaskCollection__Schedule,
+                "?_Schedule@_StructuredTaskCollection@details@Concurrency@@QAEXPAV_UnrealizedChore@23@@Z");
+        SET(p__StructuredTaskCollection__RunAndWait,
+                "?_RunAndWait@_StructuredTaskCollection@details@Concurrency@@QAG?AW4_TaskCollectionStatus@23@PAV_UnrealizedChore@23@@Z");
+        SET(p__StructuredTaskCollection__Cancel,
+                "?_Cancel@_StructuredTaskCollection@details@Concurrency@@QAEXXZ");
+        SET(p__StructuredTaskCollection__IsCanceling,
+                "?_IsCanceling@_StructuredTaskCollection@details@Concurrency@@QAE_NXZ");
 #endif
         SET(p_Context_CurrentContext,
                 "?CurrentContext@Context@Concurrency@@SAPAV12@XZ");
@@ -1270,6 +1325,66 @@ static void test_CurrentContext(void)
     ok(ret == &_ctx, "expected %p, got %p\n", &_ctx, ret);
 }
 
+static LONG chore_calls;
+
+static void chore_dtor(void)
+{
+}
+
+static const vtable_ptr chore_vtable[] = { chore_dtor };
+
+static void __cdecl chore_proc(_UnrealizedChore *chore)
+{
+    InterlockedIncrement(&chore_calls);
+}
+
+static void test__StructuredTaskCollection(void)
+{
+    _StructuredTaskCollection collection;
+    _UnrealizedChore chores[8], inline_chore;
+    MSVCRT_bool canceling;
+    int i, ret;
+
+    for (i = 0; i < ARRAY_SIZE(chores); i++)
+    {
+        memset(&chores[i], 0, sizeof(chores[i]));
+        chores[i].vtable = chore_vtable;
+        chores[i].chore_proc = chore_proc;
+    }
+    memset(&inline_chore, 0, sizeof(inline_chore));
+    inline_chore.vtable = chore_vtable;
+    inline_chore.chore_proc = chore_proc;
+
+    call_func2(p__StructuredTaskCollection_ctor, &collection, NULL);
+
+    chore_calls = 0;
+    for (i = 0; i < ARRAY_SIZE(chores); i++)
+        call_func2(p__StructuredTaskCollection__Schedule, &collection, &chores[i]);
+    ret = p__StructuredTaskCollection__RunAndWait(&collection, NULL);
+    ok(ret == 1, "_RunAndWait returned %d\n", ret);
+    ok(chore_calls == ARRAY_SIZE(chores), "chore_calls = %d\n", chore_calls);
+
+    /* the collection can be reused after waiting */
+    chore_calls = 0;
+    for (i = 0; i < ARRAY_SIZE(chores); i++)
+        call_func2(p__StructuredTaskCollection__Schedule, &collection, &chores[i]);
+    ret = p__StructuredTaskCollection__RunAndWait(&collection, &inline_chore);
+    ok(ret == 1, "_RunAndWait returned %d\n", ret);
+    ok(chore_calls == ARRAY_SIZE(chores) + 1, "chore_calls = %d\n", chore_calls);
+
+    canceling = call_func1(p__StructuredTaskCollection__IsCanceling, &collection);
+    ok(!canceling, "_IsCanceling returned %d\n", canceling);
+    call_func1(p__StructuredTaskCollection__Cancel, &collection);
+    canceling = call_func1(p__StructuredTaskCollection__IsCanceling, &collection);
+    ok(canceling, "_IsCanceling returned %d\n", canceling);
+    ret = p__StructuredTaskCollection__RunAndWait(&collection, NULL);
+    ok(ret == 2, "_RunAndWait returned %d\n", ret);
+    canceling = call_func1(p__StructuredTaskCollection__IsCanceling, &collection);
+    ok(!canceling, "_IsCanceling returned %d\n", canceling);
+
+    call_func1(p__StructuredTaskCollection_dtor, &collection);
+}
+
 START_TEST(msvcr120)
 {
     if (!init()) return;
@@ -1292,4 +1407,5 @@ START_TEST(msvcr120)
     test_nexttoward();
     test_towctrans();
     test_CurrentContext();
+    test__StructuredTaskCollection();
 }
@@ -134,4 +134,29 @@ static inline void bnum_mult(struct bnum *b, int mult)
     }
 }
 
+static inline int clz64(ULONGLONG x)
+{
+    int ret = 0;
+
+    if(!(x >> 32)) { ret += 32; x <<= 32; }
+    if(!(x >> 48)) { ret += 16; x <<= 16; }
+    if(!(x >> 56)) { ret += 8; x <<= 8; }
+    if(!(x >> 60)) { ret += 4; x <<= 4; }
+    if(!(x >> 62)) { ret += 2; x <<= 2; }
+    if(!(x >> 63)) ret++;
+    return ret;
+}
+
+static inline void mul_64x64(ULONGLONG a, ULONGLONG b, ULONGLONG *hi, ULONGLONG *lo)
+{
+    ULONGLONG ll = (a & 0xffffffff) * (b & 0xffffffff);
+    ULONGLONG lh = (a & 0xffffffff) * (b >> 32);
+    ULONGLONG hl = (a >> 32) * (b & 0xffffffff);
+    ULONGLONG hh = (a >> 32) * (b >> 32);
+    ULONGLONG mid = (ll >> 32) + (lh & 0xffffffff) + (hl & 0xffffffff);
+
+    *lo = (mid << 32) | (ll & 0xffffffff);
+    *hi = hh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+}
+
 #endif /* __WINE_BNUM_H */
@@ -24,6 +24,7 @@
 #include "windef.h"
 #include "winternl.h"
 #include "wine/debug.h"
+#include "wine/exception.h"
 #include "msvcrt.h"
 #include "cxx.h"
 
@@ -89,11 +90,17 @@ struct scheduler_list {
     struct scheduler_list *next;
 };
 
+struct scheduler_worker;
+
 typedef struct {
     Context context;
     struct scheduler_list scheduler;
     unsigned int id;
     union allocator_cache_entry *allocator_cache[8];
+    struct scheduler_worker *worker;
+    LONG blocked;
+    LONG oversubscribed;
+    struct _StructuredTaskCollection *task_collection;
 } ExternalContextBase;
 extern const vtable_ptr ExternalContextBase_vtable;
 static void ExternalContextBase_ctor(ExternalContextBase*);
@@ -135,13 +142,92 @@ typedef struct {
     int shutdown_size;
     HANDLE *shutdown_events;
     CRITICAL_SECTION cs;
+    struct scheduler_pool *pool;
 } ThreadScheduler;
 extern const vtable_ptr ThreadScheduler_vtable;
 
+struct scheduler_task {
+    void (__cdecl *proc)(void*);
+    void *data;
+};
+
+/* Work-stealing queue: the owning worker pushes and pops tasks at the
+ * tail, other workers steal the oldest tasks from the head. */
+struct task_queue {
+    SRWLOCK lock;
+    struct scheduler_task *tasks;
+    LONG size;
+    LONG head;
+    LONG tail;
+};
+
+struct scheduler_worker {
+    struct scheduler_pool *pool;
+    struct task_queue queue;
+    BOOL active;
+};
+
+struct scheduler_pool {
+    LONG ref;
+    ThreadScheduler *scheduler;
+    CRITICAL_SECTION cs;
+    CONDITION_VARIABLE cv;
+    /* tasks scheduled from threads not owned by the pool */
+    struct task_queue inject;
+    struct scheduler_worker *workers;
+    LONG max_workers;
+    LONG target;
+    /* started and blocked are only modified with cs held */
+    LONG started;
+    LONG blocked;
+    LONG idle;
+    LONG pending;
+    BOOL shutdown;
+    SIZE_T stack_size;
+    int priority;
+};
+
+/* idle workers exit after this many milliseconds */
+#define SCHEDULER_WORKER_TIMEOUT 5000
+/* additional workers that can be started to replace blocked ones */
+#define SCHEDULER_MAX_COMPENSATION 64
+
 typedef struct {
     Scheduler *scheduler;
 } _Scheduler;
 
+typedef enum {
+    TASK_COLLECTION_SUCCESS = 1,
+    TASK_COLLECTION_CANCELLED
+} _TaskCollectionStatus;
+
+typedef struct _StructuredTaskCollection {
+    void *unk1;
+    unsigned int unk2;
+    void *unk3;
+    Context *context;
+    /* chores scheduled and finished since the last wait, finished is set to
+     * FINISHED_INITIAL by the constructor that's inlined in msvcr100 code */
+    volatile LONG count;
+    volatile LONG finished;
+    /* exception_ptr of the first exception thrown by a chore, the low bits
+     * hold the STRUCTURED_TASK_COLLECTION_* flags */
+    void *exception;
+    void *unk4;
+} _StructuredTaskCollection;
+
+#define FINISHED_INITIAL 0x80000000
+#define STRUCTURED_TASK_COLLECTION_CANCELLED 0x2
+#define STRUCTURED_TASK_COLLECTION_STATUS_MASK 0x7
+
+typedef struct _UnrealizedChore {
+    const vtable_ptr *vtable;
+    void (__cdecl *chore_proc)(struct _UnrealizedChore*);
+    _StructuredTaskCollection *task_collection;
+    void (__cdecl *chore_wrapper)(struct _UnrealizedChore*);
+    void *unk[6];
+} _UnrealizedChore;
+
 typedef struct {
     char empty;
 } _CurrentScheduler;
@@ -351,6 +437,9 @@ static ThreadScheduler *default_scheduler;
 static HANDLE keyed_event;
 
 static void create_default_scheduler(void);
+static void scheduler_pool_set_blocked(struct scheduler_pool*, BOOL);
+unsigned int __thiscall ThreadScheduler_Reference(ThreadScheduler*);
+unsigned int __thiscall ThreadScheduler_Release(ThreadScheduler*);
 
 /* ??0improper_lock@Concurrency@@QAE@PBD@Z */
 /* ??0improper_lock@Concurrency@@QEAA@PEBD@Z */
@@ -610,10 +699,8 @@ static Context* try_get_current_context(void)
     return TlsGetValue(context_tls_index);
 }
 
-static Context* get_current_context(void)
+static void alloc_context_tls(void)
 {
-    Context *ret;
-
     if (context_tls_index == TLS_OUT_OF_INDEXES) {
         int tls_index = TlsAlloc();
         if (tls_index == TLS_OUT_OF_INDEXES) {
@@ -626,7 +713,13 @@ static Context* get_current_context(void)
         if(InterlockedCompareExchange(&context_tls_index, tls_index, TLS_OUT_OF_INDEXES) != TLS_OUT_OF_INDEXES)
             TlsFree(tls_index);
     }
+}
 
+static Context* get_current_context(void)
+{
+    Context *ret;
+
+    alloc_context_tls();
     ret = TlsGetValue(context_tls_index);
     if (!ret) {
         ExternalContextBase *context = operator_new(sizeof(ExternalContextBase));
@@ -678,36 +771,89 @@ unsigned int __cdecl Context_Id(void)
     return ctx ? call_Context_GetId(ctx) : -1;
 }
 
+static void create_keyed_event(void)
+{
+    if(!keyed_event) {
+        HANDLE event;
+
+        NtCreateKeyedEvent(&event, GENERIC_READ|GENERIC_WRITE, NULL, 0);
+        if(InterlockedCompareExchangePointer(&keyed_event, event, NULL) != NULL)
+            NtClose(event);
+    }
+}
+
 /* ?Block@Context@Concurrency@@SAXXZ */
 void __cdecl Context_Block(void)
 {
-    FIXME("()\n");
+    ExternalContextBase *context = (ExternalContextBase*)get_current_context();
+
+    TRACE("()\n");
+
+    if(context->context.vtable != &ExternalContextBase_vtable) {
+        ERR("unknown context set\n");
+        return;
+    }
+
+    /* Unblock was already called */
+    if(InterlockedDecrement(&context->blocked) >= 0)
+        return;
+
+    create_keyed_event();
+    if(context->worker)
+        scheduler_pool_set_blocked(context->worker->pool, TRUE);
+    NtWaitForKeyedEvent(keyed_event, &context->blocked, 0, NULL);
+    if(context->worker)
+        scheduler_pool_set_blocked(context->worker->pool, FALSE);
 }
 
 /* ?Yield@Context@Concurrency@@SAXXZ */
 /* ?_Yield@_Context@details@Concurrency@@SAXXZ */
 void __cdecl Context_Yield(void)
 {
-    FIXME("()\n");
+    TRACE("()\n");
+    SwitchToThread();
 }
 
 /* ?_SpinYield@Context@Concurrency@@SAXXZ */
 void __cdecl Context__SpinYield(void)
 {
-    FIXME("()\n");
+    TRACE("()\n");
+    Sleep(0);
 }
 
 /* ?IsCurrentTaskCollectionCanceling@Context@Concurrency@@SA_NXZ */
 bool __cdecl Context_IsCurrentTaskCollectionCanceling(void)
 {
-    FIXME("()\n");
-    return FALSE;
+    ExternalContextBase *context = (ExternalContextBase*)try_get_current_context();
+
+    TRACE("()\n");
+
+    if (context && context->context.vtable != &ExternalContextBase_vtable) {
+        ERR("unknown context set\n");
+        return FALSE;
+    }
+
+    return context && context->task_collection &&
+        ((ULONG_PTR)context->task_collection->exception & STRUCTURED_TASK_COLLECTION_CANCELLED);
 }
 
 /* ?Oversubscribe@Context@Concurrency@@SAX_N@Z */
 void __cdecl Context_Oversubscribe(bool begin)
 {
-    FIXME("(%x)\n", begin);
+    ExternalContextBase *context = (ExternalContextBase*)try_get_current_context();
+
+    TRACE("(%x)\n", begin);
+
+    if(!context || context->context.vtable != &ExternalContextBase_vtable || !context->worker)
+        return;
+
+    /* an oversubscribed worker is replaced by an additional thread, like a blocked one */
+    if(begin) {
+        if(context->oversubscribed++) return;
+    } else {
+        if(!context->oversubscribed || --context->oversubscribed) return;
+    }
+    scheduler_pool_set_blocked(context->worker->pool, begin);
 }
 
 /* ?ScheduleGroupId@Context@Concurrency@@SAIXZ */
@@ -746,8 +892,11 @@ unsigned int __thiscall ExternalContextBase_GetId(const ExternalContextBase *thi
 DEFINE_THISCALL_WRAPPER(ExternalContextBase_GetVirtualProcessorId, 4)
 unsigned int __thiscall ExternalContextBase_GetVirtualProcessorId(const ExternalContextBase *this)
 {
-    FIXME("(%p)->() stub\n", this);
-    return -1;
+    TRACE("(%p)->()\n", this);
+
+    if(!this->worker)
+        return -1;
+    return this->worker - this->worker->pool->workers;
 }
 
 DEFINE_THISCALL_WRAPPER(ExternalContextBase_GetScheduleGroupId, 4)
@@ -760,14 +909,23 @@ unsigned int __thiscall ExternalContextBase_GetScheduleGroupId(const ExternalCon
 DEFINE_THISCALL_WRAPPER(ExternalContextBase_Unblock, 4)
 void __thiscall ExternalContextBase_Unblock(ExternalContextBase *this)
 {
-    FIXME("(%p)->() stub\n", this);
+    TRACE("(%p)->()\n", this);
+
+    if(&this->context == try_get_current_context()) {
+        WARN("trying to unblock current context\n");
+        return;
+    }
+
+    create_keyed_event();
+    if(InterlockedIncrement(&this->blocked) == 0)
+        NtReleaseKeyedEvent(keyed_event, &this->blocked, 0, NULL);
 }
 
 DEFINE_THISCALL_WRAPPER(ExternalContextBase_IsSynchronouslyBlocked, 4)
 bool __thiscall ExternalContextBase_IsSynchronouslyBlocked(const ExternalContextBase *this)
 {
-    FIXME("(%p)->() stub\n", this);
-    return FALSE;
+    TRACE("(%p)->()\n", this);
+    return this->blocked < 0;
 }
 
 static void ExternalContextBase_dtor(ExternalContextBase *this)
@@ -815,17 +973,23 @@ Context* __thiscall ExternalContextBase_vector_dtor(ExternalContextBase *this, u
     return &this->context;
 }
 
-static void ExternalContextBase_ctor(ExternalContextBase *this)
+static void ExternalContextBase_ctor_scheduler(ExternalContextBase *this, Scheduler *scheduler)
 {
-    TRACE("(%p)->()\n", this);
+    TRACE("(%p)->(%p)\n", this, scheduler);
 
     memset(this, 0, sizeof(*this));
     this->context.vtable = &ExternalContextBase_vtable;
     this->id = InterlockedIncrement(&context_id);
 
+    this->scheduler.scheduler = scheduler;
+    if(scheduler)
+        call_Scheduler_Reference(scheduler);
+}
+
+static void ExternalContextBase_ctor(ExternalContextBase *this)
+{
     create_default_scheduler();
-    this->scheduler.scheduler = &default_scheduler->scheduler;
-    call_Scheduler_Reference(&default_scheduler->scheduler);
+    ExternalContextBase_ctor_scheduler(this, &default_scheduler->scheduler);
 }
 
 /* ?Alloc@Concurrency@@YAPAXI@Z */
@@ -1085,11 +1249,338 @@ void __thiscall SchedulerPolicy_dtor(SchedulerPolicy *this)
     operator_delete(this->policy_container);
 }
 
+static void task_queue_init(struct task_queue *queue)
+{
+    InitializeSRWLock(&queue->lock);
+    queue->tasks = NULL;
+    queue->size = queue->head = queue->tail = 0;
+}
+
+static BOOL task_queue_push(struct task_queue *queue, const struct scheduler_task *task)
+{
+    AcquireSRWLockExclusive(&queue->lock);
+    if(queue->tail - queue->head == queue->size) {
+        LONG i, size = queue->size ? queue->size * 2 : 32;
+        struct scheduler_task *tasks = malloc(size * sizeof(*tasks));
+
+        if(!tasks) {
+            ReleaseSRWLockExclusive(&queue->lock);
+            return FALSE;
+        }
+        for(i = 0; i < queue->tail - queue->head; i++)
+            tasks[i] = queue->tasks[(queue->head + i) & (queue->size - 1)];
+        free(queue->tasks);
+        queue->tasks = tasks;
+        queue->size = size;
+        queue->tail -= queue->head;
+        queue->head = 0;
+    }
+    queue->tasks[queue->tail++ & (queue->size - 1)] = *task;
+    ReleaseSRWLockExclusive(&queue->lock);
+    return TRUE;
+}
+
+/* takes the most recently pushed task, only used by the owner of the queue */
+static BOOL task_queue_pop(struct task_queue *queue, struct scheduler_task *task)
+{
+    BOOL ret = FALSE;
+
+    if(queue->head == queue->tail)
+        return FALSE;
+
+    AcquireSRWLockExclusive(&queue->lock);
+    if(queue->head != queue->tail) {
+        *task = queue->tasks[--queue->tail & (queue->size - 1)];
+        ret = TRUE;
+    }
+    ReleaseSRWLockExclusive(&queue->lock);
+    return ret;
+}
+
+/* takes the oldest task from the queue */
+static BOOL task_queue_steal(struct task_queue *queue, struct scheduler_task *task)
+{
+    BOOL ret = FALSE;
+
+    if(queue->head == queue->tail)
+        return FALSE;
+
+    if(!TryAcquireSRWLockExclusive(&queue->lock))
+        return FALSE;
+    if(queue->head != queue->tail) {
+        *task = queue->tasks[queue->head++ & (queue->size - 1)];
+        ret = TRUE;
+    }
+    ReleaseSRWLockExclusive(&queue->lock);
+    return ret;
+}
+
+static struct scheduler_pool* scheduler_pool_create(ThreadScheduler *scheduler)
+{
+    struct scheduler_pool *pool = operator_new(sizeof(*pool));
+    unsigned int stack_size;
+    LONG i;
+
+    pool->ref = 1;
+    pool->scheduler = scheduler;
+    InitializeCriticalSection(&pool->cs);
+    pool->cs.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": scheduler_pool");
+    InitializeConditionVariable(&pool->cv);
+    task_queue_init(&pool->inject);
+
+    pool->target = scheduler->virt_proc_no;
+    pool->max_workers = pool->target + SCHEDULER_MAX_COMPENSATION;
+    pool->workers = operator_new(pool->max_workers * sizeof(*pool->workers));
+    for(i = 0; i < pool->max_workers; i++) {
+        pool->workers[i].pool = pool;
+        task_queue_init(&pool->workers[i].queue);
+        pool->workers[i].active = FALSE;
+    }
+    pool->started = pool->blocked = 0;
+    pool->idle = pool->pending = 0;
+    pool->shutdown = FALSE;
+
+    stack_size = SchedulerPolicy_GetPolicyValue(&scheduler->policy, ContextStackSize);
+    pool->stack_size = (SIZE_T)stack_size * 1024;
+    pool->priority = SchedulerPolicy_GetPolicyValue(&scheduler->policy, ContextPriority);
+    return pool;
+}
+
+static void scheduler_pool_release(struct scheduler_pool *pool)
+{
+    LONG i;
+
+    if(InterlockedDecrement(&pool->ref))
+        return;
+
+    for(i = 0; i < pool->max_workers; i++)
+        free(pool->workers[i].queue.tasks);
+    operator_delete(pool->workers);
+    free(pool->inject.tasks);
+    pool->cs.DebugInfo->Spare[0] = 0;
+    DeleteCriticalSection(&pool->cs);
+    operator_delete(pool);
+}
+
+static BOOL scheduler_pool_get_task(struct scheduler_pool *pool,
+        struct scheduler_worker *worker, struct scheduler_task *task)
+{
+    LONG i, idx = worker - pool->workers;
+
+    if(task_queue_pop(&worker->queue, task))
+        goto done;
+    if(task_queue_steal(&pool->inject, task))
+        goto done;
+    for(i = 1; i < pool->max_workers; i++) {
+        struct scheduler_worker *victim = pool->workers + (idx + i) % pool->max_workers;
+
+        if(task_queue_steal(&victim->queue, task))
+            goto done;
+    }
+    return FALSE;
+
+done:
+    InterlockedDecrement(&pool->pending);
+    return TRUE;
+}
+
+static DWORD WINAPI scheduler_worker_proc(void *arg)
+{
+    struct scheduler_worker *worker = arg;
+    struct scheduler_pool *pool = worker->pool;
+    ExternalContextBase *context;
+    struct scheduler_task task;
+    HMODULE module;
+    BOOL timed_out;
+
+    TRACE("(%p) started\n", worker);
+
+    if(!GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS,
+                (const WCHAR*)scheduler_worker_proc, &module))
+        module = NULL;
+
+    /* The context only references the scheduler while it's running tasks,
+     * an idle worker must not keep the scheduler (and the pool) alive. */
+    context = operator_new(sizeof(*context));
+    ExternalContextBase_ctor_scheduler(context, NULL);
+    context->worker = worker;
+    alloc_context_tls();
+    TlsSetValue(context_tls_index, context);
+
+    for(;;) {
+        while(scheduler_pool_get_task(pool, worker, &task)) {
+            ThreadScheduler *scheduler = pool->scheduler;
+
+            /* the first task's reference is kept by the context */
+            if(!context->scheduler.scheduler) {
+                context->scheduler.scheduler = &scheduler->scheduler;
+                task.proc(task.data);
+            } else {
+                task.proc(task.data);
+                ThreadScheduler_Release(scheduler);
+            }
+        }
+
+        if(context->scheduler.scheduler) {
+            Scheduler *scheduler = context->scheduler.scheduler;
+
+            /* may destroy the scheduler and shut the pool down */
+            context->scheduler.scheduler = NULL;
+            call_Scheduler_Release(scheduler);
+        }
+
+        EnterCriticalSection(&pool->cs);
+        if(pool->shutdown || pool->started > pool->target + pool->blocked)
+            break;
+
+        InterlockedIncrement(&pool->idle);
+        timed_out = FALSE;
+        while(!pool->pending && !pool->shutdown && !timed_out)
+            timed_out = !SleepConditionVariableCS(&pool->cv, &pool->cs, SCHEDULER_WORKER_TIMEOUT);
+        InterlockedDecrement(&pool->idle);
+
+        if(pool->shutdown || (timed_out && !pool->pending))
+            break;
+        LeaveCriticalSection(&pool->cs);
+    }
+
+    /* the queue is empty, nothing else can push tasks to it */
+    worker->active = FALSE;
+    pool->started--;
+    LeaveCriticalSection(&pool->cs);
+
+    TRACE("(%p) exiting\n", worker);
+
+    TlsSetValue(context_tls_index, NULL);
+    ExternalContextBase_dtor(context);
+    operator_delete(context);
+    scheduler_pool_release(pool);
+
+    if(module)
+        FreeLibraryAndExitThread(module, 0);
+    return 0;
+}
+
+/* called with pool->cs held */
+static void scheduler_pool_start_worker(struct scheduler_pool *pool)
+{
+    struct scheduler_worker *worker = NULL;
+    HANDLE thread;
+    LONG i;
+
+    for(i = 0; i < pool->max_workers; i++) {
+        if(!pool->workers[i].active) {
+            worker = pool->workers + i;
+            break;
+        }
+    }
+    if(!worker) {
+        WARN("too many workers started\n");
+        return;
+    }
+
+    InterlockedIncrement(&pool->ref);
+    thread = CreateThread(NULL, pool->stack_size, scheduler_worker_proc,
+            worker, CREATE_SUSPENDED | STACK_SIZE_PARAM_IS_A_RESERVATION, NULL);
+    if(!thread) {
+        ERR("failed to create worker thread: %d\n", GetLastError());
+        InterlockedDecrement(&pool->ref);
+        return;
+    }
+
+    worker->active = TRUE;
+    pool->started++;
+    if(pool->priority != INHERIT_THREAD_PRIORITY)
+        SetThreadPriority(thread, pool->priority);
+    ResumeThread(thread);
+    CloseHandle(thread);
+}
+
+/* Exiting workers decide to exit and update started under pool->cs, so it
+ * has to be taken here even if the pool looks busy. */
+static void scheduler_pool_wake(struct scheduler_pool *pool)
+{
+    EnterCriticalSection(&pool->cs);
+    if(pool->idle)
+        WakeConditionVariable(&pool->cv);
+    else if(pool->started < pool->target + pool->blocked)
+        scheduler_pool_start_worker(pool);
+    LeaveCriticalSection(&pool->cs);
+}
+
+/* Blocked workers are compensated by starting additional ones when
+ * there's pending work, so blocking inside of a task can't starve the pool. */
+static void scheduler_pool_set_blocked(struct scheduler_pool *pool, BOOL blocked)
+{
+    EnterCriticalSection(&pool->cs);
+    if(blocked) {
+        pool->blocked++;
+        if(pool->pending && !pool->idle)
+            scheduler_pool_start_worker(pool);
+    } else {
+        pool->blocked--;
+    }
+    LeaveCriticalSection(&pool->cs);
+}
+
+/* runs a pending task of the worker's pool on the current thread, used by
+ * workers that wait for other tasks */
+static BOOL scheduler_worker_run_task(struct scheduler_worker *worker)
+{
+    struct scheduler_pool *pool = worker->pool;
+    ThreadScheduler *scheduler = pool->scheduler;
+    struct scheduler_task task;
+
+    if(!scheduler_pool_get_task(pool, worker, &task))
+        return FALSE;
+
+    task.proc(task.data);
+    ThreadScheduler_Release(scheduler);
+    return TRUE;
+}
+
+static void scheduler_pool_schedule(struct scheduler_pool *pool,
+        void (__cdecl *proc)(void*), void *data)
+{
+    ExternalContextBase *context = (ExternalContextBase*)try_get_current_context();
+    struct task_queue *queue = &pool->inject;
+    struct scheduler_task task;
+
+    if(context && context->context.vtable == &ExternalContextBase_vtable
+            && context->worker && context->worker->pool == pool)
+        queue = &context->worker->queue;
+
+    task.proc = proc;
+    task.data = data;
+    /* the scheduler is kept alive until the task is executed */
+    ThreadScheduler_Reference(pool->scheduler);
+    if(!task_queue_push(queue, &task)) {
+        scheduler_resource_allocation_error e;
+
+        ThreadScheduler_Release(pool->scheduler);
+        scheduler_resource_allocation_error_ctor_name(&e, NULL, E_OUTOFMEMORY);
+        _CxxThrowException(&e, &scheduler_resource_allocation_error_exception_type);
+    }
+
+    InterlockedIncrement(&pool->pending);
+    scheduler_pool_wake(pool);
+}
+
+static void scheduler_pool_shutdown(struct scheduler_pool *pool)
+{
+    EnterCriticalSection(&pool->cs);
+    pool->shutdown = TRUE;
+    WakeAllConditionVariable(&pool->cv);
+    LeaveCriticalSection(&pool->cs);
+    scheduler_pool_release(pool);
+}
+
 static void ThreadScheduler_dtor(ThreadScheduler *this)
 {
     int i;
 
     if(this->ref != 0) WARN("ref = %d\n", this->ref);
+    scheduler_pool_shutdown(this->pool);
     SchedulerPolicy_dtor(&this->policy);
 
     for(i=0; i<this->shutdown_count; i++)
@@ -1211,14 +1702,21 @@ DEFINE_THISCALL_WRAPPER(ThreadScheduler_ScheduleTask_loc, 16)
 void __thiscall ThreadScheduler_ScheduleTask_loc(ThreadScheduler *this,
         void (__cdecl *proc)(void*), void* data, /*location*/void *placement)
 {
-    FIXME("(%p %p %p %p) stub\n", this, proc, data, placement);
+    static int once;
+
+    if(!once++)
+        FIXME("(%p %p %p %p) placement ignored\n", this, proc, data, placement);
+    else
+        TRACE("(%p %p %p %p)\n", this, proc, data, placement);
+    scheduler_pool_schedule(this->pool, proc, data);
 }
 
 DEFINE_THISCALL_WRAPPER(ThreadScheduler_ScheduleTask, 12)
 void __thiscall ThreadScheduler_ScheduleTask(ThreadScheduler *this,
         void (__cdecl *proc)(void*), void* data)
 {
-    FIXME("(%p %p %p) stub\n", this, proc, data);
+    TRACE("(%p %p %p)\n", this, proc, data);
+    scheduler_pool_schedule(this->pool, proc, data);
 }
 
 DEFINE_THISCALL_WRAPPER(ThreadScheduler_IsAvailableLocation, 8)
@@ -1252,6 +1750,7 @@ Scheduler* __thiscall ThreadScheduler_vector_dtor(ThreadScheduler *this, unsigne
 static ThreadScheduler* ThreadScheduler_ctor(ThreadScheduler *this,
         const SchedulerPolicy *policy)
 {
+    unsigned int min_concurrency;
     SYSTEM_INFO si;
 
     TRACE("(%p)->()\n", this);
@@ -1265,12 +1764,17 @@ static ThreadScheduler* ThreadScheduler_ctor(ThreadScheduler *this,
     this->virt_proc_no = SchedulerPolicy_GetPolicyValue(&this->policy, MaxConcurrency);
     if(this->virt_proc_no > si.dwNumberOfProcessors)
         this->virt_proc_no = si.dwNumberOfProcessors;
+    min_concurrency = SchedulerPolicy_GetPolicyValue(&this->policy, MinConcurrency);
+    if(this->virt_proc_no < min_concurrency)
+        this->virt_proc_no = min_concurrency;
 
     this->shutdown_count = this->shutdown_size = 0;
     this->shutdown_events = NULL;
 
     InitializeCriticalSection(&this->cs);
     this->cs.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": ThreadScheduler");
+
+    this->pool = scheduler_pool_create(this);
     return this;
 }
 
@@ -1554,6 +2058,295 @@ void __cdecl _CurrentScheduler__ScheduleTask(void (__cdecl *proc)(void*), void *
     CurrentScheduler_ScheduleTask(proc, data);
 }
 
+struct execute_chore_data {
+    _UnrealizedChore *chore;
+    _StructuredTaskCollection *task_collection;
+};
+
+/* ?_Cancel@_StructuredTaskCollection@details@Concurrency@@QAEXXZ */
+/* ?_Cancel@_StructuredTaskCollection@details@Concurrency@@QEAAXXZ */
+DEFINE_THISCALL_WRAPPER(_StructuredTaskCollection__Cancel, 4)
+void __thiscall _StructuredTaskCollection__Cancel(_StructuredTaskCollection *this)
+{
+    void *exception, *prev;
+
+    TRACE("(%p)\n", this);
+
+    exception = this->exception;
+    do {
+        if ((ULONG_PTR)exception & STRUCTURED_TASK_COLLECTION_CANCELLED)
+            return;
+        prev = exception;
+        exception = InterlockedCompareExchangePointer(&this->exception,
+                (void*)((ULONG_PTR)prev | STRUCTURED_TASK_COLLECTION_CANCELLED), prev);
+    } while (exception != prev);
+}
+
+/* ?_IsCanceling@_StructuredTaskCollection@details@Concurrency@@QAE_NXZ */
+/* ?_IsCanceling@_StructuredTaskCollection@details@Concurrency@@QEAA_NXZ */
+DEFINE_THISCALL_WRAPPER(_StructuredTaskCollection__IsCanceling, 4)
+bool __thiscall _StructuredTaskCollection__IsCanceling(_StructuredTaskCollection *this)
+{
+    TRACE("(%p)\n", this);
+    return !!((ULONG_PTR)this->exception & STRUCTURED_TASK_COLLECTION_CANCELLED);
+}
+
+/* C++ exceptions thrown by a chore cancel the collection, the first one is
+ * stored and rethrown by _RunAndWait */
+static LONG CALLBACK execute_chore_except(EXCEPTION_POINTERS *pexc, void *_data)
+{
+    struct execute_chore_data *data = _data;
+    void *exception, *prev;
+    exception_ptr *ptr;
+
+    if (pexc->ExceptionRecord->ExceptionCode != CXX_EXCEPTION)
+        return EXCEPTION_CONTINUE_SEARCH;
+
+    _StructuredTaskCollection__Cancel(data->task_collection);
+
+    ptr = operator_new(sizeof(*ptr));
+    __ExceptionPtrCreate(ptr);
+    exception_ptr_from_record(ptr, pexc->ExceptionRecord);
+
+    exception = data->task_collection->exception;
+    do {
+        if ((ULONG_PTR)exception & ~STRUCTURED_TASK_COLLECTION_STATUS_MASK) {
+            __ExceptionPtrDestroy(ptr);
+            operator_delete(ptr);
+            break;
+        }
+        prev = exception;
+        exception = InterlockedCompareExchangePointer(&data->task_collection->exception,
+                (void*)((ULONG_PTR)prev | (ULONG_PTR)ptr), prev);
+    } while (exception != prev);
+    return EXCEPTION_EXECUTE_HANDLER;
+}
+
+static void execute_chore(_UnrealizedChore *chore,
+        _StructuredTaskCollection *task_collection)
+{
+    ExternalContextBase *context = (ExternalContextBase*)get_current_context();
+    struct execute_chore_data data = { chore, task_collection };
+    _StructuredTaskCollection *prev = NULL;
+
+    TRACE("(%p %p)\n", chore, task_collection);
+
+    /* chores that didn't start before the collection was canceled are skipped */
+    if (task_collection->exception)
+        return;
+
+    if (context->context.vtable == &ExternalContextBase_vtable) {
+        prev = context->task_collection;
+        context->task_collection = task_collection;
+    }
+
+    __TRY
+    {
+        if (chore->chore_proc)
+            chore->chore_proc(chore);
+    }
+    __EXCEPT_CTX(execute_chore_except, &data)
+    {
+    }
+    __ENDTRY
+
+    if (context->context.vtable == &ExternalContextBase_vtable)
+        context->task_collection = prev;
+}
+
+static void __cdecl chore_wrapper_proc(void *data)
+{
+    _UnrealizedChore *chore = data;
+    _StructuredTaskCollection *task_collection = chore->task_collection;
+
+    execute_chore(chore, task_collection);
+
+    /* the chore and the collection may be destroyed once finished is updated */
+    chore->task_collection = NULL;
+    InterlockedIncrement(&task_collection->finished);
+    RtlWakeAddressSingle((void*)&task_collection->finished);
+}
+
+static void task_collection_init(_StructuredTaskCollection *this)
+{
+    if (this->finished != FINISHED_INITIAL)
+        return;
+
+    this->context = get_current_context();
+    this->count = 0;
+    this->finished = 0;
+}
+
+/* ??0_StructuredTaskCollection@details@Concurrency@@QAE@PAV_CancellationTokenState@12@@Z */
+/* ??0_StructuredTaskCollection@details@Concurrency@@QEAA@PEAV_CancellationTokenState@12@@Z */
+DEFINE_THISCALL_WRAPPER(_StructuredTaskCollection_ctor, 8)
+_StructuredTaskCollection* __thiscall _StructuredTaskCollection_ctor(
+        _StructuredTaskCollection *this, /*_CancellationTokenState*/void *token)
+{
+    TRACE("(%p %p)\n", this, token);
+
+    if (token)
+        FIXME("_StructuredTaskCollection with cancellation token not implemented!\n");
+
+    memset(this, 0, sizeof(*this));
+    this->finished = FINISHED_INITIAL;
+    return this;
+}
+
+static void task_collection_schedule(_StructuredTaskCollection *this,
+        _UnrealizedChore *chore, /*location*/void *placement)
+{
+    Scheduler *scheduler;
+
+    task_collection_init(this);
+    scheduler = get_current_scheduler();
+
+    chore->task_collection = this;
+    this->count++;
+#if _MSVCR_VER > 100
+    if (placement) {
+        call_Scheduler_ScheduleTask_loc(scheduler, chore_wrapper_proc, chore, placement);
+        return;
+    }
+#endif
+    call_Scheduler_ScheduleTask(scheduler, chore_wrapper_proc, chore);
+}
+
+/* ?_Schedule@_StructuredTaskCollection@details@Concurrency@@QAEXPAV_UnrealizedChore@23@@Z */
+/* ?_Schedule@_StructuredTaskCollection@details@Concurrency@@QEAAXPEAV_UnrealizedChore@23@@Z */
+DEFINE_THISCALL_WRAPPER(_StructuredTaskCollection__Schedule, 8)
+void __thiscall _StructuredTaskCollection__Schedule(
+        _StructuredTaskCollection *this, _UnrealizedChore *chore)
+{
+    TRACE("(%p %p)\n", this, chore);
+    task_collection_schedule(this, chore, NULL);
+}
+
+#if _MSVCR_VER > 100
+/* ?_Schedule@_StructuredTaskCollection@details@Concurrency@@QAEXPAV_UnrealizedChore@23@PAVlocation@3@@Z */
+/* ?_Schedule@_StructuredTaskCollection@details@Concurrency@@QEAAXPEAV_UnrealizedChore@23@PEAVlocation@3@@Z */
+DEFINE_THISCALL_WRAPPER(_StructuredTaskCollection__Schedule_loc, 12)
+void __thiscall _StructuredTaskCollection__Schedule_loc(_StructuredTaskCollection *this,
+        _UnrealizedChore *chore, /*location*/void *placement)
+{
+    TRACE("(%p %p %p)\n", this, chore, placement);
+    task_collection_schedule(this, chore, placement);
+}
+#endif
+
+/* Workers run other pending tasks while they wait, scheduled chores are often
+ * still in the waiting worker's own queue. */
+static void task_collection_wait(_StructuredTaskCollection *this)
+{
+    ExternalContextBase *context = (ExternalContextBase*)get_current_context();
+    struct scheduler_worker *worker = NULL;
+    LONG finished;
+
+    if (context->context.vtable == &ExternalContextBase_vtable)
+        worker = context->worker;
+
+    while ((finished = this->finished) != this->count) {
+        if (worker && scheduler_worker_run_task(worker))
+            continue;
+
+        if (worker)
+            scheduler_pool_set_blocked(worker->pool, TRUE);
+        RtlWaitOnAddress((void*)&this->finished, &finished, sizeof(finished), NULL);
+        if (worker)
+            scheduler_pool_set_blocked(worker->pool, FALSE);
+    }
+}
+
+static void CALLBACK exception_ptr_rethrow_finally(BOOL normal, void *data)
+{
+    exception_ptr *ep = data;
+
+    TRACE("(%u %p)\n", normal, data);
+
+    __ExceptionPtrDestroy(ep);
+    operator_delete(ep);
+}
+
+/* ?_RunAndWait@_StructuredTaskCollection@details@Concurrency@@QAG?AW4_TaskCollectionStatus@23@PAV_UnrealizedChore@23@@Z */
+/* ?_RunAndWait@_StructuredTaskCollection@details@Concurrency@@QEAA?AW4_TaskCollectionStatus@23@PEAV_UnrealizedChore@23@@Z */
+_TaskCollectionStatus __stdcall _StructuredTaskCollection__RunAndWait(
+        _StructuredTaskCollection *this, _UnrealizedChore *chore)
+{
+    void *exception;
+    exception_ptr *ep;
+
+    TRACE("(%p %p)\n", this, chore);
+
+    task_collection_init(this);
+
+    if (chore) {
+        chore->task_collection = this;
+        execute_chore(chore, this);
+        chore->task_collection = NULL;
+    }
+
+    task_collection_wait(this);
+    this->count = 0;
+    this->finished = 0;
+
+    exception = this->exception;
+    this->exception = NULL;
+    if (!exception)
+        return TASK_COLLECTION_SUCCESS;
+
+    ep = (exception_ptr*)((ULONG_PTR)exception & ~STRUCTURED_TASK_COLLECTION_STATUS_MASK);
+    if (!ep)
+        return TASK_COLLECTION_CANCELLED;
+
+    __TRY
+    {
+        __ExceptionPtrRethrow(ep);
+    }
+    __FINALLY_CTX(exception_ptr_rethrow_finally, ep)
+    return TASK_COLLECTION_CANCELLED;
+}
+
+/* ?_Abort@_StructuredTaskCollection@details@Concurrency@@AAEXXZ */
+/* ?_Abort@_StructuredTaskCollection@details@Concurrency@@AEAAXXZ */
+DEFINE_THISCALL_WRAPPER(_StructuredTaskCollection__Abort, 4)
+void __thiscall _StructuredTaskCollection__Abort(_StructuredTaskCollection *this)
+{
+    void *exception;
+    exception_ptr *ep;
+
+    TRACE("(%p)\n", this);
+
+    if (this->finished == FINISHED_INITIAL)
+        return;
+
+    _StructuredTaskCollection__Cancel(this);
+    task_collection_wait(this);
+    this->count = 0;
+    this->finished = 0;
+
+    exception = this->exception;
+    this->exception = NULL;
+    ep = (exception_ptr*)((ULONG_PTR)exception & ~STRUCTURED_TASK_COLLECTION_STATUS_MASK);
+    if (ep) {
+        __ExceptionPtrDestroy(ep);
+        operator_delete(ep);
+    }
+}
+
+/* ??1_StructuredTaskCollection@details@Concurrency@@QAE@XZ */
+/* ??1_StructuredTaskCollection@details@Concurrency@@QEAA@XZ */
+DEFINE_THISCALL_WRAPPER(_StructuredTaskCollection_dtor, 4)
+void __thiscall _StructuredTaskCollection_dtor(_StructuredTaskCollection *this)
+{
+    TRACE("(%p)\n", this);
+
+    /* native throws missing_wait when the collection is destroyed with
+     * chores that were not waited for, they are canceled instead */
+    if (this->count)
+        WARN("destroying collection with pending chores\n");
+    _StructuredTaskCollection__Abort(this);
+}
+
 /* ?_Value@_SpinCount@details@Concurrency@@SAIXZ */
 unsigned int __cdecl SpinCount__Value(void)
 {
@@ -1700,13 +2493,7 @@ critical_section* __thiscall critical_section_ctor(critical_section *this)
 {
     TRACE("(%p)\n", this);
 
-    if(!keyed_event) {
-        HANDLE event;
-
-        NtCreateKeyedEvent(&event, GENERIC_READ|GENERIC_WRITE, NULL, 0);
-        if(InterlockedCompareExchangePointer(&keyed_event, event, NULL) != NULL)
-            NtClose(event);
-    }
+    create_keyed_event();
 
     this->unk_thread_id = 0;
     this->head = this->tail = NULL;
@@ -1130,13 +1130,6 @@ const char * __thiscall type_info_name_internal_method(type_info * _this, struct
 
 #endif /* _MSVCR_VER >= 80 */
 
-/* std::exception_ptr class helpers */
-typedef struct
-{
-    EXCEPTION_RECORD *rec;
-    int *ref; /* not binary compatible with native msvcr100 */
-} exception_ptr;
-
 #if _MSVCR_VER >= 100
 
 /*********************************************************************
@@ -1266,17 +1259,9 @@ static inline void call_copy_ctor( void *func, void *this, void *src, int has_vb
 }
 #endif
 
-/*********************************************************************
- * ?__ExceptionPtrCurrentException@@YAXPAX@Z
- * ?__ExceptionPtrCurrentException@@YAXPEAX@Z
- */
 #ifndef __x86_64__
-void __cdecl __ExceptionPtrCurrentException(exception_ptr *ep)
+void exception_ptr_from_record(exception_ptr *ep, EXCEPTION_RECORD *rec)
 {
-    EXCEPTION_RECORD *rec = msvcrt_get_thread_data()->exc_record;
-
-    TRACE("(%p)\n", ep);
-
     if (!rec)
     {
         ep->rec = NULL;
@@ -1317,12 +1302,8 @@ void __cdecl __ExceptionPtrCurrentException(exception_ptr *ep)
     return;
 }
 #else
-void __cdecl __ExceptionPtrCurrentException(exception_ptr *ep)
+void exception_ptr_from_record(exception_ptr *ep, EXCEPTION_RECORD *rec)
 {
-    EXCEPTION_RECORD *rec = msvcrt_get_thread_data()->exc_record;
-
-    TRACE("(%p)\n", ep);
-
     if (!rec)
     {
         ep->rec = NULL;
@@ -1365,6 +1346,16 @@ void __cdecl __ExceptionPtrCurrentException(exception_ptr *ep)
 }
 #endif
 
+/*********************************************************************
+ * ?__ExceptionPtrCurrentException@@YAXPAX@Z
+ * ?__ExceptionPtrCurrentException@@YAXPEAX@Z
+ */
+void __cdecl __ExceptionPtrCurrentException(exception_ptr *ep)
+{
+    TRACE("(%p)\n", ep);
+    exception_ptr_from_record(ep, msvcrt_get_thread_data()->exc_record);
+}
+
 #endif /* _MSVCR_VER >= 100 */
 
 #if _MSVCR_VER >= 110
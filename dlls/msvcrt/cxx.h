@@ -280,6 +280,18 @@ extern void *vtbl_wrapper_48;
 
 exception* __thiscall exception_ctor(exception*, const char**);
 
+/* std::exception_ptr class helpers */
+typedef struct
+{
+    EXCEPTION_RECORD *rec;
+    int *ref; /* not binary compatible with native msvcr100 */
+} exception_ptr;
+
+void __cdecl __ExceptionPtrCreate(exception_ptr*);
+void __cdecl __ExceptionPtrDestroy(exception_ptr*);
+void __cdecl __ExceptionPtrRethrow(const exception_ptr*);
+void exception_ptr_from_record(exception_ptr*, EXCEPTION_RECORD*) DECLSPEC_HIDDEN;
+
 extern const vtable_ptr type_info_vtable;
 
 #define CREATE_TYPE_INFO_VTABLE \
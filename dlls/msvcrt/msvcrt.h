@@ -315,6 +315,8 @@ struct fpnum {
 };
 struct fpnum fpnum_parse(wchar_t (*)(void*), void (*)(void*),
         void*, pthreadlocinfo, BOOL) DECLSPEC_HIDDEN;
+BOOL fpnum_parse_fast(const char*, const char**,
+        pthreadlocinfo, struct fpnum*) DECLSPEC_HIDDEN;
 int fpnum_double(struct fpnum*, double*) DECLSPEC_HIDDEN;
 /* Maybe one day we'll enable the invalid parameter handlers with the full set of information (msvcrXXd)
  *      #define MSVCRT_INVALID_PMT(x) MSVCRT_call_invalid_parameter_handler(x, __FUNCTION__, __FILE__, __LINE__, 0)
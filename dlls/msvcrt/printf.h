@@ -135,6 +135,250 @@ static inline int mbstowcs_len(wchar_t *wcstr, const char *mbstr,
     }
     return wlen;
 }
+
+static const ULONGLONG p10s64[] = { 1, 10, 100, 1000, 10000, 100000, 1000000,
+    10000000, 100000000, 1000000000, 10000000000, 100000000000, 1000000000000,
+    10000000000000, 100000000000000, 1000000000000000, 10000000000000000,
+    100000000000000000, 1000000000000000000, 10000000000000000000u };
+
+#define FP_FAST_MAX_DIGITS 19   /* rounded value needs to fit in ULONGLONG */
+#define FP_FAST_MAX_POW5 27     /* 5^27 < 2^63 */
+
+static const ULONGLONG p5s[] = { 1, 5, 25, 125, 625, 3125, 15625, 78125, 390625,
+    1953125, 9765625, 48828125, 244140625, 1220703125, 6103515625, 30517578125,
+    152587890625, 762939453125, 3814697265625, 19073486328125, 95367431640625,
+    476837158203125, 2384185791015625, 11920928955078125, 59604644775390625,
+    298023223876953125, 1490116119384765625, 7450580596923828125 };
+
+/* Computes q = floor(m * 2^e / 10^s) and compares the remainder with half
+ * of the last digit. Returns FALSE if q can't be computed exactly. */
+static inline BOOL fp_fast_div_pow10(ULONGLONG m, int e, int s, ULONGLONG *q, int *cmp)
+{
+    ULONGLONG hi, lo, p5, r, d;
+    int sh;
+
+    if(s > FP_FAST_MAX_POW5 || -s > FP_FAST_MAX_POW5)
+        return FALSE;
+    p5 = p5s[s < 0 ? -s : s];
+
+    if(s <= 0) {
+        /* m * 2^e * 10^-s = m * 5^-s * 2^(e-s) */
+        mul_64x64(m, p5, &hi, &lo);
+        sh = e - s;
+
+        if(sh >= 0) {
+            if(hi || sh >= 64 || (sh && lo >> (64 - sh)))
+                return FALSE;
+            *q = lo << sh;
+            *cmp = -1;
+            return TRUE;
+        }
+
+        sh = -sh;
+        if(sh >= 128)
+            return FALSE;
+        if(sh < 64) {
+            if(hi >> sh)
+                return FALSE;
+            *q = (lo >> sh) | (sh ? hi << (64 - sh) : 0);
+            r = lo & (((ULONGLONG)1 << sh) - 1);
+            if(!sh) *cmp = -1;
+            else if(!(r >> (sh - 1) & 1)) *cmp = -1;
+            else *cmp = (r & (((ULONGLONG)1 << (sh - 1)) - 1)) ? 1 : 0;
+        } else {
+            *q = hi >> (sh - 64);
+            sh -= 64;
+            if(sh) {
+                r = hi & (((ULONGLONG)1 << sh) - 1);
+                if(!(r >> (sh - 1) & 1)) *cmp = -1;
+                else *cmp = (r & (((ULONGLONG)1 << (sh - 1)) - 1)) || lo ? 1 : 0;
+            } else {
+                if(!(lo >> 63)) *cmp = -1;
+                else *cmp = (lo & ~((ULONGLONG)1 << 63)) ? 1 : 0;
+            }
+        }
+        return TRUE;
+    }
+
+    /* m * 2^e / 10^s = m * 2^(e-s) / 5^s */
+    sh = e - s;
+    if(sh >= 0) {
+        if(sh >= 64 || m >> (64 - sh))
+            return FALSE;
+        m <<= sh;
+        d = p5;
+    } else {
+        if(-sh >= 64 || p5 > ~(ULONGLONG)0 >> -sh)
+            return FALSE;
+        d = p5 << -sh;
+    }
+    *q = m / d;
+    r = m % d;
+    if(r < d - r) *cmp = -1;
+    else *cmp = r == d - r ? 0 : 1;
+    return TRUE;
+}
+
+/* 10^(28*i) for i in -13..12, truncated to 128 bits: (hi * 2^64 + lo) * 2^e2 */
+static const struct {
+    ULONGLONG hi, lo;
+    int e2;
+} p10s128[] = {
+    { 0xe1afa13afbd14d6d, 0x82189c09a3a1ec21, -1337 }, /* 1e-364 */
+    { 0xe3e27a444d8d98b7, 0xfd1b1b2308169b25, -1244 }, /* 1e-336 */
+    { 0xe61acf033d1a45df, 0x6fb92487298e33bd, -1151 }, /* 1e-308 */
+    { 0xe858ad248f5c22c9, 0xd1b3400f8f9cff68, -1058 }, /* 1e-280 */
+    { 0xea9c227723ee8bcb, 0x465e15a979c1cadc, -965 }, /* 1e-252 */
+    { 0xece53cec4a314ebd, 0xa4f8bf5635246428, -872 }, /* 1e-224 */
+    { 0xef340a98172aace4, 0x86fb897116c87c34, -779 }, /* 1e-196 */
+    { 0xf18899b1bc3f8ca1, 0xdc44e6c3cb279ac1, -686 }, /* 1e-168 */
+    { 0xf3e2f893dec3f126, 0x5a89dba3c3efccfa, -593 }, /* 1e-140 */
+    { 0xf64335bcf065d37d, 0x4d4617b5ff4a16d5, -500 }, /* 1e-112 */
+    { 0xf8a95fcf88747d94, 0x75a44c6397ce912a, -407 }, /* 1e-84 */
+    { 0xfb158592be068d2e, 0xeed6e2f0f0d56712, -314 }, /* 1e-56 */
+    { 0xfd87b5f28300ca0d, 0x8bca9d6e188853fc, -221 }, /* 1e-28 */
+    { 0x8000000000000000, 0x0000000000000000, -127 }, /* 1e0 */
+    { 0x813f3978f8940984, 0x4000000000000000, -34 }, /* 1e28 */
+    { 0x82818f1281ed449f, 0xbff8f10e7a8921a4, 59 }, /* 1e56 */
+    { 0x83c7088e1aab65db, 0x792667c6da79e0fa, 152 }, /* 1e84 */
+    { 0x850fadc09923329e, 0x03e2cf6bc604ddb0, 245 }, /* 1e112 */
+    { 0x865b86925b9bc5c2, 0x0b8a2392ba45a9b2, 338 }, /* 1e140 */
+    { 0x87aa9aff79042286, 0x90fb44d2f05d0842, 431 }, /* 1e168 */
+    { 0x88fcf317f22241e2, 0x441fece3bdf81f03, 524 }, /* 1e196 */
+    { 0x8a5296ffe33cc92f, 0x82bd6b70d99aaa6f, 617 }, /* 1e224 */
+    { 0x8bab8eefb6409c1a, 0x1ad089b6c2f7548e, 710 }, /* 1e252 */
+    { 0x8d07e33455637eb2, 0xdb0b487b6423e1e8, 803 }, /* 1e280 */
+    { 0x8e679c2f5e44ff8f, 0x570f09eaa7ea7648, 896 }, /* 1e308 */
+    { 0x8fcac257558ee4e6, 0x213a4f0aa5e8a7b1, 989 }, /* 1e336 */
+};
+
+static inline ULONGLONG get_bits192(const ULONGLONG *x, int pos)
+{
+    int w = pos / 64, b = pos % 64;
+    ULONGLONG ret;
+
+    if(w >= 3) return 0;
+    ret = x[w] >> b;
+    if(b && w < 2) ret |= x[w + 1] << (64 - b);
+    return ret;
+}
+
+/* Computes q = floor(m * 2^e / 10^s) using 128-bit approximation of 10^-s.
+ * The approximation is lower than the exact value by less than 2^-125 of it.
+ * Returns FALSE if the remainder is too close to 0 or half of the last digit
+ * to compare it reliably. */
+static inline BOOL fp_approx_div_pow10(ULONGLONG m, int e, int s, ULONGLONG *q, int *cmp)
+{
+    ULONGLONG h, l, p5, x[3], y[3], frac;
+    int i, k = -s, r, sh;
+
+    i = (k >= 0 ? k / 28 : -((-k + 27) / 28)) + 13;
+    if(i < 0 || i >= ARRAY_SIZE(p10s128))
+        return FALSE;
+    r = k - (i - 13) * 28;
+    p5 = p5s[r];
+
+    /* 10^k = 10^(28*i) * 5^r * 2^r, keep top 128 bits */
+    mul_64x64(p10s128[i].lo, p5, &h, &x[0]);
+    mul_64x64(p10s128[i].hi, p5, &x[2], &l);
+    x[1] = l + h;
+    if(x[1] < l) x[2]++;
+    sh = p10s128[i].e2 + r;
+    if(x[2]) {
+        i = clz64(x[2]);
+        x[0] = get_bits192(x, 64 - i);
+        x[1] = get_bits192(x, 128 - i);
+        sh += 64 - i;
+    }
+
+    /* y = m * 10^k * 2^-sh */
+    mul_64x64(m, x[0], &h, &y[0]);
+    mul_64x64(m, x[1], &y[2], &l);
+    y[1] = l + h;
+    if(y[1] < l) y[2]++;
+    sh = -(e + sh);
+
+    if(sh < 64 || sh > 191)
+        return FALSE;
+    if(sh < 128 && get_bits192(y, sh + 64))
+        return FALSE;
+    *q = get_bits192(y, sh);
+    frac = get_bits192(y, sh - 64);
+
+    /* the error is smaller than 4 in frac units */
+    if(frac >= ~(ULONGLONG)0 - 16)
+        return FALSE;
+    if(frac >= ((ULONGLONG)1 << 63) - 16 && frac <= ((ULONGLONG)1 << 63))
+        return FALSE;
+    *cmp = frac > ((ULONGLONG)1 << 63) ? 1 : -1;
+    return TRUE;
+}
+
+/* Stores v rounded to the last printed digit in b, so formatting code
+ * can skip the exact big number conversion. v needs to be positive and
+ * finite. Rounding is computed on the exact value, the result is the same
+ * as when rounding the exact decimal expansion of v. */
+static inline BOOL bnum_from_double_rounded(struct bnum *b, int *e10, double v,
+        int format, int prec, BOOL standard_rounding)
+{
+    ULONGLONG bits = *(ULONGLONG*)&v, m, q;
+    int e, s, n, k, i, cmp;
+
+    e = (bits >> (MANT_BITS - 1)) & ((1 << EXP_BITS) - 1);
+    m = bits & (((ULONGLONG)1 << (MANT_BITS - 1)) - 1);
+    if(e) {
+        m |= (ULONGLONG)1 << (MANT_BITS - 1);
+        e -= (1 << (EXP_BITS - 1)) - 1 + MANT_BITS - 1;
+    } else {
+        e = 2 - (1 << (EXP_BITS - 1)) - (MANT_BITS - 1);
+    }
+
+    if(format == 'f' || format == 'F') {
+        s = -prec;
+        if(!fp_fast_div_pow10(m, e, s, &q, &cmp) && !fp_approx_div_pow10(m, e, s, &q, &cmp))
+            return FALSE;
+    } else {
+        n = prec;
+        if(!n || format == 'e' || format == 'E') n++;
+        if(n > FP_FAST_MAX_DIGITS)
+            return FALSE;
+
+        /* find the exponent, so q has exactly n digits,
+         * start with floor(log10(2^x)) where 2^x <= v < 2^(x+1) */
+        k = e + 63 - clz64(m);
+        k = k >= 0 ? k * 78913 >> 18 : -((-k * 78913 + (1 << 18) - 1) >> 18);
+        for(i = 0; ; i++) {
+            s = k + 1 - n;
+            if(i == 3)
+                return FALSE;
+            if(!fp_fast_div_pow10(m, e, s, &q, &cmp) && !fp_approx_div_pow10(m, e, s, &q, &cmp))
+                return FALSE;
+            if(q < p10s64[n - 1]) k--;
+            else if(q >= p10s64[n]) k++;
+            else break;
+        }
+    }
+
+    if(cmp > 0 || (!cmp && (!standard_rounding || (q & 1))))
+        q++;
+    /* value rounded to 0 or overflow */
+    if(!q)
+        return FALSE;
+
+    b->b = 0;
+    b->size = BNUM_PREC64;
+    for(i = 0; q; i++) {
+        b->data[i] = q % LIMB_MAX;
+        q /= LIMB_MAX;
+    }
+    b->e = i;
+
+    /* align the number to limb boundary */
+    k = ((s % LIMB_DIGITS) + LIMB_DIGITS) % LIMB_DIGITS;
+    if(k) bnum_mult(b, p10s[k]);
+    *e10 = s - k + LIMB_DIGITS * (b->e - 2);
+    return TRUE;
+}
 #endif
 
 static inline int FUNC_NAME(pf_output_wstr)(FUNC_NAME(puts_clbk) pf_puts, void *puts_ctx,
@@ -603,8 +847,10 @@ static inline int FUNC_NAME(pf_output_fp)(FUNC_NAME(puts_clbk) pf_puts, void *pu
     if(flags->Precision == -1)
         flags->Precision = 6;
 
-    v = frexp(v, &e2);
-    if(v) {
+    if(v && bnum_from_double_rounded(b, &e10, v, flags->Format,
+                flags->Precision, standard_rounding)) {
+        /* b already contains the rounded value */
+    } else if((v = frexp(v, &e2))) {
         m = (ULONGLONG)1 << (MANT_BITS - 1);
         m |= (*(ULONGLONG*)&v & (((ULONGLONG)1 << (MANT_BITS - 1)) - 1));
         b->b = 0;
@@ -399,6 +399,9 @@ _FUNCTION_ {
                     int negative = 0;
                     struct fpnum fp;
                     double cur;
+#if defined(STRING) && !defined(STRING_LEN) && !defined(WIDE_SCANF)
+                    const char *end;
+#endif
 
                     /* skip initial whitespace */
                     while ((nch!=_EOF_) && _ISSPACE_(nch))
@@ -413,6 +416,15 @@ _FUNCTION_ {
                     if(ctx.length > length-consumed+1) ctx.length = length-consumed+1;
 #endif
 
+#if defined(STRING) && !defined(STRING_LEN) && !defined(WIDE_SCANF)
+                    /* nch was read from file[-1], parse the string in place */
+                    if (width < 0 && fpnum_parse_fast(file - 1, &end, locinfo, &fp)) {
+                        ctx.read = end - (file - 1);
+                        ctx.cur = *end;
+                        ctx.file = end + 1;
+                    }
+                    else
+#endif
                     fp = fpnum_parse(_STRTOD_NAME_(strtod_scanf_get),
                             _STRTOD_NAME_(strtod_scanf_unget), &ctx, locinfo, FALSE);
                     fpnum_double(&fp, &cur);
@@ -1086,6 +1086,67 @@ static void test__get_output_format(void)
     ok(ret == _TWO_DIGIT_EXPONENT, "got %d\n", ret);
 }
 
+static void test_sprintf_fp(void)
+{
+    static const struct {
+        const char *format;
+        double value;
+        const char *out;
+    } tests[] = {
+        { "%.0f", 0.5, "1" },
+        { "%.0f", 2.5, "3" },
+        { "%.2f", 0.125, "0.13" },
+        { "%.2f", 0.375, "0.38" },
+        { "%.2f", 1.005, "1.00" },
+        { "%f", 9.9999996, "10.000000" },
+        { "%e", 1e-300, "1.000000e-300" },
+        { "%e", 1e300, "1.000000e+300" },
+        { "%.16e", 1.7976931348623157e308, "1.7976931348623157e+308" },
+        { "%.3e", 4.9406564584124654e-324, "4.941e-324" },
+        { "%.10e", 2.2250738585072014e-308, "2.2250738585e-308" },
+        { "%.17g", 0.1, "0.10000000000000001" },
+        { "%.17g", 1e15, "1000000000000000" },
+        { "%g", 123456789.0, "1.23457e+008" },
+        { "%g", 999999.5, "1e+006" },
+        { "%g", 1e-5, "1e-005" },
+    };
+    static const struct {
+        const char *format;
+        double value;
+    } perf[] = {
+        { "%f", 3.14159265358979 },
+        { "%.2f", 1234.5678 },
+        { "%e", 6.02214076e23 },
+        { "%e", 1.602176634e-300 },
+        { "%g", 0.000123456 },
+        { "%.17g", 2.718281828459045 },
+        { "%.30e", 6.02214076e23 },
+        { "%.40f", 0.1 },
+    };
+    char buf[256];
+    DWORD start;
+    int i, j, r;
+
+    for (i = 0; i < ARRAY_SIZE(tests); i++)
+    {
+        r = p_sprintf(buf, tests[i].format, tests[i].value);
+        ok(r == strlen(tests[i].out), "%d) r = %d\n", i, r);
+        ok(!strcmp(buf, tests[i].out), "%d) buf = %s, expected %s\n",
+                i, buf, tests[i].out);
+    }
+
+    if (!winetest_interactive)
+        return;
+
+    for (i = 0; i < ARRAY_SIZE(perf); i++)
+    {
+        start = GetTickCount();
+        for (j = 0; j < 100000; j++)
+            p_sprintf(buf, perf[i].format, perf[i].value * (1 + j * 1e-9));
+        trace("%s: 100000 calls in %u ms\n", perf[i].format, GetTickCount() - start);
+    }
+}
+
 START_TEST(printf)
 {
     init();
@@ -1103,4 +1164,5 @@ START_TEST(printf)
     test_vsnwprintf_s();
     test_vsprintf_p();
     test__get_output_format();
+    test_sprintf_fp();
 }
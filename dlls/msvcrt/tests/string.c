@@ -1980,6 +1980,13 @@ static void test__strtod(void)
         { ".00", 3, 0 },
         { "-0.", 3, 0 },
         { "0e13", 4, 0 },
+        { "9007199254740993", 16, 9007199254740992.0 },
+        { "9007199254740995", 16, 9007199254740996.0 },
+        { "1e23", 4, 1e23 },
+        { "8.98846567431158e307", 20, 8.98846567431158e307 },
+        { "123456789012345678901e-2", 24, 1234567890123456789.01 },
+        { "1e+", 1, 1 },
+        { "1.5d-", 3, 1.5 },
     };
     const char overflow[] = "1d9999999999999999999";
 
@@ -4477,6 +4484,66 @@ static void test_wcsncpy(void)
             wine_dbgstr_wn(dst, ARRAY_SIZE(dst)));
 }
 
+static void test_strtod_round_trip(void)
+{
+    int count = winetest_interactive ? 200000 : 5000;
+    char *buf, *p, *end;
+    DWORD start, time;
+    double d, *vals, *res;
+    int i, n, bad, bad_end;
+
+    buf = malloc(count * 26 + 1);
+    vals = malloc(count * sizeof(*vals));
+    res = malloc(count * sizeof(*res));
+
+    /* comma separated values, both short and round-trip representations */
+    srand(0);
+    for (i = 0, p = buf; i < count; i++)
+    {
+        d = (rand() - RAND_MAX / 2) * pow(10, rand() % 40 - 20) / (rand() + 1);
+        p += sprintf(p, i % 2 ? "%.17g," : "%g,", d);
+        vals[i] = d;
+    }
+
+    /* only record the results in the loops, they are checked afterwards so
+     * that interactive runs time the parsing alone */
+    bad_end = -1;
+    start = GetTickCount();
+    for (i = 0, p = buf; i < count; i++)
+    {
+        res[i] = strtod(p, &end);
+        if (*end != ',' && bad_end == -1) bad_end = i;
+        p = end + 1;
+    }
+    time = GetTickCount() - start;
+    ok(bad_end == -1, "%d) unexpected end\n", bad_end);
+    for (i = 1, bad = 0; i < count; i += 2)
+        if (res[i] != vals[i]) bad++;
+    ok(!bad, "%d values didn't round-trip\n", bad);
+    if (winetest_interactive)
+        trace("strtod: %d values (%d bytes) in %u ms\n", count, (int)(p - buf), time);
+
+    bad_end = -1;
+    start = GetTickCount();
+    for (i = 0, p = buf; i < count; i++)
+    {
+        n = 0;
+        if (sscanf(p, "%lf,%n", &res[i], &n) != 1 && bad_end == -1) bad_end = i;
+        p += n;
+    }
+    time = GetTickCount() - start;
+    ok(bad_end == -1, "%d) sscanf failed\n", bad_end);
+    for (i = 1, bad = 0; i < count; i += 2)
+        if (res[i] != vals[i]) bad++;
+    ok(!bad, "%d values didn't round-trip\n", bad);
+    if (winetest_interactive)
+        trace("sscanf: %d values in %u ms\n", count, time);
+
+    free(buf);
+    free(vals);
+    free(res);
+}
+
 START_TEST(string)
 {
     char mem[100];
@@ -4591,6 +4658,7 @@ START_TEST(string)
     test_strnlen();
     test__strtoi64();
     test__strtod();
+    test_strtod_round_trip();
     test_mbstowcs();
     test__wcstombs_s_l();
     test_gcvt();
@@ -0,0 +1,688 @@
+/*
+ * Event tracing providers and local trace sessions
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include <stdarg.h>
+
+#include "ntstatus.h"
+#define WIN32_NO_STATUS
+#include "ntdll_misc.h"
+#include "wmistr.h"
+#include "evntrace.h"
+#include "evntprov.h"
+#include "wine/etw.h"
+#include "wine/list.h"
+#include "wine/debug.h"
+
+WINE_DEFAULT_DEBUG_CHANNEL(etw);
+
+/* Sessions only exist in the current process. Events are recorded in a set
+ * of buffers, one per processor, in a section; a thread always uses the same
+ * buffer, and space in a buffer is reserved with interlocked operations.
+ * Full buffers are appended to the log file. */
+
+#define MAX_SESSIONS      16
+#define MAX_ENABLED_GUIDS 64
+#define DEFAULT_BUFFER_KB 64
+
+struct etw_buffer
+{
+    LONG volatile offset;   /* offset of the next record; above the buffer size once the buffer is full */
+    LONG volatile filled;   /* size of the records completely written */
+    LONG volatile writers;  /* number of threads currently writing to the buffer */
+    LONG reserved;
+};
+
+struct etw_enabled_guid
+{
+    GUID      guid;
+    UCHAR     level;
+    ULONGLONG match_any;
+    ULONGLONG match_all;
+};
+
+struct etw_session
+{
+    BOOL                    used;
+    LONG volatile           stopped;
+    WCHAR                  *name;
+    ULONG                   log_file_mode;
+    HANDLE                  file;
+    LARGE_INTEGER           file_pos;
+    char                   *buffers;
+    SIZE_T                  buffers_size;   /* size of the mapping, which is kept when the session stops */
+    ULONG                   buffer_size;
+    ULONG                   buffer_count;
+    ULONG                   buffers_written;
+    LONG                    events_lost;
+    RTL_CRITICAL_SECTION    cs;             /* protects the file */
+    struct etw_enabled_guid guids[MAX_ENABLED_GUIDS];
+    ULONG                   guid_count;
+};
+
+struct etw_provider
+{
+    BOOL volatile           enabled;        /* checked first, so that disabled events are cheap */
+    LONG volatile           writers;        /* number of threads currently writing an event */
+    UCHAR                   level;
+    ULONGLONG               match_any;
+    ULONGLONG               match_all;
+    struct etw_session     *session;
+    struct list             entry;
+    GUID                    guid;
+    PENABLECALLBACK         callback;
+    void                   *context;
+};
+
+/* session slots are never freed, writers may still access a stopped session */
+static struct etw_session sessions[MAX_SESSIONS];
+static struct list providers = LIST_INIT( providers );
+/* unregistered providers are kept for later registrations instead of being freed,
+ * other threads may still be checking whether they are enabled */
+static struct list free_providers = LIST_INIT( free_providers );
+
+static RTL_CRITICAL_SECTION etw_section;
+static RTL_CRITICAL_SECTION_DEBUG etw_section_debug =
+{
+    0, 0, &etw_section,
+    { &etw_section_debug.ProcessLocksList, &etw_section_debug.ProcessLocksList },
+      0, 0, { (DWORD_PTR)(__FILE__ ": etw_section") }
+};
+static RTL_CRITICAL_SECTION etw_section = { &etw_section_debug, -1, 0, 0, 0, 0 };
+
+static inline struct etw_provider *get_provider( REGHANDLE handle )
+{
+    return (struct etw_provider *)(ULONG_PTR)handle;
+}
+
+static inline struct etw_buffer *get_buffer( struct etw_session *session, ULONG index )
+{
+    return (struct etw_buffer *)(session->buffers + index * session->buffer_size);
+}
+
+static struct etw_session *get_session( TRACEHANDLE handle, const WCHAR *name )
+{
+    unsigned int i;
+
+    if (handle && handle <= MAX_SESSIONS)
+        return sessions[handle - 1].used ? &sessions[handle - 1] : NULL;
+    if (!name) return NULL;
+    for (i = 0; i < MAX_SESSIONS; i++)
+        if (sessions[i].used && !wcsicmp( sessions[i].name, name )) return &sessions[i];
+    return NULL;
+}
+
+static inline BOOL is_event_enabled( const struct etw_provider *provider, UCHAR level, ULONGLONG keyword )
+{
+    if (level && provider->level && level > provider->level) return FALSE;
+    if (!keyword || !provider->match_any) return TRUE;
+    return (keyword & provider->match_any) && (keyword & provider->match_all) == provider->match_all;
+}
+
+/* append a buffer to the log file and make it available again; session->cs must be held */
+static void flush_buffer( struct etw_session *session, ULONG index )
+{
+    struct etw_buffer *buffer = get_buffer( session, index );
+    struct wine_etw_buffer_header header;
+    IO_STATUS_BLOCK io;
+
+    /* make further reservations fail, and wait for the ones in progress */
+    InterlockedExchange( &buffer->offset, session->buffer_size );
+    while (buffer->writers) NtYieldExecution();
+
+    if (buffer->filled && session->file)
+    {
+        header.size        = buffer->filled;
+        header.index       = index;
+        header.sequence    = session->buffers_written++;
+        header.events_lost = session->events_lost;
+        NtWriteFile( session->file, 0, NULL, NULL, &io, &header, sizeof(header), &session->file_pos, NULL );
+        session->file_pos.QuadPart += sizeof(header);
+        NtWriteFile( session->file, 0, NULL, NULL, &io, buffer + 1, buffer->filled, &session->file_pos, NULL );
+        session->file_pos.QuadPart += buffer->filled;
+    }
+    buffer->filled = 0;
+    InterlockedExchange( &buffer->offset, sizeof(*buffer) );
+}
+
+static void flush_session( struct etw_session *session )
+{
+    ULONG i;
+
+    RtlEnterCriticalSection( &session->cs );
+    for (i = 0; i < session->buffer_count; i++) flush_buffer( session, i );
+    RtlLeaveCriticalSection( &session->cs );
+}
+
+/* write out the last events and close the log file; writers may still be flushing a full buffer */
+static void stop_session( struct etw_session *session )
+{
+    ULONG i;
+
+    RtlEnterCriticalSection( &session->cs );
+    session->stopped = TRUE;
+    for (i = 0; i < session->buffer_count; i++) flush_buffer( session, i );
+    if (session->file) NtClose( session->file );
+    session->file = 0;
+    RtlLeaveCriticalSection( &session->cs );
+}
+
+/* record an event in the buffer of the current thread */
+static void write_session_event( struct etw_session *session, const struct etw_provider *provider, USHORT flags,
+                                 const EVENT_DESCRIPTOR *descriptor, const GUID *activity, const GUID *related,
+                                 ULONG count, const EVENT_DATA_DESCRIPTOR *data )
+{
+    struct wine_etw_event_record *record;
+    struct etw_buffer *buffer;
+    ULONG i, index, data_size = 0, size;
+    ULONG *sizes;
+    LONG offset;
+    char *ptr;
+
+    for (i = 0; i < count; i++) data_size += data[i].Size;
+    size = (sizeof(*record) + count * sizeof(ULONG) + data_size + 7) & ~7;
+    if (size > session->buffer_size - sizeof(*buffer))
+    {
+        InterlockedIncrement( &session->events_lost );
+        return;
+    }
+    index = (HandleToULong( NtCurrentTeb()->ClientId.UniqueThread ) >> 2) % session->buffer_count;
+    buffer = get_buffer( session, index );
+
+    for (;;)
+    {
+        InterlockedIncrement( &buffer->writers );
+        if (session->stopped)
+        {
+            InterlockedDecrement( &buffer->writers );
+            return;
+        }
+        offset = InterlockedExchangeAdd( &buffer->offset, size );
+        if (offset + size <= session->buffer_size) break;
+        InterlockedDecrement( &buffer->writers );
+
+        /* the buffer is full; the first thread getting here writes it out, unless
+         * the session has been stopped meanwhile */
+        RtlEnterCriticalSection( &session->cs );
+        if (!session->stopped && buffer->offset + size > session->buffer_size) flush_buffer( session, index );
+        RtlLeaveCriticalSection( &session->cs );
+    }
+
+    record = (struct wine_etw_event_record *)((char *)buffer + offset);
+    record->size       = size;
+    record->flags      = flags;
+    record->data_count = count;
+    record->pid        = HandleToULong( NtCurrentTeb()->ClientId.UniqueProcess );
+    record->tid        = HandleToULong( NtCurrentTeb()->ClientId.UniqueThread );
+    NtQueryPerformanceCounter( &record->timestamp, NULL );
+    record->provider   = provider->guid;
+    record->descriptor = *descriptor;
+    if (activity) record->activity = *activity;
+    else memset( &record->activity, 0, sizeof(record->activity) );
+    if (related) record->related_activity = *related;
+    else memset( &record->related_activity, 0, sizeof(record->related_activity) );
+    record->data_size  = data_size;
+    record->reserved   = 0;
+
+    sizes = (ULONG *)(record + 1);
+    ptr = (char *)(sizes + count);
+    for (i = 0; i < count; i++)
+    {
+        sizes[i] = data[i].Size;
+        memcpy( ptr, (const void *)(ULONG_PTR)data[i].Ptr, data[i].Size );
+        ptr += data[i].Size;
+    }
+
+    InterlockedExchangeAdd( &buffer->filled, size );
+    InterlockedDecrement( &buffer->writers );
+}
+
+static void write_event( struct etw_provider *provider, USHORT flags, const EVENT_DESCRIPTOR *descriptor,
+                         const GUID *activity, const GUID *related, ULONG count,
+                         const EVENT_DATA_DESCRIPTOR *data )
+{
+    struct etw_session *session;
+
+    /* keep EtwEventUnregister from reusing the provider until the event is written */
+    InterlockedIncrement( &provider->writers );
+    if (provider->enabled && (session = provider->session))
+        write_session_event( session, provider, flags, descriptor, activity, related, count, data );
+    InterlockedDecrement( &provider->writers );
+}
+
+/* enable or disable a provider for a session, and notify it; etw_section must be held */
+static void enable_provider( struct etw_provider *provider, struct etw_session *session, ULONG control,
+                             UCHAR level, ULONGLONG match_any, ULONGLONG match_all )
+{
+    switch (control)
+    {
+    case EVENT_CONTROL_CODE_ENABLE_PROVIDER:
+        provider->level     = level;
+        provider->match_any = match_any;
+        provider->match_all = match_all;
+        provider->session   = session;
+        provider->enabled = TRUE;
+        break;
+    case EVENT_CONTROL_CODE_DISABLE_PROVIDER:
+        if (provider->session != session) return;
+        provider->enabled = FALSE;
+        break;
+    }
+    if (provider->callback)
+        provider->callback( &provider->guid, control, level, match_any, match_all, NULL, provider->context );
+}
+
+/******************************************************************************
+ *                  EtwEventRegister (NTDLL.@)
+ */
+ULONG WINAPI EtwEventRegister( LPCGUID guid, PENABLECALLBACK callback, PVOID context,
+                               PREGHANDLE handle )
+{
+    struct etw_provider *provider;
+    unsigned int i, j;
+
+    TRACE( "(%s, %p, %p, %p)\n", debugstr_guid(guid), callback, context, handle );
+
+    if (!guid || !handle) return ERROR_INVALID_PARAMETER;
+
+    RtlEnterCriticalSection( &etw_section );
+    if (!list_empty( &free_providers ))
+    {
+        /* writers still holding an old handle may update the writer count at any
+         * time, so it is left alone; the provider is already disabled */
+        provider = LIST_ENTRY( list_head( &free_providers ), struct etw_provider, entry );
+        list_remove( &provider->entry );
+        provider->level     = 0;
+        provider->match_any = 0;
+        provider->match_all = 0;
+        provider->session   = NULL;
+    }
+    else if (!(provider = RtlAllocateHeap( GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(*provider) )))
+    {
+        RtlLeaveCriticalSection( &etw_section );
+        return ERROR_NOT_ENOUGH_MEMORY;
+    }
+    provider->guid     = *guid;
+    provider->callback = callback;
+    provider->context  = context;
+    *handle = (ULONG_PTR)provider;
+
+    list_add_tail( &providers, &provider->entry );
+    for (i = 0; i < MAX_SESSIONS; i++)
+    {
+        if (!sessions[i].used || sessions[i].stopped) continue;
+        for (j = 0; j < sessions[i].guid_count; j++)
+        {
+            struct etw_enabled_guid *enabled = &sessions[i].guids[j];
+
+            if (!IsEqualGUID( &enabled->guid, guid )) continue;
+            enable_provider( provider, &sessions[i], EVENT_CONTROL_CODE_ENABLE_PROVIDER,
+                             enabled->level, enabled->match_any, enabled->match_all );
+            break;
+        }
+    }
+    RtlLeaveCriticalSection( &etw_section );
+    return ERROR_SUCCESS;
+}
+
+/******************************************************************************
+ *                  EtwEventUnregister (NTDLL.@)
+ */
+ULONG WINAPI EtwEventUnregister( REGHANDLE handle )
+{
+    struct etw_provider *provider = get_provider( handle );
+
+    TRACE( "(%s)\n", wine_dbgstr_longlong(handle) );
+
+    if (!provider) return ERROR_INVALID_HANDLE;
+
+    RtlEnterCriticalSection( &etw_section );
+    list_remove( &provider->entry );
+    provider->enabled = FALSE;
+    RtlLeaveCriticalSection( &etw_section );
+
+    /* wait for the events still being written before the provider can be reused */
+    MemoryBarrier();
+    while (provider->writers) NtYieldExecution();
+
+    RtlEnterCriticalSection( &etw_section );
+    list_add_tail( &free_providers, &provider->entry );
+    RtlLeaveCriticalSection( &etw_section );
+    return ERROR_SUCCESS;
+}
+
+/******************************************************************************
+ *                  EtwEventEnabled (NTDLL.@)
+ */
+BOOLEAN WINAPI EtwEventEnabled( REGHANDLE handle, const EVENT_DESCRIPTOR *descriptor )
+{
+    struct etw_provider *provider = get_provider( handle );
+
+    if (!provider || !provider->enabled) return FALSE;
+    return is_event_enabled( provider, descriptor->Level, descriptor->Keyword );
+}
+
+/******************************************************************************
+ *                  EtwEventProviderEnabled (NTDLL.@)
+ */
+BOOLEAN WINAPI EtwEventProviderEnabled( REGHANDLE handle, UCHAR level, ULONGLONG keyword )
+{
+    struct etw_provider *provider = get_provider( handle );
+
+    if (!provider || !provider->enabled) return FALSE;
+    return is_event_enabled( provider, level, keyword );
+}
+
+/******************************************************************************
+ *                  EtwEventWriteTransfer   (NTDLL.@)
+ */
+ULONG WINAPI EtwEventWriteTransfer( REGHANDLE handle, PCEVENT_DESCRIPTOR descriptor, LPCGUID activity,
+                                    LPCGUID related, ULONG count, PEVENT_DATA_DESCRIPTOR data )
+{
+    struct etw_provider *provider = get_provider( handle );
+
+    if (!provider) return ERROR_INVALID_HANDLE;
+    /* this is all the work done when no session records the provider */
+    if (!provider->enabled) return ERROR_SUCCESS;
+
+    if (!descriptor || (count && !data)) return ERROR_INVALID_PARAMETER;
+    if (!is_event_enabled( provider, descriptor->Level, descriptor->Keyword )) return ERROR_SUCCESS;
+    write_event( provider, (activity || related) ? WINE_ETW_EVENT_ACTIVITY : 0,
+                 descriptor, activity, related, count, data );
+    return ERROR_SUCCESS;
+}
+
+/******************************************************************************
+ *                  EtwEventWrite (NTDLL.@)
+ */
+ULONG WINAPI EtwEventWrite( REGHANDLE handle, const EVENT_DESCRIPTOR *descriptor, ULONG count,
+                            EVENT_DATA_DESCRIPTOR *data )
+{
+    return EtwEventWriteTransfer( handle, descriptor, NULL, NULL, count, data );
+}
+
+/******************************************************************************
+ *                  EtwEventWriteString   (NTDLL.@)
+ */
+ULONG WINAPI EtwEventWriteString( REGHANDLE handle, UCHAR level, ULONGLONG keyword, PCWSTR string )
+{
+    struct etw_provider *provider = get_provider( handle );
+    EVENT_DESCRIPTOR descriptor;
+    EVENT_DATA_DESCRIPTOR data;
+
+    if (!provider) return ERROR_INVALID_HANDLE;
+    if (!string) return ERROR_INVALID_PARAMETER;
+    if (!provider->enabled || !is_event_enabled( provider, level, keyword )) return ERROR_SUCCESS;
+
+    memset( &descriptor, 0, sizeof(descriptor) );
+    descriptor.Level   = level;
+    descriptor.Keyword = keyword;
+    data.Ptr      = (ULONG_PTR)string;
+    data.Size     = (wcslen( string ) + 1) * sizeof(WCHAR);
+    data.Reserved = 0;
+    write_event( provider, WINE_ETW_EVENT_STRING, &descriptor, NULL, NULL, 1, &data );
+    return ERROR_SUCCESS;
+}
+
+/* fill the statistics of a session in its properties */
+static void get_session_properties( struct etw_session *session, EVENT_TRACE_PROPERTIES *properties )
+{
+    if (!properties) return;
+    properties->BufferSize      = session->buffer_size / 1024;
+    properties->MinimumBuffers  = session->buffer_count;
+    properties->MaximumBuffers  = session->buffer_count;
+    properties->NumberOfBuffers = session->buffer_count;
+    properties->FreeBuffers     = 0;
+    properties->LogFileMode     = session->log_file_mode;
+    properties->EventsLost      = session->events_lost;
+    properties->BuffersWritten  = session->buffers_written;
+}
+
+/***********************************************************************
+ *                  __wine_etw_start_trace   (NTDLL.@)
+ *
+ * Start a local trace session; the parameters are validated by the caller.
+ */
+ULONG CDECL __wine_etw_start_trace( TRACEHANDLE *handle, const WCHAR *name, EVENT_TRACE_PROPERTIES *properties )
+{
+    const WCHAR *file_name = properties->LogFileNameOffset ?
+                             (const WCHAR *)((char *)properties + properties->LogFileNameOffset) : NULL;
+    struct wine_etw_log_header header;
+    struct etw_session *session = NULL;
+    OBJECT_ATTRIBUTES attr;
+    UNICODE_STRING nt_name;
+    IO_STATUS_BLOCK io;
+    LARGE_INTEGER size;
+    SIZE_T buffers_size;
+    HANDLE section;
+    ULONG i, ret = ERROR_SUCCESS;
+    NTSTATUS status;
+
+    TRACE( "(%p, %s, %p) file %s\n", handle, debugstr_w(name), properties, debugstr_w(file_name) );
+
+    RtlEnterCriticalSection( &etw_section );
+    if (get_session( 0, name ))
+    {
+        ret = ERROR_ALREADY_EXISTS;
+        goto done;
+    }
+    for (i = 0; i < MAX_SESSIONS; i++) if (!sessions[i].used) break;
+    if (i == MAX_SESSIONS)
+    {
+        ret = ERROR_NO_SYSTEM_RESOURCES;
+        goto done;
+    }
+    session = &sessions[i];
+
+    session->buffer_size  = (properties->BufferSize ? properties->BufferSize : DEFAULT_BUFFER_KB) * 1024;
+    session->buffer_count = max( NtCurrentTeb()->Peb->NumberOfProcessors, 1 );
+    buffers_size = (SIZE_T)session->buffer_size * session->buffer_count;
+    if (buffers_size > session->buffers_size)
+    {
+        /* the previous mapping is leaked on purpose, threads may still be writing to it */
+        void *view = NULL;
+
+        size.QuadPart = buffers_size;
+        if ((status = NtCreateSection( &section, SECTION_ALL_ACCESS, NULL, &size, PAGE_READWRITE,
+                                       SEC_COMMIT, 0 )))
+        {
+            ret = RtlNtStatusToDosError( status );
+            goto done;
+        }
+        status = NtMapViewOfSection( section, NtCurrentProcess(), &view, 0, 0, NULL, &buffers_size,
+                                     ViewShare, 0, PAGE_READWRITE );
+        NtClose( section );
+        if (status)
+        {
+            ret = RtlNtStatusToDosError( status );
+            goto done;
+        }
+        session->buffers = view;
+        session->buffers_size = buffers_size;
+    }
+
+    session->file = 0;
+    session->file_pos.QuadPart = 0;
+    if (file_name)
+    {
+        if ((status = RtlDosPathNameToNtPathName_U_WithStatus( file_name, &nt_name, NULL, NULL )))
+        {
+            ret = RtlNtStatusToDosError( status );
+            goto done;
+        }
+        InitializeObjectAttributes( &attr, &nt_name, OBJ_CASE_INSENSITIVE, 0, NULL );
+        status = NtCreateFile( &session->file, GENERIC_WRITE | SYNCHRONIZE, &attr, &io, NULL,
+                               FILE_ATTRIBUTE_NORMAL, FILE_SHARE_READ | FILE_SHARE_DELETE, FILE_OVERWRITE_IF,
+                               FILE_SYNCHRONOUS_IO_NONALERT | FILE_NON_DIRECTORY_FILE, NULL, 0 );
+        RtlFreeUnicodeString( &nt_name );
+        if (status)
+        {
+            session->file = 0;
+            ret = RtlNtStatusToDosError( status );
+            goto done;
+        }
+    }
+
+    if (!(session->name = RtlAllocateHeap( GetProcessHeap(), 0, (wcslen( name ) + 1) * sizeof(WCHAR) )))
+    {
+        if (session->file) NtClose( session->file );
+        ret = ERROR_NOT_ENOUGH_MEMORY;
+        goto done;
+    }
+    wcscpy( session->name, name );
+    session->log_file_mode   = properties->LogFileMode;
+    session->buffers_written = 0;
+    session->events_lost     = 0;
+    session->guid_count      = 0;
+    if (!session->cs.DebugInfo) RtlInitializeCriticalSection( &session->cs );
+    for (i = 0; i < session->buffer_count; i++)
+    {
+        struct etw_buffer *buffer = get_buffer( session, i );
+        buffer->filled = 0;
+        buffer->offset = sizeof(*buffer);
+    }
+
+    if (session->file)
+    {
+        memset( &header, 0, sizeof(header) );
+        header.magic         = WINE_ETW_LOG_MAGIC;
+        header.version       = WINE_ETW_LOG_VERSION;
+        NtQueryPerformanceCounter( &header.start_time, &header.frequency );
+        NtQuerySystemTime( &header.start_system_time );
+        header.pid           = HandleToULong( NtCurrentTeb()->ClientId.UniqueProcess );
+        header.buffer_count  = session->buffer_count;
+        header.buffer_size   = session->buffer_size;
+        header.log_file_mode = session->log_file_mode;
+        memcpy( header.logger_name, name, min( wcslen( name ), ARRAY_SIZE(header.logger_name) - 1 ) * sizeof(WCHAR) );
+        NtWriteFile( session->file, 0, NULL, NULL, &io, &header, sizeof(header), &session->file_pos, NULL );
+        session->file_pos.QuadPart += sizeof(header);
+    }
+
+    session->used = TRUE;
+    session->stopped = FALSE;
+    *handle = session - sessions + 1;
+    get_session_properties( session, properties );
+
+done:
+    RtlLeaveCriticalSection( &etw_section );
+    return ret;
+}
+
+/***********************************************************************
+ *                  __wine_etw_control_trace   (NTDLL.@)
+ */
+ULONG CDECL __wine_etw_control_trace( TRACEHANDLE handle, const WCHAR *name,
+                                      EVENT_TRACE_PROPERTIES *properties, ULONG control )
+{
+    struct etw_session *session;
+    struct etw_provider *provider;
+    ULONG ret = ERROR_SUCCESS;
+
+    TRACE( "(%s, %s, %p, %u)\n", wine_dbgstr_longlong(handle), debugstr_w(name), properties, control );
+
+    RtlEnterCriticalSection( &etw_section );
+    if (!(session = get_session( handle, name )))
+    {
+        RtlLeaveCriticalSection( &etw_section );
+        return ERROR_WMI_INSTANCE_NOT_FOUND;
+    }
+
+    switch (control)
+    {
+    case EVENT_TRACE_CONTROL_QUERY:
+    case EVENT_TRACE_CONTROL_UPDATE:
+        break;
+    case EVENT_TRACE_CONTROL_FLUSH:
+        flush_session( session );
+        break;
+    case EVENT_TRACE_CONTROL_STOP:
+        LIST_FOR_EACH_ENTRY( provider, &providers, struct etw_provider, entry )
+        {
+            if (provider->enabled && provider->session == session)
+                enable_provider( provider, session, EVENT_CONTROL_CODE_DISABLE_PROVIDER, 0, 0, 0 );
+        }
+        stop_session( session );
+        RtlFreeHeap( GetProcessHeap(), 0, session->name );
+        session->name = NULL;
+        session->used = FALSE;
+        break;
+    default:
+        ret = ERROR_INVALID_PARAMETER;
+        break;
+    }
+    if (!ret) get_session_properties( session, properties );
+    RtlLeaveCriticalSection( &etw_section );
+    return ret;
+}
+
+/***********************************************************************
+ *                  __wine_etw_enable_trace   (NTDLL.@)
+ */
+ULONG CDECL __wine_etw_enable_trace( TRACEHANDLE handle, const GUID *guid, ULONG control, UCHAR level,
+                                     ULONGLONG match_any, ULONGLONG match_all )
+{
+    struct etw_session *session;
+    struct etw_provider *provider;
+    ULONG i;
+
+    TRACE( "(%s, %s, %u, %u, %s, %s)\n", wine_dbgstr_longlong(handle), debugstr_guid(guid), control,
+           level, wine_dbgstr_longlong(match_any), wine_dbgstr_longlong(match_all) );
+
+    if (!guid) return ERROR_INVALID_PARAMETER;
+    if (control > EVENT_CONTROL_CODE_CAPTURE_STATE) return ERROR_INVALID_PARAMETER;
+
+    RtlEnterCriticalSection( &etw_section );
+    if (!(session = get_session( handle, NULL )))
+    {
+        RtlLeaveCriticalSection( &etw_section );
+        return ERROR_INVALID_HANDLE;
+    }
+
+    for (i = 0; i < session->guid_count; i++)
+        if (IsEqualGUID( &session->guids[i].guid, guid )) break;
+
+    switch (control)
+    {
+    case EVENT_CONTROL_CODE_ENABLE_PROVIDER:
+        if (i == session->guid_count)
+        {
+            if (i == MAX_ENABLED_GUIDS)
+            {
+                RtlLeaveCriticalSection( &etw_section );
+                return ERROR_NO_SYSTEM_RESOURCES;
+            }
+            session->guids[session->guid_count++].guid = *guid;
+        }
+        session->guids[i].level     = level;
+        session->guids[i].match_any = match_any;
+        session->guids[i].match_all = match_all;
+        break;
+    case EVENT_CONTROL_CODE_DISABLE_PROVIDER:
+        if (i < session->guid_count) session->guids[i] = session->guids[--session->guid_count];
+        break;
+    case EVENT_CONTROL_CODE_CAPTURE_STATE:
+        break;
+    }
+
+    LIST_FOR_EACH_ENTRY( provider, &providers, struct etw_provider, entry )
+    {
+        if (!IsEqualGUID( &provider->guid, guid )) continue;
+        enable_provider( provider, session, control, level, match_any, match_all );
+    }
+    RtlLeaveCriticalSection( &etw_section );
+    return ERROR_SUCCESS;
+}
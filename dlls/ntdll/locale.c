@@ -23,6 +23,9 @@
 #include <stdarg.h>
 #include <string.h>
 #include <stdlib.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #include "ntstatus.h"
 #define WIN32_NO_STATUS
@@ -171,6 +174,120 @@ static WCHAR casemap_ascii( WCHAR ch )
 }
 
 
+/* whether code pages map 7-bit ASCII to itself, keyed on the code page number since
+ * tables are caller-supplied. Each entry holds the code page in the low word and
+ * ASCII_* flags in the high word, so that it can be read and replaced atomically. */
+#define ASCII_MB_CHECKED  0x10000
+#define ASCII_MB          0x20000
+#define ASCII_WC_CHECKED  0x40000
+#define ASCII_WC          0x80000
+static LONG ascii_codepages[16];
+
+static BOOL is_ascii_table( const CPTABLEINFO *info, BOOL wctomb )
+{
+    LONG *entry = &ascii_codepages[info->CodePage % ARRAY_SIZE(ascii_codepages)];
+    LONG checked = wctomb ? ASCII_WC_CHECKED : ASCII_MB_CHECKED;
+    LONG ascii = wctomb ? ASCII_WC : ASCII_MB;
+    LONG val = *(volatile LONG *)entry;
+    unsigned int i;
+
+    if (LOWORD(val) == info->CodePage && (val & checked)) return (val & ascii) != 0;
+
+    for (i = 0; i < 0x80; i++)
+    {
+        if (!wctomb)
+        {
+            if (info->MultiByteTable[i] != i) break;
+            if (info->DBCSCodePage && info->DBCSOffsets[i]) break;
+        }
+        else if (info->DBCSCodePage)
+        {
+            if (((const USHORT *)info->WideCharTable)[i] != i) break;
+        }
+        else if (((const unsigned char *)info->WideCharTable)[i] != i) break;
+    }
+
+    /* keep the other direction if it's for the same code page, losing it to a race is harmless */
+    if (LOWORD(val) != info->CodePage) val = info->CodePage;
+    val |= checked;
+    if (i == 0x80) val |= ascii;
+    InterlockedExchange( entry, val );
+    return i == 0x80;
+}
+
+
+/* copy a run of 7-bit ASCII chars, returns the number of chars copied */
+static inline unsigned int copy_ascii_to_unicode( WCHAR *dst, const char *src, unsigned int len )
+{
+    unsigned int i = 0;
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128();
+
+    for ( ; i + 16 <= len; i += 16)
+    {
+        __m128i val = _mm_loadu_si128( (const __m128i *)(src + i) );
+        if (_mm_movemask_epi8( val )) break;
+        _mm_storeu_si128( (__m128i *)(dst + i), _mm_unpacklo_epi8( val, zero ));
+        _mm_storeu_si128( (__m128i *)(dst + i + 8), _mm_unpackhi_epi8( val, zero ));
+    }
+#endif
+    for ( ; i < len && !(src[i] & 0x80); i++) dst[i] = src[i];
+    return i;
+}
+
+
+/* copy a run of 7-bit ASCII chars, returns the number of chars copied */
+static inline unsigned int copy_unicode_to_ascii( char *dst, const WCHAR *src, unsigned int len )
+{
+    unsigned int i = 0;
+#ifdef __SSE2__
+    const __m128i mask = _mm_set1_epi16( 0xff80 ), zero = _mm_setzero_si128();
+
+    for ( ; i + 16 <= len; i += 16)
+    {
+        __m128i lo = _mm_loadu_si128( (const __m128i *)(src + i) );
+        __m128i hi = _mm_loadu_si128( (const __m128i *)(src + i + 8) );
+        __m128i high_bits = _mm_and_si128( _mm_or_si128( lo, hi ), mask );
+        if (_mm_movemask_epi8( _mm_cmpeq_epi16( high_bits, zero )) != 0xffff) break;
+        _mm_storeu_si128( (__m128i *)(dst + i), _mm_packus_epi16( lo, hi ));
+    }
+#endif
+    for ( ; i < len && src[i] < 0x80; i++) dst[i] = src[i];
+    return i;
+}
+
+
+/* length of a run of 7-bit ASCII chars */
+static inline unsigned int ascii_length( const char *src, unsigned int len )
+{
+    unsigned int i = 0;
+#ifdef __SSE2__
+    for ( ; i + 16 <= len; i += 16)
+        if (_mm_movemask_epi8( _mm_loadu_si128( (const __m128i *)(src + i) ))) break;
+#endif
+    for ( ; i < len && !(src[i] & 0x80); i++) ;
+    return i;
+}
+
+
+/* length of a run of 7-bit ASCII chars */
+static inline unsigned int ascii_lengthW( const WCHAR *src, unsigned int len )
+{
+    unsigned int i = 0;
+#ifdef __SSE2__
+    const __m128i mask = _mm_set1_epi16( 0xff80 ), zero = _mm_setzero_si128();
+
+    for ( ; i + 8 <= len; i += 8)
+    {
+        __m128i val = _mm_and_si128( _mm_loadu_si128( (const __m128i *)(src + i) ), mask );
+        if (_mm_movemask_epi8( _mm_cmpeq_epi16( val, zero )) != 0xffff) break;
+    }
+#endif
+    for ( ; i < len && src[i] < 0x80; i++) ;
+    return i;
+}
+
+
 static int get_utf16( const WCHAR *src, unsigned int srclen, unsigned int *ch )
 {
     if (IS_HIGH_SURROGATE( src[0] ))
@@ -813,14 +930,26 @@ NTSTATUS WINAPI RtlHashUnicodeString( const UNICODE_STRING *string, BOOLEAN case
 NTSTATUS WINAPI RtlCustomCPToUnicodeN( CPTABLEINFO *info, WCHAR *dst, DWORD dstlen, DWORD *reslen,
                                        const char *src, DWORD srclen )
 {
-    DWORD i, ret;
+    DWORD i, len, ret;
+    BOOL ascii = srclen >= 16 && is_ascii_table( info, FALSE );
 
     dstlen /= sizeof(WCHAR);
     if (info->DBCSOffsets)
     {
         for (i = dstlen; srclen && i; i--, srclen--, src++, dst++)
         {
-            USHORT off = info->DBCSOffsets[(unsigned char)*src];
+            USHORT off;
+
+            if (ascii && !(*src & 0x80))
+            {
+                len = copy_ascii_to_unicode( dst, src, min( srclen, i )) - 1;
+                i -= len;  /* the last char is accounted for by the loop */
+                srclen -= len;
+                src += len;
+                dst += len;
+                continue;
+            }
+            off = info->DBCSOffsets[(unsigned char)*src];
             if (off && srclen > 1)
             {
                 src++;
@@ -834,7 +963,15 @@ NTSTATUS WINAPI RtlCustomCPToUnicodeN( CPTABLEINFO *info, WCHAR *dst, DWORD dstl
     else
     {
         ret = min( srclen, dstlen );
-        for (i = 0; i < ret; i++) dst[i] = info->MultiByteTable[(unsigned char)src[i]];
+        for (i = 0; i < ret; i++)
+        {
+            if (ascii && !(src[i] & 0x80))
+            {
+                i += copy_ascii_to_unicode( dst + i, src + i, ret - i ) - 1;
+                continue;
+            }
+            dst[i] = info->MultiByteTable[(unsigned char)src[i]];
+        }
     }
     if (reslen) *reslen = ret * sizeof(WCHAR);
     return STATUS_SUCCESS;
@@ -847,15 +984,26 @@ NTSTATUS WINAPI RtlCustomCPToUnicodeN( CPTABLEINFO *info, WCHAR *dst, DWORD dstl
 NTSTATUS WINAPI RtlUnicodeToCustomCPN( CPTABLEINFO *info, char *dst, DWORD dstlen, DWORD *reslen,
                                        const WCHAR *src, DWORD srclen )
 {
-    DWORD i, ret;
+    DWORD i, len, ret;
+    BOOL ascii;
 
     srclen /= sizeof(WCHAR);
+    ascii = srclen >= 16 && is_ascii_table( info, TRUE );
     if (info->DBCSCodePage)
     {
         WCHAR *uni2cp = info->WideCharTable;
 
         for (i = dstlen; srclen && i; i--, srclen--, src++)
         {
+            if (ascii && *src < 0x80)
+            {
+                len = copy_unicode_to_ascii( dst, src, min( srclen, i ));
+                i -= len - 1;  /* the last char is accounted for by the loop */
+                srclen -= len - 1;
+                src += len - 1;
+                dst += len;
+                continue;
+            }
             if (uni2cp[*src] & 0xff00)
             {
                 if (i == 1) break;  /* do not output a partial char */
@@ -870,7 +1018,15 @@ NTSTATUS WINAPI RtlUnicodeToCustomCPN( CPTABLEINFO *info, char *dst, DWORD dstle
     {
         char *uni2cp = info->WideCharTable;
         ret = min( srclen, dstlen );
-        for (i = 0; i < ret; i++) dst[i] = uni2cp[src[i]];
+        for (i = 0; i < ret; i++)
+        {
+            if (ascii && src[i] < 0x80)
+            {
+                i += copy_unicode_to_ascii( dst + i, src + i, ret - i ) - 1;
+                continue;
+            }
+            dst[i] = uni2cp[src[i]];
+        }
     }
     if (reslen) *reslen = ret;
     return STATUS_SUCCESS;
@@ -1317,7 +1473,13 @@ NTSTATUS WINAPI RtlUTF8ToUnicodeN( WCHAR *dst, DWORD dstlen, DWORD *reslen, cons
         for (len = 0; src < srcend; len++)
         {
             unsigned char ch = *src++;
-            if (ch < 0x80) continue;
+            if (ch < 0x80)
+            {
+                res = ascii_length( src, srcend - src );
+                src += res;
+                len += res;
+                continue;
+            }
             if ((res = decode_utf8_char( ch, &src, srcend )) > 0x10ffff)
                 status = STATUS_SOME_NOT_MAPPED;
             else
@@ -1333,6 +1495,9 @@ NTSTATUS WINAPI RtlUTF8ToUnicodeN( WCHAR *dst, DWORD dstlen, DWORD *reslen, cons
         if (ch < 0x80)  /* special fast case for 7-bit ASCII */
         {
             *dst++ = ch;
+            len = copy_ascii_to_unicode( dst, src, min( srcend - src, dstend - dst ));
+            src += len;
+            dst += len;
             continue;
         }
         if ((res = decode_utf8_char( ch, &src, srcend )) <= 0xffff)
@@ -1377,7 +1542,13 @@ NTSTATUS WINAPI RtlUnicodeToUTF8N( char *dst, DWORD dstlen, DWORD *reslen, const
     {
         for (len = 0; srclen; srclen--, src++)
         {
-            if (*src < 0x80) len++;  /* 0x00-0x7f: 1 byte */
+            if (*src < 0x80)  /* 0x00-0x7f: 1 byte */
+            {
+                val = ascii_lengthW( src, srclen );
+                len += val;
+                src += val - 1;
+                srclen -= val - 1;
+            }
             else if (*src < 0x800) len += 2;  /* 0x80-0x7ff: 2 bytes */
             else
             {
@@ -1406,7 +1577,10 @@ NTSTATUS WINAPI RtlUnicodeToUTF8N( char *dst, DWORD dstlen, DWORD *reslen, const
         if (ch < 0x80)  /* 0x00-0x7f: 1 byte */
         {
             if (dst > end - 1) break;
-            *dst++ = ch;
+            len = copy_unicode_to_ascii( dst, src, min( srclen, end - dst ));
+            dst += len;
+            src += len - 1;
+            srclen -= len - 1;
             continue;
         }
         if (ch < 0x800)  /* 0x80-0x7ff: 2 bytes */
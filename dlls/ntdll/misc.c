@@ -172,38 +172,6 @@ ULONG WINAPI EtwEventActivityIdControl(ULONG code, GUID *guid)
     return ERROR_SUCCESS;
 }
 
-/******************************************************************************
- *                  EtwEventProviderEnabled (NTDLL.@)
- */
-BOOLEAN WINAPI EtwEventProviderEnabled( REGHANDLE handle, UCHAR level, ULONGLONG keyword )
-{
-    WARN("%s, %u, %s: stub\n", wine_dbgstr_longlong(handle), level, wine_dbgstr_longlong(keyword));
-    return FALSE;
-}
-
-/******************************************************************************
- *                  EtwEventRegister (NTDLL.@)
- */
-ULONG WINAPI EtwEventRegister( LPCGUID provider, PENABLECALLBACK callback, PVOID context,
-                PREGHANDLE handle )
-{
-    WARN("(%s, %p, %p, %p) stub.\n", debugstr_guid(provider), callback, context, handle);
-
-    if (!handle) return ERROR_INVALID_PARAMETER;
-
-    *handle = 0xdeadbeef;
-    return ERROR_SUCCESS;
-}
-
-/******************************************************************************
- *                  EtwEventUnregister (NTDLL.@)
- */
-ULONG WINAPI EtwEventUnregister( REGHANDLE handle )
-{
-    WARN("(%s) stub.\n", wine_dbgstr_longlong(handle));
-    return ERROR_SUCCESS;
-}
-
 /*********************************************************************
  *                  EtwEventSetInformation   (NTDLL.@)
  */
@@ -214,27 +182,6 @@ ULONG WINAPI EtwEventSetInformation( REGHANDLE handle, EVENT_INFO_CLASS class, v
     return ERROR_SUCCESS;
 }
 
-/******************************************************************************
- *                  EtwEventWriteString   (NTDLL.@)
- */
-ULONG WINAPI EtwEventWriteString( REGHANDLE handle, UCHAR level, ULONGLONG keyword, PCWSTR string )
-{
-    FIXME("%s, %u, %s, %s: stub\n", wine_dbgstr_longlong(handle), level,
-          wine_dbgstr_longlong(keyword), debugstr_w(string));
-    return ERROR_SUCCESS;
-}
-
-/******************************************************************************
- *                  EtwEventWriteTransfer   (NTDLL.@)
- */
-ULONG WINAPI EtwEventWriteTransfer( REGHANDLE handle, PCEVENT_DESCRIPTOR descriptor, LPCGUID activity,
-                                    LPCGUID related, ULONG count, PEVENT_DATA_DESCRIPTOR data )
-{
-    FIXME("%s, %p, %s, %s, %u, %p: stub\n", wine_dbgstr_longlong(handle), descriptor,
-          debugstr_guid(activity), debugstr_guid(related), count, data);
-    return ERROR_SUCCESS;
-}
-
 /******************************************************************************
  *                  EtwRegisterTraceGuidsW (NTDLL.@)
  *
@@ -303,25 +250,6 @@ ULONG WINAPI EtwUnregisterTraceGuids( TRACEHANDLE RegistrationHandle )
     return ERROR_SUCCESS;
 }
 
-/******************************************************************************
- *                  EtwEventEnabled (NTDLL.@)
- */
-BOOLEAN WINAPI EtwEventEnabled( REGHANDLE handle, const EVENT_DESCRIPTOR *descriptor )
-{
-    WARN("(%s, %p): stub\n", wine_dbgstr_longlong(handle), descriptor);
-    return FALSE;
-}
-
-/******************************************************************************
- *                  EtwEventWrite (NTDLL.@)
- */
-ULONG WINAPI EtwEventWrite( REGHANDLE handle, const EVENT_DESCRIPTOR *descriptor, ULONG count,
-    EVENT_DATA_DESCRIPTOR *data )
-{
-    FIXME("(%s, %p, %u, %p): stub\n", wine_dbgstr_longlong(handle), descriptor, count, data);
-    return ERROR_SUCCESS;
-}
-
 /******************************************************************************
  *                  EtwGetTraceEnableFlags (NTDLL.@)
  */
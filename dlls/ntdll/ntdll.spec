@@ -1638,6 +1638,11 @@
 @ cdecl -norelay __wine_dbg_output(str)
 @ cdecl -norelay __wine_dbg_strdup(str)
 
+# Event tracing
+@ cdecl __wine_etw_start_trace(ptr wstr ptr)
+@ cdecl __wine_etw_control_trace(int64 wstr ptr long)
+@ cdecl __wine_etw_enable_trace(int64 ptr long long int64 int64)
+
 # Virtual memory
 @ cdecl -syscall __wine_needs_override_large_address_aware()
 
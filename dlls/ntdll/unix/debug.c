@@ -26,6 +26,10 @@
 
 #include <assert.h>
 #include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -65,6 +69,69 @@ static struct __wine_debug_channel *debug_options;
 
 static const char * const debug_classes[] = { "fixme", "err", "warn", "trace" };
 
+/* Binary debug log, enabled by setting WINEDEBUGLOG to a file name prefix.
+ * Each thread appends records to its own ring buffer, and a background
+ * thread writes them to "<prefix>.<unix pid>". tools/decode_debug_log
+ * renders the log in the usual text format. */
+
+#define DEBUG_LOG_MAGIC    "WINEDBG\1"
+#define DEBUG_RING_SIZE    0x10000  /* must be a power of 2 */
+#define DEBUG_RECORD_RAW   0xff     /* class of output without header */
+
+#define DEBUG_RECORD_TIMESTAMP 0x01 /* +timestamp was set */
+#define DEBUG_RECORD_PID       0x02 /* +pid was set */
+#define DEBUG_RECORD_FUNCTION  0x04 /* record has a function name, i.e. a standard prefix */
+
+struct debug_log_header
+{
+    char               magic[8];
+    unsigned int       version;
+    unsigned int       unix_pid;
+    unsigned long long frequency;   /* frequency of the record time counter */
+};
+
+struct debug_record
+{
+    unsigned int       size;        /* record size, including the strings and padding to 8 bytes */
+    unsigned int       pid;
+    unsigned int       tid;
+    unsigned char      cls;
+    unsigned char      channel_len;
+    unsigned char      function_len;
+    unsigned char      flags;
+    unsigned long long time;        /* performance counter */
+    unsigned int       ticks;       /* tick count, as printed by +timestamp */
+    unsigned int       text_len;
+    /* followed by the channel name, the function name and the text */
+};
+
+C_ASSERT( sizeof(struct debug_record) == 32 );
+
+struct debug_ring
+{
+    struct debug_ring *next;
+    unsigned int       head;        /* written by the thread */
+    unsigned int       tail;        /* written by the flush thread */
+    int                dead;        /* the thread has exited */
+    int                wake_pending;
+    int                in_log;      /* the thread is using the ring, nested output goes to stderr */
+    /* header of the line being output */
+    int                header_set;
+    unsigned char      header_cls;
+    unsigned char      header_flags;
+    const char        *header_channel;
+    const char        *header_function;
+    unsigned long long header_time;
+    unsigned int       header_ticks;
+    char               data[DEBUG_RING_SIZE];
+};
+
+static int log_fd = -1;
+static int log_wake_pipe[2] = { -1, -1 };
+static struct debug_ring *log_rings;
+static pthread_key_t log_ring_key;
+static pthread_mutex_t log_flush_mutex = PTHREAD_MUTEX_INITIALIZER;
+
 /* get the debug info pointer for the current thread */
 static inline struct debug_info *get_info(void)
 {
@@ -90,6 +157,199 @@ static int append_output( struct debug_info *info, const char *str, size_t len )
     return len;
 }
 
+/* mark the ring of an exiting thread for freeing once it has been flushed */
+static void free_log_ring( void *ptr )
+{
+    struct debug_ring *ring = ptr;
+
+    __atomic_store_n( &ring->dead, 1, __ATOMIC_RELEASE );
+}
+
+/* get the log ring buffer for the current thread and mark it in use; fails if
+ * the thread has no ring, or if it is already using it and got here again,
+ * for instance from a signal handler */
+static struct debug_ring *enter_log_ring(void)
+{
+    struct debug_ring *ring;
+
+    if (log_fd == -1 || !init_done) return NULL;
+    if (!(ring = pthread_getspecific( log_ring_key ))) return NULL;
+    if (ring->in_log) return NULL;
+    ring->in_log = 1;
+    __atomic_signal_fence( __ATOMIC_SEQ_CST );
+    return ring;
+}
+
+static void leave_log_ring( struct debug_ring *ring )
+{
+    __atomic_signal_fence( __ATOMIC_SEQ_CST );
+    ring->in_log = 0;
+}
+
+/* copy data to the ring buffer at the given position, wrapping around if needed */
+static unsigned int ring_write( struct debug_ring *ring, unsigned int pos, const void *data, unsigned int len )
+{
+    unsigned int offset = pos & (DEBUG_RING_SIZE - 1), count = min( len, DEBUG_RING_SIZE - offset );
+
+    memcpy( ring->data + offset, data, count );
+    memcpy( ring->data, (const char *)data + count, len - count );
+    return pos + len;
+}
+
+/* append a record to the thread ring buffer; only the owning thread writes to it */
+static void log_record( struct debug_ring *ring, unsigned char cls, unsigned char flags,
+                        const char *channel, const char *function, unsigned long long time,
+                        unsigned int ticks, const char *text, unsigned int len )
+{
+    static const char padding[8];
+    struct debug_record record;
+    unsigned int pos = ring->head;
+
+    if (!channel) channel = "";
+    if (!function) function = "";
+    if (!time)
+    {
+        LARGE_INTEGER counter;
+
+        NtQueryPerformanceCounter( &counter, NULL );
+        time = counter.QuadPart;
+        ticks = NtGetTickCount();
+    }
+    record.pid          = GetCurrentProcessId();
+    record.tid          = GetCurrentThreadId();
+    record.cls          = cls;
+    record.flags        = flags;
+    record.channel_len  = strlen( channel );
+    record.function_len = min( strlen( function ), 255 );
+    record.time         = time;
+    record.ticks        = ticks;
+    record.text_len     = len;
+    record.size = (sizeof(record) + record.channel_len + record.function_len + len + 7) & ~7;
+
+    /* wait for the flush thread if the ring is full, output must not be lost */
+    while (record.size > DEBUG_RING_SIZE - (pos - __atomic_load_n( &ring->tail, __ATOMIC_ACQUIRE )))
+    {
+        write( log_wake_pipe[1], "", 1 );
+        sched_yield();
+    }
+
+    pos = ring_write( ring, pos, &record, sizeof(record) );
+    pos = ring_write( ring, pos, channel, record.channel_len );
+    pos = ring_write( ring, pos, function, record.function_len );
+    pos = ring_write( ring, pos, text, len );
+    pos = ring_write( ring, pos, padding, ring->head + record.size - pos );
+    __atomic_store_n( &ring->head, pos, __ATOMIC_RELEASE );
+
+    if (pos - ring->tail >= DEBUG_RING_SIZE / 2 && !ring->wake_pending)
+    {
+        ring->wake_pending = 1;
+        write( log_wake_pipe[1], "", 1 );
+    }
+}
+
+/* write out the contents of all the ring buffers; caller must hold log_flush_mutex */
+static void flush_log_rings(void)
+{
+    struct debug_ring *ring, *next, **prev;
+    unsigned int head, tail, offset, count;
+
+    for (prev = &log_rings, ring = __atomic_load_n( &log_rings, __ATOMIC_ACQUIRE ); ring; ring = next)
+    {
+        int dead = __atomic_load_n( &ring->dead, __ATOMIC_ACQUIRE );
+
+        next = ring->next;
+        head = __atomic_load_n( &ring->head, __ATOMIC_ACQUIRE );
+        for (tail = ring->tail; tail != head; tail += count)
+        {
+            offset = tail & (DEBUG_RING_SIZE - 1);
+            count = min( head - tail, DEBUG_RING_SIZE - offset );
+            write( log_fd, ring->data + offset, count );
+        }
+        __atomic_store_n( &ring->tail, tail, __ATOMIC_RELEASE );
+        ring->wake_pending = 0;
+
+        if (!dead)
+        {
+            prev = &ring->next;
+            continue;
+        }
+
+        /* new rings are only ever added at the head of the list */
+        if (prev == &log_rings)
+        {
+            struct debug_ring *expected = ring;
+
+            if (!__atomic_compare_exchange_n( &log_rings, &expected, next, FALSE,
+                                              __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE ))
+            {
+                while (expected->next != ring) expected = expected->next;
+                prev = &expected->next;
+                *prev = next;
+            }
+        }
+        else *prev = next;
+        free( ring );
+    }
+}
+
+/* background thread writing out the ring buffers */
+static void *log_flush_thread( void *arg )
+{
+    struct pollfd pfd = { log_wake_pipe[0], POLLIN };
+    char buffer[64];
+
+    for (;;)
+    {
+        if (poll( &pfd, 1, 10 ) > 0) while (read( log_wake_pipe[0], buffer, sizeof(buffer) ) > 0) /* nothing */;
+        pthread_mutex_lock( &log_flush_mutex );
+        flush_log_rings();
+        pthread_mutex_unlock( &log_flush_mutex );
+    }
+    return NULL;
+}
+
+/* open the binary log file and start the flush thread */
+static void init_log( const char *prefix )
+{
+    struct debug_log_header header;
+    pthread_t thread;
+    sigset_t sigset, old_sigset;
+    char *name;
+
+    if (!(name = malloc( strlen( prefix ) + 12 ))) return;
+    sprintf( name, "%s.%u", prefix, (unsigned int)getpid() );
+    log_fd = open( name, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666 );
+    free( name );
+    if (log_fd == -1) return;
+
+    memcpy( header.magic, DEBUG_LOG_MAGIC, sizeof(header.magic) );
+    header.version   = 1;
+    header.unix_pid  = getpid();
+    header.frequency = TICKSPERSEC;
+    write( log_fd, &header, sizeof(header) );
+
+    if (pipe( log_wake_pipe ) == -1) goto failed;
+    fcntl( log_wake_pipe[0], F_SETFD, FD_CLOEXEC );
+    fcntl( log_wake_pipe[1], F_SETFD, FD_CLOEXEC );
+    fcntl( log_wake_pipe[0], F_SETFL, O_NONBLOCK );
+    fcntl( log_wake_pipe[1], F_SETFL, O_NONBLOCK );
+    if (pthread_key_create( &log_ring_key, free_log_ring )) goto failed;
+
+    /* the flush thread must never run signal handlers */
+    sigfillset( &sigset );
+    pthread_sigmask( SIG_SETMASK, &sigset, &old_sigset );
+    if (pthread_create( &thread, NULL, log_flush_thread, NULL )) thread = 0;
+    pthread_sigmask( SIG_SETMASK, &old_sigset, NULL );
+    if (!thread) goto failed;
+    pthread_detach( thread );
+    atexit( dbg_flush_log );
+    return;
+
+failed:
+    close( log_fd );
+    log_fd = -1;
+}
+
 /* add a new debug option at the end of the option list */
 static void add_option( const char *name, unsigned char set, unsigned char clear )
 {
@@ -257,6 +517,14 @@ const char * __cdecl __wine_dbg_strdup( const char *str )
  */
 int WINAPI __wine_dbg_write( const char *str, unsigned int len )
 {
+    struct debug_ring *ring;
+
+    if ((ring = enter_log_ring()))
+    {
+        log_record( ring, DEBUG_RECORD_RAW, 0, NULL, NULL, 0, 0, str, len );
+        leave_log_ring( ring );
+        return len;
+    }
     return write( 2, str, len );
 }
 
@@ -271,8 +539,21 @@ int __cdecl __wine_dbg_output( const char *str )
 
     if (end)
     {
+        struct debug_ring *ring;
+
         ret += append_output( info, str, end + 1 - str );
-        __wine_dbg_write( info->output, info->out_pos );
+        if ((ring = enter_log_ring()))
+        {
+            if (ring->header_set)
+                log_record( ring, ring->header_cls, ring->header_flags, ring->header_channel,
+                            ring->header_function, ring->header_time, ring->header_ticks,
+                            info->output, info->out_pos );
+            else
+                log_record( ring, DEBUG_RECORD_RAW, 0, NULL, NULL, 0, 0, info->output, info->out_pos );
+            ring->header_set = FALSE;
+            leave_log_ring( ring );
+        }
+        else __wine_dbg_write( info->output, info->out_pos );
         info->out_pos = 0;
         str = end + 1;
     }
@@ -288,6 +569,7 @@ int __cdecl __wine_dbg_header( enum __wine_debug_class cls, struct __wine_debug_
 {
     static const char * const classes[] = { "fixme", "err", "warn", "trace" };
     struct debug_info *info = get_info();
+    struct debug_ring *ring;
     char *pos = info->output;
 
     if (!(__wine_dbg_get_channel_flags( channel ) & (1 << cls))) return -1;
@@ -295,6 +577,30 @@ int __cdecl __wine_dbg_header( enum __wine_debug_class cls, struct __wine_debug_
     /* only print header if we are at the beginning of the line */
     if (info->out_pos) return 0;
 
+    if ((ring = enter_log_ring()))
+    {
+        LARGE_INTEGER counter;
+
+        if (ring->header_set)
+        {
+            leave_log_ring( ring );
+            return 0;
+        }
+        NtQueryPerformanceCounter( &counter, NULL );
+        ring->header_set = TRUE;
+        ring->header_cls = cls;
+        ring->header_flags = 0;
+        if (TRACE_ON(timestamp)) ring->header_flags |= DEBUG_RECORD_TIMESTAMP;
+        if (TRACE_ON(pid)) ring->header_flags |= DEBUG_RECORD_PID;
+        if (function && cls < ARRAY_SIZE( classes )) ring->header_flags |= DEBUG_RECORD_FUNCTION;
+        ring->header_channel = channel->name;
+        ring->header_function = function;
+        ring->header_time = counter.QuadPart;
+        ring->header_ticks = NtGetTickCount();
+        leave_log_ring( ring );
+        return 0;
+    }
+
     if (init_done)
     {
         if (TRACE_ON(timestamp))
@@ -318,11 +624,13 @@ int __cdecl __wine_dbg_header( enum __wine_debug_class cls, struct __wine_debug_
 void dbg_init(void)
 {
     struct __wine_debug_channel *options, default_option = { default_flags };
+    const char *log_name;
 
     setbuf( stdout, NULL );
     setbuf( stderr, NULL );
 
     if (nb_debug_options == -1) init_options();
+    if ((log_name = getenv( "WINEDEBUGLOG" )) && *log_name) init_log( log_name );
 
     options = (struct __wine_debug_channel *)((char *)peb + (is_win64 ? 2 : 1) * page_size);
     memcpy( options, debug_options, nb_debug_options * sizeof(*options) );
@@ -330,6 +638,40 @@ void dbg_init(void)
     debug_options = options;
     options[nb_debug_options] = default_option;
     init_done = TRUE;
+    dbg_init_thread();
+}
+
+
+/***********************************************************************
+ *		dbg_init_thread
+ *
+ * Allocate the binary log ring buffer of the current thread.
+ */
+void dbg_init_thread(void)
+{
+    struct debug_ring *ring;
+
+    if (log_fd == -1) return;
+    if (!(ring = malloc( sizeof(*ring) ))) return;
+    memset( ring, 0, offsetof( struct debug_ring, data ));
+    ring->next = __atomic_load_n( &log_rings, __ATOMIC_RELAXED );
+    while (!__atomic_compare_exchange_n( &log_rings, &ring->next, ring, FALSE,
+                                         __ATOMIC_RELEASE, __ATOMIC_RELAXED )) /* nothing */;
+    pthread_setspecific( log_ring_key, ring );
+}
+
+
+/***********************************************************************
+ *		dbg_flush_log
+ *
+ * Write out the pending binary log records, at process exit.
+ */
+void dbg_flush_log(void)
+{
+    if (log_fd == -1) return;
+    pthread_mutex_lock( &log_flush_mutex );
+    flush_log_rings();
+    pthread_mutex_unlock( &log_flush_mutex );
 }
 
 
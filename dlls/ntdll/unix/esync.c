@@ -29,6 +29,7 @@
 #include <assert.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
 #ifdef HAVE_POLL_H
 #include <poll.h>
 #endif
@@ -39,6 +40,9 @@
 # include <sys/mman.h>
 #endif
 #include <poll.h>
+#ifdef HAVE_SYS_EPOLL_H
+# include <sys/epoll.h>
+#endif
 #ifdef HAVE_SYS_STAT_H
 # include <sys/stat.h>
 #endif
@@ -81,6 +85,7 @@ struct esync
     enum esync_type type;
     int fd;
     void *shm;
+    unsigned int closes;  /* number of times this handle slot was closed */
 };
 
 struct semaphore
@@ -281,6 +286,8 @@ NTSTATUS esync_close( HANDLE handle )
     {
         if (InterlockedExchange((int *)&esync_list[entry][idx].type, 0))
         {
+            /* tell do_poll_cached() that the fd may now be reused */
+            InterlockedIncrement( (LONG *)&esync_list[entry][idx].closes );
             close( esync_list[entry][idx].fd );
             return STATUS_SUCCESS;
         }
@@ -766,6 +773,177 @@ static int do_poll( struct pollfd *fds, nfds_t nfds, ULONGLONG *end )
     return ret;
 }
 
+#if defined(HAVE_SYS_EPOLL_H) && defined(HAVE_EPOLL_CREATE)
+
+/* Waits on at least this many objects go through a per-thread epoll set. Below
+ * that, poll() is cheaper than keeping the set in sync. */
+#define ESYNC_EPOLL_MIN_FDS 8
+
+struct esync_wait_cache
+{
+    int          epoll_fd;  /* epoll set matching fds[], or -1 */
+    BOOL         no_epoll;  /* fds[] can't be put in an epoll set */
+    DWORD        count;     /* number of objects, the APC fd is not included */
+    nfds_t       nfds;
+    HANDLE       handles[MAXIMUM_WAIT_OBJECTS];
+    unsigned int closes[MAXIMUM_WAIT_OBJECTS];
+    int          fds[MAXIMUM_WAIT_OBJECTS + 1];
+};
+
+static struct esync_wait_cache *get_wait_cache(void)
+{
+    struct esync_wait_cache *cache = ntdll_get_thread_data()->esync_wait_cache;
+
+    if (!cache && (cache = malloc( sizeof(*cache) )))
+    {
+        cache->epoll_fd = -1;
+        cache->no_epoll = FALSE;
+        cache->count = 0;
+        cache->nfds = 0;
+        ntdll_get_thread_data()->esync_wait_cache = cache;
+    }
+    return cache;
+}
+
+static BOOL build_epoll_set( struct esync_wait_cache *cache )
+{
+    struct epoll_event ev;
+    nfds_t i;
+
+    if (cache->epoll_fd != -1) close( cache->epoll_fd );
+    if ((cache->epoll_fd = epoll_create1( EPOLL_CLOEXEC )) == -1)
+    {
+        cache->no_epoll = TRUE;
+        return FALSE;
+    }
+
+    for (i = 0; i < cache->nfds; i++)
+    {
+        if (cache->fds[i] == -1) continue;
+        ev.events = EPOLLIN;
+        ev.data.u32 = i;
+        /* the same handle may be passed twice, poll() copes with that better */
+        if (epoll_ctl( cache->epoll_fd, EPOLL_CTL_ADD, cache->fds[i], &ev ) == -1)
+        {
+            WARN( "Failed to add fd %d to epoll set, errno %d.\n", cache->fds[i], errno );
+            close( cache->epoll_fd );
+            cache->epoll_fd = -1;
+            cache->no_epoll = TRUE;
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+/* Check whether the cached set still describes the same objects. Comparing the
+ * fds isn't enough: closing a handle doesn't remove its fd from the epoll set
+ * as long as the server holds the eventfd, and the fd number may have been
+ * reused by another object since. The close count of each handle slot catches
+ * that, without other threads' closes invalidating our set. */
+static BOOL wait_cache_matches( const struct esync_wait_cache *cache, struct esync **objs,
+                                const HANDLE *handles, DWORD count, const struct pollfd *fds,
+                                nfds_t nfds )
+{
+    DWORD i;
+
+    if (cache->count != count || cache->nfds != nfds) return FALSE;
+    for (i = 0; i < count; i++)
+    {
+        if (cache->handles[i] != handles[i] || cache->fds[i] != fds[i].fd) return FALSE;
+        if (objs[i] && cache->closes[i] != objs[i]->closes) return FALSE;
+    }
+    for (; i < nfds; i++)
+        if (cache->fds[i] != fds[i].fd) return FALSE;
+    return TRUE;
+}
+
+/* Same as do_poll(), but the fds are kept in an epoll set when a thread waits
+ * repeatedly on the same objects, so that a wait doesn't need to rearm all of
+ * them. The set is only built once the same objects are seen on two
+ * consecutive waits; threads alternating between sets keep using poll(). The
+ * fds past the first count ones (i.e. the APC fd) don't belong to an object. */
+static int do_poll_cached( struct esync **objs, const HANDLE *handles, DWORD count,
+                           struct pollfd *fds, nfds_t nfds, ULONGLONG *end )
+{
+    struct epoll_event events[MAXIMUM_WAIT_OBJECTS + 1];
+    struct esync_wait_cache *cache;
+    int ret, i, timeout_ms;
+
+    if (nfds < ESYNC_EPOLL_MIN_FDS || !(cache = get_wait_cache())) return do_poll( fds, nfds, end );
+
+    if (!wait_cache_matches( cache, objs, handles, count, fds, nfds ))
+    {
+        if (cache->epoll_fd != -1) close( cache->epoll_fd );
+        cache->epoll_fd = -1;
+        cache->no_epoll = FALSE;
+        cache->count = count;
+        cache->nfds = nfds;
+        for (i = 0; i < count; i++)
+        {
+            cache->handles[i] = handles[i];
+            cache->closes[i] = objs[i] ? objs[i]->closes : 0;
+        }
+        for (i = 0; i < nfds; i++) cache->fds[i] = fds[i].fd;
+        return do_poll( fds, nfds, end );
+    }
+    if (cache->no_epoll || (cache->epoll_fd == -1 && !build_epoll_set( cache )))
+        return do_poll( fds, nfds, end );
+
+    do
+    {
+        timeout_ms = -1;
+        if (end)
+        {
+            LONGLONG timeleft = update_timeout( *end );
+
+            /* epoll_wait() only counts in milliseconds, so wait for the whole
+             * ones and leave the remainder to ppoll() */
+            if (timeleft < TICKSPERMSEC) return do_poll( fds, nfds, end );
+            timeout_ms = min( timeleft / TICKSPERMSEC, INT_MAX );
+        }
+        ret = epoll_wait( cache->epoll_fd, events, ARRAY_SIZE(events), timeout_ms );
+    } while ((ret < 0 && errno == EINTR) || (!ret && end));
+
+    if (ret < 0) return ret;
+
+    /* report the results the way poll() does, so that callers still scan the
+     * objects in order */
+    for (i = 0; i < nfds; i++) fds[i].revents = 0;
+    for (i = 0; i < ret; i++)
+    {
+        struct pollfd *fd = &fds[events[i].data.u32];
+
+        if (events[i].events & EPOLLIN) fd->revents |= POLLIN;
+        if (events[i].events & EPOLLERR) fd->revents |= POLLERR;
+        if (events[i].events & EPOLLHUP) fd->revents |= POLLHUP;
+    }
+    return ret;
+}
+
+void esync_free_wait_cache(void)
+{
+    struct esync_wait_cache *cache = ntdll_get_thread_data()->esync_wait_cache;
+
+    if (!cache) return;
+    if (cache->epoll_fd != -1) close( cache->epoll_fd );
+    free( cache );
+    ntdll_get_thread_data()->esync_wait_cache = NULL;
+}
+
+#else  /* HAVE_SYS_EPOLL_H */
+
+static inline int do_poll_cached( struct esync **objs, const HANDLE *handles, DWORD count,
+                                  struct pollfd *fds, nfds_t nfds, ULONGLONG *end )
+{
+    return do_poll( fds, nfds, end );
+}
+
+void esync_free_wait_cache(void)
+{
+}
+
+#endif  /* HAVE_SYS_EPOLL_H */
+
 /* Return TRUE if abandoned. */
 static BOOL update_grabbed_object( struct esync *obj )
 {
@@ -1009,7 +1187,7 @@ static NTSTATUS __esync_wait_objects( DWORD count, const HANDLE *handles, BOOLEA
             if (ac_odyssey && alertable)
                 usleep( 0 );
 
-            ret = do_poll( fds, pollcount, timeout ? &end : NULL );
+            ret = do_poll_cached( objs, handles, count, fds, pollcount, timeout ? &end : NULL );
             if (ret > 0)
             {
                 /* We must check this first! The server may set an event that
@@ -77,6 +77,7 @@
 #include "wine/debug.h"
 
 WINE_DEFAULT_DEBUG_CHANNEL(process);
+WINE_DECLARE_DEBUG_CHANNEL(servercalls);
 
 
 static ULONG execute_flags = MEM_EXECUTE_OPTION_DISABLE | (sizeof(void *) > sizeof(int) ?
@@ -1520,6 +1521,16 @@ NTSTATUS WINAPI NtQueryInformationProcess( HANDLE handle, PROCESSINFOCLASS class
         else ret = STATUS_INFO_LENGTH_MISMATCH;
         break;
 
+    case ProcessWineServerCallCount:
+        /* only available for the current process, used to measure server round trips;
+         * the calls are only counted with WINEDEBUG=+servercalls */
+        len = sizeof(ULONG);
+        if (handle != NtCurrentProcess()) ret = STATUS_INVALID_PARAMETER;
+        else if (!TRACE_ON(servercalls)) ret = STATUS_NOT_SUPPORTED;
+        else if (size != len) ret = STATUS_INFO_LENGTH_MISMATCH;
+        else *(ULONG *)info = server_call_count;
+        break;
+
     default:
         FIXME("(%p,info_class=%d,%p,0x%08x,%p) Unknown information class\n",
               handle, class, info, size, ret_len );
@@ -95,6 +95,7 @@
 #include "ddk/wdm.h"
 
 WINE_DEFAULT_DEBUG_CHANNEL(server);
+WINE_DECLARE_DEBUG_CHANNEL(servercalls);
 
 /* just in case... */
 #undef EXT2_IOC_GETFLAGS
@@ -134,6 +135,7 @@ timeout_t server_start_time = 0;  /* time of server startup */
 sigset_t server_block_set;  /* signals to block during server calls */
 static int fd_socket = -1;  /* socket to exchange file descriptors with the server */
 static pid_t server_pid;
+LONG server_call_count;     /* number of requests sent by this process, with +servercalls only */
 pthread_mutex_t fd_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 /* atomically exchange a 64-bit value */
@@ -292,6 +294,7 @@ unsigned int server_call_unlocked( void *req_ptr )
     struct __server_request_info * const req = req_ptr;
     unsigned int ret;
 
+    if (TRACE_ON(servercalls)) InterlockedIncrement( &server_call_count );
     if ((ret = send_request( req ))) return ret;
     return wait_reply( req );
 }
@@ -69,6 +69,7 @@
 #include "wine/server.h"
 #include "wine/debug.h"
 #include "unix_private.h"
+#include "esync.h"
 
 WINE_DEFAULT_DEBUG_CHANNEL(thread);
 WINE_DECLARE_DEBUG_CHANNEL(seh);
@@ -1059,6 +1060,7 @@ static void contexts_from_server( CONTEXT *context, context_t server_contexts[2]
  */
 static void pthread_exit_wrapper( int status )
 {
+    esync_free_wait_cache();
     close( ntdll_get_thread_data()->wait_fd[0] );
     close( ntdll_get_thread_data()->wait_fd[1] );
     close( ntdll_get_thread_data()->reply_fd );
@@ -1079,6 +1081,7 @@ static void start_thread( TEB *teb )
 
     thread_data->pthread_id = pthread_self();
     signal_init_thread( teb );
+    dbg_init_thread();
     server_init_thread( thread_data->start, &suspend );
     signal_start_thread( thread_data->start, thread_data->param, suspend, teb );
 }
@@ -1390,6 +1393,7 @@ void abort_thread( int status )
  */
 void abort_process( int status )
 {
+    dbg_flush_log();
     _exit( get_unix_exit_code( status ));
 }
 
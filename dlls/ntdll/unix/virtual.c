@@ -3097,6 +3097,7 @@ static TEB *init_teb( void *ptr, BOOL is_wow )
     thread_data = (struct ntdll_thread_data *)&teb->GdiTebBatch;
     thread_data->esync_apc_fd = -1;
     thread_data->fsync_apc_futex = NULL;
+    thread_data->esync_wait_cache = NULL;
     thread_data->request_fd = -1;
     thread_data->reply_fd   = -1;
     thread_data->wait_fd[0] = -1;
@@ -23,21 +23,44 @@
 #include <stdarg.h>
 #include "windef.h"
 #include "winbase.h"
+#include "winnls.h"
 #include "wmistr.h"
+#include "initguid.h"
 #include "evntrace.h"
+#include "evntprov.h"
 
+#include "wine/etw.h"
+#include "wine/heap.h"
 #include "wine/debug.h"
 
 WINE_DEFAULT_DEBUG_CHANNEL(eventlog);
 
+static WCHAR *strdupAW( const char *str )
+{
+    WCHAR *ret;
+    int len;
+
+    if (!str) return NULL;
+    len = MultiByteToWideChar( CP_ACP, 0, str, -1, NULL, 0 );
+    if ((ret = heap_alloc( len * sizeof(WCHAR) ))) MultiByteToWideChar( CP_ACP, 0, str, -1, ret, len );
+    return ret;
+}
+
 /******************************************************************************
  *     ControlTraceA   (sechost.@)
  */
 ULONG WINAPI ControlTraceA( TRACEHANDLE handle, const char *session,
                             EVENT_TRACE_PROPERTIES *properties, ULONG control )
 {
-    FIXME("(%s, %s, %p, %d) stub\n", wine_dbgstr_longlong(handle), debugstr_a(session), properties, control);
-    return ERROR_SUCCESS;
+    WCHAR *sessionW = NULL;
+    ULONG ret;
+
+    TRACE("(%s, %s, %p, %d)\n", wine_dbgstr_longlong(handle), debugstr_a(session), properties, control);
+
+    if (session && !(sessionW = strdupAW( session ))) return ERROR_NOT_ENOUGH_MEMORY;
+    ret = ControlTraceW( handle, sessionW, properties, control );
+    heap_free( sessionW );
+    return ret;
 }
 
 /******************************************************************************
@@ -46,8 +69,13 @@ ULONG WINAPI ControlTraceA( TRACEHANDLE handle, const char *session,
 ULONG WINAPI ControlTraceW( TRACEHANDLE handle, const WCHAR *session,
                             EVENT_TRACE_PROPERTIES *properties, ULONG control )
 {
-    FIXME("(%s, %s, %p, %d) stub\n", wine_dbgstr_longlong(handle), debugstr_w(session), properties, control);
-    return ERROR_SUCCESS;
+    TRACE("(%s, %s, %p, %d)\n", wine_dbgstr_longlong(handle), debugstr_w(session), properties, control);
+
+    if (!properties) return ERROR_INVALID_PARAMETER;
+    if (properties->Wnode.BufferSize < sizeof(*properties)) return ERROR_BAD_LENGTH;
+    if (!handle && !session) return ERROR_INVALID_PARAMETER;
+
+    return __wine_etw_control_trace( handle, session, properties, control );
 }
 
 /******************************************************************************
@@ -57,11 +85,14 @@ ULONG WINAPI EnableTraceEx2( TRACEHANDLE handle, const GUID *provider, ULONG con
                              ULONGLONG match_any, ULONGLONG match_all, ULONG timeout,
                              ENABLE_TRACE_PARAMETERS *params )
 {
-    FIXME("(%s, %s, %u, %u, %s, %s, %u, %p): stub\n", wine_dbgstr_longlong(handle),
+    TRACE("(%s, %s, %u, %u, %s, %s, %u, %p)\n", wine_dbgstr_longlong(handle),
           debugstr_guid(provider), control, level, wine_dbgstr_longlong(match_any),
           wine_dbgstr_longlong(match_all), timeout, params);
 
-    return ERROR_SUCCESS;
+    if (params && (params->EnableProperty || params->FilterDescCount))
+        FIXME("ignoring properties %#x and %u filters\n", params->EnableProperty, params->FilterDescCount);
+
+    return __wine_etw_enable_trace( handle, provider, control, level, match_any, match_all );
 }
 
 /******************************************************************************
@@ -86,14 +117,103 @@ ULONG WINAPI QueryAllTracesW( EVENT_TRACE_PROPERTIES **properties, ULONG count,
     return ERROR_SUCCESS;
 }
 
+/* check that a string in the properties is terminated within their buffer */
+static BOOL is_property_string_terminated( const EVENT_TRACE_PROPERTIES *properties, ULONG offset, ULONG char_size )
+{
+    const char *ptr = (const char *)properties + offset;
+    const char *end = (const char *)properties + properties->Wnode.BufferSize;
+
+    for (; ptr + char_size <= end; ptr += char_size)
+        if (!ptr[0] && (char_size == 1 || !ptr[1])) return TRUE;
+    return FALSE;
+}
+
+/* validate the properties passed to StartTrace, the strings they contain are char_size wide */
+static ULONG check_start_properties( TRACEHANDLE *handle, ULONG name_size, const EVENT_TRACE_PROPERTIES *properties,
+                                     ULONG char_size )
+{
+    if (!handle || !name_size || !properties) return ERROR_INVALID_PARAMETER;
+    if (properties->Wnode.BufferSize < sizeof(*properties)) return ERROR_BAD_LENGTH;
+
+    if (properties->LoggerNameOffset)
+    {
+        if (properties->LoggerNameOffset < sizeof(*properties) ||
+            properties->LoggerNameOffset > properties->Wnode.BufferSize)
+            return ERROR_INVALID_PARAMETER;
+        if (properties->LoggerNameOffset + name_size * char_size > properties->Wnode.BufferSize)
+            return ERROR_BAD_LENGTH;
+    }
+    if (properties->LogFileNameOffset)
+    {
+        if (properties->LogFileNameOffset < sizeof(*properties) ||
+            properties->LogFileNameOffset >= properties->Wnode.BufferSize)
+            return ERROR_INVALID_PARAMETER;
+        if (!is_property_string_terminated( properties, properties->LogFileNameOffset, char_size ))
+            return ERROR_BAD_LENGTH;
+    }
+
+    if ((properties->LogFileMode & EVENT_TRACE_FILE_MODE_SEQUENTIAL) &&
+        (properties->LogFileMode & EVENT_TRACE_FILE_MODE_CIRCULAR))
+        return ERROR_INVALID_PARAMETER;
+    if (IsEqualGUID( &properties->Wnode.Guid, &SystemTraceControlGuid ))
+    {
+        FIXME("kernel logger not supported\n");
+        return ERROR_INVALID_PARAMETER;
+    }
+    if (!properties->LogFileNameOffset && !(properties->LogFileMode & EVENT_TRACE_REAL_TIME_MODE))
+        return ERROR_BAD_PATHNAME;
+    return ERROR_SUCCESS;
+}
+
 /******************************************************************************
  *     StartTraceA   (sechost.@)
  */
 ULONG WINAPI StartTraceA( TRACEHANDLE *handle, const char *session, EVENT_TRACE_PROPERTIES *properties )
 {
-    FIXME("(%p, %s, %p) stub\n", handle, debugstr_a(session), properties);
-    if (handle) *handle = 0xcafe4242;
-    return ERROR_SUCCESS;
+    EVENT_TRACE_PROPERTIES *propertiesW;
+    const char *file = NULL;
+    ULONG size, ret;
+    WCHAR *sessionW;
+    int file_len = 0;
+
+    TRACE("(%p, %s, %p)\n", handle, debugstr_a(session), properties);
+
+    if ((ret = check_start_properties( handle, session ? strlen( session ) + 1 : 0, properties, sizeof(char) )))
+        return ret;
+
+    if (!(sessionW = strdupAW( session ))) return ERROR_NOT_ENOUGH_MEMORY;
+    if (properties->LogFileNameOffset)
+    {
+        file = (const char *)properties + properties->LogFileNameOffset;
+        file_len = MultiByteToWideChar( CP_ACP, 0, file, -1, NULL, 0 );
+    }
+    size = sizeof(*properties) + (lstrlenW( sessionW ) + 1 + file_len) * sizeof(WCHAR);
+    if (!(propertiesW = heap_alloc( size )))
+    {
+        heap_free( sessionW );
+        return ERROR_NOT_ENOUGH_MEMORY;
+    }
+    *propertiesW = *properties;
+    propertiesW->Wnode.BufferSize = size;
+    propertiesW->LoggerNameOffset = sizeof(*properties);
+    propertiesW->LogFileNameOffset = file ? sizeof(*properties) + (lstrlenW( sessionW ) + 1) * sizeof(WCHAR) : 0;
+    if (file)
+        MultiByteToWideChar( CP_ACP, 0, file, -1, (WCHAR *)((char *)propertiesW + propertiesW->LogFileNameOffset),
+                             file_len );
+
+    if (!(ret = StartTraceW( handle, sessionW, propertiesW )))
+    {
+        EVENT_TRACE_PROPERTIES saved = *properties;
+
+        *properties = *propertiesW;
+        properties->Wnode.BufferSize  = saved.Wnode.BufferSize;
+        properties->LoggerNameOffset  = saved.LoggerNameOffset;
+        properties->LogFileNameOffset = saved.LogFileNameOffset;
+        if (properties->LoggerNameOffset) strcpy( (char *)properties + properties->LoggerNameOffset, session );
+    }
+    heap_free( propertiesW );
+    heap_free( sessionW );
+    return ret;
 }
 
 /******************************************************************************
@@ -101,8 +221,15 @@ ULONG WINAPI StartTraceA( TRACEHANDLE *handle, const char *session, EVENT_TRACE_
  */
 ULONG WINAPI StartTraceW( TRACEHANDLE *handle, const WCHAR *session, EVENT_TRACE_PROPERTIES *properties )
 {
-    FIXME("(%p, %s, %p) stub\n", handle, debugstr_w(session), properties);
-    if (handle) *handle = 0xcafe4242;
+    ULONG ret;
+
+    TRACE("(%p, %s, %p)\n", handle, debugstr_w(session), properties);
+
+    if ((ret = check_start_properties( handle, session ? lstrlenW( session ) + 1 : 0, properties, sizeof(WCHAR) )))
+        return ret;
+
+    if ((ret = __wine_etw_start_trace( handle, session, properties ))) return ret;
+    if (properties->LoggerNameOffset) lstrcpyW( (WCHAR *)((char *)properties + properties->LoggerNameOffset), session );
     return ERROR_SUCCESS;
 }
 
@@ -111,8 +238,9 @@ ULONG WINAPI StartTraceW( TRACEHANDLE *handle, const WCHAR *session, EVENT_TRACE
  */
 ULONG WINAPI StopTraceW( TRACEHANDLE handle, const WCHAR *session, EVENT_TRACE_PROPERTIES *properties )
 {
-    FIXME("(%s, %s, %p) stub\n", wine_dbgstr_longlong(handle), debugstr_w(session), properties);
-    return ERROR_SUCCESS;
+    TRACE("(%s, %s, %p)\n", wine_dbgstr_longlong(handle), debugstr_w(session), properties);
+
+    return ControlTraceW( handle, session, properties, EVENT_TRACE_CONTROL_STOP );
 }
 
 /******************************************************************************
@@ -358,6 +358,8 @@ HWND WINAPI GetActiveWindow(void)
 {
     HWND ret = 0;
 
+    if (get_shared_thread_input( NULL, &ret, NULL )) return ret;
+
     SERVER_START_REQ( get_thread_input )
     {
         req->tid = GetCurrentThreadId();
@@ -375,6 +377,8 @@ HWND WINAPI GetFocus(void)
 {
     HWND ret = 0;
 
+    if (get_shared_thread_input( &ret, NULL, NULL )) return ret;
+
     SERVER_START_REQ( get_thread_input )
     {
         req->tid = GetCurrentThreadId();
@@ -392,6 +396,8 @@ HWND WINAPI GetForegroundWindow(void)
 {
     HWND ret = 0;
 
+    if (get_shared_foreground_window( &ret )) return ret;
+
     SERVER_START_REQ( get_thread_input )
     {
         req->tid = 0;
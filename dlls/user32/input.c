@@ -51,6 +51,223 @@ WINE_DECLARE_DEBUG_CHANNEL(keyboard);
 
 INT global_key_state_counter = 0;
 
+static const shared_object_t *shared_objects;
+static BOOL shared_objects_unavailable;
+
+/* the server updates shared objects with a seqlock, retry reading while an update is in progress */
+#define SHARED_READ_BEGIN( object ) \
+    do { \
+        const shared_object_t *__obj = (object); \
+        UINT __seq; \
+        do { \
+            while ((__seq = __obj->seq) & 1) YieldProcessor(); \
+            MemoryBarrier(); \
+            do
+
+#define SHARED_READ_END \
+            while (0); \
+            MemoryBarrier(); \
+        } while (__obj->seq != __seq); \
+    } while (0)
+
+/***********************************************************************
+ *           map_shared_objects
+ */
+static const shared_object_t *map_shared_objects(void)
+{
+    OBJECT_ATTRIBUTES attr;
+    UNICODE_STRING name;
+    NTSTATUS status;
+    HANDLE section;
+    SIZE_T size = 0;
+    void *ptr = NULL;
+
+    if (shared_objects || shared_objects_unavailable) return shared_objects;
+
+    RtlInitUnicodeString( &name, L"\\KernelObjects\\__wine_shared_objects" );
+    InitializeObjectAttributes( &attr, &name, 0, NULL, NULL );
+    if (!(status = NtOpenSection( &section, SECTION_MAP_READ, &attr )))
+    {
+        status = NtMapViewOfSection( section, GetCurrentProcess(), &ptr, 0, 0, NULL, &size,
+                                     ViewUnmap, 0, PAGE_READONLY );
+        NtClose( section );
+    }
+    if (status)
+    {
+        WARN( "failed to map the shared objects, status %08x\n", status );
+        shared_objects_unavailable = TRUE;
+        return NULL;
+    }
+    if (InterlockedCompareExchangePointer( (void **)&shared_objects, ptr, NULL ))
+        NtUnmapViewOfSection( GetCurrentProcess(), ptr );
+    return shared_objects;
+}
+
+static inline const shared_object_t *get_shared_object( UINT offset )
+{
+    return (const shared_object_t *)((const char *)shared_objects + offset);
+}
+
+/***********************************************************************
+ *           update_thread_shared_objects
+ *
+ * Retrieve the shared objects of the current thread desktop and queue.
+ */
+static void update_thread_shared_objects( struct user_thread_info *thread_info, BOOL create_queue )
+{
+    thread_info->desktop_shm_id = thread_info->queue_shm_id = 0;
+    thread_info->queue_shm_missing = FALSE;
+    if (!map_shared_objects()) return;
+
+    SERVER_START_REQ( get_thread_shared_objects )
+    {
+        req->create_queue = create_queue;
+        if (!wine_server_call( req ))
+        {
+            thread_info->desktop_shm_id      = reply->desktop_id;
+            thread_info->desktop_shm_offset  = reply->desktop_offset;
+            thread_info->queue_shm_id        = reply->queue_id;
+            thread_info->queue_shm_offset    = reply->queue_offset;
+            thread_info->queue_shm_count     = reply->queue_count;
+            thread_info->queue_shm_missing   = !reply->queue_id;
+            thread_info->queue_shm_has_queue = reply->has_queue;
+        }
+    }
+    SERVER_END_REQ;
+}
+
+/***********************************************************************
+ *           get_desktop_shared_object
+ *
+ * Return the shared object of the current thread desktop, and its id which
+ * has to be checked again while reading it.
+ */
+static const shared_object_t *get_desktop_shared_object( UINT *id )
+{
+    struct user_thread_info *thread_info = get_user_thread_info();
+
+    if (!thread_info->desktop_shm_id ||
+        get_shared_object( thread_info->desktop_shm_offset )->id != thread_info->desktop_shm_id)
+        update_thread_shared_objects( thread_info, FALSE );
+    if (!(*id = thread_info->desktop_shm_id)) return NULL;
+    return get_shared_object( thread_info->desktop_shm_offset );
+}
+
+/***********************************************************************
+ *           is_queue_shared_object_missing
+ *
+ * Check whether the queue shared object of the current thread was found
+ * missing, and no message queue was created on its desktop since then.
+ */
+static BOOL is_queue_shared_object_missing( struct user_thread_info *thread_info, BOOL create_queue )
+{
+    const shared_object_t *desktop;
+    BOOL missing = FALSE;
+    UINT id;
+
+    if (!thread_info->queue_shm_missing) return FALSE;
+    if (!(desktop = get_desktop_shared_object( &id ))) return FALSE;
+    /* the desktop lookup may have refreshed the queue state too */
+    if (!thread_info->queue_shm_missing) return FALSE;
+    if (create_queue && !thread_info->queue_shm_has_queue) return FALSE;
+
+    SHARED_READ_BEGIN( desktop )
+    {
+        missing = desktop->id == id && desktop->shm.desktop.queue_count == thread_info->queue_shm_count;
+    }
+    SHARED_READ_END;
+    return missing;
+}
+
+/***********************************************************************
+ *           get_input_shared_object
+ *
+ * Return the shared object of the current thread input, and its id which
+ * has to be checked again while reading it. A thread without a queue, or
+ * whose queue has no shared object, is remembered as such until a queue
+ * gets created on its desktop, so that polling doesn't ask the server
+ * for the object every time.
+ */
+static const shared_object_t *get_input_shared_object( UINT *id, BOOL create_queue )
+{
+    struct user_thread_info *thread_info = get_user_thread_info();
+    const shared_object_t *queue;
+    UINT offset = 0;
+
+    *id = 0;
+    if (!thread_info->queue_shm_id ||
+        get_shared_object( thread_info->queue_shm_offset )->id != thread_info->queue_shm_id)
+    {
+        if (is_queue_shared_object_missing( thread_info, create_queue )) return NULL;
+        update_thread_shared_objects( thread_info, create_queue );
+    }
+    if (!thread_info->queue_shm_id) return NULL;
+
+    queue = get_shared_object( thread_info->queue_shm_offset );
+    SHARED_READ_BEGIN( queue )
+    {
+        *id = queue->id == thread_info->queue_shm_id ? queue->shm.queue.input_id : 0;
+        offset = queue->shm.queue.input_offset;
+    }
+    SHARED_READ_END;
+    return *id ? get_shared_object( offset ) : NULL;
+}
+
+/***********************************************************************
+ *           get_shared_thread_input
+ *
+ * Read the current thread input windows from shared memory.
+ */
+BOOL get_shared_thread_input( HWND *focus, HWND *active, HWND *capture )
+{
+    struct user_thread_info *thread_info = get_user_thread_info();
+    const shared_object_t *input;
+    BOOL valid = FALSE;
+    UINT id;
+
+    if (!(input = get_input_shared_object( &id, FALSE )))
+    {
+        /* a thread without a queue has no input state */
+        if (!thread_info->queue_shm_missing || thread_info->queue_shm_has_queue) return FALSE;
+        if (focus) *focus = 0;
+        if (active) *active = 0;
+        if (capture) *capture = 0;
+        return TRUE;
+    }
+    SHARED_READ_BEGIN( input )
+    {
+        if ((valid = (input->id == id)))
+        {
+            if (focus) *focus = wine_server_ptr_handle( input->shm.input.focus );
+            if (active) *active = wine_server_ptr_handle( input->shm.input.active );
+            if (capture) *capture = wine_server_ptr_handle( input->shm.input.capture );
+        }
+    }
+    SHARED_READ_END;
+    return valid;
+}
+
+/***********************************************************************
+ *           get_shared_foreground_window
+ *
+ * Read the desktop foreground window from shared memory.
+ */
+BOOL get_shared_foreground_window( HWND *foreground )
+{
+    const shared_object_t *desktop;
+    BOOL valid = FALSE;
+    UINT id;
+
+    if (!(desktop = get_desktop_shared_object( &id ))) return FALSE;
+    SHARED_READ_BEGIN( desktop )
+    {
+        if ((valid = (desktop->id == id)))
+            *foreground = wine_server_ptr_handle( desktop->shm.desktop.foreground );
+    }
+    SHARED_READ_END;
+    return valid;
+}
+
 /***********************************************************************
  *           get_key_state
  */
@@ -325,22 +542,40 @@ void WINAPI mouse_event( DWORD dwFlags, DWORD dx, DWORD dy,
  */
 BOOL WINAPI DECLSPEC_HOTPATCH GetCursorPos( POINT *pt )
 {
-    BOOL ret;
+    const shared_object_t *desktop;
+    BOOL ret = FALSE;
     DWORD last_change;
-    UINT dpi;
+    UINT dpi, id;
 
     if (!pt) return FALSE;
 
-    SERVER_START_REQ( set_cursor )
+    if ((desktop = get_desktop_shared_object( &id )))
     {
-        if ((ret = !wine_server_call( req )))
+        SHARED_READ_BEGIN( desktop )
         {
-            pt->x = reply->new_x;
-            pt->y = reply->new_y;
-            last_change = reply->last_change;
+            if ((ret = (desktop->id == id)))
+            {
+                pt->x = desktop->shm.desktop.cursor.x;
+                pt->y = desktop->shm.desktop.cursor.y;
+                last_change = desktop->shm.desktop.cursor.last_change;
+            }
         }
+        SHARED_READ_END;
+    }
+
+    if (!ret)
+    {
+        SERVER_START_REQ( set_cursor )
+        {
+            if ((ret = !wine_server_call( req )))
+            {
+                pt->x = reply->new_x;
+                pt->y = reply->new_y;
+                last_change = reply->last_change;
+            }
+        }
+        SERVER_END_REQ;
     }
-    SERVER_END_REQ;
 
     /* query new position from graphics driver if we haven't updated recently */
     if (ret && GetTickCount() - last_change > 100) ret = USER_Driver->pGetCursorPos( pt );
@@ -443,6 +678,8 @@ HWND WINAPI GetCapture(void)
 {
     HWND ret = 0;
 
+    if (get_shared_thread_input( NULL, NULL, &ret )) return ret;
+
     SERVER_START_REQ( get_thread_input )
     {
         req->tid = GetCurrentThreadId();
@@ -470,13 +707,29 @@ SHORT WINAPI DECLSPEC_HOTPATCH GetAsyncKeyState( INT key )
 {
     struct user_key_state_info *key_state_info = get_user_thread_info()->key_state;
     INT counter = global_key_state_counter;
-    BYTE prev_key_state;
+    const shared_object_t *desktop;
+    BYTE prev_key_state, state = 0;
+    BOOL valid = FALSE;
     SHORT ret;
+    UINT id;
 
     if (key < 0 || key >= 256) return 0;
 
     check_for_events( QS_INPUT );
 
+    if ((desktop = get_desktop_shared_object( &id )))
+    {
+        SHARED_READ_BEGIN( desktop )
+        {
+            valid = (desktop->id == id);
+            state = desktop->shm.desktop.keystate[key];
+        }
+        SHARED_READ_END;
+
+        /* the server has to clear the pressed since last call bit */
+        if (valid && !(state & 0x40)) return (state & 0x80) ? 0x8000 : 0;
+    }
+
     if (key_state_info && !(key_state_info->state[key] & 0xc0) &&
         key_state_info->counter == counter && GetTickCount() - key_state_info->time < 50)
     {
@@ -625,8 +878,46 @@ BOOL WINAPI AttachThreadInput( DWORD from, DWORD to, BOOL attach )
  */
 SHORT WINAPI DECLSPEC_HOTPATCH GetKeyState(INT vkey)
 {
+    const shared_object_t *input, *desktop;
+    BYTE desktop_keystate[256], synced_keystate[256];
+    BOOL valid = FALSE, locked = FALSE;
+    UINT input_id, desktop_id, input_desktop_id = 0;
     SHORT retval = 0;
 
+    if (vkey >= 0 && (input = get_input_shared_object( &input_id, TRUE )) &&
+        (desktop = get_desktop_shared_object( &desktop_id )))
+    {
+        SHARED_READ_BEGIN( input )
+        {
+            valid = (input->id == input_id);
+            input_desktop_id = input->shm.input.desktop_id;
+            locked = input->shm.input.keystate_lock;
+            retval = (signed char)(input->shm.input.keystate[vkey & 0xff] & 0x81);
+            memcpy( synced_keystate, (const void *)input->shm.input.desktop_keystate, sizeof(synced_keystate) );
+        }
+        SHARED_READ_END;
+
+        if (valid && input_desktop_id == desktop_id && !locked)
+        {
+            SHARED_READ_BEGIN( desktop )
+            {
+                valid = (desktop->id == desktop_id);
+                memcpy( desktop_keystate, (const void *)desktop->shm.desktop.keystate, sizeof(desktop_keystate) );
+            }
+            SHARED_READ_END;
+
+            /* the server has to synchronize the thread key state with the desktop */
+            valid = valid && !memcmp( desktop_keystate, synced_keystate, sizeof(desktop_keystate) );
+        }
+
+        if (valid && input_desktop_id == desktop_id)
+        {
+            TRACE("key (0x%x) -> %x\n", vkey, retval);
+            return retval;
+        }
+        retval = 0;
+    }
+
     SERVER_START_REQ( get_key_state )
     {
         req->key = vkey;
@@ -643,11 +934,28 @@ SHORT WINAPI DECLSPEC_HOTPATCH GetKeyState(INT vkey)
  */
 BOOL WINAPI DECLSPEC_HOTPATCH GetKeyboardState( LPBYTE state )
 {
-    BOOL ret;
-    UINT i;
+    const shared_object_t *input;
+    BOOL ret, valid = FALSE;
+    UINT i, id;
 
     TRACE("(%p)\n", state);
 
+    if ((input = get_input_shared_object( &id, TRUE )))
+    {
+        SHARED_READ_BEGIN( input )
+        {
+            valid = (input->id == id);
+            memcpy( state, (const void *)input->shm.input.keystate, 256 );
+        }
+        SHARED_READ_END;
+
+        if (valid)
+        {
+            for (i = 0; i < 256; i++) state[i] &= 0x81;
+            return TRUE;
+        }
+    }
+
     memset( state, 0, 256 );
     SERVER_START_REQ( get_key_state )
     {
@@ -55,6 +55,7 @@
 #include "wingdi.h"
 #include "winnls.h"
 #include "winreg.h"
+#include "winternl.h"
 #include "ddk/hidsdi.h"
 
 #include "wine/test.h"
@@ -89,6 +90,7 @@ static UINT (WINAPI *pGetRawInputDeviceInfoW) (HANDLE, UINT, void *, UINT *);
 static UINT (WINAPI *pGetRawInputDeviceInfoA) (HANDLE, UINT, void *, UINT *);
 static int  (WINAPI *pGetWindowRgnBox)(HWND, LPRECT);
 static BOOL (WINAPI *pIsWow64Process)(HANDLE, PBOOL);
+static NTSTATUS (WINAPI *pNtQueryInformationProcess)(HANDLE, PROCESSINFOCLASS, void *, ULONG, ULONG *);
 
 #define MAXKEYEVENTS 12
 #define MAXKEYMESSAGES MAXKEYEVENTS /* assuming a key event generates one
@@ -171,6 +173,9 @@ static void init_function_pointers(void)
 
     hdll = GetModuleHandleA("kernel32");
     GET_PROC(IsWow64Process);
+
+    hdll = GetModuleHandleA("ntdll");
+    GET_PROC(NtQueryInformationProcess);
 #undef GET_PROC
 
     if (!pIsWow64Process || !pIsWow64Process( GetCurrentProcess(), &is_wow64 ))
@@ -4780,6 +4785,140 @@ static void test_GetKeyboardLayoutList(void)
     }
 }
 
+/* number of wineserver requests made by this process so far, or -1 when not running on Wine */
+static LONG get_server_call_count(void)
+{
+    ULONG count;
+
+    if (!pNtQueryInformationProcess ||
+        pNtQueryInformationProcess(GetCurrentProcess(), 1001 /* ProcessWineServerCallCount */,
+                                   &count, sizeof(count), NULL))
+        return -1;
+    return count;
+}
+
+static DWORD WINAPI input_state_polling_thread(void *arg)
+{
+    LONG calls;
+    int i;
+
+    /* this thread has no message queue, so it has no input state either */
+    calls = get_server_call_count();
+    for (i = 0; i < 100; i++)
+    {
+        ok(GetFocus() == NULL, "GetFocus returned %p\n", GetFocus());
+        ok(GetActiveWindow() == NULL, "GetActiveWindow returned %p\n", GetActiveWindow());
+        ok(GetCapture() == NULL, "GetCapture returned %p\n", GetCapture());
+    }
+    if (calls != -1)
+    {
+        calls = get_server_call_count() - calls;
+        ok(calls < 10, "%d server calls for 600 queries without a queue\n", calls);
+    }
+    return 0;
+}
+
+/* the input state queries a game makes once per frame */
+static HWND poll_input_state(void)
+{
+    POINT pt;
+    int key;
+
+    GetCursorPos(&pt);
+    for (key = 'A'; key <= 'Z'; key++) GetAsyncKeyState(key);
+    GetAsyncKeyState(VK_LBUTTON);
+    GetAsyncKeyState(VK_RBUTTON);
+    GetKeyState(VK_SHIFT);
+    GetKeyState(VK_CONTROL);
+    GetForegroundWindow();
+    GetActiveWindow();
+    GetCapture();
+    return GetFocus();
+}
+
+static void test_input_state_polling(void)
+{
+    const int frames = winetest_interactive ? 2000 : 200, queries = 35;
+    LARGE_INTEGER freq, start, end;
+    BYTE keystate[256], state[256];
+    GUITHREADINFO info;
+    int i, key;
+    HWND hwnd, focus;
+    HANDLE thread;
+    LONG calls;
+    POINT pt;
+    BOOL ret;
+
+    hwnd = CreateWindowA("static", "Title", WS_OVERLAPPEDWINDOW | WS_VISIBLE,
+                         10, 10, 200, 200, NULL, NULL, NULL, NULL);
+    ok(hwnd != NULL, "CreateWindowA failed %u\n", GetLastError());
+    SetForegroundWindow(hwnd);
+    SetFocus(hwnd);
+    empty_message_queue();
+
+    ok(GetFocus() == hwnd, "GetFocus returned %p\n", GetFocus());
+    ok(GetActiveWindow() == hwnd, "GetActiveWindow returned %p\n", GetActiveWindow());
+    /* GetGUIThreadInfo always asks the server */
+    memset(&info, 0, sizeof(info));
+    info.cbSize = sizeof(info);
+    ret = GetGUIThreadInfo(0, &info);
+    ok(ret, "GetGUIThreadInfo failed %u\n", GetLastError());
+    ok(GetForegroundWindow() == info.hwndActive, "GetForegroundWindow returned %p, expected %p\n",
+       GetForegroundWindow(), info.hwndActive);
+
+    SetCapture(hwnd);
+    ok(GetCapture() == hwnd, "GetCapture returned %p\n", GetCapture());
+    ReleaseCapture();
+    ok(GetCapture() == NULL, "GetCapture returned %p\n", GetCapture());
+    empty_message_queue();
+
+    SetCursorPos(100, 110);
+    ret = GetCursorPos(&pt);
+    ok(ret, "GetCursorPos failed %u\n", GetLastError());
+    ok(pt.x == 100 && pt.y == 110, "got cursor position (%d,%d)\n", pt.x, pt.y);
+
+    /* the thread key state is visible right after changing it */
+    GetKeyboardState(keystate);
+    memset(state, 0, sizeof(state));
+    state['C'] = 0x81;
+    SetKeyboardState(state);
+    ok((GetKeyState('C') & 0xffff) == 0xff81, "GetKeyState returned %#x\n", GetKeyState('C'));
+    memset(state, 0xcc, sizeof(state));
+    GetKeyboardState(state);
+    ok(state['C'] == 0x81, "got C key state %#x\n", state['C']);
+    for (key = 0; key < 256; key++)
+        if ((BYTE)GetKeyState(key) != (state[key] & 0x81)) break;
+    ok(key == 256, "GetKeyState and GetKeyboardState differ for key %#x\n", key);
+    SetKeyboardState(keystate);
+    ok(!(GetKeyState('C') & 0x8000), "GetKeyState returned %#x\n", GetKeyState('C'));
+
+    /* poll the input state once per frame, like games do; the first frame
+     * may have to clear the pressed since last call key state bits and fetch
+     * the shared objects, after that everything is read from shared memory */
+    focus = poll_input_state();
+    ok(focus == hwnd, "GetFocus returned %p\n", focus);
+    QueryPerformanceFrequency(&freq);
+    calls = get_server_call_count();
+    QueryPerformanceCounter(&start);
+    for (i = 0; i < frames; i++)
+        if ((focus = poll_input_state()) != hwnd) break;
+    QueryPerformanceCounter(&end);
+    if (calls != -1) calls = get_server_call_count() - calls;
+    ok(i == frames, "focus changed to %p after %d frames\n", focus, i);
+    if (winetest_interactive)
+        trace("%d frames, %d input state queries per frame: %.2f us per frame\n", frames, queries,
+              (end.QuadPart - start.QuadPart) * 1000000.0 / freq.QuadPart / frames);
+    if (calls != -1) ok(calls < 10, "%d server calls for %d frames\n", calls, frames);
+
+    thread = CreateThread(NULL, 0, input_state_polling_thread, NULL, 0, NULL);
+    ok(thread != NULL, "CreateThread failed %u\n", GetLastError());
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+
+    DestroyWindow(hwnd);
+    empty_message_queue();
+}
+
 START_TEST(input)
 {
     char **argv;
@@ -4817,6 +4956,7 @@ START_TEST(input)
     test_key_names();
     test_attach_input();
     test_GetKeyState();
+    test_input_state_polling();
     test_OemKeyScan();
     test_GetRawInputData();
     test_GetRawInputBuffer();
@@ -10856,6 +10856,81 @@ static void test_LockWindowUpdate(HWND parent)
     DestroyWindow(child);
 }
 
+static void test_surface_partial_update(void)
+{
+    static const COLORREF caret_color = RGB(0xff, 0, 0), bar_color = RGB(0, 0, 0xff);
+    const int frames = winetest_interactive ? 500 : 50;
+    COLORREF color;
+    HDC hdc, hdc_screen;
+    HBRUSH caret, bar;
+    LARGE_INTEGER freq, start, end;
+    POINT pt;
+    RECT rc;
+    MSG msg;
+    HWND hwnd;
+    int i;
+
+    hwnd = CreateWindowExA(WS_EX_TOPMOST, "static", NULL, WS_POPUP | WS_VISIBLE,
+                           100, 100, 400, 300, 0, 0, GetModuleHandleA(NULL), NULL);
+    ok(hwnd != NULL, "CreateWindowEx failed, error %u\n", GetLastError());
+    UpdateWindow(hwnd);
+    flush_events(TRUE);
+
+    pt.x = 150;
+    pt.y = 150;
+    if (WindowFromPoint(pt) != hwnd)
+    {
+        skip("window is not visible on screen\n");
+        DestroyWindow(hwnd);
+        return;
+    }
+
+    hdc = GetDC(hwnd);
+    hdc_screen = GetDC(0);
+    caret = CreateSolidBrush(caret_color);
+    bar = CreateSolidBrush(bar_color);
+    GetClientRect(hwnd, &rc);
+    FillRect(hdc, &rc, GetStockObject(WHITE_BRUSH));
+    flush_events(TRUE);
+
+    /* a blinking caret in one corner and a progress bar in the other one */
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&start);
+    for (i = 0; i < frames; i++)
+    {
+        SetRect(&rc, 4, 4, 6, 20);
+        FillRect(hdc, &rc, (i & 1) ? GetStockObject(WHITE_BRUSH) : caret);
+        SetRect(&rc, 200 + i * 190 / frames, 280, 201 + (i + 1) * 190 / frames, 296);
+        FillRect(hdc, &rc, bar);
+        while (PeekMessageA(&msg, 0, 0, 0, PM_REMOVE)) DispatchMessageA(&msg);
+    }
+    QueryPerformanceCounter(&end);
+    if (winetest_interactive)
+        trace("%d partial updates: %.2f us per frame\n", frames,
+              (end.QuadPart - start.QuadPart) * 1000000.0 / freq.QuadPart / frames);
+
+    SetRect(&rc, 4, 4, 6, 20);
+    FillRect(hdc, &rc, caret);
+    flush_events(TRUE);
+
+    color = GetPixel(hdc_screen, 105, 110);
+    ok(color == caret_color, "got caret color %08x\n", color);
+    color = GetPixel(hdc_screen, 300, 385);
+    ok(color == bar_color, "got bar color %08x\n", color);
+    color = GetPixel(hdc_screen, 399, 385);
+    ok(color == bar_color, "got bar color %08x\n", color);
+    color = GetPixel(hdc_screen, 250, 250);
+    ok(color == RGB(0xff, 0xff, 0xff), "got background color %08x\n", color);
+    color = GetPixel(hdc_screen, 495, 385);
+    ok(color == RGB(0xff, 0xff, 0xff), "got background color %08x\n", color);
+
+    DeleteObject(caret);
+    DeleteObject(bar);
+    ReleaseDC(0, hdc_screen);
+    ReleaseDC(hwnd, hdc);
+    DestroyWindow(hwnd);
+}
+
 static void test_hide_window(void)
 {
     HWND hwnd, hwnd2, hwnd3;
@@ -12556,6 +12631,7 @@ START_TEST(win)
     test_desktop();
     test_display_affinity(hwndMain);
     test_hide_window();
+    test_surface_partial_update();
     test_minimize_window(hwndMain);
     test_destroy_quit();
     test_IsWindowEnabled();
@@ -203,6 +203,13 @@ struct user_thread_info
     HWND                          top_window;             /* Desktop window */
     HWND                          msg_window;             /* HWND_MESSAGE parent window */
     struct rawinput_thread_data  *rawinput;               /* RawInput thread local data / buffer */
+    UINT                          desktop_shm_id;         /* Id of the desktop shared object */
+    UINT                          desktop_shm_offset;     /* Offset of the desktop shared object */
+    UINT                          queue_shm_id;           /* Id of the queue shared object */
+    UINT                          queue_shm_offset;       /* Offset of the queue shared object */
+    UINT                          queue_shm_count;        /* Desktop queue count when the queue object was missing */
+    BYTE                          queue_shm_missing;      /* The queue shared object was found missing */
+    BYTE                          queue_shm_has_queue;    /* The thread had a queue when its object was missing */
 };
 
 C_ASSERT( sizeof(struct user_thread_info) <= sizeof(((TEB *)0)->Win32ClientInfo) );
@@ -273,6 +280,8 @@ extern RECT get_virtual_screen_rect(void) DECLSPEC_HIDDEN;
 extern RECT get_primary_monitor_rect(void) DECLSPEC_HIDDEN;
 extern LRESULT call_current_hook( HHOOK hhook, INT code, WPARAM wparam, LPARAM lparam ) DECLSPEC_HIDDEN;
 extern DWORD get_input_codepage( void ) DECLSPEC_HIDDEN;
+extern BOOL get_shared_thread_input( HWND *focus, HWND *active, HWND *capture ) DECLSPEC_HIDDEN;
+extern BOOL get_shared_foreground_window( HWND *foreground ) DECLSPEC_HIDDEN;
 extern BOOL map_wparam_AtoW( UINT message, WPARAM *wparam, enum wm_char_mapping mapping ) DECLSPEC_HIDDEN;
 extern NTSTATUS send_hardware_message( HWND hwnd, const INPUT *input, const RAWINPUT *rawinput, UINT flags ) DECLSPEC_HIDDEN;
 extern LRESULT MSG_SendInternalMessageTimeout( DWORD dest_pid, DWORD dest_tid,
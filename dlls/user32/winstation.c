@@ -322,6 +322,8 @@ BOOL WINAPI SetThreadDesktop( HDESK handle )
         struct user_key_state_info *key_state_info = thread_info->key_state;
         thread_info->top_window = 0;
         thread_info->msg_window = 0;
+        thread_info->desktop_shm_id = 0;
+        thread_info->queue_shm_missing = FALSE;
         if (key_state_info) key_state_info->time = 0;
     }
     return ret;
@@ -23,6 +23,7 @@
 #endif
 
 #include <assert.h>
+#include <pthread.h>
 
 #include "ntgdi_private.h"
 #include "dibdrv.h"
@@ -585,17 +586,285 @@ static void mask_rect( dib_info *dst, const RECT *dst_rect, const dib_info *src,
     }
 }
 
+/* band rendering
+ *
+ * Large operations can optionally be split into horizontal bands that are
+ * processed in parallel by a pool of worker threads.  Each band only touches
+ * its own destination rows, so the result is identical to the serial path.
+ * The workers are plain host threads without a TEB, so they must only run
+ * pixel primitives that don't call back into Wine, not even for debug output.
+ * Formats handled by funcs_null print a FIXME, so they are always rendered by
+ * the calling thread, and the destination is written once by the calling
+ * thread first so that any page fault that Wine has to handle, such as a write
+ * watch, happens there.
+ *
+ * It is enabled by setting HKCU\Software\Wine\Gdi\RenderThreads to the
+ * number of threads to use.
+ */
+
+#define MAX_BAND_THREADS    16
+#define MIN_BAND_PIXELS     (256 * 256)  /* don't bother splitting smaller operations */
+#define MIN_BAND_HEIGHT     16
+
+struct band_job
+{
+    void (*func)( void *ctx, unsigned int band );
+    void        *ctx;
+    unsigned int count;  /* number of bands */
+    LONG         next;   /* next band to process */
+    LONG         done;   /* number of bands processed */
+    unsigned int users;  /* number of worker threads using the job */
+};
+
+static unsigned int band_thread_count = 1;
+static pthread_once_t band_init_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t band_run_lock = PTHREAD_MUTEX_INITIALIZER;  /* held while a job is running */
+static pthread_mutex_t band_lock = PTHREAD_MUTEX_INITIALIZER;      /* protects the fields below */
+static pthread_cond_t band_start_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t band_done_cond = PTHREAD_COND_INITIALIZER;
+static struct band_job *band_job;
+static unsigned int band_generation;
+
+static void run_band_job( struct band_job *job )
+{
+    LONG band;
+
+    while ((band = InterlockedIncrement( &job->next ) - 1) < (LONG)job->count)
+    {
+        job->func( job->ctx, band );
+        if (InterlockedIncrement( &job->done ) == job->count)
+        {
+            pthread_mutex_lock( &band_lock );
+            pthread_cond_broadcast( &band_done_cond );
+            pthread_mutex_unlock( &band_lock );
+        }
+    }
+}
+
+static void *band_thread( void *arg )
+{
+    unsigned int generation = 0;
+    struct band_job *job;
+
+    pthread_mutex_lock( &band_lock );
+    for (;;)
+    {
+        while (generation == band_generation) pthread_cond_wait( &band_start_cond, &band_lock );
+        generation = band_generation;
+        if (!(job = band_job)) continue;
+        job->users++;
+        pthread_mutex_unlock( &band_lock );
+
+        run_band_job( job );
+
+        pthread_mutex_lock( &band_lock );
+        if (!--job->users) pthread_cond_broadcast( &band_done_cond );
+    }
+    return NULL;
+}
+
+static void init_band_threads(void)
+{
+    char value_buffer[FIELD_OFFSET(KEY_VALUE_PARTIAL_INFORMATION, Data[sizeof(DWORD)])];
+    KEY_VALUE_PARTIAL_INFORMATION *info = (void *)value_buffer;
+    unsigned int i, count = 1;
+    pthread_attr_t attr;
+    pthread_t thread;
+    HKEY hkey;
+
+    if ((hkey = reg_open_hkcu_key( "Software\\Wine\\Gdi" )))
+    {
+        if (query_reg_ascii_value( hkey, "RenderThreads", info, sizeof(value_buffer) ) &&
+            info->Type == REG_DWORD)
+            count = min( max( *(DWORD *)info->Data, 1 ), MAX_BAND_THREADS );
+        NtClose( hkey );
+    }
+
+    pthread_attr_init( &attr );
+    pthread_attr_setdetachstate( &attr, PTHREAD_CREATE_DETACHED );
+    for (i = 1; i < count; i++)
+    {
+        if (pthread_create( &thread, &attr, band_thread, NULL )) break;
+        band_thread_count++;
+    }
+    pthread_attr_destroy( &attr );
+    if (band_thread_count > 1) TRACE( "using %u threads\n", band_thread_count );
+}
+
+/* return the number of bands to split an operation into, 1 to run it serially */
+static unsigned int get_band_count( const dib_info *dst, const dib_info *src, int width, int height )
+{
+    unsigned int count;
+
+    if (dst->funcs == &funcs_null || (src && src->funcs == &funcs_null)) return 1;
+    if (width <= 0 || height < 2 * MIN_BAND_HEIGHT) return 1;
+    if ((ULONGLONG)width * height < MIN_BAND_PIXELS) return 1;
+    pthread_once( &band_init_once, init_band_threads );
+    count = min( band_thread_count, height / MIN_BAND_HEIGHT );
+    return max( count, 1 );
+}
+
+/* touch every page of the destination rows without changing them */
+static void prefault_dib( const dib_info *dib )
+{
+    char *start = (char *)dib->bits.ptr + dib->rect.top * dib->stride;
+    char *end = (char *)dib->bits.ptr + (dib->rect.bottom - 1) * dib->stride;
+    char *ptr;
+
+    if (dib->rect.bottom <= dib->rect.top) return;
+    if (start > end)
+    {
+        ptr = start;
+        start = end;
+        end = ptr;
+    }
+    end += abs( dib->stride );
+
+    start = (char *)((UINT_PTR)start & ~3);
+    for (ptr = start; ptr < end; ptr = (char *)(((UINT_PTR)ptr + 0x1000) & ~0xfff))
+        InterlockedExchangeAdd( (LONG *)ptr, 0 );
+}
+
+/* run func for each band, using the worker threads and the current thread */
+static void run_in_bands( const dib_info *dst, void (*func)( void *ctx, unsigned int band ),
+                          void *ctx, unsigned int count )
+{
+    struct band_job job;
+    unsigned int i;
+
+    /* only one job at a time, other threads simply render serially */
+    if (count <= 1 || pthread_mutex_trylock( &band_run_lock ))
+    {
+        for (i = 0; i < count; i++) func( ctx, i );
+        return;
+    }
+
+    prefault_dib( dst );
+
+    job.func  = func;
+    job.ctx   = ctx;
+    job.count = count;
+    job.next  = 0;
+    job.done  = 0;
+    job.users = 0;
+
+    pthread_mutex_lock( &band_lock );
+    band_job = &job;
+    band_generation++;
+    pthread_cond_broadcast( &band_start_cond );
+    pthread_mutex_unlock( &band_lock );
+
+    run_band_job( &job );
+
+    pthread_mutex_lock( &band_lock );
+    while (job.done < count || job.users) pthread_cond_wait( &band_done_cond, &band_lock );
+    band_job = NULL;
+    pthread_mutex_unlock( &band_lock );
+
+    pthread_mutex_unlock( &band_run_lock );
+}
+
+/* intersect a rectangle with the rows of a band */
+static BOOL get_band_rect( RECT *dst, const RECT *rect, const RECT *bounds,
+                           unsigned int band, unsigned int count )
+{
+    int height = bounds->bottom - bounds->top;
+
+    *dst = *rect;
+    dst->top    = max( rect->top, bounds->top + (int)((LONGLONG)height * band / count) );
+    dst->bottom = min( rect->bottom, bounds->top + (int)((LONGLONG)height * (band + 1) / count) );
+    return dst->top < dst->bottom;
+}
+
+static void get_rects_bounds( RECT *bounds, const RECT *rects, int count )
+{
+    int i;
+
+    *bounds = rects[0];
+    for (i = 1; i < count; i++)
+    {
+        bounds->left   = min( bounds->left, rects[i].left );
+        bounds->top    = min( bounds->top, rects[i].top );
+        bounds->right  = max( bounds->right, rects[i].right );
+        bounds->bottom = max( bounds->bottom, rects[i].bottom );
+    }
+}
+
+struct blend_band_ctx
+{
+    const dib_info        *dst;
+    const dib_info        *src;
+    const struct clipped_rects *rects;
+    RECT                   bounds;
+    POINT                  offset;
+    BLENDFUNCTION          blend;
+    unsigned int           count;
+};
+
+static void blend_band( void *arg, unsigned int band )
+{
+    struct blend_band_ctx *ctx = arg;
+    RECT rect;
+    int i;
+
+    for (i = 0; i < ctx->rects->count; i++)
+        if (get_band_rect( &rect, &ctx->rects->rects[i], &ctx->bounds, band, ctx->count ))
+            ctx->dst->funcs->blend_rects( ctx->dst, 1, &rect, ctx->src, &ctx->offset, ctx->blend );
+}
+
+struct gradient_band_ctx
+{
+    const dib_info        *dib;
+    const struct clipped_rects *rects;
+    const TRIVERTEX       *v;
+    int                    mode;
+    RECT                   bounds;
+    unsigned int           count;
+    LONG                   failed;
+};
+
+static void gradient_band( void *arg, unsigned int band )
+{
+    struct gradient_band_ctx *ctx = arg;
+    RECT rect;
+    int i;
+
+    for (i = 0; i < ctx->rects->count; i++)
+    {
+        if (!get_band_rect( &rect, &ctx->rects->rects[i], &ctx->bounds, band, ctx->count )) continue;
+        if (!ctx->dib->funcs->gradient_rect( ctx->dib, &rect, ctx->v, ctx->mode ))
+        {
+            InterlockedExchange( &ctx->failed, 1 );
+            break;
+        }
+    }
+}
+
 static DWORD blend_rect( dib_info *dst, const RECT *dst_rect, const dib_info *src, const RECT *src_rect,
                          HRGN clip, BLENDFUNCTION blend )
 {
     POINT offset;
     struct clipped_rects clipped_rects;
+    struct blend_band_ctx ctx;
 
     if (!get_clipped_rects( dst, dst_rect, clip, &clipped_rects )) return ERROR_SUCCESS;
 
     offset.x = src_rect->left - dst_rect->left;
     offset.y = src_rect->top  - dst_rect->top;
-    dst->funcs->blend_rects( dst, clipped_rects.count, clipped_rects.rects, src, &offset, blend );
+
+    get_rects_bounds( &ctx.bounds, clipped_rects.rects, clipped_rects.count );
+    ctx.count = get_band_count( dst, src, ctx.bounds.right - ctx.bounds.left,
+                                ctx.bounds.bottom - ctx.bounds.top );
+    if (ctx.count > 1)
+    {
+        ctx.dst    = dst;
+        ctx.src    = src;
+        ctx.rects  = &clipped_rects;
+        ctx.offset = offset;
+        ctx.blend  = blend;
+        run_in_bands( dst, blend_band, &ctx, ctx.count );
+    }
+    else dst->funcs->blend_rects( dst, clipped_rects.count, clipped_rects.rects, src, &offset, blend );
 
     free_clipped_rects( &clipped_rects );
     return ERROR_SUCCESS;
@@ -684,12 +953,30 @@ static BOOL gradient_rect( dib_info *dib, TRIVERTEX *v, int mode, HRGN clip, con
 {
     int i;
     struct clipped_rects clipped_rects;
+    struct gradient_band_ctx ctx;
     BOOL ret = TRUE;
 
     if (!get_clipped_rects( dib, bounds, clip, &clipped_rects )) return TRUE;
-    for (i = 0; i < clipped_rects.count; i++)
+
+    get_rects_bounds( &ctx.bounds, clipped_rects.rects, clipped_rects.count );
+    ctx.count = get_band_count( dib, NULL, ctx.bounds.right - ctx.bounds.left,
+                                ctx.bounds.bottom - ctx.bounds.top );
+    if (ctx.count > 1)
+    {
+        ctx.dib    = dib;
+        ctx.rects  = &clipped_rects;
+        ctx.v      = v;
+        ctx.mode   = mode;
+        ctx.failed = 0;
+        run_in_bands( dib, gradient_band, &ctx, ctx.count );
+        ret = !ctx.failed;
+    }
+    else
     {
-        if (!(ret = dib->funcs->gradient_rect( dib, &clipped_rects.rects[i], v, mode ))) break;
+        for (i = 0; i < clipped_rects.count; i++)
+        {
+            if (!(ret = dib->funcs->gradient_rect( dib, &clipped_rects.rects[i], v, mode ))) break;
+        }
     }
     free_clipped_rects( &clipped_rects );
     return ret;
@@ -1198,6 +1485,140 @@ static DWORD calc_1d_stretch_params( INT dst_start, INT dst_length, INT dst_vis_
 }
 
 
+struct stretch_band
+{
+    POINT        dst_start;
+    POINT        src_start;
+    int          err;
+    unsigned int length;
+};
+
+struct stretch_band_ctx
+{
+    dib_info             *dst_dib;
+    const dib_info       *src_dib;
+    const struct stretch_params *h_params;
+    const struct stretch_params *v_params;
+    void (* row_fn)(const dib_info *dst_dib, const POINT *dst_start,
+                    const dib_info *src_dib, const POINT *src_start,
+                    const struct stretch_params *params, int mode, BOOL keep_dst);
+    int                   mode;
+    int                   row_width;
+    BOOL                  vstretch;
+    struct stretch_band  *bands;
+};
+
+/* stretch the rows of a band, starting with a full row */
+static void stretch_band( void *arg, unsigned int index )
+{
+    struct stretch_band_ctx *ctx = arg;
+    const struct stretch_params *v_params = ctx->v_params;
+    struct stretch_band *band = &ctx->bands[index];
+    POINT dst_start = band->dst_start, src_start = band->src_start;
+    unsigned int length = band->length;
+    int err = band->err;
+
+    if (ctx->vstretch)
+    {
+        BOOL need_row = TRUE;
+        RECT last_row, this_row;
+        last_row.left = 0;
+        last_row.right = ctx->row_width;
+
+        while (length--)
+        {
+            if (need_row)
+            {
+                ctx->row_fn( ctx->dst_dib, &dst_start, ctx->src_dib, &src_start, ctx->h_params, ctx->mode, FALSE );
+                need_row = FALSE;
+            }
+            else
+            {
+                last_row.top = dst_start.y - v_params->dst_inc;
+                last_row.bottom = last_row.top + 1;
+                this_row = last_row;
+                offset_rect( &this_row, 0, v_params->dst_inc );
+                copy_rect( ctx->dst_dib, &this_row, ctx->dst_dib, &last_row, NULL, R2_COPYPEN );
+            }
+
+            if (err > 0)
+            {
+                src_start.y += v_params->src_inc;
+                need_row = TRUE;
+                err += v_params->err_add_1;
+            }
+            else err += v_params->err_add_2;
+            dst_start.y += v_params->dst_inc;
+        }
+    }
+    else
+    {
+        int merged_rows = 0;
+
+        while (length--)
+        {
+            if (ctx->mode != STRETCH_DELETESCANS || !merged_rows)
+                ctx->row_fn( ctx->dst_dib, &dst_start, ctx->src_dib, &src_start, ctx->h_params,
+                             ctx->mode, merged_rows != 0 );
+            merged_rows++;
+
+            if (err > 0)
+            {
+                dst_start.y += v_params->dst_inc;
+                merged_rows = 0;
+                err += v_params->err_add_1;
+            }
+            else err += v_params->err_add_2;
+            src_start.y += v_params->src_inc;
+        }
+    }
+}
+
+/* split the vertical stretch into bands that start on a new destination row */
+static unsigned int get_stretch_bands( struct stretch_band *bands, unsigned int count,
+                                       const struct stretch_params *v_params, BOOL vstretch,
+                                       POINT dst_start, POINT src_start )
+{
+    unsigned int i, n = 0, start = 0;
+    BOOL new_row = TRUE;
+    int err = v_params->err_start;
+
+    for (i = 0; i < v_params->length; i++)
+    {
+        if (new_row && i >= (ULONGLONG)v_params->length * n / count)
+        {
+            if (n) bands[n - 1].length = i - start;
+            bands[n].dst_start = dst_start;
+            bands[n].src_start = src_start;
+            bands[n].err = err;
+            start = i;
+            if (++n == count) break;
+        }
+        if (vstretch)
+        {
+            if (err > 0)
+            {
+                src_start.y += v_params->src_inc;
+                err += v_params->err_add_1;
+            }
+            else err += v_params->err_add_2;
+            dst_start.y += v_params->dst_inc;
+        }
+        else
+        {
+            if ((new_row = err > 0))
+            {
+                dst_start.y += v_params->dst_inc;
+                err += v_params->err_add_1;
+            }
+            else err += v_params->err_add_2;
+            src_start.y += v_params->src_inc;
+        }
+    }
+    bands[n - 1].length = v_params->length - start;
+    return n;
+}
+
 DWORD stretch_bitmapinfo( const BITMAPINFO *src_info, void *src_bits, struct bitblt_coords *src,
                           const BITMAPINFO *dst_info, void *dst_bits, struct bitblt_coords *dst,
                           INT mode )
@@ -1207,11 +1628,10 @@ DWORD stretch_bitmapinfo( const BITMAPINFO *src_info, void *src_bits, struct bit
     RECT rect;
     BOOL hstretch, vstretch;
     struct stretch_params v_params, h_params;
-    int err;
+    struct stretch_band_ctx ctx;
+    struct stretch_band band, *bands = NULL;
+    unsigned int count;
     DWORD ret;
-    void (* row_fn)(const dib_info *dst_dib, const POINT *dst_start,
-                    const dib_info *src_dib, const POINT *src_start,
-                    const struct stretch_params *params, int mode, BOOL keep_dst);
 
     TRACE("dst %d, %d - %d x %d visrect %s src %d, %d - %d x %d visrect %s\n",
           dst->x, dst->y, dst->width, dst->height, wine_dbgstr_rect(&dst->visrect),
@@ -1251,63 +1671,32 @@ DWORD stretch_bitmapinfo( const BITMAPINFO *src_info, void *src_bits, struct bit
     dst_start.x -= dst->visrect.left;
     dst_start.y -= dst->visrect.top;
 
-    err = v_params.err_start;
-
-    row_fn = hstretch ? dst_dib.funcs->stretch_row : dst_dib.funcs->shrink_row;
-
-    if (vstretch)
+    ctx.dst_dib   = &dst_dib;
+    ctx.src_dib   = &src_dib;
+    ctx.h_params  = &h_params;
+    ctx.v_params  = &v_params;
+    ctx.row_fn    = hstretch ? dst_dib.funcs->stretch_row : dst_dib.funcs->shrink_row;
+    ctx.mode      = (vstretch && hstretch) ? STRETCH_DELETESCANS : mode;
+    ctx.row_width = dst->visrect.right - dst->visrect.left;
+    ctx.vstretch  = vstretch;
+    ctx.bands     = &band;
+
+    count = get_band_count( &dst_dib, &src_dib, dst->visrect.right - dst->visrect.left,
+                            dst->visrect.bottom - dst->visrect.top );
+    if (count > 1 && v_params.length >= count && (bands = malloc( count * sizeof(*bands) )))
     {
-        BOOL need_row = TRUE;
-        RECT last_row, this_row;
-        if (hstretch) mode = STRETCH_DELETESCANS;
-        last_row.left = 0;
-        last_row.right = dst->visrect.right - dst->visrect.left;
-
-        while (v_params.length--)
-        {
-            if (need_row)
-            {
-                row_fn( &dst_dib, &dst_start, &src_dib, &src_start, &h_params, mode, FALSE );
-                need_row = FALSE;
-            }
-            else
-            {
-                last_row.top = dst_start.y - v_params.dst_inc;
-                last_row.bottom = last_row.top + 1;
-                this_row = last_row;
-                offset_rect( &this_row, 0, v_params.dst_inc );
-                copy_rect( &dst_dib, &this_row, &dst_dib, &last_row, NULL, R2_COPYPEN );
-            }
-
-            if (err > 0)
-            {
-                src_start.y += v_params.src_inc;
-                need_row = TRUE;
-                err += v_params.err_add_1;
-            }
-            else err += v_params.err_add_2;
-            dst_start.y += v_params.dst_inc;
-        }
+        ctx.bands = bands;
+        count = get_stretch_bands( bands, count, &v_params, vstretch, dst_start, src_start );
+        run_in_bands( &dst_dib, stretch_band, &ctx, count );
+        free( bands );
     }
     else
     {
-        int merged_rows = 0;
-
-        while (v_params.length--)
-        {
-            if (mode != STRETCH_DELETESCANS || !merged_rows)
-                row_fn( &dst_dib, &dst_start, &src_dib, &src_start, &h_params, mode, merged_rows != 0 );
-            merged_rows++;
-
-            if (err > 0)
-            {
-                dst_start.y += v_params.dst_inc;
-                merged_rows = 0;
-                err += v_params.err_add_1;
-            }
-            else err += v_params.err_add_2;
-            src_start.y += v_params.src_inc;
-        }
+        band.dst_start = dst_start;
+        band.src_start = src_start;
+        band.err       = v_params.err_start;
+        band.length    = v_params.length;
+        stretch_band( &ctx, 0 );
     }
 
 done:
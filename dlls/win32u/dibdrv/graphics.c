@@ -55,6 +55,7 @@ struct cached_font
     LOGFONTW              lf;
     XFORM                 xform;
     UINT                  aa_flags;
+    UINT                  shared_font; /* font id in the shared glyph cache, 0 if not shared */
     struct cached_glyph **glyphs[GLYPH_NBTYPES][GLYPH_CACHE_PAGES];
 };
 
@@ -631,10 +632,37 @@ static int font_cache_cmp( const struct cached_font *p1, const struct cached_fon
     return ret;
 }
 
+static UINT get_shared_font_id( DC *dc, const struct cached_font *font );
+static void release_shared_font_id( UINT id );
+
+/* must be called with the font cache lock held */
+static struct cached_font *find_cached_font( const struct cached_font *font, UINT *unused,
+                                             struct cached_font **last_unused )
+{
+    struct cached_font *ptr;
+
+    *unused = 0;
+    LIST_FOR_EACH_ENTRY( ptr, &font_cache, struct cached_font, entry )
+    {
+        if (!font_cache_cmp( font, ptr ))
+        {
+            InterlockedIncrement( &ptr->ref );
+            list_remove( &ptr->entry );
+            return ptr;
+        }
+        if (!ptr->ref)
+        {
+            (*unused)++;
+            *last_unused = ptr;
+        }
+    }
+    return NULL;
+}
+
 static struct cached_font *add_cached_font( DC *dc, HFONT hfont, UINT aa_flags )
 {
     struct cached_font font, *ptr, *last_unused = NULL;
-    UINT i = 0, j, k;
+    UINT i, j, k, unused;
 
     NtGdiExtGetObjectW( hfont, sizeof(font.lf), &font.lf );
     font.xform = dc->xformWorld2Vport;
@@ -650,22 +678,21 @@ static struct cached_font *add_cached_font( DC *dc, HFONT hfont, UINT aa_flags )
     font.hash = font_cache_hash( &font );
 
     pthread_mutex_lock( &font_cache_lock );
-    LIST_FOR_EACH_ENTRY( ptr, &font_cache, struct cached_font, entry )
+    if ((ptr = find_cached_font( &font, &unused, &last_unused ))) goto done;
+    pthread_mutex_unlock( &font_cache_lock );
+
+    /* this needs the font file, so only do it when the font isn't cached yet */
+    font.shared_font = get_shared_font_id( dc, &font );
+
+    pthread_mutex_lock( &font_cache_lock );
+    if ((ptr = find_cached_font( &font, &unused, &last_unused )))
     {
-        if (!font_cache_cmp( &font, ptr ))
-        {
-            InterlockedIncrement( &ptr->ref );
-            list_remove( &ptr->entry );
-            goto done;
-        }
-        if (!ptr->ref)
-        {
-            i++;
-            last_unused = ptr;
-        }
+        /* added by another thread in the meantime */
+        release_shared_font_id( font.shared_font );
+        goto done;
     }
 
-    if (i > 5)  /* keep at least 5 of the most-recently used fonts around */
+    if (unused > 5)  /* keep at least 5 of the most-recently used fonts around */
     {
         ptr = last_unused;
         for (i = 0; i < GLYPH_NBTYPES; i++)
@@ -678,11 +705,13 @@ static struct cached_font *add_cached_font( DC *dc, HFONT hfont, UINT aa_flags )
                 free( ptr->glyphs[i][j] );
             }
         }
+        release_shared_font_id( ptr->shared_font );
         list_remove( &ptr->entry );
     }
     else if (!(ptr = malloc( sizeof(*ptr) )))
     {
         pthread_mutex_unlock( &font_cache_lock );
+        release_shared_font_id( font.shared_font );
         return NULL;
     }
 
@@ -737,6 +766,373 @@ static struct cached_glyph *get_cached_glyph( struct cached_font *font, UINT ind
     return font->glyphs[type][page][index % GLYPH_CACHE_PAGE_SIZE];
 }
 
+/* shared glyph cache
+ *
+ * Optionally, rendered glyphs are also stored in a section shared by all the
+ * processes of the session, so that a glyph rasterized once can be reused by
+ * every other process drawing the same text.  Realized fonts are registered
+ * in a table of full font descriptions, and glyphs are stored in a
+ * set-associative table of fixed-size entries keyed by font id and glyph,
+ * with LRU replacement within each set.  A font slot counts the cached fonts
+ * of all processes using it and can be given to another font once that drops
+ * to zero; the font id includes the serial number of the slot, so the glyphs
+ * left behind by the previous font don't match anymore.  Glyph writers take a
+ * lock and give up if it is busy, readers only check the entry sequence number
+ * to detect concurrent updates.  A lock held for longer than SHARED_GLYPH_LOCK_TIMEOUT is assumed to
+ * belong to a process that died while holding it and is taken over.
+ *
+ * It is enabled by setting HKCU\Software\Wine\Fonts\SharedGlyphCacheSize to the
+ * size of the cache in kilobytes.
+ */
+
+#define SHARED_GLYPH_CACHE_MAGIC    0x48434c47  /* 'GLCH' */
+#define SHARED_GLYPH_CACHE_VERSION  3
+#define SHARED_GLYPH_CACHE_WAYS     8
+#define SHARED_GLYPH_CACHE_FONTS    256
+#define SHARED_GLYPH_MAX_BITS       1024
+#define SHARED_GLYPH_LOCK_TIMEOUT   2000  /* ms */
+
+struct shared_font_desc
+{
+    WCHAR         path[MAX_PATH];
+    FILETIME      writetime;
+    LARGE_INTEGER size;
+    DWORD         face_index;
+    DWORD         simulations;
+    LOGFONTW      lf;           /* lfFaceName is not used */
+    XFORM         xform;
+    UINT          aa_flags;
+};
+
+struct shared_glyph_font
+{
+    LONG                    seq;     /* odd while the entry is being written */
+    UINT                    hash;    /* 0 if the entry was never used */
+    UINT                    serial;  /* incremented each time the slot is given to a font */
+    LONG                    refs;    /* cached fonts using the slot, it can be reused when 0 */
+    struct shared_font_desc desc;
+};
+
+struct shared_glyph
+{
+    LONG         seq;        /* odd while the entry is being written */
+    LONG         last_used;
+    UINT         font;       /* font id, 0 if the entry is free */
+    UINT         index;      /* glyph index or character, see shared_glyph_index() */
+    UINT         size;
+    GLYPHMETRICS metrics;
+    BYTE         bits[SHARED_GLYPH_MAX_BITS];
+};
+
+struct shared_glyph_cache
+{
+    DWORD        magic;
+    DWORD        version;
+    LONG         init;
+    UINT         set_count;
+    LONG         clock;
+    LONG         hits;
+    LONG         misses;
+    LONG         inserts;
+    LONG         evictions;
+    LONG         fonts_lock;
+    struct shared_glyph_font fonts[SHARED_GLYPH_CACHE_FONTS];
+    LONG         locks[1];   /* one per set, followed by the entries */
+};
+
+static struct shared_glyph_cache *shared_glyph_cache;
+static pthread_once_t shared_glyph_cache_once = PTHREAD_ONCE_INIT;
+
+static inline struct shared_glyph *get_shared_glyph_set( struct shared_glyph_cache *cache, UINT set )
+{
+    char *entries = (char *)&cache->locks[(cache->set_count + 7) & ~7];
+    return (struct shared_glyph *)entries + set * SHARED_GLYPH_CACHE_WAYS;
+}
+
+/* the lock holds the tick count when it was taken, so that a stale lock can be recovered */
+static BOOL lock_shared_glyph_cache( LONG *lock )
+{
+    LONG now = max( NtGetTickCount(), 1 ), prev = *(volatile LONG *)lock;
+
+    if (prev && now - prev < SHARED_GLYPH_LOCK_TIMEOUT) return FALSE;
+    if (InterlockedCompareExchange( lock, now, prev ) != prev) return FALSE;
+    if (prev) WARN( "recovering stale shared glyph cache lock\n" );
+    return TRUE;
+}
+
+static inline void unlock_shared_glyph_cache( LONG *lock )
+{
+    InterlockedExchange( lock, 0 );
+}
+
+static void init_shared_glyph_cache(void)
+{
+    static WCHAR nameW[] = {'\\','B','a','s','e','N','a','m','e','d','O','b','j','e','c','t','s',
+                            '\\','_','_','w','i','n','e','_','g','l','y','p','h','_','c','a','c','h','e'};
+    char value_buffer[FIELD_OFFSET(KEY_VALUE_PARTIAL_INFORMATION, Data[sizeof(DWORD)])];
+    KEY_VALUE_PARTIAL_INFORMATION *info = (void *)value_buffer;
+    UNICODE_STRING name = { sizeof(nameW), sizeof(nameW), nameW };
+    struct shared_glyph_cache *cache = NULL;
+    OBJECT_ATTRIBUTES attr;
+    LARGE_INTEGER size;
+    SIZE_T view_size = 0;
+    HANDLE section;
+    UINT set_count;
+    HKEY hkey;
+    int i;
+
+    if (!(hkey = reg_open_hkcu_key( "Software\\Wine\\Fonts" ))) return;
+    size.QuadPart = 0;
+    if (query_reg_ascii_value( hkey, "SharedGlyphCacheSize", info, sizeof(value_buffer) ) &&
+        info->Type == REG_DWORD)
+        size.QuadPart = (ULONGLONG)*(DWORD *)info->Data * 1024;
+    NtClose( hkey );
+
+    if (size.QuadPart <= offsetof( struct shared_glyph_cache, locks )) return;
+    set_count = (size.QuadPart - offsetof( struct shared_glyph_cache, locks )) /
+                (sizeof(LONG) + SHARED_GLYPH_CACHE_WAYS * sizeof(struct shared_glyph));
+    if (!set_count) return;
+    size.QuadPart = offsetof( struct shared_glyph_cache, locks[(set_count + 7) & ~7] ) +
+                    (ULONGLONG)set_count * SHARED_GLYPH_CACHE_WAYS * sizeof(struct shared_glyph);
+
+    InitializeObjectAttributes( &attr, &name, OBJ_OPENIF, 0, NULL );
+    if (NtCreateSection( &section, SECTION_MAP_READ | SECTION_MAP_WRITE | SECTION_QUERY, &attr, &size,
+                         PAGE_READWRITE, SEC_COMMIT, 0 ) < 0)
+    {
+        WARN( "failed to create the shared glyph cache\n" );
+        return;
+    }
+    if (NtMapViewOfSection( section, GetCurrentProcess(), (void **)&cache, 0, 0, NULL,
+                            &view_size, ViewShare, 0, PAGE_READWRITE ))
+    {
+        NtClose( section );
+        return;
+    }
+    NtClose( section );
+
+    /* the first process initializes the header, the others wait for it to be ready */
+    if (!InterlockedCompareExchange( &cache->init, 1, 0 ))
+    {
+        cache->version = SHARED_GLYPH_CACHE_VERSION;
+        cache->set_count = set_count;
+        MemoryBarrier();
+        cache->magic = SHARED_GLYPH_CACHE_MAGIC;
+    }
+    for (i = 0; i < 1000 && *(volatile DWORD *)&cache->magic != SHARED_GLYPH_CACHE_MAGIC; i++)
+        NtYieldExecution();
+    MemoryBarrier();
+
+    if (cache->magic != SHARED_GLYPH_CACHE_MAGIC || cache->version != SHARED_GLYPH_CACHE_VERSION ||
+        offsetof( struct shared_glyph_cache, locks[(cache->set_count + 7) & ~7] ) +
+        (SIZE_T)cache->set_count * SHARED_GLYPH_CACHE_WAYS * sizeof(struct shared_glyph) > view_size)
+    {
+        WARN( "incompatible shared glyph cache\n" );
+        NtUnmapViewOfSection( GetCurrentProcess(), cache );
+        return;
+    }
+    TRACE( "using shared glyph cache %p, %u sets\n", cache, cache->set_count );
+    shared_glyph_cache = cache;
+}
+
+static inline ULONGLONG hash_bytes( ULONGLONG hash, const void *ptr, SIZE_T size )
+{
+    const BYTE *p = ptr;
+    while (size--) hash = (hash ^ *p++) * 0x100000001b3ull;  /* FNV-1a */
+    return hash;
+}
+
+static inline UINT shared_font_id( const struct shared_glyph_font *slot )
+{
+    return slot->serial * SHARED_GLYPH_CACHE_FONTS + (slot - shared_glyph_cache->fonts);
+}
+
+/* unlike the glyph sets, the font table lock is always waited for, so that references aren't lost */
+static void lock_shared_glyph_fonts( struct shared_glyph_cache *cache )
+{
+    while (!lock_shared_glyph_cache( &cache->fonts_lock )) NtYieldExecution();
+}
+
+/* find or register the slot of a realized font in the shared cache, returns the font id or 0 */
+static UINT get_shared_font_id( DC *dc, const struct cached_font *font )
+{
+    struct shared_glyph_cache *cache;
+    struct shared_glyph_font *slot, *free_slot = NULL;
+    struct shared_font_desc desc;
+    struct font_realization_info info;
+    struct font_fileinfo *file_info;
+    char buffer[offsetof( struct font_fileinfo, path[MAX_PATH] )];
+    SIZE_T needed;
+    PHYSDEV dev;
+    UINT hash, i, id = 0;
+
+    pthread_once( &shared_glyph_cache_once, init_shared_glyph_cache );
+    if (!(cache = shared_glyph_cache)) return 0;
+
+    info.size = sizeof(info);
+    dev = GET_DC_PHYSDEV( dc, pGetFontRealizationInfo );
+    if (!dev->funcs->pGetFontRealizationInfo( dev, &info )) return 0;
+
+    file_info = (struct font_fileinfo *)buffer;
+    if (!NtGdiGetFontFileInfo( info.instance_id, 0, file_info, sizeof(buffer), &needed )) return 0;
+    if (!file_info->path[0]) return 0;  /* memory fonts are private to the process */
+
+    /* zero everything, including padding, so that descriptions can be compared with memcmp */
+    memset( &desc, 0, sizeof(desc) );
+    lstrcpynW( desc.path, file_info->path, MAX_PATH );
+    desc.writetime   = file_info->writetime;
+    desc.size        = file_info->size;
+    desc.face_index  = info.face_index;
+    desc.simulations = info.simulations;
+    memcpy( &desc.lf, &font->lf, FIELD_OFFSET( LOGFONTW, lfFaceName ));
+    desc.xform       = font->xform;
+    desc.aa_flags    = font->aa_flags;
+    hash = hash_bytes( 0xcbf29ce484222325ull, &desc, sizeof(desc) ) | 1;
+
+    /* linear probing; a slot keeps its hash once used, so the first never used one ends the
+     * search, and the first unreferenced one is taken if the font isn't found */
+    lock_shared_glyph_fonts( cache );
+    for (i = 0; i < SHARED_GLYPH_CACHE_FONTS; i++)
+    {
+        slot = &cache->fonts[(hash + i) % SHARED_GLYPH_CACHE_FONTS];
+        if (slot->seq & 1)
+        {
+            /* left over by a writer that died, make sure it doesn't match anything */
+            memset( &slot->desc, 0, sizeof(slot->desc) );
+            slot->refs = 0;
+            InterlockedIncrement( &slot->seq );
+        }
+        if (slot->hash == hash && !memcmp( &slot->desc, &desc, sizeof(desc) ))
+        {
+            slot->refs++;
+            id = shared_font_id( slot );
+            break;
+        }
+        if (!slot->refs && !free_slot) free_slot = slot;
+        if (!slot->hash) break;
+    }
+    if (!id && (slot = free_slot))
+    {
+        InterlockedIncrement( &slot->seq );
+        if (++slot->serial >= UINT_MAX / SHARED_GLYPH_CACHE_FONTS) slot->serial = 1;
+        slot->desc = desc;
+        slot->hash = hash;
+        slot->refs = 1;
+        InterlockedIncrement( &slot->seq );
+        id = shared_font_id( slot );
+    }
+    unlock_shared_glyph_cache( &cache->fonts_lock );
+    if (!id) WARN( "shared glyph cache font table is full\n" );
+    return id;
+}
+
+static void release_shared_font_id( UINT id )
+{
+    struct shared_glyph_font *slot;
+
+    if (!id) return;
+    slot = &shared_glyph_cache->fonts[id % SHARED_GLYPH_CACHE_FONTS];
+    lock_shared_glyph_fonts( shared_glyph_cache );
+    if (shared_font_id( slot ) == id && slot->refs > 0) slot->refs--;
+    unlock_shared_glyph_cache( &shared_glyph_cache->fonts_lock );
+}
+
+static inline UINT shared_glyph_index( UINT index, UINT flags )
+{
+    return (flags & ETO_GLYPH_INDEX) ? index : index | 0x80000000;
+}
+
+static inline UINT get_shared_glyph_set_index( UINT font, UINT index )
+{
+    ULONGLONG hash = hash_bytes( 0xcbf29ce484222325ull, &font, sizeof(font) );
+    hash = hash_bytes( hash, &index, sizeof(index) );
+    return (hash >> 16) % shared_glyph_cache->set_count;
+}
+
+static struct cached_glyph *find_shared_glyph( struct cached_font *font, UINT index, UINT flags )
+{
+    struct shared_glyph *entry;
+    struct cached_glyph *glyph;
+    LONG seq;
+    int i;
+
+    index = shared_glyph_index( index, flags );
+    entry = get_shared_glyph_set( shared_glyph_cache, get_shared_glyph_set_index( font->shared_font, index ));
+
+    for (i = 0; i < SHARED_GLYPH_CACHE_WAYS; i++, entry++)
+    {
+        seq = *(volatile LONG *)&entry->seq;
+        if (seq & 1) continue;
+        MemoryBarrier();
+        if (entry->font != font->shared_font || entry->index != index) continue;
+        if (entry->size > SHARED_GLYPH_MAX_BITS) continue;
+        if (!(glyph = malloc( FIELD_OFFSET( struct cached_glyph, bits[entry->size] )))) return NULL;
+        glyph->metrics = entry->metrics;
+        memcpy( glyph->bits, entry->bits, entry->size );
+        MemoryBarrier();
+        if (*(volatile LONG *)&entry->seq != seq || entry->font != font->shared_font ||
+            entry->index != index)
+        {
+            free( glyph );
+            break;
+        }
+        entry->last_used = InterlockedIncrement( &shared_glyph_cache->clock );
+        InterlockedIncrement( &shared_glyph_cache->hits );
+        return glyph;
+    }
+    InterlockedIncrement( &shared_glyph_cache->misses );
+    return NULL;
+}
+
+static void add_shared_glyph( struct cached_font *font, UINT index, UINT flags,
+                              const struct cached_glyph *glyph, UINT size )
+{
+    struct shared_glyph *entries, *entry = NULL;
+    UINT set;
+    LONG *lock;
+    int i;
+
+    if (size > SHARED_GLYPH_MAX_BITS) return;
+
+    index = shared_glyph_index( index, flags );
+    set = get_shared_glyph_set_index( font->shared_font, index );
+    entries = get_shared_glyph_set( shared_glyph_cache, set );
+    lock = &shared_glyph_cache->locks[set];
+    if (!lock_shared_glyph_cache( lock )) return;  /* busy, don't bother */
+
+    for (i = 0; i < SHARED_GLYPH_CACHE_WAYS; i++)
+    {
+        if (entries[i].seq & 1)
+        {
+            /* left over by a writer that died */
+            entries[i].font = 0;
+            InterlockedIncrement( &entries[i].seq );
+        }
+        if (entries[i].font == font->shared_font && entries[i].index == index) goto done;
+        if (!entries[i].font)
+        {
+            if (!entry || entry->font) entry = &entries[i];
+        }
+        else if (!entry || (entry->font && entries[i].last_used - entry->last_used < 0))
+            entry = &entries[i];
+    }
+    if (entry->font) InterlockedIncrement( &shared_glyph_cache->evictions );
+
+    InterlockedIncrement( &entry->seq );
+    entry->font     = font->shared_font;
+    entry->index    = index;
+    entry->size     = size;
+    entry->metrics  = glyph->metrics;
+    memcpy( entry->bits, glyph->bits, size );
+    entry->last_used = InterlockedIncrement( &shared_glyph_cache->clock );
+    InterlockedIncrement( &entry->seq );
+
+    if (!(InterlockedIncrement( &shared_glyph_cache->inserts ) % 1024))
+        TRACE( "hits %d misses %d inserts %d evictions %d\n", shared_glyph_cache->hits,
+               shared_glyph_cache->misses, shared_glyph_cache->inserts, shared_glyph_cache->evictions );
+done:
+    unlock_shared_glyph_cache( lock );
+}
+
 /**********************************************************************
  *                 get_text_bkgnd_masks
  *
@@ -834,6 +1230,9 @@ static struct cached_glyph *cache_glyph_bitmap( DC *dc, struct cached_font *font
     GLYPHMETRICS metrics;
     struct cached_glyph *glyph;
 
+    if (font->shared_font && (glyph = find_shared_glyph( font, index, flags )))
+        return add_cached_glyph( font, index, flags, glyph );
+
     if (flags & ETO_GLYPH_INDEX) ggo_flags |= GGO_GLYPH_INDEX;
     indices[0] = index;
     for (i = 0; i < ARRAY_SIZE( indices ); i++)
@@ -884,6 +1283,7 @@ static struct cached_glyph *cache_glyph_bitmap( DC *dc, struct cached_font *font
 
 done:
     glyph->metrics = metrics;
+    if (font->shared_font) add_shared_glyph( font, indices[0], flags, glyph, size );
     return add_cached_glyph( font, index, flags, glyph );
 }
 
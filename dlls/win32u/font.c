@@ -198,6 +198,7 @@ static struct font_gamma_ramp font_gamma_ramp;
 
 static void add_face_to_cache( struct gdi_font_face *face );
 static void remove_face_from_cache( struct gdi_font_face *face );
+static void invalidate_font_catalog(void);
 
 UINT get_acp(void)
 {
@@ -1380,6 +1381,8 @@ static void add_face_to_cache( struct gdi_font_face *face )
     DWORD len, buffer[1024];
     struct cached_face *cached = (struct cached_face *)buffer;
 
+    invalidate_font_catalog();
+
     if (!(hkey_family = reg_create_key( wine_fonts_cache_key, face->family->family_name,
                                         lstrlenW( face->family->family_name ) * sizeof(WCHAR),
                                         REG_OPTION_VOLATILE, NULL )))
@@ -1424,6 +1427,8 @@ static void remove_face_from_cache( struct gdi_font_face *face )
 {
     HKEY hkey_family, hkey;
 
+    invalidate_font_catalog();
+
     if (!(hkey_family = reg_open_key( wine_fonts_cache_key, face->family->family_name,
                                       lstrlenW( face->family->family_name ) * sizeof(WCHAR) )))
         return;
@@ -1445,6 +1450,401 @@ static void remove_face_from_cache( struct gdi_font_face *face )
     NtClose( hkey_family );
 }
 
+/* font catalog
+ *
+ * The registry cache above is expensive to read back, since every family and
+ * face is a separate key or value that has to be fetched from the server.  The
+ * first process that populates the cache therefore also writes a flat binary
+ * copy of it to disk; other processes map that file read-only and build their
+ * face list from it directly.  The catalog is tied to the volatile cache key
+ * through a serial number, and records the write time of every directory that
+ * contains a cached font file, as well as the size and write time of the font
+ * files themselves, so that it is ignored once fonts are added or changed.
+ */
+
+#define FONT_CATALOG_MAGIC    0x54414346  /* 'FCAT' */
+#define FONT_CATALOG_VERSION  2
+
+struct font_catalog_header
+{
+    DWORD         magic;
+    DWORD         version;
+    DWORD         size;         /* total size of the catalog */
+    DWORD         dir_count;    /* number of struct font_catalog_dir entries */
+    DWORD         face_count;   /* number of struct font_catalog_face entries */
+    DWORD         reserved;
+    LARGE_INTEGER serial;       /* must match the cache key Catalog value */
+};
+
+struct font_catalog_dir
+{
+    DWORD         size;         /* size of the entry, including the name */
+    DWORD         reserved;
+    LARGE_INTEGER write_time;
+    WCHAR         name[1];
+};
+
+struct font_catalog_face
+{
+    DWORD                   size;  /* size of the entry, including the names */
+    DWORD                   index;
+    DWORD                   flags;
+    DWORD                   ntmflags;
+    DWORD                   version;
+    DWORD                   scalable;
+    LARGE_INTEGER           file_time;  /* write time of the font file */
+    ULONGLONG               file_size;  /* size of the font file */
+    struct bitmap_font_size font_size;
+    FONTSIGNATURE           fs;
+    WCHAR                   names[1];
+    /* family name, second name, style name, full name, file name; all nul-terminated */
+};
+
+struct font_catalog_buffer
+{
+    char *data;
+    DWORD size;
+    DWORD alloc;
+};
+
+static const WCHAR font_catalog_valueW[] = {'C','a','t','a','l','o','g',0};
+static LARGE_INTEGER font_catalog_serial;
+
+static void *font_catalog_append( struct font_catalog_buffer *buffer, DWORD size )
+{
+    void *ptr;
+
+    size = (size + 7) & ~7;
+    if (buffer->size + size > buffer->alloc)
+    {
+        DWORD new_alloc = max( buffer->alloc * 2, buffer->size + size );
+        char *new_data = realloc( buffer->data, new_alloc );
+        if (!new_data) return NULL;
+        buffer->data = new_data;
+        buffer->alloc = new_alloc;
+    }
+    ptr = buffer->data + buffer->size;
+    memset( ptr, 0, size );
+    buffer->size += size;
+    return ptr;
+}
+
+static BOOL get_font_dir_write_time( const WCHAR *dir, DWORD len, LARGE_INTEGER *time )
+{
+    UNICODE_STRING nameW = { len * sizeof(WCHAR), len * sizeof(WCHAR), (WCHAR *)dir };
+    OBJECT_ATTRIBUTES attr;
+    FILE_BASIC_INFORMATION info;
+
+    InitializeObjectAttributes( &attr, &nameW, OBJ_CASE_INSENSITIVE, 0, NULL );
+    if (NtQueryAttributesFile( &attr, &info )) return FALSE;
+    *time = info.LastWriteTime;
+    return TRUE;
+}
+
+static BOOL get_font_file_info( const WCHAR *file, LARGE_INTEGER *time, ULONGLONG *size )
+{
+    DWORD len = lstrlenW( file ) * sizeof(WCHAR);
+    UNICODE_STRING nameW = { len, len, (WCHAR *)file };
+    OBJECT_ATTRIBUTES attr;
+    FILE_NETWORK_OPEN_INFORMATION info;
+
+    InitializeObjectAttributes( &attr, &nameW, OBJ_CASE_INSENSITIVE, 0, NULL );
+    if (NtQueryFullAttributesFile( &attr, &info )) return FALSE;
+    *time = info.LastWriteTime;
+    *size = info.EndOfFile.QuadPart;
+    return TRUE;
+}
+
+static BOOL font_catalog_add_dir( struct font_catalog_buffer *buffer, const WCHAR *file )
+{
+    struct font_catalog_header *header = (struct font_catalog_header *)buffer->data;
+    struct font_catalog_dir *dir = (struct font_catalog_dir *)(header + 1);
+    const WCHAR *p;
+    LARGE_INTEGER time;
+    DWORD i, len;
+
+    if (!(p = wcsrchr( file, '\\' ))) return TRUE;
+    len = p - file;
+
+    for (i = 0; i < header->dir_count; i++)
+    {
+        if (lstrlenW( dir->name ) == len && !facename_compare( dir->name, file, len )) return TRUE;
+        dir = (struct font_catalog_dir *)((char *)dir + dir->size);
+    }
+
+    if (!get_font_dir_write_time( file, len, &time )) return FALSE;
+    if (!(dir = font_catalog_append( buffer, offsetof( struct font_catalog_dir, name[len + 1] ))))
+        return FALSE;
+    header = (struct font_catalog_header *)buffer->data;
+    dir->size = buffer->data + buffer->size - (char *)dir;
+    dir->write_time = time;
+    memcpy( dir->name, file, len * sizeof(WCHAR) );
+    header->dir_count++;
+    return TRUE;
+}
+
+static BOOL font_catalog_add_face( struct font_catalog_buffer *buffer, const struct gdi_font_face *face )
+{
+    const WCHAR *names[] = { face->family->family_name, face->family->second_name,
+                             face->style_name, face->full_name, face->file };
+    struct font_catalog_face *entry;
+    DWORD i, len = 0;
+    WCHAR *p;
+
+    static const WCHAR emptyW[] = {0};
+
+    for (i = 0; i < ARRAY_SIZE(names); i++)
+    {
+        if (!names[i]) names[i] = emptyW;
+        len += lstrlenW( names[i] ) + 1;
+    }
+    if (!(entry = font_catalog_append( buffer, offsetof( struct font_catalog_face, names[len] ))))
+        return FALSE;
+    if (!get_font_file_info( face->file, &entry->file_time, &entry->file_size )) return FALSE;
+
+    entry->size     = buffer->data + buffer->size - (char *)entry;
+    entry->index    = face->face_index;
+    entry->flags    = face->flags;
+    entry->ntmflags = face->ntmFlags;
+    entry->version  = face->version;
+    entry->scalable = face->scalable;
+    entry->fs       = face->fs;
+    if (!face->scalable) entry->font_size = face->size;
+    for (i = 0, p = entry->names; i < ARRAY_SIZE(names); i++)
+    {
+        lstrcpyW( p, names[i] );
+        p += lstrlenW( p ) + 1;
+    }
+    ((struct font_catalog_header *)buffer->data)->face_count++;
+    return TRUE;
+}
+
+static HANDLE open_font_catalog_file( ACCESS_MASK access, ULONG disposition )
+{
+    static const WCHAR catalogW[] = {'\\','?','?','\\','C',':','\\','w','i','n','d','o','w','s','\\',
+                                     's','y','s','t','e','m','3','2','\\','w','i','n','e','f','o','n','t','s','.','c','a','t'};
+    UNICODE_STRING nameW = { sizeof(catalogW), sizeof(catalogW), (WCHAR *)catalogW };
+    OBJECT_ATTRIBUTES attr;
+    IO_STATUS_BLOCK io;
+    HANDLE handle;
+
+    InitializeObjectAttributes( &attr, &nameW, OBJ_CASE_INSENSITIVE, 0, NULL );
+    if (NtCreateFile( &handle, access | SYNCHRONIZE, &attr, &io, NULL, FILE_ATTRIBUTE_NORMAL,
+                      FILE_SHARE_READ, disposition, FILE_SYNCHRONOUS_IO_NONALERT | FILE_NON_DIRECTORY_FILE,
+                      NULL, 0 ))
+        return 0;
+    return handle;
+}
+
+/* write the faces of the registry cache to the catalog file; must be called with the font mutex held */
+static void save_font_catalog(void)
+{
+    struct font_catalog_buffer buffer = { NULL };
+    struct font_catalog_header *header;
+    struct gdi_font_family *family;
+    struct gdi_font_face *face;
+    IO_STATUS_BLOCK io;
+    HANDLE handle;
+    BOOL ret = TRUE;
+
+    if (!font_catalog_append( &buffer, sizeof(*header) )) return;
+
+    /* directories first, so that the loader can validate them before parsing any face */
+    WINE_RB_FOR_EACH_ENTRY( family, &family_name_tree, struct gdi_font_family, name_entry )
+    {
+        LIST_FOR_EACH_ENTRY( face, &family->faces, struct gdi_font_face, entry )
+        {
+            if (!(face->flags & ADDFONT_ADD_TO_CACHE) || !face->file) continue;
+            if (!(ret = font_catalog_add_dir( &buffer, face->file ))) goto done;
+        }
+    }
+    WINE_RB_FOR_EACH_ENTRY( family, &family_name_tree, struct gdi_font_family, name_entry )
+    {
+        LIST_FOR_EACH_ENTRY( face, &family->faces, struct gdi_font_face, entry )
+        {
+            if (!(face->flags & ADDFONT_ADD_TO_CACHE) || !face->file) continue;
+            if (!(ret = font_catalog_add_face( &buffer, face ))) goto done;
+        }
+    }
+
+    header = (struct font_catalog_header *)buffer.data;
+    header->magic = FONT_CATALOG_MAGIC;
+    header->version = FONT_CATALOG_VERSION;
+    header->size = buffer.size;
+    NtQuerySystemTime( &header->serial );
+
+    if (!(handle = open_font_catalog_file( GENERIC_WRITE, FILE_OVERWRITE_IF )))
+    {
+        ret = FALSE;
+        goto done;
+    }
+    ret = !NtWriteFile( handle, 0, NULL, NULL, &io, buffer.data, buffer.size, NULL, NULL ) &&
+          io.Information == buffer.size;
+    NtClose( handle );
+
+    if (ret)
+    {
+        set_reg_value( wine_fonts_cache_key, font_catalog_valueW, REG_BINARY,
+                       &header->serial, sizeof(header->serial) );
+        font_catalog_serial = header->serial;
+        TRACE( "saved %u faces, %u bytes\n", header->face_count, header->size );
+    }
+
+done:
+    if (!ret) WARN( "failed to save the font catalog\n" );
+    free( buffer.data );
+}
+
+/* return the string following a nul-terminated one, or NULL if it isn't terminated before end */
+static const WCHAR *font_catalog_next_string( const WCHAR *str, const WCHAR *end )
+{
+    while (str < end) if (!*str++) return str;
+    return NULL;
+}
+
+/* check that the catalog is well formed and that the fonts didn't change since it was written */
+static BOOL validate_font_catalog( const char *data, SIZE_T size )
+{
+    const struct font_catalog_header *header = (const struct font_catalog_header *)data;
+    const struct font_catalog_dir *dir;
+    const struct font_catalog_face *entry;
+    const WCHAR *str, *end, *file, *prev_file = NULL;
+    const char *ptr, *data_end;
+    LARGE_INTEGER time;
+    ULONGLONG file_size;
+    DWORD i, j;
+
+    if (size < sizeof(*header) || header->magic != FONT_CATALOG_MAGIC ||
+        header->version != FONT_CATALOG_VERSION || header->size > size || header->size < sizeof(*header) ||
+        header->serial.QuadPart != font_catalog_serial.QuadPart)
+        return FALSE;
+
+    ptr = (const char *)(header + 1);
+    data_end = data + header->size;
+
+    for (i = 0; i < header->dir_count; i++, ptr += dir->size)
+    {
+        dir = (const struct font_catalog_dir *)ptr;
+        if (data_end - ptr < sizeof(*dir) || dir->size < sizeof(*dir) || dir->size > data_end - ptr ||
+            dir->size % 8)
+            return FALSE;
+        end = (const WCHAR *)(ptr + dir->size);
+        if (!font_catalog_next_string( dir->name, end )) return FALSE;
+        if (!get_font_dir_write_time( dir->name, lstrlenW( dir->name ), &time ) ||
+            time.QuadPart != dir->write_time.QuadPart)
+        {
+            TRACE( "directory %s changed, ignoring catalog\n", debugstr_w(dir->name) );
+            return FALSE;
+        }
+    }
+
+    for (i = 0; i < header->face_count; i++, ptr += entry->size)
+    {
+        entry = (const struct font_catalog_face *)ptr;
+        if (data_end - ptr < sizeof(*entry) || entry->size < sizeof(*entry) || entry->size > data_end - ptr ||
+            entry->size % 8)
+            return FALSE;
+        end = (const WCHAR *)(ptr + entry->size);
+        for (j = 0, str = file = entry->names; j < 5; j++)
+        {
+            file = str;
+            if (!(str = font_catalog_next_string( str, end ))) return FALSE;
+        }
+        if (prev_file && !wcscmp( file, prev_file )) continue;
+        if (!get_font_file_info( file, &time, &file_size ) ||
+            time.QuadPart != entry->file_time.QuadPart || file_size != entry->file_size)
+        {
+            TRACE( "font file %s changed, ignoring catalog\n", debugstr_w(file) );
+            return FALSE;
+        }
+        prev_file = file;
+    }
+    return TRUE;
+}
+
+static BOOL load_font_catalog_entries( const char *data, SIZE_T size )
+{
+    const struct font_catalog_header *header = (const struct font_catalog_header *)data;
+    const char *ptr = (const char *)(header + 1);
+    const struct font_catalog_dir *dir;
+    const struct font_catalog_face *entry;
+    const WCHAR *family_name, *second_name, *style, *full_name, *file;
+    struct gdi_font_family *family;
+    struct gdi_font_face *face;
+    DWORD i;
+
+    if (!validate_font_catalog( data, size )) return FALSE;
+
+    for (i = 0; i < header->dir_count; i++, ptr += dir->size)
+        dir = (const struct font_catalog_dir *)ptr;
+
+    for (i = 0; i < header->face_count; i++, ptr += entry->size)
+    {
+        entry = (const struct font_catalog_face *)ptr;
+
+        family_name = entry->names;
+        second_name = family_name + lstrlenW( family_name ) + 1;
+        style       = second_name + lstrlenW( second_name ) + 1;
+        full_name   = style + lstrlenW( style ) + 1;
+        file        = full_name + lstrlenW( full_name ) + 1;
+
+        if ((family = find_family_from_name( family_name ))) family->refcount++;
+        else if (!(family = create_family( family_name, second_name ))) continue;
+
+        if ((face = create_face( family, style, full_name, file, NULL, 0, entry->index, entry->fs,
+                                 entry->ntmflags, entry->version, entry->flags,
+                                 entry->scalable ? NULL : &entry->font_size )))
+            release_face( face );
+        release_family( family );
+    }
+
+    TRACE( "loaded %u faces\n", i );
+    return TRUE;
+}
+
+/* load the faces of the registry cache from the catalog file; must be called with the font mutex held */
+static BOOL load_font_catalog(void)
+{
+    char value_buffer[FIELD_OFFSET(KEY_VALUE_PARTIAL_INFORMATION, Data[sizeof(LARGE_INTEGER)])];
+    KEY_VALUE_PARTIAL_INFORMATION *info = (void *)value_buffer;
+    LARGE_INTEGER map_offset = { {0} };
+    HANDLE handle, section;
+    SIZE_T size = 0;
+    void *data = NULL;
+    BOOL ret = FALSE;
+
+    if (query_reg_value( wine_fonts_cache_key, font_catalog_valueW, info, sizeof(value_buffer) ) !=
+        sizeof(LARGE_INTEGER) || info->Type != REG_BINARY)
+        return FALSE;
+    memcpy( &font_catalog_serial, info->Data, sizeof(font_catalog_serial) );
+
+    if (!(handle = open_font_catalog_file( GENERIC_READ, FILE_OPEN ))) goto done;
+    if (!NtCreateSection( &section, SECTION_MAP_READ | SECTION_QUERY, NULL, NULL,
+                          PAGE_READONLY, SEC_COMMIT, handle ))
+    {
+        if (!NtMapViewOfSection( section, GetCurrentProcess(), &data, 0, 0, &map_offset,
+                                 &size, ViewShare, 0, PAGE_READONLY ))
+        {
+            ret = load_font_catalog_entries( data, size );
+            NtUnmapViewOfSection( GetCurrentProcess(), data );
+        }
+        NtClose( section );
+    }
+    NtClose( handle );
+
+done:
+    if (!ret) font_catalog_serial.QuadPart = 0;
+    return ret;
+}
+
+/* called when the registry cache is modified, so that other processes stop using the catalog;
+ * the value is deleted even if we didn't load it, it may have been written by another process */
+static void invalidate_font_catalog(void)
+{
+    font_catalog_serial.QuadPart = 0;
+    reg_delete_value( wine_fonts_cache_key, font_catalog_valueW );
+}
+
 /* font links */
 
 struct gdi_font_link
@@ -6351,7 +6751,8 @@ UINT font_init(void)
     OBJECT_ATTRIBUTES attr = { sizeof(attr) };
     UNICODE_STRING name;
     HANDLE mutex;
-    DWORD disposition;
+    DWORD disposition, start_time;
+    BOOL catalog_loaded = FALSE;
     UINT dpi = 0;
 
     static WCHAR wine_font_mutexW[] =
@@ -6370,6 +6771,7 @@ UINT font_init(void)
     if (!(font_funcs = init_freetype_lib()))
         return dpi;
 
+    start_time = NtGetTickCount();
     load_system_bitmap_fonts();
     load_file_system_fonts();
     font_funcs->load_fonts();
@@ -6389,16 +6791,31 @@ UINT font_init(void)
     {
         load_registry_fonts();
         update_external_font_keys();
+        save_font_catalog();
     }
+    else catalog_loaded = load_font_catalog();
 
     NtReleaseMutant( mutex, NULL );
 
-    if (disposition != REG_CREATED_NEW_KEY)
+    if (catalog_loaded)
+    {
+        /* faces from the catalog are already in the list, so this only picks up new entries */
+        load_registry_fonts();
+    }
+    else if (disposition != REG_CREATED_NEW_KEY)
     {
         load_registry_fonts();
         load_font_list_from_cache();
+
+        /* the catalog is missing or stale, rebuild it for the next processes */
+        NtWaitForSingleObject( mutex, FALSE, NULL );
+        save_font_catalog();
+        NtReleaseMutant( mutex, NULL );
     }
 
+    TRACE( "font list loaded in %u ms%s\n", NtGetTickCount() - start_time,
+           catalog_loaded ? " from catalog" : "" );
+
     reorder_font_list();
     load_gdi_font_subst();
     load_gdi_font_replacements();
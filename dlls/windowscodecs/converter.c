@@ -19,6 +19,9 @@
 
 #include <stdarg.h>
 #include <math.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #define COBJMACROS
 
@@ -131,6 +134,230 @@ static void to_sRGB(BYTE *bgr)
 }
 #endif
 
+/* to_sRGB_component() of a linear value, scaled and rounded to a byte.
+ * Values between 0 and 1 are looked up: the coarse table gives the result
+ * at the start of the interval containing the value, and the thresholds,
+ * the smallest values giving each result, are used to refine it. */
+#define SRGB_TABLE_SIZE 4096
+
+static BYTE srgb_coarse[SRGB_TABLE_SIZE + 1];
+static float srgb_threshold[256];
+static INIT_ONCE srgb_init_once = INIT_ONCE_STATIC_INIT;
+
+static inline BYTE to_sRGB_byte_slow(float f)
+{
+    return (BYTE)floorf(to_sRGB_component(f) * 255.0f + 0.51f);
+}
+
+static BOOL WINAPI init_srgb_tables(INIT_ONCE *once, void *param, void **context)
+{
+    union { float f; DWORD i; } lo, hi, mid, one;
+    UINT i, v;
+
+    for (i = 0; i <= SRGB_TABLE_SIZE; i++)
+        srgb_coarse[i] = to_sRGB_byte_slow((float)i / SRGB_TABLE_SIZE);
+
+    /* non-negative floats are ordered like their bit patterns */
+    one.f = 1.0f;
+    srgb_threshold[0] = 0.0f;
+    for (v = 1; v < 256; v++)
+    {
+        lo.f = srgb_threshold[v - 1];
+        hi.i = one.i + 1;
+        while (lo.i < hi.i)
+        {
+            mid.i = lo.i + (hi.i - lo.i) / 2;
+            if (to_sRGB_byte_slow(mid.f) >= v) hi.i = mid.i;
+            else lo.i = mid.i + 1;
+        }
+        srgb_threshold[v] = lo.f;
+    }
+    return TRUE;
+}
+
+/* init_srgb_tables() must have been called */
+static inline BYTE to_sRGB_byte(float f)
+{
+    BYTE v;
+
+    if (!(f >= 0.0f && f <= 1.0f)) return to_sRGB_byte_slow(f);
+
+    v = srgb_coarse[(UINT)(f * SRGB_TABLE_SIZE)];
+    while (v < 255 && f >= srgb_threshold[v + 1]) v++;
+    return v;
+}
+
+/* The row helpers below convert a whole scanline at a time. */
+
+static void set_alpha_row(BYTE *row, UINT width)
+{
+    DWORD *pixel = (DWORD *)row;
+    UINT x = 0;
+#ifdef __SSE2__
+    const __m128i alpha = _mm_set1_epi32(0xff000000);
+
+    for (; x + 4 <= width; x += 4)
+        _mm_storeu_si128((__m128i *)(pixel + x),
+                         _mm_or_si128(_mm_loadu_si128((const __m128i *)(pixel + x)), alpha));
+#endif
+    for (; x < width; x++)
+        pixel[x] |= 0xff000000;
+}
+
+static inline DWORD swap_red_blue(DWORD pixel)
+{
+    return (pixel & 0xff00ff00) | ((pixel & 0xff) << 16) | ((pixel >> 16) & 0xff);
+}
+
+#ifdef __SSE2__
+static inline __m128i swap_red_blue_sse2(__m128i pixels)
+{
+    const __m128i mask = _mm_set1_epi32(0x00ff00ff);
+    __m128i rb = _mm_and_si128(pixels, mask);
+
+    return _mm_or_si128(_mm_andnot_si128(mask, pixels),
+                        _mm_or_si128(_mm_slli_epi32(rb, 16), _mm_srli_epi32(rb, 16)));
+}
+#endif
+
+/* 32bppBGRA <-> 32bppRGBA */
+static void swap_red_blue_row(BYTE *row, UINT width)
+{
+    DWORD *pixel = (DWORD *)row;
+    UINT x = 0;
+#ifdef __SSE2__
+    for (; x + 4 <= width; x += 4)
+        _mm_storeu_si128((__m128i *)(pixel + x),
+                         swap_red_blue_sse2(_mm_loadu_si128((const __m128i *)(pixel + x))));
+#endif
+    for (; x < width; x++)
+        pixel[x] = swap_red_blue(pixel[x]);
+}
+
+/* c * alpha / 255, exact for c * alpha <= 65534 */
+static inline UINT mul_div_255(UINT c, UINT alpha)
+{
+    UINT x = c * alpha;
+    return (x + 1 + (x >> 8)) >> 8;
+}
+
+static void premultiply_row(BYTE *row, UINT width)
+{
+    BYTE *pixel = row;
+    UINT x = 0;
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128(), alpha_mask = _mm_set1_epi32(0xff000000);
+    const __m128i one = _mm_set1_epi16(1);
+
+    for (; x + 4 <= width; x += 4, pixel += 16)
+    {
+        __m128i src = _mm_loadu_si128((const __m128i *)pixel);
+        __m128i lo = _mm_unpacklo_epi8(src, zero), hi = _mm_unpackhi_epi8(src, zero);
+        __m128i alpha_lo = _mm_shufflehi_epi16(_mm_shufflelo_epi16(lo, 0xff), 0xff);
+        __m128i alpha_hi = _mm_shufflehi_epi16(_mm_shufflelo_epi16(hi, 0xff), 0xff);
+
+        lo = _mm_mullo_epi16(lo, alpha_lo);
+        hi = _mm_mullo_epi16(hi, alpha_hi);
+        lo = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(lo, one), _mm_srli_epi16(lo, 8)), 8);
+        hi = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(hi, one), _mm_srli_epi16(hi, 8)), 8);
+        _mm_storeu_si128((__m128i *)pixel, _mm_or_si128(_mm_andnot_si128(alpha_mask, _mm_packus_epi16(lo, hi)),
+                                                        _mm_and_si128(src, alpha_mask)));
+    }
+#endif
+    for (; x < width; x++, pixel += 4)
+    {
+        BYTE alpha = pixel[3];
+        if (alpha != 255)
+        {
+            pixel[0] = mul_div_255(pixel[0], alpha);
+            pixel[1] = mul_div_255(pixel[1], alpha);
+            pixel[2] = mul_div_255(pixel[2], alpha);
+        }
+    }
+}
+
+static void unpremultiply_row(BYTE *row, UINT width)
+{
+    BYTE *pixel = row;
+    UINT x;
+
+    for (x = 0; x < width; x++, pixel += 4)
+    {
+        BYTE alpha = pixel[3];
+        if (alpha != 0 && alpha != 255)
+        {
+            /* same as c * 255 / alpha for all c and alpha */
+            UINT recip = (255 << 16) / alpha + 1;
+
+            pixel[0] = (pixel[0] * recip) >> 16;
+            pixel[1] = (pixel[1] * recip) >> 16;
+            pixel[2] = (pixel[2] * recip) >> 16;
+        }
+    }
+}
+
+/* 24bppBGR -> 32bppBGRA, or 24bppRGB -> 32bppBGRA if swap is set */
+static void convert_24bpp_to_32bpp_row(const BYTE *src, BYTE *dst, UINT width, BOOL swap)
+{
+    DWORD *pixel = (DWORD *)dst;
+    UINT x;
+
+    if (swap)
+        for (x = 0; x < width; x++, src += 3)
+            pixel[x] = 0xff000000 | (src[0] << 16) | (src[1] << 8) | src[2];
+    else
+        for (x = 0; x < width; x++, src += 3)
+            pixel[x] = 0xff000000 | (src[2] << 16) | (src[1] << 8) | src[0];
+}
+
+/* 32bppBGR(A) -> 24bppBGR, or -> 24bppRGB if swap is set */
+static void convert_32bpp_to_24bpp_row(const BYTE *src, BYTE *dst, UINT width, BOOL swap)
+{
+    UINT x;
+
+    if (swap)
+        for (x = 0; x < width; x++, src += 4, dst += 3)
+        {
+            dst[0] = src[2];
+            dst[1] = src[1];
+            dst[2] = src[0];
+        }
+    else
+        for (x = 0; x < width; x++, src += 4, dst += 3)
+        {
+            dst[0] = src[0];
+            dst[1] = src[1];
+            dst[2] = src[2];
+        }
+}
+
+/* 48bppRGB -> 32bppBGRA, keeping the high byte of each channel */
+static void convert_48bppRGB_row(const BYTE *src, BYTE *dst, UINT width)
+{
+    DWORD *pixel = (DWORD *)dst;
+    UINT x;
+
+    for (x = 0; x < width; x++, src += 6)
+        pixel[x] = 0xff000000 | (src[1] << 16) | (src[3] << 8) | src[5];
+}
+
+/* 64bppRGBA -> 32bppBGRA, keeping the high byte of each channel */
+static void convert_64bppRGBA_row(const BYTE *src, BYTE *dst, UINT width)
+{
+    DWORD *pixel = (DWORD *)dst;
+    UINT x = 0;
+#ifdef __SSE2__
+    for (; x + 4 <= width; x += 4, src += 32)
+    {
+        __m128i lo = _mm_srli_epi16(_mm_loadu_si128((const __m128i *)src), 8);
+        __m128i hi = _mm_srli_epi16(_mm_loadu_si128((const __m128i *)(src + 16)), 8);
+        _mm_storeu_si128((__m128i *)(pixel + x), swap_red_blue_sse2(_mm_packus_epi16(lo, hi)));
+    }
+#endif
+    for (; x < width; x++, src += 8)
+        pixel[x] = (src[7] << 24) | (src[1] << 16) | (src[3] << 8) | src[5];
+}
+
 static inline FormatConverter *impl_from_IWICFormatConverter(IWICFormatConverter *iface)
 {
     return CONTAINING_RECORD(iface, FormatConverter, IWICFormatConverter_iface);
@@ -618,13 +845,11 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
         if (prc)
         {
             HRESULT res;
-            INT x, y;
+            INT y;
             BYTE *srcdata;
             UINT srcstride, srcdatasize;
             const BYTE *srcrow;
-            const BYTE *srcpixel;
             BYTE *dstrow;
-            BYTE *dstpixel;
 
             srcstride = 3 * prc->Width;
             srcdatasize = srcstride * prc->Height;
@@ -639,14 +864,7 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
                 srcrow = srcdata;
                 dstrow = pbBuffer;
                 for (y=0; y<prc->Height; y++) {
-                    srcpixel=srcrow;
-                    dstpixel=dstrow;
-                    for (x=0; x<prc->Width; x++) {
-                        *dstpixel++=*srcpixel++; /* blue */
-                        *dstpixel++=*srcpixel++; /* green */
-                        *dstpixel++=*srcpixel++; /* red */
-                        *dstpixel++=255; /* alpha */
-                    }
+                    convert_24bpp_to_32bpp_row(srcrow, dstrow, prc->Width, FALSE);
                     srcrow += srcstride;
                     dstrow += cbStride;
                 }
@@ -661,14 +879,11 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
         if (prc)
         {
             HRESULT res;
-            INT x, y;
+            INT y;
             BYTE *srcdata;
             UINT srcstride, srcdatasize;
             const BYTE *srcrow;
-            const BYTE *srcpixel;
             BYTE *dstrow;
-            BYTE *dstpixel;
-            BYTE tmppixel[3];
 
             srcstride = 3 * prc->Width;
             srcdatasize = srcstride * prc->Height;
@@ -683,18 +898,7 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
                 srcrow = srcdata;
                 dstrow = pbBuffer;
                 for (y=0; y<prc->Height; y++) {
-                    srcpixel=srcrow;
-                    dstpixel=dstrow;
-                    for (x=0; x<prc->Width; x++) {
-                        tmppixel[0]=*srcpixel++; /* red */
-                        tmppixel[1]=*srcpixel++; /* green */
-                        tmppixel[2]=*srcpixel++; /* blue */
-
-                        *dstpixel++=tmppixel[2]; /* blue */
-                        *dstpixel++=tmppixel[1]; /* green */
-                        *dstpixel++=tmppixel[0]; /* red */
-                        *dstpixel++=255; /* alpha */
-                    }
+                    convert_24bpp_to_32bpp_row(srcrow, dstrow, prc->Width, TRUE);
                     srcrow += srcstride;
                     dstrow += cbStride;
                 }
@@ -709,24 +913,26 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
         if (prc)
         {
             HRESULT res;
-            INT x, y;
+            INT y;
 
             res = IWICBitmapSource_CopyPixels(This->source, prc, cbStride, cbBufferSize, pbBuffer);
             if (FAILED(res)) return res;
 
             /* set all alpha values to 255 */
             for (y=0; y<prc->Height; y++)
-                for (x=0; x<prc->Width; x++)
-                    pbBuffer[cbStride*y+4*x+3] = 0xff;
+                set_alpha_row(pbBuffer + cbStride * y, prc->Width);
         }
         return S_OK;
     case format_32bppRGBA:
         if (prc)
         {
             HRESULT res;
+            INT y;
+
             res = IWICBitmapSource_CopyPixels(This->source, prc, cbStride, cbBufferSize, pbBuffer);
             if (FAILED(res)) return res;
-            reverse_bgr8(4, pbBuffer, prc->Width, prc->Height, cbStride);
+            for (y=0; y<prc->Height; y++)
+                swap_red_blue_row(pbBuffer + cbStride * y, prc->Width);
         }
         return S_OK;
     case format_32bppBGRA:
@@ -737,35 +943,24 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
         if (prc)
         {
             HRESULT res;
-            INT x, y;
+            INT y;
 
             res = IWICBitmapSource_CopyPixels(This->source, prc, cbStride, cbBufferSize, pbBuffer);
             if (FAILED(res)) return res;
 
             for (y=0; y<prc->Height; y++)
-                for (x=0; x<prc->Width; x++)
-                {
-                    BYTE alpha = pbBuffer[cbStride*y+4*x+3];
-                    if (alpha != 0 && alpha != 255)
-                    {
-                        pbBuffer[cbStride*y+4*x] = pbBuffer[cbStride*y+4*x] * 255 / alpha;
-                        pbBuffer[cbStride*y+4*x+1] = pbBuffer[cbStride*y+4*x+1] * 255 / alpha;
-                        pbBuffer[cbStride*y+4*x+2] = pbBuffer[cbStride*y+4*x+2] * 255 / alpha;
-                    }
-                }
+                unpremultiply_row(pbBuffer + cbStride * y, prc->Width);
         }
         return S_OK;
     case format_48bppRGB:
         if (prc)
         {
             HRESULT res;
-            INT x, y;
+            INT y;
             BYTE *srcdata;
             UINT srcstride, srcdatasize;
             const BYTE *srcrow;
-            const BYTE *srcpixel;
             BYTE *dstrow;
-            DWORD *dstpixel;
 
             srcstride = 6 * prc->Width;
             srcdatasize = srcstride * prc->Height;
@@ -780,15 +975,7 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
                 srcrow = srcdata;
                 dstrow = pbBuffer;
                 for (y=0; y<prc->Height; y++) {
-                    srcpixel=srcrow;
-                    dstpixel=(DWORD*)dstrow;
-                    for (x=0; x<prc->Width; x++) {
-                        BYTE red, green, blue;
-                        srcpixel++; red = *srcpixel++;
-                        srcpixel++; green = *srcpixel++;
-                        srcpixel++; blue = *srcpixel++;
-                        *dstpixel++=0xff000000|red<<16|green<<8|blue;
-                    }
+                    convert_48bppRGB_row(srcrow, dstrow, prc->Width);
                     srcrow += srcstride;
                     dstrow += cbStride;
                 }
@@ -803,13 +990,11 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
         if (prc)
         {
             HRESULT res;
-            INT x, y;
+            INT y;
             BYTE *srcdata;
             UINT srcstride, srcdatasize;
             const BYTE *srcrow;
-            const BYTE *srcpixel;
             BYTE *dstrow;
-            DWORD *dstpixel;
 
             srcstride = 8 * prc->Width;
             srcdatasize = srcstride * prc->Height;
@@ -824,16 +1009,7 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
                 srcrow = srcdata;
                 dstrow = pbBuffer;
                 for (y=0; y<prc->Height; y++) {
-                    srcpixel=srcrow;
-                    dstpixel=(DWORD*)dstrow;
-                    for (x=0; x<prc->Width; x++) {
-                        BYTE red, green, blue, alpha;
-                        srcpixel++; red = *srcpixel++;
-                        srcpixel++; green = *srcpixel++;
-                        srcpixel++; blue = *srcpixel++;
-                        srcpixel++; alpha = *srcpixel++;
-                        *dstpixel++=alpha<<24|red<<16|green<<8|blue;
-                    }
+                    convert_64bppRGBA_row(srcrow, dstrow, prc->Width);
                     srcrow += srcstride;
                     dstrow += cbStride;
                 }
@@ -881,15 +1057,14 @@ static HRESULT copypixels_to_32bppRGBA(struct FormatConverter *This, const WICRe
     case format_32bppRGB:
         if (prc)
         {
-            INT x, y;
+            INT y;
 
             hr = IWICBitmapSource_CopyPixels(This->source, prc, cbStride, cbBufferSize, pbBuffer);
             if (FAILED(hr)) return hr;
 
             /* set all alpha values to 255 */
             for (y=0; y<prc->Height; y++)
-                for (x=0; x<prc->Width; x++)
-                    pbBuffer[cbStride*y+4*x+3] = 0xff;
+                set_alpha_row(pbBuffer + cbStride * y, prc->Width);
         }
         return S_OK;
 
@@ -901,29 +1076,25 @@ static HRESULT copypixels_to_32bppRGBA(struct FormatConverter *This, const WICRe
     case format_32bppPRGBA:
         if (prc)
         {
-            INT x, y;
+            INT y;
 
             hr = IWICBitmapSource_CopyPixels(This->source, prc, cbStride, cbBufferSize, pbBuffer);
             if (FAILED(hr)) return hr;
 
             for (y=0; y<prc->Height; y++)
-                for (x=0; x<prc->Width; x++)
-                {
-                    BYTE alpha = pbBuffer[cbStride*y+4*x+3];
-                    if (alpha != 0 && alpha != 255)
-                    {
-                        pbBuffer[cbStride*y+4*x] = pbBuffer[cbStride*y+4*x] * 255 / alpha;
-                        pbBuffer[cbStride*y+4*x+1] = pbBuffer[cbStride*y+4*x+1] * 255 / alpha;
-                        pbBuffer[cbStride*y+4*x+2] = pbBuffer[cbStride*y+4*x+2] * 255 / alpha;
-                    }
-                }
+                unpremultiply_row(pbBuffer + cbStride * y, prc->Width);
         }
         return S_OK;
 
     default:
         hr = copypixels_to_32bppBGRA(This, prc, cbStride, cbBufferSize, pbBuffer, source_format);
         if (SUCCEEDED(hr) && prc)
-              reverse_bgr8(4, pbBuffer, prc->Width, prc->Height, cbStride);
+        {
+            INT y;
+
+            for (y=0; y<prc->Height; y++)
+                swap_red_blue_row(pbBuffer + cbStride * y, prc->Width);
+        }
         return hr;
     }
 }
@@ -975,19 +1146,10 @@ static HRESULT copypixels_to_32bppPBGRA(struct FormatConverter *This, const WICR
         hr = copypixels_to_32bppBGRA(This, prc, cbStride, cbBufferSize, pbBuffer, source_format);
         if (SUCCEEDED(hr) && prc)
         {
-            INT x, y;
+            INT y;
 
             for (y=0; y<prc->Height; y++)
-                for (x=0; x<prc->Width; x++)
-                {
-                    BYTE alpha = pbBuffer[cbStride*y+4*x+3];
-                    if (alpha != 255)
-                    {
-                        pbBuffer[cbStride*y+4*x] = pbBuffer[cbStride*y+4*x] * alpha / 255;
-                        pbBuffer[cbStride*y+4*x+1] = pbBuffer[cbStride*y+4*x+1] * alpha / 255;
-                        pbBuffer[cbStride*y+4*x+2] = pbBuffer[cbStride*y+4*x+2] * alpha / 255;
-                    }
-                }
+                premultiply_row(pbBuffer + cbStride * y, prc->Width);
         }
         return hr;
     }
@@ -1008,19 +1170,10 @@ static HRESULT copypixels_to_32bppPRGBA(struct FormatConverter *This, const WICR
         hr = copypixels_to_32bppRGBA(This, prc, cbStride, cbBufferSize, pbBuffer, source_format);
         if (SUCCEEDED(hr) && prc)
         {
-            INT x, y;
+            INT y;
 
             for (y=0; y<prc->Height; y++)
-                for (x=0; x<prc->Width; x++)
-                {
-                    BYTE alpha = pbBuffer[cbStride*y+4*x+3];
-                    if (alpha != 255)
-                    {
-                        pbBuffer[cbStride*y+4*x] = pbBuffer[cbStride*y+4*x] * alpha / 255;
-                        pbBuffer[cbStride*y+4*x+1] = pbBuffer[cbStride*y+4*x+1] * alpha / 255;
-                        pbBuffer[cbStride*y+4*x+2] = pbBuffer[cbStride*y+4*x+2] * alpha / 255;
-                    }
-                }
+                premultiply_row(pbBuffer + cbStride * y, prc->Width);
         }
         return hr;
     }
@@ -1050,13 +1203,11 @@ static HRESULT copypixels_to_24bppBGR(struct FormatConverter *This, const WICRec
         if (prc)
         {
             HRESULT res;
-            INT x, y;
+            INT y;
             BYTE *srcdata;
             UINT srcstride, srcdatasize;
             const BYTE *srcrow;
-            const BYTE *srcpixel;
             BYTE *dstrow;
-            BYTE *dstpixel;
 
             srcstride = 4 * prc->Width;
             srcdatasize = srcstride * prc->Height;
@@ -1071,37 +1222,11 @@ static HRESULT copypixels_to_24bppBGR(struct FormatConverter *This, const WICRec
                 srcrow = srcdata;
                 dstrow = pbBuffer;
 
-                if (source_format == format_32bppRGBA)
-                {
-                    for (y = 0; y < prc->Height; y++)
-                    {
-                        srcpixel = srcrow;
-                        dstpixel = dstrow;
-                        for (x = 0; x < prc->Width; x++) {
-                            *dstpixel++ = srcpixel[2]; /* blue */
-                            *dstpixel++ = srcpixel[1]; /* green */
-                            *dstpixel++ = srcpixel[0]; /* red */
-                            srcpixel += 4;
-                        }
-                        srcrow += srcstride;
-                        dstrow += cbStride;
-                    }
-                }
-                else
+                for (y = 0; y < prc->Height; y++)
                 {
-                    for (y = 0; y < prc->Height; y++)
-                    {
-                        srcpixel = srcrow;
-                        dstpixel = dstrow;
-                        for (x = 0; x < prc->Width; x++) {
-                            *dstpixel++ = *srcpixel++; /* blue */
-                            *dstpixel++ = *srcpixel++; /* green */
-                            *dstpixel++ = *srcpixel++; /* red */
-                            srcpixel++; /* alpha */
-                        }
-                        srcrow += srcstride;
-                        dstrow += cbStride;
-                    }
+                    convert_32bpp_to_24bpp_row(srcrow, dstrow, prc->Width, source_format == format_32bppRGBA);
+                    srcrow += srcstride;
+                    dstrow += cbStride;
                 }
             }
 
@@ -1130,6 +1255,8 @@ static HRESULT copypixels_to_24bppBGR(struct FormatConverter *This, const WICRec
                 INT x, y;
                 BYTE *src = srcdata, *dst = pbBuffer;
 
+                InitOnceExecuteOnce(&srgb_init_once, init_srgb_tables, NULL, NULL);
+
                 for (y = 0; y < prc->Height; y++)
                 {
                     float *gray_float = (float *)src;
@@ -1137,7 +1264,7 @@ static HRESULT copypixels_to_24bppBGR(struct FormatConverter *This, const WICRec
 
                     for (x = 0; x < prc->Width; x++)
                     {
-                        BYTE gray = (BYTE)floorf(to_sRGB_component(gray_float[x]) * 255.0f + 0.51f);
+                        BYTE gray = to_sRGB_byte(gray_float[x]);
                         *bgr++ = gray;
                         *bgr++ = gray;
                         *bgr++ = gray;
@@ -1224,14 +1351,11 @@ static HRESULT copypixels_to_24bppRGB(struct FormatConverter *This, const WICRec
         if (prc)
         {
             HRESULT res;
-            INT x, y;
+            INT y;
             BYTE *srcdata;
             UINT srcstride, srcdatasize;
             const BYTE *srcrow;
-            const BYTE *srcpixel;
             BYTE *dstrow;
-            BYTE *dstpixel;
-            BYTE tmppixel[3];
 
             srcstride = 4 * prc->Width;
             srcdatasize = srcstride * prc->Height;
@@ -1246,18 +1370,7 @@ static HRESULT copypixels_to_24bppRGB(struct FormatConverter *This, const WICRec
                 srcrow = srcdata;
                 dstrow = pbBuffer;
                 for (y=0; y<prc->Height; y++) {
-                    srcpixel=srcrow;
-                    dstpixel=dstrow;
-                    for (x=0; x<prc->Width; x++) {
-                        tmppixel[0]=*srcpixel++; /* blue */
-                        tmppixel[1]=*srcpixel++; /* green */
-                        tmppixel[2]=*srcpixel++; /* red */
-                        srcpixel++; /* alpha */
-
-                        *dstpixel++=tmppixel[2]; /* red */
-                        *dstpixel++=tmppixel[1]; /* green */
-                        *dstpixel++=tmppixel[0]; /* blue */
-                    }
+                    convert_32bpp_to_24bpp_row(srcrow, dstrow, prc->Width, TRUE);
                     srcrow += srcstride;
                     dstrow += cbStride;
                 }
@@ -1350,13 +1463,15 @@ static HRESULT copypixels_to_8bppGray(struct FormatConverter *This, const WICRec
                 INT x, y;
                 BYTE *src = srcdata, *dst = pbBuffer;
 
+                InitOnceExecuteOnce(&srgb_init_once, init_srgb_tables, NULL, NULL);
+
                 for (y=0; y < prc->Height; y++)
                 {
                     float *srcpixel = (float*)src;
                     BYTE *dstpixel = dst;
 
                     for (x=0; x < prc->Width; x++)
-                        *dstpixel++ = (BYTE)floorf(to_sRGB_component(*srcpixel++) * 255.0f + 0.51f);
+                        *dstpixel++ = to_sRGB_byte(*srcpixel++);
 
                     src += srcstride;
                     dst += cbStride;
@@ -1384,6 +1499,8 @@ static HRESULT copypixels_to_8bppGray(struct FormatConverter *This, const WICRec
         INT x, y;
         BYTE *src = srcdata, *dst = pbBuffer;
 
+        InitOnceExecuteOnce(&srgb_init_once, init_srgb_tables, NULL, NULL);
+
         for (y = 0; y < prc->Height; y++)
         {
             BYTE *bgr = src;
@@ -1392,8 +1509,7 @@ static HRESULT copypixels_to_8bppGray(struct FormatConverter *This, const WICRec
             {
                 float gray = (bgr[2] * 0.2126f + bgr[1] * 0.7152f + bgr[0] * 0.0722f) / 255.0f;
 
-                gray = to_sRGB_component(gray) * 255.0f;
-                dst[x] = (BYTE)floorf(gray + 0.51f);
+                dst[x] = to_sRGB_byte(gray);
                 bgr += 3;
             }
             src += srcstride;
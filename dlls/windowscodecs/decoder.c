@@ -245,6 +245,7 @@ static const IWICBitmapDecoderVtbl CommonDecoder_Vtbl = {
 typedef struct {
     IWICBitmapFrameDecode IWICBitmapFrameDecode_iface;
     IWICMetadataBlockReader IWICMetadataBlockReader_iface;
+    IWICBitmapSourceTransform IWICBitmapSourceTransform_iface;
     LONG ref;
     CommonDecoder *parent;
     DWORD frame;
@@ -264,6 +265,11 @@ static inline CommonDecoderFrame *impl_from_IWICMetadataBlockReader(IWICMetadata
     return CONTAINING_RECORD(iface, CommonDecoderFrame, IWICMetadataBlockReader_iface);
 }
 
+static inline CommonDecoderFrame *impl_from_IWICBitmapSourceTransform(IWICBitmapSourceTransform *iface)
+{
+    return CONTAINING_RECORD(iface, CommonDecoderFrame, IWICBitmapSourceTransform_iface);
+}
+
 static HRESULT WINAPI CommonDecoderFrame_QueryInterface(IWICBitmapFrameDecode *iface, REFIID iid,
     void **ppv)
 {
@@ -281,6 +287,11 @@ static HRESULT WINAPI CommonDecoderFrame_QueryInterface(IWICBitmapFrameDecode *i
     {
         *ppv = &This->IWICMetadataBlockReader_iface;
     }
+    else if (IsEqualIID(&IID_IWICBitmapSourceTransform, iid) &&
+             (This->parent->file_info.flags & DECODER_FLAGS_SUPPORTS_SCALING))
+    {
+        *ppv = &This->IWICBitmapSourceTransform_iface;
+    }
     else
     {
         *ppv = NULL;
@@ -714,6 +725,115 @@ static const IWICMetadataBlockReaderVtbl CommonDecoderFrame_BlockVtbl = {
     CommonDecoderFrame_Block_GetEnumerator,
 };
 
+static HRESULT WINAPI CommonDecoderFrame_Transform_QueryInterface(IWICBitmapSourceTransform *iface,
+    REFIID iid, void **ppv)
+{
+    CommonDecoderFrame *This = impl_from_IWICBitmapSourceTransform(iface);
+    return IWICBitmapFrameDecode_QueryInterface(&This->IWICBitmapFrameDecode_iface, iid, ppv);
+}
+
+static ULONG WINAPI CommonDecoderFrame_Transform_AddRef(IWICBitmapSourceTransform *iface)
+{
+    CommonDecoderFrame *This = impl_from_IWICBitmapSourceTransform(iface);
+    return IWICBitmapFrameDecode_AddRef(&This->IWICBitmapFrameDecode_iface);
+}
+
+static ULONG WINAPI CommonDecoderFrame_Transform_Release(IWICBitmapSourceTransform *iface)
+{
+    CommonDecoderFrame *This = impl_from_IWICBitmapSourceTransform(iface);
+    return IWICBitmapFrameDecode_Release(&This->IWICBitmapFrameDecode_iface);
+}
+
+static HRESULT WINAPI CommonDecoderFrame_Transform_CopyPixels(IWICBitmapSourceTransform *iface,
+    const WICRect *prc, UINT width, UINT height, WICPixelFormatGUID *format,
+    WICBitmapTransformOptions transform, UINT stride, UINT buffersize, BYTE *buffer)
+{
+    CommonDecoderFrame *This = impl_from_IWICBitmapSourceTransform(iface);
+    HRESULT hr;
+
+    TRACE("(%p,%s,%u,%u,%s,%#x,%u,%u,%p)\n", iface, debug_wic_rect(prc), width, height,
+        debugstr_guid(format), transform, stride, buffersize, buffer);
+
+    if (!buffer)
+        return E_POINTER;
+
+    if (format && !IsEqualGUID(format, &This->decoder_frame.pixel_format))
+        return WINCODEC_ERR_UNSUPPORTEDPIXELFORMAT;
+
+    if (transform != WICBitmapTransformRotate0)
+    {
+        FIXME("unsupported transform %#x\n", transform);
+        return WINCODEC_ERR_UNSUPPORTEDOPERATION;
+    }
+
+    EnterCriticalSection(&This->parent->lock);
+
+    /* width and height have to be a size returned by GetClosestSize, the
+     * decoder then produces the scaled pixels directly */
+    hr = decoder_copy_pixels_scaled(This->parent->decoder, This->frame, width, height,
+        prc, stride, buffersize, buffer);
+
+    LeaveCriticalSection(&This->parent->lock);
+
+    return hr;
+}
+
+static HRESULT WINAPI CommonDecoderFrame_Transform_GetClosestSize(IWICBitmapSourceTransform *iface,
+    UINT *width, UINT *height)
+{
+    CommonDecoderFrame *This = impl_from_IWICBitmapSourceTransform(iface);
+    HRESULT hr;
+
+    TRACE("(%p,%p,%p)\n", iface, width, height);
+
+    if (!width || !height)
+        return E_INVALIDARG;
+
+    EnterCriticalSection(&This->parent->lock);
+
+    hr = decoder_get_closest_size(This->parent->decoder, This->frame, width, height);
+
+    LeaveCriticalSection(&This->parent->lock);
+
+    return hr;
+}
+
+static HRESULT WINAPI CommonDecoderFrame_Transform_GetClosestPixelFormat(IWICBitmapSourceTransform *iface,
+    WICPixelFormatGUID *format)
+{
+    CommonDecoderFrame *This = impl_from_IWICBitmapSourceTransform(iface);
+
+    TRACE("(%p,%p)\n", iface, format);
+
+    if (!format)
+        return E_INVALIDARG;
+
+    *format = This->decoder_frame.pixel_format;
+    return S_OK;
+}
+
+static HRESULT WINAPI CommonDecoderFrame_Transform_DoesSupportTransform(IWICBitmapSourceTransform *iface,
+    WICBitmapTransformOptions transform, BOOL *supported)
+{
+    TRACE("(%p,%#x,%p)\n", iface, transform, supported);
+
+    if (!supported)
+        return E_INVALIDARG;
+
+    *supported = (transform == WICBitmapTransformRotate0);
+    return S_OK;
+}
+
+static const IWICBitmapSourceTransformVtbl CommonDecoderFrame_TransformVtbl = {
+    CommonDecoderFrame_Transform_QueryInterface,
+    CommonDecoderFrame_Transform_AddRef,
+    CommonDecoderFrame_Transform_Release,
+    CommonDecoderFrame_Transform_CopyPixels,
+    CommonDecoderFrame_Transform_GetClosestSize,
+    CommonDecoderFrame_Transform_GetClosestPixelFormat,
+    CommonDecoderFrame_Transform_DoesSupportTransform
+};
+
 static HRESULT WINAPI CommonDecoder_GetFrame(IWICBitmapDecoder *iface,
     UINT index, IWICBitmapFrameDecode **ppIBitmapFrame)
 {
@@ -742,6 +862,7 @@ static HRESULT WINAPI CommonDecoder_GetFrame(IWICBitmapDecoder *iface,
     {
         result->IWICBitmapFrameDecode_iface.lpVtbl = &CommonDecoderFrameVtbl;
         result->IWICMetadataBlockReader_iface.lpVtbl = &CommonDecoderFrame_BlockVtbl;
+        result->IWICBitmapSourceTransform_iface.lpVtbl = &CommonDecoderFrame_TransformVtbl;
         result->ref = 1;
         result->parent = This;
         result->frame = index;
@@ -78,8 +78,13 @@ struct jpeg_decoder {
     struct jpeg_error_mgr jerr;
     struct jpeg_source_mgr source_mgr;
     BYTE source_buffer[1024];
+    ULONGLONG stream_pos; /* stream position matching the source buffer */
+    BOOL decompress_started;
+    UINT scale; /* DCT scaling denominator of the running decompression */
+    BYTE *row_buffer; /* rec_outbuf_height rows of output */
     UINT stride;
-    BYTE *image_data;
+    BYTE *image_data; /* whole frame, only used for out of order access */
+    UINT image_scale;
 };
 
 static inline struct jpeg_decoder *impl_from_decoder(struct decoder* iface)
@@ -97,6 +102,7 @@ static void CDECL jpeg_decoder_destroy(struct decoder* iface)
     struct jpeg_decoder *This = impl_from_decoder(iface);
 
     if (This->cinfo_initialized) jpeg_destroy_decompress(&This->cinfo);
+    free(This->row_buffer);
     free(This->image_data);
     RtlFreeHeap(GetProcessHeap(), 0, This);
 }
@@ -145,44 +151,13 @@ static void source_mgr_term_source(j_decompress_ptr cinfo)
 {
 }
 
-static HRESULT CDECL jpeg_decoder_initialize(struct decoder* iface, IStream *stream, struct decoder_stat *st)
+/* Must be called with a jmp_buf set up in cinfo.client_data. */
+static HRESULT jpeg_decoder_read_header(struct jpeg_decoder *This)
 {
-    struct jpeg_decoder *This = impl_from_decoder(iface);
     int ret;
-    jmp_buf jmpbuf;
-    UINT data_size, i;
-
-    if (This->cinfo_initialized)
-        return WINCODEC_ERR_WRONGSTATE;
-
-    jpeg_std_error(&This->jerr);
-
-    This->jerr.error_exit = error_exit_fn;
-    This->jerr.emit_message = emit_message_fn;
-
-    This->cinfo.err = &This->jerr;
-
-    This->cinfo.client_data = jmpbuf;
-
-    if (setjmp(jmpbuf))
-        return E_FAIL;
-
-    jpeg_CreateDecompress(&This->cinfo, JPEG_LIB_VERSION, sizeof(struct jpeg_decompress_struct));
-
-    This->cinfo_initialized = TRUE;
-
-    This->stream = stream;
 
     stream_seek(This->stream, 0, STREAM_SEEK_SET, NULL);
-
     This->source_mgr.bytes_in_buffer = 0;
-    This->source_mgr.init_source = source_mgr_init_source;
-    This->source_mgr.fill_input_buffer = source_mgr_fill_input_buffer;
-    This->source_mgr.skip_input_data = source_mgr_skip_input_data;
-    This->source_mgr.resync_to_restart = jpeg_resync_to_restart;
-    This->source_mgr.term_source = source_mgr_term_source;
-
-    This->cinfo.src = &This->source_mgr;
 
     ret = jpeg_read_header(&This->cinfo, TRUE);
 
@@ -215,81 +190,285 @@ static HRESULT CDECL jpeg_decoder_initialize(struct decoder* iface, IStream *str
         return E_FAIL;
     }
 
+    return S_OK;
+}
+
+/* Restart decompression from the beginning of the stream, with the output
+ * scaled down by 1/scale. Must be called with a jmp_buf set up. */
+static HRESULT jpeg_decoder_start(struct jpeg_decoder *This, UINT scale)
+{
+    HRESULT hr;
+
+    jpeg_abort_decompress(&This->cinfo);
+    This->decompress_started = FALSE;
+
+    hr = jpeg_decoder_read_header(This);
+    if (FAILED(hr))
+        return hr;
+
+    This->cinfo.scale_num = 1;
+    This->cinfo.scale_denom = scale;
+
     if (!jpeg_start_decompress(&This->cinfo))
     {
         ERR("jpeg_start_decompress failed\n");
         return E_FAIL;
     }
 
-    This->frame.width = This->cinfo.output_width;
-    This->frame.height = This->cinfo.output_height;
-
-    switch (This->cinfo.density_unit)
-    {
-    case 2: /* pixels per centimeter */
-        This->frame.dpix = This->cinfo.X_density * 2.54;
-        This->frame.dpiy = This->cinfo.Y_density * 2.54;
-        break;
+    This->stride = (This->frame.bpp * This->cinfo.output_width + 7) / 8;
 
-    case 1: /* pixels per inch */
-        This->frame.dpix = This->cinfo.X_density;
-        This->frame.dpiy = This->cinfo.Y_density;
-        break;
+    free(This->row_buffer);
+    This->row_buffer = malloc(This->stride * max(This->cinfo.rec_outbuf_height, 1));
+    if (!This->row_buffer)
+        return E_OUTOFMEMORY;
 
-    case 0: /* unknown */
-    default:
-        This->frame.dpix = This->frame.dpiy = 96.0;
-        break;
-    }
+    This->decompress_started = TRUE;
+    This->scale = scale;
 
-    This->frame.num_color_contexts = 0;
-    This->frame.num_colors = 0;
+    return S_OK;
+}
 
-    This->stride = (This->frame.bpp * This->cinfo.output_width + 7) / 8;
-    data_size = This->stride * This->cinfo.output_height;
+/* Decode rows sequentially up to the end of the given rectangle, converting
+ * and copying the ones that intersect it. Rows before the current scanline
+ * can't be returned. Must be called with a jmp_buf set up. */
+static HRESULT jpeg_decoder_read_rows(struct jpeg_decoder *This, const WICRect *rc,
+    UINT stride, BYTE *buffer)
+{
+    UINT bytesperpixel = This->frame.bpp / 8;
+    UINT rows_per_read = max(This->cinfo.rec_outbuf_height, 1);
+    UINT first_scanline, i, j;
+    JSAMPROW out_rows[4];
+    JDIMENSION ret;
 
-    This->image_data = malloc(data_size);
-    if (!This->image_data)
-        return E_OUTOFMEMORY;
+    if (rows_per_read > ARRAY_SIZE(out_rows))
+        rows_per_read = ARRAY_SIZE(out_rows);
 
-    while (This->cinfo.output_scanline < This->cinfo.output_height)
+    while (This->cinfo.output_scanline < rc->Y + rc->Height)
     {
-        UINT first_scanline = This->cinfo.output_scanline;
-        UINT max_rows;
-        JSAMPROW out_rows[4];
-        JDIMENSION ret;
+        first_scanline = This->cinfo.output_scanline;
 
-        max_rows = min(This->cinfo.output_height-first_scanline, 4);
-        for (i=0; i<max_rows; i++)
-            out_rows[i] = This->image_data + This->stride * (first_scanline+i);
+        for (i = 0; i < rows_per_read; i++)
+            out_rows[i] = This->row_buffer + This->stride * i;
 
-        ret = jpeg_read_scanlines(&This->cinfo, out_rows, max_rows);
+        ret = jpeg_read_scanlines(&This->cinfo, out_rows,
+            min(This->cinfo.output_height - first_scanline, rows_per_read));
         if (ret == 0)
         {
             ERR("read_scanlines failed\n");
             return E_FAIL;
         }
+
+        for (i = 0; i < ret; i++)
+        {
+            BYTE *src = out_rows[i] + rc->X * bytesperpixel;
+            UINT y = first_scanline + i;
+
+            if (y < rc->Y || y >= rc->Y + rc->Height)
+                continue;
+
+            if (This->frame.bpp == 24)
+            {
+                /* libjpeg gives us RGB data and we want BGR, so byteswap the data */
+                reverse_bgr8(3, src, rc->Width, 1, This->stride);
+            }
+            else if (This->cinfo.out_color_space == JCS_CMYK && This->cinfo.saw_Adobe_marker)
+            {
+                /* Adobe JPEG's have inverted CMYK data. */
+                for (j = 0; j < rc->Width * 4; j++)
+                    src[j] ^= 0xff;
+            }
+
+            memcpy(buffer + stride * (y - rc->Y), src, rc->Width * bytesperpixel);
+        }
+    }
+
+    return S_OK;
+}
+
+static inline UINT scaled_size(UINT size, UINT scale)
+{
+    return (size + scale - 1) / scale;
+}
+
+static HRESULT jpeg_decoder_copy(struct jpeg_decoder *This, UINT scale, const WICRect *prc,
+    UINT stride, UINT buffersize, BYTE *buffer)
+{
+    UINT width = scaled_size(This->frame.width, scale);
+    UINT height = scaled_size(This->frame.height, scale);
+    UINT bytesperrow, image_stride;
+    WICRect rect, full_rect;
+    jmp_buf jmpbuf;
+    HRESULT hr;
+
+    if (This->image_data && This->image_scale == scale)
+        return copy_pixels(This->frame.bpp, This->image_data, width, height,
+            (This->frame.bpp * width + 7) / 8, prc, stride, buffersize, buffer);
+
+    if (!prc)
+    {
+        rect.X = 0;
+        rect.Y = 0;
+        rect.Width = width;
+        rect.Height = height;
+        prc = &rect;
+    }
+    else
+    {
+        if (prc->X < 0 || prc->Y < 0 || prc->X+prc->Width > width || prc->Y+prc->Height > height)
+            return E_INVALIDARG;
+    }
+
+    bytesperrow = ((This->frame.bpp * prc->Width)+7)/8;
+
+    if (stride < bytesperrow)
+        return E_INVALIDARG;
+
+    if ((stride * (prc->Height-1)) + bytesperrow > buffersize)
+        return E_INVALIDARG;
+
+    if (setjmp(jmpbuf))
+    {
+        jpeg_abort_decompress(&This->cinfo);
+        This->decompress_started = FALSE;
+        if (!This->image_scale)
+        {
+            free(This->image_data);
+            This->image_data = NULL;
+        }
+        return E_FAIL;
     }
 
-    if (This->frame.bpp == 24)
+    This->cinfo.client_data = jmpbuf;
+
+    if (This->decompress_started && This->scale == scale && prc->Y >= This->cinfo.output_scanline)
     {
-        /* libjpeg gives us RGB data and we want BGR, so byteswap the data */
-        reverse_bgr8(3, This->image_data,
-            This->cinfo.output_width, This->cinfo.output_height,
-            This->stride);
+        /* continue where the previous call stopped */
+        stream_seek(This->stream, This->stream_pos, STREAM_SEEK_SET, NULL);
     }
+    else if (This->decompress_started && This->scale == scale)
+    {
+        /* The caller went back to rows that were already decoded. Rather than
+         * restarting the decompression for each request, decode the whole
+         * frame once and serve all further requests from memory. */
+        TRACE("out of order access, decoding the whole frame\n");
+
+        image_stride = (This->frame.bpp * width + 7) / 8;
+        free(This->image_data);
+        This->image_scale = 0;
+        This->image_data = malloc(image_stride * height);
+        if (!This->image_data)
+            return E_OUTOFMEMORY;
+
+        full_rect.X = 0;
+        full_rect.Y = 0;
+        full_rect.Width = width;
+        full_rect.Height = height;
+
+        hr = jpeg_decoder_start(This, scale);
+        if (SUCCEEDED(hr))
+            hr = jpeg_decoder_read_rows(This, &full_rect, image_stride, This->image_data);
+
+        jpeg_abort_decompress(&This->cinfo);
+        This->decompress_started = FALSE;
+        free(This->row_buffer);
+        This->row_buffer = NULL;
+
+        if (FAILED(hr))
+        {
+            free(This->image_data);
+            This->image_data = NULL;
+            return hr;
+        }
+        This->image_scale = scale;
+
+        return copy_pixels(This->frame.bpp, This->image_data, width, height,
+            image_stride, prc, stride, buffersize, buffer);
+    }
+    else
+    {
+        hr = jpeg_decoder_start(This, scale);
+        if (FAILED(hr))
+            return hr;
+    }
+
+    hr = jpeg_decoder_read_rows(This, prc, stride, buffer);
+
+    stream_seek(This->stream, 0, STREAM_SEEK_CUR, &This->stream_pos);
+
+    return hr;
+}
+
+static HRESULT CDECL jpeg_decoder_initialize(struct decoder* iface, IStream *stream, struct decoder_stat *st)
+{
+    struct jpeg_decoder *This = impl_from_decoder(iface);
+    jmp_buf jmpbuf;
+    HRESULT hr;
+
+    if (This->cinfo_initialized)
+        return WINCODEC_ERR_WRONGSTATE;
+
+    jpeg_std_error(&This->jerr);
+
+    This->jerr.error_exit = error_exit_fn;
+    This->jerr.emit_message = emit_message_fn;
+
+    This->cinfo.err = &This->jerr;
+
+    This->cinfo.client_data = jmpbuf;
+
+    if (setjmp(jmpbuf))
+        return E_FAIL;
+
+    jpeg_CreateDecompress(&This->cinfo, JPEG_LIB_VERSION, sizeof(struct jpeg_decompress_struct));
+
+    This->cinfo_initialized = TRUE;
 
-    if (This->cinfo.out_color_space == JCS_CMYK && This->cinfo.saw_Adobe_marker)
+    This->stream = stream;
+
+    This->source_mgr.bytes_in_buffer = 0;
+    This->source_mgr.init_source = source_mgr_init_source;
+    This->source_mgr.fill_input_buffer = source_mgr_fill_input_buffer;
+    This->source_mgr.skip_input_data = source_mgr_skip_input_data;
+    This->source_mgr.resync_to_restart = jpeg_resync_to_restart;
+    This->source_mgr.term_source = source_mgr_term_source;
+
+    This->cinfo.src = &This->source_mgr;
+
+    /* Only the header is parsed here, the image data is decoded on demand
+     * by CopyPixels, one strip of rows at a time. */
+    hr = jpeg_decoder_read_header(This);
+    if (FAILED(hr))
+        return hr;
+
+    This->frame.width = This->cinfo.image_width;
+    This->frame.height = This->cinfo.image_height;
+
+    switch (This->cinfo.density_unit)
     {
-        /* Adobe JPEG's have inverted CMYK data. */
-        for (i=0; i<data_size; i++)
-            This->image_data[i] ^= 0xff;
+    case 2: /* pixels per centimeter */
+        This->frame.dpix = This->cinfo.X_density * 2.54;
+        This->frame.dpiy = This->cinfo.Y_density * 2.54;
+        break;
+
+    case 1: /* pixels per inch */
+        This->frame.dpix = This->cinfo.X_density;
+        This->frame.dpiy = This->cinfo.Y_density;
+        break;
+
+    case 0: /* unknown */
+    default:
+        This->frame.dpix = This->frame.dpiy = 96.0;
+        break;
     }
 
+    This->frame.num_color_contexts = 0;
+    This->frame.num_colors = 0;
+
     st->frame_count = 1;
     st->flags = WICBitmapDecoderCapabilityCanDecodeAllImages |
                 WICBitmapDecoderCapabilityCanDecodeSomeImages |
                 WICBitmapDecoderCapabilityCanEnumerateMetadata |
+                DECODER_FLAGS_SUPPORTS_SCALING |
                 DECODER_FLAGS_UNSUPPORTED_COLOR_CONTEXT;
     return S_OK;
 }
@@ -305,9 +484,42 @@ static HRESULT CDECL jpeg_decoder_copy_pixels(struct decoder* iface, UINT frame,
     const WICRect *prc, UINT stride, UINT buffersize, BYTE *buffer)
 {
     struct jpeg_decoder *This = impl_from_decoder(iface);
-    return copy_pixels(This->frame.bpp, This->image_data,
-        This->frame.width, This->frame.height, This->stride,
-        prc, stride, buffersize, buffer);
+    return jpeg_decoder_copy(This, 1, prc, stride, buffersize, buffer);
+}
+
+static HRESULT CDECL jpeg_decoder_get_closest_size(struct decoder* iface, UINT frame,
+    UINT *width, UINT *height)
+{
+    struct jpeg_decoder *This = impl_from_decoder(iface);
+    UINT scale;
+
+    /* libjpeg can scale the IDCT output by 1/2, 1/4 and 1/8 */
+    for (scale = 8; scale > 1; scale /= 2)
+    {
+        if (scaled_size(This->frame.width, scale) >= *width &&
+            scaled_size(This->frame.height, scale) >= *height)
+            break;
+    }
+
+    *width = scaled_size(This->frame.width, scale);
+    *height = scaled_size(This->frame.height, scale);
+    return S_OK;
+}
+
+static HRESULT CDECL jpeg_decoder_copy_pixels_scaled(struct decoder* iface, UINT frame,
+    UINT width, UINT height, const WICRect *prc, UINT stride, UINT buffersize, BYTE *buffer)
+{
+    struct jpeg_decoder *This = impl_from_decoder(iface);
+    UINT scale;
+
+    for (scale = 1; scale <= 8; scale *= 2)
+    {
+        if (scaled_size(This->frame.width, scale) == width &&
+            scaled_size(This->frame.height, scale) == height)
+            return jpeg_decoder_copy(This, scale, prc, stride, buffersize, buffer);
+    }
+
+    return E_INVALIDARG;
 }
 
 static HRESULT CDECL jpeg_decoder_get_metadata_blocks(struct decoder* iface, UINT frame,
@@ -333,7 +545,9 @@ static const struct decoder_funcs jpeg_decoder_vtable = {
     jpeg_decoder_copy_pixels,
     jpeg_decoder_get_metadata_blocks,
     jpeg_decoder_get_color_context,
-    jpeg_decoder_destroy
+    jpeg_decoder_destroy,
+    jpeg_decoder_get_closest_size,
+    jpeg_decoder_copy_pixels_scaled
 };
 
 HRESULT CDECL jpeg_decoder_create(struct decoder_info *info, struct decoder **result)
@@ -346,7 +560,13 @@ HRESULT CDECL jpeg_decoder_create(struct decoder_info *info, struct decoder **re
     This->decoder.vtable = &jpeg_decoder_vtable;
     This->cinfo_initialized = FALSE;
     This->stream = NULL;
+    This->stream_pos = 0;
+    This->decompress_started = FALSE;
+    This->scale = 1;
+    This->row_buffer = NULL;
+    This->stride = 0;
     This->image_data = NULL;
+    This->image_scale = 0;
     *result = &This->decoder;
 
     info->container_format = GUID_ContainerFormatJpeg;
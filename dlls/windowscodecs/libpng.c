@@ -40,8 +40,14 @@ struct png_decoder
     struct decoder decoder;
     IStream *stream;
     struct decoder_frame decoder_frame;
+    png_structp png_ptr;
+    png_infop info_ptr;
+    ULONGLONG stream_pos; /* stream position of the next byte libpng reads */
+    UINT next_row; /* next row png_read_row will return */
+    BOOL interlaced;
     UINT stride;
-    BYTE *image_bits;
+    BYTE *row_buffer;
+    BYTE *image_bits; /* whole frame, for interlaced images and out of order access */
     BYTE *color_profile;
     DWORD color_profile_len;
 };
@@ -64,105 +70,107 @@ static void user_read_data(png_structp png_ptr, png_bytep data, png_size_t lengt
     }
 }
 
-static HRESULT CDECL png_decoder_initialize(struct decoder *iface, IStream *stream, struct decoder_stat *st)
+static void png_decoder_stop(struct png_decoder *This)
+{
+    if (This->png_ptr)
+        png_destroy_read_struct(&This->png_ptr, &This->info_ptr, NULL);
+    This->png_ptr = NULL;
+    This->info_ptr = NULL;
+    free(This->row_buffer);
+    This->row_buffer = NULL;
+}
+
+/* Parse the header from the start of the stream and set up the transformations
+ * producing the pixel format of the frame, so that the image rows can be read
+ * next. Any previous read structure is thrown away. */
+static HRESULT png_decoder_start(struct png_decoder *This)
 {
-    struct png_decoder *This = impl_from_decoder(iface);
-    png_structp png_ptr;
-    png_infop info_ptr;
-    HRESULT hr = E_FAIL;
     int color_type, bit_depth;
     png_bytep trans;
     int num_trans;
     png_uint_32 transparency;
     png_color_16p trans_values;
-    png_uint_32 ret, xres, yres;
-    int unit_type;
-    png_colorp png_palette;
-    int num_palette;
-    int i;
-    UINT image_size;
-    png_bytep *row_pointers=NULL;
-    png_charp cp_name;
-    png_bytep cp_profile;
-    png_uint_32 cp_len;
-    int cp_compression;
+    HRESULT hr;
 
-    png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
-    if (!png_ptr)
+    png_decoder_stop(This);
+
+    This->png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+    if (!This->png_ptr)
     {
         return E_FAIL;
     }
 
-    info_ptr = png_create_info_struct(png_ptr);
-    if (!info_ptr)
+    This->info_ptr = png_create_info_struct(This->png_ptr);
+    if (!This->info_ptr)
     {
-        png_destroy_read_struct(&png_ptr, NULL, NULL);
+        png_destroy_read_struct(&This->png_ptr, NULL, NULL);
+        This->png_ptr = NULL;
         return E_FAIL;
     }
 
     /* set up setjmp/longjmp error handling */
-    if (setjmp(png_jmpbuf(png_ptr)))
+    if (setjmp(png_jmpbuf(This->png_ptr)))
     {
-        hr = WINCODEC_ERR_UNKNOWNIMAGEFORMAT;
-        goto end;
+        png_decoder_stop(This);
+        return WINCODEC_ERR_UNKNOWNIMAGEFORMAT;
     }
-    png_set_crc_action(png_ptr, PNG_CRC_QUIET_USE, PNG_CRC_QUIET_USE);
+    png_set_crc_action(This->png_ptr, PNG_CRC_QUIET_USE, PNG_CRC_QUIET_USE);
 
     /* seek to the start of the stream */
-    hr = stream_seek(stream, 0, STREAM_SEEK_SET, NULL);
+    hr = stream_seek(This->stream, 0, STREAM_SEEK_SET, NULL);
     if (FAILED(hr))
     {
-        goto end;
+        png_decoder_stop(This);
+        return hr;
     }
 
     /* set up custom i/o handling */
-    png_set_read_fn(png_ptr, stream, user_read_data);
+    png_set_read_fn(This->png_ptr, This->stream, user_read_data);
 
     /* read the header */
-    png_read_info(png_ptr, info_ptr);
+    png_read_info(This->png_ptr, This->info_ptr);
 
     /* choose a pixel format */
-    color_type = png_get_color_type(png_ptr, info_ptr);
-    bit_depth = png_get_bit_depth(png_ptr, info_ptr);
+    color_type = png_get_color_type(This->png_ptr, This->info_ptr);
+    bit_depth = png_get_bit_depth(This->png_ptr, This->info_ptr);
 
     /* PNGs with bit-depth greater than 8 are network byte order. Windows does not expect this. */
     if (bit_depth > 8)
-        png_set_swap(png_ptr);
+        png_set_swap(This->png_ptr);
 
     /* check for color-keyed alpha */
-    transparency = png_get_tRNS(png_ptr, info_ptr, &trans, &num_trans, &trans_values);
-    if (!transparency)
-        num_trans = 0;
+    transparency = png_get_tRNS(This->png_ptr, This->info_ptr, &trans, &num_trans, &trans_values);
 
     if (transparency && (color_type == PNG_COLOR_TYPE_RGB ||
         (color_type == PNG_COLOR_TYPE_GRAY && bit_depth == 16)))
     {
         /* expand to RGBA */
         if (color_type == PNG_COLOR_TYPE_GRAY)
-            png_set_gray_to_rgb(png_ptr);
-        png_set_tRNS_to_alpha(png_ptr);
+            png_set_gray_to_rgb(This->png_ptr);
+        png_set_tRNS_to_alpha(This->png_ptr);
         color_type = PNG_COLOR_TYPE_RGB_ALPHA;
     }
 
+    hr = S_OK;
+
     switch (color_type)
     {
     case PNG_COLOR_TYPE_GRAY_ALPHA:
         /* WIC does not support grayscale alpha formats so use RGBA */
-        png_set_gray_to_rgb(png_ptr);
+        png_set_gray_to_rgb(This->png_ptr);
         /* fall through */
     case PNG_COLOR_TYPE_RGB_ALPHA:
         This->decoder_frame.bpp = bit_depth * 4;
         switch (bit_depth)
         {
         case 8:
-            png_set_bgr(png_ptr);
+            png_set_bgr(This->png_ptr);
             This->decoder_frame.pixel_format = GUID_WICPixelFormat32bppBGRA;
             break;
         case 16: This->decoder_frame.pixel_format = GUID_WICPixelFormat64bppRGBA; break;
         default:
             ERR("invalid RGBA bit depth: %i\n", bit_depth);
             hr = E_FAIL;
-            goto end;
         }
         break;
     case PNG_COLOR_TYPE_GRAY:
@@ -179,7 +187,6 @@ static HRESULT CDECL png_decoder_initialize(struct decoder *iface, IStream *stre
             default:
                 ERR("invalid grayscale bit depth: %i\n", bit_depth);
                 hr = E_FAIL;
-                goto end;
             }
             break;
         }
@@ -195,7 +202,6 @@ static HRESULT CDECL png_decoder_initialize(struct decoder *iface, IStream *stre
         default:
             ERR("invalid indexed color bit depth: %i\n", bit_depth);
             hr = E_FAIL;
-            goto end;
         }
         break;
     case PNG_COLOR_TYPE_RGB:
@@ -203,24 +209,82 @@ static HRESULT CDECL png_decoder_initialize(struct decoder *iface, IStream *stre
         switch (bit_depth)
         {
         case 8:
-            png_set_bgr(png_ptr);
+            png_set_bgr(This->png_ptr);
             This->decoder_frame.pixel_format = GUID_WICPixelFormat24bppBGR;
             break;
         case 16: This->decoder_frame.pixel_format = GUID_WICPixelFormat48bppRGB; break;
         default:
             ERR("invalid RGB color bit depth: %i\n", bit_depth);
             hr = E_FAIL;
-            goto end;
         }
         break;
     default:
         ERR("invalid color type %i\n", color_type);
         hr = E_FAIL;
+    }
+
+    if (FAILED(hr))
+    {
+        png_decoder_stop(This);
+        return hr;
+    }
+
+    This->decoder_frame.width = png_get_image_width(This->png_ptr, This->info_ptr);
+    This->decoder_frame.height = png_get_image_height(This->png_ptr, This->info_ptr);
+    This->interlaced = png_get_interlace_type(This->png_ptr, This->info_ptr) != PNG_INTERLACE_NONE;
+    This->stride = (This->decoder_frame.width * This->decoder_frame.bpp + 7) / 8;
+    This->next_row = 0;
+
+    stream_seek(This->stream, 0, STREAM_SEEK_CUR, &This->stream_pos);
+
+    return S_OK;
+}
+
+static HRESULT CDECL png_decoder_initialize(struct decoder *iface, IStream *stream, struct decoder_stat *st)
+{
+    struct png_decoder *This = impl_from_decoder(iface);
+    png_structp png_ptr;
+    png_infop info_ptr;
+    HRESULT hr;
+    int color_type, bit_depth;
+    png_bytep trans;
+    int num_trans;
+    png_uint_32 transparency;
+    png_color_16p trans_values;
+    png_uint_32 ret, xres, yres;
+    int unit_type;
+    png_colorp png_palette;
+    int num_palette;
+    int i;
+    png_charp cp_name;
+    png_bytep cp_profile;
+    png_uint_32 cp_len;
+    int cp_compression;
+
+    This->stream = stream;
+
+    hr = png_decoder_start(This);
+    if (FAILED(hr))
+    {
+        This->stream = NULL;
+        return hr;
+    }
+
+    png_ptr = This->png_ptr;
+    info_ptr = This->info_ptr;
+
+    if (setjmp(png_jmpbuf(png_ptr)))
+    {
+        hr = WINCODEC_ERR_UNKNOWNIMAGEFORMAT;
         goto end;
     }
 
-    This->decoder_frame.width = png_get_image_width(png_ptr, info_ptr);
-    This->decoder_frame.height = png_get_image_height(png_ptr, info_ptr);
+    color_type = png_get_color_type(png_ptr, info_ptr);
+    bit_depth = png_get_bit_depth(png_ptr, info_ptr);
+
+    transparency = png_get_tRNS(png_ptr, info_ptr, &trans, &num_trans, &trans_values);
+    if (!transparency)
+        num_trans = 0;
 
     ret = png_get_pHYs(png_ptr, info_ptr, &xres, &yres, &unit_type);
 
@@ -294,51 +358,23 @@ static HRESULT CDECL png_decoder_initialize(struct decoder *iface, IStream *stre
         This->decoder_frame.num_colors = 0;
     }
 
-    This->stride = (This->decoder_frame.width * This->decoder_frame.bpp + 7) / 8;
-    image_size = This->stride * This->decoder_frame.height;
-
-    This->image_bits = malloc(image_size);
-    if (!This->image_bits)
-    {
-        hr = E_OUTOFMEMORY;
-        goto end;
-    }
-
-    row_pointers = malloc(sizeof(png_bytep)*This->decoder_frame.height);
-    if (!row_pointers)
-    {
-        hr = E_OUTOFMEMORY;
-        goto end;
-    }
-
-    for (i=0; i<This->decoder_frame.height; i++)
-        row_pointers[i] = This->image_bits + i * This->stride;
-
-    png_read_image(png_ptr, row_pointers);
-
-    free(row_pointers);
-    row_pointers = NULL;
-
-    /* png_read_end intentionally not called to not seek to the end of the file */
+    /* The image data is decoded on demand by CopyPixels. Rows requested in
+     * order are streamed without keeping the whole frame in memory. */
 
     st->flags = WICBitmapDecoderCapabilityCanDecodeAllImages |
                 WICBitmapDecoderCapabilityCanDecodeSomeImages |
                 WICBitmapDecoderCapabilityCanEnumerateMetadata;
     st->frame_count = 1;
 
-    This->stream = stream;
-
     hr = S_OK;
 
 end:
-    png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
-    free(row_pointers);
     if (FAILED(hr))
     {
-        free(This->image_bits);
-        This->image_bits = NULL;
+        png_decoder_stop(This);
         free(This->color_profile);
         This->color_profile = NULL;
+        This->stream = NULL;
     }
     return hr;
 }
@@ -350,14 +386,149 @@ static HRESULT CDECL png_decoder_get_frame_info(struct decoder *iface, UINT fram
     return S_OK;
 }
 
+/* Decode the whole frame into image_bits, restarting from the beginning of
+ * the stream if some rows were already read. */
+static HRESULT png_decoder_read_image(struct png_decoder *This)
+{
+    png_bytep *row_pointers;
+    HRESULT hr;
+    UINT i;
+
+    if (!This->png_ptr || This->next_row)
+    {
+        hr = png_decoder_start(This);
+        if (FAILED(hr))
+            return hr;
+    }
+    else
+        stream_seek(This->stream, This->stream_pos, STREAM_SEEK_SET, NULL);
+
+    This->image_bits = malloc(This->stride * This->decoder_frame.height);
+    row_pointers = malloc(sizeof(png_bytep)*This->decoder_frame.height);
+    if (!This->image_bits || !row_pointers)
+    {
+        free(row_pointers);
+        free(This->image_bits);
+        This->image_bits = NULL;
+        return E_OUTOFMEMORY;
+    }
+
+    for (i=0; i<This->decoder_frame.height; i++)
+        row_pointers[i] = This->image_bits + i * This->stride;
+
+    if (setjmp(png_jmpbuf(This->png_ptr)))
+    {
+        free(row_pointers);
+        free(This->image_bits);
+        This->image_bits = NULL;
+        png_decoder_stop(This);
+        return E_FAIL;
+    }
+
+    png_read_image(This->png_ptr, row_pointers);
+
+    /* png_read_end intentionally not called to not seek to the end of the file */
+
+    free(row_pointers);
+    png_decoder_stop(This);
+    return S_OK;
+}
+
 static HRESULT CDECL png_decoder_copy_pixels(struct decoder *iface, UINT frame,
     const WICRect *prc, UINT stride, UINT buffersize, BYTE *buffer)
 {
     struct png_decoder *This = impl_from_decoder(iface);
+    UINT bytesperrow, row_offset;
+    WICRect rect;
+    BYTE *dst;
+    HRESULT hr;
+
+    if (This->image_bits)
+        return copy_pixels(This->decoder_frame.bpp, This->image_bits,
+            This->decoder_frame.width, This->decoder_frame.height, This->stride,
+            prc, stride, buffersize, buffer);
+
+    if (!prc)
+    {
+        rect.X = 0;
+        rect.Y = 0;
+        rect.Width = This->decoder_frame.width;
+        rect.Height = This->decoder_frame.height;
+        prc = &rect;
+    }
+    else
+    {
+        if (prc->X < 0 || prc->Y < 0 ||
+            prc->X+prc->Width > This->decoder_frame.width ||
+            prc->Y+prc->Height > This->decoder_frame.height)
+            return E_INVALIDARG;
+    }
+
+    bytesperrow = ((This->decoder_frame.bpp * prc->Width)+7)/8;
+    row_offset = prc->X * This->decoder_frame.bpp;
+
+    if (stride < bytesperrow)
+        return E_INVALIDARG;
+
+    if ((stride * (prc->Height-1)) + bytesperrow > buffersize)
+        return E_INVALIDARG;
+
+    /* Interlaced images need the whole frame, and so do callers going back
+     * to rows that were already streamed out, so keep it from then on. */
+    if (This->interlaced || row_offset % 8 ||
+        (This->png_ptr && prc->Y < This->next_row))
+    {
+        hr = png_decoder_read_image(This);
+        if (FAILED(hr))
+            return hr;
+
+        return copy_pixels(This->decoder_frame.bpp, This->image_bits,
+            This->decoder_frame.width, This->decoder_frame.height, This->stride,
+            prc, stride, buffersize, buffer);
+    }
+
+    if (!This->png_ptr)
+    {
+        hr = png_decoder_start(This);
+        if (FAILED(hr))
+            return hr;
+    }
+    else
+        stream_seek(This->stream, This->stream_pos, STREAM_SEEK_SET, NULL);
+
+    if (!This->row_buffer && !(This->row_buffer = malloc(This->stride)))
+        return E_OUTOFMEMORY;
+
+    if (setjmp(png_jmpbuf(This->png_ptr)))
+    {
+        png_decoder_stop(This);
+        return E_FAIL;
+    }
+
+    while (This->next_row < prc->Y + prc->Height)
+    {
+        if (This->next_row < prc->Y)
+        {
+            png_read_row(This->png_ptr, This->row_buffer, NULL);
+        }
+        else
+        {
+            dst = buffer + stride * (This->next_row - prc->Y);
+
+            if (bytesperrow == This->stride)
+                png_read_row(This->png_ptr, dst, NULL);
+            else
+            {
+                png_read_row(This->png_ptr, This->row_buffer, NULL);
+                memcpy(dst, This->row_buffer + row_offset / 8, bytesperrow);
+            }
+        }
+        This->next_row++;
+    }
+
+    stream_seek(This->stream, 0, STREAM_SEEK_CUR, &This->stream_pos);
 
-    return copy_pixels(This->decoder_frame.bpp, This->image_bits,
-        This->decoder_frame.width, This->decoder_frame.height, This->stride,
-        prc, stride, buffersize, buffer);
+    return S_OK;
 }
 
 static HRESULT CDECL png_decoder_get_metadata_blocks(struct decoder* iface,
@@ -453,6 +624,7 @@ static void CDECL png_decoder_destroy(struct decoder* iface)
 {
     struct png_decoder *This = impl_from_decoder(iface);
 
+    png_decoder_stop(This);
     free(This->image_bits);
     free(This->color_profile);
     RtlFreeHeap(GetProcessHeap(), 0, This);
@@ -479,6 +651,13 @@ HRESULT CDECL png_decoder_create(struct decoder_info *info, struct decoder **res
     }
 
     This->decoder.vtable = &png_decoder_vtable;
+    This->stream = NULL;
+    This->png_ptr = NULL;
+    This->info_ptr = NULL;
+    This->stream_pos = 0;
+    This->next_row = 0;
+    This->interlaced = FALSE;
+    This->row_buffer = NULL;
     This->image_bits = NULL;
     This->color_profile = NULL;
     *result = &This->decoder;
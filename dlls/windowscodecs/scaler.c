@@ -18,6 +18,8 @@
  */
 
 #include <stdarg.h>
+#include <stdlib.h>
+#include <math.h>
 
 #define COBJMACROS
 
@@ -31,6 +33,14 @@
 
 WINE_DEFAULT_DEBUG_CHANNEL(wincodecs);
 
+/* Weights of a separable filter along one dimension. Each destination pixel
+ * is computed from taps consecutive source pixels. */
+struct filter_weights {
+    UINT taps;
+    UINT *start;     /* first source pixel for each destination pixel */
+    short *weights;  /* taps weights for each destination pixel, sum is 1 << 14 */
+};
+
 typedef struct BitmapScaler {
     IWICBitmapScaler IWICBitmapScaler_iface;
     LONG ref;
@@ -42,9 +52,19 @@ typedef struct BitmapScaler {
     UINT bpp;
     void (*fn_get_required_source_rect)(struct BitmapScaler*,UINT,UINT,WICRect*);
     void (*fn_copy_scanline)(struct BitmapScaler*,UINT,UINT,UINT,BYTE**,UINT,UINT,BYTE*);
+    struct filter_weights x_weights, y_weights;
+    int *filter_row; /* vertically filtered source pixels */
     CRITICAL_SECTION lock; /* must be held when initialized */
 } BitmapScaler;
 
+static void free_filter_weights(struct filter_weights *fw)
+{
+    HeapFree(GetProcessHeap(), 0, fw->start);
+    HeapFree(GetProcessHeap(), 0, fw->weights);
+    fw->start = NULL;
+    fw->weights = NULL;
+}
+
 static inline BitmapScaler *impl_from_IWICBitmapScaler(IWICBitmapScaler *iface)
 {
     return CONTAINING_RECORD(iface, BitmapScaler, IWICBitmapScaler_iface);
@@ -106,6 +126,9 @@ static ULONG WINAPI BitmapScaler_Release(IWICBitmapScaler *iface)
         This->lock.DebugInfo->Spare[0] = 0;
         DeleteCriticalSection(&This->lock);
         if (This->source) IWICBitmapSource_Release(This->source);
+        free_filter_weights(&This->x_weights);
+        free_filter_weights(&This->y_weights);
+        HeapFree(GetProcessHeap(), 0, This->filter_row);
         HeapFree(GetProcessHeap(), 0, This);
     }
 
@@ -203,6 +226,162 @@ static void NearestNeighbor_CopyScanline(BitmapScaler *This,
     }
 }
 
+static float filter_box(float x)
+{
+    return (x > -0.5f && x <= 0.5f) ? 1.0f : 0.0f;
+}
+
+static float filter_triangle(float x)
+{
+    x = fabsf(x);
+    return x < 1.0f ? 1.0f - x : 0.0f;
+}
+
+/* Catmull-Rom spline */
+static float filter_cubic(float x)
+{
+    x = fabsf(x);
+    if (x < 1.0f) return (1.5f * x - 2.5f) * x * x + 1.0f;
+    if (x < 2.0f) return ((-0.5f * x + 2.5f) * x - 4.0f) * x + 2.0f;
+    return 0.0f;
+}
+
+static BOOL init_filter_weights(struct filter_weights *fw, UINT src_size, UINT dst_size,
+    float (*filter)(float), float radius)
+{
+    float scale = (float)src_size / dst_size, filter_scale = max(scale, 1.0f);
+    float support = radius * filter_scale;
+    float *values;
+    UINT i, k;
+
+    fw->taps = min((UINT)ceilf(support * 2.0f) + 2, src_size);
+    fw->start = HeapAlloc(GetProcessHeap(), 0, dst_size * sizeof(*fw->start));
+    fw->weights = HeapAlloc(GetProcessHeap(), 0, dst_size * fw->taps * sizeof(*fw->weights));
+    values = HeapAlloc(GetProcessHeap(), 0, fw->taps * sizeof(*values));
+    if (!fw->start || !fw->weights || !values)
+    {
+        free_filter_weights(fw);
+        HeapFree(GetProcessHeap(), 0, values);
+        return FALSE;
+    }
+
+    for (i = 0; i < dst_size; i++)
+    {
+        float center = (i + 0.5f) * scale - 0.5f, sum = 0.0f;
+        int first = floorf(center - support), last = ceilf(center + support), j;
+        short *weights = fw->weights + i * fw->taps;
+        UINT start, largest = 0;
+        int total = 0;
+
+        start = max(first, 0);
+        start = min(start, src_size - fw->taps);
+        memset(values, 0, fw->taps * sizeof(*values));
+
+        /* pixels beyond the edges are replaced by the edge pixels */
+        for (j = first; j <= last; j++)
+        {
+            int pos = max(0, min(j, (int)src_size - 1)) - (int)start;
+
+            pos = max(0, min(pos, (int)fw->taps - 1));
+            values[pos] += filter((j - center) / filter_scale);
+        }
+        for (k = 0; k < fw->taps; k++)
+            sum += values[k];
+
+        for (k = 0; k < fw->taps; k++)
+        {
+            weights[k] = sum != 0.0f ? floorf(values[k] / sum * 16384.0f + 0.5f) : 0;
+            total += weights[k];
+            if (abs(weights[k]) > abs(weights[largest])) largest = k;
+        }
+        if (sum == 0.0f)
+        {
+            largest = min((UINT)max(floorf(center + 0.5f) - start, 0.0f), fw->taps - 1);
+            total = 0;
+        }
+        /* make the weights add up to exactly one */
+        weights[largest] += 16384 - total;
+        fw->start[i] = start;
+    }
+
+    HeapFree(GetProcessHeap(), 0, values);
+    return TRUE;
+}
+
+static void Filter_GetRequiredSourceRect(BitmapScaler *This,
+    UINT x, UINT y, WICRect *src_rect)
+{
+    src_rect->X = This->x_weights.start[x];
+    src_rect->Y = This->y_weights.start[y];
+    src_rect->Width = This->x_weights.taps;
+    src_rect->Height = This->y_weights.taps;
+}
+
+/* Filters the source vertically into filter_row, then horizontally. The
+ * intermediate values keep 6 bits of fraction. */
+static void Filter_CopyScanline(BitmapScaler *This,
+    UINT dst_x, UINT dst_y, UINT dst_width,
+    BYTE **src_data, UINT src_data_x, UINT src_data_y, BYTE *pbBuffer)
+{
+    const struct filter_weights *xw = &This->x_weights, *yw = &This->y_weights;
+    const short *weights = yw->weights + dst_y * yw->taps;
+    UINT channels = This->bpp / 8;
+    UINT first = xw->start[dst_x], end = xw->start[dst_x + dst_width - 1] + xw->taps;
+    UINT src_y = yw->start[dst_y] - src_data_y;
+    UINT i, k, c, count = (end - first) * channels;
+    int *row = This->filter_row;
+
+    memset(row, 0, count * sizeof(*row));
+    for (k = 0; k < yw->taps; k++)
+    {
+        const BYTE *src = src_data[src_y + k] + (first - src_data_x) * channels;
+        int weight = weights[k];
+
+        if (!weight) continue;
+        for (i = 0; i < count; i++)
+            row[i] += weight * src[i];
+    }
+    for (i = 0; i < count; i++)
+        row[i] = (row[i] + (1 << 7)) >> 8;
+
+    for (i = 0; i < dst_width; i++)
+    {
+        const int *src = row + (xw->start[dst_x + i] - first) * channels;
+
+        weights = xw->weights + (dst_x + i) * xw->taps;
+        for (c = 0; c < channels; c++)
+        {
+            int sum = 0;
+
+            for (k = 0; k < xw->taps; k++)
+                sum += weights[k] * src[k * channels + c];
+            sum = (sum + (1 << 19)) >> 20;
+            *pbBuffer++ = max(0, min(sum, 255));
+        }
+    }
+}
+
+static BOOL is_filter_format(const WICPixelFormatGUID *format)
+{
+    static const WICPixelFormatGUID *formats[] =
+    {
+        &GUID_WICPixelFormat8bppGray,
+        &GUID_WICPixelFormat24bppBGR,
+        &GUID_WICPixelFormat24bppRGB,
+        &GUID_WICPixelFormat32bppBGR,
+        &GUID_WICPixelFormat32bppBGRA,
+        &GUID_WICPixelFormat32bppPBGRA,
+        &GUID_WICPixelFormat32bppRGB,
+        &GUID_WICPixelFormat32bppRGBA,
+        &GUID_WICPixelFormat32bppPRGBA,
+    };
+    UINT i;
+
+    for (i = 0; i < ARRAY_SIZE(formats); i++)
+        if (IsEqualGUID(formats[i], format)) return TRUE;
+    return FALSE;
+}
+
 static HRESULT WINAPI BitmapScaler_CopyPixels(IWICBitmapScaler *iface,
     const WICRect *prc, UINT cbStride, UINT cbBufferSize, BYTE *pbBuffer)
 {
@@ -312,6 +491,59 @@ end:
     return hr;
 }
 
+static HRESULT init_filter(BitmapScaler *This, IWICBitmapSource *source,
+    const WICPixelFormatGUID *format, WICBitmapInterpolationMode mode)
+{
+    float (*filter)(float);
+    float radius;
+    HRESULT hr;
+
+    switch (mode)
+    {
+    case WICBitmapInterpolationModeFant:
+        filter = filter_box;
+        radius = 0.5f;
+        break;
+    case WICBitmapInterpolationModeLinear:
+        filter = filter_triangle;
+        radius = 1.0f;
+        break;
+    default:
+        filter = filter_cubic;
+        radius = 2.0f;
+        break;
+    }
+
+    if (is_filter_format(format))
+    {
+        IWICBitmapSource_AddRef(source);
+        This->source = source;
+    }
+    else
+    {
+        hr = WICConvertBitmapSource(&GUID_WICPixelFormat32bppBGRA, source, &This->source);
+        if (FAILED(hr)) return hr;
+        This->bpp = 32;
+    }
+
+    This->filter_row = HeapAlloc(GetProcessHeap(), 0, This->src_width * (This->bpp / 8) * sizeof(int));
+    if (!This->filter_row ||
+        !init_filter_weights(&This->x_weights, This->src_width, This->width, filter, radius) ||
+        !init_filter_weights(&This->y_weights, This->src_height, This->height, filter, radius))
+    {
+        free_filter_weights(&This->x_weights);
+        HeapFree(GetProcessHeap(), 0, This->filter_row);
+        This->filter_row = NULL;
+        IWICBitmapSource_Release(This->source);
+        This->source = NULL;
+        return E_OUTOFMEMORY;
+    }
+
+    This->fn_get_required_source_rect = Filter_GetRequiredSourceRect;
+    This->fn_copy_scanline = Filter_CopyScanline;
+    return S_OK;
+}
+
 static HRESULT WINAPI BitmapScaler_Initialize(IWICBitmapScaler *iface,
     IWICBitmapSource *pISource, UINT uiWidth, UINT uiHeight,
     WICBitmapInterpolationMode mode)
@@ -351,6 +583,16 @@ static HRESULT WINAPI BitmapScaler_Initialize(IWICBitmapScaler *iface,
     {
         switch (mode)
         {
+        case WICBitmapInterpolationModeLinear:
+        case WICBitmapInterpolationModeCubic:
+        case WICBitmapInterpolationModeFant:
+        case WICBitmapInterpolationModeHighQualityCubic:
+            if (is_filter_format(&src_pixelformat) || (This->bpp % 8) != 0)
+            {
+                hr = init_filter(This, pISource, &src_pixelformat, mode);
+                break;
+            }
+            /* fall-through */
         default:
             FIXME("unsupported mode %i\n", mode);
             /* fall-through */
@@ -527,6 +769,9 @@ HRESULT BitmapScaler_Create(IWICBitmapScaler **scaler)
     This->src_height = 0;
     This->mode = 0;
     This->bpp = 0;
+    memset(&This->x_weights, 0, sizeof(This->x_weights));
+    memset(&This->y_weights, 0, sizeof(This->y_weights));
+    This->filter_row = NULL;
     InitializeCriticalSection(&This->lock);
     This->lock.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": BitmapScaler.lock");
 
@@ -1312,6 +1312,70 @@ static void test_bitmap_scaler(void)
     IWICBitmap_Release(bitmap);
 }
 
+static void test_bitmap_scaler_interpolation(void)
+{
+    static const WICBitmapInterpolationMode modes[] =
+    {
+        WICBitmapInterpolationModeLinear,
+        WICBitmapInterpolationModeCubic,
+        WICBitmapInterpolationModeFant,
+    };
+    static const BYTE columns[16] = { 0, 254, 0, 254, 0, 254, 0, 254, 0, 254, 0, 254, 0, 254, 0, 254 };
+    IWICBitmapScaler *scaler;
+    IWICBitmap *bitmap;
+    DWORD src[8 * 8], dst[3 * 5];
+    BYTE gray[4];
+    HRESULT hr;
+    UINT i, j;
+
+    for (i = 0; i < ARRAY_SIZE(src); i++)
+        src[i] = 0x80402010;
+
+    hr = IWICImagingFactory_CreateBitmapFromMemory(factory, 8, 8, &GUID_WICPixelFormat32bppBGRA,
+        8 * 4, sizeof(src), (BYTE *)src, &bitmap);
+    ok(hr == S_OK, "Failed to create a bitmap, hr %#x.\n", hr);
+
+    /* a uniform image stays uniform */
+    for (i = 0; i < ARRAY_SIZE(modes); i++)
+    {
+        hr = IWICImagingFactory_CreateBitmapScaler(factory, &scaler);
+        ok(hr == S_OK, "Failed to create bitmap scaler, hr %#x.\n", hr);
+
+        hr = IWICBitmapScaler_Initialize(scaler, (IWICBitmapSource *)bitmap, 3, 5, modes[i]);
+        ok(hr == S_OK, "mode %u: Failed to initialize bitmap scaler, hr %#x.\n", modes[i], hr);
+
+        memset(dst, 0, sizeof(dst));
+        hr = IWICBitmapScaler_CopyPixels(scaler, NULL, 3 * 4, sizeof(dst), (BYTE *)dst);
+        ok(hr == S_OK, "mode %u: Failed to copy pixels, hr %#x.\n", modes[i], hr);
+        for (j = 0; j < ARRAY_SIZE(dst); j++)
+            ok(dst[j] == 0x80402010, "mode %u: got %08x at %u.\n", modes[i], dst[j], j);
+
+        IWICBitmapScaler_Release(scaler);
+    }
+
+    IWICBitmap_Release(bitmap);
+
+    /* halving alternating columns averages them */
+    hr = IWICImagingFactory_CreateBitmapFromMemory(factory, 8, 2, &GUID_WICPixelFormat8bppGray,
+        8, sizeof(columns), (BYTE *)columns, &bitmap);
+    ok(hr == S_OK, "Failed to create a bitmap, hr %#x.\n", hr);
+
+    hr = IWICImagingFactory_CreateBitmapScaler(factory, &scaler);
+    ok(hr == S_OK, "Failed to create bitmap scaler, hr %#x.\n", hr);
+
+    hr = IWICBitmapScaler_Initialize(scaler, (IWICBitmapSource *)bitmap, 4, 1, WICBitmapInterpolationModeFant);
+    ok(hr == S_OK, "Failed to initialize bitmap scaler, hr %#x.\n", hr);
+
+    memset(gray, 0, sizeof(gray));
+    hr = IWICBitmapScaler_CopyPixels(scaler, NULL, 4, sizeof(gray), gray);
+    ok(hr == S_OK, "Failed to copy pixels, hr %#x.\n", hr);
+    for (i = 0; i < ARRAY_SIZE(gray); i++)
+        ok(gray[i] >= 126 && gray[i] <= 128, "got %u at %u.\n", gray[i], i);
+
+    IWICBitmapScaler_Release(scaler);
+    IWICBitmap_Release(bitmap);
+}
+
 static LONG obj_refcount(void *obj)
 {
     IUnknown_AddRef((IUnknown *)obj);
@@ -1482,6 +1546,7 @@ START_TEST(bitmap)
     test_CreateBitmapFromHBITMAP();
     test_clipper();
     test_bitmap_scaler();
+    test_bitmap_scaler_interpolation();
 
     IWICImagingFactory_Release(factory);
 
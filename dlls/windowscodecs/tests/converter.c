@@ -19,6 +19,7 @@
 
 #include <stdarg.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <math.h>
 
 #define COBJMACROS
@@ -1865,6 +1866,163 @@ static void test_converter_8bppIndexed(void)
     DeleteTestBitmap(src_obj);
 }
 
+static DWORD perf_pixel(UINT x, UINT y, BOOL premultiplied)
+{
+    BYTE b = x * 7 + y, g = x * 3 + y * 5, r = x + y * 11, a = (x / 4) * 37 + y;
+
+    if (premultiplied)
+    {
+        b = min(b, a);
+        g = min(g, a);
+        r = min(r, a);
+    }
+    return b | g << 8 | r << 16 | (DWORD)a << 24;
+}
+
+static BOOL near_byte(BYTE a, BYTE b)
+{
+    return abs(a - b) <= 1;
+}
+
+static void check_perf_pixel(const WICPixelFormatGUID *src_format, const WICPixelFormatGUID *dst_format,
+    const BYTE *data, UINT stride, UINT x, UINT y, const char *name)
+{
+    BOOL premultiplied = IsEqualGUID(src_format, &GUID_WICPixelFormat32bppPBGRA);
+    DWORD src = perf_pixel(x, y, premultiplied);
+    BYTE b = src, g = src >> 8, r = src >> 16, a = src >> 24;
+    const BYTE *pixel;
+
+    if (IsEqualGUID(src_format, &GUID_WICPixelFormat24bppBGR))
+        a = 255;
+    if (premultiplied && a && a != 255)
+    {
+        b = b * 255 / a;
+        g = g * 255 / a;
+        r = r * 255 / a;
+    }
+
+    if (IsEqualGUID(dst_format, &GUID_WICPixelFormat8bppGray))
+    {
+        float gray = (r * 0.2126f + g * 0.7152f + b * 0.0722f) / 255.0f;
+
+        gray = gray <= 0.0031308f ? 12.92f * gray : 1.055f * powf(gray, 1.0f / 2.4f) - 0.055f;
+        pixel = data + y * stride + x;
+        ok(near_byte(*pixel, floorf(gray * 255.0f + 0.51f)), "%s: got %u at %u,%u\n", name, *pixel, x, y);
+        return;
+    }
+
+    if (IsEqualGUID(dst_format, &GUID_WICPixelFormat24bppBGR))
+    {
+        pixel = data + y * stride + x * 3;
+        ok(pixel[0] == b && pixel[1] == g && pixel[2] == r,
+           "%s: got %02x%02x%02x at %u,%u\n", name, pixel[2], pixel[1], pixel[0], x, y);
+        return;
+    }
+
+    pixel = data + y * stride + x * 4;
+    if (IsEqualGUID(dst_format, &GUID_WICPixelFormat32bppPBGRA))
+    {
+        b = b * a / 255;
+        g = g * a / 255;
+        r = r * a / 255;
+    }
+    if (IsEqualGUID(dst_format, &GUID_WICPixelFormat32bppRGBA))
+    {
+        BYTE tmp = b;
+        b = r;
+        r = tmp;
+    }
+    ok(near_byte(pixel[0], b) && near_byte(pixel[1], g) && near_byte(pixel[2], r) && pixel[3] == a,
+       "%s: got %02x%02x%02x%02x, expected %02x%02x%02x%02x at %u,%u\n", name,
+       pixel[3], pixel[2], pixel[1], pixel[0], a, r, g, b, x, y);
+}
+
+static void test_bulk_conversion(void)
+{
+    static const struct
+    {
+        const WICPixelFormatGUID *src_format;
+        const WICPixelFormatGUID *dst_format;
+        UINT src_bpp, dst_bpp;
+        const char *name;
+    }
+    tests[] =
+    {
+        { &GUID_WICPixelFormat32bppBGRA, &GUID_WICPixelFormat32bppPBGRA, 32, 32, "BGRA -> PBGRA" },
+        { &GUID_WICPixelFormat32bppPBGRA, &GUID_WICPixelFormat32bppBGRA, 32, 32, "PBGRA -> BGRA" },
+        { &GUID_WICPixelFormat32bppBGRA, &GUID_WICPixelFormat32bppRGBA, 32, 32, "BGRA -> RGBA" },
+        { &GUID_WICPixelFormat32bppBGRA, &GUID_WICPixelFormat24bppBGR, 32, 24, "BGRA -> 24bppBGR" },
+        { &GUID_WICPixelFormat24bppBGR, &GUID_WICPixelFormat32bppBGRA, 24, 32, "24bppBGR -> BGRA" },
+        { &GUID_WICPixelFormat32bppBGRA, &GUID_WICPixelFormat8bppGray, 32, 8, "BGRA -> 8bppGray" },
+    };
+    const UINT width = winetest_interactive ? 1024 : 256;
+    const UINT height = winetest_interactive ? 512 : 64;
+    const UINT repeat = winetest_interactive ? 8 : 1;
+    LARGE_INTEGER freq, start, end;
+    IWICBitmapSource *converted;
+    UINT src_stride, dst_stride;
+    BYTE *src_data, *dst_data;
+    IWICBitmap *bitmap;
+    UINT i, x, y, n;
+    HRESULT hr;
+    double ms;
+
+    src_data = HeapAlloc(GetProcessHeap(), 0, width * height * 4);
+    dst_data = HeapAlloc(GetProcessHeap(), 0, width * height * 4);
+    QueryPerformanceFrequency(&freq);
+
+    for (i = 0; i < ARRAY_SIZE(tests); i++)
+    {
+        src_stride = width * tests[i].src_bpp / 8;
+        dst_stride = width * tests[i].dst_bpp / 8;
+
+        for (y = 0; y < height; y++)
+            for (x = 0; x < width; x++)
+            {
+                DWORD pixel = perf_pixel(x, y, IsEqualGUID(tests[i].src_format, &GUID_WICPixelFormat32bppPBGRA));
+                memcpy(src_data + y * src_stride + x * tests[i].src_bpp / 8, &pixel, tests[i].src_bpp / 8);
+            }
+
+        hr = IWICImagingFactory_CreateBitmapFromMemory(factory, width, height, tests[i].src_format,
+            src_stride, src_stride * height, src_data, &bitmap);
+        ok(hr == S_OK, "%s: CreateBitmapFromMemory error %#x\n", tests[i].name, hr);
+        if (hr != S_OK) continue;
+
+        hr = WICConvertBitmapSource(tests[i].dst_format, (IWICBitmapSource *)bitmap, &converted);
+        ok(hr == S_OK, "%s: WICConvertBitmapSource error %#x\n", tests[i].name, hr);
+        if (hr != S_OK)
+        {
+            IWICBitmap_Release(bitmap);
+            continue;
+        }
+
+        QueryPerformanceCounter(&start);
+        for (n = 0; n < repeat; n++)
+        {
+            hr = IWICBitmapSource_CopyPixels(converted, NULL, dst_stride, dst_stride * height, dst_data);
+            ok(hr == S_OK, "%s: CopyPixels error %#x\n", tests[i].name, hr);
+        }
+        QueryPerformanceCounter(&end);
+
+        if (winetest_interactive)
+        {
+            ms = (end.QuadPart - start.QuadPart) * 1000.0 / freq.QuadPart / repeat;
+            trace("%s: %ux%u in %.2f ms, %.1f Mpixels/s\n", tests[i].name, width, height, ms,
+                  ms > 0.0 ? width * height / ms / 1000.0 : 0.0);
+        }
+
+        for (y = 0; y < height; y += 37)
+            for (x = 0; x < width; x += 13)
+                check_perf_pixel(tests[i].src_format, tests[i].dst_format, dst_data, dst_stride, x, y, tests[i].name);
+
+        IWICBitmapSource_Release(converted);
+        IWICBitmap_Release(bitmap);
+    }
+
+    HeapFree(GetProcessHeap(), 0, dst_data);
+    HeapFree(GetProcessHeap(), 0, src_data);
+}
+
 START_TEST(converter)
 {
     HRESULT hr;
@@ -1923,6 +2081,7 @@ START_TEST(converter)
     test_invalid_conversion();
     test_default_converter();
     test_converter_8bppIndexed();
+    test_bulk_conversion();
 
     test_encoder(&testdata_8bppIndexed, &CLSID_WICGifEncoder,
                  &testdata_8bppIndexed, &CLSID_WICGifDecoder, "GIF encoder 8bppIndexed");
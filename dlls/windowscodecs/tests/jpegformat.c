@@ -18,8 +18,11 @@
 
 #include "objbase.h"
 #include "wincodec.h"
+#include "psapi.h"
 #include "wine/test.h"
 
+static BOOL (WINAPI *pK32GetProcessMemoryInfo)(HANDLE, PROCESS_MEMORY_COUNTERS *, DWORD);
+
 static const char jpeg_adobe_cmyk_1x5[] =
     "\xff\xd8\xff\xe0\x00\x10\x4a\x46\x49\x46\x00\x01\x01\x01\x01\x2c"
     "\x01\x2c\x00\x00\xff\xee\x00\x0e\x41\x64\x6f\x62\x65\x00\x64\x00"
@@ -155,11 +158,328 @@ static void test_decode_adobe_cmyk(void)
 }
 
 
+static UINT image_width, image_height;
+
+static BYTE large_pixel(UINT x, UINT y, UINT channel)
+{
+    /* smooth content, so that the DCT scaled output is close to a box filter */
+    return x / 32 + y / 24 + channel * 40;
+}
+
+static IStream *create_large_jpeg(IWICImagingFactory *factory)
+{
+    IWICBitmapFrameEncode *frame_encode;
+    IWICBitmapEncoder *encoder;
+    IPropertyBag2 *options;
+    IWICBitmap *bitmap;
+    WICPixelFormatGUID format;
+    IStream *stream;
+    BYTE *data;
+    UINT x, y;
+    HRESULT hr;
+
+    data = HeapAlloc(GetProcessHeap(), 0, image_width * image_height * 3);
+    for (y = 0; y < image_height; y++)
+        for (x = 0; x < image_width * 3; x++)
+            data[y * image_width * 3 + x] = large_pixel(x / 3, y, x % 3);
+
+    hr = IWICImagingFactory_CreateBitmapFromMemory(factory, image_width, image_height,
+        &GUID_WICPixelFormat24bppBGR, image_width * 3, image_width * image_height * 3, data, &bitmap);
+    ok(hr == S_OK, "CreateBitmapFromMemory error %#x\n", hr);
+
+    hr = CreateStreamOnHGlobal(NULL, TRUE, &stream);
+    ok(hr == S_OK, "CreateStream error %#x\n", hr);
+
+    hr = IWICImagingFactory_CreateEncoder(factory, &GUID_ContainerFormatJpeg, NULL, &encoder);
+    ok(hr == S_OK, "CreateEncoder error %#x\n", hr);
+    hr = IWICBitmapEncoder_Initialize(encoder, stream, WICBitmapEncoderNoCache);
+    ok(hr == S_OK, "Initialize error %#x\n", hr);
+    hr = IWICBitmapEncoder_CreateNewFrame(encoder, &frame_encode, &options);
+    ok(hr == S_OK, "CreateNewFrame error %#x\n", hr);
+    hr = IWICBitmapFrameEncode_Initialize(frame_encode, options);
+    ok(hr == S_OK, "Initialize error %#x\n", hr);
+    IPropertyBag2_Release(options);
+    hr = IWICBitmapFrameEncode_SetSize(frame_encode, image_width, image_height);
+    ok(hr == S_OK, "SetSize error %#x\n", hr);
+    format = GUID_WICPixelFormat24bppBGR;
+    hr = IWICBitmapFrameEncode_SetPixelFormat(frame_encode, &format);
+    ok(hr == S_OK, "SetPixelFormat error %#x\n", hr);
+    hr = IWICBitmapFrameEncode_WriteSource(frame_encode, (IWICBitmapSource *)bitmap, NULL);
+    ok(hr == S_OK, "WriteSource error %#x\n", hr);
+    hr = IWICBitmapFrameEncode_Commit(frame_encode);
+    ok(hr == S_OK, "Commit error %#x\n", hr);
+    hr = IWICBitmapEncoder_Commit(encoder);
+    ok(hr == S_OK, "Commit error %#x\n", hr);
+
+    IWICBitmapFrameEncode_Release(frame_encode);
+    IWICBitmapEncoder_Release(encoder);
+    IWICBitmap_Release(bitmap);
+    HeapFree(GetProcessHeap(), 0, data);
+    return stream;
+}
+
+static BOOL get_memory_counters(PROCESS_MEMORY_COUNTERS *counters)
+{
+    return pK32GetProcessMemoryInfo && pK32GetProcessMemoryInfo(GetCurrentProcess(), counters, sizeof(*counters));
+}
+
+static void save_stream(IStream *stream, const char *name)
+{
+    HGLOBAL hglobal;
+    DWORD written;
+    HANDLE file;
+    HRESULT hr;
+
+    hr = GetHGlobalFromStream(stream, &hglobal);
+    ok(hr == S_OK, "GetHGlobalFromStream error %#x\n", hr);
+    file = CreateFileA(name, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, 0, NULL);
+    ok(file != INVALID_HANDLE_VALUE, "CreateFile error %u\n", GetLastError());
+    WriteFile(file, GlobalLock(hglobal), GlobalSize(hglobal), &written, NULL);
+    GlobalUnlock(hglobal);
+    CloseHandle(file);
+}
+
+static void run_child(const char *args)
+{
+    PROCESS_INFORMATION pi;
+    STARTUPINFOA si = {sizeof(si)};
+    char cmdline[MAX_PATH], **argv;
+    BOOL ret;
+
+    winetest_get_mainargs(&argv);
+    sprintf(cmdline, "\"%s\" jpegformat %s", argv[0], args);
+    ret = CreateProcessA(NULL, cmdline, NULL, NULL, FALSE, 0, NULL, NULL, &si, &pi);
+    ok(ret, "CreateProcess error %u\n", GetLastError());
+    if (!ret) return;
+    wait_child_process(pi.hProcess);
+    CloseHandle(pi.hThread);
+    CloseHandle(pi.hProcess);
+}
+
+/* Runs in a fresh process, so that the peak counter starts out small. */
+static void test_decode_peak(const char *mode)
+{
+    PROCESS_MEMORY_COUNTERS before, after;
+    IWICBitmapSourceTransform *transform;
+    IWICBitmapFrameDecode *frame;
+    IWICBitmapDecoder *decoder;
+    IWICImagingFactory *factory;
+    WICPixelFormatGUID format;
+    UINT width, height;
+    BYTE *data;
+    HRESULT hr;
+
+    hr = CoCreateInstance(&CLSID_WICImagingFactory, NULL, CLSCTX_INPROC_SERVER,
+        &IID_IWICImagingFactory, (void **)&factory);
+    ok(hr == S_OK, "CoCreateInstance error %#x\n", hr);
+    hr = IWICImagingFactory_CreateDecoderFromFilename(factory, L"large.jpg", NULL, GENERIC_READ,
+        WICDecodeMetadataCacheOnDemand, &decoder);
+    ok(hr == S_OK, "CreateDecoderFromFilename error %#x\n", hr);
+    hr = IWICBitmapDecoder_GetFrame(decoder, 0, &frame);
+    ok(hr == S_OK, "GetFrame error %#x\n", hr);
+
+    if (!strcmp(mode, "scaled"))
+    {
+        hr = IWICBitmapFrameDecode_QueryInterface(frame, &IID_IWICBitmapSourceTransform, (void **)&transform);
+        if (hr != S_OK)
+        {
+            win_skip("IWICBitmapSourceTransform is not supported\n");
+            goto done;
+        }
+        format = GUID_WICPixelFormat24bppBGR;
+        width = image_width / 8;
+        height = image_height / 8;
+        hr = IWICBitmapSourceTransform_GetClosestSize(transform, &width, &height);
+        ok(hr == S_OK, "GetClosestSize error %#x\n", hr);
+        data = HeapAlloc(GetProcessHeap(), 0, width * 3 * height);
+        if (!get_memory_counters(&before)) goto skip;
+        hr = IWICBitmapSourceTransform_CopyPixels(transform, NULL, width, height, &format,
+            WICBitmapTransformRotate0, width * 3, width * 3 * height, data);
+        IWICBitmapSourceTransform_Release(transform);
+    }
+    else
+    {
+        width = image_width;
+        height = image_height;
+        data = HeapAlloc(GetProcessHeap(), 0, width * 3 * height);
+        if (!get_memory_counters(&before)) goto skip;
+        hr = IWICBitmapFrameDecode_CopyPixels(frame, NULL, width * 3, width * 3 * height, data);
+    }
+    ok(hr == S_OK, "CopyPixels error %#x\n", hr);
+    get_memory_counters(&after);
+    trace("%s decode to %ux%u: peak memory use %lu KiB above the initial use\n", mode, width, height,
+        (ULONG)((max(after.PeakPagefileUsage, before.PagefileUsage) - before.PagefileUsage) / 1024));
+    HeapFree(GetProcessHeap(), 0, data);
+    goto done;
+
+skip:
+    win_skip("K32GetProcessMemoryInfo is not available\n");
+    HeapFree(GetProcessHeap(), 0, data);
+done:
+    IWICBitmapFrameDecode_Release(frame);
+    IWICBitmapDecoder_Release(decoder);
+    IWICImagingFactory_Release(factory);
+}
+
+static IWICBitmapFrameDecode *get_large_frame(IWICImagingFactory *factory, IStream *stream)
+{
+    IWICBitmapFrameDecode *frame;
+    IWICBitmapDecoder *decoder;
+    HRESULT hr;
+
+    hr = IWICImagingFactory_CreateDecoderFromStream(factory, stream, NULL, WICDecodeMetadataCacheOnDemand, &decoder);
+    ok(hr == S_OK, "CreateDecoderFromStream error %#x\n", hr);
+    hr = IWICBitmapDecoder_GetFrame(decoder, 0, &frame);
+    ok(hr == S_OK, "GetFrame error %#x\n", hr);
+    IWICBitmapDecoder_Release(decoder);
+    return frame;
+}
+
+static void test_decode_large(void)
+{
+    UINT width, height, x, y, c, full_stride, stride, max_diff;
+    IWICBitmapSourceTransform *transform;
+    IWICBitmapFrameDecode *frame;
+    IWICImagingFactory *factory;
+    BYTE *full, *scaled, *row;
+    WICPixelFormatGUID format;
+    DWORD start, ticks;
+    IStream *stream;
+    BOOL supported;
+    WICRect rc;
+    HRESULT hr;
+
+    hr = CoCreateInstance(&CLSID_WICImagingFactory, NULL, CLSCTX_INPROC_SERVER,
+        &IID_IWICImagingFactory, (void **)&factory);
+    ok(hr == S_OK, "CoCreateInstance error %#x\n", hr);
+
+    stream = create_large_jpeg(factory);
+
+    full_stride = image_width * 3;
+    full = HeapAlloc(GetProcessHeap(), 0, full_stride * image_height);
+    row = HeapAlloc(GetProcessHeap(), 0, full_stride);
+
+    /* thumbnail through IWICBitmapSourceTransform, scaled while decoding */
+    frame = get_large_frame(factory, stream);
+    hr = IWICBitmapFrameDecode_QueryInterface(frame, &IID_IWICBitmapSourceTransform, (void **)&transform);
+    ok(hr == S_OK || broken(hr == E_NOINTERFACE), "QueryInterface error %#x\n", hr);
+    if (hr == S_OK)
+    {
+        hr = IWICBitmapSourceTransform_DoesSupportTransform(transform, WICBitmapTransformRotate0, &supported);
+        ok(hr == S_OK, "DoesSupportTransform error %#x\n", hr);
+        ok(supported, "Rotate0 should be supported\n");
+
+        format = GUID_WICPixelFormat32bppBGRA;
+        hr = IWICBitmapSourceTransform_GetClosestPixelFormat(transform, &format);
+        ok(hr == S_OK, "GetClosestPixelFormat error %#x\n", hr);
+        ok(IsEqualGUID(&format, &GUID_WICPixelFormat24bppBGR), "got format %s\n", wine_dbgstr_guid(&format));
+
+        width = image_width / 8;
+        height = image_height / 8;
+        hr = IWICBitmapSourceTransform_GetClosestSize(transform, &width, &height);
+        ok(hr == S_OK, "GetClosestSize error %#x\n", hr);
+        ok(width >= image_width / 8 && width < image_width && height >= image_height / 8 && height < image_height,
+            "got size %ux%u\n", width, height);
+
+        stride = width * 3;
+        scaled = HeapAlloc(GetProcessHeap(), 0, stride * height);
+
+        start = GetTickCount();
+        hr = IWICBitmapSourceTransform_CopyPixels(transform, NULL, width, height, &format,
+            WICBitmapTransformRotate0, stride, stride * height, scaled);
+        ticks = GetTickCount() - start;
+        ok(hr == S_OK, "CopyPixels error %#x\n", hr);
+        if (winetest_interactive) trace("scaled decode to %ux%u: %u ms\n", width, height, ticks);
+
+        max_diff = 0;
+        for (y = 0; y < height; y++)
+            for (x = 0; x < width; x++)
+                for (c = 0; c < 3; c++)
+                {
+                    UINT expected = large_pixel(x * image_width / width, y * image_height / height, c);
+                    UINT value = scaled[y * stride + x * 3 + c];
+                    max_diff = max(max_diff, value > expected ? value - expected : expected - value);
+                }
+        ok(max_diff <= 8, "scaled pixels differ by up to %u\n", max_diff);
+
+        HeapFree(GetProcessHeap(), 0, scaled);
+        IWICBitmapSourceTransform_Release(transform);
+    }
+    IWICBitmapFrameDecode_Release(frame);
+
+    /* whole frame at once */
+    frame = get_large_frame(factory, stream);
+    start = GetTickCount();
+    hr = IWICBitmapFrameDecode_CopyPixels(frame, NULL, full_stride, full_stride * image_height, full);
+    ticks = GetTickCount() - start;
+    ok(hr == S_OK, "CopyPixels error %#x\n", hr);
+    if (winetest_interactive) trace("full decode of %ux%u: %u ms\n", image_width, image_height, ticks);
+    IWICBitmapFrameDecode_Release(frame);
+
+    /* one row at a time, in order, and a partial rectangle */
+    frame = get_large_frame(factory, stream);
+    rc.X = 0;
+    rc.Width = image_width;
+    rc.Height = 1;
+    start = GetTickCount();
+    for (y = 0; y < image_height; y++)
+    {
+        rc.Y = y;
+        hr = IWICBitmapFrameDecode_CopyPixels(frame, &rc, full_stride, full_stride, row);
+        if (hr != S_OK || memcmp(row, full + y * full_stride, full_stride)) break;
+    }
+    ticks = GetTickCount() - start;
+    ok(y == image_height, "row %u differs, hr %#x\n", y, hr);
+    if (winetest_interactive) trace("row by row decode: %u ms\n", ticks);
+
+    /* going back to rows already returned */
+    rc.X = image_width / 2;
+    rc.Y = image_height / 3;
+    rc.Width = image_width / 4;
+    rc.Height = 1;
+    hr = IWICBitmapFrameDecode_CopyPixels(frame, &rc, full_stride, full_stride, row);
+    ok(hr == S_OK, "CopyPixels error %#x\n", hr);
+    ok(!memcmp(row, full + rc.Y * full_stride + rc.X * 3, rc.Width * 3), "unexpected pixels\n");
+    IWICBitmapFrameDecode_Release(frame);
+
+    /* The peak memory use is measured in child processes, the one of this
+     * process already includes the buffers above. */
+    if (winetest_interactive)
+    {
+        save_stream(stream, "large.jpg");
+        run_child("peak scaled");
+        run_child("peak full");
+        DeleteFileA("large.jpg");
+    }
+
+    HeapFree(GetProcessHeap(), 0, row);
+    HeapFree(GetProcessHeap(), 0, full);
+    IStream_Release(stream);
+    IWICImagingFactory_Release(factory);
+}
+
 START_TEST(jpegformat)
 {
+    char **argv;
+    int argc;
+
+    pK32GetProcessMemoryInfo = (void *)GetProcAddress(GetModuleHandleA("kernel32.dll"), "K32GetProcessMemoryInfo");
+
     CoInitializeEx(NULL, COINIT_APARTMENTTHREADED);
 
+    image_width = winetest_interactive ? 2048 : 512;
+    image_height = winetest_interactive ? 1536 : 384;
+
+    argc = winetest_get_mainargs(&argv);
+    if (argc >= 4 && !strcmp(argv[2], "peak"))
+    {
+        test_decode_peak(argv[3]);
+        CoUninitialize();
+        return;
+    }
+
     test_decode_adobe_cmyk();
+    test_decode_large();
 
     CoUninitialize();
 }
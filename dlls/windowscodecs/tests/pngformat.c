@@ -734,7 +734,6 @@ static void test_color_formats(void)
         const GUID *format_PLTE;
         const GUID *format_PLTE_tRNS;
         BOOL todo;
-        BOOL todo_load;
     } td[] =
     {
         /* 2 - PNG_COLOR_TYPE_RGB */
@@ -743,12 +742,9 @@ static void test_color_formats(void)
         { 4, PNG_COLOR_TYPE_RGB, NULL, NULL, NULL },
         { 8, PNG_COLOR_TYPE_RGB,
           &GUID_WICPixelFormat24bppBGR, &GUID_WICPixelFormat24bppBGR, &GUID_WICPixelFormat24bppBGR },
-        /* libpng refuses to load our test image complaining about extra compressed data,
-         * but libpng is still able to load the image with other combination of type/depth
-         * making RGB 16 bpp case special for some reason. Therefore todo = TRUE.
-         */
+        /* Wine turns the tRNS chunk into an alpha channel. */
         { 16, PNG_COLOR_TYPE_RGB,
-          &GUID_WICPixelFormat48bppRGB, &GUID_WICPixelFormat48bppRGB, &GUID_WICPixelFormat48bppRGB, TRUE, TRUE },
+          &GUID_WICPixelFormat48bppRGB, &GUID_WICPixelFormat48bppRGB, &GUID_WICPixelFormat48bppRGB, TRUE },
         { 24, PNG_COLOR_TYPE_RGB, NULL, NULL, NULL },
         { 32, PNG_COLOR_TYPE_RGB, NULL, NULL, NULL },
         /* 0 - PNG_COLOR_TYPE_GRAY */
@@ -815,7 +811,6 @@ static void test_color_formats(void)
         if (!is_valid_png_type_depth(td[i].color_type, td[i].bit_depth, TRUE))
             ok(hr == WINCODEC_ERR_UNKNOWNIMAGEFORMAT, "%d: wrong error %#x\n", i, hr);
         else
-todo_wine_if(td[i].todo_load)
             ok(hr == S_OK, "%d: Failed to load PNG image data (type %d, bpp %d) %#x\n", i, td[i].color_type, td[i].bit_depth, hr);
         if (hr != S_OK) goto next_1;
 
@@ -843,7 +838,6 @@ next_1:
         if (!is_valid_png_type_depth(td[i].color_type, td[i].bit_depth, TRUE))
             ok(hr == WINCODEC_ERR_UNKNOWNIMAGEFORMAT, "%d: wrong error %#x\n", i, hr);
         else
-todo_wine_if(td[i].todo_load)
             ok(hr == S_OK, "%d: Failed to load PNG image data (type %d, bpp %d) %#x\n", i, td[i].color_type, td[i].bit_depth, hr);
         if (hr != S_OK) goto next_2;
 
@@ -871,7 +865,6 @@ next_2:
         if (!is_valid_png_type_depth(td[i].color_type, td[i].bit_depth, FALSE))
             ok(hr == WINCODEC_ERR_UNKNOWNIMAGEFORMAT, "%d: wrong error %#x\n", i, hr);
         else
-todo_wine_if(td[i].todo_load)
             ok(hr == S_OK, "%d: Failed to load PNG image data (type %d, bpp %d) %#x\n", i, td[i].color_type, td[i].bit_depth, hr);
         if (hr != S_OK) goto next_3;
 
@@ -898,7 +891,6 @@ next_3:
         if (!is_valid_png_type_depth(td[i].color_type, td[i].bit_depth, FALSE))
             ok(hr == WINCODEC_ERR_UNKNOWNIMAGEFORMAT, "%d: wrong error %#x\n", i, hr);
         else
-todo_wine_if(td[i].todo_load)
             ok(hr == S_OK, "%d: Failed to load PNG image data (type %d, bpp %d) %#x\n", i, td[i].color_type, td[i].bit_depth, hr);
         if (hr != S_OK) continue;
 
@@ -922,6 +914,153 @@ todo_wine_if(td[i].todo)
 #undef PNG_COLOR_TYPE_GRAY_ALPHA
 #undef PNG_COLOR_TYPE_RGB_ALPHA
 
+static BYTE stream_pixel(UINT x, UINT y, UINT c)
+{
+    return (x * 7 + y * 13 + c * 71) & 0xff;
+}
+
+static IStream *create_png_stream(UINT width, UINT height, BOOL interlace)
+{
+    IWICBitmapFrameEncode *frame_encode;
+    IWICBitmapEncoder *encoder;
+    IPropertyBag2 *options;
+    WICPixelFormatGUID format;
+    PROPBAG2 option = {0};
+    IWICBitmap *bitmap;
+    IStream *stream;
+    VARIANT var;
+    BYTE *data;
+    HRESULT hr;
+    UINT x, y;
+
+    data = HeapAlloc(GetProcessHeap(), 0, width * height * 3);
+    for (y = 0; y < height; y++)
+        for (x = 0; x < width * 3; x++)
+            data[y * width * 3 + x] = stream_pixel(x / 3, y, x % 3);
+
+    hr = IWICImagingFactory_CreateBitmapFromMemory(factory, width, height, &GUID_WICPixelFormat24bppBGR,
+        width * 3, width * height * 3, data, &bitmap);
+    ok(hr == S_OK, "CreateBitmapFromMemory error %#x\n", hr);
+
+    hr = CreateStreamOnHGlobal(NULL, TRUE, &stream);
+    ok(hr == S_OK, "CreateStream error %#x\n", hr);
+
+    hr = IWICImagingFactory_CreateEncoder(factory, &GUID_ContainerFormatPng, NULL, &encoder);
+    ok(hr == S_OK, "CreateEncoder error %#x\n", hr);
+    hr = IWICBitmapEncoder_Initialize(encoder, stream, WICBitmapEncoderNoCache);
+    ok(hr == S_OK, "Initialize error %#x\n", hr);
+    hr = IWICBitmapEncoder_CreateNewFrame(encoder, &frame_encode, &options);
+    ok(hr == S_OK, "CreateNewFrame error %#x\n", hr);
+    option.pstrName = (LPOLESTR)L"InterlaceOption";
+    V_VT(&var) = VT_BOOL;
+    V_BOOL(&var) = interlace ? VARIANT_TRUE : VARIANT_FALSE;
+    hr = IPropertyBag2_Write(options, 1, &option, &var);
+    ok(hr == S_OK, "Write error %#x\n", hr);
+    hr = IWICBitmapFrameEncode_Initialize(frame_encode, options);
+    ok(hr == S_OK, "Initialize error %#x\n", hr);
+    IPropertyBag2_Release(options);
+    hr = IWICBitmapFrameEncode_SetSize(frame_encode, width, height);
+    ok(hr == S_OK, "SetSize error %#x\n", hr);
+    format = GUID_WICPixelFormat24bppBGR;
+    hr = IWICBitmapFrameEncode_SetPixelFormat(frame_encode, &format);
+    ok(hr == S_OK, "SetPixelFormat error %#x\n", hr);
+    hr = IWICBitmapFrameEncode_WriteSource(frame_encode, (IWICBitmapSource *)bitmap, NULL);
+    ok(hr == S_OK, "WriteSource error %#x\n", hr);
+    hr = IWICBitmapFrameEncode_Commit(frame_encode);
+    ok(hr == S_OK, "Commit error %#x\n", hr);
+    hr = IWICBitmapEncoder_Commit(encoder);
+    ok(hr == S_OK, "Commit error %#x\n", hr);
+
+    IWICBitmapFrameEncode_Release(frame_encode);
+    IWICBitmapEncoder_Release(encoder);
+    IWICBitmap_Release(bitmap);
+    HeapFree(GetProcessHeap(), 0, data);
+    return stream;
+}
+
+static IWICBitmapFrameDecode *get_stream_frame(IStream *stream)
+{
+    IWICBitmapFrameDecode *frame;
+    IWICBitmapDecoder *decoder;
+    LARGE_INTEGER zero;
+    HRESULT hr;
+
+    zero.QuadPart = 0;
+    IStream_Seek(stream, zero, STREAM_SEEK_SET, NULL);
+    hr = IWICImagingFactory_CreateDecoderFromStream(factory, stream, NULL, 0, &decoder);
+    ok(hr == S_OK, "CreateDecoderFromStream error %#x\n", hr);
+    hr = IWICBitmapDecoder_GetFrame(decoder, 0, &frame);
+    ok(hr == S_OK, "GetFrame error %#x\n", hr);
+    IWICBitmapDecoder_Release(decoder);
+    return frame;
+}
+
+static BOOL check_stream_rect(IWICBitmapFrameDecode *frame, const WICRect *rc)
+{
+    BYTE buf[64 * 64 * 3];
+    UINT x, y, c;
+    HRESULT hr;
+
+    memset(buf, 0xcc, sizeof(buf));
+    hr = IWICBitmapFrameDecode_CopyPixels(frame, rc, rc->Width * 3, rc->Width * 3 * rc->Height, buf);
+    ok(hr == S_OK, "CopyPixels(%d,%d,%d,%d) error %#x\n", rc->X, rc->Y, rc->Width, rc->Height, hr);
+    if (hr != S_OK) return FALSE;
+
+    for (y = 0; y < rc->Height; y++)
+        for (x = 0; x < rc->Width; x++)
+            for (c = 0; c < 3; c++)
+                if (buf[(y * rc->Width + x) * 3 + c] != stream_pixel(rc->X + x, rc->Y + y, c))
+                    return FALSE;
+    return TRUE;
+}
+
+static void test_png_streaming(void)
+{
+    static const WICRect rows[] =
+    {
+        /* in order, with a sub-rectangle and a skipped row */
+        { 0, 0, 64, 1 },
+        { 5, 1, 20, 8 },
+        { 0, 9, 64, 3 },
+        { 40, 13, 24, 10 },
+        /* going back */
+        { 0, 2, 64, 4 },
+        { 7, 0, 9, 64 },
+        { 0, 60, 64, 4 },
+    };
+    IWICBitmapFrameDecode *frame;
+    IStream *stream;
+    WICRect rc = { 0, 0, 64, 64 };
+    UINT interlace, i, y;
+
+    for (interlace = 0; interlace < 2; interlace++)
+    {
+        winetest_push_context("interlace %u", interlace);
+        stream = create_png_stream(64, 64, interlace);
+
+        /* reading every row in order */
+        frame = get_stream_frame(stream);
+        for (y = 0; y < 64; y++)
+        {
+            rc.Y = y;
+            rc.Height = 1;
+            ok(check_stream_rect(frame, &rc), "row %u does not match\n", y);
+        }
+        IWICBitmapFrameDecode_Release(frame);
+
+        frame = get_stream_frame(stream);
+        for (i = 0; i < ARRAY_SIZE(rows); i++)
+            ok(check_stream_rect(frame, &rows[i]), "rect %u does not match\n", i);
+        rc.Y = 0;
+        rc.Height = 64;
+        ok(check_stream_rect(frame, &rc), "full frame does not match\n");
+        IWICBitmapFrameDecode_Release(frame);
+
+        IStream_Release(stream);
+        winetest_pop_context();
+    }
+}
+
 START_TEST(pngformat)
 {
     HRESULT hr;
@@ -935,6 +1074,7 @@ START_TEST(pngformat)
     test_color_contexts();
     test_png_palette();
     test_color_formats();
+    test_png_streaming();
 
     IWICImagingFactory_Release(factory);
     CoUninitialize();
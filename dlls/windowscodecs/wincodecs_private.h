@@ -260,6 +260,7 @@ struct decoder_info
 };
 
 #define DECODER_FLAGS_CAPABILITY_MASK 0x1f
+#define DECODER_FLAGS_SUPPORTS_SCALING 0x40000000
 #define DECODER_FLAGS_UNSUPPORTED_COLOR_CONTEXT 0x80000000
 
 struct decoder_stat
@@ -306,6 +307,10 @@ struct decoder_funcs
     HRESULT (CDECL *get_color_context)(struct decoder* This, UINT frame, UINT num,
         BYTE **data, DWORD *datasize);
     void (CDECL *destroy)(struct decoder* This);
+    /* only used when DECODER_FLAGS_SUPPORTS_SCALING is set */
+    HRESULT (CDECL *get_closest_size)(struct decoder* This, UINT frame, UINT *width, UINT *height);
+    HRESULT (CDECL *copy_pixels_scaled)(struct decoder* This, UINT frame, UINT width, UINT height,
+        const WICRect *prc, UINT stride, UINT buffersize, BYTE *buffer);
 };
 
 HRESULT CDECL stream_getsize(IStream *stream, ULONGLONG *size);
@@ -323,6 +328,9 @@ HRESULT CDECL decoder_get_metadata_blocks(struct decoder* This, UINT frame, UINT
 HRESULT CDECL decoder_get_color_context(struct decoder* This, UINT frame, UINT num,
     BYTE **data, DWORD *datasize);
 void CDECL decoder_destroy(struct decoder *This);
+HRESULT CDECL decoder_get_closest_size(struct decoder* This, UINT frame, UINT *width, UINT *height);
+HRESULT CDECL decoder_copy_pixels_scaled(struct decoder* This, UINT frame, UINT width, UINT height,
+    const WICRect *prc, UINT stride, UINT buffersize, BYTE *buffer);
 
 struct encoder_funcs;
 
@@ -52,6 +52,7 @@
 #include "wine/debug.h"
 
 WINE_DEFAULT_DEBUG_CHANNEL(bitblt);
+WINE_DECLARE_DEBUG_CHANNEL(surface);
 
 
 #define DST 0   /* Destination drawable */
@@ -1564,7 +1565,17 @@ struct x11drv_window_surface
     Window                window;
     GC                    gc;
     XImage               *image;
-    RECT                  bounds;
+    RECT                  bounds;       /* bounds of the drawing done since the last unlock */
+    RECT                  dirty;        /* bounding rectangle of the dirty tiles */
+    BYTE                 *tiles;        /* dirty flag for each tile */
+    int                   tiles_x;
+    int                   tiles_y;
+    RECT                 *flush_rects;
+    DWORD                 dirty_ticks;
+    int                   lock_count;
+    DWORD                 stats_ticks;
+    UINT                  stats_flushes;
+    ULONGLONG             stats_bytes;
     BOOL                  byteswap;
     BOOL                  is_argb;
     DWORD                 alpha_bits;
@@ -1872,6 +1883,106 @@ failed:
 }
 #endif /* HAVE_LIBXXSHM */
 
+/* the surface is flushed in tiles, so that updates in distant parts of a
+ * window don't require pushing everything in between */
+#define TILE_SIZE 32
+#define FLUSH_PERIOD 50  /* time in ms since drawing started for forcing a surface flush */
+
+/***********************************************************************
+ *           add_dirty_tiles
+ *
+ * Move the bounds of the drawing done under the surface lock to the dirty tiles.
+ */
+static void add_dirty_tiles( struct x11drv_window_surface *surface )
+{
+    int y, left, right, top, bottom;
+    RECT rect;
+
+    SetRect( &rect, 0, 0, surface->header.rect.right - surface->header.rect.left,
+             surface->header.rect.bottom - surface->header.rect.top );
+    if (IntersectRect( &rect, &rect, &surface->bounds ))
+    {
+        left   = rect.left / TILE_SIZE;
+        right  = (rect.right + TILE_SIZE - 1) / TILE_SIZE;
+        top    = rect.top / TILE_SIZE;
+        bottom = (rect.bottom + TILE_SIZE - 1) / TILE_SIZE;
+        for (y = top; y < bottom; y++)
+            memset( surface->tiles + y * surface->tiles_x + left, 1, right - left );
+
+        if (IsRectEmpty( &surface->dirty ))
+        {
+            surface->dirty_ticks = GetTickCount();
+            SetRect( &surface->dirty, left, top, right, bottom );
+        }
+        else
+        {
+            surface->dirty.left   = min( surface->dirty.left, left );
+            surface->dirty.top    = min( surface->dirty.top, top );
+            surface->dirty.right  = max( surface->dirty.right, right );
+            surface->dirty.bottom = max( surface->dirty.bottom, bottom );
+        }
+    }
+    reset_bounds( &surface->bounds );
+}
+
+/***********************************************************************
+ *           get_dirty_rects
+ *
+ * Merge the dirty tiles into rectangles, clear them, and return the rectangle count.
+ * Runs of tiles in a row are merged, and runs spanning the same columns in
+ * consecutive rows are merged vertically, so that each rectangle is pushed
+ * with a single request.
+ */
+static int get_dirty_rects( struct x11drv_window_surface *surface, int *dirty_tiles )
+{
+    int x, y, i, start, count = 0, tiles = 0;
+    int width = surface->header.rect.right - surface->header.rect.left;
+    int height = surface->header.rect.bottom - surface->header.rect.top;
+    RECT *rects = surface->flush_rects;
+    BYTE *row;
+
+    for (y = surface->dirty.top; y < surface->dirty.bottom; y++)
+    {
+        row = surface->tiles + y * surface->tiles_x;
+        x = surface->dirty.left;
+        while (x < surface->dirty.right)
+        {
+            while (x < surface->dirty.right && !row[x]) x++;
+            if (x == surface->dirty.right) break;
+            start = x;
+            while (x < surface->dirty.right && row[x]) row[x++] = 0;
+            tiles += x - start;
+
+            for (i = count - 1; i >= 0; i--)
+                if (rects[i].bottom == y && rects[i].left == start && rects[i].right == x) break;
+            if (i >= 0) rects[i].bottom = y + 1;
+            else SetRect( &rects[count++], start, y, x, y + 1 );
+        }
+    }
+
+    /* pushing the bounding box is cheaper than many requests when most of it is dirty */
+    if (count > 1 && tiles * 4 >= (surface->dirty.right - surface->dirty.left) *
+                                  (surface->dirty.bottom - surface->dirty.top) * 3)
+    {
+        rects[0] = surface->dirty;
+        count = 1;
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        rects[i].left   *= TILE_SIZE;
+        rects[i].top    *= TILE_SIZE;
+        rects[i].right  = min( rects[i].right * TILE_SIZE, width );
+        rects[i].bottom = min( rects[i].bottom * TILE_SIZE, height );
+    }
+
+    SetRectEmpty( &surface->dirty );
+    *dirty_tiles = tiles;
+    return count;
+}
+
+static void CDECL x11drv_surface_flush( struct window_surface *window_surface );
+
 /***********************************************************************
  *           x11drv_surface_lock
  */
@@ -1880,6 +1991,7 @@ static void CDECL x11drv_surface_lock( struct window_surface *window_surface )
     struct x11drv_window_surface *surface = get_x11_surface( window_surface );
 
     EnterCriticalSection( &surface->crit );
+    surface->lock_count++;
 }
 
 /***********************************************************************
@@ -1888,8 +2000,15 @@ static void CDECL x11drv_surface_lock( struct window_surface *window_surface )
 static void CDECL x11drv_surface_unlock( struct window_surface *window_surface )
 {
     struct x11drv_window_surface *surface = get_x11_surface( window_surface );
+    BOOL flush;
 
+    /* the bounds are reset after each drawing operation, so the caller's check
+     * for drawing in progress never sees them set; flush periodically here instead */
+    add_dirty_tiles( surface );
+    flush = !--surface->lock_count && !IsRectEmpty( &surface->dirty ) &&
+            GetTickCount() - surface->dirty_ticks > FLUSH_PERIOD;
     LeaveCriticalSection( &surface->crit );
+    if (flush) x11drv_surface_flush( window_surface );
 }
 
 /***********************************************************************
@@ -1952,62 +2071,87 @@ static void CDECL x11drv_surface_flush( struct window_surface *window_surface )
     struct x11drv_window_surface *surface = get_x11_surface( window_surface );
     unsigned char *src = surface->bits;
     unsigned char *dst = (unsigned char *)surface->image->data;
-    struct bitblt_coords coords;
+    int width_bytes = surface->image->bytes_per_line;
+    int i, y, count, tiles, copied = 0;
+    UINT bytes = 0;
+    RECT *rect;
 
     window_surface->funcs->lock( window_surface );
-    coords.x = 0;
-    coords.y = 0;
-    coords.width  = surface->header.rect.right - surface->header.rect.left;
-    coords.height = surface->header.rect.bottom - surface->header.rect.top;
-    SetRect( &coords.visrect, 0, 0, coords.width, coords.height );
-    if (IntersectRect( &coords.visrect, &coords.visrect, &surface->bounds ))
+    add_dirty_tiles( surface );
+    if (!IsRectEmpty( &surface->dirty ))
     {
-        TRACE( "flushing %p %dx%d bounds %s bits %p\n",
-               surface, coords.width, coords.height,
-               wine_dbgstr_rect( &surface->bounds ), surface->bits );
+        count = get_dirty_rects( surface, &tiles );
 
         if (surface->is_argb || surface->color_key != CLR_INVALID) update_surface_region( surface );
 
-        if (src != dst)
-        {
-            int map[256], *mapping = get_window_surface_mapping( surface->image->bits_per_pixel, map );
-            int width_bytes = surface->image->bytes_per_line;
-
-            src += coords.visrect.top * width_bytes;
-            dst += coords.visrect.top * width_bytes;
-            copy_image_byteswap( &surface->info, src, dst, width_bytes, width_bytes,
-                                 coords.visrect.bottom - coords.visrect.top,
-                                 surface->byteswap, mapping, ~0u, surface->alpha_bits );
-        }
-        else if (surface->alpha_bits)
+        for (i = 0; i < count; i++)
         {
-            int x, y, stride = surface->image->bytes_per_line / sizeof(ULONG);
-            ULONG *ptr = (ULONG *)dst + coords.visrect.top * stride;
+            rect = &surface->flush_rects[i];
+            TRACE( "flushing %p rect %s bits %p\n", surface, wine_dbgstr_rect( rect ), surface->bits );
 
-            for (y = coords.visrect.top; y < coords.visrect.bottom; y++, ptr += stride)
-                for (x = coords.visrect.left; x < coords.visrect.right; x++)
-                    ptr[x] |= surface->alpha_bits;
-        }
+            if (src != dst)
+            {
+                int map[256], *mapping = get_window_surface_mapping( surface->image->bits_per_pixel, map );
+
+                /* rectangles are sorted by top, rows are converted only once */
+                y = max( rect->top, copied );
+                if (y < rect->bottom)
+                {
+                    copy_image_byteswap( &surface->info, src + y * width_bytes, dst + y * width_bytes,
+                                         width_bytes, width_bytes, rect->bottom - y,
+                                         surface->byteswap, mapping, ~0u, surface->alpha_bits );
+                    copied = rect->bottom;
+                }
+            }
+            else if (surface->alpha_bits)
+            {
+                int x, stride = surface->image->bytes_per_line / sizeof(ULONG);
+                ULONG *ptr = (ULONG *)dst + rect->top * stride;
+
+                for (y = rect->top; y < rect->bottom; y++, ptr += stride)
+                    for (x = rect->left; x < rect->right; x++)
+                        ptr[x] |= surface->alpha_bits;
+            }
 
 #ifdef HAVE_LIBXXSHM
-        if (surface->shminfo.shmid != -1)
-            XShmPutImage( gdi_display, surface->window, surface->gc, surface->image,
-                          coords.visrect.left, coords.visrect.top,
-                          surface->header.rect.left + coords.visrect.left,
-                          surface->header.rect.top + coords.visrect.top,
-                          coords.visrect.right - coords.visrect.left,
-                          coords.visrect.bottom - coords.visrect.top, False );
-        else
+            if (surface->shminfo.shmid != -1)
+                XShmPutImage( gdi_display, surface->window, surface->gc, surface->image,
+                              rect->left, rect->top,
+                              surface->header.rect.left + rect->left,
+                              surface->header.rect.top + rect->top,
+                              rect->right - rect->left, rect->bottom - rect->top, False );
+            else
 #endif
-        XPutImage( gdi_display, surface->window, surface->gc, surface->image,
-                   coords.visrect.left, coords.visrect.top,
-                   surface->header.rect.left + coords.visrect.left,
-                   surface->header.rect.top + coords.visrect.top,
-                   coords.visrect.right - coords.visrect.left,
-                   coords.visrect.bottom - coords.visrect.top );
+            XPutImage( gdi_display, surface->window, surface->gc, surface->image,
+                       rect->left, rect->top,
+                       surface->header.rect.left + rect->left,
+                       surface->header.rect.top + rect->top,
+                       rect->right - rect->left, rect->bottom - rect->top );
+            bytes += (rect->bottom - rect->top) *
+                     ((rect->right - rect->left) * surface->image->bits_per_pixel + 7) / 8;
+        }
         XFlush( gdi_display );
+
+        TRACE_(surface)( "%p: pushed %u bytes in %d rects, %d/%d tiles dirty\n",
+                         surface, bytes, count, tiles, surface->tiles_x * surface->tiles_y );
+        if (TRACE_ON(surface))
+        {
+            DWORD time = GetTickCount();
+
+            surface->stats_flushes++;
+            surface->stats_bytes += bytes;
+            /* every 1.5 seconds */
+            if (time - surface->stats_ticks > 1500)
+            {
+                TRACE_(surface)( "%p: %u flushes, %s bytes pushed, %s bytes/flush average\n",
+                                 surface, surface->stats_flushes, wine_dbgstr_longlong( surface->stats_bytes ),
+                                 wine_dbgstr_longlong( surface->stats_bytes / surface->stats_flushes ));
+                surface->stats_ticks = time;
+                surface->stats_flushes = 0;
+                surface->stats_bytes = 0;
+            }
+        }
     }
-    reset_bounds( &surface->bounds );
     window_surface->funcs->unlock( window_surface );
 }
 
@@ -2038,6 +2182,8 @@ static void CDECL x11drv_surface_destroy( struct window_surface *window_surface
     surface->crit.DebugInfo->Spare[0] = 0;
     DeleteCriticalSection( &surface->crit );
     if (surface->region) DeleteObject( surface->region );
+    HeapFree( GetProcessHeap(), 0, surface->tiles );
+    HeapFree( GetProcessHeap(), 0, surface->flush_rects );
     HeapFree( GetProcessHeap(), 0, surface );
 }
 
@@ -2085,6 +2231,15 @@ struct window_surface *create_surface( Window window, const XVisualInfo *vis, co
     set_color_key( surface, color_key );
     reset_bounds( &surface->bounds );
 
+    surface->tiles_x = (width + TILE_SIZE - 1) / TILE_SIZE;
+    surface->tiles_y = (height + TILE_SIZE - 1) / TILE_SIZE;
+    if (!(surface->tiles = HeapAlloc( GetProcessHeap(), HEAP_ZERO_MEMORY,
+                                      max( surface->tiles_x * surface->tiles_y, 1 ))))
+        goto failed;
+    if (!(surface->flush_rects = HeapAlloc( GetProcessHeap(), 0,
+                                            max( surface->tiles_x * surface->tiles_y, 1 ) * sizeof(RECT) )))
+        goto failed;
+
 #ifdef HAVE_LIBXXSHM
     surface->image = create_shm_image( vis, width, height, &surface->shminfo );
     if (!surface->image)
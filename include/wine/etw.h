@@ -0,0 +1,78 @@
+/*
+ * Format of the log files written by local event trace sessions
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef __WINE_WINE_ETW_H
+#define __WINE_WINE_ETW_H
+
+/* The file starts with a wine_etw_log_header, followed by the session
+ * buffers as they get flushed. Each buffer is a wine_etw_buffer_header
+ * followed by its event records, each aligned to 8 bytes. */
+
+#define WINE_ETW_LOG_MAGIC    0x4c575445  /* "ETWL" */
+#define WINE_ETW_LOG_VERSION  1
+
+struct wine_etw_log_header
+{
+    ULONG         magic;
+    ULONG         version;
+    LARGE_INTEGER frequency;        /* frequency of the event timestamps */
+    LARGE_INTEGER start_time;       /* timestamp when the session started */
+    LARGE_INTEGER start_system_time;
+    ULONG         pid;
+    ULONG         buffer_count;
+    ULONG         buffer_size;
+    ULONG         log_file_mode;
+    WCHAR         logger_name[64];
+};
+
+struct wine_etw_buffer_header
+{
+    ULONG         size;             /* size of the records following the header */
+    ULONG         index;            /* index of the session buffer */
+    ULONG         sequence;         /* number of buffers written before this one */
+    ULONG         events_lost;      /* events lost so far in the session */
+};
+
+#define WINE_ETW_EVENT_STRING    0x0001  /* data is a null-terminated WCHAR string */
+#define WINE_ETW_EVENT_ACTIVITY  0x0002  /* activity and related activity are set */
+
+struct wine_etw_event_record
+{
+    ULONG            size;          /* size of the record, including data and padding */
+    USHORT           flags;
+    USHORT           data_count;    /* number of data descriptors */
+    ULONG            pid;
+    ULONG            tid;
+    LARGE_INTEGER    timestamp;
+    GUID             provider;
+    EVENT_DESCRIPTOR descriptor;
+    GUID             activity;
+    GUID             related_activity;
+    ULONG            data_size;
+    ULONG            reserved;
+    /* followed by data_count ULONG sizes, and then the data itself */
+};
+
+/* session management, implemented in ntdll for sechost */
+ULONG CDECL __wine_etw_start_trace( TRACEHANDLE *handle, const WCHAR *name, EVENT_TRACE_PROPERTIES *properties );
+ULONG CDECL __wine_etw_control_trace( TRACEHANDLE handle, const WCHAR *name,
+                                      EVENT_TRACE_PROPERTIES *properties, ULONG control );
+ULONG CDECL __wine_etw_enable_trace( TRACEHANDLE handle, const GUID *guid, ULONG control, UCHAR level,
+                                     ULONGLONG match_any, ULONGLONG match_all );
+
+#endif  /* __WINE_WINE_ETW_H */
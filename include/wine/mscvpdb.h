@@ -2502,6 +2502,23 @@ typedef struct
     WORD        unk7;
 } PDB_STREAM_INDEXES;
 
+/* header of the hash table stream of the global symbols */
+typedef struct _PDB_GSI_HASH_HEADER
+{
+    DWORD       signature;      /* 0xffffffff */
+    DWORD       version;        /* 0xeffe0000 + 19990810 */
+    DWORD       hash_records_size;
+    DWORD       buckets_size;
+} PDB_GSI_HASH_HEADER;
+
+typedef struct _PDB_GSI_HASH_RECORD
+{
+    DWORD       offset;         /* offset of the symbol in the global symbols stream, plus one */
+    DWORD       refcount;
+} PDB_GSI_HASH_RECORD;
+
+#define PDB_GSI_HASH_BUCKETS    4096
+
 typedef struct _PDB_FPO_DATA
 {
     DWORD       start;
@@ -818,6 +818,57 @@ typedef struct
 
 
 
+typedef volatile struct
+{
+    int                  x;
+    int                  y;
+    unsigned int         last_change;
+    rectangle_t          clip;
+} cursor_shm_t;
+
+typedef volatile struct
+{
+    cursor_shm_t         cursor;
+    user_handle_t        foreground;
+    unsigned int         queue_count;
+    unsigned char        keystate[256];
+} desktop_shm_t;
+
+typedef volatile struct
+{
+    unsigned int         input_id;
+    unsigned int         input_offset;
+} queue_shm_t;
+
+typedef volatile struct
+{
+    unsigned int         desktop_id;
+    user_handle_t        focus;
+    user_handle_t        capture;
+    user_handle_t        active;
+    user_handle_t        cursor;
+    int                  cursor_count;
+    int                  keystate_lock;
+    unsigned char        keystate[256];
+    unsigned char        desktop_keystate[256];
+} input_shm_t;
+
+typedef volatile struct
+{
+    unsigned int         seq;
+    unsigned int         id;
+    union
+    {
+        desktop_shm_t    desktop;
+        queue_shm_t      queue;
+        input_shm_t      input;
+    } shm;
+} shared_object_t;
+
+#define SHARED_OBJECTS_SIZE  0x200000
+
+
+
 
 
 struct new_process_request
@@ -5239,6 +5290,24 @@ struct get_cursor_history_reply
 
 
 
+struct get_thread_shared_objects_request
+{
+    struct request_header __header;
+    int            create_queue;
+};
+struct get_thread_shared_objects_reply
+{
+    struct reply_header __header;
+    unsigned int   desktop_id;
+    unsigned int   desktop_offset;
+    unsigned int   queue_id;
+    unsigned int   queue_offset;
+    unsigned int   queue_count;
+    int            has_queue;
+};
+
+
+
 struct get_rawinput_buffer_request
 {
     struct request_header __header;
@@ -5873,6 +5942,7 @@ enum request
     REQ_free_user_handle,
     REQ_set_cursor,
     REQ_get_cursor_history,
+    REQ_get_thread_shared_objects,
     REQ_get_rawinput_buffer,
     REQ_update_rawinput_devices,
     REQ_get_rawinput_devices,
@@ -6165,6 +6235,7 @@ union generic_request
     struct free_user_handle_request free_user_handle_request;
     struct set_cursor_request set_cursor_request;
     struct get_cursor_history_request get_cursor_history_request;
+    struct get_thread_shared_objects_request get_thread_shared_objects_request;
     struct get_rawinput_buffer_request get_rawinput_buffer_request;
     struct update_rawinput_devices_request update_rawinput_devices_request;
     struct get_rawinput_devices_request get_rawinput_devices_request;
@@ -6455,6 +6526,7 @@ union generic_reply
     struct free_user_handle_reply free_user_handle_reply;
     struct set_cursor_reply set_cursor_reply;
     struct get_cursor_history_reply get_cursor_history_reply;
+    struct get_thread_shared_objects_reply get_thread_shared_objects_reply;
     struct get_rawinput_buffer_reply get_rawinput_buffer_reply;
     struct update_rawinput_devices_reply update_rawinput_devices_reply;
     struct get_rawinput_devices_reply get_rawinput_devices_reply;
@@ -6483,7 +6555,7 @@ union generic_reply
 
 /* ### protocol_version begin ### */
 
-#define SERVER_PROTOCOL_VERSION 737
+#define SERVER_PROTOCOL_VERSION 739
 
 /* ### protocol_version end ### */
 
@@ -1569,6 +1569,7 @@ typedef enum _PROCESSINFOCLASS {
     MaxProcessInfoClass,
 #ifdef __WINESRC__
     ProcessWineMakeProcessSystem = 1000,
+    ProcessWineServerCallCount = 1001,
 #endif
 } PROCESSINFOCLASS, PROCESS_INFORMATION_CLASS;
 
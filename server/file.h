@@ -200,6 +200,24 @@ extern struct object *create_user_data_mapping( struct object *root, const struc
                                                 unsigned int attr, const struct security_descriptor *sd );
 extern struct object *create_hypervisor_data_mapping( struct object *root, const struct unicode_str *name,
                                                       unsigned int attr, const struct security_descriptor *sd );
+extern struct object *create_shared_objects_mapping( struct object *root, const struct unicode_str *name,
+                                                     unsigned int attr, const struct security_descriptor *sd );
+extern shared_object_t *alloc_shared_object(void);
+extern void free_shared_object( shared_object_t *object );
+extern unsigned int get_shared_object_offset( const shared_object_t *object );
+
+/* shared objects are updated with a seqlock, readers retry while the sequence is odd or has changed */
+#define SHARED_WRITE_BEGIN( object ) \
+    do { \
+        shared_object_t *__obj = (object); \
+        __atomic_store_n( &__obj->seq, __obj->seq + 1, __ATOMIC_RELAXED ); \
+        __atomic_thread_fence( __ATOMIC_RELEASE ); \
+        do
+
+#define SHARED_WRITE_END \
+        while (0); \
+        __atomic_store_n( &__obj->seq, __obj->seq + 1, __ATOMIC_RELEASE ); \
+    } while (0)
 
 /* device functions */
 
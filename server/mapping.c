@@ -1135,6 +1135,69 @@ struct object *create_hypervisor_data_mapping( struct object *root, const struct
     return &mapping->obj;
 }
 
+static shared_object_t *shared_objects;      /* server view of the shared objects mapping */
+static unsigned int shared_objects_count;    /* number of slots that have been used so far */
+static unsigned int *shared_free_slots;      /* indices of the slots freed since */
+static unsigned int shared_free_count;
+static unsigned int shared_last_id;
+
+struct object *create_shared_objects_mapping( struct object *root, const struct unicode_str *name,
+                                              unsigned int attr, const struct security_descriptor *sd )
+{
+    void *ptr;
+    struct mapping *mapping;
+
+    if (!(mapping = create_mapping( root, name, attr, SHARED_OBJECTS_SIZE,
+                                    SEC_COMMIT, 0, FILE_READ_DATA | FILE_WRITE_DATA, sd ))) return NULL;
+    ptr = mmap( NULL, mapping->size, PROT_READ | PROT_WRITE, MAP_SHARED, get_unix_fd( mapping->fd ), 0 );
+    if (ptr != MAP_FAILED)
+    {
+        if ((shared_free_slots = malloc( SHARED_OBJECTS_SIZE / sizeof(*shared_objects) * sizeof(*shared_free_slots) )))
+            shared_objects = ptr;
+        else
+            munmap( ptr, mapping->size );
+    }
+    return &mapping->obj;
+}
+
+/* allocate a zero-initialized shared object, returns NULL when the mapping is full */
+shared_object_t *alloc_shared_object(void)
+{
+    shared_object_t *object;
+    unsigned int index;
+
+    if (!shared_objects) return NULL;
+    if (shared_free_count) index = shared_free_slots[--shared_free_count];
+    else if (shared_objects_count < SHARED_OBJECTS_SIZE / sizeof(*shared_objects)) index = shared_objects_count++;
+    else return NULL;
+
+    object = &shared_objects[index];
+    if (!++shared_last_id) ++shared_last_id;
+    SHARED_WRITE_BEGIN( object )
+    {
+        memset( (void *)&object->shm, 0, sizeof(object->shm) );
+        object->id = shared_last_id;
+    }
+    SHARED_WRITE_END;
+    return object;
+}
+
+void free_shared_object( shared_object_t *object )
+{
+    if (!object) return;
+    SHARED_WRITE_BEGIN( object )
+    {
+        object->id = 0;
+    }
+    SHARED_WRITE_END;
+    shared_free_slots[shared_free_count++] = object - shared_objects;
+}
+
+unsigned int get_shared_object_offset( const shared_object_t *object )
+{
+    return (const char *)object - (const char *)shared_objects;
+}
+
 /* create a file mapping */
 DECL_HANDLER(create_mapping)
 {
@@ -90,6 +90,7 @@ struct process
     struct list          kernel_object;   /* list of kernel object pointers */
     int                  esync_fd;        /* esync file descriptor (signaled on exit) */
     unsigned int         fsync_idx;
+    struct process_profile *profile;      /* request profiling counters */
 };
 
 /* process functions */
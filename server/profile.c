@@ -0,0 +1,206 @@
+/*
+ * Server request profiling
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "config.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "ntstatus.h"
+#define WIN32_NO_STATUS
+#include "winternl.h"
+
+#include "object.h"
+#include "process.h"
+#include "request.h"
+
+/* Request profiling is toggled with SIGUSR1, and SIGUSR2 writes a snapshot of
+ * the counters to a request-profile-<n> file in the server directory. The
+ * snapshots can be compared with tools/diff_server_profile. */
+
+#define PROFILE_BUCKETS 32  /* bucket n counts the requests that took [2^n, 2^(n+1)) ns */
+
+struct request_stats
+{
+    unsigned int       count;
+    unsigned long long total;     /* total time in ns */
+    unsigned long long max;       /* longest request in ns */
+    unsigned int       hist[PROFILE_BUCKETS];
+};
+
+struct process_profile
+{
+    struct list          entry;
+    struct process      *process; /* NULL once the process is gone */
+    process_id_t         id;
+    char                 name[64];
+    struct request_stats stats;
+};
+
+int profile_requests = 0;
+static unsigned long long profile_start;
+static unsigned int snapshot_count;
+static struct request_stats req_stats[REQ_NB_REQUESTS];
+static struct list process_profiles = LIST_INIT( process_profiles );
+
+unsigned long long profile_time(void)
+{
+#ifdef HAVE_CLOCK_GETTIME
+    struct timespec ts;
+
+    if (!clock_gettime( CLOCK_MONOTONIC, &ts )) return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+#endif
+    return monotonic_counter() * 100;
+}
+
+static inline unsigned int get_bucket( unsigned long long time )
+{
+    unsigned int bucket = 0;
+
+    while (time > 1 && bucket < PROFILE_BUCKETS - 1)
+    {
+        time >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+static inline void add_stats( struct request_stats *stats, unsigned long long time )
+{
+    stats->count++;
+    stats->total += time;
+    if (time > stats->max) stats->max = time;
+    stats->hist[get_bucket( time )]++;
+}
+
+/* store the base name of the process image, in plain ASCII */
+static void get_process_name( struct process *process, char *name, size_t size )
+{
+    data_size_t i, start = 0, len = process->imagelen / sizeof(WCHAR);
+    size_t pos = 0;
+
+    for (i = 0; i < len; i++) if (process->image[i] == '\\' || process->image[i] == '/') start = i + 1;
+    for (i = start; i < len && pos < size - 1; i++)
+        name[pos++] = (process->image[i] > ' ' && process->image[i] < 0x7f) ? process->image[i] : '?';
+    if (!pos) strcpy( name, "-" );
+    else name[pos] = 0;
+}
+
+/* get the profiling counters of a process, they remain valid until profiling is restarted */
+struct process_profile *get_process_profile( struct process *process )
+{
+    struct process_profile *profile;
+
+    if ((profile = process->profile)) return profile;
+    if (!(profile = mem_alloc( sizeof(*profile) ))) return NULL;
+    memset( profile, 0, sizeof(*profile) );
+    profile->process = process;
+    profile->id = process->id;
+    strcpy( profile->name, "-" );
+    list_add_tail( &process_profiles, &profile->entry );
+    process->profile = profile;
+    return profile;
+}
+
+/* account for a request that started at the given time */
+void add_request_profile( enum request req, struct process_profile *profile, unsigned long long start )
+{
+    unsigned long long time = profile_time() - start;
+
+    if (req < REQ_NB_REQUESTS) add_stats( &req_stats[req], time );
+    if (profile) add_stats( &profile->stats, time );
+}
+
+/* keep the counters of a process after it's gone */
+void release_process_profile( struct process *process )
+{
+    struct process_profile *profile = process->profile;
+
+    if (!profile) return;
+    if (process->image) get_process_name( process, profile->name, sizeof(profile->name) );
+    profile->process = NULL;
+    process->profile = NULL;
+}
+
+static void reset_request_profile(void)
+{
+    struct process_profile *profile, *next;
+
+    memset( req_stats, 0, sizeof(req_stats) );
+    LIST_FOR_EACH_ENTRY_SAFE( profile, next, &process_profiles, struct process_profile, entry )
+    {
+        list_remove( &profile->entry );
+        if (profile->process) profile->process->profile = NULL;
+        free( profile );
+    }
+    profile_start = profile_time();
+}
+
+void enable_request_profile( int enable )
+{
+    if (enable && !profile_requests) reset_request_profile();
+    profile_requests = enable;
+}
+
+static void dump_stats( FILE *file, const struct request_stats *stats )
+{
+    unsigned int i;
+
+    fprintf( file, " %u %llu %llu", stats->count, stats->total, stats->max );
+    for (i = 0; i < PROFILE_BUCKETS; i++) fprintf( file, " %u", stats->hist[i] );
+    fputc( '\n', file );
+}
+
+void dump_request_profile(void)
+{
+    struct process_profile *profile;
+    char name[32];
+    FILE *file;
+    unsigned int i;
+
+    sprintf( name, "request-profile-%u", snapshot_count++ );
+    if (!(file = fopen( name, "w" )))
+    {
+        fprintf( stderr, "wineserver: cannot create %s/%s\n", server_dir, name );
+        return;
+    }
+
+    fprintf( file, "# wineserver request profile\n" );
+    fprintf( file, "version 1\n" );
+    fprintf( file, "enabled %d\n", profile_requests );
+    fprintf( file, "elapsed %llu\n", profile_time() - profile_start );
+    fprintf( file, "buckets %u\n", PROFILE_BUCKETS );
+    for (i = 0; i < REQ_NB_REQUESTS; i++)
+    {
+        if (!req_stats[i].count) continue;
+        fprintf( file, "request %s", get_request_name( i ));
+        dump_stats( file, &req_stats[i] );
+    }
+    LIST_FOR_EACH_ENTRY( profile, &process_profiles, struct process_profile, entry )
+    {
+        if (profile->process && profile->process->image)
+            get_process_name( profile->process, profile->name, sizeof(profile->name) );
+        fprintf( file, "process %04x %s", profile->id, profile->name );
+        dump_stats( file, &profile->stats );
+    }
+    fclose( file );
+    fprintf( stderr, "wineserver: request profile written to %s/%s\n", server_dir, name );
+}
@@ -116,6 +116,7 @@ struct thread_input
     unsigned char          keystate[256]; /* state of each key */
     unsigned char          desktop_keystate[256]; /* desktop keystate when keystate was synced */
     int                    keystate_lock; /* keystate is locked */
+    shared_object_t       *shared;        /* input state shared with the clients */
 };
 
 struct msg_queue
@@ -148,6 +149,7 @@ struct msg_queue
     int                    esync_in_msgwait; /* our thread is currently waiting on us */
     unsigned int           fsync_idx;
     int                    fsync_in_msgwait; /* our thread is currently waiting on us */
+    shared_object_t       *shared;          /* queue state shared with the clients */
 };
 
 struct hotkey
@@ -247,6 +249,73 @@ static unsigned int cursor_history_latest;
 static void queue_hardware_message( struct desktop *desktop, struct message *msg, int always_queue );
 static void free_message( struct message *msg );
 
+/* publish the desktop state to its shared object */
+static void update_desktop_shm( struct desktop *desktop )
+{
+    shared_object_t *object = desktop->shared;
+
+    if (!object) return;
+    SHARED_WRITE_BEGIN( object )
+    {
+        desktop_shm_t *shm = &object->shm.desktop;
+
+        shm->cursor.x           = desktop->cursor.x;
+        shm->cursor.y           = desktop->cursor.y;
+        shm->cursor.last_change = desktop->cursor.last_change;
+        shm->cursor.clip        = desktop->cursor.clip;
+        shm->foreground = desktop->foreground_input ? desktop->foreground_input->active : 0;
+        shm->queue_count = desktop->queue_count;
+        memcpy( (void *)shm->keystate, desktop->keystate, sizeof(desktop->keystate) );
+    }
+    SHARED_WRITE_END;
+}
+
+/* publish the thread input state to its shared object */
+static void update_input_shm( struct thread_input *input )
+{
+    shared_object_t *object = input->shared;
+    struct desktop *desktop = input->desktop;
+
+    if (object)
+    {
+        SHARED_WRITE_BEGIN( object )
+        {
+            input_shm_t *shm = &object->shm.input;
+
+            shm->desktop_id    = desktop && desktop->shared ? desktop->shared->id : 0;
+            shm->focus         = input->focus;
+            shm->capture       = input->capture;
+            shm->active        = input->active;
+            shm->cursor        = input->cursor;
+            shm->cursor_count  = input->cursor_count;
+            shm->keystate_lock = input->keystate_lock;
+            memcpy( (void *)shm->keystate, input->keystate, sizeof(input->keystate) );
+            memcpy( (void *)shm->desktop_keystate, input->desktop_keystate, sizeof(input->desktop_keystate) );
+        }
+        SHARED_WRITE_END;
+    }
+
+    /* the desktop foreground window is the active window of its foreground input */
+    if (desktop && desktop->foreground_input == input && desktop->shared &&
+        desktop->shared->shm.desktop.foreground != input->active)
+        update_desktop_shm( desktop );
+}
+
+/* publish the thread input used by a queue to its shared object */
+static void update_queue_shm( struct msg_queue *queue )
+{
+    shared_object_t *object = queue->shared;
+    shared_object_t *input = queue->input->shared;
+
+    if (!object) return;
+    SHARED_WRITE_BEGIN( object )
+    {
+        object->shm.queue.input_id     = input ? input->id : 0;
+        object->shm.queue.input_offset = input ? get_shared_object_offset( input ) : 0;
+    }
+    SHARED_WRITE_END;
+}
+
 /* set the caret window in a given thread input */
 static void set_caret_window( struct thread_input *input, user_handle_t win )
 {
@@ -280,6 +349,7 @@ static struct thread_input *create_thread_input( struct thread *thread )
         set_caret_window( input, 0 );
         memset( input->keystate, 0, sizeof(input->keystate) );
         input->keystate_lock = 0;
+        input->shared = NULL;
 
         if (!(input->desktop = get_thread_desktop( thread, 0 /* FIXME: access rights */ )))
         {
@@ -287,6 +357,8 @@ static struct thread_input *create_thread_input( struct thread *thread )
             return NULL;
         }
         memcpy( input->desktop_keystate, input->desktop->keystate, sizeof(input->desktop_keystate) );
+        input->shared = alloc_shared_object();
+        update_input_shm( input );
     }
     return input;
 }
@@ -327,6 +399,7 @@ static struct msg_queue *create_msg_queue( struct thread *thread, struct thread_
         queue->esync_in_msgwait = 0;
         queue->fsync_idx       = 0;
         queue->fsync_in_msgwait = 0;
+        queue->shared          = alloc_shared_object();
         list_init( &queue->send_result );
         list_init( &queue->callback_result );
         list_init( &queue->pending_timers );
@@ -339,7 +412,15 @@ static struct msg_queue *create_msg_queue( struct thread *thread, struct thread_
         if (do_esync())
             queue->esync_fd = esync_create_fd( 0, 0 );
 
+        update_queue_shm( queue );
         thread->queue = queue;
+
+        /* let the clients know that their missing queue may exist now */
+        if (queue->input->desktop)
+        {
+            queue->input->desktop->queue_count++;
+            update_desktop_shm( queue->input->desktop );
+        }
     }
     if (new_input) release_object( new_input );
     return queue;
@@ -357,19 +438,22 @@ void free_msg_queue( struct thread *thread )
 /* synchronize thread input keystate with the desktop */
 static void sync_input_keystate( struct thread_input *input )
 {
-    int i;
+    int i, changed = 0;
     if (!input->desktop || input->keystate_lock) return;
     for (i = 0; i < sizeof(input->keystate); ++i)
     {
         if (input->desktop_keystate[i] == input->desktop->keystate[i]) continue;
         input->keystate[i] = input->desktop_keystate[i] = input->desktop->keystate[i];
+        changed = 1;
     }
+    if (changed) update_input_shm( input );
 }
 
 /* locks thread input keystate to prevent synchronization */
 static void lock_input_keystate( struct thread_input *input )
 {
     input->keystate_lock++;
+    update_input_shm( input );
 }
 
 /* unlock the thread input keystate and synchronize it again */
@@ -377,6 +461,7 @@ static void unlock_input_keystate( struct thread_input *input )
 {
     input->keystate_lock--;
     if (!input->keystate_lock) sync_input_keystate( input );
+    update_input_shm( input );
 }
 
 /* change the thread input data of a given thread */
@@ -393,11 +478,14 @@ static int assign_thread_input( struct thread *thread, struct thread_input *new_
     {
         queue->input->cursor_count -= queue->cursor_count;
         if (queue->keystate_lock) unlock_input_keystate( queue->input );
+        update_input_shm( queue->input );
         release_object( queue->input );
     }
     queue->input = (struct thread_input *)grab_object( new_input );
     if (queue->keystate_lock) lock_input_keystate( queue->input );
     new_input->cursor_count += queue->cursor_count;
+    update_input_shm( new_input );
+    update_queue_shm( queue );
     return 1;
 }
 
@@ -437,6 +525,7 @@ static int update_desktop_cursor_pos( struct desktop *desktop, int x, int y )
     desktop->cursor.x = x;
     desktop->cursor.y = y;
     desktop->cursor.last_change = get_tick_count();
+    update_desktop_shm( desktop );
 
     return updated;
 }
@@ -490,6 +579,7 @@ static void set_clip_rectangle( struct desktop *desktop, const rectangle_t *rect
         desktop->cursor.clip = new_rect;
     }
     else desktop->cursor.clip = top_rect;
+    update_desktop_shm( desktop );
 
     if (desktop->cursor.clip_msg && send_clip_msg)
         post_desktop_message( desktop, desktop->cursor.clip_msg, rect != NULL, 0 );
@@ -506,6 +596,7 @@ static void set_foreground_input( struct desktop *desktop, struct thread_input *
     if (desktop->foreground_input == input) return;
     set_clip_rectangle( desktop, NULL, 1 );
     desktop->foreground_input = input;
+    update_desktop_shm( desktop );
 }
 
 /* get the hook table for a given thread */
@@ -1134,9 +1225,11 @@ static void msg_queue_destroy( struct object *obj )
     if (queue->timeout) remove_timeout_user( queue->timeout );
     queue->input->cursor_count -= queue->cursor_count;
     if (queue->keystate_lock) unlock_input_keystate( queue->input );
+    update_input_shm( queue->input );
     release_object( queue->input );
     if (queue->hooks) release_object( queue->hooks );
     if (queue->fd) release_object( queue->fd );
+    free_shared_object( queue->shared );
 }
 
 static void msg_queue_poll_event( struct fd *fd, int event )
@@ -1166,6 +1259,7 @@ static void thread_input_destroy( struct object *obj )
         if (input->desktop->foreground_input == input) set_foreground_input( input->desktop, NULL );
         release_object( input->desktop );
     }
+    free_shared_object( input->shared );
 }
 
 /* fix the thread input data when a window is destroyed */
@@ -1179,6 +1273,7 @@ static inline void thread_input_cleanup_window( struct msg_queue *queue, user_ha
     if (window == input->menu_owner) input->menu_owner = 0;
     if (window == input->move_size) input->move_size = 0;
     if (window == input->caret) set_caret_window( input, 0 );
+    update_input_shm( input );
 }
 
 /* check if the specified window can be set in the input data of a given queue */
@@ -1234,6 +1329,7 @@ int attach_thread_input( struct thread *thread_from, struct thread *thread_to )
 
     ret = assign_thread_input( thread_from, input );
     if (ret) memset( input->keystate, 0, sizeof(input->keystate) );
+    update_input_shm( input );
     release_object( input );
     return ret;
 }
@@ -1465,6 +1561,7 @@ static void update_input_key_state( struct desktop *desktop, unsigned char *keys
         }
         break;
     }
+    if (keystate == desktop->keystate) update_desktop_shm( desktop );
 }
 
 /* update the desktop key state according to a mouse message flags */
@@ -1517,6 +1614,7 @@ static void release_hardware_message( struct msg_queue *queue, unsigned int hw_i
     if (clr_bit) clear_queue_bits( queue, clr_bit );
 
     update_input_key_state( input->desktop, input->keystate, msg->msg, msg->wparam );
+    update_input_shm( input );
     list_remove( &msg->entry );
     free_message( msg );
 }
@@ -1685,7 +1783,11 @@ static void queue_hardware_message( struct desktop *desktop, struct message *msg
     win = find_hardware_message_window( desktop, input, msg, &msg_code, &thread );
     if (!win || !thread)
     {
-        if (input) update_input_key_state( input->desktop, input->keystate, msg->msg, msg->wparam );
+        if (input)
+        {
+            update_input_key_state( input->desktop, input->keystate, msg->msg, msg->wparam );
+            update_input_shm( input );
+        }
         free_message( msg );
         return;
     }
@@ -1867,6 +1969,7 @@ static int queue_mouse_message( struct desktop *desktop, user_handle_t win, cons
     };
 
     desktop->cursor.last_change = get_tick_count();
+    update_desktop_shm( desktop );
     flags = input->mouse.flags;
     time  = input->mouse.time;
     if (!time) time = desktop->cursor.last_change;
@@ -2029,6 +2132,7 @@ static int queue_keyboard_message( struct desktop *desktop, user_handle_t win, c
         desktop->keystate[VK_MENU] &= ~0x02;
         break;
     }
+    update_desktop_shm( desktop );
 
     if ((req_flags & SEND_HWMSG_RAWINPUT) && (foreground = get_foreground_thread( desktop, win )))
     {
@@ -2221,6 +2325,7 @@ static int get_hardware_message( struct thread *thread, unsigned int hw_id, user
         {
             /* no window at all, remove it */
             update_input_key_state( input->desktop, input->keystate, msg->msg, msg->wparam );
+            update_input_shm( input );
             list_remove( &msg->entry );
             free_message( msg );
             continue;
@@ -2237,6 +2342,7 @@ static int get_hardware_message( struct thread *thread, unsigned int hw_id, user
             {
                 /* for another thread input, drop it */
                 update_input_key_state( input->desktop, input->keystate, msg->msg, msg->wparam );
+                update_input_shm( input );
                 list_remove( &msg->entry );
                 free_message( msg );
             }
@@ -3176,7 +3282,11 @@ DECL_HANDLER(get_key_state)
         if (req->key >= 0)
         {
             reply->state = desktop->keystate[req->key & 0xff];
-            desktop->keystate[req->key & 0xff] &= ~0x40;
+            if (reply->state & 0x40)
+            {
+                desktop->keystate[req->key & 0xff] &= ~0x40;
+                update_desktop_shm( desktop );
+            }
         }
         set_reply_data( desktop->keystate, size );
         release_object( desktop );
@@ -3204,9 +3314,11 @@ DECL_HANDLER(set_key_state)
 
     memcpy( queue->input->keystate, get_req_data(), size );
     memcpy( queue->input->desktop_keystate, queue->input->desktop->keystate, 256 );
+    update_input_shm( queue->input );
     if (req->async && (desktop = get_thread_desktop( current, 0 )))
     {
         memcpy( desktop->keystate, get_req_data(), size );
+        update_desktop_shm( desktop );
         release_object( desktop );
     }
 }
@@ -3248,6 +3360,7 @@ DECL_HANDLER(set_focus_window)
     {
         reply->previous = queue->input->focus;
         queue->input->focus = get_user_full_handle( req->handle );
+        update_input_shm( queue->input );
     }
 }
 
@@ -3264,6 +3377,7 @@ DECL_HANDLER(set_active_window)
         {
             reply->previous = queue->input->active;
             queue->input->active = get_user_full_handle( req->handle );
+            update_input_shm( queue->input );
         }
         else set_error( STATUS_INVALID_HANDLE );
     }
@@ -3291,6 +3405,7 @@ DECL_HANDLER(set_capture_window)
         input->menu_owner = (req->flags & CAPTURE_MENU) ? input->capture : 0;
         input->move_size = (req->flags & CAPTURE_MOVESIZE) ? input->capture : 0;
         reply->full_handle = input->capture;
+        update_input_shm( input );
     }
 }
 
@@ -3396,6 +3511,7 @@ DECL_HANDLER(set_cursor)
         queue->cursor_count += req->show_count;
         input->cursor_count += req->show_count;
     }
+    if (req->flags & (SET_CURSOR_HANDLE | SET_CURSOR_COUNT)) update_input_shm( input );
     if (req->flags & SET_CURSOR_POS)
     {
         set_cursor_pos( input->desktop, req->x, req->y );
@@ -3428,6 +3544,28 @@ DECL_HANDLER(get_cursor_history)
             pos[i] = cursor_history[(i + cursor_history_latest) % ARRAY_SIZE(cursor_history)];
 }
 
+/* retrieve the shared objects of the current thread desktop and queue */
+DECL_HANDLER(get_thread_shared_objects)
+{
+    struct msg_queue *queue = req->create_queue ? get_current_queue() : current->queue;
+    struct desktop *desktop;
+
+    if (!(desktop = get_thread_desktop( current, 0 ))) return;
+    if (desktop->shared)
+    {
+        reply->desktop_id     = desktop->shared->id;
+        reply->desktop_offset = get_shared_object_offset( desktop->shared );
+    }
+    if (queue && queue->shared)
+    {
+        reply->queue_id     = queue->shared->id;
+        reply->queue_offset = get_shared_object_offset( queue->shared );
+    }
+    reply->queue_count = desktop->queue_count;
+    reply->has_queue   = queue != NULL;
+    release_object( desktop );
+}
+
 DECL_HANDLER(get_rawinput_buffer)
 {
     struct thread_input *input = current->queue->input;
@@ -299,6 +299,14 @@ static void call_req_handler( struct thread *thread )
 {
     union generic_reply reply;
     enum request req = thread->req.request_header.req;
+    struct process_profile *profile = NULL;
+    unsigned long long start = 0;
+
+    if (profile_requests)
+    {
+        profile = get_process_profile( thread->process );
+        start = profile_time();
+    }
 
     current = thread;
     current->reply_size = 0;
@@ -328,6 +336,7 @@ static void call_req_handler( struct thread *thread )
         }
     }
     current = NULL;
+    if (start) add_request_profile( req, profile, start );
 }
 
 /* read a request from a thread */
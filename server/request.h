@@ -65,6 +65,18 @@ extern int server_dir_fd, config_dir_fd;
 
 extern void trace_request(void);
 extern void trace_reply( enum request req, const union generic_reply *reply );
+extern const char *get_request_name( enum request req );
+
+/* request profiling functions */
+
+struct process_profile;
+extern int profile_requests;
+extern unsigned long long profile_time(void);
+extern struct process_profile *get_process_profile( struct process *process );
+extern void add_request_profile( enum request req, struct process_profile *profile, unsigned long long start );
+extern void release_process_profile( struct process *process );
+extern void enable_request_profile( int enable );
+extern void dump_request_profile(void);
 
 /* get current tick count to return to client */
 static inline unsigned int get_tick_count(void)
@@ -380,6 +392,7 @@ DECL_HANDLER(alloc_user_handle);
 DECL_HANDLER(free_user_handle);
 DECL_HANDLER(set_cursor);
 DECL_HANDLER(get_cursor_history);
+DECL_HANDLER(get_thread_shared_objects);
 DECL_HANDLER(get_rawinput_buffer);
 DECL_HANDLER(update_rawinput_devices);
 DECL_HANDLER(get_rawinput_devices);
@@ -671,6 +684,7 @@ static const req_handler req_handlers[REQ_NB_REQUESTS] =
     (req_handler)req_free_user_handle,
     (req_handler)req_set_cursor,
     (req_handler)req_get_cursor_history,
+    (req_handler)req_get_thread_shared_objects,
     (req_handler)req_get_rawinput_buffer,
     (req_handler)req_update_rawinput_devices,
     (req_handler)req_get_rawinput_devices,
@@ -2220,6 +2234,15 @@ C_ASSERT( FIELD_OFFSET(struct set_cursor_reply, last_change) == 48 );
 C_ASSERT( sizeof(struct set_cursor_reply) == 56 );
 C_ASSERT( sizeof(struct get_cursor_history_request) == 16 );
 C_ASSERT( sizeof(struct get_cursor_history_reply) == 8 );
+C_ASSERT( FIELD_OFFSET(struct get_thread_shared_objects_request, create_queue) == 12 );
+C_ASSERT( sizeof(struct get_thread_shared_objects_request) == 16 );
+C_ASSERT( FIELD_OFFSET(struct get_thread_shared_objects_reply, desktop_id) == 8 );
+C_ASSERT( FIELD_OFFSET(struct get_thread_shared_objects_reply, desktop_offset) == 12 );
+C_ASSERT( FIELD_OFFSET(struct get_thread_shared_objects_reply, queue_id) == 16 );
+C_ASSERT( FIELD_OFFSET(struct get_thread_shared_objects_reply, queue_offset) == 20 );
+C_ASSERT( FIELD_OFFSET(struct get_thread_shared_objects_reply, queue_count) == 24 );
+C_ASSERT( FIELD_OFFSET(struct get_thread_shared_objects_reply, has_queue) == 28 );
+C_ASSERT( sizeof(struct get_thread_shared_objects_reply) == 32 );
 C_ASSERT( FIELD_OFFSET(struct get_rawinput_buffer_request, rawinput_size) == 12 );
 C_ASSERT( FIELD_OFFSET(struct get_rawinput_buffer_request, buffer_size) == 16 );
 C_ASSERT( sizeof(struct get_rawinput_buffer_request) == 24 );
@@ -4450,6 +4450,21 @@ static void dump_get_cursor_history_reply( const struct get_cursor_history_reply
     dump_varargs_cursor_positions( " history=", cur_size );
 }
 
+static void dump_get_thread_shared_objects_request( const struct get_thread_shared_objects_request *req )
+{
+    fprintf( stderr, " create_queue=%d", req->create_queue );
+}
+
+static void dump_get_thread_shared_objects_reply( const struct get_thread_shared_objects_reply *req )
+{
+    fprintf( stderr, " desktop_id=%08x", req->desktop_id );
+    fprintf( stderr, ", desktop_offset=%08x", req->desktop_offset );
+    fprintf( stderr, ", queue_id=%08x", req->queue_id );
+    fprintf( stderr, ", queue_offset=%08x", req->queue_offset );
+    fprintf( stderr, ", queue_count=%08x", req->queue_count );
+    fprintf( stderr, ", has_queue=%d", req->has_queue );
+}
+
 static void dump_get_rawinput_buffer_request( const struct get_rawinput_buffer_request *req )
 {
     fprintf( stderr, " rawinput_size=%u", req->rawinput_size );
@@ -4940,6 +4955,7 @@ static const dump_func req_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_free_user_handle_request,
     (dump_func)dump_set_cursor_request,
     (dump_func)dump_get_cursor_history_request,
+    (dump_func)dump_get_thread_shared_objects_request,
     (dump_func)dump_get_rawinput_buffer_request,
     (dump_func)dump_update_rawinput_devices_request,
     (dump_func)dump_get_rawinput_devices_request,
@@ -5228,6 +5244,7 @@ static const dump_func reply_dumpers[REQ_NB_REQUESTS] = {
     NULL,
     (dump_func)dump_set_cursor_reply,
     (dump_func)dump_get_cursor_history_reply,
+    (dump_func)dump_get_thread_shared_objects_reply,
     (dump_func)dump_get_rawinput_buffer_reply,
     NULL,
     (dump_func)dump_get_rawinput_devices_reply,
@@ -5516,6 +5533,7 @@ static const char * const req_names[REQ_NB_REQUESTS] = {
     "free_user_handle",
     "set_cursor",
     "get_cursor_history",
+    "get_thread_shared_objects",
     "get_rawinput_buffer",
     "update_rawinput_devices",
     "get_rawinput_devices",
@@ -5772,3 +5790,8 @@ void trace_reply( enum request req, const union generic_reply *reply )
     else fprintf( stderr, "%04x: %d() = %s\n",
                   current->id, req, get_status_name(current->error) );
 }
+
+const char *get_request_name( enum request req )
+{
+    return req < REQ_NB_REQUESTS ? req_names[req] : "?";
+}
@@ -77,6 +77,8 @@ struct desktop
     unsigned int         users;            /* processes and threads using this desktop */
     struct global_cursor cursor;           /* global cursor information */
     unsigned char        keystate[256];    /* asynchronous key state */
+    unsigned int         queue_count;      /* number of message queues created on the desktop */
+    shared_object_t     *shared;           /* desktop state shared with the clients */
 };
 
 /* user handles functions */
@@ -259,6 +259,7 @@ dumpers[] =
     {SIG_FNT,           get_kind_fnt,   fnt_dump},
     {SIG_TLB,           get_kind_tlb,   tlb_dump},
     {SIG_NLS,           get_kind_nls,   nls_dump},
+    {SIG_ETL,           get_kind_etl,   etl_dump},
     {SIG_UNKNOWN,       NULL,           NULL} /* sentinel */
 };
 
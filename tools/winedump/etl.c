@@ -0,0 +1,157 @@
+/*
+ * Dump an event trace log written by a Wine trace session
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+
+#include "windef.h"
+#include "winbase.h"
+#include "wmistr.h"
+#include "evntrace.h"
+#include "evntprov.h"
+#include "winedump.h"
+#include "wine/etw.h"
+
+struct provider_count
+{
+    GUID         guid;
+    unsigned int count;
+};
+
+static struct provider_count *providers;
+static unsigned int provider_count;
+
+static void count_event( const GUID *guid )
+{
+    unsigned int i;
+
+    for (i = 0; i < provider_count; i++)
+        if (!memcmp( &providers[i].guid, guid, sizeof(*guid) )) break;
+    if (i == provider_count)
+    {
+        providers = realloc( providers, (provider_count + 1) * sizeof(*providers) );
+        providers[provider_count].guid = *guid;
+        providers[provider_count++].count = 0;
+    }
+    providers[i].count++;
+}
+
+static void dump_event( const struct wine_etw_log_header *header, const struct wine_etw_event_record *record )
+{
+    const EVENT_DESCRIPTOR *desc = &record->descriptor;
+    const unsigned int *sizes = (const unsigned int *)(record + 1);
+    const unsigned char *data = (const unsigned char *)(sizes + record->data_count);
+    double time = 0;
+    unsigned int i;
+
+    if (header->frequency.QuadPart)
+        time = (double)(record->timestamp.QuadPart - header->start_time.QuadPart) * 1000 / header->frequency.QuadPart;
+
+    printf( "  %12.6f ms tid %04x provider %s\n", time, record->tid, get_guid_str( &record->provider ) );
+    printf( "    id %u version %u channel %u level %u opcode %u task %u keyword %x%08x\n",
+            desc->Id, desc->Version, desc->Channel, desc->Level, desc->Opcode, desc->Task,
+            (DWORD)(desc->Keyword >> 32), (DWORD)desc->Keyword );
+    if (record->flags & WINE_ETW_EVENT_ACTIVITY)
+    {
+        printf( "    activity %s", get_guid_str( &record->activity ) );
+        printf( " related %s\n", get_guid_str( &record->related_activity ) );
+    }
+
+    if (record->flags & WINE_ETW_EVENT_STRING)
+    {
+        printf( "    " );
+        dump_unicode_str( (const WCHAR *)data, record->data_size / sizeof(WCHAR) );
+        printf( "\n" );
+    }
+    else
+    {
+        for (i = 0; i < record->data_count; i++)
+        {
+            printf( "    data %u, %u bytes\n", i, sizes[i] );
+            if (sizes[i]) dump_data( data, sizes[i], "      " );
+            data += sizes[i];
+        }
+    }
+    count_event( &record->provider );
+}
+
+enum FileSig get_kind_etl(void)
+{
+    const struct wine_etw_log_header *header;
+
+    header = PRD(0, sizeof(*header));
+    if (header && header->magic == WINE_ETW_LOG_MAGIC) return SIG_ETL;
+    return SIG_UNKNOWN;
+}
+
+void etl_dump(void)
+{
+    const struct wine_etw_log_header *header = PRD(0, sizeof(*header));
+    const struct wine_etw_buffer_header *buffer;
+    const struct wine_etw_event_record *record;
+    unsigned long pos = sizeof(*header);
+    unsigned int buffers = 0, events = 0, lost = 0, i, offset;
+
+    printf( "Event trace log\n" );
+    printf( "  version:      %u\n", header->version );
+    printf( "  logger:       " );
+    dump_unicode_str( header->logger_name, ARRAY_SIZE(header->logger_name) );
+    printf( "\n" );
+    printf( "  pid:          %04x\n", header->pid );
+    printf( "  buffers:      %u x %u bytes\n", header->buffer_count, header->buffer_size );
+    printf( "  log mode:     %08x\n", header->log_file_mode );
+    printf( "  frequency:    %x%08x\n", header->frequency.u.HighPart, header->frequency.u.LowPart );
+    printf( "  start time:   %x%08x\n", header->start_time.u.HighPart, header->start_time.u.LowPart );
+    printf( "  system time:  %s\n", get_time_str( (header->start_system_time.QuadPart / 10000000) - 11644473600LL ) );
+
+    while ((buffer = PRD( pos, sizeof(*buffer) )))
+    {
+        pos += sizeof(*buffer);
+        printf( "\nBuffer %u (cpu slot %u, %u bytes, %u events lost so far)\n",
+                buffer->sequence, buffer->index, buffer->size, buffer->events_lost );
+        if (!PRD( pos, buffer->size ))
+        {
+            printf( "  truncated buffer\n" );
+            break;
+        }
+        for (offset = 0; offset + sizeof(*record) <= buffer->size; offset += record->size)
+        {
+            record = PRD( pos + offset, sizeof(*record) );
+            if (record->size < sizeof(*record) || offset + record->size > buffer->size)
+            {
+                printf( "  invalid record size %u at offset %u\n", record->size, offset );
+                break;
+            }
+            dump_event( header, record );
+            events++;
+        }
+        pos += buffer->size;
+        lost = buffer->events_lost;
+        buffers++;
+    }
+
+    printf( "\n%u events in %u buffers, %u lost\n", events, buffers, lost );
+    for (i = 0; i < provider_count; i++)
+        printf( "  %s: %u events\n", get_guid_str( &providers[i].guid ), providers[i].count );
+    free( providers );
+    providers = NULL;
+    provider_count = 0;
+}